@@ -5,8 +5,12 @@ See LICENSE file in root folder
 #define ___SDW_WriterGlsl_H___
 
 #include <ShaderAST/ShaderASTPrerequisites.hpp>
+#include <ShaderAST/ShaderBatch.hpp>
+#include <ShaderAST/Visitors/FunctionHashes.hpp>
 #include <GlslCommon/GlslStatementsHelpers.hpp>
 
+#include <span>
+
 #if defined( CompilerGlsl_Static )
 #	define SDWGLSL_API
 #elif defined( _WIN32 )
@@ -23,6 +27,15 @@ namespace glsl
 {
 	using GlslConfig = StmtConfig;
 
+	/**
+	*	Hashes the options of \p config that change the generated source, for ast::ShaderMemoT.
+	*/
+	SDWGLSL_API size_t hashConfig( GlslConfig const & config );
+	/**
+	*	Keeps the GLSL source of a shader, and of its functions, between two compilations.
+	*/
+	using GlslMemo = ast::ShaderMemoT< std::string >;
+
 	SDWGLSL_API std::string compileGlsl( ast::Shader const & shader
 		, ast::stmt::Container const * statements
 		, ast::ShaderStage stage
@@ -31,6 +44,69 @@ namespace glsl
 	SDWGLSL_API std::string compileGlsl( ast::Shader const & shader
 		, ast::SpecialisationInfo const & specialisation
 		, GlslConfig & config );
+	/**
+	*	Compiles a shader, reusing from \p memo the source of the functions that didn't change since the previous compilation.
+	*	The transformation passes still run on the whole shader, only the generation is done per function.
+	*	It is the same source as the one compileGlsl gives.
+	*\param[in]	shader
+	*	The shader.
+	*\param[in]	specialisation
+	*	The specialisation.
+	*\param[in,out]	config
+	*	The config, updated like compileGlsl does.
+	*\param[in,out]	memo
+	*	The memo, kept from a compilation of the shader to the next one.
+	*\return
+	*	The GLSL source.
+	*/
+	SDWGLSL_API std::string compileGlsl( ast::Shader const & shader
+		, ast::SpecialisationInfo const & specialisation
+		, GlslConfig & config
+		, GlslMemo & memo );
+	/**
+	*	Compiles a shader once up to adaptation, and then generates one GLSL source per specialisation.
+	*	Each variant only goes through specialisation, constants folding (which removes the dead branches), and generation.
+	*	It is the same source as the one compileGlsl gives for its specialisation.
+	*\param[in]	shader
+	*	The shader.
+	*\param[in]	specialisations
+	*	The specialisations, one per wanted variant.
+	*\param[in,out]	config
+	*	The config, updated like compileGlsl does.
+	*\return
+	*	The GLSL sources, one per specialisation.
+	*/
+	SDWGLSL_API std::vector< std::string > compileGlslVariants( ast::Shader const & shader
+		, std::span< ast::SpecialisationInfo const > specialisations
+		, GlslConfig & config );
+	/**
+	*	Called from the worker thread, when a batch item is compiled.
+	*/
+	using GlslBatchCallback = std::function< void( size_t index
+		, std::string const & source ) >;
+	/**
+	*	Compiles a batch of shaders, on a work-stealing pool.
+	*	Items sharing the same shader are compiled sequentially, on the same worker.
+	*	The configs' allocator is ignored, each worker uses its own scratch allocator.
+	*	If compilations throw, the exception of the lowest item index is rethrown.
+	*\param[in]	shaders
+	*	The shaders.
+	*\param[in]	specialisations
+	*	The specialisations, one per shader, or empty if the shaders have no specialisation constant.
+	*\param[in,out]	configs
+	*	The configs, one per shader, updated like compileGlsl does.
+	*\param[in]	batchConfig
+	*	The pool configuration.
+	*\param[in]	onCompiled
+	*	Optional callback, called once per item.
+	*\return
+	*	The GLSL sources, in input order.
+	*/
+	SDWGLSL_API std::vector< std::string > compileBatch( std::span< ast::Shader const * const > shaders
+		, std::span< ast::SpecialisationInfo const > specialisations
+		, std::span< GlslConfig > configs
+		, ast::BatchConfig const & batchConfig = {}
+		, GlslBatchCallback const & onCompiled = {} );
 }
 
 #endif
@@ -5,6 +5,11 @@ See LICENSE file in root folder
 #define ___SDW_WriterHlsl_H___
 
 #include <ShaderAST/ShaderASTPrerequisites.hpp>
+#include <ShaderAST/ShaderBatch.hpp>
+#include <ShaderAST/Visitors/FunctionHashes.hpp>
+#include <ShaderAST/Visitors/OptimiseStatements.hpp>
+
+#include <span>
 
 #if defined( CompilerHlsl_Static )
 #	define SDWHLSL_API
@@ -45,8 +50,18 @@ namespace hlsl
 		ast::ShaderStage shaderStage;
 		bool flipVertY{ false };
 		ast::ShaderAllocator * allocator{};
+		ast::OptimisationConfig optimisations{};
 	};
 
+	/**
+	*	Hashes the options of \p config that change the generated source, for ast::ShaderMemoT.
+	*/
+	SDWHLSL_API size_t hashConfig( HlslConfig const & config );
+	/**
+	*	Keeps the HLSL source of a shader, and of its functions, between two compilations.
+	*/
+	using HlslMemo = ast::ShaderMemoT< std::string >;
+
 	SDWHLSL_API std::string compileHlsl( ast::Shader const & shader
 		, ast::stmt::Container const * statements
 		, ast::ShaderStage stage
@@ -55,6 +70,69 @@ namespace hlsl
 	SDWHLSL_API std::string compileHlsl( ast::Shader const & shader
 		, ast::SpecialisationInfo const & specialisation
 		, HlslConfig const & writerConfig );
+	/**
+	*	Compiles a shader, reusing from \p memo the source of the functions that didn't change since the previous compilation.
+	*	The transformation passes still run on the whole shader, only the generation is done per function.
+	*	It is the same source as the one compileHlsl gives.
+	*\param[in]	shader
+	*	The shader.
+	*\param[in]	specialisation
+	*	The specialisation.
+	*\param[in]	writerConfig
+	*	The config.
+	*\param[in,out]	memo
+	*	The memo, kept from a compilation of the shader to the next one.
+	*\return
+	*	The HLSL source.
+	*/
+	SDWHLSL_API std::string compileHlsl( ast::Shader const & shader
+		, ast::SpecialisationInfo const & specialisation
+		, HlslConfig const & writerConfig
+		, HlslMemo & memo );
+	/**
+	*	Compiles a shader once up to adaptation, and then generates one HLSL source per specialisation.
+	*	Each variant only goes through specialisation, constants folding (which removes the dead branches), and generation.
+	*	It is the same source as the one compileHlsl gives for its specialisation.
+	*\param[in]	shader
+	*	The shader.
+	*\param[in]	specialisations
+	*	The specialisations, one per wanted variant.
+	*\param[in]	writerConfig
+	*	The config.
+	*\return
+	*	The HLSL sources, one per specialisation.
+	*/
+	SDWHLSL_API std::vector< std::string > compileHlslVariants( ast::Shader const & shader
+		, std::span< ast::SpecialisationInfo const > specialisations
+		, HlslConfig const & writerConfig );
+	/**
+	*	Called from the worker thread, when a batch item is compiled.
+	*/
+	using HlslBatchCallback = std::function< void( size_t index
+		, std::string const & source ) >;
+	/**
+	*	Compiles a batch of shaders, on a work-stealing pool.
+	*	Items sharing the same shader are compiled sequentially, on the same worker.
+	*	The configs' allocator is ignored, each worker uses its own scratch allocator.
+	*	If compilations throw, the exception of the lowest item index is rethrown.
+	*\param[in]	shaders
+	*	The shaders.
+	*\param[in]	specialisations
+	*	The specialisations, one per shader, or empty if the shaders have no specialisation constant.
+	*\param[in]	configs
+	*	The configs, one per shader.
+	*\param[in]	batchConfig
+	*	The pool configuration.
+	*\param[in]	onCompiled
+	*	Optional callback, called once per item.
+	*\return
+	*	The HLSL sources, in input order.
+	*/
+	SDWHLSL_API std::vector< std::string > compileBatch( std::span< ast::Shader const * const > shaders
+		, std::span< ast::SpecialisationInfo const > specialisations
+		, std::span< HlslConfig const > configs
+		, ast::BatchConfig const & batchConfig = {}
+		, HlslBatchCallback const & onCompiled = {} );
 }
 
 #endif
@@ -5,8 +5,12 @@ See LICENSE file in root folder
 #define ___SDW_WriterSpirV_H___
 
 #include <ShaderAST/ShaderASTPrerequisites.hpp>
+#include <ShaderAST/ShaderBatch.hpp>
+#include <ShaderAST/Visitors/FunctionHashes.hpp>
+#include <ShaderAST/Visitors/OptimiseStatements.hpp>
 
 #include <set>
+#include <span>
 #include <vector>
 
 #if defined( CompilerSpirV_Static )
@@ -126,12 +130,43 @@ namespace spirv
 		eDebugInfo
 	};
 
+	struct ControlFlowStats
+	{
+		// The blocks count of the functions, before and after the control flow simplification.
+		uint32_t blocksBefore{};
+		uint32_t blocksAfter{};
+	};
+
 	struct SpirVConfig
 	{
 		uint32_t specVersion{ v1_1 };
 		SpirVExtensionSet * availableExtensions{};
 		DebugLevel debugLevel{};
 		ast::ShaderAllocator * allocator{};
+		// If set, the specialisation constants are baked into the module, instead of being emitted as OpSpecConstant*.
+		// The constants are then folded, and the branches they make unreachable are removed.
+		ast::SpecialisationInfo const * specialisation{};
+		// The optimisations run on the AST, after constants resolution.
+		ast::OptimisationConfig optimisations{};
+		// If set, the values stored through a pointer are reused by the following loads of this pointer in the same block,
+		// and the stores to invocation private variables that are overwritten or never read are removed.
+		bool eliminateRedundantMemoryAccesses{};
+		// If set, the scalar and vector Function variables only accessed through OpLoad and OpStore are replaced
+		// by the stored values, with OpPhi instructions where the control flow merges.
+		bool promoteLocalVariables{};
+		// If set, the blocks only reached from a block branching unconditionally to them are merged into it,
+		// the empty blocks are removed, and the selections whose branches are empty are folded,
+		// when the structured control flow rules allow it.
+		bool simplifyControlFlow{};
+		// Optional, receives the blocks counts of the control flow simplification.
+		ControlFlowStats * controlFlowStats{};
+		// If set, the ids are renumbered densely once the module is generated, in their definition order.
+		// This lowers the ids bound, and identical shaders get identical modules.
+		bool compactIds{};
+		// The number of threads generating the function bodies, 0 and 1 generate them on the calling thread.
+		// The functions are split in that many contiguous chunks, generated in separate modules merged in order,
+		// so the module depends on this count, not on the threads scheduling. Ignored with DebugLevel::eDebugInfo.
+		uint32_t generationThreads{};
 		// Filled by writeSpirv/serialiseSpirv
 		uint32_t requiredVersion{ vUnk };
 		SpirVExtensionSet requiredExtensions{};
@@ -143,7 +178,22 @@ namespace spirv
 		SDWSPIRV_API void operator()( Module * shaderModule );
 	};
 	using ModulePtr = std::unique_ptr< Module, ModuleDeleter >;
+
+	struct FunctionModule;
+	struct FunctionModuleDeleter
+	{
+		SDWSPIRV_API void operator()( FunctionModule * functionModule );
+	};
+	using FunctionModulePtr = std::unique_ptr< FunctionModule, FunctionModuleDeleter >;
+	/**
+	*	Keeps the SPIR-V module of a shader, and the modules generated for its functions, between two compilations.
+	*/
+	using SpirVMemo = ast::ShaderMemoT< std::vector< uint32_t >, FunctionModulePtr >;
 	
+	/**
+	*	Hashes the options of \p config that change the generated module, for ast::ShaderMemoT.
+	*/
+	SDWSPIRV_API size_t hashConfig( SpirVConfig const & config );
 	SDWSPIRV_API ModulePtr compileSpirV( ast::ShaderAllocatorBlock & allocator
 		, ast::Shader const & shader
 		, ast::stmt::Container const * statements
@@ -170,6 +220,47 @@ namespace spirv
 		, SpirVConfig & config );
 	SDWSPIRV_API std::vector< uint32_t > serialiseSpirv( ast::Shader const & shader
 		, SpirVConfig & config );
+	/**
+	*	Serialises a shader, reusing from \p memo the functions that didn't change since the previous compilation.
+	*	The transformation passes still run on the whole shader, each function body is then generated in its own module,
+	*	or reused, and merged in a module where the functions are only declared (see SpirVConfig::generationThreads).
+	*	With DebugLevel::eDebugInfo, only the whole module is reused.
+	*\param[in]	shader
+	*	The shader.
+	*\param[in,out]	config
+	*	The config, filled like serialiseSpirv does.
+	*\param[in,out]	memo
+	*	The memo, kept from a compilation of the shader to the next one.
+	*\return
+	*	The SPIR-V module.
+	*/
+	SDWSPIRV_API std::vector< uint32_t > serialiseSpirv( ast::Shader const & shader
+		, SpirVConfig & config
+		, SpirVMemo & memo );
+	/**
+	*	Called from the worker thread, when a batch item is compiled.
+	*/
+	using SpirVBatchCallback = std::function< void( size_t index
+		, std::vector< uint32_t > const & spirv ) >;
+	/**
+	*	Serialises a batch of shaders, on a work-stealing pool.
+	*	Items sharing the same shader are compiled sequentially, on the same worker.
+	*	The configs' allocator is ignored, each worker uses its own scratch allocator.
+	*\param[in]	shaders
+	*	The shaders.
+	*\param[in,out]	configs
+	*	The configs, one per shader, filled like serialiseSpirv does.
+	*\param[in]	batchConfig
+	*	The pool configuration.
+	*\param[in]	onCompiled
+	*	Optional callback, called once per item.
+	*\return
+	*	The SPIR-V modules, in input order.
+	*/
+	SDWSPIRV_API std::vector< std::vector< uint32_t > > compileBatch( std::span< ast::Shader const * const > shaders
+		, std::span< SpirVConfig > configs
+		, ast::BatchConfig const & batchConfig = {}
+		, SpirVBatchCallback const & onCompiled = {} );
 	SDWSPIRV_API std::string displaySpirv( ast::ShaderAllocatorBlock & allocator
 		, std::vector< uint32_t > const & spirv );
 	SDWSPIRV_API ast::Shader parseSpirv( ast::ShaderAllocatorBlock & allocator
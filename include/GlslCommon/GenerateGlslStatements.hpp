@@ -7,6 +7,8 @@ See LICENSE file in root folder
 
 #include "GlslStatementsHelpers.hpp"
 
+#include <ShaderAST/Visitors/FunctionHashes.hpp>
+
 #include <map>
 #pragma warning( push )
 #pragma warning( disable: 4365 )
@@ -20,6 +22,15 @@ namespace glsl
 		, IntrinsicsConfig const & intrinsics
 		, ast::stmt::Container const & stmt
 		, bool withExprColumns = false );
+	/**
+	*	Generates the source of \p stmt, reusing the sources of the functions found in \p functions,
+	*	and storing the sources of the ones it generates, see ast::ShaderMemoT.
+	*	The statements are only listed for the generated functions.
+	*/
+	SDWGLC_API Statements generateGlslStatements( StmtConfig const & config
+		, IntrinsicsConfig const & intrinsics
+		, ast::stmt::Container const & stmt
+		, ast::FunctionOutputsT< std::string > & functions );
 	SDWGLC_API std::string getExprName( StmtConfig const & config
 		, ast::expr::Expr const & expr );
 }
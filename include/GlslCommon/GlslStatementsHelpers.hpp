@@ -9,6 +9,7 @@ See LICENSE file in root folder
 #include <ShaderAST/Type/TypeCombinedImage.hpp>
 #include <ShaderAST/Type/TypeImage.hpp>
 #include <ShaderAST/Type/TypeSampledImage.hpp>
+#include <ShaderAST/Visitors/OptimiseStatements.hpp>
 
 #include <map>
 #include <set>
@@ -150,6 +151,7 @@ namespace glsl
 		bool hasDescriptorSets{ false };
 		bool hasBaseInstance{ false };
 		ast::ShaderAllocator * allocator{};
+		ast::OptimisationConfig optimisations{};
 		// Filled by writeGlsl
 		uint32_t requiredVersion{ vUnk };
 		GlslExtensionSet requiredExtensions{};
@@ -249,6 +251,12 @@ namespace glsl
 	SDWGLC_API RangeInfo getColumnData( Statement const * statement
 		, ast::expr::Expr const & expr );
 	SDWGLC_API RangeInfo getColumnData( Statement const * statement );
+	/**
+	*	Lists the generated statements of the given AST statements, to retrieve their source ranges.
+	*	The scope delimiters are left out.
+	*/
+	SDWGLC_API std::vector< Statement const * > findStatements( Statements const & statements
+		, std::vector< ast::stmt::Stmt const * > const & stmts );
 
 	inline bool checkBufferMemoryBarrier( ast::type::MemorySemantics semantics )
 	{
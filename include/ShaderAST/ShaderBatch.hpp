@@ -0,0 +1,54 @@
+/*
+See LICENSE file in root folder
+*/
+#ifndef ___AST_ShaderBatch_H___
+#define ___AST_ShaderBatch_H___
+#pragma once
+
+#include "ShaderAllocator.hpp"
+
+#include <functional>
+
+namespace ast
+{
+	struct BatchConfig
+	{
+		// The maximum number of worker threads, 0 means std::thread::hardware_concurrency().
+		uint32_t concurrency{};
+	};
+	/**
+	*	A batch job.
+	*\param[in]	allocator
+	*	The calling worker's scratch allocator.
+	*\param[in]	index
+	*	The job index, in [0, count).
+	*/
+	using BatchJob = std::function< void( ShaderAllocator & allocator, size_t index ) >;
+	/**
+	*	Runs \p count jobs on a work-stealing pool, and waits for their completion.
+	*	Each worker owns its ShaderAllocator, jobs get it through a fresh block.
+	*	Jobs are distributed round-robin, workers pop their own queue from its back,
+	*	and steal from the front of the other workers' queues.
+	*	If jobs throw, the exception of the lowest job index is rethrown, once every job is done.
+	*\param[in]	count
+	*	The jobs count.
+	*\param[in]	job
+	*	The job function.
+	*\param[in]	config
+	*	The pool configuration.
+	*/
+	SDAST_API void runBatch( size_t count
+		, BatchJob const & job
+		, BatchConfig const & config = {} );
+	/**
+	*	Groups items sharing the same key, preserving their input order.
+	*	Used to serialise compilations that share the same (non thread safe) ast::Shader.
+	*\param[in]	keys
+	*	The items keys.
+	*\return
+	*	The groups, ordered by first item index.
+	*/
+	SDAST_API std::vector< std::vector< size_t > > groupBatchItems( std::vector< void const * > const & keys );
+}
+
+#endif
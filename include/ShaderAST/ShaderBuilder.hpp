@@ -6,6 +6,7 @@ See LICENSE file in root folder
 #pragma once
 
 #include "Shader.hpp"
+#include "ShaderAST/Stmt/StmtIf.hpp"
 
 namespace ast
 {
@@ -20,6 +21,8 @@ namespace ast
 		SDAST_API void saveNextExpr();
 		SDAST_API expr::ExprPtr loadExpr( expr::ExprPtr expr );
 		SDAST_API void beginIf( expr::ExprPtr condition );
+		SDAST_API void beginIf( expr::ExprPtr condition
+			, stmt::SelectionHint hint );
 		SDAST_API void beginElseIf( expr::ExprPtr condition );
 		SDAST_API void beginElse();
 		SDAST_API void endIf();
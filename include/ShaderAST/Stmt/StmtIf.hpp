@@ -12,6 +12,17 @@ See LICENSE file in root folder
 
 namespace ast::stmt
 {
+	enum class SelectionHint
+		: uint8_t
+	{
+		// Lets the optimiser and the driver decide.
+		eNone,
+		// Asks for the branches to be replaced by a selection of their results.
+		eFlatten,
+		// Asks for the branches to be kept.
+		eDontFlatten,
+	};
+
 	class If
 		: public Compound
 	{
@@ -39,10 +50,21 @@ namespace ast::stmt
 			return m_elseIfs;
 		}
 
+		inline SelectionHint getHint()const
+		{
+			return m_hint;
+		}
+
+		inline void setHint( SelectionHint hint )
+		{
+			m_hint = hint;
+		}
+
 	private:
 		expr::ExprPtr m_ctrlExpr{};
 		ElsePtr m_else;
 		ElseIfList m_elseIfs;
+		SelectionHint m_hint{ SelectionHint::eNone };
 	};
 }
 
@@ -9,6 +9,17 @@ See LICENSE file in root folder
 
 namespace ast::stmt
 {
+	enum class LoopHint
+		: uint8_t
+	{
+		// Lets the optimiser and the driver decide.
+		eNone,
+		// Asks for the loop to be unrolled, whatever its size.
+		eUnroll,
+		// Asks for the loop to be kept.
+		eDontUnroll,
+	};
+
 	class Loop
 		: public Compound
 	{
@@ -16,6 +27,19 @@ namespace ast::stmt
 		SDAST_API explicit Loop( StmtCache & stmtCache
 			, size_t size
 			, Kind kind );
+
+		inline LoopHint getHint()const
+		{
+			return m_hint;
+		}
+
+		inline void setHint( LoopHint hint )
+		{
+			m_hint = hint;
+		}
+
+	private:
+		LoopHint m_hint{ LoopHint::eNone };
 	};
 }
 
@@ -29,6 +29,7 @@ See LICENSE file in root folder
 #include <array>
 #include <functional>
 #include <map>
+#include <mutex>
 
 namespace ast::type
 {
@@ -52,6 +53,7 @@ namespace ast::type
 		inline TypeTPtr getType( ParamsT && ... params )
 		{
 			auto key = m_hasher( params... );
+			std::lock_guard< std::mutex > lock{ m_mutex };
 			auto it = m_cache.find( key );
 
 			if ( it == m_cache.end() )
@@ -65,6 +67,7 @@ namespace ast::type
 	private:
 		CreatorT m_creator;
 		HasherT m_hasher;
+		std::mutex m_mutex;
 		std::map< size_t, TypeTPtr > m_cache;
 	};
 
@@ -182,8 +185,14 @@ namespace ast::type
 
 		SDAST_API TypePtr getPointerType( TypePtr pointerType, Storage storage );
 		SDAST_API TypePtr getForwardPointerType( TypePtr pointerType, Storage storage );
+		/**
+		*	Locks the cache, around code that retrieves a struct type and fills its members
+		*	while other threads may retrieve the same struct.
+		*/
+		SDAST_API std::unique_lock< std::recursive_mutex > lock();
 
 	private:
+		std::recursive_mutex m_mutex;
 		std::array< TypePtr, size_t( Kind::eMax ) > m_basicTypes;
 		AccelerationStructurePtr m_accelerationStructure;
 		RayDescPtr m_rayDesc;
@@ -50,6 +50,9 @@ namespace ast::var
 		ePerTaskNV = 1ULL << 36,
 		ePerTask = 1ULL << 37,
 		eShared = 1ULL << 38,
+		eRelaxedPrecision = 1ULL << 39,
+		eNonWritable = 1ULL << 40,
+		eNonReadable = 1ULL << 41,
 	};
 
 	inline bool hasFlag( uint64_t flags, Flag flag )
@@ -291,6 +294,21 @@ namespace ast::var
 			return hasFlag( Flag::eShared );
 		}
 
+		bool isRelaxedPrecision()const
+		{
+			return hasFlag( Flag::eRelaxedPrecision );
+		}
+
+		bool isNonWritable()const
+		{
+			return hasFlag( Flag::eNonWritable );
+		}
+
+		bool isNonReadable()const
+		{
+			return hasFlag( Flag::eNonReadable );
+		}
+
 	private:
 		uint64_t m_flags;
 	};
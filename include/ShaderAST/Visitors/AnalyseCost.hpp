@@ -0,0 +1,82 @@
+/*
+See LICENSE file in root folder
+*/
+#ifndef ___SDW_AnalyseCost_H___
+#define ___SDW_AnalyseCost_H___
+#pragma once
+
+#include "ShaderAST/ShaderStlTypes.hpp"
+
+#include <string>
+
+namespace ast
+{
+	/**
+	*	The operations counts, the ALU operations and the transcendental functions are counted per component.
+	*/
+	struct OperationCounts
+	{
+		// The ALU operations on floats.
+		uint64_t floatOps{};
+		// The ALU operations on half floats.
+		uint64_t halfOps{};
+		// The ALU operations on doubles.
+		uint64_t doubleOps{};
+		// The ALU operations on integers and booleans.
+		uint64_t intOps{};
+		// The trigonometric, exponential, logarithm and square root functions.
+		uint64_t transcendentals{};
+		// The texture sampling functions.
+		uint64_t samples{};
+		// The texture gather functions.
+		uint64_t gathers{};
+		// The texel fetches.
+		uint64_t fetches{};
+		uint64_t imageLoads{};
+		uint64_t imageStores{};
+		// The atomic operations, on buffers, shared variables and images.
+		uint64_t atomics{};
+		uint64_t barriers{};
+		// The if, else if and switch statements.
+		uint64_t branches{};
+	};
+
+	struct LoopCost
+	{
+		// The iterations count, 0 if it is unknown.
+		uint32_t tripCount{};
+		// The operations of one iteration, including the ones of the nested loops.
+		OperationCounts iteration;
+	};
+
+	struct FunctionCost
+	{
+		std::string name;
+		bool entryPoint{};
+		// The operations in the function body, each counted once.
+		OperationCounts operations;
+		// The operations in the function body, the ones in loops multiplied by the trip count, and the called functions included.
+		OperationCounts executed;
+		std::vector< LoopCost > loops;
+		// The maximum count of scalar components live at the same time, as computed by analyseRegisterPressure.
+		uint32_t peakLiveValues{};
+	};
+
+	struct ShaderCost
+	{
+		// The operations in all the functions, each counted once.
+		OperationCounts operations;
+		// The executed operations of the entry points.
+		OperationCounts executed;
+		std::vector< FunctionCost > functions;
+		// The maximum of the functions peak live values.
+		uint32_t peakLiveValues{};
+	};
+	/**
+	*	Estimates statically the cost of a shader, without running it.
+	*	The loops with an unknown trip count are considered executed once.
+	*/
+	SDAST_API ShaderCost analyseCost( stmt::Container const & container );
+}
+
+#endif
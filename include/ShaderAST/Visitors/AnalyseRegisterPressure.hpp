@@ -0,0 +1,40 @@
+/*
+See LICENSE file in root folder
+*/
+#ifndef ___SDW_AnalyseRegisterPressure_H___
+#define ___SDW_AnalyseRegisterPressure_H___
+#pragma once
+
+#include "ShaderAST/ShaderStlTypes.hpp"
+
+#include <string>
+
+namespace ast
+{
+	struct FunctionPressure
+	{
+		std::string name;
+		bool entryPoint{};
+		// The maximum count of scalar components live at the same time, including the ones of the called functions.
+		uint32_t maxLiveScalars{};
+		// The statements where the maximum is reached, in source order.
+		std::vector< stmt::Stmt const * > peakStatements;
+	};
+
+	struct RegisterPressure
+	{
+		// The functions, in declaration order.
+		std::vector< FunctionPressure > functions;
+		// The maximum of the entry points pressure.
+		uint32_t entryPointMaxLiveScalars{};
+	};
+	/**
+	*	Computes the live variables at each statement, with a backward data flow analysis of the structured control flow,
+	*	and reports the register pressure as the count of scalar components of the live local variables.
+	*	It is meant to run on the statements after SSA transformation, where each value has its own variable.
+	*	The values of a called function are added to the values live at the call.
+	*/
+	SDAST_API RegisterPressure analyseRegisterPressure( stmt::Container const & container );
+}
+
+#endif
@@ -0,0 +1,37 @@
+/*
+See LICENSE file in root folder
+*/
+#ifndef ___SDW_CoalesceComponents_H___
+#define ___SDW_CoalesceComponents_H___
+#pragma once
+
+#include "ShaderAST/ShaderStlTypes.hpp"
+
+namespace ast
+{
+	struct ComponentCoalescingStats
+	{
+		// The vector assignments created.
+		uint32_t assignments{};
+		// The component assignments they replace.
+		uint32_t components{};
+	};
+	/**
+	*	Replaces the consecutive assignments of single components of a vector, computed by the same operations
+	*	on the matching components of the same vectors, by one assignment of a vector operation:
+	*	r.x = a.x * b.x; r.y = a.y * b.y; becomes r.xy = a.xy * b.xy;
+	*	The operations can be additions, subtractions, multiplications, divisions and negations,
+	*	their scalar operands (variables and literals) are gathered in vectors, or kept for float multiplications by a same scalar.
+	*	The assigned values must not have side effects, nor read the assigned vector.
+	*	Expects statements that went through SSA transformation, simplification and constants resolution.
+	*\param[in,out]	stats
+	*	Receives the counts, added to the previous values.
+	*/
+	SDAST_API stmt::ContainerPtr coalesceComponents( stmt::StmtCache & stmtCache
+		, expr::ExprCache & exprCache
+		, type::TypesCache & typesCache
+		, stmt::Container const & container
+		, ComponentCoalescingStats & stats );
+}
+
+#endif
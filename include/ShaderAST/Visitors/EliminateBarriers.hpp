@@ -0,0 +1,50 @@
+/*
+See LICENSE file in root folder
+*/
+#ifndef ___SDW_EliminateBarriers_H___
+#define ___SDW_EliminateBarriers_H___
+#pragma once
+
+#include "ShaderAST/ShaderStlTypes.hpp"
+
+namespace ast
+{
+	enum class BarrierEliminationMode : uint8_t
+	{
+		// Only removes the barriers with no access to the memory they order on one of their sides.
+		eConservative,
+		// Also removes the control barriers separating accesses that don't conflict (no write to the same memory).
+		eConflicts,
+	};
+
+	struct BarrierEliminationStats
+	{
+		// The barriers removed because they ordered no conflicting accesses.
+		uint32_t removed{};
+		// The barriers merged into the previous adjacent barrier.
+		uint32_t merged{};
+	};
+	/**
+	*	Removes the redundant barriers from the compute, task and mesh entry points:
+	*	- The barriers of the same kind and execution scope, only separated by statements without memory access,
+	*	are merged into the first one, with the widest memory scope and the combined semantics.
+	*	- The barriers with no access to the memory they order between them and the previous or next barrier are removed.
+	*	- With BarrierEliminationMode::eConflicts, the control barriers are also removed when no shared variable,
+	*	storage buffer, image or output written on one side is accessed on the other side.
+	*	All the storage buffers are considered as one memory, since they can be bound to the same buffer,
+	*	the same goes for the storage images.
+	*	The accesses are searched up to the enclosing blocks, and through the called functions.
+	*	When the search reaches an unknown path (start of a non entry point function, switch case, or a jump statement),
+	*	all the accesses of the shader are taken.
+	*\param[in,out]	stats
+	*	Receives the counts, added to the previous values.
+	*/
+	SDAST_API stmt::ContainerPtr eliminateBarriers( stmt::StmtCache & stmtCache
+		, expr::ExprCache & exprCache
+		, type::TypesCache & typesCache
+		, stmt::Container const & container
+		, BarrierEliminationMode mode
+		, BarrierEliminationStats & stats );
+}
+
+#endif
@@ -0,0 +1,44 @@
+/*
+See LICENSE file in root folder
+*/
+#ifndef ___SDW_EliminateCommonSubexpressions_H___
+#define ___SDW_EliminateCommonSubexpressions_H___
+#pragma once
+
+#include "ShaderAST/Visitors/TransformSSA.hpp"
+
+namespace ast
+{
+	struct CommonSubexpressionStats
+	{
+		// The expressions replaced by a previously computed value.
+		uint32_t reused{};
+		// The temporaries created to hold an expression computed several times.
+		uint32_t temporaries{};
+	};
+	/**
+	*	Replaces the expressions already computed in a dominating statement by the variable holding their value.
+	*	When no variable holds the value yet, and the expression is computed again later, a temporary is created for it.
+	*	Only expressions without side effects are considered, that don't read memory other invocations can write,
+	*	and that don't depend on the other invocations (subgroup operations) ; non uniform expressions only match
+	*	non uniform expressions.
+	*	Expects statements that went through SSA transformation.
+	*\param[in,out]	ssaData
+	*	Used to create the temporaries.
+	*\param[in]	useAliases
+	*	\p true if the backend computes an alias once and reuses its result (SPIR-V),
+	*	\p false if it expands the aliased expression at each use (GLSL, HLSL).
+	*	Temporaries are aliases in the first case, and local variables in the second.
+	*\param[in,out]	stats
+	*	Receives the counts, added to the previous values.
+	*/
+	SDAST_API stmt::ContainerPtr eliminateCommonSubexpressions( stmt::StmtCache & stmtCache
+		, expr::ExprCache & exprCache
+		, type::TypesCache & typesCache
+		, stmt::Container const & container
+		, SSAData & ssaData
+		, bool useAliases
+		, CommonSubexpressionStats & stats );
+}
+
+#endif
@@ -0,0 +1,39 @@
+/*
+See LICENSE file in root folder
+*/
+#ifndef ___SDW_EliminateDeadCode_H___
+#define ___SDW_EliminateDeadCode_H___
+#pragma once
+
+#include "ShaderAST/Stmt/Stmt.hpp"
+
+namespace ast
+{
+	struct DeadCodeStats
+	{
+		// The removed function declarations.
+		uint32_t functions{};
+		// The removed variable declarations (locals, and globals like shared variables).
+		uint32_t variables{};
+		// The removed shader interface and resource declarations (inputs, buffers, images, samplers...).
+		uint32_t declarations{};
+		// The removed statements (unread stores, and statements following a jump).
+		uint32_t statements{};
+	};
+	/**
+	*	Removes the code that has no effect on the shader outputs:
+	*	functions that can't be reached from an entry point, unreferenced variables,
+	*	unreferenced shader inputs and resources, stores to locals that are never read,
+	*	and statements following a return, break, continue or invocation termination.
+	*	Statements following a demote are kept, since depending on the target, the invocation keeps executing.
+	*	Runs until nothing more can be removed.
+	*\param[in,out]	stats
+	*	Receives the removed nodes counts, added to the previous values.
+	*/
+	SDAST_API stmt::ContainerPtr eliminateDeadCode( stmt::StmtCache & stmtCache
+		, expr::ExprCache & exprCache
+		, stmt::Container const & container
+		, DeadCodeStats & stats );
+}
+
+#endif
@@ -0,0 +1,51 @@
+/*
+See LICENSE file in root folder
+*/
+#ifndef ___SDW_ExprSideEffects_H___
+#define ___SDW_ExprSideEffects_H___
+#pragma once
+
+#include "ShaderAST/Expr/ExprIntrinsicCall.hpp"
+#include "ShaderAST/Expr/ExprStorageImageAccessCall.hpp"
+
+namespace ast
+{
+	struct ExprEffects
+	{
+		// Writes variables or memory, synchronises, or calls a function.
+		bool sideEffects{};
+		// The result depends on the other invocations (subgroup operations), or on the helper state.
+		bool invocationDependent{};
+		// Reads memory that other invocations, or side effects, can modify (storage buffers and images, shared variables).
+		bool readsMemory{};
+	};
+	/**
+	*\return
+	*	\p true if the intrinsic writes memory, synchronises, emits primitives, or calls other shaders.
+	*/
+	SDAST_API bool hasSideEffects( expr::Intrinsic value );
+	/**
+	*\return
+	*	\p true if the storage image access writes the image (stores and atomics).
+	*/
+	SDAST_API bool hasSideEffects( expr::StorageImageAccess value );
+	/**
+	*\return
+	*	\p true if the intrinsic result depends on the other invocations, or on the helper invocation state.
+	*/
+	SDAST_API bool isInvocationDependent( expr::Intrinsic value );
+	/**
+	*	Tells if removing or moving the expression can change the shader behaviour.
+	*	Function calls are considered as having side effects, since they can write their out parameters or global variables.
+	*\return
+	*	\p true if the expression contains an assignment, an increment, a function call,
+	*	a stream append, or an intrinsic or image access with side effects.
+	*/
+	SDAST_API bool hasSideEffects( expr::Expr const & expr );
+	/**
+	*	Tells what prevents the expression from being removed, moved, or computed once for several uses.
+	*/
+	SDAST_API ExprEffects getExprEffects( expr::Expr const & expr );
+}
+
+#endif
@@ -0,0 +1,47 @@
+/*
+See LICENSE file in root folder
+*/
+#ifndef ___SDW_FlattenBranches_H___
+#define ___SDW_FlattenBranches_H___
+#pragma once
+
+#include "ShaderAST/Visitors/TransformSSA.hpp"
+
+namespace ast
+{
+	struct BranchFlatteningStats
+	{
+		// The if statements replaced by selections.
+		uint32_t branches{};
+		// The assignments of selections created for them.
+		uint32_t selections{};
+	};
+	/**
+	*	Replaces the if statements which only assign local variables, with values that can be computed
+	*	whatever the condition, by assignments of selections ( condition ? trueValue : falseValue ).
+	*	The branches can also declare variables, then declared before the selections.
+	*	The values must not have side effects, read memory, access images, index with non constant indices,
+	*	nor depend on the other invocations.
+	*	The if statements hinted stmt::SelectionHint::eDontFlatten are kept,
+	*	the ones hinted stmt::SelectionHint::eFlatten ignore the cost threshold.
+	*	Expects statements that went through SSA transformation and simplification.
+	*\param[in,out]	ssaData
+	*	Used to create the temporary holding the condition, when several variables are assigned.
+	*\param[in]	useAliases
+	*	\p true to hold the condition in an alias, \p false to hold it in a variable.
+	*\param[in]	costThreshold
+	*	The maximum statements count of a flattened if statement, both branches included.
+	*\param[in,out]	stats
+	*	Receives the counts, added to the previous values.
+	*/
+	SDAST_API stmt::ContainerPtr flattenBranches( stmt::StmtCache & stmtCache
+		, expr::ExprCache & exprCache
+		, type::TypesCache & typesCache
+		, stmt::Container const & container
+		, SSAData & ssaData
+		, bool useAliases
+		, uint32_t costThreshold
+		, BranchFlatteningStats & stats );
+}
+
+#endif
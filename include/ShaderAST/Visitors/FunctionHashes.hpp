@@ -0,0 +1,247 @@
+/*
+See LICENSE file in root folder
+*/
+#ifndef ___AST_FunctionHashes_H___
+#define ___AST_FunctionHashes_H___
+#pragma once
+
+#include "ShaderAST/Stmt/StmtContainer.hpp"
+
+#include <map>
+#include <optional>
+
+namespace ast
+{
+	struct FunctionHash
+	{
+		std::string name;
+		// The hash of the function's own declaration and statements.
+		size_t hash{};
+		// The hash combined with the global declarations hash and the callees full hashes.
+		size_t fullHash{};
+		// The names of the functions called from this one.
+		std::vector< std::string > callees;
+	};
+
+	struct ShaderHashes
+	{
+		// The hash of every statement that isn't a function declaration.
+		size_t globals{};
+		// The function hashes, in declaration order.
+		std::vector< FunctionHash > functions;
+	};
+	/**
+	*	Computes the structural hashes of a shader's statements, at function granularity.
+	*	Hashes are based on names and not on variable IDs, so that two builds of the same shader source give the same hashes.
+	*\param[in]	container
+	*	The shader statements (before any transformation pass).
+	*/
+	SDAST_API ShaderHashes computeShaderHashes( stmt::Container const & container );
+	/**
+	*	Lists the functions of \p current whose full hash is not the one they had in \p previous.
+	*	Since a full hash includes the callees ones, callers of a changed function are listed too.
+	*\param[in]	previous
+	*	The hashes from the previous compilation.
+	*\param[in]	current
+	*	The hashes from the current compilation.
+	*\return
+	*	The changed or added function names, in declaration order.
+	*/
+	SDAST_API std::vector< std::string > listChangedFunctions( ShaderHashes const & previous
+		, ShaderHashes const & current );
+	/**
+	*	Tells if two sets of shader hashes describe the same shader (same globals, same functions in the same order).
+	*/
+	SDAST_API bool isSameShader( ShaderHashes const & lhs
+		, ShaderHashes const & rhs );
+	/**
+	*	Hashes the specialisation constants values of \p specialisation.
+	*/
+	SDAST_API size_t hashSpecialisation( SpecialisationInfo const & specialisation );
+	/**
+	*	The outputs of a shader's functions, kept from a compilation to the next one, see ShaderMemoT.
+	*	A backend looks a function up before generating it, and stores the output of the ones it had to generate.
+	*	The functions are identified by their index, in declaration order, in the statements given to ShaderMemoT::compile.
+	*/
+	template< typename FunctionOutputT >
+	class FunctionOutputsT
+	{
+	public:
+		using Key = std::pair< std::string, size_t >;
+		using Map = std::map< Key, FunctionOutputT >;
+
+		FunctionOutputsT( ShaderHashes const & hashes
+			, Map & previous )
+			: m_hashes{ hashes }
+			, m_previous{ previous }
+		{
+		}
+		/**
+		*\return
+		*	The output of the function at \p index, if it was generated with the same full hash, nullptr if it wasn't.
+		*/
+		FunctionOutputT * find( size_t index )
+		{
+			if ( index >= m_hashes.functions.size() )
+			{
+				return nullptr;
+			}
+
+			auto key = makeKey( index );
+
+			if ( auto it = m_current.find( key );
+				it != m_current.end() )
+			{
+				return &it->second;
+			}
+
+			if ( auto node = m_previous.extract( key ) )
+			{
+				return &m_current.insert( std::move( node ) ).position->second;
+			}
+
+			return nullptr;
+		}
+		/**
+		*	Stores the output generated for the function at \p index.
+		*/
+		void store( size_t index
+			, FunctionOutputT output )
+		{
+			if ( index >= m_hashes.functions.size() )
+			{
+				return;
+			}
+
+			m_current.insert_or_assign( makeKey( index ), std::move( output ) );
+			m_generated.push_back( m_hashes.functions[index].name );
+		}
+
+		ShaderHashes const & getHashes()const noexcept
+		{
+			return m_hashes;
+		}
+
+		std::vector< std::string > const & getGenerated()const noexcept
+		{
+			return m_generated;
+		}
+		/**
+		*\return
+		*	The outputs of the current shader functions, the ones looked up and the stored ones.
+		*/
+		Map release()noexcept
+		{
+			return std::move( m_current );
+		}
+
+	private:
+		Key makeKey( size_t index )const
+		{
+			auto & function = m_hashes.functions[index];
+			return { function.name, function.fullHash };
+		}
+
+	private:
+		ShaderHashes const & m_hashes;
+		Map & m_previous;
+		Map m_current;
+		std::vector< std::string > m_generated;
+	};
+	/**
+	*	Memoizes the output of a shader compilation, at function granularity.
+	*	When the shader and the configuration didn't change, the previous output is returned as is.
+	*	Otherwise the compiler is called with the outputs of the functions whose full hash (see FunctionHash) didn't change,
+	*	so that it only generates the changed functions and their callers, and splices the other ones in.
+	*	The hashes are the ones of the statements given to compile: backends give their transformed statements,
+	*	since SSA transformation and adaptation depend on the whole shader.
+	*/
+	template< typename OutputT
+		, typename FunctionOutputT = OutputT >
+	class ShaderMemoT
+	{
+	public:
+		using FunctionOutputs = FunctionOutputsT< FunctionOutputT >;
+		/**
+		*\param[in]	container
+		*	The shader statements.
+		*\param[in]	configHash
+		*	The hash of everything else the output depends on (the backend configuration, see the compilers' hashConfig, the specialisation...).
+		*\param[in]	compile
+		*	The compilation function, called with a FunctionOutputs when the shader or the configuration changed.
+		*\return
+		*	The compilation output.
+		*/
+		template< typename CompileFuncT >
+		OutputT const & compile( stmt::Container const & container
+			, size_t configHash
+			, CompileFuncT && compile )
+		{
+			auto hashes = computeShaderHashes( container );
+			m_changedFunctions = listChangedFunctions( m_hashes, hashes );
+			m_generatedFunctions.clear();
+
+			if ( m_output
+				&& m_configHash == configHash
+				&& isSameShader( m_hashes, hashes ) )
+			{
+				m_reused = true;
+				return *m_output;
+			}
+
+			if ( m_configHash != configHash )
+			{
+				m_functions.clear();
+			}
+
+			FunctionOutputs functions{ hashes, m_functions };
+			m_output = compile( functions );
+			m_functions = functions.release();
+			m_generatedFunctions = functions.getGenerated();
+			m_hashes = std::move( hashes );
+			m_configHash = configHash;
+			m_reused = false;
+			return *m_output;
+		}
+
+		void clear()
+		{
+			m_hashes = {};
+			m_configHash = {};
+			m_output.reset();
+			m_functions.clear();
+			m_changedFunctions.clear();
+			m_generatedFunctions.clear();
+			m_reused = false;
+		}
+
+		std::vector< std::string > const & getChangedFunctions()const noexcept
+		{
+			return m_changedFunctions;
+		}
+		/**
+		*\return
+		*	The functions generated by the last compilation, the other ones were reused.
+		*/
+		std::vector< std::string > const & getGeneratedFunctions()const noexcept
+		{
+			return m_generatedFunctions;
+		}
+
+		bool isReused()const noexcept
+		{
+			return m_reused;
+		}
+
+	private:
+		ShaderHashes m_hashes;
+		size_t m_configHash{};
+		std::optional< OutputT > m_output;
+		typename FunctionOutputs::Map m_functions;
+		std::vector< std::string > m_changedFunctions;
+		std::vector< std::string > m_generatedFunctions;
+		bool m_reused{};
+	};
+}
+
+#endif
@@ -0,0 +1,44 @@
+/*
+See LICENSE file in root folder
+*/
+#ifndef ___SDW_HoistLoopInvariants_H___
+#define ___SDW_HoistLoopInvariants_H___
+#pragma once
+
+#include "ShaderAST/Visitors/TransformSSA.hpp"
+
+namespace ast
+{
+	struct LoopInvariantStats
+	{
+		// The loops from which expressions were moved.
+		uint32_t loops{};
+		// The moved expressions.
+		uint32_t expressions{};
+	};
+	/**
+	*	Moves the expressions of the loops bodies that compute the same value at each iteration
+	*	into temporaries, computed just before the loop.
+	*	Storage buffers, shared variables and storage images reads are moved only if nothing in the loop
+	*	writes memory, nor calls a function, and only from the statements run at each iteration.
+	*	Texture accesses are moved only from these statements too.
+	*	The handled loops are the do while loops, which SSA transformation creates from all the loops,
+	*	so that the body runs at least once.
+	*	Expects statements that went through SSA transformation and constants resolution.
+	*\param[in,out]	ssaData
+	*	Used to create the temporaries.
+	*\param[in]	useAliases
+	*	\p true to hold the values in aliases, \p false to hold them in variables.
+	*\param[in,out]	stats
+	*	Receives the counts, added to the previous values.
+	*/
+	SDAST_API stmt::ContainerPtr hoistLoopInvariants( stmt::StmtCache & stmtCache
+		, expr::ExprCache & exprCache
+		, type::TypesCache & typesCache
+		, stmt::Container const & container
+		, SSAData & ssaData
+		, bool useAliases
+		, LoopInvariantStats & stats );
+}
+
+#endif
@@ -0,0 +1,36 @@
+/*
+See LICENSE file in root folder
+*/
+#ifndef ___SDW_InferBufferAccess_H___
+#define ___SDW_InferBufferAccess_H___
+#pragma once
+
+#include "ShaderAST/ShaderStlTypes.hpp"
+
+namespace ast
+{
+	struct BufferAccessStats
+	{
+		// The storage buffer members and variables marked as never written.
+		uint32_t nonWritable{};
+		// The storage buffer members and variables marked as never read.
+		uint32_t nonReadable{};
+	};
+	/**
+	*	Looks at how the shader uses its storage buffers, and marks with NonWritable the members never written,
+	*	and with NonReadable the members written but never read, so that the backends can emit the matching qualifiers
+	*	(readonly and writeonly in GLSL, NonWritable and NonReadable decorations in SPIR-V, non RW buffers in HLSL).
+	*	A buffer variable gets the flag shared by all its members.
+	*	The assignments, the increments, the output arguments and the atomic operations write their operand,
+	*	the accesses through aliases are counted on the aliased buffer.
+	*\param[in,out]	stats
+	*	Receives the counts, added to the previous values.
+	*/
+	SDAST_API stmt::ContainerPtr inferBufferAccess( stmt::StmtCache & stmtCache
+		, expr::ExprCache & exprCache
+		, type::TypesCache & typesCache
+		, stmt::Container const & container
+		, BufferAccessStats & stats );
+}
+
+#endif
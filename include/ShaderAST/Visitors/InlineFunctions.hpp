@@ -0,0 +1,46 @@
+/*
+See LICENSE file in root folder
+*/
+#ifndef ___SDW_InlineFunctions_H___
+#define ___SDW_InlineFunctions_H___
+#pragma once
+
+#include "ShaderAST/Visitors/TransformSSA.hpp"
+
+namespace ast
+{
+	struct InlineStats
+	{
+		// The functions inlined at least once.
+		uint32_t functions{};
+		// The inlined call sites.
+		uint32_t calls{};
+	};
+	/**
+	*	Replaces the calls to small functions, or to functions called only once, by the function body.
+	*	The parameters are copied into local variables, except for unmodified input parameters receiving
+	*	a literal or a local variable, which are used directly ; output parameters are copied back after the body.
+	*	Entry points, and functions returning from anywhere else than their last statement, are never inlined.
+	*	The inlined functions are kept, eliminateDeadCode removes them when they are no longer called.
+	*	Expects statements that went through SSA transformation.
+	*\param[in,out]	ssaData
+	*	Used to create the local variables.
+	*\param[in]	useAliases
+	*	\p true if the backend computes an alias once and reuses its result (SPIR-V),
+	*	\p false if it expands the aliased expression at each use (GLSL, HLSL).
+	*\param[in]	costThreshold
+	*	The functions whose body counts at most this number of statements are inlined at each call site.
+	*\param[in,out]	stats
+	*	Receives the counts, added to the previous values.
+	*/
+	SDAST_API stmt::ContainerPtr inlineFunctions( stmt::StmtCache & stmtCache
+		, expr::ExprCache & exprCache
+		, type::TypesCache & typesCache
+		, stmt::Container const & container
+		, SSAData & ssaData
+		, bool useAliases
+		, uint32_t costThreshold
+		, InlineStats & stats );
+}
+
+#endif
@@ -0,0 +1,110 @@
+/*
+See LICENSE file in root folder
+*/
+#ifndef ___SDW_OptimiseStatements_H___
+#define ___SDW_OptimiseStatements_H___
+#pragma once
+
+#include "ShaderAST/Visitors/CoalesceComponents.hpp"
+#include "ShaderAST/Visitors/EliminateBarriers.hpp"
+#include "ShaderAST/Visitors/EliminateCommonSubexpressions.hpp"
+#include "ShaderAST/Visitors/EliminateDeadCode.hpp"
+#include "ShaderAST/Visitors/FlattenBranches.hpp"
+#include "ShaderAST/Visitors/HoistLoopInvariants.hpp"
+#include "ShaderAST/Visitors/InferBufferAccess.hpp"
+#include "ShaderAST/Visitors/InlineFunctions.hpp"
+#include "ShaderAST/Visitors/PlaceNonUniform.hpp"
+#include "ShaderAST/Visitors/PropagateConstants.hpp"
+#include "ShaderAST/Visitors/ReduceStrength.hpp"
+#include "ShaderAST/Visitors/RelaxPrecision.hpp"
+#include "ShaderAST/Visitors/UnrollLoops.hpp"
+
+namespace ast
+{
+	struct OptimisationStats
+	{
+		InlineStats inlining;
+		UnrollStats unrolling;
+		ConstantPropagationStats constants;
+		StrengthReductionStats strength;
+		ComponentCoalescingStats coalescing;
+		BranchFlatteningStats flattening;
+		LoopInvariantStats loopInvariants;
+		CommonSubexpressionStats commonSubexpressions;
+		DeadCodeStats deadCode;
+		BarrierEliminationStats barriers;
+		BufferAccessStats bufferAccess;
+		NonUniformStats nonUniform;
+		RelaxedPrecisionStats precision;
+	};
+
+	struct OptimisationConfig
+	{
+		// Replaces the calls to small functions, and to functions called once, by their body.
+		bool inlineFunctions{};
+		// The maximum statements count of a function inlined at each of its call sites.
+		uint32_t inlineCostThreshold{ 8u };
+		// Replaces the loops with a compile time iterations count by copies of their body.
+		bool unrollLoops{};
+		// The maximum statements count of an unrolled loop.
+		uint32_t unrollBudget{ 64u };
+		// Replaces the reads of local variables holding a known literal, and removes the branches that are never taken.
+		bool propagateConstants{};
+		// Rewrites the arithmetic expressions into cheaper equivalents.
+		bool reduceStrength{};
+		// Whether the strength reduction can change the floating point results.
+		StrengthReductionMode strengthReduction{ StrengthReductionMode::eExact };
+		// Replaces the assignments of single vector components, computed by the same operations, by one vector operation.
+		bool coalesceComponents{};
+		// Replaces the small if statements only assigning local variables by selections of the assigned values.
+		bool flattenBranches{};
+		// The maximum statements count of a flattened if statement.
+		uint32_t flattenCostThreshold{ 4u };
+		// Computes the expressions giving the same value at each iteration of a loop once, before the loop.
+		bool hoistLoopInvariants{};
+		// Reuses the values of the expressions already computed, instead of computing them again.
+		bool eliminateCommonSubexpressions{};
+		// Removes unreachable functions, unused variables and declarations, and unreachable statements.
+		bool eliminateDeadCode{};
+		// Removes the barriers of the compute, task and mesh shaders ordering no conflicting accesses, and merges the adjacent ones.
+		bool eliminateBarriers{};
+		// Whether the barriers separating accesses to different memories are removed, or only the ones with no access on one side.
+		BarrierEliminationMode barrierElimination{ BarrierEliminationMode::eConflicts };
+		// Marks the storage buffer members never written as readonly, and the ones never read as writeonly.
+		bool inferBufferAccess{};
+		// Flags with NonUniform the descriptor indices which are not dynamically uniform, and only them.
+		bool placeNonUniform{};
+		// Marks the local float variables holding small values (colours, normals...) with relaxed precision.
+		bool relaxPrecision{};
+		// The maximum absolute value of a variable marked with relaxed precision.
+		float relaxedPrecisionBound{ 2.0f };
+		// Optional, receives the counts of what the optimisations did.
+		OptimisationStats * stats{};
+	};
+	/**
+	*	Hashes the options of \p config, the stats output excepted.
+	*/
+	SDAST_API size_t hashConfig( OptimisationConfig const & config );
+	/**
+	*	Runs the optimisation passes enabled in \p config.
+	*	Expects statements that went through SSA transformation and constants resolution.
+	*\param[in]	container
+	*	The statements, returned as is if no optimisation is enabled.
+	*\param[in,out]	ssaData
+	*	The data from the SSA transformation, used to create temporaries.
+	*\param[in]	useAliases
+	*	\p true if the backend computes an alias once and reuses its result (SPIR-V),
+	*	\p false if it expands the aliased expression at each use (GLSL, HLSL).
+	*\return
+	*	The optimised statements.
+	*/
+	SDAST_API stmt::ContainerPtr optimiseStatements( stmt::StmtCache & stmtCache
+		, expr::ExprCache & exprCache
+		, type::TypesCache & typesCache
+		, stmt::ContainerPtr container
+		, SSAData & ssaData
+		, bool useAliases
+		, OptimisationConfig const & config );
+}
+
+#endif
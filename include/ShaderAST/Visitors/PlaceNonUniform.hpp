@@ -0,0 +1,35 @@
+/*
+See LICENSE file in root folder
+*/
+#ifndef ___SDW_PlaceNonUniform_H___
+#define ___SDW_PlaceNonUniform_H___
+#pragma once
+
+#include "ShaderAST/ShaderStlTypes.hpp"
+
+namespace ast
+{
+	struct NonUniformStats
+	{
+		// The descriptor indices flagged by the analysis.
+		uint32_t added{};
+		// The flags removed, because the flagged value is dynamically uniform, or is not a descriptor index.
+		uint32_t unnecessary{};
+	};
+	/**
+	*	Classifies the values of the shader as uniform (the same for all the invocations of the draw call, or of the workgroup),
+	*	uniform per subgroup, or non uniform, and flags with NonUniform the indices into arrays of descriptors (images, samplers...)
+	*	which are not dynamically uniform.
+	*	The non uniform values come from the shader inputs, most builtins, the storage buffers written by the shader,
+	*	the storage images, the subgroup operations, and from the branches and loops taken depending on non uniform values.
+	*	The flags the user placed on the uniform indices, or on other expressions, are removed.
+	*\param[in,out]	stats
+	*	Receives the counts, added to the previous values.
+	*/
+	SDAST_API stmt::ContainerPtr placeNonUniform( stmt::StmtCache & stmtCache
+		, expr::ExprCache & exprCache
+		, stmt::Container const & container
+		, NonUniformStats & stats );
+}
+
+#endif
@@ -0,0 +1,37 @@
+/*
+See LICENSE file in root folder
+*/
+#ifndef ___SDW_PropagateConstants_H___
+#define ___SDW_PropagateConstants_H___
+#pragma once
+
+#include "ShaderAST/ShaderStlTypes.hpp"
+
+namespace ast
+{
+	struct ConstantPropagationStats
+	{
+		// The reads of a local variable replaced by its literal value.
+		uint32_t values{};
+		// The if statements removed, and the switch statements whose tested value became a literal.
+		uint32_t branches{};
+	};
+	/**
+	*	Follows the literal values assigned to the scalar local variables, through the control flow,
+	*	and replaces the reads of these variables by the values.
+	*	The if statements whose condition becomes a literal are replaced by the taken branch,
+	*	and the branch that is not taken doesn't alter the known values.
+	*	The variables written in a loop are unknown within and after the loop.
+	*	The assignments are kept, resolveConstants and simplify are meant to be run afterwards,
+	*	to fold the resulting expressions and prune the switch statements.
+	*	Expects statements that went through SSA transformation, simplification and constants resolution.
+	*\param[in,out]	stats
+	*	Receives the counts, added to the previous values.
+	*/
+	SDAST_API stmt::ContainerPtr propagateConstants( stmt::StmtCache & stmtCache
+		, expr::ExprCache & exprCache
+		, stmt::Container const & container
+		, ConstantPropagationStats & stats );
+}
+
+#endif
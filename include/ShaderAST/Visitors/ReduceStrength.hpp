@@ -0,0 +1,53 @@
+/*
+See LICENSE file in root folder
+*/
+#ifndef ___SDW_ReduceStrength_H___
+#define ___SDW_ReduceStrength_H___
+#pragma once
+
+#include "ShaderAST/ShaderStlTypes.hpp"
+
+namespace ast
+{
+	enum class StrengthReductionMode : uint8_t
+	{
+		// Only the rewrites giving the same results, as defined by IEEE 754.
+		eExact,
+		// Also the rewrites that can change the rounding, or the sign of a zero result.
+		eFastMath,
+	};
+
+	struct StrengthReductionStats
+	{
+		// The rewritten expressions.
+		uint32_t rewrites{};
+	};
+	/**
+	*	Rewrites the arithmetic expressions into cheaper equivalents:
+	*	- pow( x, 2.0 ) into x * x, when x is a variable access.
+	*	- x * 1, x / 1, x - 0, and x + 0 for integers, into x.
+	*	- Integer multiplications and unsigned integer divisions by a power of two, into shifts.
+	*	- Divisions by a float power of two, into multiplications by its reciprocal.
+	*	- transpose( transpose( m ) ) into m.
+	*	With StrengthReductionMode::eFastMath, also:
+	*	- Divisions by any float constant, into multiplications by its reciprocal.
+	*	- Floating point x + 0 into x.
+	*	- normalize( normalize( v ) ) into normalize( v ).
+	*	Expects statements that went through SSA transformation, simplification and constants resolution.
+	*\param[in,out]	stats
+	*	Receives the counts, added to the previous values.
+	*/
+	SDAST_API stmt::ContainerPtr reduceStrength( stmt::StmtCache & stmtCache
+		, expr::ExprCache & exprCache
+		, type::TypesCache & typesCache
+		, stmt::Container const & container
+		, StrengthReductionMode mode
+		, StrengthReductionStats & stats );
+	SDAST_API expr::ExprPtr reduceStrength( expr::ExprCache & exprCache
+		, type::TypesCache & typesCache
+		, expr::Expr const & expr
+		, StrengthReductionMode mode
+		, StrengthReductionStats & stats );
+}
+
+#endif
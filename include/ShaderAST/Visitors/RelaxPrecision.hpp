@@ -0,0 +1,38 @@
+/*
+See LICENSE file in root folder
+*/
+#ifndef ___SDW_RelaxPrecision_H___
+#define ___SDW_RelaxPrecision_H___
+#pragma once
+
+#include "ShaderAST/ShaderStlTypes.hpp"
+
+namespace ast
+{
+	struct RelaxedPrecisionStats
+	{
+		// The local variables marked with relaxed precision.
+		uint32_t variables{};
+	};
+	/**
+	*	Marks with relaxed precision the local float variables (scalars and vectors) which values stay in a small range,
+	*	so that the backends can compute them in half precision (RelaxedPrecision decoration in SPIR-V, mediump qualifier in GLSL).
+	*	The ranges come from the literals and from the intrinsics with a bounded result (normalize, clamp, fract, sin, ...),
+	*	and are propagated through the arithmetic operations, which is enough to catch colour and normal maths.
+	*	The variables the user marked with relaxed precision are trusted, and are considered within [-maxMagnitude, maxMagnitude].
+	*	The variables used, directly or not, as texture coordinates, function arguments, conversion operands,
+	*	or builtin outputs values keep their precision.
+	*\param[in]	maxMagnitude
+	*	The maximum absolute value of a relaxed variable.
+	*\param[in,out]	stats
+	*	Receives the counts, added to the previous values.
+	*/
+	SDAST_API stmt::ContainerPtr relaxPrecision( stmt::StmtCache & stmtCache
+		, expr::ExprCache & exprCache
+		, type::TypesCache & typesCache
+		, stmt::Container const & container
+		, float maxMagnitude
+		, RelaxedPrecisionStats & stats );
+}
+
+#endif
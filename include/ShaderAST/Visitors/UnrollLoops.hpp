@@ -0,0 +1,45 @@
+/*
+See LICENSE file in root folder
+*/
+#ifndef ___SDW_UnrollLoops_H___
+#define ___SDW_UnrollLoops_H___
+#pragma once
+
+#include "ShaderAST/Visitors/TransformSSA.hpp"
+
+namespace ast
+{
+	struct UnrollStats
+	{
+		// The unrolled loops.
+		uint32_t loops{};
+		// The copies of the loops bodies.
+		uint32_t iterations{};
+	};
+	/**
+	*	Replaces the loops with a compile time iterations count by copies of their body,
+	*	where the loop variable is replaced by its value for the iteration.
+	*	The handled loops are the ones SSA transformation creates from for and while loops :
+	*	an integer variable initialised with a literal, compared to a literal, and incremented or decremented
+	*	by a literal at the end of the body, which doesn't otherwise write the variable, nor break or continue the loop.
+	*	The do while loops with the same shape are also handled, when their first iteration passes the condition.
+	*	Loops with the ast::stmt::LoopHint::eDontUnroll hint are kept.
+	*	Expects statements that went through SSA transformation and constants resolution.
+	*\param[in,out]	ssaData
+	*	Used to create the copies of the variables declared in the loops bodies.
+	*\param[in]	budget
+	*	The maximum statements count of an unrolled loop (iterations count times body statements count).
+	*	Loops with the ast::stmt::LoopHint::eUnroll hint ignore it, up to a fixed limit.
+	*\param[in,out]	stats
+	*	Receives the counts, added to the previous values.
+	*/
+	SDAST_API stmt::ContainerPtr unrollLoops( stmt::StmtCache & stmtCache
+		, expr::ExprCache & exprCache
+		, type::TypesCache & typesCache
+		, stmt::Container const & container
+		, SSAData & ssaData
+		, uint32_t budget
+		, UnrollStats & stats );
+}
+
+#endif
@@ -20,6 +20,7 @@ See LICENSE file in root folder
 #include <ShaderAST/Shader.hpp>
 #include <ShaderAST/ShaderBuilder.hpp>
 #include <ShaderAST/Stmt/StmtIf.hpp>
+#include <ShaderAST/Stmt/StmtLoop.hpp>
 #include <ShaderAST/Stmt/StmtSwitch.hpp>
 
 #include <functional>
@@ -205,17 +206,40 @@ namespace sdw
 			, expr::ExprPtr condition
 			, expr::ExprPtr increment
 			, std::function< void() > const & function );
+		SDW_API void forStmt( expr::ExprPtr init
+			, expr::ExprPtr condition
+			, expr::ExprPtr increment
+			, ast::stmt::LoopHint hint
+			, std::function< void() > const & function );
 		SDW_API void doWhileStmt( expr::ExprPtr condition
 			, std::function< void() > const & function );
+		SDW_API void doWhileStmt( expr::ExprPtr condition
+			, ast::stmt::LoopHint hint
+			, std::function< void() > const & function );
+		SDW_API void doWhileStmt( sdw::Boolean const condition
+			, std::function< void() > const & function );
 		SDW_API void doWhileStmt( sdw::Boolean const condition
+			, ast::stmt::LoopHint hint
 			, std::function< void() > const & function );
 		SDW_API void whileStmt( expr::ExprPtr condition
 			, std::function< void() > const & function );
+		SDW_API void whileStmt( expr::ExprPtr condition
+			, ast::stmt::LoopHint hint
+			, std::function< void() > const & function );
+		SDW_API void whileStmt( sdw::Boolean const condition
+			, std::function< void() > const & function );
 		SDW_API void whileStmt( sdw::Boolean const condition
+			, ast::stmt::LoopHint hint
 			, std::function< void() > const & function );
 		SDW_API ShaderWriter & ifStmt( sdw::Boolean const condition
 			, std::function< void() > const & function );
+		SDW_API ShaderWriter & ifStmt( sdw::Boolean const condition
+			, ast::stmt::SelectionHint hint
+			, std::function< void() > const & function );
+		SDW_API ShaderWriter & ifStmt( expr::ExprPtr condition
+			, std::function< void() > const & function );
 		SDW_API ShaderWriter & ifStmt( expr::ExprPtr condition
+			, ast::stmt::SelectionHint hint
 			, std::function< void() > const & function );
 		SDW_API ShaderWriter & elseIfStmt( sdw::Boolean const condition
 			, std::function< void() > const & function );
@@ -866,6 +890,11 @@ namespace sdw
 		template< typename BaseT, typename DerivedT >
 		std::unique_ptr< BaseT > declDerivedLocale( std::string name
 			, bool enabled = true );
+		/**
+		*	Tells that the given variable can be computed with relaxed precision (mediump/fp16).
+		*	It is decorated as such, and trusted by the relaxed precision pass.
+		*/
+		SDW_API void relaxPrecision( Value const & value );
 		/**@}*/
 #pragma endregion
 #pragma region Global variables declaration
@@ -1089,7 +1118,7 @@ namespace sdw
 	}
 }
 
-#define FOR( Writer, Type, Name, Init, Cond, Incr )\
+#define FOR_HINT( Writer, Hint, Type, Name, Init, Cond, Incr )\
 	if ( auto writerScope = makeScope( Writer ) )\
 	{\
 		auto ctrlVar##Name = ( Writer ).registerLoopVar( #Name, Type::makeType( ( Writer ).getTypesCache() ) );\
@@ -1102,30 +1131,46 @@ namespace sdw
 			, sdw::makeExpr( Writer, Init ) )\
 			, sdw::makeExpr( Writer, cond##Name )\
 			, sdw::makeExpr( Writer, incr##Name )\
+			, Hint\
 			, [&]()noexcept
 
+#define FOR( Writer, Type, Name, Init, Cond, Incr )\
+	FOR_HINT( Writer, ast::stmt::LoopHint::eNone, Type, Name, Init, Cond, Incr )
+
 #define ROF\
  );\
 	}
 
-#define WHILE( Writer, Condition )\
+#define WHILE_HINT( Writer, Hint, Condition )\
 	( Writer ).whileStmt( sdw::makeCondition( Condition )\
+		, Hint\
 		, [&]()noexcept
 
+#define WHILE( Writer, Condition )\
+	WHILE_HINT( Writer, ast::stmt::LoopHint::eNone, Condition )
+
 #define ELIHW\
  );
 
-#define DOWHILE( Writer, Condition )\
+#define DOWHILE_HINT( Writer, Hint, Condition )\
 	( Writer ).doWhileStmt( sdw::makeCondition( Condition )\
+		, Hint\
 		, [&]()noexcept
 
+#define DOWHILE( Writer, Condition )\
+	DOWHILE_HINT( Writer, ast::stmt::LoopHint::eNone, Condition )
+
 #define ELIHWOD\
  );
 
-#define IF( Writer, Condition )\
+#define IF_HINT( Writer, Hint, Condition )\
 	( Writer ).ifStmt( sdw::makeCondition( Condition )\
+		, Hint\
 		, [&]()noexcept
 
+#define IF( Writer, Condition )\
+	IF_HINT( Writer, ast::stmt::SelectionHint::eNone, Condition )
+
 #define ELSE\
  ).elseStmt( [&]()noexcept
 
@@ -16,59 +16,195 @@ See LICENSE file in root folder
 
 namespace glsl
 {
+	namespace
+	{
+		ast::stmt::ContainerPtr adaptShader( ast::Shader const & shader
+			, ast::stmt::Container const * stmt
+			, ast::ShaderStage stage
+			, ast::stmt::StmtCache & compileStmtCache
+			, ast::expr::ExprCache & compileExprCache
+			, GlslConfig & config
+			, IntrinsicsConfig & intrinsics )
+		{
+			ast::SSAData ssaData;
+			ssaData.nextVarId = shader.getData().nextVarId;
+			auto & typesCache = shader.getTypesCache();
+			config.shaderStage = stage;
+			intrinsics = glsl::fillConfig( stage
+				, *stmt );
+			glsl::checkConfig( config, intrinsics );
+
+			auto statements = ast::transformSSA( compileStmtCache
+				, compileExprCache
+				, typesCache
+				, *stmt
+				, ssaData
+				, true );
+			statements = ast::simplify( compileStmtCache
+				, compileExprCache
+				, typesCache
+				, *statements );
+			statements = ast::resolveConstants( compileStmtCache
+				, compileExprCache
+				, typesCache
+				, *statements );
+			statements = ast::optimiseStatements( compileStmtCache
+				, compileExprCache
+				, typesCache
+				, std::move( statements )
+				, ssaData
+				, false
+				, config.optimisations );
+
+			// The requirements were gathered before the optimisations, and the non uniform placement can flag new indices.
+			if ( config.optimisations.placeNonUniform
+				&& glsl::fillConfig( stage, *statements ).requiredExtensions.contains( EXT_nonuniform_qualifier ) )
+			{
+				intrinsics.requiredExtensions.insert( EXT_nonuniform_qualifier );
+			}
+
+			glsl::AdaptationData adaptationData{ stage
+				, config
+				, intrinsics
+				, ssaData.nextVarId };
+			statements = adaptStatements( compileStmtCache
+				, compileExprCache
+				, typesCache
+				, *statements
+				, adaptationData );
+			// Simplify again, since adaptation can introduce complexity
+			return ast::simplify( compileStmtCache
+				, compileExprCache
+				, typesCache
+				, *statements );
+		}
+
+		ast::stmt::ContainerPtr transformShader( ast::Shader const & shader
+			, ast::stmt::Container const * stmt
+			, ast::ShaderStage stage
+			, ast::SpecialisationInfo const & specialisation
+			, ast::stmt::StmtCache & compileStmtCache
+			, ast::expr::ExprCache & compileExprCache
+			, GlslConfig & config
+			, IntrinsicsConfig & intrinsics )
+		{
+			auto statements = adaptShader( shader
+				, stmt
+				, stage
+				, compileStmtCache
+				, compileExprCache
+				, config
+				, intrinsics );
+			statements = ast::specialiseStatements( compileStmtCache
+				, compileExprCache
+				, shader.getTypesCache()
+				, *statements
+				, specialisation );
+
+			if ( !specialisation.data.empty() )
+			{
+				// Fold the specialised constants, and prune the branches they made dead.
+				statements = ast::resolveConstants( compileStmtCache
+					, compileExprCache
+					, shader.getTypesCache()
+					, *statements );
+			}
+
+			return statements;
+		}
+	}
+
+	size_t hashConfig( GlslConfig const & config )
+	{
+		size_t result{};
+		ast::type::hashCombine( result, config.shaderStage );
+		ast::type::hashCombine( result, config.wantedVersion );
+
+		for ( auto & extension : config.availableExtensions )
+		{
+			ast::type::hashCombine( result, extension.name );
+		}
+
+		ast::type::hashCombine( result, config.vulkanGlsl );
+		ast::type::hashCombine( result, config.flipVertY );
+		ast::type::hashCombine( result, config.fixupClipDepth );
+		ast::type::hashCombine( result, config.hasStd430Layout );
+		ast::type::hashCombine( result, config.hasShaderStorageBuffers );
+		ast::type::hashCombine( result, config.hasDescriptorSets );
+		ast::type::hashCombine( result, config.hasBaseInstance );
+		ast::type::hashCombine( result, ast::hashConfig( config.optimisations ) );
+		return result;
+	}
+
 	std::string compileGlsl( ast::Shader const & shader
 		, ast::stmt::Container const * stmt
 		, ast::ShaderStage stage
 		, ast::SpecialisationInfo const & specialisation
 		, GlslConfig & config )
 	{
-		ast::SSAData ssaData;
-		ssaData.nextVarId = shader.getData().nextVarId;
-		auto & typesCache = shader.getTypesCache();
-		config.shaderStage = stage;
-		auto intrinsics = glsl::fillConfig( stage
-			, *stmt );
-		glsl::checkConfig( config, intrinsics );
-
 		auto ownAllocator = config.allocator ? nullptr : std::make_unique< ast::ShaderAllocator >();
 		auto allocator = config.allocator ? config.allocator->getBlock() : ownAllocator->getBlock();
 		ast::stmt::StmtCache compileStmtCache{ *allocator };
 		ast::expr::ExprCache compileExprCache{ *allocator };
-		auto statements = ast::transformSSA( compileStmtCache
-			, compileExprCache
-			, typesCache
-			, *stmt
-			, ssaData
-			, true );
-		statements = ast::simplify( compileStmtCache
-			, compileExprCache
-			, typesCache
-			, *statements );
-		statements = ast::resolveConstants( compileStmtCache
+		IntrinsicsConfig intrinsics;
+		auto statements = transformShader( shader
+			, stmt
+			, stage
+			, specialisation
+			, compileStmtCache
 			, compileExprCache
-			, typesCache
-			, *statements );
-		glsl::AdaptationData adaptationData{ stage
 			, config
-			, intrinsics
-			, ssaData.nextVarId };
-		statements = adaptStatements( compileStmtCache
-			, compileExprCache
-			, typesCache
-			, *statements
-			, adaptationData );
-		// Simplify again, since adaptation can introduce complexity
-		statements = ast::simplify( compileStmtCache
-			, compileExprCache
-			, typesCache
-			, *statements );
-		statements = ast::specialiseStatements( compileStmtCache
-			, compileExprCache
-			, typesCache
-			, *statements
-			, specialisation );
+			, intrinsics );
 		return glsl::generateGlslStatements( config, intrinsics, *statements ).source;
 	}
+
+	std::vector< std::string > compileGlslVariants( ast::Shader const & shader
+		, std::span< ast::SpecialisationInfo const > specialisations
+		, GlslConfig & config )
+	{
+		auto ownAllocator = config.allocator ? nullptr : std::make_unique< ast::ShaderAllocator >();
+		auto & shaderAllocator = config.allocator ? *config.allocator : *ownAllocator;
+		auto allocator = shaderAllocator.getBlock();
+		ast::stmt::StmtCache compileStmtCache{ *allocator };
+		ast::expr::ExprCache compileExprCache{ *allocator };
+		auto & typesCache = shader.getTypesCache();
+		IntrinsicsConfig intrinsics;
+		auto statements = adaptShader( shader
+			, shader.getStatements()
+			, shader.getType()
+			, compileStmtCache
+			, compileExprCache
+			, config
+			, intrinsics );
+		std::vector< std::string > result;
+		result.reserve( specialisations.size() );
+
+		for ( auto & specialisation : specialisations )
+		{
+			// Each variant lives in its own block, released before the next one.
+			auto variantAllocator = shaderAllocator.getBlock();
+			ast::stmt::StmtCache variantStmtCache{ *variantAllocator };
+			ast::expr::ExprCache variantExprCache{ *variantAllocator };
+			auto variant = ast::specialiseStatements( variantStmtCache
+				, variantExprCache
+				, typesCache
+				, *statements
+				, specialisation );
+
+			if ( !specialisation.data.empty() )
+			{
+				// Fold the specialised constants, and prune the branches they made dead.
+				variant = ast::resolveConstants( variantStmtCache
+					, variantExprCache
+					, typesCache
+					, *variant );
+			}
+
+			result.push_back( glsl::generateGlslStatements( config, intrinsics, *variant ).source );
+		}
+
+		return result;
+	}
 	
 	std::string compileGlsl( ast::Shader const & shader
 		, ast::SpecialisationInfo const & specialisation
@@ -80,4 +216,77 @@ namespace glsl
 			, specialisation
 			, config );
 	}
+
+	std::string compileGlsl( ast::Shader const & shader
+		, ast::SpecialisationInfo const & specialisation
+		, GlslConfig & config
+		, GlslMemo & memo )
+	{
+		auto ownAllocator = config.allocator ? nullptr : std::make_unique< ast::ShaderAllocator >();
+		auto allocator = config.allocator ? config.allocator->getBlock() : ownAllocator->getBlock();
+		ast::stmt::StmtCache compileStmtCache{ *allocator };
+		ast::expr::ExprCache compileExprCache{ *allocator };
+		IntrinsicsConfig intrinsics;
+		auto statements = transformShader( shader
+			, shader.getStatements()
+			, shader.getType()
+			, specialisation
+			, compileStmtCache
+			, compileExprCache
+			, config
+			, intrinsics );
+		// The required extensions are written in the header, before the functions.
+		auto configHash = hashConfig( config );
+
+		for ( auto & extension : intrinsics.requiredExtensions )
+		{
+			ast::type::hashCombine( configHash, extension.name );
+		}
+
+		return memo.compile( *statements
+			, configHash
+			, [&]( GlslMemo::FunctionOutputs & functions )
+			{
+				return glsl::generateGlslStatements( config, intrinsics, *statements, functions ).source;
+			} );
+	}
+
+	std::vector< std::string > compileBatch( std::span< ast::Shader const * const > shaders
+		, std::span< ast::SpecialisationInfo const > specialisations
+		, std::span< GlslConfig > configs
+		, ast::BatchConfig const & batchConfig
+		, GlslBatchCallback const & onCompiled )
+	{
+		if ( shaders.size() != configs.size()
+			|| ( !specialisations.empty() && shaders.size() != specialisations.size() ) )
+		{
+			throw ast::Exception{ "Batch shaders, specialisations and configs counts mismatch" };
+		}
+
+		ast::SpecialisationInfo const noSpecialisation{};
+		std::vector< std::string > result( shaders.size() );
+		auto groups = ast::groupBatchItems( { shaders.begin(), shaders.end() } );
+		ast::runBatch( groups.size()
+			, [&]( ast::ShaderAllocator & allocator
+				, size_t groupIndex )
+			{
+				for ( auto index : groups[groupIndex] )
+				{
+					auto config = configs[index];
+					config.allocator = &allocator;
+					result[index] = compileGlsl( *shaders[index]
+						, specialisations.empty() ? noSpecialisation : specialisations[index]
+						, config );
+					config.allocator = configs[index].allocator;
+					configs[index] = std::move( config );
+
+					if ( onCompiled )
+					{
+						onCompiled( index, result[index] );
+					}
+				}
+			}
+			, batchConfig );
+		return result;
+	}
 }
@@ -1132,11 +1132,12 @@ namespace hlsl
 				, RoutineMap const & routines
 				, std::map< ast::var::VariablePtr, ast::expr::Expr const * > & aliases
 				, ast::stmt::Stmt const & stmt
-				, std::string indent = std::string{} )
+				, std::string indent = std::string{}
+				, ast::FunctionOutputsT< std::string > * functions = nullptr )
 			{
 				std::string result;
 				result += "// This shader was generated using ShaderWriter version " + helpers::printVersion() + "\n";
-				StmtVisitor vis{ writerConfig, routines, aliases, std::move( indent ), result };
+				StmtVisitor vis{ writerConfig, routines, aliases, std::move( indent ), result, functions };
 				stmt.accept( &vis );
 				return result;
 			}
@@ -1146,12 +1147,14 @@ namespace hlsl
 				, RoutineMap const & routines
 				, std::map< ast::var::VariablePtr, ast::expr::Expr const * > & aliases
 				, std::string indent
-				, std::string & result )
+				, std::string & result
+				, ast::FunctionOutputsT< std::string > * functions )
 				: m_writerConfig{ writerConfig }
 				, m_routines{ routines }
 				, m_aliases{ aliases }
 				, m_indent{ std::move( indent ) }
 				, m_result{ result }
+				, m_functions{ functions }
 			{
 			}
 
@@ -1170,6 +1173,30 @@ namespace hlsl
 				m_appendLineEnd = false;
 			}
 
+			void doAppendLoopHint( ast::stmt::Loop const & stmt )
+			{
+				if ( stmt.getHint() == ast::stmt::LoopHint::eUnroll )
+				{
+					m_result += m_indent + "[unroll]\n";
+				}
+				else if ( stmt.getHint() == ast::stmt::LoopHint::eDontUnroll )
+				{
+					m_result += m_indent + "[loop]\n";
+				}
+			}
+
+			void doAppendSelectionHint( ast::stmt::If const & stmt )
+			{
+				if ( stmt.getHint() == ast::stmt::SelectionHint::eFlatten )
+				{
+					m_result += m_indent + "[flatten]\n";
+				}
+				else if ( stmt.getHint() == ast::stmt::SelectionHint::eDontFlatten )
+				{
+					m_result += m_indent + "[branch]\n";
+				}
+			}
+
 			void visitContainerStmt( ast::stmt::Container const * stmt )override
 			{
 				for ( auto & curStmt : *stmt )
@@ -1273,6 +1300,7 @@ namespace hlsl
 			{
 				m_appendLineEnd = true;
 				doAppendLineEnd();
+				doAppendLoopHint( *stmt );
 				m_result += m_indent + "do";
 				m_appendSemiColon = false;
 				visitCompoundStmt( stmt );
@@ -1302,6 +1330,7 @@ namespace hlsl
 			{
 				m_appendLineEnd = true;
 				doAppendLineEnd();
+				doAppendLoopHint( *stmt );
 				m_result += m_indent + "for (" + doSubmit( *stmt->getInitExpr() ) + "; ";
 				m_result += doSubmit( *stmt->getCtrlExpr() ) + "; ";
 				m_result += doSubmit( *stmt->getIncrExpr() ) + ")";
@@ -1319,6 +1348,21 @@ namespace hlsl
 			{
 				m_appendLineEnd = true;
 				doAppendLineEnd();
+				auto index = m_functionIndex++;
+				auto begin = m_result.size();
+
+				if ( m_functions )
+				{
+					if ( auto source = m_functions->find( index ) )
+					{
+						// The function didn't change, its source is reused.
+						m_result += *source;
+						m_appendSemiColon = false;
+						m_appendLineEnd = true;
+						return;
+					}
+				}
+
 				auto type = stmt->getType();
 				ast::var::VariableList params;
 
@@ -1554,6 +1598,11 @@ namespace hlsl
 				m_indent = save;
 				m_result += m_indent + "}\n";
 				m_appendLineEnd = true;
+
+				if ( m_functions )
+				{
+					m_functions->store( index, m_result.substr( begin ) );
+				}
 			}
 
 			void visitAccelerationStructureDeclStmt( ast::stmt::AccelerationStructureDecl const * stmt )override
@@ -1590,6 +1639,7 @@ namespace hlsl
 			{
 				m_appendLineEnd = true;
 				doAppendLineEnd();
+				doAppendSelectionHint( *stmt );
 				m_result += m_indent + "if (" + doSubmit( *stmt->getCtrlExpr() ) + ")";
 				m_appendSemiColon = false;
 				visitCompoundStmt( stmt );
@@ -1741,18 +1791,38 @@ namespace hlsl
 			{
 				m_appendLineEnd = true;
 				doAppendLineEnd();
-				m_result += m_indent + "RWByteAddressBuffer "
-					+ stmt->getSsboName()
-					+ ": register(u" + std::to_string( stmt->getBindingPoint() ) + ");\n";
+				// The buffers never written are bound as shader resource views.
+				if ( stmt->getVariable()->isNonWritable() )
+				{
+					m_result += m_indent + "ByteAddressBuffer "
+						+ stmt->getSsboName()
+						+ ": register(t" + std::to_string( stmt->getBindingPoint() ) + ");\n";
+				}
+				else
+				{
+					m_result += m_indent + "RWByteAddressBuffer "
+						+ stmt->getSsboName()
+						+ ": register(u" + std::to_string( stmt->getBindingPoint() ) + ");\n";
+				}
 			}
 
 			void visitShaderStructBufferDeclStmt( ast::stmt::ShaderStructBufferDecl const * stmt )override
 			{
 				m_appendLineEnd = true;
 				doAppendLineEnd();
-				m_result += m_indent + "RWStructuredBuffer<" + getTypeName( stmt->getData()->getType() ) + "> "
-					+ stmt->getData()->getName()
-					+ ": register(u" + std::to_string( stmt->getBindingPoint() ) + ");\n";
+				// The buffers never written are bound as shader resource views.
+				if ( stmt->getData()->isNonWritable() )
+				{
+					m_result += m_indent + "StructuredBuffer<" + getTypeName( stmt->getData()->getType() ) + "> "
+						+ stmt->getData()->getName()
+						+ ": register(t" + std::to_string( stmt->getBindingPoint() ) + ");\n";
+				}
+				else
+				{
+					m_result += m_indent + "RWStructuredBuffer<" + getTypeName( stmt->getData()->getType() ) + "> "
+						+ stmt->getData()->getName()
+						+ ": register(u" + std::to_string( stmt->getBindingPoint() ) + ");\n";
+				}
 			}
 
 			void visitSimpleStmt( ast::stmt::Simple const * stmt )override
@@ -1846,6 +1916,7 @@ namespace hlsl
 			{
 				m_appendLineEnd = true;
 				doAppendLineEnd();
+				doAppendLoopHint( *stmt );
 				m_result += m_indent + "while (" + doSubmit( *stmt->getCtrlExpr() ) + ")";
 				m_appendSemiColon = false;
 				visitCompoundStmt( stmt );
@@ -1892,6 +1963,8 @@ namespace hlsl
 			std::map< ast::var::VariablePtr, ast::expr::Expr const * > & m_aliases;
 			std::string m_indent;
 			std::string & m_result;
+			ast::FunctionOutputsT< std::string > * m_functions;
+			size_t m_functionIndex{};
 			bool m_appendSemiColon{ false };
 			bool m_appendLineEnd{ false };
 		};
@@ -1901,8 +1974,9 @@ namespace hlsl
 		, RoutineMap const & routines
 		, std::map< ast::var::VariablePtr, ast::expr::Expr const * > & aliases
 		, ast::stmt::Stmt const & stmt
-		, std::string indent )
+		, std::string indent
+		, ast::FunctionOutputsT< std::string > * functions )
 	{
-		return vis::StmtVisitor::submit( writerConfig, routines, aliases, stmt, std::move( indent ) );
+		return vis::StmtVisitor::submit( writerConfig, routines, aliases, stmt, std::move( indent ), functions );
 	}
 }
@@ -7,13 +7,16 @@ See LICENSE file in root folder
 
 #include "HlslHelpers.hpp"
 
+#include <ShaderAST/Visitors/FunctionHashes.hpp>
+
 namespace hlsl
 {
 	std::string generateStatements( HlslConfig const & writerConfig
 		, RoutineMap const & routines
 		, std::map< ast::var::VariablePtr, ast::expr::Expr const * > & aliases
 		, ast::stmt::Stmt const & stmt
-		, std::string indent = std::string{} );
+		, std::string indent = std::string{}
+		, ast::FunctionOutputsT< std::string > * functions = nullptr );
 }
 
 #endif
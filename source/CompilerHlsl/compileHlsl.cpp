@@ -103,6 +103,103 @@ namespace hlsl
 				throw ast::Exception{ "Unsupported SV_SampleIndex for this shader model" };
 			}
 		}
+
+		ast::stmt::ContainerPtr adaptShader( ast::Shader const & shader
+			, ast::stmt::Container const * stmt
+			, HlslShader & hlslShader
+			, ast::stmt::StmtCache & compileStmtCache
+			, ast::expr::ExprCache & compileExprCache
+			, HlslConfig const & config
+			, AdaptationData & adaptationData )
+		{
+			ast::SSAData ssaData;
+			ssaData.nextVarId = shader.getData().nextVarId;
+			auto & typesCache = shader.getTypesCache();
+			auto statements = ast::transformSSA( compileStmtCache
+				, compileExprCache
+				, typesCache
+				, *stmt
+				, ssaData
+				, false );
+			statements = ast::simplify( compileStmtCache
+				, compileExprCache
+				, typesCache
+				, *statements );
+			statements = ast::resolveConstants( compileStmtCache
+				, compileExprCache
+				, typesCache
+				, *statements );
+			statements = ast::optimiseStatements( compileStmtCache
+				, compileExprCache
+				, typesCache
+				, std::move( statements )
+				, ssaData
+				, false
+				, config.optimisations );
+			adaptationData.aliasId = ssaData.aliasId;
+			adaptationData.nextVarId = ssaData.nextVarId;
+			auto intrinsicsConfig = hlsl::fillConfig( hlslShader
+				, adaptationData
+				, *statements );
+			checkConfig( config, intrinsicsConfig );
+
+			statements = hlsl::adaptStatements( compileStmtCache
+				, compileExprCache
+				, hlslShader
+				, *statements
+				, intrinsicsConfig
+				, config
+				, adaptationData );
+			// Simplify again, since adaptation can introduce complexity
+			return ast::simplify( compileStmtCache
+				, compileExprCache
+				, typesCache
+				, *statements );
+		}
+
+		ast::stmt::ContainerPtr transformShader( ast::Shader const & shader
+			, ast::stmt::Container const * stmt
+			, HlslShader & hlslShader
+			, ast::SpecialisationInfo const & specialisation
+			, ast::stmt::StmtCache & compileStmtCache
+			, ast::expr::ExprCache & compileExprCache
+			, HlslConfig const & config
+			, AdaptationData & adaptationData )
+		{
+			auto statements = adaptShader( shader
+				, stmt
+				, hlslShader
+				, compileStmtCache
+				, compileExprCache
+				, config
+				, adaptationData );
+			statements = ast::specialiseStatements( compileStmtCache
+				, compileExprCache
+				, shader.getTypesCache()
+				, *statements
+				, specialisation );
+
+			if ( !specialisation.data.empty() )
+			{
+				// Fold the specialised constants, and prune the branches they made dead.
+				statements = ast::resolveConstants( compileStmtCache
+					, compileExprCache
+					, shader.getTypesCache()
+					, *statements );
+			}
+
+			return statements;
+		}
+	}
+
+	size_t hashConfig( HlslConfig const & config )
+	{
+		size_t result{};
+		ast::type::hashCombine( result, config.shaderModel );
+		ast::type::hashCombine( result, config.shaderStage );
+		ast::type::hashCombine( result, config.flipVertY );
+		ast::type::hashCombine( result, ast::hashConfig( config.optimisations ) );
+		return result;
 	}
 
 	std::string compileHlsl( ast::Shader const & shader
@@ -111,60 +208,80 @@ namespace hlsl
 		, ast::SpecialisationInfo const & specialisation
 		, HlslConfig const & writerConfig )
 	{
-		ast::SSAData ssaData;
-		ssaData.nextVarId = shader.getData().nextVarId;
-		auto & typesCache = shader.getTypesCache();
 		auto config = writerConfig;
 		config.shaderStage = stage;
 		auto ownAllocator = config.allocator ? nullptr : std::make_unique< ast::ShaderAllocator >();
 		auto allocator = config.allocator ? config.allocator->getBlock() : ownAllocator->getBlock();
 		ast::stmt::StmtCache compileStmtCache{ *allocator };
 		ast::expr::ExprCache compileExprCache{ *allocator };
-		auto statements = ast::transformSSA( compileStmtCache
-			, compileExprCache
-			, typesCache
-			, *stmt
-			, ssaData
-			, false );
-		statements = ast::simplify( compileStmtCache
-			, compileExprCache
-			, typesCache
-			, *statements );
-		statements = ast::resolveConstants( compileStmtCache
-			, compileExprCache
-			, typesCache
-			, *statements );
 		HlslShader hlslShader{ shader, stage };
 		AdaptationData adaptationData{ compileExprCache
 			, hlslShader };
-		adaptationData.aliasId = ssaData.aliasId;
-		adaptationData.nextVarId = ssaData.nextVarId;
-		auto intrinsicsConfig = hlsl::fillConfig( hlslShader
-			, adaptationData
-			, *statements );
-		checkConfig( config, intrinsicsConfig );
-
-		statements = hlsl::adaptStatements( compileStmtCache
-			, compileExprCache
+		auto statements = transformShader( shader
+			, stmt
 			, hlslShader
-			, *statements
-			, intrinsicsConfig
+			, specialisation
+			, compileStmtCache
+			, compileExprCache
 			, config
 			, adaptationData );
-		// Simplify again, since adaptation can introduce complexity
-		statements = ast::simplify( compileStmtCache
-			, compileExprCache
-			, typesCache
-			, *statements );
-		statements = ast::specialiseStatements( compileStmtCache
-			, compileExprCache
-			, typesCache
-			, *statements
-			, specialisation );
 		std::map< ast::var::VariablePtr, ast::expr::Expr const * > aliases;
 		return hlsl::generateStatements( config, adaptationData.getRoutines(), aliases, *statements );
 	}
 
+	std::vector< std::string > compileHlslVariants( ast::Shader const & shader
+		, std::span< ast::SpecialisationInfo const > specialisations
+		, HlslConfig const & writerConfig )
+	{
+		auto config = writerConfig;
+		config.shaderStage = shader.getType();
+		auto ownAllocator = config.allocator ? nullptr : std::make_unique< ast::ShaderAllocator >();
+		auto & shaderAllocator = config.allocator ? *config.allocator : *ownAllocator;
+		auto allocator = shaderAllocator.getBlock();
+		ast::stmt::StmtCache compileStmtCache{ *allocator };
+		ast::expr::ExprCache compileExprCache{ *allocator };
+		auto & typesCache = shader.getTypesCache();
+		HlslShader hlslShader{ shader, config.shaderStage };
+		AdaptationData adaptationData{ compileExprCache
+			, hlslShader };
+		auto statements = adaptShader( shader
+			, shader.getStatements()
+			, hlslShader
+			, compileStmtCache
+			, compileExprCache
+			, config
+			, adaptationData );
+		std::vector< std::string > result;
+		result.reserve( specialisations.size() );
+
+		for ( auto & specialisation : specialisations )
+		{
+			// Each variant lives in its own block, released before the next one.
+			auto variantAllocator = shaderAllocator.getBlock();
+			ast::stmt::StmtCache variantStmtCache{ *variantAllocator };
+			ast::expr::ExprCache variantExprCache{ *variantAllocator };
+			auto variant = ast::specialiseStatements( variantStmtCache
+				, variantExprCache
+				, typesCache
+				, *statements
+				, specialisation );
+
+			if ( !specialisation.data.empty() )
+			{
+				// Fold the specialised constants, and prune the branches they made dead.
+				variant = ast::resolveConstants( variantStmtCache
+					, variantExprCache
+					, typesCache
+					, *variant );
+			}
+
+			std::map< ast::var::VariablePtr, ast::expr::Expr const * > aliases;
+			result.push_back( hlsl::generateStatements( config, adaptationData.getRoutines(), aliases, *variant ) );
+		}
+
+		return result;
+	}
+
 	std::string compileHlsl( ast::Shader const & shader
 		, ast::SpecialisationInfo const & specialisation
 		, HlslConfig const & writerConfig )
@@ -175,4 +292,80 @@ namespace hlsl
 			, specialisation
 			, writerConfig );
 	}
+
+	std::string compileHlsl( ast::Shader const & shader
+		, ast::SpecialisationInfo const & specialisation
+		, HlslConfig const & writerConfig
+		, HlslMemo & memo )
+	{
+		auto config = writerConfig;
+		config.shaderStage = shader.getType();
+		auto ownAllocator = config.allocator ? nullptr : std::make_unique< ast::ShaderAllocator >();
+		auto allocator = config.allocator ? config.allocator->getBlock() : ownAllocator->getBlock();
+		ast::stmt::StmtCache compileStmtCache{ *allocator };
+		ast::expr::ExprCache compileExprCache{ *allocator };
+		HlslShader hlslShader{ shader, config.shaderStage };
+		AdaptationData adaptationData{ compileExprCache
+			, hlslShader };
+		auto statements = transformShader( shader
+			, shader.getStatements()
+			, hlslShader
+			, specialisation
+			, compileStmtCache
+			, compileExprCache
+			, config
+			, adaptationData );
+		// The routines are only written in the entry point, but they aren't part of the statements.
+		auto configHash = hashConfig( config );
+
+		for ( auto & [name, routine] : adaptationData.getRoutines() )
+		{
+			ast::type::hashCombine( configHash, name );
+		}
+
+		return memo.compile( *statements
+			, configHash
+			, [&]( HlslMemo::FunctionOutputs & functions )
+			{
+				std::map< ast::var::VariablePtr, ast::expr::Expr const * > aliases;
+				return hlsl::generateStatements( config, adaptationData.getRoutines(), aliases, *statements, {}, &functions );
+			} );
+	}
+
+	std::vector< std::string > compileBatch( std::span< ast::Shader const * const > shaders
+		, std::span< ast::SpecialisationInfo const > specialisations
+		, std::span< HlslConfig const > configs
+		, ast::BatchConfig const & batchConfig
+		, HlslBatchCallback const & onCompiled )
+	{
+		if ( shaders.size() != configs.size()
+			|| ( !specialisations.empty() && shaders.size() != specialisations.size() ) )
+		{
+			throw ast::Exception{ "Batch shaders, specialisations and configs counts mismatch" };
+		}
+
+		ast::SpecialisationInfo const noSpecialisation{};
+		std::vector< std::string > result( shaders.size() );
+		auto groups = ast::groupBatchItems( { shaders.begin(), shaders.end() } );
+		ast::runBatch( groups.size()
+			, [&]( ast::ShaderAllocator & allocator
+				, size_t groupIndex )
+			{
+				for ( auto index : groups[groupIndex] )
+				{
+					auto config = configs[index];
+					config.allocator = &allocator;
+					result[index] = compileHlsl( *shaders[index]
+						, specialisations.empty() ? noSpecialisation : specialisations[index]
+						, config );
+
+					if ( onCompiled )
+					{
+						onCompiled( index, result[index] );
+					}
+				}
+			}
+			, batchConfig );
+		return result;
+	}
 }
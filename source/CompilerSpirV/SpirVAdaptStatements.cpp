@@ -69,6 +69,7 @@ namespace spirv
 				assert( stmt->getElseIfList().empty() && "ElseIf list is supposed to have been converted." );
 				auto save = m_current;
 				auto cont = m_stmtCache.makeIf( doSubmit( *stmt->getCtrlExpr() ) );
+				cont->setHint( stmt->getHint() );
 				m_current = cont.get();
 				visitContainerStmt( stmt );
 				m_current = save;
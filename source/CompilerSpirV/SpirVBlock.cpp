@@ -17,6 +17,44 @@ namespace spirv
 {
 	//*************************************************************************
 
+	namespace spvblock
+	{
+		static bool isBufferStorage( ast::type::Storage storage )
+		{
+			return storage == ast::type::Storage::eUniform
+				|| storage == ast::type::Storage::eStorageBuffer
+				|| storage == ast::type::Storage::ePhysicalStorageBuffer
+				|| storage == ast::type::Storage::eShaderRecordBuffer;
+		}
+
+		static DebugId getRoot( DebugId const & pointer
+			, ast::Map< DebugId, DebugId > const & accessChainBases )
+		{
+			auto result = pointer;
+			auto it = accessChainBases.find( result );
+
+			while ( it != accessChainBases.end() )
+			{
+				result = it->second;
+				it = accessChainBases.find( result );
+			}
+
+			return result;
+		}
+
+		static bool isExternalStorage( ast::type::Storage storage
+			, bool includePrivate )
+		{
+			return storage != ast::type::Storage::eFunction
+				&& storage != ast::type::Storage::eInput
+				&& storage != ast::type::Storage::eUniformConstant
+				&& storage != ast::type::Storage::ePushConstant
+				&& ( includePrivate || storage != ast::type::Storage::ePrivate );
+		}
+	}
+
+	//*************************************************************************
+
 	bool VariableInfo::needsStoreOnPromote()const
 	{
 		return isAlias
@@ -35,6 +73,7 @@ namespace spirv
 		, allocator{ rhs.allocator }
 		, variables{ std::move( rhs.variables ) }
 		, accessChains{ std::move( rhs.accessChains ) }
+		, accessChainBases{ std::move( rhs.accessChainBases ) }
 		, isInterrupted{ rhs.isInterrupted }
 	{
 		rhs.label = {};
@@ -50,6 +89,7 @@ namespace spirv
 		allocator = rhs.allocator;
 		variables = std::move( rhs.variables );
 		accessChains = std::move( rhs.accessChains );
+		accessChainBases = std::move( rhs.accessChainBases );
 		isInterrupted = rhs.isInterrupted;
 
 		rhs.label = {};
@@ -65,7 +105,8 @@ namespace spirv
 		, instructions{ alloc }
 		, allocator{ alloc }
 		, variables{ ast::StlMapAllocatorT< DebugId, DebugId >{ alloc } }
-		, accessChains{ ast::StlPairAllocatorT< DebugIdList, DebugId >{ alloc } }
+		, accessChains{ ast::StlMapAllocatorT< DebugIdList, DebugId >{ alloc } }
+		, accessChainBases{ ast::StlMapAllocatorT< DebugId, DebugId >{ alloc } }
 	{
 	}
 
@@ -147,85 +188,117 @@ namespace spirv
 		nonSemanticDebug.makeValueInstruction( instructions, variable, value );
 
 		modifyVariable( variable );
-	}
 
-	void Block::modifyVariable( DebugId const & variable )
-	{
-		// Remove the variable from the cache.
-		if ( auto it = variables.find( variable );
-			it != variables.end() )
+		if ( shaderModule.isEliminatingRedundantMemoryAccesses() )
 		{
-			variables.erase( it );
+			// The following loads of the variable get the stored value.
+			variables.insert_or_assign( variable, value );
 		}
+	}
 
-		DebugIdList work{ allocator };
-		auto accit = accessChains.begin();
+	void Block::modifyVariable( DebugId const & variable )
+	{
+		// The access chains don't depend on the memory content, they are kept.
+		// Remove the values loaded from the variable, or from any pointer into it, from the cache.
+		auto root = spvblock::getRoot( variable, accessChainBases );
+		auto it = variables.begin();
 
-		while ( accit != accessChains.end() )
+		while ( it != variables.end() )
 		{
-			if ( accit->first.front() == variable // The access chains for which the variable is the source.
-				|| accit->second == variable ) // The access chain that represents this variable.
+			if ( it->first.isPointer()
+				&& spvblock::getRoot( it->first, accessChainBases ) == root )
 			{
-				work.emplace_back( accit->first.front() );
-				accit = accessChains.erase( accit );
+				it = variables.erase( it );
 			}
 			else
 			{
-				++accit;
+				++it;
 			}
 		}
 
-		for ( auto const & id : work )
+		// Two buffers can be bound to the same memory, the values loaded from any buffer are not valid anymore.
+		if ( variable.isPointer()
+			&& spvblock::isBufferStorage( variable.getStorage() ) )
 		{
-			modifyVariable( id );
+			it = variables.begin();
+
+			while ( it != variables.end() )
+			{
+				if ( it->first.isPointer()
+					&& spvblock::isBufferStorage( it->first.getStorage() ) )
+				{
+					it = variables.erase( it );
+				}
+				else
+				{
+					++it;
+				}
+			}
 		}
 	}
 
-	DebugId Block::writeAccessChain( ValueIdList const & accessChain
-		, ast::expr::Expr const & expr
-		, Module & shaderModule
-		, glsl::Statement const * debugStatement )
+	void Block::invalidateExternalMemory( bool includePrivate )
 	{
-		auto debugAccessChain = toTypeId( accessChain );
-		auto it = std::find_if( accessChains.begin()
-			, accessChains.end()
-			, [&debugAccessChain]( std::pair< DebugIdList, DebugId > const & lookup )
-			{
-				static DebugIdListHasher const hasher{};
-				return hasher( debugAccessChain ) == hasher( lookup.first );
-			} );
+		auto it = variables.begin();
 
-		if ( it == accessChains.end() )
+		while ( it != variables.end() )
 		{
-			spv::StorageClass storageClass{};
-
-			if ( accessChain.front().isPointer() )
+			if ( it->first.isPointer()
+				&& spvblock::isExternalStorage( it->first.getStorage(), includePrivate ) )
 			{
-				storageClass = convert( accessChain.front().getStorage() );
+				it = variables.erase( it );
 			}
 			else
 			{
-				auto var = ast::findIdentifier( expr )->getVariable();
-				storageClass = getStorageClass( shaderModule.getVersion(), var );
+				++it;
 			}
+		}
+	}
+
+	DebugId const * Block::findAccessChain( ValueIdList const & accessChain )const
+	{
+		auto it = accessChains.find( toTypeId( accessChain ) );
+		return it == accessChains.end()
+			? nullptr
+			: &it->second;
+	}
 
-			// Register the type pointed to.
-			auto rawTypeId = shaderModule.registerType( expr.getType(), nullptr );
-			// Register the pointer to the type.
-			auto pointerTypeId = shaderModule.registerPointerType( rawTypeId
-				, storageClass );
-			// Reserve the ID for the result.
-			DebugId resultId{ shaderModule.getIntermediateResult(), pointerTypeId->type };
-			// Write access chain => resultId = pointerTypeId( outer.members + index ).
-			writeAccessChain( resultId, pointerTypeId, accessChain, shaderModule );
-			it = std::next( accessChains.begin(), ptrdiff_t( accessChains.size() - 1u ) );
-			shaderModule.declareDebugAccessChain( instructions
-				, expr
-				, debugStatement
-				, resultId );
+	DebugId Block::writeAccessChain( ValueIdList const & accessChain
+		, ast::expr::Expr const & expr
+		, Module & shaderModule
+		, glsl::Statement const * debugStatement )
+	{
+		if ( auto result = findAccessChain( accessChain ) )
+		{
+			return *result;
 		}
 
-		return it->second;
+		spv::StorageClass storageClass{};
+
+		if ( accessChain.front().isPointer() )
+		{
+			storageClass = convert( accessChain.front().getStorage() );
+		}
+		else
+		{
+			auto var = ast::findIdentifier( expr )->getVariable();
+			storageClass = getStorageClass( shaderModule.getVersion(), var );
+		}
+
+		// Register the type pointed to.
+		auto rawTypeId = shaderModule.registerType( expr.getType(), nullptr );
+		// Register the pointer to the type.
+		auto pointerTypeId = shaderModule.registerPointerType( rawTypeId
+			, storageClass );
+		// Reserve the ID for the result.
+		DebugId resultId{ shaderModule.getIntermediateResult(), pointerTypeId->type };
+		// Write access chain => resultId = pointerTypeId( outer.members + index ).
+		writeAccessChain( resultId, pointerTypeId, accessChain, shaderModule );
+		shaderModule.declareDebugAccessChain( instructions
+			, expr
+			, debugStatement
+			, resultId );
+		return resultId;
 	}
 
 	void Block::writeAccessChain( DebugId const & accessChainId
@@ -233,12 +306,12 @@ namespace spirv
 		, ValueIdList const & accessChainOperands
 		, Module & shaderModule )
 	{
-		auto debugAccessChain = toTypeId( accessChainOperands );
 		instructions.emplace_back( makeInstruction< AccessChainInstruction >( shaderModule.getNameCache()
 			, pointerTypeId.id
 			, accessChainId.id
 			, accessChainOperands ) );
-		accessChains.emplace_back( debugAccessChain, accessChainId );
+		accessChains.insert_or_assign( toTypeId( accessChainOperands ), accessChainId );
+		accessChainBases.insert_or_assign( accessChainId, DebugId{ accessChainOperands.front() } );
 	}
 
 	Block Block::deserialize( ast::ShaderAllocatorBlock * alloc
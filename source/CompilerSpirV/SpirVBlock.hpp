@@ -71,6 +71,14 @@ namespace spirv
 			, glsl::RangeInfo const & columns
 			, debug::NonSemanticDebug & nonSemanticDebug );
 		SDWSPIRV_API void modifyVariable( DebugId const & variable );
+		/**
+		*	Removes from the cache the values loaded from the memory that can be written
+		*	by other invocations (after a barrier), or by a called function.
+		*\param[in] includePrivate
+		*	Tells if the invocation's Private variables are also removed.
+		*/
+		SDWSPIRV_API void invalidateExternalMemory( bool includePrivate );
+		SDWSPIRV_API DebugId const * findAccessChain( ValueIdList const & accessChain )const;
 		SDWSPIRV_API DebugId writeAccessChain( ValueIdList const & accessChain
 			, ast::expr::Expr const & expr
 			, Module & shaderModule
@@ -92,7 +100,10 @@ namespace spirv
 		// Used during construction.
 		ast::ShaderAllocatorBlock * allocator;
 		ast::Map< DebugId, DebugId > variables;
-		ast::Vector< std::pair< DebugIdList, DebugId > > accessChains;
+		// The access chains written in the block, keyed by their base and indices.
+		ast::UnorderedMap< DebugIdList, DebugId, DebugIdListHasher > accessChains;
+		// The base of each access chain written in the block.
+		ast::Map< DebugId, DebugId > accessChainBases;
 		bool isInterrupted{};
 	};
 }
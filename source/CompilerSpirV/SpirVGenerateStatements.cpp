@@ -14,6 +14,7 @@ See LICENSE file in root folder
 #include "SpirVCombinedImageAccessConfig.hpp"
 #include "SpirVCombinedImageAccessNames.hpp"
 
+#include <ShaderAST/ShaderBatch.hpp>
 #include <ShaderAST/Expr/ExprVisitor.hpp>
 #include <ShaderAST/Stmt/StmtVisitor.hpp>
 #include <ShaderAST/Type/TypeImage.hpp>
@@ -23,6 +24,7 @@ See LICENSE file in root folder
 
 #include <algorithm>
 #include <array>
+#include <limits>
 #include <numeric>
 #include <sstream>
 #include <stdexcept>
@@ -359,6 +361,52 @@ namespace spirv
 
 				return result;
 			}
+
+			static uint32_t getLoopControl( ast::stmt::LoopHint hint )
+			{
+				switch ( hint )
+				{
+				case ast::stmt::LoopHint::eUnroll:
+					return uint32_t( spv::LoopControlUnrollMask );
+				case ast::stmt::LoopHint::eDontUnroll:
+					return uint32_t( spv::LoopControlDontUnrollMask );
+				default:
+					return uint32_t( spv::LoopControlMaskNone );
+				}
+			}
+
+			/**
+			*\return
+			*	\p true if \p expr is generated as an arithmetic instruction with its own result.
+			*/
+			static bool isComputation( ast::expr::Expr const & expr )
+			{
+				switch ( expr.getKind() )
+				{
+				case ast::expr::Kind::eAdd:
+				case ast::expr::Kind::eMinus:
+				case ast::expr::Kind::eTimes:
+				case ast::expr::Kind::eDivide:
+				case ast::expr::Kind::eUnaryMinus:
+				case ast::expr::Kind::eIntrinsicCall:
+					return true;
+				default:
+					return false;
+				}
+			}
+
+			static uint32_t getSelectionControl( ast::stmt::SelectionHint hint )
+			{
+				switch ( hint )
+				{
+				case ast::stmt::SelectionHint::eFlatten:
+					return uint32_t( spv::SelectionControlFlattenMask );
+				case ast::stmt::SelectionHint::eDontFlatten:
+					return uint32_t( spv::SelectionControlDontFlattenMask );
+				default:
+					return uint32_t( spv::SelectionControlMaskNone );
+				}
+			}
 		}
 
 		class ExprVisitor
@@ -810,12 +858,22 @@ namespace spirv
 						assert( lhsOutermost->getKind() == ast::expr::Kind::eIdentifier );
 						auto pointerTypeId = registerPointerType( typeId
 							, getStorageClass( getVersion(), static_cast< ast::expr::Identifier const & >( *lhsOutermost ).getVariable() ) );
-						//   Create the access chain.
-						auto intermediateId = getIntermediateResult( pointerTypeId->type );
-						m_currentBlock.writeAccessChain( intermediateId
-							, pointerTypeId
-							, makeOperands( m_allocator, lhsId, componentId )
-							, m_module );
+						//   Create the access chain, if not already written in this block.
+						auto operands = makeOperands( m_allocator, lhsId, componentId );
+						DebugId intermediateId;
+
+						if ( auto accessChainId = m_currentBlock.findAccessChain( operands ) )
+						{
+							intermediateId = *accessChainId;
+						}
+						else
+						{
+							intermediateId = getIntermediateResult( pointerTypeId->type );
+							m_currentBlock.writeAccessChain( intermediateId
+								, pointerTypeId
+								, operands
+								, m_module );
+						}
 						// - Store the RHS into this access chain.
 						storeVariable( intermediateId, rhsId, *expr );
 						m_result = intermediateId;
@@ -1064,6 +1122,8 @@ namespace spirv
 					, typeId.id
 					, m_result.id
 					, convert( params ) ) );
+				// The called function can write any global variable.
+				m_currentBlock.invalidateExternalMemory( true );
 
 				for ( auto const & param : outputParams )
 				{
@@ -1489,6 +1549,13 @@ namespace spirv
 					registerAlias( var->getName()
 						, var->getType()
 						, m_result );
+
+					// Only the computations results are decorated, the constants are shared.
+					if ( var->isRelaxedPrecision()
+						&& helpers::isComputation( *expr->getAliasedExpr() ) )
+					{
+						m_module.decorate( m_result, spv::DecorationRelaxedPrecision );
+					}
 				}
 			}
 
@@ -1707,6 +1774,7 @@ namespace spirv
 					, m_result.id
 					, opCode
 					, convert( params ) ) );
+				m_currentBlock.modifyVariable( params.front() );
 			}
 
 			void handleExtensionIntrinsicCallExpr( spv::Id opCode, ast::expr::IntrinsicCall const * expr )
@@ -1725,6 +1793,7 @@ namespace spirv
 					assert( expr->getArgList().size() == 2u );
 					params.push_back( loadVariable( doSubmit( *expr->getArgList()[0] ), *expr->getArgList()[0] ) );
 					params.push_back( doSubmit( *expr->getArgList()[1] ) );
+					m_currentBlock.modifyVariable( params.back() );
 				}
 				else if ( intrinsic >= ast::expr::Intrinsic::eInterpolateAtCentroid1
 					&& intrinsic <= ast::expr::Intrinsic::eInterpolateAtCentroid4 )
@@ -1797,6 +1866,8 @@ namespace spirv
 				m_currentBlock.instructions.emplace_back( makeIntrinsicInstruction( getNameCache()
 					, opCode
 					, convert( params ) ) );
+				// The memory can have been written by other invocations.
+				m_currentBlock.invalidateExternalMemory( false );
 			}
 
 			void handleSubgroupIntrinsicCallExpr( spv::Op opCode, ast::expr::IntrinsicCall const * expr )
@@ -1907,6 +1978,7 @@ namespace spirv
 				if ( !m_unsignedExtendedTypes[count] )
 				{
 					std::string name = "SDW_ExtendedResultTypeU" + std::to_string( count + 1u );
+					auto lock = m_typesCache.lock();
 					m_unsignedExtendedTypes[count] = m_typesCache.getStruct( ast::type::MemoryLayout::eC, name );
 
 					if ( m_unsignedExtendedTypes[count]->empty() )
@@ -1934,6 +2006,7 @@ namespace spirv
 				if ( !m_signedExtendedTypes[count] )
 				{
 					std::string name = "SDW_ExtendedResultTypeS" + std::to_string( count + 1u );
+					auto lock = m_typesCache.lock();
 					m_signedExtendedTypes[count] = m_typesCache.getStruct( ast::type::MemoryLayout::eC, name );
 
 					if ( m_signedExtendedTypes[count]->empty() )
@@ -2051,6 +2124,11 @@ namespace spirv
 						, sourceInfo
 						, init );
 					result = sourceInfo.isAlias;
+
+					if ( !result )
+					{
+						decorateVar( *var, m_result, m_module );
+					}
 				}
 				else if ( var->isAlias()
 					&& !isFuncInit )
@@ -2077,6 +2155,7 @@ namespace spirv
 					{
 						m_result = varInfo;
 						result = sourceInfo.isAlias;
+						decorateVar( *var, m_result, m_module );
 
 						if ( init )
 						{
@@ -2142,10 +2221,22 @@ namespace spirv
 			uint32_t m_aliasId{ 1u };
 		};
 
+		// The functions whose body is generated, by declaration order, the other ones are only declared.
+		struct FunctionsRange
+		{
+			size_t first{};
+			size_t last{ std::numeric_limits< size_t >::max() };
+		};
+
 		class StmtVisitor
 			: public ast::stmt::Visitor
 		{
 		public:
+			/**
+			*\param[out] sharedIdsBound
+			*	Receives the ids bound when the first function is met, the modules generated from the same statements
+			*	are identical until then.
+			*/
 			static ModulePtr submit( ast::expr::ExprCache & exprCache
 				, ast::type::TypesCache & typesCache
 				, ast::stmt::Stmt const & stmt
@@ -2154,8 +2245,10 @@ namespace spirv
 				, spirv::PreprocContext context
 				, SpirVConfig const & spirvConfig
 				, glsl::StmtConfig const & stmtConfig
-				, ShaderActions actions
-				, glsl::Statements debugStatements )
+				, ShaderActions const & actions
+				, glsl::Statements debugStatements
+				, FunctionsRange const & generated = {}
+				, spv::Id * sharedIdsBound = nullptr )
 			{
 				auto result = ModulePtr{ new Module{ &exprCache.getAllocator()
 					, typesCache
@@ -2169,9 +2262,16 @@ namespace spirv
 					, *result
 					, moduleConfig
 					, std::move( context )
-					, std::move( actions )
-					, std::move( debugStatements ) };
+					, actions
+					, std::move( debugStatements )
+					, generated };
 				stmt.accept( &vis );
+
+				if ( sharedIdsBound )
+				{
+					*sharedIdsBound = vis.m_sharedIdsBound;
+				}
+
 				return result;
 			}
 
@@ -2187,13 +2287,15 @@ namespace spirv
 				, Module & result
 				, ModuleConfig const & moduleConfig
 				, spirv::PreprocContext context
-				, ShaderActions actions
-				, glsl::Statements debugStatements )
+				, ShaderActions const & actions
+				, glsl::Statements debugStatements
+				, FunctionsRange const & generated )
 				: m_exprCache{ exprCache }
 				, m_allocator{ &m_exprCache.getAllocator() }
 				, m_moduleConfig{ moduleConfig }
 				, m_context{ std::move( context ) }
-				, m_actions{ std::move( actions ) }
+				, m_actions{ actions }
+				, m_generated{ generated }
 				, m_result{ result }
 				, m_debug{ m_result.getNonSemanticDebug() }
 				, m_debugStatements{ std::move( debugStatements ) }
@@ -2581,7 +2683,7 @@ namespace spirv
 					, makeOperands( m_allocator
 						, ValueId{ mergeBlock.label }
 						, ValueId{ ifBlock.label }
-						, ValueId{ 0u } ) ) );
+						, ValueId{ helpers::getLoopControl( stmt->getHint() ) } ) ) );
 				endBlock( loopBlock, contentBlock.label );
 
 				// The current block becomes the loop content block.
@@ -2660,6 +2762,19 @@ namespace spirv
 			void visitFunctionDeclStmt( ast::stmt::FunctionDecl const * stmt )override
 			{
 				TraceFunc;
+
+				if ( !m_functionIndex )
+				{
+					m_sharedIdsBound = m_result.getIdsBound();
+				}
+
+				if ( auto index = m_functionIndex++;
+					index < m_generated.first || index >= m_generated.last )
+				{
+					declareFunction( *stmt );
+					return;
+				}
+
 				auto type = stmt->getType();
 				auto declStmt = getCurrentDebugStatement();
 				consumeDebugStatement( glsl::StatementType::eFunctionDecl );
@@ -2768,6 +2883,30 @@ namespace spirv
 				m_function = nullptr;
 			}
 
+			// Only declares the function, its body is generated in another module, see generateModule.
+			void declareFunction( ast::stmt::FunctionDecl const & stmt )
+			{
+				auto type = stmt.getType();
+				auto retType = m_result.registerType( type->getReturnType(), nullptr );
+				m_function = m_result.beginFunction( stmt.getName()
+					, retType
+					, ast::var::VariableList{ type->begin(), type->end() }
+					, nullptr
+					, nullptr
+					, nullptr );
+
+				if ( stmt.isEntryPoint() )
+				{
+					m_result.registerEntryPoint( m_function->id
+						, stmt.getName()
+						, convert( m_inputs )
+						, convert( m_outputs ) );
+				}
+
+				m_result.endFunction();
+				m_function = nullptr;
+			}
+
 			void visitHitAttributeVariableDeclStmt( ast::stmt::HitAttributeVariableDecl const * stmt )override
 			{
 				TraceFunc;
@@ -2800,7 +2939,7 @@ namespace spirv
 				auto intermediateIfId = loadVariable( doSubmit( *stmt->getCtrlExpr() ), *stmt->getCtrlExpr() );
 				m_debug.makeNoScopeInstruction( m_currentBlock.instructions );
 
-				m_currentBlock.instructions.emplace_back( makeInstruction< SelectionMergeInstruction >( m_result.getNameCache(), ValueId{ mergeBlock.label }, ValueId{ 0u } ) );
+				m_currentBlock.instructions.emplace_back( makeInstruction< SelectionMergeInstruction >( m_result.getNameCache(), ValueId{ mergeBlock.label }, ValueId{ helpers::getSelectionControl( stmt->getHint() ) } ) );
 				endBlock( m_currentBlock, intermediateIfId->id, contentBlock.label, falseBlockLabel );
 
 				// The current block becomes the if content block.
@@ -3077,6 +3216,15 @@ namespace spirv
 					, ( m_result.getVersion() > v1_3
 						? spv::DecorationBlock
 						: spv::DecorationBufferBlock ) );
+				uint32_t index = 0u;
+
+				for ( auto & member : *stmt )
+				{
+					decorateBufferMember( variableId
+						, index++
+						, *static_cast< ast::stmt::VariableDecl const & >( *member ).getVariable() );
+				}
+
 				visitDebugVariableBlockDecl( stmt );
 			}
 
@@ -3090,6 +3238,7 @@ namespace spirv
 					, ( m_result.getVersion() > v1_3
 						? spv::DecorationBlock
 						: spv::DecorationBufferBlock ) );
+				decorateBufferMember( variableId, 0u, *stmt->getData() );
 				visitDebugVariableDecl();
 				consumeDebugStatement( glsl::StatementType::eStructureScopeBegin );
 				consumeDebugStatement( glsl::StatementType::eStructureMemberDecl );
@@ -3369,6 +3518,21 @@ namespace spirv
 					, glsl::StatementType::eStructureScopeEnd );
 			}
 
+			void decorateBufferMember( DebugId const & variableId
+				, uint32_t index
+				, ast::var::Variable const & member )
+			{
+				if ( member.isNonWritable() )
+				{
+					m_result.decorateBufferMember( variableId, index, spv::DecorationNonWritable );
+				}
+
+				if ( member.isNonReadable() )
+				{
+					m_result.decorateBufferMember( variableId, index, spv::DecorationNonReadable );
+				}
+			}
+
 			DebugId submitAndLoad( ast::expr::Expr const & expr )
 			{
 				TraceFunc;
@@ -3387,7 +3551,10 @@ namespace spirv
 			ast::ShaderAllocatorBlock * m_allocator;
 			ModuleConfig const & m_moduleConfig;
 			spirv::PreprocContext m_context;
-			ShaderActions m_actions;
+			ShaderActions const & m_actions;
+			FunctionsRange m_generated;
+			size_t m_functionIndex{};
+			spv::Id m_sharedIdsBound{};
 			Module & m_result;
 			debug::NonSemanticDebug & m_debug;
 			glsl::Statements m_debugStatements;
@@ -3401,6 +3568,214 @@ namespace spirv
 			std::vector< glsl::StatementType > m_scopeLines{ glsl::StatementType::eScopeLine };
 			ValueId m_currentScopeId{};
 		};
+
+		// Lists the statements count of the functions, by declaration order.
+		class FunctionsSizes
+			: public ast::stmt::SimpleVisitor
+		{
+		public:
+			static std::vector< size_t > submit( ast::stmt::Stmt const & stmt )
+			{
+				std::vector< size_t > result;
+				FunctionsSizes vis{ result };
+				stmt.accept( &vis );
+				return result;
+			}
+
+		private:
+			explicit FunctionsSizes( std::vector< size_t > & result )
+				: m_result{ result }
+			{
+			}
+
+			void visitContainerStmt( ast::stmt::Container const * stmt )override
+			{
+				m_count += stmt->size();
+				SimpleVisitor::visitContainerStmt( stmt );
+			}
+
+			void visitFunctionDeclStmt( ast::stmt::FunctionDecl const * stmt )override
+			{
+				m_count = 1u;
+				visitContainerStmt( stmt );
+				m_result.push_back( m_count );
+			}
+
+		private:
+			std::vector< size_t > & m_result;
+			size_t m_count{};
+		};
+
+		// Splits the functions in at most count contiguous ranges, of similar statements counts.
+		static std::vector< FunctionsRange > splitFunctions( ast::stmt::Stmt const & stmt
+			, uint32_t count )
+		{
+			std::vector< FunctionsRange > result;
+
+			if ( count < 2u )
+			{
+				return result;
+			}
+
+			auto sizes = FunctionsSizes::submit( stmt );
+
+			if ( sizes.size() < 2u )
+			{
+				return result;
+			}
+
+			auto ranges = std::min( size_t( count ), sizes.size() );
+			auto total = std::accumulate( sizes.begin(), sizes.end(), size_t{} );
+			size_t accumulated{};
+			FunctionsRange range{};
+
+			for ( size_t index = 0u; index + 1u < sizes.size(); ++index )
+			{
+				accumulated += sizes[index];
+				auto remainingFunctions = sizes.size() - index - 1u;
+				auto remainingRanges = ranges - result.size() - 1u;
+
+				// Each remaining range needs at least one function.
+				if ( remainingRanges
+					&& ( accumulated * ranges >= total * ( result.size() + 1u )
+						|| remainingFunctions == remainingRanges ) )
+				{
+					range.last = index + 1u;
+					result.push_back( range );
+					range.first = range.last;
+				}
+			}
+
+			range.last = sizes.size();
+			result.push_back( range );
+			return result;
+		}
+
+		// Hashes the main module, where the functions are only declared, and the functions names,
+		// since the functions modules are matched to it by function order.
+		static size_t hashLayout( Module const & shaderModule
+			, ast::ShaderHashes const & hashes )
+		{
+			size_t result{};
+
+			for ( auto word : Module::serialize( shaderModule ) )
+			{
+				ast::type::hashCombine( result, word );
+			}
+
+			for ( auto & function : hashes.functions )
+			{
+				ast::type::hashCombine( result, function.name );
+			}
+
+			return result;
+		}
+
+		static ModulePtr generateFunctionsModules( ast::expr::ExprCache & exprCache
+			, ast::type::TypesCache & typesCache
+			, ast::stmt::Stmt const & stmt
+			, ast::ShaderStage type
+			, ModuleConfig const & moduleConfig
+			, spirv::PreprocContext const & context
+			, SpirVConfig const & spirvConfig
+			, glsl::StmtConfig const & stmtConfig
+			, ShaderActions const & actions
+			, std::vector< FunctionsRange > const & ranges )
+		{
+			// The first range is generated in the main module, the other ones in their own module.
+			// Their expressions are allocated directly, a fragmented allocator per module would cost more than the generation.
+			auto allocator = std::make_shared< ast::ShaderAllocator >( ast::AllocationMode::eNone );
+			std::vector< std::unique_ptr< FunctionModule > > modules;
+
+			for ( size_t index = 1u; index < ranges.size(); ++index )
+			{
+				modules.push_back( std::make_unique< FunctionModule >( allocator
+					, spirvConfig
+					, stmtConfig ) );
+			}
+
+			ModulePtr result;
+			spv::Id sharedIdsBound{};
+			ast::runBatch( ranges.size()
+				, [&]( ast::ShaderAllocator const &, size_t index )
+				{
+					if ( index == 0u )
+					{
+						result = StmtVisitor::submit( exprCache
+							, typesCache
+							, stmt
+							, type
+							, moduleConfig
+							, context
+							, spirvConfig
+							, stmtConfig
+							, actions
+							, glsl::Statements{}
+							, ranges[index]
+							, &sharedIdsBound );
+					}
+					else
+					{
+						auto & functions = *modules[index - 1u];
+						functions.result = StmtVisitor::submit( functions.exprCache
+							, typesCache
+							, stmt
+							, type
+							, moduleConfig
+							, context
+							, functions.spirvConfig
+							, functions.stmtConfig
+							, actions
+							, glsl::Statements{}
+							, ranges[index]
+							, &functions.sharedIdsBound );
+					}
+				}
+				, ast::BatchConfig{ spirvConfig.generationThreads } );
+
+			if ( !std::all_of( modules.begin()
+				, modules.end()
+				, [&result, sharedIdsBound]( std::unique_ptr< FunctionModule > const & functions )
+				{
+					return functions->sharedIdsBound == sharedIdsBound
+						&& result->canMergeFunctions( *functions->result, sharedIdsBound );
+				} ) )
+			{
+				return nullptr;
+			}
+
+			for ( size_t index = 1u; index < ranges.size(); ++index )
+			{
+				auto & functions = *modules[index - 1u];
+				result->mergeFunctions( *functions.result
+					, sharedIdsBound
+					, ranges[index].first
+					, ranges[index].last );
+
+				if ( spirvConfig.controlFlowStats )
+				{
+					spirvConfig.controlFlowStats->blocksBefore += functions.controlFlowStats.blocksBefore;
+					spirvConfig.controlFlowStats->blocksAfter += functions.controlFlowStats.blocksAfter;
+				}
+			}
+
+			return result;
+		}
+	}
+
+	FunctionModule::FunctionModule( std::shared_ptr< ast::ShaderAllocator > pallocator
+		, SpirVConfig const & pspirvConfig
+		, glsl::StmtConfig const & pstmtConfig )
+		: allocator{ std::move( pallocator ) }
+		, allocatorBlock{ allocator->getBlock() }
+		, exprCache{ *allocatorBlock }
+		, spirvConfig{ pspirvConfig }
+		, stmtConfig{ pstmtConfig }
+	{
+		if ( spirvConfig.controlFlowStats )
+		{
+			spirvConfig.controlFlowStats = &controlFlowStats;
+		}
 	}
 
 	ModulePtr generateModule( ast::expr::ExprCache & exprCache
@@ -3414,6 +3789,38 @@ namespace spirv
 		, ShaderActions actions
 		, glsl::Statements debugStatements )
 	{
+		// The debug information follows the statements in order, it can't be split.
+		if ( spirvConfig.debugLevel != DebugLevel::eDebugInfo )
+		{
+			if ( auto ranges = vis::splitFunctions( stmt, spirvConfig.generationThreads );
+				!ranges.empty() )
+			{
+				auto stats = ( spirvConfig.controlFlowStats
+					? *spirvConfig.controlFlowStats
+					: ControlFlowStats{} );
+
+				if ( auto result = vis::generateFunctionsModules( exprCache
+						, typesCache
+						, stmt
+						, type
+						, moduleConfig
+						, context
+						, spirvConfig
+						, stmtConfig
+						, actions
+						, ranges ) )
+				{
+					return result;
+				}
+
+				// The modules couldn't be merged, the shader is generated again in one module.
+				if ( spirvConfig.controlFlowStats )
+				{
+					*spirvConfig.controlFlowStats = stats;
+				}
+			}
+		}
+
 		return vis::StmtVisitor::submit( exprCache
 			, typesCache
 			, stmt
@@ -3422,10 +3829,155 @@ namespace spirv
 			, std::move( context )
 			, spirvConfig
 			, stmtConfig
-			, std::move( actions )
+			, actions
 			, std::move( debugStatements ) );
 	}
 
+	ModulePtr generateModule( ast::expr::ExprCache & exprCache
+		, ast::type::TypesCache & typesCache
+		, ast::stmt::Stmt const & stmt
+		, ast::ShaderStage type
+		, ModuleConfig const & moduleConfig
+		, spirv::PreprocContext context
+		, SpirVConfig const & spirvConfig
+		, glsl::StmtConfig const & stmtConfig
+		, ShaderActions actions
+		, FunctionModules & functions )
+	{
+		auto stats = ( spirvConfig.controlFlowStats
+			? *spirvConfig.controlFlowStats
+			: ControlFlowStats{} );
+		// The main module only declares the functions.
+		spv::Id sharedIdsBound{};
+		auto result = vis::StmtVisitor::submit( exprCache
+			, typesCache
+			, stmt
+			, type
+			, moduleConfig
+			, context
+			, spirvConfig
+			, stmtConfig
+			, actions
+			, glsl::Statements{}
+			, vis::FunctionsRange{ 0u, 0u }
+			, &sharedIdsBound );
+		auto count = functions.getHashes().functions.size();
+		std::vector< FunctionModule * > modules;
+		std::vector< size_t > missing;
+		std::vector< FunctionModulePtr > generated;
+
+		if ( result->functions.size() == count )
+		{
+			// The modules of the unchanged functions are reused, if they were generated for the same main module.
+			auto layoutHash = vis::hashLayout( *result, functions.getHashes() );
+			std::shared_ptr< ast::ShaderAllocator > allocator;
+			modules.resize( count );
+
+			for ( size_t index = 0u; index < count; ++index )
+			{
+				if ( auto function = functions.find( index );
+					function
+					&& ( *function )->layoutHash == layoutHash
+					&& ( *function )->sharedIdsBound == sharedIdsBound )
+				{
+					modules[index] = function->get();
+					allocator = ( *function )->allocator;
+				}
+				else
+				{
+					missing.push_back( index );
+				}
+			}
+
+			// The functions modules outlive the compilation, and are generated concurrently.
+			if ( !allocator )
+			{
+				allocator = std::make_shared< ast::ShaderAllocator >( ast::AllocationMode::eNone );
+			}
+
+			for ( size_t index = 0u; index < missing.size(); ++index )
+			{
+				generated.emplace_back( new FunctionModule{ allocator, spirvConfig, stmtConfig } );
+				generated.back()->layoutHash = layoutHash;
+			}
+
+			ast::runBatch( missing.size()
+				, [&]( ast::ShaderAllocator const &, size_t index )
+				{
+					auto & function = *generated[index];
+					function.result = vis::StmtVisitor::submit( function.exprCache
+						, typesCache
+						, stmt
+						, type
+						, moduleConfig
+						, context
+						, function.spirvConfig
+						, function.stmtConfig
+						, actions
+						, glsl::Statements{}
+						, vis::FunctionsRange{ missing[index], missing[index] + 1u }
+						, &function.sharedIdsBound );
+					// The types registrations are keyed by the shader's types, a reused module is merged without them.
+					function.result->detachTypes();
+				}
+				, ast::BatchConfig{ std::max( 1u, spirvConfig.generationThreads ) } );
+
+			for ( size_t index = 0u; index < missing.size(); ++index )
+			{
+				modules[missing[index]] = generated[index].get();
+			}
+		}
+
+		if ( modules.empty()
+			|| !std::all_of( modules.begin()
+				, modules.end()
+				, [&result, sharedIdsBound]( FunctionModule const * function )
+				{
+					return function->sharedIdsBound == sharedIdsBound
+						&& result->canMergeFunctions( *function->result, sharedIdsBound );
+				} ) )
+		{
+			// The modules couldn't be merged, the shader is generated again in one module, and nothing is stored.
+			if ( spirvConfig.controlFlowStats )
+			{
+				*spirvConfig.controlFlowStats = stats;
+			}
+
+			return vis::StmtVisitor::submit( exprCache
+				, typesCache
+				, stmt
+				, type
+				, moduleConfig
+				, std::move( context )
+				, spirvConfig
+				, stmtConfig
+				, actions
+				, glsl::Statements{} );
+		}
+
+		for ( size_t index = 0u; index < count; ++index )
+		{
+			auto & function = *modules[index];
+			result->mergeFunctions( *function.result
+				, sharedIdsBound
+				, index
+				, index + 1u );
+
+			if ( spirvConfig.controlFlowStats )
+			{
+				spirvConfig.controlFlowStats->blocksBefore += function.controlFlowStats.blocksBefore;
+				spirvConfig.controlFlowStats->blocksAfter += function.controlFlowStats.blocksAfter;
+			}
+		}
+
+		for ( size_t index = 0u; index < missing.size(); ++index )
+		{
+			functions.store( missing[index], std::move( generated[index] ) );
+		}
+
+		return result;
+	}
+
 	DebugId generateModuleExpr( ast::expr::ExprCache & exprCache
 		, ast::expr::Expr const & expr
 		, PreprocContext const & context
@@ -12,8 +12,34 @@ See LICENSE file in root folder
 
 #include <GlslCommon/GlslStatementsHelpers.hpp>
 
+#include <ShaderAST/Expr/ExprCache.hpp>
+
 namespace spirv
 {
+	/**
+	*	A module where a range of functions bodies is generated, the other functions are only declared.
+	*	It is merged in the main module, see Module::mergeFunctions.
+	*/
+	struct FunctionModule
+	{
+		FunctionModule( std::shared_ptr< ast::ShaderAllocator > allocator
+			, SpirVConfig const & spirvConfig
+			, glsl::StmtConfig const & stmtConfig );
+
+		std::shared_ptr< ast::ShaderAllocator > allocator;
+		ast::ShaderAllocatorBlockPtr allocatorBlock;
+		ast::expr::ExprCache exprCache;
+		ControlFlowStats controlFlowStats;
+		SpirVConfig spirvConfig;
+		glsl::StmtConfig stmtConfig;
+		ModulePtr result;
+		// The ids bound of the part the module shares with the main one.
+		spv::Id sharedIdsBound{};
+		// The hash of the main module, without the functions bodies, the module was generated for.
+		size_t layoutHash{};
+	};
+	using FunctionModules = ast::FunctionOutputsT< FunctionModulePtr >;
+
 	ModulePtr generateModule( ast::expr::ExprCache & exprCache
 		, ast::type::TypesCache & typesCache
 		, ast::stmt::Stmt const & stmt
@@ -24,6 +50,20 @@ namespace spirv
 		, glsl::StmtConfig const & stmtConfig
 		, ShaderActions actions
 		, glsl::Statements debugStatements );
+	/**
+	*	Generates the module with each function body in its own module, or reused from \p functions.
+	*	The modules generated for the changed functions are stored in \p functions.
+	*/
+	ModulePtr generateModule( ast::expr::ExprCache & exprCache
+		, ast::type::TypesCache & typesCache
+		, ast::stmt::Stmt const & stmt
+		, ast::ShaderStage type
+		, ModuleConfig const & moduleConfig
+		, spirv::PreprocContext context
+		, SpirVConfig const & spirvConfig
+		, glsl::StmtConfig const & stmtConfig
+		, ShaderActions actions
+		, FunctionModules & functions );
 	DebugId generateModuleExpr( ast::expr::ExprCache & exprCache
 		, ast::expr::Expr const & expr
 		, PreprocContext const & context
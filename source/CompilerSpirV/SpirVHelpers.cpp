@@ -3606,6 +3606,11 @@ namespace spirv
 		{
 			shaderModule.decorate( varId, spv::DecorationPerTaskNV );
 		}
+
+		if ( var.isRelaxedPrecision() )
+		{
+			shaderModule.decorate( varId, spv::DecorationRelaxedPrecision );
+		}
 	}
 
 	spv::StorageClass getStorageClass( uint32_t version
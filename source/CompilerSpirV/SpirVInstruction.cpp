@@ -537,6 +537,8 @@ namespace spirv
 				return ImageAccessInstructionT < spv::OpImageSparseRead >::Config;
 			case spv::OpUndef:
 				return UndefInstruction::Config;
+			case spv::OpPhi:
+				return PhiInstruction::Config;
 			case spv::OpTerminateInvocation:
 				return TerminateInvocationInstruction::Config;
 			case spv::OpSubgroupAllKHR:
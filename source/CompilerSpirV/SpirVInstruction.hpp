@@ -596,6 +596,7 @@ namespace spirv
 	using ReturnInstruction = InstructionT< spv::OpReturn, false, false, 0u, false, false >;
 	using ReturnValueInstruction = InstructionT< spv::OpReturnValue, false, false, 1u, false, false >;
 	using UndefInstruction = InstructionT< spv::OpUndef, true, true, 0u, false, false >;
+	using PhiInstruction = VariadicInstructionT< spv::OpPhi, true, true >;
 	using FunctionEndInstruction = InstructionT< spv::OpFunctionEnd, false, false, 0u, false, false >;
 	using IgnoreIntersectionInstruction = InstructionT< spv::OpIgnoreIntersectionKHR, false, false, 0u, false, false >;
 	using TerminateRayInstruction = InstructionT< spv::OpTerminateRayKHR, false, false, 0u, false, false >;
@@ -16,6 +16,8 @@ See LICENSE file in root folder
 #include <ShaderAST/Type/TypeArray.hpp>
 
 #include <algorithm>
+#include <map>
+#include <set>
 
 namespace spirv
 {
@@ -66,6 +68,707 @@ namespace spirv
 
 			return it->second;
 		}
+
+		static Instruction const & getTerminator( Block const & block )
+		{
+			// The last block of the function keeps its terminator in its instructions, followed by OpFunctionEnd.
+			if ( !block.blockEnd
+				|| block.blockEnd->op.getOpData().opCode == spv::OpFunctionEnd )
+			{
+				return *block.instructions.back();
+			}
+
+			return *block.blockEnd;
+		}
+
+		/**
+		*	Tells if the operand at given index of a function body instruction holds a value id.
+		*\param[out] known
+		*	Set to false when the operands layout of the instruction isn't described here,
+		*	in which case all the operands must be considered as possible value ids.
+		*/
+		static bool isValueOperand( spv::Op op
+			, size_t index
+			, bool & known )
+		{
+			known = true;
+
+			switch ( op )
+			{
+			case spv::OpLabel:
+			case spv::OpBranch:
+			case spv::OpSelectionMerge:
+			case spv::OpLoopMerge:
+			case spv::OpLine:
+			case spv::OpNoLine:
+			case spv::OpVariable:
+				return false;
+			case spv::OpLoad:
+			case spv::OpCompositeExtract:
+			case spv::OpReturnValue:
+			case spv::OpBranchConditional:
+			case spv::OpSwitch:
+				return index < 1u;
+			case spv::OpStore:
+			case spv::OpCompositeInsert:
+			case spv::OpVectorShuffle:
+				return index < 2u;
+			case spv::OpExtInst:
+				// The instruction set id, then the instruction literal.
+				return index != 1u;
+			case spv::OpImageSampleImplicitLod:
+			case spv::OpImageSampleExplicitLod:
+			case spv::OpImageSampleProjImplicitLod:
+			case spv::OpImageSampleProjExplicitLod:
+			case spv::OpImageFetch:
+			case spv::OpImageRead:
+				// The image operands mask.
+				return index != 2u;
+			case spv::OpImageSampleDrefImplicitLod:
+			case spv::OpImageSampleDrefExplicitLod:
+			case spv::OpImageSampleProjDrefImplicitLod:
+			case spv::OpImageSampleProjDrefExplicitLod:
+			case spv::OpImageGather:
+			case spv::OpImageDrefGather:
+			case spv::OpImageWrite:
+				return index != 3u;
+			case spv::OpFunctionCall:
+			case spv::OpAccessChain:
+			case spv::OpInBoundsAccessChain:
+			case spv::OpVectorExtractDynamic:
+			case spv::OpVectorInsertDynamic:
+			case spv::OpCompositeConstruct:
+			case spv::OpCopyObject:
+			case spv::OpTranspose:
+			case spv::OpSampledImage:
+			case spv::OpPhi:
+				return true;
+			default:
+				break;
+			}
+
+			// Conversions, arithmetic, relational, logical and bit operations, derivatives,
+			// barriers and atomics, all their operands are ids.
+			known = ( op >= spv::OpConvertFToU && op <= spv::OpBitcast && op != spv::OpGenericCastToPtrExplicit )
+				|| ( op >= spv::OpSNegate && op <= spv::OpBitCount )
+				|| ( op >= spv::OpDPdx && op <= spv::OpFwidthCoarse )
+				|| ( op >= spv::OpControlBarrier && op <= spv::OpAtomicXor );
+			return known;
+		}
+
+		/**
+		*	Calls \p function on each block label referenced by \p instruction,
+		*	the branch targets, the merge blocks and continue targets, and the phis parent blocks.
+		*/
+		template< typename InstructionType, typename FuncT >
+		static void forEachLabel( InstructionType & instruction
+			, FuncT function )
+		{
+			switch ( instruction.op.getOpData().opCode )
+			{
+			case spv::OpBranch:
+			case spv::OpSelectionMerge:
+				function( instruction.operands[0] );
+				break;
+			case spv::OpLoopMerge:
+				function( instruction.operands[0] );
+				function( instruction.operands[1] );
+				break;
+			case spv::OpBranchConditional:
+				function( instruction.operands[1] );
+				function( instruction.operands[2] );
+				break;
+			case spv::OpSwitch:
+				function( instruction.operands[1] );
+
+				if ( instruction.labels )
+				{
+					for ( auto & [value, label] : *instruction.labels )
+					{
+						function( label );
+					}
+				}
+				break;
+			case spv::OpPhi:
+				for ( size_t index = 1u; index < instruction.operands.size(); index += 2u )
+				{
+					function( instruction.operands[index] );
+				}
+				break;
+			default:
+				break;
+			}
+		}
+
+		static bool hasInstruction( Block const & block
+			, spv::Op op )
+		{
+			return std::any_of( block.instructions.begin()
+				, block.instructions.end()
+				, [op]( InstructionPtr const & instruction )
+				{
+					return instruction->op.getOpData().opCode == op;
+				} );
+		}
+
+		static Instruction const * getMergeInstruction( Block const & block )
+		{
+			auto it = std::find_if( block.instructions.begin()
+				, block.instructions.end()
+				, []( InstructionPtr const & instruction )
+				{
+					return instruction->op.getOpData().opCode == spv::OpSelectionMerge
+						|| instruction->op.getOpData().opCode == spv::OpLoopMerge;
+				} );
+			return it == block.instructions.end()
+				? nullptr
+				: it->get();
+		}
+
+		/**
+		*	Tells if the operand at \p index of an instruction with opcode \p op is an id:
+		*	a value, type, label or function.
+		*	\p known is set to false if the operands layout of the instruction is not handled.
+		*/
+		static bool isIdOperand( spv::Op op
+			, IdList const & operands
+			, size_t index
+			, bool & known )
+		{
+			known = true;
+
+			switch ( op )
+			{
+			case spv::OpSource:
+			case spv::OpSourceExtension:
+			case spv::OpExtension:
+			case spv::OpExtInstImport:
+			case spv::OpMemoryModel:
+			case spv::OpCapability:
+			case spv::OpString:
+			case spv::OpName:
+			case spv::OpMemberName:
+			case spv::OpTypeVoid:
+			case spv::OpTypeBool:
+			case spv::OpTypeInt:
+			case spv::OpTypeFloat:
+			case spv::OpTypeSampler:
+			case spv::OpTypeAccelerationStructureKHR:
+			case spv::OpTypeForwardPointer:
+			case spv::OpConstantTrue:
+			case spv::OpConstantFalse:
+			case spv::OpConstant:
+			case spv::OpSpecConstantTrue:
+			case spv::OpSpecConstantFalse:
+			case spv::OpSpecConstant:
+			case spv::OpFunctionParameter:
+			case spv::OpFunctionEnd:
+			case spv::OpLabel:
+			case spv::OpReturn:
+			case spv::OpKill:
+			case spv::OpTerminateInvocation:
+			case spv::OpDemoteToHelperInvocation:
+			case spv::OpIgnoreIntersectionKHR:
+			case spv::OpTerminateRayKHR:
+			case spv::OpUndef:
+			case spv::OpEmitVertex:
+			case spv::OpEndPrimitive:
+			case spv::OpIsHelperInvocationEXT:
+				return false;
+			case spv::OpEntryPoint:
+				// The interface variables.
+			case spv::OpTypeArray:
+			case spv::OpTypeStruct:
+			case spv::OpTypeFunction:
+			case spv::OpConstantComposite:
+			case spv::OpSpecConstantComposite:
+			case spv::OpBranch:
+			case spv::OpSwitch:
+			case spv::OpAtomicFAddEXT:
+			case spv::OpEmitStreamVertex:
+			case spv::OpEndStreamPrimitive:
+			case spv::OpImageQueryFormat:
+			case spv::OpImageQueryOrder:
+			case spv::OpImageQuerySizeLod:
+			case spv::OpImageQuerySize:
+			case spv::OpImageQueryLod:
+			case spv::OpImageQueryLevels:
+			case spv::OpImageQuerySamples:
+			case spv::OpImageSparseTexelsResident:
+			case spv::OpImage:
+			case spv::OpSubgroupBallotKHR:
+			case spv::OpSubgroupFirstInvocationKHR:
+			case spv::OpSubgroupAllKHR:
+			case spv::OpSubgroupAnyKHR:
+			case spv::OpSubgroupAllEqualKHR:
+			case spv::OpSubgroupReadInvocationKHR:
+			case spv::OpGroupNonUniformRotateKHR:
+			case spv::OpTraceRayKHR:
+			case spv::OpExecuteCallableKHR:
+			case spv::OpReportIntersectionKHR:
+			case spv::OpEmitMeshTasksEXT:
+			case spv::OpSetMeshOutputsEXT:
+			case spv::OpWritePackedPrimitiveIndices4x8NV:
+				return true;
+			case spv::OpExecutionMode:
+			case spv::OpDecorate:
+			case spv::OpMemberDecorate:
+			case spv::OpTypeVector:
+			case spv::OpTypeMatrix:
+			case spv::OpTypeImage:
+			case spv::OpTypeSampledImage:
+			case spv::OpTypeRuntimeArray:
+			case spv::OpSelectionMerge:
+			case spv::OpGenericCastToPtrExplicit:
+			case spv::OpLine:
+				return index < 1u;
+			case spv::OpLoopMerge:
+			case spv::OpCopyMemory:
+				return index < 2u;
+			case spv::OpBranchConditional:
+				// The branch weights are literals.
+				return index < 3u;
+			case spv::OpTypePointer:
+			case spv::OpVariable:
+			case spv::OpFunction:
+				// The storage class or function control, then the type id.
+				return index == 1u;
+			case spv::OpSpecConstantOp:
+				// The opcode, then the operands of this opcode.
+				return index != 0u
+					&& isIdOperand( spv::Op( operands[0] ), operands, index - 1u, known );
+			case spv::OpImageSparseSampleImplicitLod:
+			case spv::OpImageSparseSampleExplicitLod:
+			case spv::OpImageSparseSampleProjImplicitLod:
+			case spv::OpImageSparseSampleProjExplicitLod:
+			case spv::OpImageSparseFetch:
+			case spv::OpImageSparseRead:
+				// The image operands mask.
+				return index != 2u;
+			case spv::OpImageSparseSampleDrefImplicitLod:
+			case spv::OpImageSparseSampleDrefExplicitLod:
+			case spv::OpImageSparseSampleProjDrefImplicitLod:
+			case spv::OpImageSparseSampleProjDrefExplicitLod:
+			case spv::OpImageSparseGather:
+			case spv::OpImageSparseDrefGather:
+				return index != 3u;
+			default:
+				break;
+			}
+
+			if ( op >= spv::OpGroupNonUniformElect && op <= spv::OpGroupNonUniformQuadSwap )
+			{
+				// The execution scope, then the group operation for the reductions.
+				return index != 1u
+					|| !( op == spv::OpGroupNonUniformBallotBitCount
+						|| ( op >= spv::OpGroupNonUniformIAdd && op <= spv::OpGroupNonUniformLogicalXor ) );
+			}
+
+			return isValueOperand( op, index, known );
+		}
+
+		/**
+		*	Calls \p function on each id referenced by \p instruction, its own result id excluded.
+		*/
+		template< typename FuncT >
+		static void forEachIdReference( Instruction & instruction
+			, FuncT function )
+		{
+			auto op = spv::Op( instruction.op.getOpData().opCode );
+
+			// The execution model of OpEntryPoint is a literal.
+			if ( instruction.returnTypeId
+				&& op != spv::OpEntryPoint )
+			{
+				function( instruction.returnTypeId.value() );
+			}
+
+			// These instructions reference their target with their result id.
+			if ( instruction.resultId
+				&& ( op == spv::OpName
+					|| op == spv::OpEntryPoint
+					|| op == spv::OpTypeForwardPointer ) )
+			{
+				function( instruction.resultId.value() );
+			}
+
+			for ( size_t index = 0u; index < instruction.operands.size(); ++index )
+			{
+				bool known{};
+
+				if ( isIdOperand( op, instruction.operands, index, known ) )
+				{
+					function( instruction.operands[index] );
+				}
+			}
+
+			if ( instruction.labels )
+			{
+				for ( auto & [value, label] : *instruction.labels )
+				{
+					function( label );
+				}
+			}
+		}
+
+		static bool isLayoutKnown( Instruction const & instruction )
+		{
+			auto op = spv::Op( instruction.op.getOpData().opCode );
+			bool known{ true };
+
+			for ( size_t index = 0u; known && index < instruction.operands.size(); ++index )
+			{
+				isIdOperand( op, instruction.operands, index, known );
+			}
+
+			return known;
+		}
+
+		static bool definesResultId( Instruction const & instruction )
+		{
+			auto op = spv::Op( instruction.op.getOpData().opCode );
+			return instruction.resultId
+				&& op != spv::OpName
+				&& op != spv::OpMemberName
+				&& op != spv::OpEntryPoint
+				&& op != spv::OpTypeForwardPointer;
+		}
+
+		/**
+		*	Builds the SSA values of the promoted variables, with all the blocks of the function known
+		*	(the construction from Braun et al., with every block sealed).
+		*/
+		class SsaBuilder
+		{
+		public:
+			using BlockVar = std::pair< size_t, spv::Id >;
+
+			struct Phi
+			{
+				size_t block;
+				InstructionPtr instruction;
+			};
+
+			SsaBuilder( Module & shaderModule
+				, BlockList const & blocks
+				, ast::Map< spv::Id, spv::Id > const & valueTypes
+				, ast::Map< spv::Id, spv::Id > const & initialisers )
+				: m_module{ shaderModule }
+				, m_blocks{ blocks }
+				, m_valueTypes{ valueTypes }
+				, m_initialisers{ initialisers }
+				, m_predecessors{ shaderModule.allocator }
+				, m_entryValues{ shaderModule.allocator }
+				, endValues{ shaderModule.allocator }
+				, replacements{ shaderModule.allocator }
+				, phis{ shaderModule.allocator }
+				, undefs{ shaderModule.allocator }
+			{
+				ast::Map< spv::Id, size_t > indices{ shaderModule.allocator };
+
+				for ( size_t index = 0u; index < blocks.size(); ++index )
+				{
+					indices.emplace( blocks[index].label, index );
+				}
+
+				auto addEdge = [this, &indices]( size_t source, spv::Id target )
+				{
+					if ( auto it = indices.find( target );
+						it != indices.end() )
+					{
+						m_predecessors.emplace_back( it->second, source );
+					}
+				};
+
+				for ( size_t index = 0u; index < blocks.size(); ++index )
+				{
+					auto & terminator = getTerminator( blocks[index] );
+
+					switch ( terminator.op.getOpData().opCode )
+					{
+					case spv::OpBranch:
+						addEdge( index, terminator.operands[0] );
+						break;
+					case spv::OpBranchConditional:
+						addEdge( index, terminator.operands[1] );
+						addEdge( index, terminator.operands[2] );
+						break;
+					case spv::OpSwitch:
+						addEdge( index, terminator.operands[1] );
+
+						if ( terminator.labels )
+						{
+							for ( auto & [value, label] : *terminator.labels )
+							{
+								addEdge( index, label );
+							}
+						}
+						break;
+					default:
+						break;
+					}
+				}
+
+				std::stable_sort( m_predecessors.begin()
+					, m_predecessors.end()
+					, []( std::pair< size_t, size_t > const & lhs, std::pair< size_t, size_t > const & rhs )
+					{
+						return lhs.first < rhs.first;
+					} );
+			}
+
+			spv::Id readEnd( spv::Id variable
+				, size_t block )
+			{
+				if ( auto it = endValues.find( BlockVar{ block, variable } );
+					it != endValues.end() )
+				{
+					return it->second;
+				}
+
+				return readEntry( variable, block );
+			}
+
+			spv::Id readEntry( spv::Id variable
+				, size_t block )
+			{
+				BlockVar key{ block, variable };
+
+				if ( auto [it, res] = m_entryValues.try_emplace( key, spv::Id{} );
+					!res )
+				{
+					// A null id means the value of a single predecessor block is being read,
+					// and the predecessors chain loops back to this block: a phi breaks the loop.
+					if ( !it->second )
+					{
+						it->second = addPhi( variable, block ).first;
+					}
+
+					return it->second;
+				}
+
+				auto [begin, end] = std::equal_range( m_predecessors.begin()
+					, m_predecessors.end()
+					, std::pair< size_t, size_t >{ block, 0u }
+					, []( std::pair< size_t, size_t > const & lhs, std::pair< size_t, size_t > const & rhs )
+					{
+						return lhs.first < rhs.first;
+					} );
+
+				if ( begin == end )
+				{
+					auto result = getInitialValue( variable );
+					m_entryValues[key] = result;
+					return result;
+				}
+
+				if ( std::next( begin ) == end )
+				{
+					auto result = readEnd( variable, begin->second );
+
+					if ( auto & entryValue = m_entryValues[key];
+						entryValue )
+					{
+						addPhiOperand( phis.find( entryValue )->second, result, begin->second );
+						return entryValue;
+					}
+
+					m_entryValues[key] = result;
+					return result;
+				}
+
+				// Registered before reading the predecessors, to break the loops.
+				auto [result, phi] = addPhi( variable, block );
+				m_entryValues[key] = result;
+
+				for ( auto it = begin; it != end; ++it )
+				{
+					addPhiOperand( *phi, readEnd( variable, it->second ), it->second );
+				}
+
+				return result;
+			}
+
+			spv::Id resolve( spv::Id value )const
+			{
+				auto it = replacements.find( value );
+
+				while ( it != replacements.end() )
+				{
+					value = it->second;
+					it = replacements.find( value );
+				}
+
+				return value;
+			}
+
+			/**
+			*	Replaces the phis merging only one value (apart from themselves) by this value.
+			*/
+			void removeTrivialPhis()
+			{
+				bool changed = true;
+
+				while ( changed )
+				{
+					changed = false;
+					auto it = phis.begin();
+
+					while ( it != phis.end() )
+					{
+						auto & operands = it->second.instruction->operands;
+						spv::Id same{};
+						bool trivial = true;
+
+						for ( size_t index = 0u; index < operands.size() && trivial; index += 2u )
+						{
+							auto value = resolve( operands[index] );
+
+							if ( value != it->first
+								&& value != same )
+							{
+								trivial = same == spv::Id{};
+								same = value;
+							}
+						}
+
+						if ( trivial )
+						{
+							replacements.emplace( it->first
+								, same != spv::Id{}
+									? same
+									: getUndef( it->second.instruction->returnTypeId.value() ) );
+							it = phis.erase( it );
+							changed = true;
+						}
+						else
+						{
+							++it;
+						}
+					}
+				}
+			}
+
+			spv::Id getUndef( spv::Id type )
+			{
+				auto it = undefs.find( type );
+
+				if ( it == undefs.end() )
+				{
+					auto id = m_module.getNextId();
+					it = undefs.emplace( type
+						, makeInstruction< UndefInstruction >( m_module.getNameCache()
+							, ValueId{ type }
+							, ValueId{ id } ) ).first;
+				}
+
+				return it->second->resultId.value();
+			}
+
+		private:
+			std::pair< spv::Id, Phi * > addPhi( spv::Id variable
+				, size_t block )
+			{
+				auto result = m_module.getNextId();
+				auto & phi = phis.emplace( result
+					, Phi{ block
+						, makeInstruction< PhiInstruction >( m_module.getNameCache()
+							, ValueId{ m_valueTypes.find( variable )->second }
+							, ValueId{ result }
+							, ValueIdList{ m_module.allocator } ) } ).first->second;
+				return { result, &phi };
+			}
+
+			void addPhiOperand( Phi & phi
+				, spv::Id value
+				, size_t predecessor )
+			{
+				phi.instruction->operands.push_back( value );
+				phi.instruction->operands.push_back( m_blocks[predecessor].label );
+			}
+
+			spv::Id getInitialValue( spv::Id variable )
+			{
+				if ( auto it = m_initialisers.find( variable );
+					it != m_initialisers.end() )
+				{
+					return it->second;
+				}
+
+				return getUndef( m_valueTypes.find( variable )->second );
+			}
+
+		private:
+			Module & m_module;
+			BlockList const & m_blocks;
+			ast::Map< spv::Id, spv::Id > const & m_valueTypes;
+			ast::Map< spv::Id, spv::Id > const & m_initialisers;
+			// The (block, predecessor) pairs, sorted by block.
+			ast::Vector< std::pair< size_t, size_t > > m_predecessors;
+			ast::Map< BlockVar, spv::Id > m_entryValues;
+
+		public:
+			// The last value stored to each variable in each block.
+			ast::Map< BlockVar, spv::Id > endValues;
+			// The removed values (loads and trivial phis), linked to the value replacing them.
+			ast::Map< spv::Id, spv::Id > replacements;
+			ast::Map< spv::Id, Phi > phis;
+			ast::Map< spv::Id, InstructionPtr > undefs;
+		};
+
+		/**
+		*	Copies \p instruction, with its operands allocated from \p allocator.
+		*\param[in] operands
+		*	If set, replaces the operands of \p instruction.
+		*/
+		static InstructionPtr cloneInstruction( NamesCache & nameCache
+			, ast::ShaderAllocatorBlock * allocator
+			, Instruction const & instruction
+			, IdList const * operands = nullptr )
+		{
+			if ( !operands )
+			{
+				operands = &instruction.operands;
+			}
+
+			Optional< ast::Map< int32_t, spv::Id > > labels;
+
+			if ( instruction.labels )
+			{
+				labels = ast::Map< int32_t, spv::Id >{ allocator };
+				labels->insert( instruction.labels->begin(), instruction.labels->end() );
+			}
+
+			auto toValueId = []( Optional< spv::Id > const & id )
+			{
+				return id
+					? Optional< ValueId >{ ValueId{ *id } }
+					: Optional< ValueId >{};
+			};
+			return std::make_unique< Instruction >( nameCache
+				, instruction.config
+				, spv::Op( instruction.op.getOpData().opCode )
+				, toValueId( instruction.returnTypeId )
+				, toValueId( instruction.resultId )
+				, IdList{ operands->begin(), operands->end(), ast::StlAllocatorT< spv::Id >{ allocator } }
+				, instruction.name
+				, std::move( labels ) );
+		}
+
+		static UInt32List makeKey( ast::ShaderAllocatorBlock * allocator
+			, Instruction const & instruction )
+		{
+			UInt32List result{ allocator };
+			Instruction::serialize( result, instruction );
+			return result;
+		}
+
+		static bool isDecoration( Instruction const & instruction )
+		{
+			auto op = spv::Op( instruction.op.getOpData().opCode );
+			return ( op == spv::OpDecorate || op == spv::OpMemberDecorate )
+				&& !instruction.operands.empty();
+		}
 	}
 
 	//*************************************************************************
@@ -116,6 +819,10 @@ namespace spirv
 			, ValueId{ spv::Id( addressingModel ) }
 			, ValueId{ spv::Id( pmemoryModel ) } );
 		m_version = spirvConfig.specVersion;
+		m_eliminateRedundantMemoryAccesses = spirvConfig.eliminateRedundantMemoryAccesses;
+		m_promoteLocalVariables = spirvConfig.promoteLocalVariables;
+		m_simplifyControlFlow = spirvConfig.simplifyControlFlow;
+		m_controlFlowStats = spirvConfig.controlFlowStats;
 		m_model = pexecutionModel;
 
 		doInitialiseHeader( Header{ spv::MagicNumber
@@ -534,6 +1241,18 @@ namespace spirv
 		return result;
 	}
 
+	void Module::decorateBufferMember( DebugId const & variableId
+		, uint32_t index
+		, spv::Decoration decoration )
+	{
+		auto typeIt = m_registeredVariablesTypes.find( variableId );
+
+		if ( typeIt != m_registeredVariablesTypes.end() )
+		{
+			decorateMember( typeIt->second, index, decoration );
+		}
+	}
+
 	VariableInfo Module::registerParam( std::string name
 		, bool isOutput
 		, ast::type::TypePtr type )
@@ -1235,12 +1954,546 @@ namespace spirv
 
 				m_currentFunction->debugStart.clear();
 			}
-		}
 
-		variables = &globalDeclarations;
-		m_currentScopeVariables = &m_registeredVariables;
-		m_currentFunction = nullptr;
-	}
+			if ( m_promoteLocalVariables )
+			{
+				doPromoteLocalVariables( *m_currentFunction );
+			}
+
+			if ( m_eliminateRedundantMemoryAccesses )
+			{
+				doEliminateDeadStores( *m_currentFunction );
+			}
+
+			if ( m_simplifyControlFlow )
+			{
+				doSimplifyControlFlow( *m_currentFunction );
+			}
+		}
+
+		variables = &globalDeclarations;
+		m_currentScopeVariables = &m_registeredVariables;
+		m_currentFunction = nullptr;
+	}
+
+	void Module::compactIds()
+	{
+		// All the instructions, in the module layout order.
+		ast::Vector< Instruction * > instructions{ allocator };
+		auto addInstructions = [&instructions]( InstructionList & list )
+		{
+			for ( auto & instruction : list )
+			{
+				instructions.push_back( instruction.get() );
+			}
+		};
+		addInstructions( imports );
+		instructions.push_back( memoryModel.get() );
+		instructions.push_back( entryPoint.get() );
+		addInstructions( executionModes );
+		addInstructions( m_debugNames.getStringsDeclarations() );
+		addInstructions( m_debugNames.getNamesDeclarations() );
+		addInstructions( decorations );
+		addInstructions( constantsTypes );
+		addInstructions( globalDeclarations );
+		addInstructions( m_nonSemanticDebug.getDeclarations() );
+
+		for ( auto & function : functions )
+		{
+			addInstructions( function.declaration );
+
+			for ( auto & block : function.cfg.blocks )
+			{
+				addInstructions( block.instructions );
+				instructions.push_back( block.blockEnd.get() );
+			}
+		}
+
+		if ( !std::all_of( instructions.begin()
+			, instructions.end()
+			, []( Instruction const * instruction )
+			{
+				return spvmodule::isLayoutKnown( *instruction );
+			} ) )
+		{
+			return;
+		}
+
+		// The defined ids get their new value in definition order,
+		// the ones only referenced (which should not happen) get theirs at the end.
+		ast::Map< spv::Id, spv::Id > ids{ allocator };
+		spv::Id nextId = 1u;
+
+		for ( auto instruction : instructions )
+		{
+			if ( spvmodule::definesResultId( *instruction )
+				&& ids.emplace( instruction->resultId.value(), nextId ).second )
+			{
+				++nextId;
+			}
+		}
+
+		auto remap = [&ids, &nextId]( spv::Id & id )
+		{
+			auto [it, added] = ids.emplace( id, nextId );
+
+			if ( added )
+			{
+				++nextId;
+			}
+
+			id = it->second;
+		};
+		auto remapDefined = [&ids]( spv::Id & id )
+		{
+			if ( auto it = ids.find( id );
+				it != ids.end() )
+			{
+				id = it->second;
+			}
+		};
+
+		for ( auto & import : imports )
+		{
+			if ( isExtNonSemanticDebugInfo( import->resultId.value() ) )
+			{
+				m_nonSemanticDebug.setExtID( ids[import->resultId.value()] );
+				break;
+			}
+		}
+
+		remapDefined( extGlslStd450.id );
+
+		for ( auto instruction : instructions )
+		{
+			spvmodule::forEachIdReference( *instruction, remap );
+
+			if ( spvmodule::definesResultId( *instruction ) )
+			{
+				remap( instruction->resultId.value() );
+			}
+		}
+
+		for ( auto & function : functions )
+		{
+			remapDefined( function.id.id.id );
+
+			for ( auto & block : function.cfg.blocks )
+			{
+				remapDefined( block.label );
+			}
+		}
+
+		m_types.remapIds( ids );
+		*m_currentId = nextId;
+	}
+
+	bool Module::canMergeFunctions( Module const & source
+		, spv::Id sharedIdsBound )const
+	{
+		if ( source.functions.size() != functions.size()
+			|| !source.getNonSemanticDebugDeclarations().empty()
+			|| !getNonSemanticDebugDeclarations().empty()
+			|| !source.entryPoint != !entryPoint )
+		{
+			return false;
+		}
+
+		auto isMergeable = [sharedIdsBound]( InstructionPtr const & instruction )
+		{
+			auto op = spv::Op( instruction->op.getOpData().opCode );
+
+			// The forward pointers and the imports can't be matched.
+			if ( ( op == spv::OpTypeForwardPointer || op == spv::OpExtInstImport )
+				&& instruction->resultId.value_or( 0u ) >= sharedIdsBound )
+			{
+				return false;
+			}
+
+			return spvmodule::isLayoutKnown( *instruction );
+		};
+		auto areMergeable = [&isMergeable]( InstructionList const & instructions )
+		{
+			return std::all_of( instructions.begin()
+				, instructions.end()
+				, isMergeable );
+		};
+
+		if ( !areMergeable( source.capabilities )
+			|| !areMergeable( source.extensions )
+			|| !areMergeable( source.imports )
+			|| !areMergeable( source.executionModes )
+			|| !areMergeable( source.getDebugNamesDeclarations() )
+			|| !areMergeable( source.decorations )
+			|| !areMergeable( source.constantsTypes )
+			|| !areMergeable( source.globalDeclarations )
+			|| ( source.entryPoint && !isMergeable( source.entryPoint ) ) )
+		{
+			return false;
+		}
+
+		return std::all_of( source.functions.begin()
+			, source.functions.end()
+			, [&areMergeable, &isMergeable]( Function const & function )
+			{
+				return areMergeable( function.declaration )
+					&& std::all_of( function.cfg.blocks.begin()
+						, function.cfg.blocks.end()
+						, [&areMergeable, &isMergeable]( Block const & block )
+						{
+							return areMergeable( block.instructions )
+								&& ( !block.blockEnd || isMergeable( block.blockEnd ) );
+						} );
+			} );
+	}
+
+	void Module::mergeFunctions( Module const & source
+		, spv::Id sharedIdsBound
+		, size_t first
+		, size_t last )
+	{
+		auto & nameCache = getNameCache();
+		// The ids of source from sharedIdsBound on, mapped to the ones of this module.
+		ast::Map< spv::Id, spv::Id > ids{ allocator };
+		// Maps the ids referenced by an instruction, tells if they were all mapped.
+		auto translate = [&ids, sharedIdsBound]( Instruction & instruction )
+		{
+			bool result{ true };
+			spvmodule::forEachIdReference( instruction
+				, [&ids, sharedIdsBound, &result]( spv::Id & id )
+				{
+					if ( id < sharedIdsBound )
+					{
+						return;
+					}
+
+					if ( auto it = ids.find( id );
+						it != ids.end() )
+					{
+						id = it->second;
+					}
+					else
+					{
+						result = false;
+					}
+				} );
+			return result;
+		};
+		// Maps the ids referenced and defined by an instruction, the unknown ones get a new id.
+		auto remap = [this, &ids, sharedIdsBound]( spv::Id & id )
+		{
+			if ( id >= sharedIdsBound )
+			{
+				auto [it, added] = ids.try_emplace( id, 0u );
+
+				if ( added )
+				{
+					it->second = getNextId();
+				}
+
+				id = it->second;
+			}
+		};
+		auto cloneRemapped = [this, &nameCache, &remap]( Instruction const & instruction )
+		{
+			auto result = spvmodule::cloneInstruction( nameCache, allocator, instruction );
+			spvmodule::forEachIdReference( *result, remap );
+
+			if ( spvmodule::definesResultId( *result ) )
+			{
+				remap( result->resultId.value() );
+			}
+
+			return result;
+		};
+		// Merges the instructions of source not already in destination.
+		auto mergeList = [this, &nameCache, &translate]( InstructionList const & sourceList
+			, InstructionList & destination )
+		{
+			std::set< UInt32List > known;
+
+			for ( auto & instruction : destination )
+			{
+				known.insert( spvmodule::makeKey( allocator, *instruction ) );
+			}
+
+			for ( auto & instruction : sourceList )
+			{
+				auto clone = spvmodule::cloneInstruction( nameCache, allocator, *instruction );
+
+				if ( translate( *clone )
+					&& known.insert( spvmodule::makeKey( allocator, *clone ) ).second )
+				{
+					destination.push_back( std::move( clone ) );
+				}
+			}
+		};
+		// The decorations of each id, without their target, to be part of the structural keys.
+		auto listDecorations = [this, &nameCache]( InstructionList const & list )
+		{
+			std::map< spv::Id, std::vector< UInt32List > > result;
+
+			for ( auto & instruction : list )
+			{
+				if ( spvmodule::isDecoration( *instruction ) )
+				{
+					auto clone = spvmodule::cloneInstruction( nameCache, allocator, *instruction );
+					auto target = clone->operands[0];
+					clone->operands[0] = 0u;
+					result[target].push_back( spvmodule::makeKey( allocator, *clone ) );
+				}
+			}
+
+			for ( auto & [target, keys] : result )
+			{
+				std::sort( keys.begin(), keys.end() );
+			}
+
+			return result;
+		};
+		// The key of a constant or type, from its instruction with its result id left out.
+		auto makeStructuralKey = [this]( Instruction const & instruction
+			, std::vector< UInt32List > const * targetDecorations )
+		{
+			auto result = spvmodule::makeKey( allocator, instruction );
+
+			if ( targetDecorations )
+			{
+				for ( auto & decoration : *targetDecorations )
+				{
+					result.push_back( ~0u );
+					result.insert( result.end(), decoration.begin(), decoration.end() );
+				}
+			}
+
+			return result;
+		};
+		auto findDecorations = []( std::map< spv::Id, std::vector< UInt32List > > const & idsDecorations
+			, spv::Id id )
+		{
+			auto it = idsDecorations.find( id );
+			return it == idsDecorations.end()
+				? nullptr
+				: &it->second;
+		};
+
+		// The functions, by declaration order.
+		for ( size_t index = 0u; index < functions.size(); ++index )
+		{
+			ids.try_emplace( source.functions[index].id.id.id, functions[index].id.id.id );
+		}
+
+		// The types registered with the same key.
+		IdSet unmatched{ allocator };
+		m_types.matchIds( source.m_types, sharedIdsBound, ids, unmatched );
+
+		// The other constants and types, by structure.
+		{
+			auto sourceDecorations = listDecorations( source.decorations );
+			auto destinationDecorations = listDecorations( decorations );
+			std::map< UInt32List, spv::Id > known;
+
+			for ( auto & instruction : constantsTypes )
+			{
+				if ( spvmodule::definesResultId( *instruction ) )
+				{
+					auto clone = spvmodule::cloneInstruction( nameCache, allocator, *instruction );
+					clone->resultId = 0u;
+					known.try_emplace( makeStructuralKey( *clone, findDecorations( destinationDecorations, *instruction->resultId ) )
+						, *instruction->resultId );
+				}
+			}
+
+			for ( auto & instruction : source.constantsTypes )
+			{
+				if ( !spvmodule::definesResultId( *instruction )
+					|| *instruction->resultId < sharedIdsBound
+					|| ids.find( *instruction->resultId ) != ids.end() )
+				{
+					continue;
+				}
+
+				auto sourceId = *instruction->resultId;
+				auto op = spv::Op( instruction->op.getOpData().opCode );
+				// Distinct aggregates can have the same structure.
+				bool isNew = unmatched.find( sourceId ) != unmatched.end()
+					&& ( op == spv::OpTypeStruct
+						|| op == spv::OpTypeArray
+						|| op == spv::OpTypeRuntimeArray );
+				auto clone = spvmodule::cloneInstruction( nameCache, allocator, *instruction );
+				clone->resultId = 0u;
+				Optional< UInt32List > key;
+
+				if ( !isNew
+					&& translate( *clone ) )
+				{
+					key = makeStructuralKey( *clone, findDecorations( sourceDecorations, sourceId ) );
+
+					if ( auto it = known.find( *key );
+						it != known.end() )
+					{
+						ids.try_emplace( sourceId, it->second );
+						continue;
+					}
+				}
+
+				auto & added = constantsTypes.emplace_back( cloneRemapped( *instruction ) );
+
+				if ( key )
+				{
+					known.try_emplace( std::move( *key ), *added->resultId );
+				}
+			}
+		}
+
+		// The global variables, by name.
+		{
+			std::map< spv::Id, decltype( m_registeredVariables )::value_type const * > sourceVariables;
+
+			for ( auto & variable : source.m_registeredVariables )
+			{
+				if ( variable.second.id.id.id >= sharedIdsBound )
+				{
+					sourceVariables.try_emplace( variable.second.id.id.id, &variable );
+				}
+			}
+
+			for ( auto & instruction : source.globalDeclarations )
+			{
+				if ( !spvmodule::definesResultId( *instruction )
+					|| *instruction->resultId < sharedIdsBound
+					|| ids.find( *instruction->resultId ) != ids.end() )
+				{
+					continue;
+				}
+
+				auto variable = sourceVariables.find( *instruction->resultId );
+
+				if ( variable != sourceVariables.end() )
+				{
+					if ( auto it = m_registeredVariables.find( variable->second->first );
+						it != m_registeredVariables.end() )
+					{
+						ids.try_emplace( *instruction->resultId, it->second.id.id.id );
+						continue;
+					}
+				}
+
+				auto & added = globalDeclarations.emplace_back( cloneRemapped( *instruction ) );
+
+				if ( variable != sourceVariables.end() )
+				{
+					auto info = variable->second->second;
+					info.id.id.id = *added->resultId;
+					m_registeredVariables.try_emplace( variable->second->first, std::move( info ) );
+				}
+			}
+		}
+
+		// The generated functions replace the declarations.
+		IdSet replaced{ allocator };
+
+		for ( auto index = first; index < last && index < functions.size(); ++index )
+		{
+			auto & function = functions[index];
+			auto & generated = source.functions[index];
+
+			for ( auto & instruction : function.declaration )
+			{
+				if ( spv::Op( instruction->op.getOpData().opCode ) == spv::OpFunctionParameter )
+				{
+					replaced.insert( *instruction->resultId );
+				}
+			}
+
+			function.declaration.clear();
+			function.cfg.blocks.clear();
+
+			for ( auto & instruction : generated.declaration )
+			{
+				function.declaration.push_back( cloneRemapped( *instruction ) );
+			}
+
+			for ( auto & block : generated.cfg.blocks )
+			{
+				auto label = block.label;
+				remap( label );
+				auto & added = function.cfg.blocks.emplace_back( allocator, label );
+
+				for ( auto & instruction : block.instructions )
+				{
+					added.instructions.push_back( cloneRemapped( *instruction ) );
+				}
+
+				if ( block.blockEnd )
+				{
+					added.blockEnd = cloneRemapped( *block.blockEnd );
+				}
+			}
+		}
+
+		if ( !replaced.empty() )
+		{
+			auto targetsReplaced = [&replaced]( InstructionPtr const & instruction )
+			{
+				auto op = spv::Op( instruction->op.getOpData().opCode );
+				return ( op == spv::OpName
+						&& replaced.find( *instruction->resultId ) != replaced.end() )
+					|| ( spvmodule::isDecoration( *instruction )
+						&& replaced.find( instruction->operands[0] ) != replaced.end() );
+			};
+			auto & names = m_debugNames.getNamesDeclarations();
+			names.erase( std::remove_if( names.begin(), names.end(), targetsReplaced )
+				, names.end() );
+			decorations.erase( std::remove_if( decorations.begin(), decorations.end(), targetsReplaced )
+				, decorations.end() );
+		}
+
+		// The module level instructions of source, targeting the mapped ids.
+		mergeList( source.capabilities, capabilities );
+		mergeList( source.extensions, extensions );
+		mergeList( source.executionModes, executionModes );
+		mergeList( source.decorations, decorations );
+		mergeList( source.getDebugNamesDeclarations(), m_debugNames.getNamesDeclarations() );
+
+		if ( entryPoint && source.entryPoint )
+		{
+			IdList interfaceIds{ entryPoint->operands };
+			auto size = interfaceIds.size();
+
+			for ( auto id : source.entryPoint->operands )
+			{
+				auto it = ids.find( id );
+
+				if ( id >= sharedIdsBound && it == ids.end() )
+				{
+					continue;
+				}
+
+				if ( id >= sharedIdsBound )
+				{
+					id = it->second;
+				}
+
+				if ( std::find( interfaceIds.begin(), interfaceIds.end(), id ) == interfaceIds.end() )
+				{
+					interfaceIds.push_back( id );
+				}
+			}
+
+			if ( interfaceIds.size() != size )
+			{
+				entryPoint = spvmodule::cloneInstruction( nameCache, allocator, *entryPoint, &interfaceIds );
+			}
+		}
+
+		m_types.adoptIds( source.m_types, ids );
+	}
+
+	void Module::detachTypes()
+	{
+		m_types.detachTypes();
+	}
 
 	spv::Id Module::getNextId()
 	{
@@ -1469,6 +2722,817 @@ namespace spirv
 		}
 	}
 
+	void Module::doPromoteLocalVariables( Function & function )
+	{
+		auto & blocks = function.cfg.blocks;
+		ast::Map< spv::Id, Instruction const * > types{ allocator };
+
+		for ( auto const & instruction : constantsTypes )
+		{
+			if ( instruction->resultId )
+			{
+				types.emplace( instruction->resultId.value(), instruction.get() );
+			}
+		}
+
+		auto getType = [&types]( spv::Id id )->Instruction const *
+		{
+			auto it = types.find( id );
+			return it == types.end()
+				? nullptr
+				: it->second;
+		};
+		// The promotable variables, linked to the type of their value.
+		ast::Map< spv::Id, spv::Id > valueTypes{ allocator };
+		ast::Map< spv::Id, spv::Id > initialisers{ allocator };
+
+		for ( auto const & instruction : blocks.front().instructions )
+		{
+			if ( instruction->op.getOpData().opCode != spv::OpVariable )
+			{
+				continue;
+			}
+
+			auto pointerType = getType( instruction->returnTypeId.value() );
+
+			if ( !pointerType
+				|| pointerType->op.getOpData().opCode != spv::OpTypePointer )
+			{
+				continue;
+			}
+
+			auto valueTypeId = pointerType->operands[1];
+
+			if ( auto valueType = getType( valueTypeId ) )
+			{
+				auto op = valueType->op.getOpData().opCode;
+
+				if ( op == spv::OpTypeBool
+					|| op == spv::OpTypeInt
+					|| op == spv::OpTypeFloat
+					|| op == spv::OpTypeVector )
+				{
+					valueTypes.emplace( instruction->resultId.value(), valueTypeId );
+
+					if ( instruction->operands.size() > 1u )
+					{
+						initialisers.emplace( instruction->resultId.value(), instruction->operands[1] );
+					}
+				}
+			}
+		}
+
+		// The decorated values must be kept.
+		ast::Set< spv::Id > decorated{ allocator };
+
+		for ( auto const & instruction : decorations )
+		{
+			if ( !instruction->operands.empty() )
+			{
+				decorated.insert( instruction->operands.front() );
+				valueTypes.erase( instruction->operands.front() );
+			}
+		}
+
+		// The variables used other than as the pointer of an OpLoad or an OpStore are address-taken.
+		auto checkUses = [&valueTypes]( Instruction const & instruction )
+		{
+			auto op = instruction.op.getOpData().opCode;
+
+			for ( size_t index = 0u; index < instruction.operands.size(); ++index )
+			{
+				if ( index != 0u
+					|| ( op != spv::OpLoad && op != spv::OpStore && op != spv::OpVariable ) )
+				{
+					valueTypes.erase( instruction.operands[index] );
+				}
+			}
+		};
+
+		for ( auto const & block : blocks )
+		{
+			for ( auto const & instruction : block.instructions )
+			{
+				checkUses( *instruction );
+			}
+
+			if ( block.blockEnd )
+			{
+				checkUses( *block.blockEnd );
+			}
+		}
+
+		if ( valueTypes.empty() )
+		{
+			return;
+		}
+
+		auto isPromotedAccess = [&valueTypes]( Instruction const & instruction )
+		{
+			auto op = instruction.op.getOpData().opCode;
+			return ( op == spv::OpLoad || op == spv::OpStore )
+				&& valueTypes.find( instruction.operands.front() ) != valueTypes.end();
+		};
+		spvmodule::SsaBuilder builder{ *this, blocks, valueTypes, initialisers };
+
+		// The values reaching the end of the blocks are needed before reading the blocks entries.
+		for ( size_t index = 0u; index < blocks.size(); ++index )
+		{
+			for ( auto const & instruction : blocks[index].instructions )
+			{
+				if ( instruction->op.getOpData().opCode == spv::OpStore
+					&& isPromotedAccess( *instruction ) )
+				{
+					builder.endValues.insert_or_assign( spvmodule::SsaBuilder::BlockVar{ index, instruction->operands[0] }
+						, instruction->operands[1] );
+				}
+			}
+		}
+
+		for ( size_t index = 0u; index < blocks.size(); ++index )
+		{
+			ast::Map< spv::Id, spv::Id > current{ allocator };
+
+			for ( auto const & instruction : blocks[index].instructions )
+			{
+				if ( !isPromotedAccess( *instruction ) )
+				{
+					continue;
+				}
+
+				auto variable = instruction->operands[0];
+
+				if ( instruction->op.getOpData().opCode == spv::OpStore )
+				{
+					current.insert_or_assign( variable, instruction->operands[1] );
+				}
+				else if ( auto it = current.find( variable );
+					it != current.end() )
+				{
+					builder.replacements.emplace( instruction->resultId.value(), it->second );
+				}
+				else
+				{
+					builder.replacements.emplace( instruction->resultId.value()
+						, builder.readEntry( variable, index ) );
+				}
+			}
+		}
+
+		builder.removeTrivialPhis();
+
+		// The loads used by instructions with unknown operands layout, or decorated, are kept as copies of their value.
+		ast::Set< spv::Id > copies{ allocator };
+
+		for ( auto id : decorated )
+		{
+			if ( builder.replacements.find( id ) != builder.replacements.end() )
+			{
+				copies.insert( id );
+			}
+		}
+
+		auto replaceOperands = [&builder, &copies]( Instruction & instruction )
+		{
+			auto op = spv::Op( instruction.op.getOpData().opCode );
+
+			for ( size_t index = 0u; index < instruction.operands.size(); ++index )
+			{
+				auto & operand = instruction.operands[index];
+				bool known{};
+
+				if ( spvmodule::isValueOperand( op, index, known ) )
+				{
+					operand = builder.resolve( operand );
+				}
+				else if ( !known
+					&& builder.replacements.find( operand ) != builder.replacements.end() )
+				{
+					copies.insert( operand );
+				}
+			}
+		};
+
+		for ( auto & block : blocks )
+		{
+			for ( auto & instruction : block.instructions )
+			{
+				if ( !isPromotedAccess( *instruction ) )
+				{
+					replaceOperands( *instruction );
+				}
+				else if ( instruction->op.getOpData().opCode == spv::OpStore )
+				{
+					instruction->operands[1] = builder.resolve( instruction->operands[1] );
+				}
+			}
+
+			if ( block.blockEnd )
+			{
+				replaceOperands( *block.blockEnd );
+			}
+		}
+
+		for ( auto & [id, phi] : builder.phis )
+		{
+			replaceOperands( *phi.instruction );
+		}
+
+		ast::Set< spv::Id > removed{ allocator };
+
+		for ( auto & block : blocks )
+		{
+			auto it = std::remove_if( block.instructions.begin()
+				, block.instructions.end()
+				, [&valueTypes, &copies, &removed, &isPromotedAccess]( InstructionPtr const & instruction )
+				{
+					if ( instruction->op.getOpData().opCode == spv::OpVariable )
+					{
+						return valueTypes.find( instruction->resultId.value() ) != valueTypes.end()
+							&& removed.insert( instruction->resultId.value() ).second;
+					}
+
+					return isPromotedAccess( *instruction )
+						&& ( !instruction->resultId
+							|| ( copies.find( instruction->resultId.value() ) == copies.end()
+								&& removed.insert( instruction->resultId.value() ).second ) );
+				} );
+			block.instructions.erase( it, block.instructions.end() );
+
+			for ( auto & instruction : block.instructions )
+			{
+				if ( isPromotedAccess( *instruction ) )
+				{
+					auto id = instruction->resultId.value();
+					instruction = makeInstruction< CopyObjectInstruction >( getNameCache()
+						, ValueId{ instruction->returnTypeId.value() }
+						, ValueId{ id }
+						, ValueId{ builder.resolve( id ) } );
+				}
+			}
+		}
+
+		// Inserted in reverse order, to keep the phis of a block sorted by id.
+		for ( auto it = builder.phis.rbegin(); it != builder.phis.rend(); ++it )
+		{
+			auto & instructions = blocks[it->second.block].instructions;
+			instructions.emplace( instructions.begin() + 1u, std::move( it->second.instruction ) );
+		}
+
+		if ( !builder.undefs.empty() )
+		{
+			auto & instructions = blocks.front().instructions;
+			auto it = std::find_if( std::next( instructions.begin() )
+				, instructions.end()
+				, []( InstructionPtr const & instruction )
+				{
+					return instruction->op.getOpData().opCode != spv::OpVariable;
+				} );
+
+			for ( auto & [type, undef] : builder.undefs )
+			{
+				it = std::next( instructions.emplace( it, std::move( undef ) ) );
+			}
+		}
+
+		auto & names = m_debugNames.getNamesDeclarations();
+		auto it = std::remove_if( names.begin()
+			, names.end()
+			, [&removed]( InstructionPtr const & instruction )
+			{
+				return instruction->op.getOpData().opCode == spv::OpName
+					&& removed.find( instruction->resultId.value() ) != removed.end();
+			} );
+		names.erase( it, names.end() );
+	}
+
+	void Module::doEliminateDeadStores( Function & function )
+	{
+		auto isPointerDerivation = []( spv::Op op )
+		{
+			return op == spv::OpAccessChain
+				|| op == spv::OpInBoundsAccessChain
+				|| op == spv::OpPtrAccessChain
+				|| op == spv::OpInBoundsPtrAccessChain
+				|| op == spv::OpCopyObject;
+		};
+		// The invocation private variables, and the pointers derived from them, linked to their variable.
+		ast::Map< spv::Id, spv::Id > roots{ allocator };
+		// The Function variables, only visible from this function.
+		ast::Set< spv::Id > locals{ allocator };
+		// The variables read from, or passed to a call, in the function.
+		ast::Set< spv::Id > used{ allocator };
+
+		for ( auto const & instruction : globalDeclarations )
+		{
+			if ( instruction->op.getOpData().opCode == spv::OpVariable
+				&& instruction->operands.front() == spv::Id( spv::StorageClassPrivate ) )
+			{
+				roots.emplace( instruction->resultId.value(), instruction->resultId.value() );
+			}
+		}
+
+		// Blocks are laid out in dominance order, a pointer is always derived before being used.
+		for ( auto const & block : function.cfg.blocks )
+		{
+			for ( auto const & instruction : block.instructions )
+			{
+				auto op = spv::Op( instruction->op.getOpData().opCode );
+
+				if ( op == spv::OpVariable )
+				{
+					roots.emplace( instruction->resultId.value(), instruction->resultId.value() );
+					locals.insert( instruction->resultId.value() );
+				}
+				else if ( isPointerDerivation( op ) )
+				{
+					if ( auto it = roots.find( instruction->operands.front() );
+						it != roots.end() )
+					{
+						roots.emplace( instruction->resultId.value(), it->second );
+					}
+				}
+			}
+		}
+
+		if ( roots.empty() )
+		{
+			return;
+		}
+
+		ast::Set< Instruction const * > deadStores{ allocator };
+		// The last store to each pointer, not read yet.
+		ast::Map< spv::Id, Instruction const * > pendingStores{ allocator };
+		auto readVariable = [&roots, &used, &pendingStores]( spv::Id id )
+		{
+			auto rootIt = roots.find( id );
+
+			if ( rootIt == roots.end() )
+			{
+				return;
+			}
+
+			// Any pointer derived from the variable may alias the read one.
+			used.insert( rootIt->second );
+			auto it = pendingStores.begin();
+
+			while ( it != pendingStores.end() )
+			{
+				if ( roots.find( it->first )->second == rootIt->second )
+				{
+					it = pendingStores.erase( it );
+				}
+				else
+				{
+					++it;
+				}
+			}
+		};
+
+		for ( auto const & block : function.cfg.blocks )
+		{
+			pendingStores.clear();
+
+			for ( auto const & instruction : block.instructions )
+			{
+				auto op = spv::Op( instruction->op.getOpData().opCode );
+
+				if ( op == spv::OpStore
+					&& roots.find( instruction->operands.front() ) != roots.end() )
+				{
+					std::for_each( std::next( instruction->operands.begin() ), instruction->operands.end(), readVariable );
+					auto [it, res] = pendingStores.try_emplace( instruction->operands.front(), instruction.get() );
+
+					if ( !res )
+					{
+						// Overwritten before being read.
+						deadStores.insert( it->second );
+						it->second = instruction.get();
+					}
+				}
+				else if ( isPointerDerivation( op )
+					&& op != spv::OpCopyObject )
+				{
+					// Deriving a pointer doesn't access the memory, only the indices are read.
+					std::for_each( std::next( instruction->operands.begin() ), instruction->operands.end(), readVariable );
+				}
+				else
+				{
+					if ( op == spv::OpFunctionCall )
+					{
+						// The called function can read the Private variables.
+						auto it = pendingStores.begin();
+
+						while ( it != pendingStores.end() )
+						{
+							if ( locals.find( roots.find( it->first )->second ) == locals.end() )
+							{
+								it = pendingStores.erase( it );
+							}
+							else
+							{
+								++it;
+							}
+						}
+					}
+
+					std::for_each( instruction->operands.begin(), instruction->operands.end(), readVariable );
+				}
+			}
+
+			if ( block.blockEnd )
+			{
+				std::for_each( block.blockEnd->operands.begin(), block.blockEnd->operands.end(), readVariable );
+			}
+		}
+
+		for ( auto & block : function.cfg.blocks )
+		{
+			auto it = std::remove_if( block.instructions.begin()
+				, block.instructions.end()
+				, [&roots, &locals, &used, &deadStores]( InstructionPtr const & instruction )
+				{
+					if ( instruction->op.getOpData().opCode != spv::OpStore )
+					{
+						return false;
+					}
+
+					if ( deadStores.find( instruction.get() ) != deadStores.end() )
+					{
+						return true;
+					}
+
+					// The stores to a Function variable that is never read are removed too.
+					auto rootIt = roots.find( instruction->operands.front() );
+					return rootIt != roots.end()
+						&& locals.find( rootIt->second ) != locals.end()
+						&& used.find( rootIt->second ) == used.end();
+				} );
+			block.instructions.erase( it, block.instructions.end() );
+		}
+	}
+
+	void Module::doSimplifyControlFlow( Function & function )
+	{
+		auto & blocks = function.cfg.blocks;
+		auto blocksBefore = uint32_t( blocks.size() );
+
+		if ( blocks.empty()
+			|| std::any_of( blocks.begin(), blocks.end(), []( Block const & block ){ return !block.blockEnd; } )
+			|| blocks.back().blockEnd->op.getOpData().opCode != spv::OpFunctionEnd )
+		{
+			if ( m_controlFlowStats )
+			{
+				m_controlFlowStats->blocksBefore += blocksBefore;
+				m_controlFlowStats->blocksAfter += blocksBefore;
+			}
+
+			return;
+		}
+
+		// During the pass, the function terminator is the blockEnd of the last block, like for the other ones.
+		auto functionEnd = std::move( blocks.back().blockEnd );
+		blocks.back().blockEnd = std::move( blocks.back().instructions.back() );
+		blocks.back().instructions.pop_back();
+
+		auto findBlock = [&blocks]( spv::Id label )
+		{
+			return size_t( std::distance( blocks.begin()
+				, std::find_if( blocks.begin()
+					, blocks.end()
+					, [label]( Block const & block )
+					{
+						return block.label == label;
+					} ) ) );
+		};
+		auto replaceLabel = []( Instruction & instruction
+			, spv::Id oldLabel
+			, spv::Id newLabel )
+		{
+			spvmodule::forEachLabel( instruction
+				, [oldLabel, newLabel]( spv::Id & label )
+				{
+					if ( label == oldLabel )
+					{
+						label = newLabel;
+					}
+				} );
+		};
+		// Merges the block targeted by the unconditional branch of the block at given index, if it has no other predecessor.
+		auto mergeNext = [&]( size_t index
+			, ast::Set< spv::Id > const & structured
+			, ast::Map< spv::Id, uint32_t > const & predecessors )
+		{
+			auto & source = blocks[index];
+
+			if ( source.blockEnd->op.getOpData().opCode != spv::OpBranch
+				|| spvmodule::getMergeInstruction( source ) )
+			{
+				return false;
+			}
+
+			auto label = source.blockEnd->operands[0];
+			auto targetIndex = findBlock( label );
+
+			if ( targetIndex == 0u
+				|| targetIndex == index
+				|| targetIndex == blocks.size()
+				|| predecessors.find( label )->second != 1u
+				|| structured.find( label ) != structured.end()
+				|| spvmodule::hasInstruction( blocks[targetIndex], spv::OpPhi ) )
+			{
+				return false;
+			}
+
+			auto & target = blocks[targetIndex];
+			std::move( std::next( target.instructions.begin() )
+				, target.instructions.end()
+				, std::back_inserter( source.instructions ) );
+			source.blockEnd = std::move( target.blockEnd );
+			auto sourceLabel = source.label;
+			blocks.erase( std::next( blocks.begin(), ptrdiff_t( targetIndex ) ) );
+
+			// The phis of the successors now see the merged block.
+			for ( auto & block : blocks )
+			{
+				for ( auto & instruction : block.instructions )
+				{
+					if ( instruction->op.getOpData().opCode == spv::OpPhi )
+					{
+						replaceLabel( *instruction, label, sourceLabel );
+					}
+				}
+			}
+
+			return true;
+		};
+		// Removes the block at given index if it only branches to another block, its predecessors then branch directly to this block.
+		auto removeEmpty = [&]( size_t index
+			, ast::Set< spv::Id > const & structured )
+		{
+			auto & block = blocks[index];
+
+			if ( index == 0u
+				|| block.instructions.size() != 1u
+				|| block.blockEnd->op.getOpData().opCode != spv::OpBranch
+				|| structured.find( block.label ) != structured.end() )
+			{
+				return false;
+			}
+
+			auto label = block.label;
+			auto target = block.blockEnd->operands[0];
+			auto targetIndex = findBlock( target );
+
+			if ( target == label
+				|| targetIndex == blocks.size() )
+			{
+				return false;
+			}
+
+			// The phis of the target can only be updated if the removed block has a single predecessor,
+			// not already branching to the target.
+			auto hasPhis = spvmodule::hasInstruction( blocks[targetIndex], spv::OpPhi );
+			spv::Id phiParent{};
+
+			for ( auto & predecessor : blocks )
+			{
+				auto & terminator = *predecessor.blockEnd;
+				auto op = terminator.op.getOpData().opCode;
+				bool isPredecessor = false;
+				bool isTargetPredecessor = false;
+				spvmodule::forEachLabel( terminator
+					, [&isPredecessor, &isTargetPredecessor, label, target]( spv::Id const & lookup )
+					{
+						isPredecessor = isPredecessor || lookup == label;
+						isTargetPredecessor = isTargetPredecessor || lookup == target;
+					} );
+
+				if ( hasPhis
+					&& isPredecessor
+					&& ( phiParent || isTargetPredecessor ) )
+				{
+					return false;
+				}
+
+				if ( isPredecessor )
+				{
+					phiParent = predecessor.label;
+				}
+
+				if ( op == spv::OpBranchConditional
+					&& ( terminator.operands[1] == label || terminator.operands[2] == label ) )
+				{
+					// The branch would target the same block twice.
+					if ( terminator.operands[1] == target || terminator.operands[2] == target )
+					{
+						return false;
+					}
+
+					// A header can only branch to a merge block or continue target when it is its own selection merge block.
+					if ( auto merge = spvmodule::getMergeInstruction( predecessor );
+						merge
+						&& structured.find( target ) != structured.end()
+						&& ( merge->op.getOpData().opCode != spv::OpSelectionMerge || merge->operands[0] != target ) )
+					{
+						return false;
+					}
+				}
+				else if ( op == spv::OpBranch
+					&& terminator.operands[0] == label )
+				{
+					if ( spvmodule::getMergeInstruction( predecessor )
+						&& structured.find( target ) != structured.end() )
+					{
+						return false;
+					}
+				}
+				else if ( op == spv::OpSwitch
+					&& isPredecessor )
+				{
+					// The case blocks are kept, to preserve the case constructs.
+					return false;
+				}
+			}
+
+			if ( hasPhis
+				&& !phiParent )
+			{
+				return false;
+			}
+
+			for ( auto & predecessor : blocks )
+			{
+				replaceLabel( *predecessor.blockEnd, label, target );
+			}
+
+			for ( auto & instruction : blocks[targetIndex].instructions )
+			{
+				if ( instruction->op.getOpData().opCode == spv::OpPhi )
+				{
+					replaceLabel( *instruction, label, phiParent );
+				}
+			}
+
+			blocks.erase( std::next( blocks.begin(), ptrdiff_t( index ) ) );
+			return true;
+		};
+		// Folds the selection headed by the block at given index when its branches reach its merge block without doing anything,
+		// the header then branches to its merge block directly.
+		auto foldEmptySelection = [&]( size_t index
+			, ast::Set< spv::Id > const & structured
+			, ast::Map< spv::Id, uint32_t > const & predecessors )
+		{
+			auto & headerBlock = blocks[index];
+			auto merge = spvmodule::getMergeInstruction( headerBlock );
+
+			if ( !merge
+				|| merge->op.getOpData().opCode != spv::OpSelectionMerge
+				|| headerBlock.blockEnd->op.getOpData().opCode != spv::OpBranchConditional )
+			{
+				return false;
+			}
+
+			auto mergeLabel = merge->operands[0];
+			auto mergeIndex = findBlock( mergeLabel );
+
+			if ( mergeIndex == blocks.size()
+				|| spvmodule::hasInstruction( blocks[mergeIndex], spv::OpPhi ) )
+			{
+				return false;
+			}
+
+			// The targets other than the merge block must be empty blocks, only reached from the header, and branching to the merge block.
+			ast::Vector< spv::Id > empties{ allocator };
+
+			for ( auto target : { headerBlock.blockEnd->operands[1], headerBlock.blockEnd->operands[2] } )
+			{
+				if ( target == mergeLabel )
+				{
+					continue;
+				}
+
+				auto targetIndex = findBlock( target );
+
+				if ( targetIndex == blocks.size()
+					|| blocks[targetIndex].instructions.size() != 1u
+					|| blocks[targetIndex].blockEnd->op.getOpData().opCode != spv::OpBranch
+					|| blocks[targetIndex].blockEnd->operands[0] != mergeLabel
+					|| predecessors.find( target )->second != 1u
+					|| structured.find( target ) != structured.end() )
+				{
+					return false;
+				}
+
+				empties.push_back( target );
+			}
+
+			headerBlock.instructions.erase( std::find_if( headerBlock.instructions.begin()
+				, headerBlock.instructions.end()
+				, [merge]( InstructionPtr const & instruction )
+				{
+					return instruction.get() == merge;
+				} ) );
+			headerBlock.blockEnd = makeInstruction< BranchInstruction >( getNameCache(), ValueId{ mergeLabel } );
+
+			for ( auto label : empties )
+			{
+				blocks.erase( std::next( blocks.begin(), ptrdiff_t( findBlock( label ) ) ) );
+			}
+
+			return true;
+		};
+
+		bool changed = true;
+
+		while ( changed )
+		{
+			changed = false;
+			// The merge blocks and continue targets, they must be kept.
+			ast::Set< spv::Id > structured{ allocator };
+			// The count of branches to each block.
+			ast::Map< spv::Id, uint32_t > predecessors{ allocator };
+
+			for ( auto & block : blocks )
+			{
+				if ( auto merge = spvmodule::getMergeInstruction( block ) )
+				{
+					spvmodule::forEachLabel( *merge
+						, [&structured]( spv::Id const & label )
+						{
+							structured.insert( label );
+						} );
+				}
+
+				spvmodule::forEachLabel( *block.blockEnd
+					, [&predecessors]( spv::Id const & label )
+					{
+						++predecessors[label];
+					} );
+			}
+
+			for ( size_t index = 0u; index < blocks.size() && !changed; ++index )
+			{
+				changed = mergeNext( index, structured, predecessors )
+					|| removeEmpty( index, structured )
+					|| foldEmptySelection( index, structured, predecessors );
+			}
+		}
+
+		// Renumbers the remaining blocks, their labels are then sorted in layout order.
+		ast::Vector< spv::Id > labels{ allocator };
+
+		for ( auto & block : blocks )
+		{
+			labels.push_back( block.label );
+		}
+
+		std::sort( labels.begin(), labels.end() );
+		ast::Map< spv::Id, spv::Id > renumbered{ allocator };
+
+		for ( size_t index = 0u; index < blocks.size(); ++index )
+		{
+			if ( blocks[index].label != labels[index] )
+			{
+				renumbered.emplace( blocks[index].label, labels[index] );
+			}
+		}
+
+		if ( !renumbered.empty() )
+		{
+			auto renumber = [&renumbered]( spv::Id & label )
+			{
+				if ( auto it = renumbered.find( label );
+					it != renumbered.end() )
+				{
+					label = it->second;
+				}
+			};
+
+			for ( auto & block : blocks )
+			{
+				renumber( block.label );
+				block.instructions.front()->resultId = block.label;
+
+				for ( auto & instruction : block.instructions )
+				{
+					spvmodule::forEachLabel( *instruction, renumber );
+				}
+
+				spvmodule::forEachLabel( *block.blockEnd, renumber );
+			}
+		}
+
+		blocks.back().instructions.push_back( std::move( blocks.back().blockEnd ) );
+		blocks.back().blockEnd = std::move( functionEnd );
+
+		if ( m_controlFlowStats )
+		{
+			m_controlFlowStats->blocksBefore += blocksBefore;
+			m_controlFlowStats->blocksAfter += uint32_t( blocks.size() );
+		}
+	}
+
 	void Module::doAddDebug( std::string const & name
 		, DebugId const & id )
 	{
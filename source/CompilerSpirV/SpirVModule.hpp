@@ -80,6 +80,11 @@ namespace spirv
 			return m_version;
 		}
 
+		bool isEliminatingRedundantMemoryAccesses()const
+		{
+			return m_eliminateRedundantMemoryAccesses;
+		}
+
 		SDWSPIRV_API static Module deserialize( ast::ShaderAllocatorBlock * allocator
 			, ast::type::TypesCache & typesCache
 			, NameCache & names
@@ -201,6 +206,9 @@ namespace spirv
 			, uint32_t bindingPoint
 			, uint32_t descriptorSet
 			, spv::Decoration structDecoration );// BufferBlock for SSBO, Block for UBO
+		SDWSPIRV_API void decorateBufferMember( DebugId const & variableId
+			, uint32_t index
+			, spv::Decoration decoration );// Decorates the member of the block type of a buffer variable
 
 		SDWSPIRV_API Function * beginFunction( std::string name
 			, TypeId retType
@@ -210,6 +218,38 @@ namespace spirv
 			, glsl::Statement const * firstLineStatement );
 		SDWSPIRV_API Block newBlock();
 		SDWSPIRV_API void endFunction();
+		/**
+		*	Renumbers the ids of the complete module, densely and in their definition order,
+		*	and updates the ids bound.
+		*	The module is left unchanged if it holds an instruction with an unknown operands layout.
+		*/
+		SDWSPIRV_API void compactIds();
+		/**
+		*	Tells if the functions generated in \p source can be merged in this module, see mergeFunctions.
+		*/
+		SDWSPIRV_API bool canMergeFunctions( Module const & source
+			, spv::Id sharedIdsBound )const;
+		/**
+		*	Replaces the functions in [\p first, \p last), only declared in this module, with their bodies generated in \p source,
+		*	and adds the types, constants, global variables, decorations and names they need.
+		*	Both modules are generated from the same statements, and are identical until the ids bound \p sharedIdsBound.
+		*	The other ids of \p source are matched by function order, type registration key, variable name,
+		*	or by structure for the other types and constants, the ones left get new ids.
+		*/
+		SDWSPIRV_API void mergeFunctions( Module const & source
+			, spv::Id sharedIdsBound
+			, size_t first
+			, size_t last );
+		/**
+		*	Forgets the types registered by their shader type, so that the module can be kept longer than the shader's types cache.
+		*	Its types are then merged by structure only.
+		*/
+		SDWSPIRV_API void detachTypes();
+
+		spv::Id getIdsBound()const noexcept
+		{
+			return *m_currentId;
+		}
 
 		SDWSPIRV_API spv::Id getNextId();
 
@@ -287,6 +327,9 @@ namespace spirv
 		void doInitialiseExtensions( bool enableDebug
 			, glsl::Statements const & debugStatements );
 		void doInitialiseCapacities();
+		void doPromoteLocalVariables( Function & function );
+		void doEliminateDeadStores( Function & function );
+		void doSimplifyControlFlow( Function & function );
 		void doAddDebug( std::string const & name
 			, DebugId const & id );
 		void doAddBuiltin( ast::Builtin builtin
@@ -311,6 +354,10 @@ namespace spirv
 
 	private:
 		uint32_t m_version{};
+		bool m_eliminateRedundantMemoryAccesses{};
+		bool m_promoteLocalVariables{};
+		bool m_simplifyControlFlow{};
+		ControlFlowStats * m_controlFlowStats{};
 		spv::Id * m_currentId{};
 		Function * m_currentFunction{ nullptr };
 		ast::Map< std::string, VariableInfo, std::less<> > m_registeredVariables;
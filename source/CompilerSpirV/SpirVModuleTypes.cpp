@@ -20,6 +20,7 @@ namespace spirv
 		static ast::type::StructPtr getUnqualifiedType( ast::type::TypesCache & typesCache
 			, ast::type::Struct const & qualified )
 		{
+			auto lock = typesCache.lock();
 			auto result = typesCache.getStruct( qualified.getMemoryLayout(), qualified.getName() );
 			assert( result->empty() || ( result->size() == qualified.size() ) );
 
@@ -343,6 +344,100 @@ namespace spirv
 		return nullptr;
 	}
 
+	void ModuleTypes::remapIds( ast::Map< spv::Id, spv::Id > const & ids )
+	{
+		auto remap = [&ids]( TypeId & typeId )
+		{
+			if ( auto it = ids.find( typeId.id.id );
+				it != ids.end() )
+			{
+				typeId.id.id = it->second;
+			}
+		};
+
+		for ( auto & [key, typeId] : m_registeredTypes )
+		{
+			remap( typeId );
+		}
+
+		for ( auto & [key, typeId] : m_registeredImageTypes )
+		{
+			remap( typeId );
+		}
+
+		for ( auto & [key, typeId] : m_registeredPointerTypes )
+		{
+			remap( typeId );
+		}
+
+		for ( auto & [key, typeId] : m_registeredForwardPointerTypes )
+		{
+			remap( typeId );
+		}
+
+		for ( auto & [key, typeId] : m_registeredFunctionTypes )
+		{
+			remap( typeId );
+		}
+	}
+
+	void ModuleTypes::matchIds( ModuleTypes const & source
+		, spv::Id sharedIdsBound
+		, ast::Map< spv::Id, spv::Id > & ids
+		, IdSet & unmatched )const
+	{
+		auto match = [sharedIdsBound, &ids, &unmatched]( auto const & lhs
+			, auto const & rhs )
+		{
+			for ( auto & [key, typeId] : rhs )
+			{
+				if ( typeId.id.id < sharedIdsBound )
+				{
+					continue;
+				}
+
+				if ( auto it = lhs.find( key );
+					it != lhs.end() )
+				{
+					ids.try_emplace( typeId.id.id, it->second.id.id );
+				}
+				else
+				{
+					unmatched.insert( typeId.id.id );
+				}
+			}
+		};
+		match( m_registeredTypes, source.m_registeredTypes );
+		match( m_registeredImageTypes, source.m_registeredImageTypes );
+	}
+
+	void ModuleTypes::adoptIds( ModuleTypes const & source
+		, ast::Map< spv::Id, spv::Id > const & ids )
+	{
+		auto adopt = [&ids]( auto & lhs
+			, auto const & rhs )
+		{
+			for ( auto & [key, typeId] : rhs )
+			{
+				if ( auto it = ids.find( typeId.id.id );
+					it != ids.end() )
+				{
+					auto adopted = typeId;
+					adopted.id.id = it->second;
+					lhs.try_emplace( key, adopted );
+				}
+			}
+		};
+		adopt( m_registeredTypes, source.m_registeredTypes );
+		adopt( m_registeredImageTypes, source.m_registeredImageTypes );
+	}
+
+	void ModuleTypes::detachTypes()
+	{
+		m_registeredTypes.clear();
+		m_registeredImageTypes.clear();
+	}
+
 	void ModuleTypes::deserialize( spv::Op opCode
 		, Instruction const & instruction
 		, NameCache const & names )
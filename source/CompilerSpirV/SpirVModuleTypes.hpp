@@ -54,6 +54,19 @@ namespace spirv
 			, Block & currentBlock );
 
 		ast::type::TypePtr getType( DebugId const & typeId )const;
+		// Updates the registered types ids, after the module ids renumbering.
+		void remapIds( ast::Map< spv::Id, spv::Id > const & ids );
+		// Maps the ids of the types \p source registered from \p sharedIdsBound on, to the ones registered here with the same key.
+		// \p unmatched receives the ids of the ones not registered here.
+		void matchIds( ModuleTypes const & source
+			, spv::Id sharedIdsBound
+			, ast::Map< spv::Id, spv::Id > & ids
+			, IdSet & unmatched )const;
+		// Registers the types only registered by \p source, with their ids mapped through \p ids.
+		void adoptIds( ModuleTypes const & source
+			, ast::Map< spv::Id, spv::Id > const & ids );
+		// Forgets the registrations keyed by the shader types, their types cache may not outlive the module.
+		void detachTypes();
 
 		void deserialize( spv::Op opCode
 			, Instruction const & instruction
@@ -13,113 +13,223 @@ See LICENSE file in root folder
 #include <GlslCommon/GlslFillConfig.hpp>
 
 #include <ShaderAST/Shader.hpp>
+#include <ShaderAST/Visitors/FunctionHashes.hpp>
 #include <ShaderAST/Visitors/ResolveConstants.hpp>
 #include <ShaderAST/Visitors/SimplifyStatements.hpp>
+#include <ShaderAST/Visitors/SpecialiseStatements.hpp>
 #include <ShaderAST/Visitors/TransformSSA.hpp>
 
 #include <iostream>
 
 namespace spirv
 {
-	void ModuleDeleter::operator()( Module * shaderModule )
+	namespace
 	{
-		delete shaderModule;
-	}
-
-	ModulePtr compileSpirV( ast::ShaderAllocatorBlock & allocator
-		, ast::Shader const & shader
-		, ast::stmt::Container const * stmt
-		, ast::ShaderStage stage
-		, SpirVConfig & spirvConfig )
-	{
-		ast::SSAData ssaData;
-		auto & typesCache = shader.getTypesCache();
-		ssaData.nextVarId = shader.getData().nextVarId;
-		ast::stmt::StmtCache compileStmtCache{ allocator };
-		ast::expr::ExprCache compileExprCache{ allocator };
-		auto statements = ast::transformSSA( compileStmtCache
-			, compileExprCache
-			, typesCache
-			, *stmt
-			, ssaData
-			, true );
-		statements = ast::simplify( compileStmtCache
-			, compileExprCache
-			, typesCache
-			, *statements );
-		statements = ast::resolveConstants( compileStmtCache
-			, compileExprCache
-			, typesCache
-			, *statements );
-		ModuleConfig moduleConfig{ &allocator
-			, spirvConfig
-			, typesCache
-			, stage
-			, ssaData.nextVarId
-			, ssaData.aliasId };
-		spirv::fillConfig( *statements
-			, moduleConfig );
-		spirv::PreprocContext context;
-		AdaptationData adaptationData{ &allocator, context, std::move( moduleConfig ) };
-		statements = spirv::adaptStatements( compileStmtCache
-			, compileExprCache
-			, typesCache
-			, *statements
-			, adaptationData );
-		// Simplify again, since adaptation can introduce complexity
-		statements = ast::simplify( compileStmtCache
-			, compileExprCache
-			, typesCache
-			, *statements );
-		auto actions = listActions( *statements );
-		glsl::Statements debug;
-		glsl::StmtConfig stmtConfig;
+		// The shader statements, transformed and adapted for the module generation.
+		struct AdaptedShader
+		{
+			ast::stmt::ContainerPtr statements;
+			ModuleConfig config;
+			ShaderActions actions;
+		};
 
-		if ( spirvConfig.debugLevel == DebugLevel::eDebugInfo )
+		AdaptedShader adaptShader( ast::ShaderAllocatorBlock & allocator
+			, ast::stmt::StmtCache & compileStmtCache
+			, ast::expr::ExprCache & compileExprCache
+			, ast::Shader const & shader
+			, ast::stmt::Container const * stmt
+			, ast::ShaderStage stage
+			, SpirVConfig & spirvConfig
+			, spirv::PreprocContext & context )
 		{
-			auto intrinsicsConfig = glsl::fillConfig( stage
+			ast::SSAData ssaData;
+			auto & typesCache = shader.getTypesCache();
+			ssaData.nextVarId = shader.getData().nextVarId;
+			auto statements = ast::transformSSA( compileStmtCache
+				, compileExprCache
+				, typesCache
+				, *stmt
+				, ssaData
+				, true );
+			statements = ast::simplify( compileStmtCache
+				, compileExprCache
+				, typesCache
 				, *statements );
 
-			if ( intrinsicsConfig.requiresInt8 )
+			if ( spirvConfig.specialisation )
 			{
-				intrinsicsConfig.requiredExtensions.insert( glsl::EXT_shader_explicit_arithmetic_types_int8 );
+				statements = ast::specialiseStatements( compileStmtCache
+					, compileExprCache
+					, typesCache
+					, *statements
+					, *spirvConfig.specialisation );
 			}
 
-			if ( intrinsicsConfig.requiresInt16 )
+			// Also folds the baked specialisation constants, and removes the dead branches.
+			statements = ast::resolveConstants( compileStmtCache
+				, compileExprCache
+				, typesCache
+				, *statements );
+			statements = ast::optimiseStatements( compileStmtCache
+				, compileExprCache
+				, typesCache
+				, std::move( statements )
+				, ssaData
+				, true
+				, spirvConfig.optimisations );
+			ModuleConfig moduleConfig{ &allocator
+				, spirvConfig
+				, typesCache
+				, stage
+				, ssaData.nextVarId
+				, ssaData.aliasId };
+			spirv::fillConfig( *statements
+				, moduleConfig );
+			AdaptationData adaptationData{ &allocator, context, std::move( moduleConfig ) };
+			statements = spirv::adaptStatements( compileStmtCache
+				, compileExprCache
+				, typesCache
+				, *statements
+				, adaptationData );
+			// Simplify again, since adaptation can introduce complexity
+			statements = ast::simplify( compileStmtCache
+				, compileExprCache
+				, typesCache
+				, *statements );
+			auto actions = listActions( *statements );
+			return { std::move( statements )
+				, std::move( adaptationData.config )
+				, std::move( actions ) };
+		}
+
+		ModulePtr generateShaderModule( ast::expr::ExprCache & compileExprCache
+			, ast::type::TypesCache & typesCache
+			, AdaptedShader & adapted
+			, ast::ShaderStage stage
+			, SpirVConfig & spirvConfig
+			, spirv::PreprocContext context )
+		{
+			glsl::Statements debug;
+			glsl::StmtConfig stmtConfig;
+
+			if ( spirvConfig.debugLevel == DebugLevel::eDebugInfo )
 			{
-				intrinsicsConfig.requiredExtensions.insert( glsl::EXT_shader_explicit_arithmetic_types_int16 );
+				auto intrinsicsConfig = glsl::fillConfig( stage
+					, *adapted.statements );
+
+				if ( intrinsicsConfig.requiresInt8 )
+				{
+					intrinsicsConfig.requiredExtensions.insert( glsl::EXT_shader_explicit_arithmetic_types_int8 );
+				}
+
+				if ( intrinsicsConfig.requiresInt16 )
+				{
+					intrinsicsConfig.requiredExtensions.insert( glsl::EXT_shader_explicit_arithmetic_types_int16 );
+				}
+
+				if ( intrinsicsConfig.requiresInt64 )
+				{
+					intrinsicsConfig.requiredExtensions.insert( glsl::ARB_gpu_shader_int64 );
+				}
+
+				stmtConfig = glsl::StmtConfig{ stage
+					, glsl::v4_6
+					, intrinsicsConfig.requiredExtensions
+					, true
+					, false
+					, false
+					, true
+					, true
+					, true
+					, true
+					, spirvConfig.allocator };
+				glsl::checkConfig( stmtConfig, intrinsicsConfig );
+				debug = glsl::generateGlslStatements( stmtConfig, intrinsicsConfig, *adapted.statements, true );
 			}
 
-			if ( intrinsicsConfig.requiresInt64 )
+			auto result = generateModule( compileExprCache
+				, typesCache
+				, *adapted.statements
+				, stage
+				, adapted.config
+				, std::move( context )
+				, spirvConfig
+				, stmtConfig
+				, std::move( adapted.actions )
+				, std::move( debug ) );
+
+			if ( spirvConfig.compactIds )
 			{
-				intrinsicsConfig.requiredExtensions.insert( glsl::ARB_gpu_shader_int64 );
+				result->compactIds();
 			}
 
-			stmtConfig = glsl::StmtConfig{ stage
-				, glsl::v4_6
-				, intrinsicsConfig.requiredExtensions
-				, true
-				, false
-				, false
-				, true
-				, true
-				, true
-				, true
-				, spirvConfig.allocator };
-			glsl::checkConfig( stmtConfig, intrinsicsConfig );
-			debug = glsl::generateGlslStatements( stmtConfig, intrinsicsConfig, *statements, true );
+			return result;
+		}
+	}
+
+	void ModuleDeleter::operator()( Module * shaderModule )
+	{
+		delete shaderModule;
+	}
+
+	void FunctionModuleDeleter::operator()( FunctionModule * functionModule )
+	{
+		delete functionModule;
+	}
+
+	size_t hashConfig( SpirVConfig const & config )
+	{
+		size_t result{};
+		ast::type::hashCombine( result, config.specVersion );
+
+		if ( config.availableExtensions )
+		{
+			for ( auto & extension : *config.availableExtensions )
+			{
+				ast::type::hashCombine( result, extension.name );
+			}
 		}
 
-		return generateModule( compileExprCache
+		ast::type::hashCombine( result, config.debugLevel );
+
+		if ( config.specialisation )
+		{
+			ast::type::hashCombine( result, ast::hashSpecialisation( *config.specialisation ) );
+		}
+
+		ast::type::hashCombine( result, ast::hashConfig( config.optimisations ) );
+		ast::type::hashCombine( result, config.eliminateRedundantMemoryAccesses );
+		ast::type::hashCombine( result, config.promoteLocalVariables );
+		ast::type::hashCombine( result, config.simplifyControlFlow );
+		ast::type::hashCombine( result, config.compactIds );
+		ast::type::hashCombine( result, config.generationThreads );
+		return result;
+	}
+
+	ModulePtr compileSpirV( ast::ShaderAllocatorBlock & allocator
+		, ast::Shader const & shader
+		, ast::stmt::Container const * stmt
+		, ast::ShaderStage stage
+		, SpirVConfig & spirvConfig )
+	{
+		auto & typesCache = shader.getTypesCache();
+		ast::stmt::StmtCache compileStmtCache{ allocator };
+		ast::expr::ExprCache compileExprCache{ allocator };
+		spirv::PreprocContext context;
+		auto adapted = adaptShader( allocator
+			, compileStmtCache
+			, compileExprCache
+			, shader
+			, stmt
+			, stage
+			, spirvConfig
+			, context );
+		return generateShaderModule( compileExprCache
 			, typesCache
-			, *statements
+			, adapted
 			, stage
-			, adaptationData.config
-			, std::move( context )
 			, spirvConfig
-			, stmtConfig
-			, std::move( actions )
-			, std::move( debug ) );
+			, std::move( context ) );
 	}
 
 	ModulePtr compileSpirV( ast::ShaderAllocatorBlock & allocator
@@ -235,6 +345,109 @@ namespace spirv
 			, config );
 	}
 
+	std::vector< uint32_t > serialiseSpirv( ast::Shader const & shader
+		, SpirVConfig & config
+		, SpirVMemo & memo )
+	{
+		auto ownAllocator = config.allocator ? nullptr : std::make_unique< ast::ShaderAllocator >();
+		auto allocator = config.allocator ? config.allocator->getBlock() : ownAllocator->getBlock();
+		std::vector< uint32_t > result;
+
+		try
+		{
+			auto & typesCache = shader.getTypesCache();
+			ast::stmt::StmtCache compileStmtCache{ *allocator };
+			ast::expr::ExprCache compileExprCache{ *allocator };
+			spirv::PreprocContext context;
+			auto adapted = adaptShader( *allocator
+				, compileStmtCache
+				, compileExprCache
+				, shader
+				, shader.getStatements()
+				, shader.getType()
+				, config
+				, context );
+			result = memo.compile( *adapted.statements
+				, hashConfig( config )
+				, [&]( SpirVMemo::FunctionOutputs & functions )
+				{
+					ModulePtr shaderModule;
+
+					// The debug information follows the statements in order, the functions can't be generated apart.
+					if ( config.debugLevel == DebugLevel::eDebugInfo )
+					{
+						shaderModule = generateShaderModule( compileExprCache
+							, typesCache
+							, adapted
+							, shader.getType()
+							, config
+							, std::move( context ) );
+					}
+					else
+					{
+						shaderModule = generateModule( compileExprCache
+							, typesCache
+							, *adapted.statements
+							, shader.getType()
+							, adapted.config
+							, std::move( context )
+							, config
+							, glsl::StmtConfig{}
+							, std::move( adapted.actions )
+							, functions );
+
+						if ( config.compactIds )
+						{
+							shaderModule->compactIds();
+						}
+					}
+
+					auto spirv = Module::serialize( *shaderModule );
+					return std::vector< uint32_t >{ spirv.begin(), spirv.end() };
+				} );
+		}
+		catch ( ast::Exception & exc )
+		{
+			std::cerr << exc.what() << std::endl;
+		}
+
+		return result;
+	}
+
+	std::vector< std::vector< uint32_t > > compileBatch( std::span< ast::Shader const * const > shaders
+		, std::span< SpirVConfig > configs
+		, ast::BatchConfig const & batchConfig
+		, SpirVBatchCallback const & onCompiled )
+	{
+		if ( shaders.size() != configs.size() )
+		{
+			throw ast::Exception{ "Batch shaders and configs counts mismatch" };
+		}
+
+		std::vector< std::vector< uint32_t > > result( shaders.size() );
+		auto groups = ast::groupBatchItems( { shaders.begin(), shaders.end() } );
+		ast::runBatch( groups.size()
+			, [&]( ast::ShaderAllocator & allocator
+				, size_t groupIndex )
+			{
+				for ( auto index : groups[groupIndex] )
+				{
+					auto config = configs[index];
+					config.allocator = &allocator;
+					result[index] = serialiseSpirv( *shaders[index], config );
+					configs[index].requiredVersion = config.requiredVersion;
+					configs[index].requiredExtensions = std::move( config.requiredExtensions );
+
+					if ( onCompiled )
+					{
+						onCompiled( index, result[index] );
+					}
+				}
+			}
+			, batchConfig );
+		return result;
+	}
+
 	std::string displaySpirv( ast::ShaderAllocatorBlock & allocator
 		, std::vector< uint32_t > const & spirv )
 	{
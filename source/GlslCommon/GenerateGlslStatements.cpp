@@ -15,6 +15,7 @@ See LICENSE file in root folder
 #include <ShaderAST/Type/TypeCombinedImage.hpp>
 #include <ShaderAST/Visitors/SimplifyStatements.hpp>
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 #pragma warning( push )
@@ -520,6 +521,35 @@ namespace glsl
 				return result;
 			}
 
+			static std::string getPrecisionQualifier( ast::var::Variable const & var )
+			{
+				std::string result;
+
+				if ( var.isRelaxedPrecision() )
+				{
+					result = "mediump";
+				}
+
+				return result;
+			}
+
+			static std::string getMemoryQualifier( ast::var::Variable const & var )
+			{
+				std::string result;
+
+				if ( var.isNonWritable() )
+				{
+					result = "readonly";
+				}
+
+				if ( var.isNonReadable() )
+				{
+					result += result.empty() ? "writeonly" : " writeonly";
+				}
+
+				return result;
+			}
+
 			static std::string getLocationName( ast::var::Variable const & var )
 			{
 				std::string result;
@@ -1992,6 +2022,11 @@ namespace glsl
 						m_result += "const ";
 					}
 
+					if ( expr->getIdentifier().getVariable()->isRelaxedPrecision() )
+					{
+						m_result += "mediump ";
+					}
+
 					doAppend( doJoin( getTypeName( expr->getType() ), " "
 						, expr->getIdentifier()
 						, helpers::getTypeArraySize( expr->getIdentifier().getType() )
@@ -2361,7 +2396,8 @@ namespace glsl
 				, IntrinsicsConfig const & intrinsics
 				, std::map< ast::var::VariablePtr, ast::expr::Expr const * > & aliases
 				, ast::stmt::Stmt const & stmt
-				, bool withExprColumns )
+				, bool withExprColumns
+				, ast::FunctionOutputsT< std::string > * functions = nullptr )
 			{
 				Statements result{ std::string{}, StatementsList{} };
 				uint32_t line{ 1u };
@@ -2390,7 +2426,7 @@ namespace glsl
 					}
 				}
 
-				StmtVisitor vis{ config, aliases, withExprColumns, result, line };
+				StmtVisitor vis{ config, aliases, withExprColumns, result, line, functions };
 				stmt.accept( &vis );
 				return result;
 			}
@@ -2400,11 +2436,13 @@ namespace glsl
 				, std::map< ast::var::VariablePtr, ast::expr::Expr const * > & aliases
 				, bool withExprColumns
 				, Statements & result
-				, uint32_t line )
+				, uint32_t line
+				, ast::FunctionOutputsT< std::string > * functions )
 				: m_config{ config }
 				, m_aliases{ aliases }
 				, m_withExprColumns{ withExprColumns }
 				, m_result{ result }
+				, m_functions{ functions }
 				, m_currentLine{ line }
 			{
 			}
@@ -2440,16 +2478,22 @@ namespace glsl
 					: 0u;
 			}
 
+			// Tells if a statement of the given type is separated from the previous one by an empty line.
+			bool isSeparated( StatementType type )const
+			{
+				return ( helpers::isScopeEndStatement( m_lastStmtType )
+						&& !helpers::isScopeEndStatement( type ) )
+					|| ( helpers::isScopeDeclStatement( type )
+						&& !helpers::isScopeBeginStatement( m_lastStmtType ) );
+			}
+
 			void doAddStatement( std::string text
 				, ExprsColumns exprs
 				, StatementType type
 				, ast::stmt::Stmt const & stmt
 				, ast::stmt::Stmt const * scope = nullptr )
 			{
-				if ( ( helpers::isScopeEndStatement( m_lastStmtType )
-						&& !helpers::isScopeEndStatement( type ) )
-					|| ( helpers::isScopeDeclStatement( type )
-						&& !helpers::isScopeBeginStatement( m_lastStmtType ) ) )
+				if ( isSeparated( type ) )
 				{
 					++m_currentLine;
 					m_result.source += "\n";
@@ -2842,6 +2886,27 @@ namespace glsl
 
 			void visitFunctionDeclStmt( ast::stmt::FunctionDecl const * stmt )override
 			{
+				auto index = m_functionIndex++;
+				auto begin = m_result.source.size() + ( isSeparated( StatementType::eFunctionDecl ) ? 1u : 0u );
+
+				if ( m_functions )
+				{
+					if ( auto source = m_functions->find( index ) )
+					{
+						// The function didn't change, its source is reused, without its statements.
+						if ( isSeparated( StatementType::eFunctionDecl ) )
+						{
+							++m_currentLine;
+							m_result.source += "\n";
+						}
+
+						m_result.source += *source;
+						m_currentLine += uint32_t( std::count( source->begin(), source->end(), '\n' ) );
+						m_lastStmtType = StatementType::eFunctionScopeEnd;
+						return;
+					}
+				}
+
 				auto type = stmt->getType();
 				std::string text = getTypeName( type->getReturnType() );
 				text += " " + stmt->getName() + "(";
@@ -2878,6 +2943,11 @@ namespace glsl
 					, StatementType::eScopeLine
 					, StatementType::eFunctionScopeEnd
 					, preEndText );
+
+				if ( m_functions )
+				{
+					m_functions->store( index, m_result.source.substr( begin ) );
+				}
 			}
 
 			void visitHitAttributeVariableDeclStmt( ast::stmt::HitAttributeVariableDecl const * stmt )override
@@ -3017,6 +3087,7 @@ namespace glsl
 					std::string text = helpers::getInOutLayout( m_config, *stmt );
 					helpers::join( text, helpers::getInterpolationQualifier( *stmt->getVariable(), m_config.shaderStage ), " " );
 					helpers::join( text, helpers::getDirectionName( *stmt->getVariable() ), " " );
+					helpers::join( text, helpers::getPrecisionQualifier( *stmt->getVariable() ), " " );
 					helpers::join( text, getTypeName( stmt->getVariable()->getType() ), " " );
 					helpers::join( text, stmt->getVariable()->getName(), " " );
 
@@ -3247,7 +3318,9 @@ namespace glsl
 				doBeginScope( *stmt, StatementType::eStructureScopeBegin, StatementType::eStructureMemberDecl );
 				auto data = stmt->getData();
 				auto arrayType = std::static_pointer_cast< ast::type::Array >( data->getType() );
-				text = getTypeName( arrayType->getType() ) + " " + data->getName();
+				text = helpers::getMemoryQualifier( *data );
+				helpers::join( text, getTypeName( arrayType->getType() ), " " );
+				helpers::join( text, data->getName(), " " );
 				text += helpers::getTypeArraySize( arrayType );
 				doAddSimpleStatement( text, ExprsColumns{}, *stmt );
 				doEndScope( *stmt, StatementType::eStructureScopeEnd, " " + stmt->getSsboInstance()->getName() );
@@ -3357,6 +3430,8 @@ namespace glsl
 						std::string text;
 						helpers::join( text, helpers::getDirectionName( *var ), " " );
 						helpers::join( text, helpers::getInterpolationQualifier( *var, m_config.shaderStage ), " " );
+						helpers::join( text, helpers::getPrecisionQualifier( *var ), " " );
+						helpers::join( text, helpers::getMemoryQualifier( *var ), " " );
 						helpers::join( text, getTypeName( var->getType() ), " " );
 						helpers::join( text, var->getName(), " " );
 						text += helpers::getTypeArraySize( var->getType() );
@@ -3404,6 +3479,8 @@ namespace glsl
 			std::vector< std::string > m_indents{ std::string{} };
 			bool m_withExprColumns;
 			Statements & m_result;
+			ast::FunctionOutputsT< std::string > * m_functions;
+			size_t m_functionIndex{};
 			std::vector< ast::stmt::Stmt const * > m_scopes{ nullptr };
 			uint32_t m_currentLine{ 1u };
 			std::vector< StatementType > m_scopeLines{ StatementType::eScopeLine };
@@ -3422,6 +3499,15 @@ namespace glsl
 		return gstvis::StmtVisitor::submit( config, intrinsics, aliases, stmt, withExprColumns );
 	}
 
+	Statements generateGlslStatements( StmtConfig const & config
+		, IntrinsicsConfig const & intrinsics
+		, ast::stmt::Container const & stmt
+		, ast::FunctionOutputsT< std::string > & functions )
+	{
+		std::map< ast::var::VariablePtr, ast::expr::Expr const * > aliases;
+		return gstvis::StmtVisitor::submit( config, intrinsics, aliases, stmt, false, &functions );
+	}
+
 	std::string getExprName( StmtConfig const & config
 		, ast::expr::Expr const & expr )
 	{
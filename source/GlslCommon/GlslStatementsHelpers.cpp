@@ -8,6 +8,8 @@ See LICENSE file in root folder
 #include <ShaderAST/Type/TypeImage.hpp>
 #include <ShaderAST/Type/TypeCombinedImage.hpp>
 
+#include <algorithm>
+
 #pragma warning( push )
 #pragma warning( disable: 4365 )
 #pragma warning( disable: 5262 )
@@ -463,6 +465,35 @@ namespace glsl
 		return result;
 	}
 
+	std::vector< Statement const * > findStatements( Statements const & statements
+		, std::vector< ast::stmt::Stmt const * > const & stmts )
+	{
+		std::vector< Statement const * > result;
+
+		for ( auto & statement : statements.statements )
+		{
+			switch ( statement.type )
+			{
+			case StatementType::eStructureScopeBegin:
+			case StatementType::eStructureScopeEnd:
+			case StatementType::eFunctionScopeBegin:
+			case StatementType::eFunctionScopeEnd:
+			case StatementType::eLexicalScopeBegin:
+			case StatementType::eLexicalScopeEnd:
+				break;
+			default:
+				if ( statement.stmt
+					&& std::find( stmts.begin(), stmts.end(), statement.stmt ) != stmts.end() )
+				{
+					result.push_back( &statement );
+				}
+				break;
+			}
+		}
+
+		return result;
+	}
+
 	void checkType( ast::type::TypePtr ptype
 		, IntrinsicsConfig & config )
 	{
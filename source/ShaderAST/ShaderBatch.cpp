@@ -0,0 +1,199 @@
+/*
+See LICENSE file in root folder
+*/
+#include "ShaderAST/ShaderBatch.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace ast
+{
+	//*********************************************************************************************
+
+	namespace batch
+	{
+		class WorkQueue
+		{
+		public:
+			void push( size_t index )
+			{
+				std::lock_guard< std::mutex > lock{ m_mutex };
+				m_jobs.push_back( index );
+			}
+
+			bool pop( size_t & index )
+			{
+				std::lock_guard< std::mutex > lock{ m_mutex };
+
+				if ( m_jobs.empty() )
+				{
+					return false;
+				}
+
+				index = m_jobs.back();
+				m_jobs.pop_back();
+				return true;
+			}
+
+			bool steal( size_t & index )
+			{
+				std::lock_guard< std::mutex > lock{ m_mutex };
+
+				if ( m_jobs.empty() )
+				{
+					return false;
+				}
+
+				index = m_jobs.front();
+				m_jobs.pop_front();
+				return true;
+			}
+
+		private:
+			std::mutex m_mutex;
+			std::deque< size_t > m_jobs;
+		};
+
+		static uint32_t getWorkersCount( size_t count
+			, BatchConfig const & config )
+		{
+			auto result = config.concurrency
+				? config.concurrency
+				: std::max( 1u, std::thread::hardware_concurrency() );
+			return uint32_t( std::min( size_t( result ), count ) );
+		}
+
+		static void runWorker( uint32_t workerIndex
+			, std::vector< WorkQueue > & queues
+			, std::vector< std::exception_ptr > & errors
+			, BatchJob const & job )
+		{
+			ShaderAllocator allocator;
+			auto workersCount = uint32_t( queues.size() );
+			size_t index{};
+
+			while ( true )
+			{
+				bool found = queues[workerIndex].pop( index );
+
+				for ( uint32_t i = 1u; !found && i < workersCount; ++i )
+				{
+					found = queues[( workerIndex + i ) % workersCount].steal( index );
+				}
+
+				if ( !found )
+				{
+					// Jobs are all queued before the workers start, so empty queues mean we're done.
+					break;
+				}
+
+				try
+				{
+					auto block = allocator.getBlock();
+					job( allocator, index );
+				}
+				catch ( ... )
+				{
+					errors[index] = std::current_exception();
+				}
+			}
+		}
+	}
+
+	//*********************************************************************************************
+
+	void runBatch( size_t count
+		, BatchJob const & job
+		, BatchConfig const & config )
+	{
+		if ( !count )
+		{
+			return;
+		}
+
+		auto workersCount = batch::getWorkersCount( count, config );
+		std::vector< std::exception_ptr > errors( count );
+
+		if ( workersCount == 1u )
+		{
+			ShaderAllocator allocator;
+
+			for ( size_t index = 0u; index < count; ++index )
+			{
+				try
+				{
+					auto block = allocator.getBlock();
+					job( allocator, index );
+				}
+				catch ( ... )
+				{
+					errors[index] = std::current_exception();
+				}
+			}
+		}
+		else
+		{
+			std::vector< batch::WorkQueue > queues( workersCount );
+
+			for ( size_t index = 0u; index < count; ++index )
+			{
+				queues[index % workersCount].push( index );
+			}
+
+			std::vector< std::thread > workers;
+			workers.reserve( workersCount );
+
+			for ( uint32_t workerIndex = 0u; workerIndex < workersCount; ++workerIndex )
+			{
+				workers.emplace_back( batch::runWorker
+					, workerIndex
+					, std::ref( queues )
+					, std::ref( errors )
+					, std::cref( job ) );
+			}
+
+			for ( auto & worker : workers )
+			{
+				worker.join();
+			}
+		}
+
+		auto it = std::find_if( errors.begin()
+			, errors.end()
+			, []( std::exception_ptr const & lookup )
+			{
+				return lookup != nullptr;
+			} );
+
+		if ( it != errors.end() )
+		{
+			std::rethrow_exception( *it );
+		}
+	}
+
+	std::vector< std::vector< size_t > > groupBatchItems( std::vector< void const * > const & keys )
+	{
+		std::vector< std::vector< size_t > > result;
+		std::unordered_map< void const *, size_t > groups;
+
+		for ( size_t index = 0u; index < keys.size(); ++index )
+		{
+			auto [it, added] = groups.try_emplace( keys[index], result.size() );
+
+			if ( added )
+			{
+				result.emplace_back();
+			}
+
+			result[it->second].push_back( index );
+		}
+
+		return result;
+	}
+
+	//*********************************************************************************************
+}
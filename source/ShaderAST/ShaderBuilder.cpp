@@ -97,8 +97,15 @@ namespace ast
 	}
 
 	void ShaderBuilder::beginIf( expr::ExprPtr condition )
+	{
+		beginIf( std::move( condition ), stmt::SelectionHint::eNone );
+	}
+
+	void ShaderBuilder::beginIf( expr::ExprPtr condition
+		, stmt::SelectionHint hint )
 	{
 		auto stmt = getStmtCache().makeIf( std::move( condition ) );
+		stmt->setHint( hint );
 		m_ifStmt.push_back( stmt.get() );
 		pushScope( std::move( stmt ) );
 	}
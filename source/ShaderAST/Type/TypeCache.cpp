@@ -1211,5 +1211,10 @@ namespace ast::type
 		return m_pointer.getType( pointerType, storage, true );
 	}
 
+	std::unique_lock< std::recursive_mutex > TypesCache::lock()
+	{
+		return std::unique_lock< std::recursive_mutex >{ m_mutex };
+	}
+
 	//*************************************************************************
 }
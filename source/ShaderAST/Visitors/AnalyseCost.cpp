@@ -0,0 +1,936 @@
+/*
+See LICENSE file in root folder
+*/
+#include "ShaderAST/Visitors/AnalyseCost.hpp"
+
+#include "ShaderAST/Expr/ExprVisitor.hpp"
+#include "ShaderAST/Stmt/StmtVisitor.hpp"
+#include "ShaderAST/Type/TypeStruct.hpp"
+#include "ShaderAST/Visitors/AnalyseRegisterPressure.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace ast
+{
+	//*************************************************************************
+
+	namespace cost
+	{
+		// Above this count, the trip count of a loop is considered unknown.
+		static uint32_t constexpr MaxTripCount = 65536u;
+
+		struct Scope
+		{
+			// Each operation counted once.
+			OperationCounts operations;
+			// The operations multiplied by the trip count of the nested loops.
+			OperationCounts executed;
+		};
+
+		struct LoopControl
+		{
+			// The comparison, with the loop variable as the left operand.
+			expr::Kind op{};
+			int64_t bound{};
+		};
+
+		using FunctionCosts = std::unordered_map< uint32_t, OperationCounts >;
+
+		static void add( OperationCounts & result
+			, OperationCounts const & rhs
+			, uint64_t factor )
+		{
+			result.floatOps += rhs.floatOps * factor;
+			result.halfOps += rhs.halfOps * factor;
+			result.doubleOps += rhs.doubleOps * factor;
+			result.intOps += rhs.intOps * factor;
+			result.transcendentals += rhs.transcendentals * factor;
+			result.samples += rhs.samples * factor;
+			result.gathers += rhs.gathers * factor;
+			result.fetches += rhs.fetches * factor;
+			result.imageLoads += rhs.imageLoads * factor;
+			result.imageStores += rhs.imageStores * factor;
+			result.atomics += rhs.atomics * factor;
+			result.barriers += rhs.barriers * factor;
+			result.branches += rhs.branches * factor;
+		}
+
+		static uint32_t getScalarCount( type::Type const & type )
+		{
+			auto kind = type.getKind();
+
+			if ( kind == type::Kind::eArray )
+			{
+				auto & arrayType = static_cast< type::Array const & >( type );
+				auto size = arrayType.getArraySize();
+				return getScalarCount( *arrayType.getType() )
+					* ( ( size == type::NotArray || size == type::UnknownArraySize ) ? 1u : size );
+			}
+
+			if ( type::isStructType( kind ) )
+			{
+				uint32_t result{};
+
+				for ( auto & member : static_cast< type::Struct const & >( type ) )
+				{
+					result += getScalarCount( *member.type );
+				}
+
+				return result;
+			}
+
+			if ( type::isOpaqueType( kind ) )
+			{
+				return 0u;
+			}
+
+			if ( type::isMatrixType( kind ) )
+			{
+				return type::getComponentCount( kind )
+					* type::getComponentCount( type::getComponentType( kind ) );
+			}
+
+			return type::getComponentCount( kind );
+		}
+
+		static bool isVariable( expr::Expr const & expr
+			, var::Variable const & var )
+		{
+			return expr.getKind() == expr::Kind::eIdentifier
+				&& static_cast< expr::Identifier const & >( expr ).getVariable()->getId() == var.getId();
+		}
+
+		static bool getLiteralValue( expr::Expr const & expr
+			, int64_t & value )
+		{
+			if ( expr.getKind() != expr::Kind::eLiteral )
+			{
+				return false;
+			}
+
+			auto & literal = static_cast< expr::Literal const & >( expr );
+
+			if ( literal.getLiteralType() == expr::LiteralType::eInt32 )
+			{
+				value = literal.getValue< expr::LiteralType::eInt32 >();
+				return true;
+			}
+
+			if ( literal.getLiteralType() == expr::LiteralType::eUInt32 )
+			{
+				value = literal.getValue< expr::LiteralType::eUInt32 >();
+				return true;
+			}
+
+			return false;
+		}
+
+		static bool isInRange( type::Kind kind
+			, int64_t value )
+		{
+			if ( kind == type::Kind::eInt32 )
+			{
+				return value >= std::numeric_limits< int32_t >::lowest()
+					&& value <= std::numeric_limits< int32_t >::max();
+			}
+
+			return value >= 0
+				&& value <= std::numeric_limits< uint32_t >::max();
+		}
+		/**
+		*\return
+		*	The loop variable, if \p expr initialises or assigns an integer variable with a literal.
+		*/
+		static var::VariablePtr getLoopVar( expr::Expr const * expr
+			, int64_t & init )
+		{
+			if ( !expr )
+			{
+				return nullptr;
+			}
+
+			var::VariablePtr result{};
+			expr::Expr const * value{};
+
+			if ( expr->getKind() == expr::Kind::eInit
+				&& static_cast< expr::Init const & >( *expr ).hasIdentifier() )
+			{
+				auto & initExpr = static_cast< expr::Init const & >( *expr );
+				result = initExpr.getIdentifier().getVariable();
+				value = initExpr.getInitialiser();
+			}
+			else if ( expr->getKind() == expr::Kind::eAssign
+				&& static_cast< expr::Assign const & >( *expr ).getLHS()->getKind() == expr::Kind::eIdentifier )
+			{
+				auto & assign = static_cast< expr::Assign const & >( *expr );
+				result = static_cast< expr::Identifier const & >( *assign.getLHS() ).getVariable();
+				value = assign.getRHS();
+			}
+
+			if ( !result
+				|| !value
+				|| ( result->getType()->getKind() != type::Kind::eInt32
+					&& result->getType()->getKind() != type::Kind::eUInt32 )
+				|| !getLiteralValue( *value, init ) )
+			{
+				return nullptr;
+			}
+
+			return result;
+		}
+
+		static bool getControl( expr::Expr const & expr
+			, var::Variable const & var
+			, LoopControl & result )
+		{
+			switch ( expr.getKind() )
+			{
+			case expr::Kind::eLess:
+			case expr::Kind::eLessEqual:
+			case expr::Kind::eGreater:
+			case expr::Kind::eGreaterEqual:
+			case expr::Kind::eNotEqual:
+				break;
+			default:
+				return false;
+			}
+
+			auto & binary = static_cast< expr::Binary const & >( expr );
+
+			if ( isVariable( *binary.getLHS(), var )
+				&& getLiteralValue( *binary.getRHS(), result.bound ) )
+			{
+				result.op = expr.getKind();
+				return true;
+			}
+
+			if ( isVariable( *binary.getRHS(), var )
+				&& getLiteralValue( *binary.getLHS(), result.bound ) )
+			{
+				switch ( expr.getKind() )
+				{
+				case expr::Kind::eLess:
+					result.op = expr::Kind::eGreater;
+					break;
+				case expr::Kind::eLessEqual:
+					result.op = expr::Kind::eGreaterEqual;
+					break;
+				case expr::Kind::eGreater:
+					result.op = expr::Kind::eLess;
+					break;
+				case expr::Kind::eGreaterEqual:
+					result.op = expr::Kind::eLessEqual;
+					break;
+				default:
+					result.op = expr.getKind();
+					break;
+				}
+
+				return true;
+			}
+
+			return false;
+		}
+
+		static bool getStepValue( expr::Expr const & value
+			, var::Variable const & var
+			, int64_t & step )
+		{
+			if ( value.getKind() == expr::Kind::eAdd )
+			{
+				auto & add = static_cast< expr::Binary const & >( value );
+				return ( isVariable( *add.getLHS(), var ) && getLiteralValue( *add.getRHS(), step ) )
+					|| ( isVariable( *add.getRHS(), var ) && getLiteralValue( *add.getLHS(), step ) );
+			}
+
+			if ( value.getKind() == expr::Kind::eMinus
+				&& isVariable( *static_cast< expr::Binary const & >( value ).getLHS(), var )
+				&& getLiteralValue( *static_cast< expr::Binary const & >( value ).getRHS(), step ) )
+			{
+				step = -step;
+				return true;
+			}
+
+			return false;
+		}
+		/**
+		*	Finds the step of the loop variable in an increment expression.
+		*	SSA transformation can compute the new value in an alias, given as \p alias.
+		*/
+		static bool getStep( expr::Expr const & expr
+			, expr::Alias const * alias
+			, var::Variable const & var
+			, int64_t & step )
+		{
+			switch ( expr.getKind() )
+			{
+			case expr::Kind::ePreIncrement:
+			case expr::Kind::ePostIncrement:
+				step = 1;
+				return isVariable( *static_cast< expr::Unary const & >( expr ).getOperand(), var );
+			case expr::Kind::ePreDecrement:
+			case expr::Kind::ePostDecrement:
+				step = -1;
+				return isVariable( *static_cast< expr::Unary const & >( expr ).getOperand(), var );
+			case expr::Kind::eAddAssign:
+			case expr::Kind::eMinusAssign:
+				{
+					auto & binary = static_cast< expr::Binary const & >( expr );
+
+					if ( !isVariable( *binary.getLHS(), var )
+						|| !getLiteralValue( *binary.getRHS(), step ) )
+					{
+						return false;
+					}
+
+					step = ( expr.getKind() == expr::Kind::eAddAssign ) ? step : -step;
+					return true;
+				}
+			case expr::Kind::eAssign:
+				{
+					auto & assign = static_cast< expr::Assign const & >( expr );
+
+					if ( !isVariable( *assign.getLHS(), var ) )
+					{
+						return false;
+					}
+
+					if ( getStepValue( *assign.getRHS(), var, step ) )
+					{
+						return true;
+					}
+
+					return alias
+						&& isVariable( *assign.getRHS(), *alias->getIdentifier().getVariable() )
+						&& getStepValue( *alias->getAliasedExpr(), var, step );
+				}
+			default:
+				return false;
+			}
+		}
+
+		static bool evaluate( LoopControl const & control
+			, int64_t value )
+		{
+			switch ( control.op )
+			{
+			case expr::Kind::eLess:
+				return value < control.bound;
+			case expr::Kind::eLessEqual:
+				return value <= control.bound;
+			case expr::Kind::eGreater:
+				return value > control.bound;
+			case expr::Kind::eGreaterEqual:
+				return value >= control.bound;
+			default:
+				return value != control.bound;
+			}
+		}
+		/**
+		*\return
+		*	The iterations count, 0 if the loop doesn't end within MaxTripCount iterations, or if the variable overflows.
+		*/
+		static uint32_t getTripCount( type::Kind kind
+			, int64_t init
+			, LoopControl const & control
+			, int64_t step )
+		{
+			uint32_t result{};
+			auto value = init;
+
+			while ( evaluate( control, value ) )
+			{
+				if ( result >= MaxTripCount )
+				{
+					return 0u;
+				}
+
+				++result;
+				value += step;
+
+				if ( !isInRange( kind, value ) )
+				{
+					return 0u;
+				}
+			}
+
+			return result;
+		}
+
+		static expr::Expr const * getSimpleExpr( stmt::Stmt const * stmt )
+		{
+			return ( stmt && stmt->getKind() == stmt::Kind::eSimple )
+				? static_cast< stmt::Simple const & >( *stmt ).getExpr()
+				: nullptr;
+		}
+
+		class ExprCounter
+			: public expr::SimpleVisitor
+		{
+		public:
+			static void submit( expr::Expr const & expr
+				, FunctionCosts const & functions
+				, Scope & scope )
+			{
+				ExprCounter vis{ functions, scope };
+				expr.accept( &vis );
+			}
+
+		private:
+			ExprCounter( FunctionCosts const & functions
+				, Scope & scope )
+				: m_functions{ functions }
+				, m_scope{ scope }
+			{
+			}
+
+			void count( uint64_t OperationCounts::* field
+				, uint64_t value = 1u )
+			{
+				m_scope.operations.*field += value;
+				m_scope.executed.*field += value;
+			}
+
+			void countAlu( type::Kind kind
+				, uint32_t scalars )
+			{
+				auto scalar = type::getScalarType( kind );
+
+				if ( type::isHalfType( scalar ) )
+				{
+					count( &OperationCounts::halfOps, scalars );
+				}
+				else if ( type::isFloatType( scalar ) )
+				{
+					count( &OperationCounts::floatOps, scalars );
+				}
+				else if ( type::isDoubleType( scalar ) )
+				{
+					count( &OperationCounts::doubleOps, scalars );
+				}
+				else
+				{
+					count( &OperationCounts::intOps, scalars );
+				}
+			}
+
+			void doSubmit( expr::ExprList const & list )
+			{
+				for ( auto & expr : list )
+				{
+					expr->accept( this );
+				}
+			}
+
+			void countIntrinsic( expr::IntrinsicCall const & expr )
+			{
+				auto intrinsic = expr.getIntrinsic();
+				auto isIn = [intrinsic]( expr::Intrinsic min, expr::Intrinsic max )
+				{
+					return intrinsic >= min && intrinsic <= max;
+				};
+
+				if ( isIn( expr::Intrinsic::eAtomicAddI, expr::Intrinsic::eAtomicCompSwapU ) )
+				{
+					count( &OperationCounts::atomics );
+					return;
+				}
+
+				if ( intrinsic == expr::Intrinsic::eControlBarrier
+					|| intrinsic == expr::Intrinsic::eMemoryBarrier )
+				{
+					count( &OperationCounts::barriers );
+					return;
+				}
+
+				auto & args = expr.getArgList();
+				auto kind = args.empty()
+					? expr.getType()->getKind()
+					: args.front()->getType()->getKind();
+				auto scalars = getScalarCount( *expr.getType() );
+
+				for ( auto & arg : args )
+				{
+					scalars = std::max( scalars, getScalarCount( *arg->getType() ) );
+				}
+
+				if ( isIn( expr::Intrinsic::eCos1, expr::Intrinsic::eAtanh4 )
+					|| isIn( expr::Intrinsic::ePow1, expr::Intrinsic::eInverseSqrt4D ) )
+				{
+					count( &OperationCounts::transcendentals, scalars );
+				}
+				else if ( scalars )
+				{
+					countAlu( kind, scalars );
+				}
+			}
+
+			void visitUnaryExpr( expr::Unary const * expr )override
+			{
+				expr->getOperand()->accept( this );
+
+				switch ( expr->getKind() )
+				{
+				case expr::Kind::eUnaryMinus:
+				case expr::Kind::eBitNot:
+				case expr::Kind::eLogNot:
+				case expr::Kind::ePreIncrement:
+				case expr::Kind::ePreDecrement:
+				case expr::Kind::ePostIncrement:
+				case expr::Kind::ePostDecrement:
+					countAlu( expr->getType()->getKind(), getScalarCount( *expr->getType() ) );
+					break;
+				case expr::Kind::eCast:
+					if ( type::getScalarType( expr->getType()->getKind() ) != type::getScalarType( expr->getOperand()->getType()->getKind() ) )
+					{
+						countAlu( expr->getType()->getKind(), getScalarCount( *expr->getType() ) );
+					}
+					break;
+				default:
+					break;
+				}
+			}
+
+			void visitBinaryExpr( expr::Binary const * expr )override
+			{
+				expr->getLHS()->accept( this );
+				expr->getRHS()->accept( this );
+
+				switch ( expr->getKind() )
+				{
+				case expr::Kind::eAssign:
+				case expr::Kind::eAlias:
+				case expr::Kind::eArrayAccess:
+				case expr::Kind::eComma:
+					return;
+				default:
+					break;
+				}
+
+				auto lhsKind = expr->getLHS()->getType()->getKind();
+				auto rhsKind = expr->getRHS()->getType()->getKind();
+				auto scalars = std::max( getScalarCount( *expr->getLHS()->getType() )
+					, getScalarCount( *expr->getRHS()->getType() ) );
+
+				if ( ( expr->getKind() == expr::Kind::eTimes || expr->getKind() == expr::Kind::eTimesAssign )
+					&& type::isMatrixType( lhsKind )
+					&& type::isMatrixType( rhsKind ) )
+				{
+					// Each component of the result is a dot product on a row of the left operand.
+					scalars = getScalarCount( *expr->getType() ) * type::getComponentCount( lhsKind );
+				}
+
+				countAlu( lhsKind, scalars );
+			}
+
+			void visitAggrInitExpr( expr::AggrInit const * expr )override
+			{
+				doSubmit( expr->getInitialisers() );
+			}
+
+			void visitCompositeConstructExpr( expr::CompositeConstruct const * expr )override
+			{
+				doSubmit( expr->getArgList() );
+			}
+
+			void visitMbrSelectExpr( expr::MbrSelect const * expr )override
+			{
+				expr->getOuterExpr()->accept( this );
+			}
+
+			void visitFnCallExpr( expr::FnCall const * expr )override
+			{
+				if ( expr->isMember() )
+				{
+					expr->getInstance()->accept( this );
+				}
+
+				doSubmit( expr->getArgList() );
+
+				// The body is counted once in the function, its executed operations are added to each call.
+				if ( auto it = m_functions.find( expr->getFn()->getVariable()->getId() );
+					it != m_functions.end() )
+				{
+					add( m_scope.executed, it->second, 1u );
+				}
+			}
+
+			void visitIntrinsicCallExpr( expr::IntrinsicCall const * expr )override
+			{
+				doSubmit( expr->getArgList() );
+				countIntrinsic( *expr );
+			}
+
+			void visitCombinedImageAccessCallExpr( expr::CombinedImageAccessCall const * expr )override
+			{
+				doSubmit( expr->getArgList() );
+				auto access = expr->getCombinedImageAccess();
+
+				if ( access < expr::CombinedImageAccess::eTexture1DF )
+				{
+					// Size and levels queries.
+					return;
+				}
+
+				if ( access >= expr::CombinedImageAccess::eTexelFetch1DF
+					&& access <= expr::CombinedImageAccess::eTexelFetchOffset2DArrayU )
+				{
+					count( &OperationCounts::fetches );
+				}
+				else if ( access >= expr::CombinedImageAccess::eTextureGather2DF )
+				{
+					count( &OperationCounts::gathers );
+				}
+				else
+				{
+					count( &OperationCounts::samples );
+				}
+			}
+
+			void visitImageAccessCallExpr( expr::StorageImageAccessCall const * expr )override
+			{
+				doSubmit( expr->getArgList() );
+				auto access = expr->getImageAccess();
+
+				if ( access >= expr::StorageImageAccess::eImageAtomicAdd1DU )
+				{
+					count( &OperationCounts::atomics );
+				}
+				else if ( access >= expr::StorageImageAccess::eImageStore1DF )
+				{
+					count( &OperationCounts::imageStores );
+				}
+				else if ( access >= expr::StorageImageAccess::eImageLoad1DF )
+				{
+					count( &OperationCounts::imageLoads );
+				}
+			}
+
+			void visitIdentifierExpr( expr::Identifier const * expr )override
+			{
+			}
+
+			void visitInitExpr( expr::Init const * expr )override
+			{
+				if ( expr->getInitialiser() )
+				{
+					expr->getInitialiser()->accept( this );
+				}
+			}
+
+			void visitLiteralExpr( expr::Literal const * expr )override
+			{
+			}
+
+			void visitQuestionExpr( expr::Question const * expr )override
+			{
+				expr->getCtrlExpr()->accept( this );
+				expr->getTrueExpr()->accept( this );
+				expr->getFalseExpr()->accept( this );
+				countAlu( expr->getType()->getKind(), getScalarCount( *expr->getType() ) );
+			}
+
+			void visitStreamAppendExpr( expr::StreamAppend const * expr )override
+			{
+				expr->getOperand()->accept( this );
+			}
+
+			void visitSwitchCaseExpr( expr::SwitchCase const * expr )override
+			{
+			}
+
+			void visitSwitchTestExpr( expr::SwitchTest const * expr )override
+			{
+				expr->getValue()->accept( this );
+			}
+
+			void visitSwizzleExpr( expr::Swizzle const * expr )override
+			{
+				expr->getOuterExpr()->accept( this );
+			}
+
+		private:
+			FunctionCosts const & m_functions;
+			Scope & m_scope;
+		};
+
+		class StmtCounter
+			: public stmt::SimpleVisitor
+		{
+		public:
+			static ShaderCost submit( stmt::Container const & container )
+			{
+				ShaderCost result;
+				StmtCounter vis{ result };
+				container.accept( &vis );
+				add( result.operations, vis.m_global.operations, 1u );
+				return result;
+			}
+
+		private:
+			explicit StmtCounter( ShaderCost & result )
+				: m_result{ result }
+			{
+			}
+
+			void visitExpr( expr::Expr const & expr )
+			{
+				ExprCounter::submit( expr, m_functions, *m_scope );
+			}
+
+			template< typename BodyFuncT >
+			void visitLoop( uint32_t tripCount
+				, BodyFuncT body )
+			{
+				size_t loopIndex{};
+
+				if ( m_function )
+				{
+					// Reserved here, so that the loops are listed in source order.
+					loopIndex = m_function->loops.size();
+					m_function->loops.emplace_back();
+				}
+
+				Scope scope;
+				auto save = m_scope;
+				m_scope = &scope;
+				body();
+				m_scope = save;
+				add( m_scope->operations, scope.operations, 1u );
+				add( m_scope->executed, scope.executed, tripCount ? tripCount : 1u );
+
+				if ( m_function )
+				{
+					m_function->loops[loopIndex] = { tripCount, scope.executed };
+				}
+			}
+			void visitContainerStmt( stmt::Container const * cont )override
+			{
+				stmt::Stmt const * previous{};
+
+				for ( auto & stmt : *cont )
+				{
+					m_previous = previous;
+					stmt->accept( this );
+					previous = stmt.get();
+				}
+			}
+
+			void visitDoWhileStmt( stmt::DoWhile const * stmt )override
+			{
+				auto tripCount = m_pendingTripCount;
+				m_pendingTripCount = 0u;
+				visitLoop( tripCount
+					, [this, stmt]()
+					{
+						visitContainerStmt( stmt );
+						visitExpr( *stmt->getCtrlExpr() );
+					} );
+			}
+
+			void visitElseIfStmt( stmt::ElseIf const * stmt )override
+			{
+				count( &OperationCounts::branches );
+				visitExpr( *stmt->getCtrlExpr() );
+				visitContainerStmt( stmt );
+			}
+
+			void visitForStmt( stmt::For const * stmt )override
+			{
+				int64_t init{};
+				auto var = getLoopVar( stmt->getInitExpr(), init );
+				LoopControl control{};
+				int64_t step{};
+				uint32_t tripCount{};
+
+				if ( var
+					&& stmt->getCtrlExpr()
+					&& stmt->getIncrExpr()
+					&& getControl( *stmt->getCtrlExpr(), *var, control )
+					&& getStep( *stmt->getIncrExpr(), nullptr, *var, step ) )
+				{
+					tripCount = getTripCount( var->getType()->getKind(), init, control, step );
+				}
+
+				if ( stmt->getInitExpr() )
+				{
+					visitExpr( *stmt->getInitExpr() );
+				}
+
+				visitLoop( tripCount
+					, [this, stmt]()
+					{
+						if ( stmt->getCtrlExpr() )
+						{
+							visitExpr( *stmt->getCtrlExpr() );
+						}
+
+						visitContainerStmt( stmt );
+
+						if ( stmt->getIncrExpr() )
+						{
+							visitExpr( *stmt->getIncrExpr() );
+						}
+					} );
+			}
+
+			void visitFunctionDeclStmt( stmt::FunctionDecl const * stmt )override
+			{
+				FunctionCost function{ stmt->getName(), stmt->isEntryPoint(), {}, {}, {}, {} };
+				Scope scope;
+				m_function = &function;
+				m_scope = &scope;
+				visitContainerStmt( stmt );
+				function.operations = scope.operations;
+				function.executed = scope.executed;
+				m_functions[stmt->getFuncVar()->getId()] = scope.executed;
+				add( m_result.operations, scope.operations, 1u );
+
+				if ( function.entryPoint )
+				{
+					add( m_result.executed, scope.executed, 1u );
+				}
+
+				m_result.functions.push_back( std::move( function ) );
+				m_function = nullptr;
+				m_scope = &m_global;
+			}
+
+			void visitIfStmt( stmt::If const * stmt )override
+			{
+				// The loops shaped like SSA transformation creates them :
+				// var = init; if ( var OP bound ) { do { body; step; } while ( var OP bound ); }
+				auto tripCount = getSSALoopTripCount( *stmt );
+				count( &OperationCounts::branches );
+				visitExpr( *stmt->getCtrlExpr() );
+				m_pendingTripCount = tripCount;
+				visitContainerStmt( stmt );
+				m_pendingTripCount = 0u;
+
+				for ( auto & elseIf : stmt->getElseIfList() )
+				{
+					elseIf->accept( this );
+				}
+
+				if ( stmt->getElse() )
+				{
+					stmt->getElse()->accept( this );
+				}
+			}
+
+			void visitReturnStmt( stmt::Return const * stmt )override
+			{
+				if ( stmt->getExpr() )
+				{
+					visitExpr( *stmt->getExpr() );
+				}
+			}
+
+			void visitSimpleStmt( stmt::Simple const * stmt )override
+			{
+				visitExpr( *stmt->getExpr() );
+			}
+
+			void visitSwitchStmt( stmt::Switch const * stmt )override
+			{
+				count( &OperationCounts::branches );
+				visitExpr( *stmt->getTestExpr() );
+				visitContainerStmt( stmt );
+			}
+
+			void visitWhileStmt( stmt::While const * stmt )override
+			{
+				visitLoop( 0u
+					, [this, stmt]()
+					{
+						visitExpr( *stmt->getCtrlExpr() );
+						visitContainerStmt( stmt );
+					} );
+			}
+
+			void count( uint64_t OperationCounts::* field )
+			{
+				m_scope->operations.*field += 1u;
+				m_scope->executed.*field += 1u;
+			}
+
+			uint32_t getSSALoopTripCount( stmt::If const & stmt )const
+			{
+				if ( !stmt.getElseIfList().empty()
+					|| stmt.getElse()
+					|| stmt.size() != 1u
+					|| ( *stmt.begin() )->getKind() != stmt::Kind::eDoWhile )
+				{
+					return 0u;
+				}
+
+				auto & loop = static_cast< stmt::DoWhile const & >( **stmt.begin() );
+				int64_t init{};
+				auto var = getLoopVar( getSimpleExpr( m_previous ), init );
+
+				if ( !var
+					|| loop.empty() )
+				{
+					return 0u;
+				}
+
+				auto step = getSimpleExpr( loop.back().get() );
+				expr::Alias const * alias{};
+
+				if ( loop.size() > 1u )
+				{
+					auto aliasExpr = getSimpleExpr( std::prev( loop.end(), 2 )->get() );
+					alias = ( aliasExpr && aliasExpr->getKind() == expr::Kind::eAlias )
+						? static_cast< expr::Alias const * >( aliasExpr )
+						: nullptr;
+				}
+
+				LoopControl ifControl{};
+				LoopControl loopControl{};
+				int64_t stepValue{};
+
+				if ( !step
+					|| !getStep( *step, alias, *var, stepValue )
+					|| !getControl( *stmt.getCtrlExpr(), *var, ifControl )
+					|| !getControl( *loop.getCtrlExpr(), *var, loopControl )
+					|| ifControl.op != loopControl.op
+					|| ifControl.bound != loopControl.bound )
+				{
+					return 0u;
+				}
+
+				return getTripCount( var->getType()->getKind(), init, loopControl, stepValue );
+			}
+
+		private:
+			ShaderCost & m_result;
+			FunctionCosts m_functions;
+			// The statements outside of the functions (global constants initialisation...).
+			Scope m_global;
+			Scope * m_scope{ &m_global };
+			FunctionCost * m_function{};
+			stmt::Stmt const * m_previous{};
+			uint32_t m_pendingTripCount{};
+		};
+	}
+
+	//*************************************************************************
+
+	ShaderCost analyseCost( stmt::Container const & container )
+	{
+		auto result = cost::StmtCounter::submit( container );
+		auto pressure = analyseRegisterPressure( container );
+		assert( pressure.functions.size() == result.functions.size() );
+
+		for ( size_t i = 0u; i < result.functions.size(); ++i )
+		{
+			result.functions[i].peakLiveValues = pressure.functions[i].maxLiveScalars;
+			result.peakLiveValues = std::max( result.peakLiveValues, result.functions[i].peakLiveValues );
+		}
+
+		return result;
+	}
+
+	//*************************************************************************
+}
@@ -0,0 +1,591 @@
+/*
+See LICENSE file in root folder
+*/
+#include "ShaderAST/Visitors/AnalyseRegisterPressure.hpp"
+
+#include "ShaderAST/Expr/ExprVisitor.hpp"
+#include "ShaderAST/Stmt/StmtVisitor.hpp"
+#include "ShaderAST/Type/TypeStruct.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace ast
+{
+	//*************************************************************************
+
+	namespace live
+	{
+		using LiveSet = std::set< uint32_t >;
+		// The pressure of each function, including the functions it calls.
+		using FunctionPressures = std::unordered_map< uint32_t, uint32_t >;
+
+		struct Access
+		{
+			LiveSet uses;
+			LiveSet defs;
+			// The maximum pressure of the functions called by the expression.
+			uint32_t calls{};
+		};
+
+		struct Analysis
+		{
+			FunctionPressures const & functions;
+			// The scalar components count of each tracked variable.
+			std::unordered_map< uint32_t, uint32_t > scalars;
+			// The maximum pressure reached on each statement.
+			std::unordered_map< stmt::Stmt const *, uint32_t > pressures;
+			// The statements in the order they are first visited, the reverse of source order.
+			std::vector< stmt::Stmt const * > visited;
+		};
+
+		static uint32_t getScalarCount( type::Type const & type )
+		{
+			auto kind = type.getKind();
+
+			if ( kind == type::Kind::eArray )
+			{
+				auto & arrayType = static_cast< type::Array const & >( type );
+				auto size = arrayType.getArraySize();
+				return getScalarCount( *arrayType.getType() )
+					* ( ( size == type::NotArray || size == type::UnknownArraySize ) ? 1u : size );
+			}
+
+			if ( type::isStructType( kind ) )
+			{
+				uint32_t result{};
+
+				for ( auto & member : static_cast< type::Struct const & >( type ) )
+				{
+					result += getScalarCount( *member.type );
+				}
+
+				return result;
+			}
+
+			if ( type::isOpaqueType( kind ) )
+			{
+				return 0u;
+			}
+
+			if ( type::isMatrixType( kind ) )
+			{
+				return type::getComponentCount( kind )
+					* type::getComponentCount( type::getComponentType( kind ) );
+			}
+
+			return type::getComponentCount( kind );
+		}
+
+		static bool isTracked( var::Variable const & var )
+		{
+			return !var.isBuiltin()
+				&& !var.isStatic()
+				&& !var.isShared()
+				&& ( var.isLocale()
+					|| var.isParam()
+					|| var.isLoopVar()
+					|| var.isTempVar()
+					|| var.isAlias() );
+		}
+
+		static LiveSet join( LiveSet lhs
+			, LiveSet const & rhs )
+		{
+			lhs.insert( rhs.begin(), rhs.end() );
+			return lhs;
+		}
+
+		class ExprAccessLister
+			: public expr::SimpleVisitor
+		{
+		public:
+			static Access submit( expr::Expr const & expr
+				, Analysis & analysis )
+			{
+				Access result;
+				ExprAccessLister vis{ analysis, result };
+
+				// Only the writes to the whole variable end its previous live range.
+				if ( auto target = getWholeTarget( expr ) )
+				{
+					vis.add( *target, result.defs );
+
+					if ( auto value = getWrittenValue( expr ) )
+					{
+						value->accept( &vis );
+					}
+				}
+				else
+				{
+					expr.accept( &vis );
+				}
+
+				return result;
+			}
+
+		private:
+			ExprAccessLister( Analysis & analysis
+				, Access & result )
+				: m_analysis{ analysis }
+				, m_result{ result }
+			{
+			}
+
+			static var::Variable const * getWholeTarget( expr::Expr const & expr )
+			{
+				switch ( expr.getKind() )
+				{
+				case expr::Kind::eInit:
+					return static_cast< expr::Init const & >( expr ).hasIdentifier()
+						? static_cast< expr::Init const & >( expr ).getIdentifier().getVariable().get()
+						: nullptr;
+				case expr::Kind::eAssign:
+				case expr::Kind::eAlias:
+					{
+						auto & lhs = *static_cast< expr::Binary const & >( expr ).getLHS();
+						return lhs.getKind() == expr::Kind::eIdentifier
+							? static_cast< expr::Identifier const & >( lhs ).getVariable().get()
+							: nullptr;
+					}
+				default:
+					return nullptr;
+				}
+			}
+
+			static expr::Expr const * getWrittenValue( expr::Expr const & expr )
+			{
+				return expr.getKind() == expr::Kind::eInit
+					? static_cast< expr::Init const & >( expr ).getInitialiser()
+					: static_cast< expr::Binary const & >( expr ).getRHS();
+			}
+
+			void add( var::Variable const & var
+				, LiveSet & set )
+			{
+				if ( isTracked( var ) )
+				{
+					m_analysis.scalars.try_emplace( var.getId(), getScalarCount( *var.getType() ) );
+					set.insert( var.getId() );
+				}
+			}
+
+			void doSubmit( expr::ExprList const & list )
+			{
+				for ( auto & expr : list )
+				{
+					expr->accept( this );
+				}
+			}
+
+			void visitUnaryExpr( expr::Unary const * expr )override
+			{
+				expr->getOperand()->accept( this );
+			}
+
+			void visitBinaryExpr( expr::Binary const * expr )override
+			{
+				expr->getLHS()->accept( this );
+				expr->getRHS()->accept( this );
+			}
+
+			void visitAggrInitExpr( expr::AggrInit const * expr )override
+			{
+				// Filled component by component, so the variable is not defined as a whole.
+				if ( expr->hasIdentifier() )
+				{
+					expr->getIdentifier().accept( this );
+				}
+
+				doSubmit( expr->getInitialisers() );
+			}
+
+			void visitCompositeConstructExpr( expr::CompositeConstruct const * expr )override
+			{
+				doSubmit( expr->getArgList() );
+			}
+
+			void visitMbrSelectExpr( expr::MbrSelect const * expr )override
+			{
+				expr->getOuterExpr()->accept( this );
+			}
+
+			void visitFnCallExpr( expr::FnCall const * expr )override
+			{
+				if ( expr->isMember() )
+				{
+					expr->getInstance()->accept( this );
+				}
+
+				doSubmit( expr->getArgList() );
+
+				if ( auto it = m_analysis.functions.find( expr->getFn()->getVariable()->getId() );
+					it != m_analysis.functions.end() )
+				{
+					m_result.calls = std::max( m_result.calls, it->second );
+				}
+			}
+
+			void visitIntrinsicCallExpr( expr::IntrinsicCall const * expr )override
+			{
+				doSubmit( expr->getArgList() );
+			}
+
+			void visitCombinedImageAccessCallExpr( expr::CombinedImageAccessCall const * expr )override
+			{
+				doSubmit( expr->getArgList() );
+			}
+
+			void visitImageAccessCallExpr( expr::StorageImageAccessCall const * expr )override
+			{
+				doSubmit( expr->getArgList() );
+			}
+
+			void visitIdentifierExpr( expr::Identifier const * expr )override
+			{
+				add( *expr->getVariable(), m_result.uses );
+			}
+
+			void visitInitExpr( expr::Init const * expr )override
+			{
+				if ( expr->hasIdentifier() )
+				{
+					expr->getIdentifier().accept( this );
+				}
+
+				if ( expr->getInitialiser() )
+				{
+					expr->getInitialiser()->accept( this );
+				}
+			}
+
+			void visitLiteralExpr( expr::Literal const * expr )override
+			{
+			}
+
+			void visitQuestionExpr( expr::Question const * expr )override
+			{
+				expr->getCtrlExpr()->accept( this );
+				expr->getTrueExpr()->accept( this );
+				expr->getFalseExpr()->accept( this );
+			}
+
+			void visitStreamAppendExpr( expr::StreamAppend const * expr )override
+			{
+				expr->getOperand()->accept( this );
+			}
+
+			void visitSwitchCaseExpr( expr::SwitchCase const * expr )override
+			{
+			}
+
+			void visitSwitchTestExpr( expr::SwitchTest const * expr )override
+			{
+				expr->getValue()->accept( this );
+			}
+
+			void visitSwizzleExpr( expr::Swizzle const * expr )override
+			{
+				expr->getOuterExpr()->accept( this );
+			}
+
+		private:
+			Analysis & m_analysis;
+			Access & m_result;
+		};
+		/**
+		*	Visits the statements backwards, m_live holds the variables live after the visited statement,
+		*	and then the ones live before it.
+		*/
+		class StmtLivenessAnalyser
+			: public stmt::SimpleVisitor
+		{
+		public:
+			static void submit( stmt::Container const & container
+				, Analysis & analysis )
+			{
+				StmtLivenessAnalyser vis{ analysis };
+				vis.visitContainerStmt( &container );
+			}
+
+		private:
+			explicit StmtLivenessAnalyser( Analysis & analysis )
+				: m_analysis{ analysis }
+			{
+			}
+
+			uint32_t getScalars( LiveSet const & set )const
+			{
+				uint32_t result{};
+
+				for ( auto id : set )
+				{
+					result += m_analysis.scalars.at( id );
+				}
+
+				return result;
+			}
+
+			void record( stmt::Stmt const & stmt
+				, LiveSet const & before
+				, LiveSet const & after
+				, Access const & access )
+			{
+				// The operands and the results of a statement are live together.
+				auto pressure = getScalars( join( join( before, after ), access.defs ) ) + access.calls;
+
+				if ( auto [it, added] = m_analysis.pressures.try_emplace( &stmt, pressure );
+					added )
+				{
+					m_analysis.visited.push_back( &stmt );
+				}
+				else
+				{
+					it->second = std::max( it->second, pressure );
+				}
+			}
+
+			Access getAccess( expr::Expr const * expr )
+			{
+				return expr
+					? ExprAccessLister::submit( *expr, m_analysis )
+					: Access{};
+			}
+			/**
+			*	Computes the variables live before \p expr, from the ones live after it.
+			*/
+			LiveSet process( stmt::Stmt const & stmt
+				, expr::Expr const * expr
+				, LiveSet const & after )
+			{
+				auto access = getAccess( expr );
+				auto result = after;
+
+				for ( auto id : access.defs )
+				{
+					result.erase( id );
+				}
+
+				result = join( std::move( result ), access.uses );
+				record( stmt, result, after, access );
+				return result;
+			}
+
+			void visitContainerStmt( stmt::Container const * cont )override
+			{
+				for ( auto it = std::make_reverse_iterator( cont->end() ); it != std::make_reverse_iterator( cont->begin() ); ++it )
+				{
+					( *it )->accept( this );
+				}
+			}
+
+			void visitBreakStmt( stmt::Break const * stmt )override
+			{
+				m_live = m_breaks.back();
+			}
+
+			void visitContinueStmt( stmt::Continue const * stmt )override
+			{
+				m_live = m_continues.back();
+			}
+
+			void visitDoWhileStmt( stmt::DoWhile const * stmt )override
+			{
+				auto after = m_live;
+				auto cond = process( *stmt, stmt->getCtrlExpr(), after );
+				bool changed{ true };
+				m_breaks.push_back( after );
+
+				while ( changed )
+				{
+					m_continues.push_back( cond );
+					m_live = cond;
+					visitContainerStmt( stmt );
+					m_continues.pop_back();
+					// The condition loops back to the start of the body.
+					auto newCond = process( *stmt, stmt->getCtrlExpr(), join( after, m_live ) );
+					changed = newCond != cond;
+					cond = std::move( newCond );
+				}
+
+				m_breaks.pop_back();
+			}
+
+			void visitForStmt( stmt::For const * stmt )override
+			{
+				auto after = m_live;
+				auto head = process( *stmt, stmt->getCtrlExpr(), after );
+				bool changed{ true };
+				m_breaks.push_back( after );
+
+				while ( changed )
+				{
+					auto incr = process( *stmt, stmt->getIncrExpr(), head );
+					m_continues.push_back( incr );
+					m_live = incr;
+					visitContainerStmt( stmt );
+					m_continues.pop_back();
+					auto newHead = process( *stmt, stmt->getCtrlExpr(), join( after, m_live ) );
+					changed = newHead != head;
+					head = std::move( newHead );
+				}
+
+				m_breaks.pop_back();
+				m_live = process( *stmt, stmt->getInitExpr(), head );
+			}
+
+			void visitIfStmt( stmt::If const * stmt )override
+			{
+				auto after = m_live;
+				auto next = after;
+
+				if ( stmt->getElse() )
+				{
+					visitContainerStmt( stmt->getElse() );
+					next = m_live;
+				}
+
+				auto & elseIfs = stmt->getElseIfList();
+
+				for ( auto it = elseIfs.rbegin(); it != elseIfs.rend(); ++it )
+				{
+					m_live = after;
+					visitContainerStmt( it->get() );
+					next = process( **it, ( *it )->getCtrlExpr(), join( m_live, next ) );
+				}
+
+				m_live = after;
+				visitContainerStmt( stmt );
+				m_live = process( *stmt, stmt->getCtrlExpr(), join( m_live, next ) );
+			}
+
+			void visitIgnoreIntersectionStmt( stmt::IgnoreIntersection const * stmt )override
+			{
+				m_live.clear();
+			}
+
+			void visitReturnStmt( stmt::Return const * stmt )override
+			{
+				m_live = process( *stmt, stmt->getExpr(), {} );
+			}
+
+			void visitSimpleStmt( stmt::Simple const * stmt )override
+			{
+				m_live = process( *stmt, stmt->getExpr(), m_live );
+			}
+
+			void visitSwitchStmt( stmt::Switch const * stmt )override
+			{
+				auto after = m_live;
+				// The cases without a break fall through the next one.
+				auto next = after;
+				auto cases = after;
+				m_breaks.push_back( after );
+
+				for ( auto it = std::make_reverse_iterator( stmt->end() ); it != std::make_reverse_iterator( stmt->begin() ); ++it )
+				{
+					m_live = next;
+					( *it )->accept( this );
+					next = m_live;
+					cases = join( std::move( cases ), m_live );
+				}
+
+				m_breaks.pop_back();
+				m_live = process( *stmt, stmt->getTestExpr(), cases );
+			}
+
+			void visitTerminateInvocationStmt( stmt::TerminateInvocation const * stmt )override
+			{
+				m_live.clear();
+			}
+
+			void visitTerminateRayStmt( stmt::TerminateRay const * stmt )override
+			{
+				m_live.clear();
+			}
+
+			void visitVariableDeclStmt( stmt::VariableDecl const * stmt )override
+			{
+				// The variable holds no value before its declaration.
+				m_live.erase( stmt->getVariable()->getId() );
+			}
+
+			void visitWhileStmt( stmt::While const * stmt )override
+			{
+				auto after = m_live;
+				auto head = process( *stmt, stmt->getCtrlExpr(), after );
+				bool changed{ true };
+				m_breaks.push_back( after );
+
+				while ( changed )
+				{
+					m_continues.push_back( head );
+					m_live = head;
+					visitContainerStmt( stmt );
+					m_continues.pop_back();
+					auto newHead = process( *stmt, stmt->getCtrlExpr(), join( after, m_live ) );
+					changed = newHead != head;
+					head = std::move( newHead );
+				}
+
+				m_breaks.pop_back();
+				m_live = head;
+			}
+
+		private:
+			Analysis & m_analysis;
+			LiveSet m_live;
+			// The variables live after the loop or switch the break statements exit.
+			std::vector< LiveSet > m_breaks;
+			// The variables live at the continue target of the loops.
+			std::vector< LiveSet > m_continues;
+		};
+	}
+
+	//*************************************************************************
+
+	RegisterPressure analyseRegisterPressure( stmt::Container const & container )
+	{
+		RegisterPressure result;
+		live::FunctionPressures functions;
+
+		for ( auto & stmt : container )
+		{
+			if ( stmt->getKind() != stmt::Kind::eFunctionDecl )
+			{
+				continue;
+			}
+
+			auto & decl = static_cast< stmt::FunctionDecl const & >( *stmt );
+			live::Analysis analysis{ functions, {}, {}, {} };
+			live::StmtLivenessAnalyser::submit( decl, analysis );
+			FunctionPressure function{ decl.getName(), decl.isEntryPoint(), {}, {} };
+
+			for ( auto & [statement, pressure] : analysis.pressures )
+			{
+				function.maxLiveScalars = std::max( function.maxLiveScalars, pressure );
+			}
+
+			for ( auto it = analysis.visited.rbegin(); it != analysis.visited.rend(); ++it )
+			{
+				if ( analysis.pressures[*it] == function.maxLiveScalars )
+				{
+					function.peakStatements.push_back( *it );
+				}
+			}
+
+			functions[decl.getFuncVar()->getId()] = function.maxLiveScalars;
+
+			if ( function.entryPoint )
+			{
+				result.entryPointMaxLiveScalars = std::max( result.entryPointMaxLiveScalars, function.maxLiveScalars );
+			}
+
+			result.functions.push_back( std::move( function ) );
+		}
+
+		return result;
+	}
+
+	//*************************************************************************
+}
@@ -146,6 +146,7 @@ namespace ast
 		TraceFunc;
 		auto save = m_current;
 		auto cont = m_stmtCache.makeDoWhile( doSubmit( stmt->getCtrlExpr() ) );
+		cont->setHint( stmt->getHint() );
 		m_current = cont.get();
 		visitContainerStmt( stmt );
 		m_current = save;
@@ -179,6 +180,7 @@ namespace ast
 		auto cont = m_stmtCache.makeFor( doSubmit( stmt->getInitExpr() )
 			, doSubmit( stmt->getCtrlExpr() )
 			, doSubmit( stmt->getIncrExpr() ) );
+		cont->setHint( stmt->getHint() );
 		m_current = cont.get();
 		visitContainerStmt( stmt );
 		m_current = save;
@@ -216,6 +218,7 @@ namespace ast
 		TraceFunc;
 		auto save = m_current;
 		auto cont = m_stmtCache.makeIf( doSubmit( stmt->getCtrlExpr() ) );
+		cont->setHint( stmt->getHint() );
 		m_current = cont.get();
 		visitContainerStmt( stmt );
 		m_current = save;
@@ -472,6 +475,7 @@ namespace ast
 	{
 		TraceFunc;
 		auto cont = m_stmtCache.makeWhile( doSubmit( stmt->getCtrlExpr() ) );
+		cont->setHint( stmt->getHint() );
 
 		auto save = m_current;
 		m_current = cont.get();
@@ -0,0 +1,649 @@
+/*
+See LICENSE file in root folder
+*/
+#include "ShaderAST/Visitors/CoalesceComponents.hpp"
+
+#include "ShaderAST/Expr/ExprCache.hpp"
+#include "ShaderAST/Expr/ExprVisitor.hpp"
+#include "ShaderAST/Stmt/StmtCache.hpp"
+#include "ShaderAST/Type/TypeCache.hpp"
+#include "ShaderAST/Visitors/CloneStmt.hpp"
+#include "ShaderAST/Visitors/ExprSideEffects.hpp"
+#include "ShaderAST/Visitors/GetExprName.hpp"
+
+#include <algorithm>
+
+namespace ast
+{
+	//*************************************************************************
+
+	namespace coalesce
+	{
+		using Lanes = std::vector< expr::Expr const * >;
+
+		struct Lane
+		{
+			// The assigned component index.
+			uint32_t component;
+			// The assigned value.
+			expr::Expr const * value;
+			// The assignment statement, cloned when the lane is not coalesced.
+			stmt::Stmt const * stmt;
+		};
+
+		struct Group
+		{
+			// Sorted by component, once complete.
+			std::vector< Lane > lanes;
+		};
+
+		static bool isSameLiteral( expr::Literal const & lhs
+			, expr::Literal const & rhs )
+		{
+			return lhs.getLiteralType() == rhs.getLiteralType()
+				&& ( lhs == rhs )->getValue< expr::LiteralType::eBool >();
+		}
+		/**
+		*\return
+		*	\p true if \p expr is a variable access that can't depend on the execution: an identifier,
+		*	a member of such an access, or an element of it at a literal index.
+		*/
+		static bool isChain( expr::Expr const & expr )
+		{
+			switch ( expr.getKind() )
+			{
+			case expr::Kind::eIdentifier:
+				return true;
+			case expr::Kind::eMbrSelect:
+				return isChain( *static_cast< expr::MbrSelect const & >( expr ).getOuterExpr() );
+			case expr::Kind::eArrayAccess:
+				return isChain( *static_cast< expr::ArrayAccess const & >( expr ).getLHS() )
+					&& static_cast< expr::ArrayAccess const & >( expr ).getRHS()->getKind() == expr::Kind::eLiteral;
+			default:
+				return false;
+			}
+		}
+
+		static bool isSameChain( expr::Expr const & lhs
+			, expr::Expr const & rhs )
+		{
+			if ( lhs.getKind() != rhs.getKind() )
+			{
+				return false;
+			}
+
+			switch ( lhs.getKind() )
+			{
+			case expr::Kind::eIdentifier:
+				return static_cast< expr::Identifier const & >( lhs ).getVariable()->getId()
+					== static_cast< expr::Identifier const & >( rhs ).getVariable()->getId();
+			case expr::Kind::eMbrSelect:
+				{
+					auto & lhsMbr = static_cast< expr::MbrSelect const & >( lhs );
+					auto & rhsMbr = static_cast< expr::MbrSelect const & >( rhs );
+					return lhsMbr.getMemberIndex() == rhsMbr.getMemberIndex()
+						&& isSameChain( *lhsMbr.getOuterExpr(), *rhsMbr.getOuterExpr() );
+				}
+			case expr::Kind::eArrayAccess:
+				{
+					auto & lhsArr = static_cast< expr::ArrayAccess const & >( lhs );
+					auto & rhsArr = static_cast< expr::ArrayAccess const & >( rhs );
+					return isSameChain( *lhsArr.getLHS(), *rhsArr.getLHS() )
+						&& isSameLiteral( static_cast< expr::Literal const & >( *lhsArr.getRHS() )
+							, static_cast< expr::Literal const & >( *rhsArr.getRHS() ) );
+				}
+			default:
+				return false;
+			}
+		}
+
+		static var::VariablePtr getChainVariable( expr::Expr const & expr )
+		{
+			switch ( expr.getKind() )
+			{
+			case expr::Kind::eIdentifier:
+				return static_cast< expr::Identifier const & >( expr ).getVariable();
+			case expr::Kind::eMbrSelect:
+				return getChainVariable( *static_cast< expr::MbrSelect const & >( expr ).getOuterExpr() );
+			default:
+				return getChainVariable( *static_cast< expr::ArrayAccess const & >( expr ).getLHS() );
+			}
+		}
+		/**
+		*\return
+		*	The accessed vector, if \p expr is the access to a single component of a vector variable.
+		*/
+		static expr::Expr const * getComponentOwner( expr::Expr const & expr
+			, uint32_t & component )
+		{
+			if ( expr.getKind() != expr::Kind::eSwizzle )
+			{
+				return nullptr;
+			}
+
+			auto & swizzle = static_cast< expr::Swizzle const & >( expr );
+			auto outer = swizzle.getOuterExpr();
+
+			if ( !swizzle.getSwizzle().isOneComponent()
+				|| !type::isVectorType( outer->getType() )
+				|| !isChain( *outer ) )
+			{
+				return nullptr;
+			}
+
+			component = swizzle.getSwizzle().toIndex();
+			return outer;
+		}
+		/**
+		*\return
+		*	\p true if \p expr is a scalar that can be gathered with others in a vector.
+		*/
+		static bool isScalarLeaf( expr::Expr const & expr )
+		{
+			uint32_t component{};
+			return expr.getKind() == expr::Kind::eLiteral
+				|| ( isChain( expr ) && type::isScalarType( expr.getType() ) )
+				|| getComponentOwner( expr, component ) != nullptr;
+		}
+
+		static bool isSameLeaf( expr::Expr const & lhs
+			, expr::Expr const & rhs )
+		{
+			if ( lhs.getKind() != rhs.getKind() )
+			{
+				return false;
+			}
+
+			if ( lhs.getKind() == expr::Kind::eLiteral )
+			{
+				return isSameLiteral( static_cast< expr::Literal const & >( lhs )
+					, static_cast< expr::Literal const & >( rhs ) );
+			}
+
+			if ( lhs.getKind() == expr::Kind::eSwizzle )
+			{
+				auto & lhsSwizzle = static_cast< expr::Swizzle const & >( lhs );
+				auto & rhsSwizzle = static_cast< expr::Swizzle const & >( rhs );
+				return lhsSwizzle.getSwizzle().getValue() == rhsSwizzle.getSwizzle().getValue()
+					&& isSameChain( *lhsSwizzle.getOuterExpr(), *rhsSwizzle.getOuterExpr() );
+			}
+
+			return isSameChain( lhs, rhs );
+		}
+
+		static bool areScalarLeaves( Lanes const & lanes )
+		{
+			return std::all_of( lanes.begin()
+				, lanes.end()
+				, []( expr::Expr const * lookup )
+				{
+					return isScalarLeaf( *lookup );
+				} );
+		}
+		/**
+		*\return
+		*	\p true if all the lanes are the same scalar.
+		*/
+		static bool isUniformLeaf( Lanes const & lanes )
+		{
+			return areScalarLeaves( lanes )
+				&& std::all_of( lanes.begin()
+					, lanes.end()
+					, [&lanes]( expr::Expr const * lookup )
+					{
+						return isSameLeaf( *lanes.front(), *lookup );
+					} );
+		}
+		/**
+		*\return
+		*	The vector, if all the lanes access one of its components.
+		*/
+		static expr::Expr const * getSwizzledVector( Lanes const & lanes
+			, std::vector< uint32_t > & components )
+		{
+			expr::Expr const * result{};
+			components.clear();
+
+			for ( auto lane : lanes )
+			{
+				uint32_t component{};
+				auto owner = getComponentOwner( *lane, component );
+
+				if ( !owner
+					|| ( result && !isSameChain( *result, *owner ) ) )
+				{
+					return nullptr;
+				}
+
+				result = owner;
+				components.push_back( component );
+			}
+
+			return result;
+		}
+
+		static expr::SwizzleKind makeSwizzleKind( std::vector< uint32_t > const & components )
+		{
+			expr::SwizzleKind result;
+			uint32_t shift = 0u;
+
+			for ( auto component : components )
+			{
+				result |= expr::SwizzleKind::fromOffset( component ) >> shift;
+				shift += 4u;
+			}
+
+			return result;
+		}
+
+		static bool isIdentity( std::vector< uint32_t > const & components
+			, type::TypePtr vectorType )
+		{
+			if ( components.size() != type::getComponentCount( vectorType ) )
+			{
+				return false;
+			}
+
+			for ( uint32_t i = 0u; i < components.size(); ++i )
+			{
+				if ( components[i] != i )
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		static Lanes getOperands( Lanes const & lanes
+			, bool lhs )
+		{
+			Lanes result;
+
+			for ( auto lane : lanes )
+			{
+				if ( lane->getKind() == expr::Kind::eUnaryMinus )
+				{
+					result.push_back( static_cast< expr::Unary const & >( *lane ).getOperand() );
+				}
+				else
+				{
+					auto & binary = static_cast< expr::Binary const & >( *lane );
+					result.push_back( lhs ? binary.getLHS() : binary.getRHS() );
+				}
+			}
+
+			return result;
+		}
+		/**
+		*\param[out]	swizzled
+		*	Set to \p true if a vector accessed in all the lanes is found, which makes the coalescing worth it.
+		*\return
+		*	\p true if the lanes have the same shape, and can be computed as one vector expression.
+		*/
+		static bool canCoalesce( Lanes const & lanes
+			, bool & swizzled )
+		{
+			auto & first = *lanes.front();
+
+			if ( !type::isScalarType( first.getType() )
+				|| lanes.end() != std::find_if( lanes.begin()
+					, lanes.end()
+					, [&first]( expr::Expr const * lookup )
+					{
+						return lookup->getType()->getKind() != first.getType()->getKind();
+					} ) )
+			{
+				return false;
+			}
+
+			std::vector< uint32_t > components;
+
+			if ( getSwizzledVector( lanes, components ) )
+			{
+				swizzled = true;
+				return true;
+			}
+
+			if ( areScalarLeaves( lanes ) )
+			{
+				return true;
+			}
+
+			if ( lanes.end() != std::find_if( lanes.begin()
+				, lanes.end()
+				, [&first]( expr::Expr const * lookup )
+				{
+					return lookup->getKind() != first.getKind();
+				} ) )
+			{
+				return false;
+			}
+
+			switch ( first.getKind() )
+			{
+			case expr::Kind::eUnaryMinus:
+				return canCoalesce( getOperands( lanes, true ), swizzled );
+			case expr::Kind::eAdd:
+			case expr::Kind::eMinus:
+			case expr::Kind::eTimes:
+			case expr::Kind::eDivide:
+				return canCoalesce( getOperands( lanes, true ), swizzled )
+					&& canCoalesce( getOperands( lanes, false ), swizzled );
+			default:
+				return false;
+			}
+		}
+
+		static Lanes getValues( std::vector< Lane > const & lanes )
+		{
+			Lanes result;
+
+			for ( auto & lane : lanes )
+			{
+				result.push_back( lane.value );
+			}
+
+			return result;
+		}
+		/**
+		*\return
+		*	The vector assigned by \p stmt, if it is the assignment of a single component of a vector variable.
+		*/
+		static expr::Expr const * getAssignedVector( stmt::Stmt const & stmt
+			, uint32_t & component
+			, expr::Expr const *& value )
+		{
+			if ( stmt.getKind() != stmt::Kind::eSimple )
+			{
+				return nullptr;
+			}
+
+			auto & expr = *static_cast< stmt::Simple const & >( stmt ).getExpr();
+
+			if ( expr.getKind() != expr::Kind::eAssign )
+			{
+				return nullptr;
+			}
+
+			auto & assign = static_cast< expr::Assign const & >( expr );
+			auto result = getComponentOwner( *assign.getLHS(), component );
+
+			if ( !result )
+			{
+				return nullptr;
+			}
+
+			auto var = var::getOutermost( getChainVariable( *result ) );
+
+			if ( var->isAlias()
+				|| !( var->isLocale() || var->isShaderOutput() ) )
+			{
+				return nullptr;
+			}
+
+			value = assign.getRHS();
+			return result;
+		}
+		/**
+		*\return
+		*	\p true if \p value can be computed before or after the assignments of the other components of \p var.
+		*/
+		static bool isIndependent( expr::Expr const & value
+			, var::Variable const & var )
+		{
+			if ( hasSideEffects( value ) )
+			{
+				return false;
+			}
+
+			auto idents = listIdentifiers( value );
+			return idents.end() == std::find_if( idents.begin()
+				, idents.end()
+				, [&var]( expr::Identifier const * lookup )
+				{
+					return var::getOutermost( lookup->getVariable() )->getId() == var.getId();
+				} );
+		}
+
+		class StmtCoalescer
+			: public StmtCloner
+		{
+		public:
+			static stmt::ContainerPtr submit( stmt::StmtCache & stmtCache
+				, expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, stmt::Container const & container
+				, ComponentCoalescingStats & stats )
+			{
+				auto result = stmtCache.makeContainer();
+				StmtCoalescer vis{ stmtCache, exprCache, typesCache, stats, result };
+				container.accept( &vis );
+				return result;
+			}
+
+		private:
+			StmtCoalescer( stmt::StmtCache & stmtCache
+				, expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, ComponentCoalescingStats & stats
+				, stmt::ContainerPtr & result )
+				: StmtCloner{ stmtCache, exprCache, result }
+				, m_typesCache{ typesCache }
+				, m_stats{ stats }
+			{
+			}
+
+			using StmtCloner::doSubmit;
+
+			expr::ExprPtr makeVector( Lanes const & lanes
+				, bool keepScalar )
+			{
+				auto & first = *lanes.front();
+				auto scalarKind = first.getType()->getKind();
+				auto count = uint32_t( lanes.size() );
+				std::vector< uint32_t > components;
+
+				if ( keepScalar )
+				{
+					return doSubmit( first );
+				}
+
+				if ( auto vector = getSwizzledVector( lanes, components ) )
+				{
+					if ( isIdentity( components, vector->getType() ) )
+					{
+						return doSubmit( *vector );
+					}
+
+					return m_exprCache.makeSwizzle( doSubmit( *vector )
+						, makeSwizzleKind( components ) );
+				}
+
+				if ( areScalarLeaves( lanes ) )
+				{
+					expr::ExprList args;
+
+					for ( auto lane : lanes )
+					{
+						args.emplace_back( doSubmit( *lane ) );
+					}
+
+					return m_exprCache.makeCompositeConstruct( expr::CompositeType( count - 1u )
+						, scalarKind
+						, std::move( args ) );
+				}
+
+				auto type = m_typesCache.getVector( scalarKind, count );
+
+				if ( first.getKind() == expr::Kind::eUnaryMinus )
+				{
+					return m_exprCache.makeUnaryMinus( makeVector( getOperands( lanes, true ), false ) );
+				}
+
+				auto lhsLanes = getOperands( lanes, true );
+				auto rhsLanes = getOperands( lanes, false );
+				// A float vector can be multiplied by a scalar, the other operations need matching operands.
+				bool broadcast = first.getKind() == expr::Kind::eTimes
+					&& type::isFloatType( scalarKind );
+				bool lhsUniform = broadcast && isUniformLeaf( lhsLanes );
+				bool rhsUniform = broadcast && isUniformLeaf( rhsLanes );
+				auto lhs = makeVector( lhsLanes, lhsUniform && !rhsUniform );
+				auto rhs = makeVector( rhsLanes, rhsUniform && !lhsUniform );
+
+				switch ( first.getKind() )
+				{
+				case expr::Kind::eAdd:
+					return m_exprCache.makeAdd( type, std::move( lhs ), std::move( rhs ) );
+				case expr::Kind::eMinus:
+					return m_exprCache.makeMinus( type, std::move( lhs ), std::move( rhs ) );
+				case expr::Kind::eTimes:
+					return m_exprCache.makeTimes( type, std::move( lhs ), std::move( rhs ) );
+				default:
+					return m_exprCache.makeDivide( type, std::move( lhs ), std::move( rhs ) );
+				}
+			}
+
+			void addGroup( expr::Expr const & vector
+				, Group & group )
+			{
+				std::sort( group.lanes.begin()
+					, group.lanes.end()
+					, []( Lane const & lhs, Lane const & rhs )
+					{
+						return lhs.component < rhs.component;
+					} );
+				std::vector< uint32_t > components;
+
+				for ( auto & lane : group.lanes )
+				{
+					components.push_back( lane.component );
+				}
+
+				auto value = makeVector( getValues( group.lanes ), false );
+				auto target = isIdentity( components, vector.getType() )
+					? doSubmit( vector )
+					: m_exprCache.makeSwizzle( doSubmit( vector ), makeSwizzleKind( components ) );
+				auto type = target->getType();
+				m_current->addStmt( m_stmtCache.makeSimple( m_exprCache.makeAssign( type
+					, std::move( target )
+					, std::move( value ) ) ) );
+				++m_stats.assignments;
+				m_stats.components += uint32_t( group.lanes.size() );
+			}
+
+			/**
+			*	Splits the independent assignments of components of \p vector in groups that can be coalesced,
+			*	and adds them in the order of their first assignment.
+			*/
+			void addRun( expr::Expr const & vector
+				, std::vector< Lane > const & lanes )
+			{
+				std::vector< Group > groups;
+
+				for ( size_t index = 0u; index < lanes.size(); ++index )
+				{
+					auto it = std::find_if( groups.begin()
+						, groups.end()
+						, [&lanes, index]( Group const & lookup )
+						{
+							auto values = getValues( lookup.lanes );
+							values.push_back( lanes[index].value );
+							bool swizzled{};
+							return canCoalesce( values, swizzled )
+								&& swizzled;
+						} );
+
+					if ( it == groups.end() )
+					{
+						groups.push_back( { { lanes[index] } } );
+					}
+					else
+					{
+						it->lanes.push_back( lanes[index] );
+					}
+				}
+
+				for ( auto & group : groups )
+				{
+					if ( group.lanes.size() > 1u )
+					{
+						addGroup( vector, group );
+					}
+					else
+					{
+						group.lanes.front().stmt->accept( this );
+					}
+				}
+			}
+
+			void visitContainerStmt( stmt::Container const * cont )override
+			{
+				auto it = cont->begin();
+
+				while ( it != cont->end() )
+				{
+					uint32_t component{};
+					expr::Expr const * value{};
+					auto vector = getAssignedVector( **it, component, value );
+					auto var = vector ? var::getOutermost( getChainVariable( *vector ) ) : nullptr;
+
+					if ( !vector
+						|| !isIndependent( *value, *var ) )
+					{
+						( *it )->accept( this );
+						++it;
+						continue;
+					}
+
+					std::vector< Lane > lanes{ { component, value, it->get() } };
+					++it;
+
+					while ( it != cont->end() )
+					{
+						auto next = getAssignedVector( **it, component, value );
+
+						if ( !next
+							|| !isSameChain( *vector, *next )
+							|| lanes.end() != std::find_if( lanes.begin()
+								, lanes.end()
+								, [component]( Lane const & lookup )
+								{
+									return lookup.component == component;
+								} )
+							|| !isIndependent( *value, *var ) )
+						{
+							break;
+						}
+
+						lanes.push_back( { component, value, it->get() } );
+						++it;
+					}
+
+					addRun( *vector, lanes );
+				}
+			}
+
+		private:
+			type::TypesCache & m_typesCache;
+			ComponentCoalescingStats & m_stats;
+		};
+	}
+
+	//*************************************************************************
+
+	stmt::ContainerPtr coalesceComponents( stmt::StmtCache & stmtCache
+		, expr::ExprCache & exprCache
+		, type::TypesCache & typesCache
+		, stmt::Container const & container
+		, ComponentCoalescingStats & stats )
+	{
+		return coalesce::StmtCoalescer::submit( stmtCache
+			, exprCache
+			, typesCache
+			, container
+			, stats );
+	}
+
+	//*************************************************************************
+}
@@ -0,0 +1,1231 @@
+/*
+See LICENSE file in root folder
+*/
+#include "ShaderAST/Visitors/EliminateBarriers.hpp"
+
+#include "ShaderAST/Expr/ExprCache.hpp"
+#include "ShaderAST/Expr/ExprVisitor.hpp"
+#include "ShaderAST/Stmt/StmtCache.hpp"
+#include "ShaderAST/Type/TypeCache.hpp"
+#include "ShaderAST/Visitors/CloneStmt.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <optional>
+
+namespace ast
+{
+	//*************************************************************************
+
+	namespace barrier
+	{
+		static constexpr uint32_t StorageMask = uint32_t( type::MemorySemanticsMask::eUniformMemory )
+			| uint32_t( type::MemorySemanticsMask::eSubgroupMemory )
+			| uint32_t( type::MemorySemanticsMask::eWorkgroupMemory )
+			| uint32_t( type::MemorySemanticsMask::eCrossWorkgroupMemory )
+			| uint32_t( type::MemorySemanticsMask::eAtomicCounterMemory )
+			| uint32_t( type::MemorySemanticsMask::eImageMemory )
+			| uint32_t( type::MemorySemanticsMask::eOutputMemory );
+		static constexpr uint32_t OrderingMask = uint32_t( type::MemorySemanticsMask::eAcquire )
+			| uint32_t( type::MemorySemanticsMask::eRelease )
+			| uint32_t( type::MemorySemanticsMask::eAcquireRelease )
+			| uint32_t( type::MemorySemanticsMask::eSequentiallyConsistent );
+
+		struct Access
+		{
+			bool read{};
+			bool write{};
+		};
+
+		// The storage class of a memory (as a MemorySemanticsMask bit), and its variable.
+		using MemoryKey = std::pair< uint32_t, uint32_t >;
+		using Accesses = std::map< MemoryKey, Access >;
+
+		static void merge( Accesses & lhs
+			, Accesses const & rhs )
+		{
+			for ( auto & [key, access] : rhs )
+			{
+				auto & dst = lhs[key];
+				dst.read = dst.read || access.read;
+				dst.write = dst.write || access.write;
+			}
+		}
+		/**
+		*\return
+		*	The storage classes ordered by \p semantics, a barrier without storage class is considered as ordering all of them.
+		*/
+		static uint32_t getClasses( uint32_t semantics )
+		{
+			auto result = semantics & StorageMask;
+			return result
+				? result
+				: StorageMask;
+		}
+		/**
+		*\return
+		*	A value growing with the count of invocations covered by \p scope.
+		*/
+		static uint32_t getScopeRank( uint32_t scope )
+		{
+			switch ( type::Scope( scope ) )
+			{
+			case type::Scope::eCrossDevice:
+				return 6u;
+			case type::Scope::eDevice:
+				return 5u;
+			case type::Scope::eQueueFamily:
+				return 4u;
+			case type::Scope::eWorkgroup:
+				return 3u;
+			case type::Scope::eShaderCall:
+			case type::Scope::eSubgroup:
+				return 2u;
+			default:
+				return 1u;
+			}
+		}
+
+		static uint32_t getWidestScope( uint32_t lhs
+			, uint32_t rhs )
+		{
+			return getScopeRank( lhs ) >= getScopeRank( rhs )
+				? lhs
+				: rhs;
+		}
+
+		static uint32_t combineSemantics( uint32_t lhs
+			, uint32_t rhs )
+		{
+			auto result = ( lhs | rhs ) & ~OrderingMask;
+
+			// Only one ordering is allowed.
+			if ( ( ( lhs | rhs ) & uint32_t( type::MemorySemanticsMask::eSequentiallyConsistent ) ) != 0u )
+			{
+				result |= uint32_t( type::MemorySemanticsMask::eSequentiallyConsistent );
+			}
+			else if ( ( ( lhs | rhs ) & OrderingMask ) != 0u )
+			{
+				result |= uint32_t( type::MemorySemanticsMask::eAcquireRelease );
+			}
+
+			return result;
+		}
+
+		struct Barrier
+		{
+			stmt::Simple const * stmt{};
+			expr::Intrinsic intrinsic{};
+			uint32_t executionScope{};
+			uint32_t memoryScope{};
+			uint32_t semantics{};
+			// The storage classes ordered by the barrier, and by the memory barriers next to it for a control barrier.
+			uint32_t classes{};
+			// A memory barrier next to a control barrier, completing it.
+			bool attached{};
+			bool kept{ true };
+			// The barrier absorbed other barriers, its arguments changed.
+			bool merged{};
+
+			bool isControl()const
+			{
+				return intrinsic == expr::Intrinsic::eControlBarrier;
+			}
+		};
+
+		static bool getUInt32( expr::Expr const & expr
+			, uint32_t & value )
+		{
+			if ( expr.getKind() != expr::Kind::eLiteral )
+			{
+				return false;
+			}
+
+			auto & literal = static_cast< expr::Literal const & >( expr );
+
+			if ( literal.getLiteralType() != expr::LiteralType::eUInt32 )
+			{
+				return false;
+			}
+
+			value = literal.getValue< expr::LiteralType::eUInt32 >();
+			return true;
+		}
+		/**
+		*\return
+		*	The barrier called by \p stmt, if it is a barrier call with literal arguments.
+		*/
+		static std::optional< Barrier > getBarrier( stmt::Simple const & stmt )
+		{
+			auto expr = stmt.getExpr();
+
+			if ( !expr
+				|| expr->getKind() != expr::Kind::eIntrinsicCall )
+			{
+				return std::nullopt;
+			}
+
+			auto & call = static_cast< expr::IntrinsicCall const & >( *expr );
+			auto & args = call.getArgList();
+			Barrier result{ &stmt, call.getIntrinsic() };
+
+			if ( call.getIntrinsic() == expr::Intrinsic::eControlBarrier
+				&& args.size() == 3u
+				&& getUInt32( *args[0], result.executionScope )
+				&& getUInt32( *args[1], result.memoryScope )
+				&& getUInt32( *args[2], result.semantics ) )
+			{
+				result.classes = getClasses( result.semantics );
+				return result;
+			}
+
+			if ( call.getIntrinsic() == expr::Intrinsic::eMemoryBarrier
+				&& args.size() == 2u
+				&& getUInt32( *args[0], result.memoryScope )
+				&& getUInt32( *args[1], result.semantics ) )
+			{
+				result.classes = getClasses( result.semantics );
+				return result;
+			}
+
+			return std::nullopt;
+		}
+
+		enum class BlockKind : uint8_t
+		{
+			// The body of an entry point, nothing happens before or after it.
+			eEntryPoint,
+			// The body of another function, called from unknown places.
+			eFunction,
+			// The statements of a branch or of a compound statement, executed once in their parent.
+			eBranch,
+			// The body of a loop.
+			eLoop,
+			// The statements of a switch case, which can be reached from the previous cases.
+			eSwitchCase,
+		};
+
+		struct Block;
+
+		struct Item
+		{
+			// The accesses of the statement, with its nested statements.
+			Accesses accesses;
+			// The accesses of the control expressions of the statement (condition, loop initialisation and increment).
+			Accesses ctrl;
+			Barrier * barrier{};
+			// The statement contains a jump (return, break, continue, ...).
+			bool jumps{};
+			bool empty{ true };
+		};
+
+		struct Block
+		{
+			BlockKind kind{};
+			Block * parent{};
+			// The index of the statement holding this block, in its parent.
+			size_t index{};
+			// The block is in a compute, task or mesh entry point.
+			bool candidate{};
+			bool jumps{};
+			std::vector< Item > items;
+		};
+
+		struct Analysis
+		{
+			std::vector< std::unique_ptr< Block > > blocks;
+			std::vector< std::unique_ptr< Barrier > > barriers;
+			// The position of the barriers to process, in the statements order.
+			std::vector< std::pair< Block *, size_t > > candidates;
+			// The accesses of each function, with its callees.
+			std::map< uint32_t, Accesses > functions;
+			// The memory accessed through the alias variables.
+			std::map< uint32_t, MemoryKey > aliases;
+			// The accesses of the whole shader.
+			Accesses all;
+		};
+
+		static bool isAtomic( expr::Intrinsic intrinsic )
+		{
+			return intrinsic >= expr::Intrinsic::eAtomicAddI
+				&& intrinsic <= expr::Intrinsic::eAtomicCompSwapU;
+		}
+		/**
+		*\return
+		*	The count of output arguments of \p intrinsic, at the end of its arguments list.
+		*/
+		static size_t getOutputArgsCount( expr::Intrinsic intrinsic )
+		{
+			if ( ( intrinsic >= expr::Intrinsic::eModf1F && intrinsic <= expr::Intrinsic::eModf4D )
+				|| ( intrinsic >= expr::Intrinsic::eFrexp1F && intrinsic <= expr::Intrinsic::eFrexp4D )
+				|| ( intrinsic >= expr::Intrinsic::eUaddCarry1 && intrinsic <= expr::Intrinsic::eUsubBorrow4 ) )
+			{
+				return 1u;
+			}
+
+			if ( intrinsic >= expr::Intrinsic::eUmulExtended1 && intrinsic <= expr::Intrinsic::eImulExtended4 )
+			{
+				return 2u;
+			}
+
+			return 0u;
+		}
+		/**
+		*\return
+		*	The root variable of an access chain (member selections, swizzles and array accesses on a variable),
+		*	\p nullptr if \p expr is a computed value.
+		*/
+		static expr::Identifier const * getAccessChainRoot( expr::Expr const & expr )
+		{
+			switch ( expr.getKind() )
+			{
+			case expr::Kind::eIdentifier:
+				return &static_cast< expr::Identifier const & >( expr );
+			case expr::Kind::eMbrSelect:
+				return getAccessChainRoot( *static_cast< expr::MbrSelect const & >( expr ).getOuterExpr() );
+			case expr::Kind::eSwizzle:
+				return getAccessChainRoot( *static_cast< expr::Swizzle const & >( expr ).getOuterExpr() );
+			case expr::Kind::eArrayAccess:
+				return getAccessChainRoot( *static_cast< expr::ArrayAccess const & >( expr ).getLHS() );
+			default:
+				return nullptr;
+			}
+		}
+		/**
+		*\return
+		*	The memory shared between invocations accessed through \p var.
+		*/
+		static std::optional< MemoryKey > getMemory( Analysis const & analysis
+			, var::VariablePtr const & var )
+		{
+			if ( auto it = analysis.aliases.find( var->getId() );
+				it != analysis.aliases.end() )
+			{
+				return it->second;
+			}
+
+			auto outermost = var::getOutermost( var );
+			auto hasFlag = [&var, &outermost]( var::Flag flag )
+			{
+				return var->hasFlag( flag ) || outermost->hasFlag( flag );
+			};
+
+			if ( hasFlag( var::Flag::eShared )
+				|| hasFlag( var::Flag::ePerTask )
+				|| hasFlag( var::Flag::ePerTaskNV ) )
+			{
+				return MemoryKey{ uint32_t( type::MemorySemanticsMask::eWorkgroupMemory ), outermost->getId() };
+			}
+
+			// The storage buffers can be bound to the same buffer, they are considered as one memory.
+			if ( hasFlag( var::Flag::eStorageBuffer )
+				|| hasFlag( var::Flag::eBufferReference ) )
+			{
+				return MemoryKey{ uint32_t( type::MemorySemanticsMask::eUniformMemory ), 0u };
+			}
+
+			if ( hasFlag( var::Flag::eShaderOutput ) )
+			{
+				return MemoryKey{ uint32_t( type::MemorySemanticsMask::eOutputMemory ), outermost->getId() };
+			}
+
+			return std::nullopt;
+		}
+
+		class ExprAnalyser
+			: public expr::SimpleVisitor
+		{
+		public:
+			static void submit( expr::Expr const & expr
+				, Analysis & analysis
+				, Accesses & accesses )
+			{
+				ExprAnalyser vis{ analysis, accesses };
+				expr.accept( &vis );
+			}
+
+		private:
+			ExprAnalyser( Analysis & analysis
+				, Accesses & accesses )
+				: m_analysis{ analysis }
+				, m_accesses{ accesses }
+			{
+			}
+
+			void mark( std::optional< MemoryKey > const & memory
+				, bool read
+				, bool write )
+			{
+				if ( memory )
+				{
+					auto & access = m_accesses[*memory];
+					access.read = access.read || read;
+					access.write = access.write || write;
+				}
+			}
+			/**
+			*	Marks the variable accessed by an access chain, the indices in the chain are read.
+			*/
+			void access( expr::Expr const & expr
+				, bool read
+				, bool write )
+			{
+				switch ( expr.getKind() )
+				{
+				case expr::Kind::eIdentifier:
+					mark( getMemory( m_analysis, static_cast< expr::Identifier const & >( expr ).getVariable() ), read, write );
+					break;
+				case expr::Kind::eMbrSelect:
+					access( *static_cast< expr::MbrSelect const & >( expr ).getOuterExpr(), read, write );
+					break;
+				case expr::Kind::eSwizzle:
+					access( *static_cast< expr::Swizzle const & >( expr ).getOuterExpr(), read, write );
+					break;
+				case expr::Kind::eArrayAccess:
+					access( *static_cast< expr::ArrayAccess const & >( expr ).getLHS(), read, write );
+					static_cast< expr::ArrayAccess const & >( expr ).getRHS()->accept( this );
+					break;
+				default:
+					expr.accept( this );
+					break;
+				}
+			}
+
+			void visitAlias( expr::Alias const & expr )
+			{
+				auto aliased = expr.getAliasedExpr();
+				auto root = getAccessChainRoot( *aliased );
+				auto memory = root
+					? getMemory( m_analysis, root->getVariable() )
+					: std::nullopt;
+
+				if ( !memory )
+				{
+					aliased->accept( this );
+					return;
+				}
+
+				// The accesses through the alias are the accesses to the aliased memory.
+				m_analysis.aliases[expr.getIdentifier().getVariable()->getId()] = *memory;
+				access( *aliased, false, false );
+			}
+
+			void visitUnaryExpr( expr::Unary const * expr )override
+			{
+				switch ( expr->getKind() )
+				{
+				case expr::Kind::ePreIncrement:
+				case expr::Kind::ePreDecrement:
+				case expr::Kind::ePostIncrement:
+				case expr::Kind::ePostDecrement:
+					access( *expr->getOperand(), true, true );
+					break;
+				default:
+					expr->getOperand()->accept( this );
+					break;
+				}
+			}
+
+			void visitBinaryExpr( expr::Binary const * expr )override
+			{
+				switch ( expr->getKind() )
+				{
+				case expr::Kind::eAlias:
+					visitAlias( static_cast< expr::Alias const & >( *expr ) );
+					break;
+				case expr::Kind::eAssign:
+					access( *expr->getLHS(), false, true );
+					expr->getRHS()->accept( this );
+					break;
+				case expr::Kind::eAddAssign:
+				case expr::Kind::eMinusAssign:
+				case expr::Kind::eTimesAssign:
+				case expr::Kind::eDivideAssign:
+				case expr::Kind::eModuloAssign:
+				case expr::Kind::eLShiftAssign:
+				case expr::Kind::eRShiftAssign:
+				case expr::Kind::eAndAssign:
+				case expr::Kind::eNotAssign:
+				case expr::Kind::eOrAssign:
+				case expr::Kind::eXorAssign:
+					access( *expr->getLHS(), true, true );
+					expr->getRHS()->accept( this );
+					break;
+				default:
+					expr->getLHS()->accept( this );
+					expr->getRHS()->accept( this );
+					break;
+				}
+			}
+
+			void visitAggrInitExpr( expr::AggrInit const * expr )override
+			{
+				for ( auto & init : expr->getInitialisers() )
+				{
+					init->accept( this );
+				}
+			}
+
+			void visitCompositeConstructExpr( expr::CompositeConstruct const * expr )override
+			{
+				for ( auto & arg : expr->getArgList() )
+				{
+					arg->accept( this );
+				}
+			}
+
+			void visitMbrSelectExpr( expr::MbrSelect const * expr )override
+			{
+				expr->getOuterExpr()->accept( this );
+			}
+
+			void visitFnCallExpr( expr::FnCall const * expr )override
+			{
+				if ( expr->isMember() )
+				{
+					access( *expr->getInstance(), true, true );
+				}
+
+				// The accesses done by the callee happen at the call.
+				if ( auto it = m_analysis.functions.find( expr->getFn()->getVariable()->getId() );
+					it != m_analysis.functions.end() )
+				{
+					merge( m_accesses, it->second );
+				}
+
+				auto & fnType = static_cast< type::Function const & >( *expr->getFn()->getType() );
+				auto argIt = expr->getArgList().begin();
+
+				for ( auto & param : fnType )
+				{
+					if ( argIt == expr->getArgList().end() )
+					{
+						break;
+					}
+
+					if ( param->isOutputParam() )
+					{
+						access( **argIt, param->isInputParam(), true );
+					}
+					else
+					{
+						( *argIt )->accept( this );
+					}
+
+					++argIt;
+				}
+
+				for ( ; argIt != expr->getArgList().end(); ++argIt )
+				{
+					( *argIt )->accept( this );
+				}
+			}
+
+			void visitIntrinsicCallExpr( expr::IntrinsicCall const * expr )override
+			{
+				auto & args = expr->getArgList();
+				auto outputs = getOutputArgsCount( expr->getIntrinsic() );
+				size_t index = 0u;
+
+				for ( auto & arg : args )
+				{
+					if ( index == 0u && isAtomic( expr->getIntrinsic() ) )
+					{
+						access( *arg, true, true );
+					}
+					else if ( index + outputs >= args.size() )
+					{
+						access( *arg, false, true );
+					}
+					else
+					{
+						arg->accept( this );
+					}
+
+					++index;
+				}
+			}
+
+			void visitCombinedImageAccessCallExpr( expr::CombinedImageAccessCall const * expr )override
+			{
+				for ( auto & arg : expr->getArgList() )
+				{
+					arg->accept( this );
+				}
+			}
+
+			void visitImageAccessCallExpr( expr::StorageImageAccessCall const * expr )override
+			{
+				auto access = expr->getImageAccess();
+
+				// The storage images can be views on the same image, they are considered as one memory.
+				// The queries don't access the texels.
+				if ( access >= expr::StorageImageAccess::eImageLoad1DF )
+				{
+					mark( MemoryKey{ uint32_t( type::MemorySemanticsMask::eImageMemory ), 0u }
+						, access < expr::StorageImageAccess::eImageStore1DF || access >= expr::StorageImageAccess::eImageAtomicAdd1DU
+						, access >= expr::StorageImageAccess::eImageStore1DF );
+				}
+
+				for ( auto & arg : expr->getArgList() )
+				{
+					arg->accept( this );
+				}
+			}
+
+			void visitIdentifierExpr( expr::Identifier const * expr )override
+			{
+				mark( getMemory( m_analysis, expr->getVariable() ), true, false );
+			}
+
+			void visitInitExpr( expr::Init const * expr )override
+			{
+				if ( auto init = expr->getInitialiser() )
+				{
+					init->accept( this );
+				}
+			}
+
+			void visitLiteralExpr( expr::Literal const * expr )override
+			{
+			}
+
+			void visitQuestionExpr( expr::Question const * expr )override
+			{
+				expr->getCtrlExpr()->accept( this );
+				expr->getTrueExpr()->accept( this );
+				expr->getFalseExpr()->accept( this );
+			}
+
+			void visitStreamAppendExpr( expr::StreamAppend const * expr )override
+			{
+				expr->getOperand()->accept( this );
+			}
+
+			void visitSwitchCaseExpr( expr::SwitchCase const * expr )override
+			{
+			}
+
+			void visitSwitchTestExpr( expr::SwitchTest const * expr )override
+			{
+				expr->getValue()->accept( this );
+			}
+
+			void visitSwizzleExpr( expr::Swizzle const * expr )override
+			{
+				expr->getOuterExpr()->accept( this );
+			}
+
+		private:
+			Analysis & m_analysis;
+			Accesses & m_accesses;
+		};
+
+		static void addAccesses( Analysis & analysis
+			, expr::Expr const * expr
+			, Accesses & accesses )
+		{
+			if ( expr )
+			{
+				ExprAnalyser::submit( *expr, analysis, accesses );
+			}
+		}
+
+		static void addItems( Analysis & analysis
+			, Block & block
+			, stmt::Container const & container );
+
+		static void addBlock( Analysis & analysis
+			, Block & parent
+			, Item & item
+			, stmt::Container const & container
+			, BlockKind kind )
+		{
+			auto & block = *analysis.blocks.emplace_back( std::make_unique< Block >() );
+			block.kind = kind;
+			block.parent = &parent;
+			block.index = parent.items.size();
+			block.candidate = parent.candidate;
+			addItems( analysis, block, container );
+
+			for ( auto & child : block.items )
+			{
+				merge( item.accesses, child.accesses );
+			}
+
+			item.jumps = item.jumps || block.jumps;
+			item.empty = false;
+		}
+
+		static void addItems( Analysis & analysis
+			, Block & block
+			, stmt::Container const & container )
+		{
+			for ( auto & stmt : container )
+			{
+				Item item;
+
+				switch ( stmt->getKind() )
+				{
+				case stmt::Kind::eSimple:
+					if ( auto barrier = getBarrier( static_cast< stmt::Simple const & >( *stmt ) ) )
+					{
+						item.barrier = analysis.barriers.emplace_back( std::make_unique< Barrier >( *barrier ) ).get();
+
+						if ( block.candidate )
+						{
+							analysis.candidates.emplace_back( &block, block.items.size() );
+						}
+					}
+					else
+					{
+						addAccesses( analysis, static_cast< stmt::Simple const & >( *stmt ).getExpr(), item.accesses );
+					}
+					break;
+				case stmt::Kind::eReturn:
+					addAccesses( analysis, static_cast< stmt::Return const & >( *stmt ).getExpr(), item.accesses );
+					item.jumps = true;
+					break;
+				case stmt::Kind::eBreak:
+				case stmt::Kind::eContinue:
+				case stmt::Kind::eDemote:
+				case stmt::Kind::eTerminateInvocation:
+				case stmt::Kind::eTerminateRay:
+				case stmt::Kind::eIgnoreIntersection:
+					item.jumps = true;
+					break;
+				case stmt::Kind::eDispatchMesh:
+					{
+						auto & dispatch = static_cast< stmt::DispatchMesh const & >( *stmt );
+						addAccesses( analysis, dispatch.getNumGroupsX(), item.accesses );
+						addAccesses( analysis, dispatch.getNumGroupsY(), item.accesses );
+						addAccesses( analysis, dispatch.getNumGroupsZ(), item.accesses );
+						addAccesses( analysis, dispatch.getPayload(), item.accesses );
+						item.jumps = true;
+					}
+					break;
+				case stmt::Kind::eIf:
+					{
+						auto & ifStmt = static_cast< stmt::If const & >( *stmt );
+						addAccesses( analysis, ifStmt.getCtrlExpr(), item.ctrl );
+
+						for ( auto & elseIf : ifStmt.getElseIfList() )
+						{
+							addAccesses( analysis, elseIf->getCtrlExpr(), item.ctrl );
+						}
+
+						addBlock( analysis, block, item, ifStmt, BlockKind::eBranch );
+
+						for ( auto & elseIf : ifStmt.getElseIfList() )
+						{
+							addBlock( analysis, block, item, *elseIf, BlockKind::eBranch );
+						}
+
+						if ( auto elseStmt = ifStmt.getElse() )
+						{
+							addBlock( analysis, block, item, *elseStmt, BlockKind::eBranch );
+						}
+					}
+					break;
+				case stmt::Kind::eWhile:
+					addAccesses( analysis, static_cast< stmt::While const & >( *stmt ).getCtrlExpr(), item.ctrl );
+					addBlock( analysis, block, item, static_cast< stmt::While const & >( *stmt ), BlockKind::eLoop );
+					break;
+				case stmt::Kind::eDoWhile:
+					addAccesses( analysis, static_cast< stmt::DoWhile const & >( *stmt ).getCtrlExpr(), item.ctrl );
+					addBlock( analysis, block, item, static_cast< stmt::DoWhile const & >( *stmt ), BlockKind::eLoop );
+					break;
+				case stmt::Kind::eFor:
+					{
+						auto & forStmt = static_cast< stmt::For const & >( *stmt );
+						addAccesses( analysis, forStmt.getInitExpr(), item.ctrl );
+						addAccesses( analysis, forStmt.getCtrlExpr(), item.ctrl );
+						addAccesses( analysis, forStmt.getIncrExpr(), item.ctrl );
+						addBlock( analysis, block, item, forStmt, BlockKind::eLoop );
+					}
+					break;
+				case stmt::Kind::eSwitch:
+					{
+						auto & switchStmt = static_cast< stmt::Switch const & >( *stmt );
+						addAccesses( analysis, switchStmt.getTestExpr(), item.ctrl );
+
+						for ( auto & caseStmt : switchStmt )
+						{
+							addBlock( analysis, block, item, static_cast< stmt::Container const & >( *caseStmt ), BlockKind::eSwitchCase );
+						}
+					}
+					break;
+				case stmt::Kind::eContainer:
+				case stmt::Kind::eCompound:
+					addBlock( analysis, block, item, static_cast< stmt::Container const & >( *stmt ), BlockKind::eBranch );
+					break;
+				default:
+					break;
+				}
+
+				merge( item.accesses, item.ctrl );
+				item.empty = item.empty
+					&& !item.barrier
+					&& !item.jumps
+					&& item.accesses.empty();
+				block.jumps = block.jumps || item.jumps;
+				block.items.push_back( std::move( item ) );
+			}
+		}
+
+		static void addFunctions( Analysis & analysis
+			, stmt::Container const & container )
+		{
+			for ( auto & stmt : container )
+			{
+				if ( stmt->getKind() == stmt::Kind::eContainer )
+				{
+					addFunctions( analysis, static_cast< stmt::Container const & >( *stmt ) );
+				}
+				else if ( stmt->getKind() == stmt::Kind::eFunctionDecl )
+				{
+					auto & function = static_cast< stmt::FunctionDecl const & >( *stmt );
+					auto & block = *analysis.blocks.emplace_back( std::make_unique< Block >() );
+					block.kind = function.isEntryPoint()
+						? BlockKind::eEntryPoint
+						: BlockKind::eFunction;
+					block.candidate = function.isComputeEntryPoint()
+						|| function.isTaskEntryPoint()
+						|| function.isTaskEntryPointNV()
+						|| function.isMeshEntryPoint()
+						|| function.isMeshEntryPointNV();
+					addItems( analysis, block, function );
+					auto & accesses = analysis.functions[function.getFuncVar()->getId()];
+
+					for ( auto & item : block.items )
+					{
+						merge( accesses, item.accesses );
+					}
+
+					merge( analysis.all, accesses );
+				}
+			}
+		}
+		/**
+		*	Merges the barriers only separated by statements without memory access.
+		*/
+		static void mergeAdjacent( Block & block
+			, BarrierEliminationStats & stats )
+		{
+			Barrier * previous{};
+
+			for ( auto & item : block.items )
+			{
+				if ( !item.barrier )
+				{
+					if ( !item.empty )
+					{
+						previous = nullptr;
+					}
+
+					continue;
+				}
+
+				auto & current = *item.barrier;
+
+				if ( previous
+					&& previous->intrinsic == current.intrinsic
+					&& ( !current.isControl() || previous->executionScope == current.executionScope ) )
+				{
+					previous->memoryScope = getWidestScope( previous->memoryScope, current.memoryScope );
+					previous->semantics = combineSemantics( previous->semantics, current.semantics );
+					previous->classes |= current.classes;
+					previous->merged = true;
+					current.kept = false;
+					++stats.merged;
+				}
+				else
+				{
+					previous = &current;
+				}
+			}
+		}
+		/**
+		*	Gives to the control barriers the storage classes of the memory barriers next to them,
+		*	which only order memory for the other invocations through the control barrier.
+		*/
+		static void attachMemoryBarriers( Block & block )
+		{
+			for ( size_t index = 0u; index < block.items.size(); ++index )
+			{
+				auto barrier = block.items[index].barrier;
+
+				if ( !barrier
+					|| !barrier->kept
+					|| !barrier->isControl() )
+				{
+					continue;
+				}
+
+				auto attach = [barrier]( Item const & item )
+				{
+					if ( item.barrier
+						&& item.barrier->kept
+						&& !item.barrier->isControl() )
+					{
+						barrier->classes |= item.barrier->classes;
+						item.barrier->attached = true;
+					}
+
+					return item.empty || item.barrier;
+				};
+
+				for ( auto it = block.items.begin() + ptrdiff_t( index ); it != block.items.begin() && attach( *std::prev( it ) ); --it )
+				{
+				}
+
+				for ( auto it = block.items.begin() + ptrdiff_t( index + 1u ); it != block.items.end() && attach( *it ); ++it )
+				{
+				}
+			}
+		}
+
+		struct Region
+		{
+			Accesses accesses;
+			// The region reaches an unknown path, it can contain any access of the shader.
+			bool unknown{};
+		};
+
+		using Stopper = std::function< bool( Item const & ) >;
+
+		static void scanBefore( Block const & block
+			, size_t index
+			, Stopper const & stops
+			, Region & region );
+		static void scanAfter( Block const & block
+			, size_t index
+			, Stopper const & stops
+			, Region & region );
+
+		static void escapeBefore( Block const & block
+			, Stopper const & stops
+			, Region & region )
+		{
+			switch ( block.kind )
+			{
+			case BlockKind::eEntryPoint:
+				break;
+			case BlockKind::eBranch:
+				merge( region.accesses, block.parent->items[block.index].ctrl );
+				scanBefore( *block.parent, block.index, stops, region );
+				break;
+			case BlockKind::eLoop:
+				// The jumps can skip the barriers of the previous iterations.
+				if ( block.jumps )
+				{
+					region.unknown = true;
+					break;
+				}
+
+				// The end of the previous iteration.
+				for ( auto it = block.items.rbegin(); it != block.items.rend() && !stops( *it ); ++it )
+				{
+					merge( region.accesses, it->accesses );
+				}
+
+				merge( region.accesses, block.parent->items[block.index].ctrl );
+				scanBefore( *block.parent, block.index, stops, region );
+				break;
+			default:
+				region.unknown = true;
+				break;
+			}
+		}
+
+		static void escapeAfter( Block const & block
+			, Stopper const & stops
+			, Region & region )
+		{
+			switch ( block.kind )
+			{
+			case BlockKind::eEntryPoint:
+				break;
+			case BlockKind::eBranch:
+				scanAfter( *block.parent, block.index, stops, region );
+				break;
+			case BlockKind::eLoop:
+				merge( region.accesses, block.parent->items[block.index].ctrl );
+
+				// The start of the next iteration.
+				for ( auto & item : block.items )
+				{
+					if ( stops( item ) )
+					{
+						break;
+					}
+
+					merge( region.accesses, item.accesses );
+
+					if ( item.jumps )
+					{
+						region.unknown = true;
+						return;
+					}
+				}
+
+				scanAfter( *block.parent, block.index, stops, region );
+				break;
+			default:
+				region.unknown = true;
+				break;
+			}
+		}
+		/**
+		*	Gathers the accesses executed before the statement at \p index, up to a barrier stopping the search.
+		*/
+		static void scanBefore( Block const & block
+			, size_t index
+			, Stopper const & stops
+			, Region & region )
+		{
+			for ( auto i = index; i > 0u; --i )
+			{
+				auto & item = block.items[i - 1u];
+
+				if ( stops( item ) )
+				{
+					return;
+				}
+
+				merge( region.accesses, item.accesses );
+			}
+
+			escapeBefore( block, stops, region );
+		}
+		/**
+		*	Gathers the accesses executed after the statement at \p index, up to a barrier stopping the search.
+		*/
+		static void scanAfter( Block const & block
+			, size_t index
+			, Stopper const & stops
+			, Region & region )
+		{
+			for ( auto i = index + 1u; i < block.items.size(); ++i )
+			{
+				auto & item = block.items[i];
+
+				if ( stops( item ) )
+				{
+					return;
+				}
+
+				merge( region.accesses, item.accesses );
+
+				// The jumps leave the block without going through the following barriers.
+				if ( item.jumps )
+				{
+					region.unknown = true;
+					return;
+				}
+			}
+
+			escapeAfter( block, stops, region );
+		}
+
+		static bool hasAccess( Accesses const & accesses
+			, uint32_t storageClass )
+		{
+			return accesses.end() != std::find_if( accesses.begin()
+				, accesses.end()
+				, [storageClass]( Accesses::value_type const & lookup )
+				{
+					return lookup.first.first == storageClass;
+				} );
+		}
+
+		static bool hasConflict( Accesses const & before
+			, Accesses const & after
+			, uint32_t storageClass )
+		{
+			for ( auto & [key, access] : before )
+			{
+				if ( key.first == storageClass )
+				{
+					if ( auto it = after.find( key );
+						it != after.end()
+						&& ( access.write || it->second.write ) )
+					{
+						return true;
+					}
+				}
+			}
+
+			return false;
+		}
+		/**
+		*\return
+		*	\p true if the barrier at \p index in \p block orders accesses that need it.
+		*/
+		static bool isNeeded( Analysis const & analysis
+			, Block const & block
+			, size_t index
+			, BarrierEliminationMode mode )
+		{
+			auto & barrier = *block.items[index].barrier;
+
+			for ( uint32_t storageClass = 1u; storageClass <= barrier.classes; storageClass <<= 1u )
+			{
+				if ( ( barrier.classes & storageClass ) == 0u )
+				{
+					continue;
+				}
+
+				// The search stops at the barriers giving at least the same guarantees for this storage class.
+				Stopper stops = [&barrier, storageClass]( Item const & item )
+				{
+					auto other = item.barrier;
+					return other
+						&& other->kept
+						&& ( other->classes & storageClass ) != 0u
+						&& getScopeRank( other->memoryScope ) >= getScopeRank( barrier.memoryScope )
+						&& ( !barrier.isControl()
+							|| ( other->isControl() && getScopeRank( other->executionScope ) >= getScopeRank( barrier.executionScope ) ) );
+				};
+				Region before;
+				Region after;
+				scanBefore( block, index, stops, before );
+				scanAfter( block, index, stops, after );
+				auto & lhs = before.unknown ? analysis.all : before.accesses;
+				auto & rhs = after.unknown ? analysis.all : after.accesses;
+
+				if ( barrier.isControl() && mode == BarrierEliminationMode::eConflicts
+					? hasConflict( lhs, rhs, storageClass )
+					: ( hasAccess( lhs, storageClass ) && hasAccess( rhs, storageClass ) ) )
+				{
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		using Barriers = std::map< stmt::Simple const *, Barrier const * >;
+
+		class StmtReplacer
+			: public StmtCloner
+		{
+		public:
+			static stmt::ContainerPtr submit( stmt::StmtCache & stmtCache
+				, expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, stmt::Container const & container
+				, Barriers const & barriers )
+			{
+				auto result = stmtCache.makeContainer();
+				StmtReplacer vis{ stmtCache, exprCache, typesCache, barriers, result };
+				container.accept( &vis );
+				return result;
+			}
+
+		private:
+			StmtReplacer( stmt::StmtCache & stmtCache
+				, expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, Barriers const & barriers
+				, stmt::ContainerPtr & result )
+				: StmtCloner{ stmtCache, exprCache, result }
+				, m_typesCache{ typesCache }
+				, m_barriers{ barriers }
+			{
+			}
+
+			void visitSimpleStmt( stmt::Simple const * stmt )override
+			{
+				auto it = m_barriers.find( stmt );
+
+				if ( it == m_barriers.end() )
+				{
+					StmtCloner::visitSimpleStmt( stmt );
+					return;
+				}
+
+				auto & barrier = *it->second;
+
+				if ( !barrier.kept )
+				{
+					return;
+				}
+
+				if ( !barrier.merged )
+				{
+					StmtCloner::visitSimpleStmt( stmt );
+					return;
+				}
+
+				if ( barrier.isControl() )
+				{
+					m_current->addStmt( m_stmtCache.makeSimple( expr::makeControlBarrier( m_exprCache
+						, m_typesCache
+						, type::Scope( barrier.executionScope )
+						, type::Scope( barrier.memoryScope )
+						, type::MemorySemantics( barrier.semantics ) ) ) );
+				}
+				else
+				{
+					m_current->addStmt( m_stmtCache.makeSimple( expr::makeMemoryBarrier( m_exprCache
+						, m_typesCache
+						, type::Scope( barrier.memoryScope )
+						, type::MemorySemantics( barrier.semantics ) ) ) );
+				}
+			}
+
+		private:
+			type::TypesCache & m_typesCache;
+			Barriers const & m_barriers;
+		};
+	}
+
+	//*************************************************************************
+
+	stmt::ContainerPtr eliminateBarriers( stmt::StmtCache & stmtCache
+		, expr::ExprCache & exprCache
+		, type::TypesCache & typesCache
+		, stmt::Container const & container
+		, BarrierEliminationMode mode
+		, BarrierEliminationStats & stats )
+	{
+		barrier::Analysis analysis;
+		barrier::addFunctions( analysis, container );
+
+		for ( auto & block : analysis.blocks )
+		{
+			if ( block->candidate )
+			{
+				barrier::mergeAdjacent( *block, stats );
+				barrier::attachMemoryBarriers( *block );
+			}
+		}
+
+		// The barriers are processed in order, a removed barrier doesn't stop the search of the next ones.
+		for ( auto & [block, index] : analysis.candidates )
+		{
+			auto & barrier = *block->items[index].barrier;
+
+			if ( barrier.kept
+				&& !barrier.attached
+				&& !barrier::isNeeded( analysis, *block, index, mode ) )
+			{
+				barrier.kept = false;
+				++stats.removed;
+			}
+		}
+
+		barrier::Barriers barriers;
+
+		for ( auto & barrier : analysis.barriers )
+		{
+			barriers.emplace( barrier->stmt, barrier.get() );
+		}
+
+		return barrier::StmtReplacer::submit( stmtCache, exprCache, typesCache, container, barriers );
+	}
+
+	//*************************************************************************
+}
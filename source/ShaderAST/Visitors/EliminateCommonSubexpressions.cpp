@@ -0,0 +1,1366 @@
+/*
+See LICENSE file in root folder
+*/
+#include "ShaderAST/Visitors/EliminateCommonSubexpressions.hpp"
+
+#include "ShaderAST/Expr/ExprVisitor.hpp"
+#include "ShaderAST/Stmt/StmtCache.hpp"
+#include "ShaderAST/Stmt/StmtVisitor.hpp"
+#include "ShaderAST/Visitors/CloneExpr.hpp"
+#include "ShaderAST/Visitors/CloneStmt.hpp"
+#include "ShaderAST/Visitors/DebugDisplayStatements.hpp"
+#include "ShaderAST/Visitors/ExprSideEffects.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace ast
+{
+	//*************************************************************************
+
+	namespace cse
+	{
+		using ExprUses = std::unordered_map< expr::Expr const *, uint32_t >;
+
+		struct Dependencies
+		{
+			// The IDs of the read variables, in reading order, with their outer variables.
+			std::vector< uint32_t > vars;
+			// true if a read variable can be modified by a function call or a memory write.
+			bool mutableGlobals{};
+		};
+
+		struct Stores
+		{
+			// The IDs of the written variables, with their outer variables.
+			std::unordered_set< uint32_t > vars;
+			// true if global variables or memory may be written.
+			bool globals{};
+		};
+
+		struct Entry
+		{
+			var::VariablePtr holder;
+			std::unordered_set< uint32_t > deps;
+			bool mutableGlobals{};
+		};
+
+		struct ChildRules
+		{
+			// The stored value, which doesn't need a temporary, the store target holding it.
+			expr::Expr const * value{};
+			// The children that must be kept as they are (l-values).
+			std::vector< expr::Expr const * > plain;
+			// The children that are conditionally evaluated.
+			std::vector< expr::Expr const * > conditional;
+		};
+
+		static bool isStoreKind( expr::Kind kind )
+		{
+			return ( kind >= expr::Kind::eAssign && kind <= expr::Kind::eXorAssign )
+				|| kind == expr::Kind::ePreIncrement
+				|| kind == expr::Kind::ePreDecrement
+				|| kind == expr::Kind::ePostIncrement
+				|| kind == expr::Kind::ePostDecrement
+				|| kind == expr::Kind::eInit
+				|| kind == expr::Kind::eAlias
+				|| kind == expr::Kind::eAggrInit;
+		}
+
+		static bool isAccessChain( expr::Expr const & expr )
+		{
+			switch ( expr.getKind() )
+			{
+			case expr::Kind::eIdentifier:
+				return true;
+			case expr::Kind::eMbrSelect:
+				return isAccessChain( *static_cast< expr::MbrSelect const & >( expr ).getOuterExpr() );
+			case expr::Kind::eSwizzle:
+				return isAccessChain( *static_cast< expr::Swizzle const & >( expr ).getOuterExpr() );
+			case expr::Kind::eArrayAccess:
+				return isAccessChain( *static_cast< expr::ArrayAccess const & >( expr ).getLHS() );
+			default:
+				return false;
+			}
+		}
+
+		static var::VariablePtr getAccessChainRoot( expr::Expr const & expr )
+		{
+			switch ( expr.getKind() )
+			{
+			case expr::Kind::eIdentifier:
+				return static_cast< expr::Identifier const & >( expr ).getVariable();
+			case expr::Kind::eMbrSelect:
+				return getAccessChainRoot( *static_cast< expr::MbrSelect const & >( expr ).getOuterExpr() );
+			case expr::Kind::eSwizzle:
+				return getAccessChainRoot( *static_cast< expr::Swizzle const & >( expr ).getOuterExpr() );
+			case expr::Kind::eArrayAccess:
+				return getAccessChainRoot( *static_cast< expr::ArrayAccess const & >( expr ).getLHS() );
+			default:
+				return nullptr;
+			}
+		}
+
+		static bool isReadOnly( var::Variable const & var )
+		{
+			return var.isUniform()
+				|| var.isPushConstant()
+				|| var.isConstant()
+				|| var.isShaderConstant()
+				|| var.isSpecialisationConstant()
+				|| ( var.isShaderInput() && !var.isShaderOutput() );
+		}
+
+		static bool isFunctionLocal( var::Variable const & var )
+		{
+			return var.isLocale()
+				|| var.isParam()
+				|| var.isLoopVar();
+		}
+
+		static bool isHolder( var::Variable const & var )
+		{
+			return !var.isMemberVar()
+				&& ( var.isLocale() || var.isAlias() || var.isTempVar() )
+				&& !var.isParam()
+				&& !var.isLoopVar()
+				&& !var.isShared()
+				&& !var.isStatic()
+				&& !var.isBuiltin()
+				&& !var.isShaderOutput();
+		}
+
+		static bool isCandidate( expr::Expr const & expr )
+		{
+			switch ( expr.getKind() )
+			{
+			case expr::Kind::eIdentifier:
+			case expr::Kind::eLiteral:
+			case expr::Kind::eComma:
+			case expr::Kind::eCopy:
+			case expr::Kind::eFnCall:
+			case expr::Kind::eStreamAppend:
+			case expr::Kind::eSwitchCase:
+			case expr::Kind::eSwitchTest:
+				return false;
+			default:
+				break;
+			}
+
+			if ( isStoreKind( expr.getKind() )
+				|| expr.isDummy() )
+			{
+				return false;
+			}
+
+			auto type = expr.getType();
+
+			if ( type->getKind() == type::Kind::eVoid
+				|| type->getKind() == type::Kind::eArray
+				|| type::isOpaqueType( type::getNonArrayKind( type ) ) )
+			{
+				return false;
+			}
+
+			// The backends split the shader inputs and outputs structures into one variable per member,
+			// so they are only accessed through their members.
+			if ( type::isStructType( type ) )
+			{
+				if ( auto root = getAccessChainRoot( expr );
+					root && ( root->isShaderInput() || root->isShaderOutput() ) )
+				{
+					return false;
+				}
+			}
+
+			auto effects = getExprEffects( expr );
+			return !effects.sideEffects
+				&& !effects.invocationDependent
+				&& !effects.readsMemory;
+		}
+
+		static ChildRules getChildRules( expr::Expr const & expr )
+		{
+			ChildRules result;
+			auto kind = expr.getKind();
+
+			if ( kind == expr::Kind::eInit )
+			{
+				result.value = static_cast< expr::Init const & >( expr ).getInitialiser();
+			}
+			else if ( kind == expr::Kind::eAlias )
+			{
+				result.value = static_cast< expr::Alias const & >( expr ).getAliasedExpr();
+			}
+			else if ( kind >= expr::Kind::eAssign && kind <= expr::Kind::eXorAssign )
+			{
+				auto & binary = static_cast< expr::Binary const & >( expr );
+				result.plain.push_back( binary.getLHS() );
+
+				if ( kind == expr::Kind::eAssign )
+				{
+					result.value = binary.getRHS();
+				}
+			}
+			else if ( kind == expr::Kind::ePreIncrement
+				|| kind == expr::Kind::ePreDecrement
+				|| kind == expr::Kind::ePostIncrement
+				|| kind == expr::Kind::ePostDecrement
+				|| kind == expr::Kind::eStreamAppend )
+			{
+				result.plain.push_back( static_cast< expr::Unary const & >( expr ).getOperand() );
+			}
+			else if ( kind == expr::Kind::eQuestion )
+			{
+				auto & question = static_cast< expr::Question const & >( expr );
+				result.conditional.push_back( question.getTrueExpr() );
+				result.conditional.push_back( question.getFalseExpr() );
+			}
+			else if ( kind == expr::Kind::eLogAnd
+				|| kind == expr::Kind::eLogOr )
+			{
+				result.conditional.push_back( static_cast< expr::Binary const & >( expr ).getRHS() );
+			}
+			else if ( kind == expr::Kind::eFnCall
+				|| kind == expr::Kind::eIntrinsicCall
+				|| kind == expr::Kind::eImageAccessCall
+				|| kind == expr::Kind::eCombinedImageAccessCall )
+			{
+				// Arguments may be output parameters, or need to be an l-value (interpolateAt*, atomics).
+				auto addArgs = [&result]( expr::ExprList const & args )
+				{
+					for ( auto & arg : args )
+					{
+						if ( isAccessChain( *arg ) )
+						{
+							result.plain.push_back( arg.get() );
+						}
+					}
+				};
+
+				if ( kind == expr::Kind::eFnCall )
+				{
+					auto & call = static_cast< expr::FnCall const & >( expr );
+					addArgs( call.getArgList() );
+
+					if ( call.isMember() )
+					{
+						result.plain.push_back( call.getInstance() );
+					}
+				}
+				else if ( kind == expr::Kind::eIntrinsicCall )
+				{
+					addArgs( static_cast< expr::IntrinsicCall const & >( expr ).getArgList() );
+				}
+				else if ( kind == expr::Kind::eImageAccessCall )
+				{
+					addArgs( static_cast< expr::StorageImageAccessCall const & >( expr ).getArgList() );
+				}
+				else
+				{
+					addArgs( static_cast< expr::CombinedImageAccessCall const & >( expr ).getArgList() );
+				}
+			}
+
+			return result;
+		}
+
+		class DependenciesLister
+			: public expr::SimpleVisitor
+		{
+		public:
+			static Dependencies submit( expr::Expr const & expr )
+			{
+				Dependencies result;
+				DependenciesLister vis{ result };
+				expr.accept( &vis );
+				return result;
+			}
+
+		private:
+			explicit DependenciesLister( Dependencies & result )
+				: m_result{ result }
+			{
+			}
+
+		private:
+			void visitUnaryExpr( expr::Unary const * expr )override
+			{
+				expr->getOperand()->accept( this );
+			}
+
+			void visitBinaryExpr( expr::Binary const * expr )override
+			{
+				expr->getLHS()->accept( this );
+				expr->getRHS()->accept( this );
+			}
+
+			void visitAggrInitExpr( expr::AggrInit const * expr )override
+			{
+				visitList( expr->getInitialisers() );
+			}
+
+			void visitCompositeConstructExpr( expr::CompositeConstruct const * expr )override
+			{
+				visitList( expr->getArgList() );
+			}
+
+			void visitMbrSelectExpr( expr::MbrSelect const * expr )override
+			{
+				expr->getOuterExpr()->accept( this );
+			}
+
+			void visitFnCallExpr( expr::FnCall const * expr )override
+			{
+				if ( expr->isMember() )
+				{
+					expr->getInstance()->accept( this );
+				}
+
+				visitList( expr->getArgList() );
+			}
+
+			void visitIntrinsicCallExpr( expr::IntrinsicCall const * expr )override
+			{
+				visitList( expr->getArgList() );
+			}
+
+			void visitCombinedImageAccessCallExpr( expr::CombinedImageAccessCall const * expr )override
+			{
+				visitList( expr->getArgList() );
+			}
+
+			void visitImageAccessCallExpr( expr::StorageImageAccessCall const * expr )override
+			{
+				visitList( expr->getArgList() );
+			}
+
+			void visitIdentifierExpr( expr::Identifier const * expr )override
+			{
+				auto var = expr->getVariable();
+				auto outermost = var::getOutermost( var );
+
+				if ( !isFunctionLocal( *outermost )
+					&& !isReadOnly( *outermost ) )
+				{
+					m_result.mutableGlobals = true;
+				}
+
+				for ( ; var; var = var->getOuter() )
+				{
+					m_result.vars.push_back( var->getId() );
+				}
+			}
+
+			void visitInitExpr( expr::Init const * expr )override
+			{
+				if ( auto init = expr->getInitialiser() )
+				{
+					init->accept( this );
+				}
+			}
+
+			void visitLiteralExpr( expr::Literal const * expr )override
+			{
+			}
+
+			void visitQuestionExpr( expr::Question const * expr )override
+			{
+				expr->getCtrlExpr()->accept( this );
+				expr->getTrueExpr()->accept( this );
+				expr->getFalseExpr()->accept( this );
+			}
+
+			void visitStreamAppendExpr( expr::StreamAppend const * expr )override
+			{
+				expr->getOperand()->accept( this );
+			}
+
+			void visitSwitchCaseExpr( expr::SwitchCase const * expr )override
+			{
+			}
+
+			void visitSwitchTestExpr( expr::SwitchTest const * expr )override
+			{
+				expr->getValue()->accept( this );
+			}
+
+			void visitSwizzleExpr( expr::Swizzle const * expr )override
+			{
+				expr->getOuterExpr()->accept( this );
+			}
+
+			void visitList( expr::ExprList const & list )
+			{
+				for ( auto & expr : list )
+				{
+					expr->accept( this );
+				}
+			}
+
+		private:
+			Dependencies & m_result;
+		};
+
+		class StoresLister
+			: public expr::SimpleVisitor
+		{
+		public:
+			static void submit( expr::Expr const & expr
+				, Stores & result )
+			{
+				StoresLister vis{ result };
+				expr.accept( &vis );
+			}
+
+		private:
+			explicit StoresLister( Stores & result )
+				: m_result{ result }
+			{
+			}
+
+			void addStore( expr::Expr const & lhs )
+			{
+				addStore( getAccessChainRoot( lhs ) );
+			}
+
+			void addStore( var::VariablePtr var )
+			{
+				for ( ; var; var = var->getOuter() )
+				{
+					m_result.vars.insert( var->getId() );
+				}
+			}
+
+			void addArgStores( expr::ExprList const & list )
+			{
+				for ( auto & arg : list )
+				{
+					if ( isAccessChain( *arg ) )
+					{
+						addStore( *arg );
+					}
+
+					arg->accept( this );
+				}
+			}
+
+		private:
+			void visitUnaryExpr( expr::Unary const * expr )override
+			{
+				switch ( expr->getKind() )
+				{
+				case expr::Kind::ePreIncrement:
+				case expr::Kind::ePreDecrement:
+				case expr::Kind::ePostIncrement:
+				case expr::Kind::ePostDecrement:
+					addStore( *expr->getOperand() );
+					break;
+				default:
+					break;
+				}
+
+				expr->getOperand()->accept( this );
+			}
+
+			void visitBinaryExpr( expr::Binary const * expr )override
+			{
+				if ( expr->getKind() >= expr::Kind::eAssign
+					&& expr->getKind() <= expr::Kind::eXorAssign )
+				{
+					addStore( *expr->getLHS() );
+				}
+				else if ( expr->getKind() == expr::Kind::eAlias )
+				{
+					addStore( *expr->getLHS() );
+				}
+
+				expr->getLHS()->accept( this );
+				expr->getRHS()->accept( this );
+			}
+
+			void visitAggrInitExpr( expr::AggrInit const * expr )override
+			{
+				if ( expr->hasIdentifier() )
+				{
+					addStore( expr->getIdentifier().getVariable() );
+				}
+
+				for ( auto & init : expr->getInitialisers() )
+				{
+					init->accept( this );
+				}
+			}
+
+			void visitCompositeConstructExpr( expr::CompositeConstruct const * expr )override
+			{
+				for ( auto & arg : expr->getArgList() )
+				{
+					arg->accept( this );
+				}
+			}
+
+			void visitMbrSelectExpr( expr::MbrSelect const * expr )override
+			{
+				expr->getOuterExpr()->accept( this );
+			}
+
+			void visitFnCallExpr( expr::FnCall const * expr )override
+			{
+				m_result.globals = true;
+
+				if ( expr->isMember() )
+				{
+					addStore( *expr->getInstance() );
+				}
+
+				addArgStores( expr->getArgList() );
+			}
+
+			void visitIntrinsicCallExpr( expr::IntrinsicCall const * expr )override
+			{
+				if ( hasSideEffects( expr->getIntrinsic() ) )
+				{
+					m_result.globals = true;
+				}
+
+				addArgStores( expr->getArgList() );
+			}
+
+			void visitCombinedImageAccessCallExpr( expr::CombinedImageAccessCall const * expr )override
+			{
+				for ( auto & arg : expr->getArgList() )
+				{
+					arg->accept( this );
+				}
+			}
+
+			void visitImageAccessCallExpr( expr::StorageImageAccessCall const * expr )override
+			{
+				if ( hasSideEffects( expr->getImageAccess() ) )
+				{
+					m_result.globals = true;
+				}
+
+				addArgStores( expr->getArgList() );
+			}
+
+			void visitIdentifierExpr( expr::Identifier const * expr )override
+			{
+			}
+
+			void visitInitExpr( expr::Init const * expr )override
+			{
+				if ( expr->hasIdentifier() )
+				{
+					addStore( expr->getIdentifier().getVariable() );
+				}
+
+				if ( auto init = expr->getInitialiser() )
+				{
+					init->accept( this );
+				}
+			}
+
+			void visitLiteralExpr( expr::Literal const * expr )override
+			{
+			}
+
+			void visitQuestionExpr( expr::Question const * expr )override
+			{
+				expr->getCtrlExpr()->accept( this );
+				expr->getTrueExpr()->accept( this );
+				expr->getFalseExpr()->accept( this );
+			}
+
+			void visitStreamAppendExpr( expr::StreamAppend const * expr )override
+			{
+				m_result.globals = true;
+				expr->getOperand()->accept( this );
+			}
+
+			void visitSwitchCaseExpr( expr::SwitchCase const * expr )override
+			{
+			}
+
+			void visitSwitchTestExpr( expr::SwitchTest const * expr )override
+			{
+				expr->getValue()->accept( this );
+			}
+
+			void visitSwizzleExpr( expr::Swizzle const * expr )override
+			{
+				expr->getOuterExpr()->accept( this );
+			}
+
+		private:
+			Stores & m_result;
+		};
+
+		class StmtStoresLister
+			: public stmt::SimpleVisitor
+		{
+		public:
+			static Stores submit( stmt::Stmt const & stmt )
+			{
+				Stores result;
+				StmtStoresLister vis{ result };
+				stmt.accept( &vis );
+				return result;
+			}
+
+		private:
+			explicit StmtStoresLister( Stores & result )
+				: m_result{ result }
+			{
+			}
+
+			void visitExpr( expr::Expr const * expr )
+			{
+				if ( expr )
+				{
+					StoresLister::submit( *expr, m_result );
+				}
+			}
+
+		private:
+			void visitDispatchMeshStmt( stmt::DispatchMesh const * stmt )override
+			{
+				m_result.globals = true;
+			}
+
+			void visitDoWhileStmt( stmt::DoWhile const * stmt )override
+			{
+				stmt::SimpleVisitor::visitDoWhileStmt( stmt );
+				visitExpr( stmt->getCtrlExpr() );
+			}
+
+			void visitElseIfStmt( stmt::ElseIf const * stmt )override
+			{
+				visitExpr( stmt->getCtrlExpr() );
+				stmt::SimpleVisitor::visitElseIfStmt( stmt );
+			}
+
+			void visitForStmt( stmt::For const * stmt )override
+			{
+				visitExpr( stmt->getInitExpr() );
+				visitExpr( stmt->getCtrlExpr() );
+				visitExpr( stmt->getIncrExpr() );
+				stmt::SimpleVisitor::visitForStmt( stmt );
+			}
+
+			void visitIfStmt( stmt::If const * stmt )override
+			{
+				visitExpr( stmt->getCtrlExpr() );
+				stmt::SimpleVisitor::visitIfStmt( stmt );
+			}
+
+			void visitReturnStmt( stmt::Return const * stmt )override
+			{
+				visitExpr( stmt->getExpr() );
+			}
+
+			void visitSimpleStmt( stmt::Simple const * stmt )override
+			{
+				visitExpr( stmt->getExpr() );
+			}
+
+			void visitSwitchStmt( stmt::Switch const * stmt )override
+			{
+				visitExpr( stmt->getTestExpr() );
+				stmt::SimpleVisitor::visitSwitchStmt( stmt );
+			}
+
+			void visitVariableDeclStmt( stmt::VariableDecl const * stmt )override
+			{
+				// A declaration in a loop gives the variable a new (undefined) value on each iteration.
+				m_result.vars.insert( stmt->getVariable()->getId() );
+			}
+
+			void visitWhileStmt( stmt::While const * stmt )override
+			{
+				visitExpr( stmt->getCtrlExpr() );
+				stmt::SimpleVisitor::visitWhileStmt( stmt );
+			}
+
+		private:
+			Stores & m_result;
+		};
+
+		static uint32_t getWeight( expr::Expr const & expr );
+
+		class WeightCounter
+			: public expr::SimpleVisitor
+		{
+		public:
+			static uint32_t submit( expr::Expr const & expr )
+			{
+				uint32_t result{};
+				WeightCounter vis{ result };
+				expr.accept( &vis );
+				return result;
+			}
+
+		private:
+			explicit WeightCounter( uint32_t & result )
+				: m_result{ result }
+			{
+			}
+
+		private:
+			void visitUnaryExpr( expr::Unary const * expr )override
+			{
+				++m_result;
+				expr->getOperand()->accept( this );
+			}
+
+			void visitBinaryExpr( expr::Binary const * expr )override
+			{
+				++m_result;
+				expr->getLHS()->accept( this );
+				expr->getRHS()->accept( this );
+			}
+
+			void visitAggrInitExpr( expr::AggrInit const * expr )override
+			{
+				++m_result;
+				visitList( expr->getInitialisers() );
+			}
+
+			void visitCompositeConstructExpr( expr::CompositeConstruct const * expr )override
+			{
+				++m_result;
+				visitList( expr->getArgList() );
+			}
+
+			void visitMbrSelectExpr( expr::MbrSelect const * expr )override
+			{
+				++m_result;
+				expr->getOuterExpr()->accept( this );
+			}
+
+			void visitFnCallExpr( expr::FnCall const * expr )override
+			{
+				m_result += 2u;
+				visitList( expr->getArgList() );
+			}
+
+			void visitIntrinsicCallExpr( expr::IntrinsicCall const * expr )override
+			{
+				m_result += 2u;
+				visitList( expr->getArgList() );
+			}
+
+			void visitCombinedImageAccessCallExpr( expr::CombinedImageAccessCall const * expr )override
+			{
+				m_result += 2u;
+				visitList( expr->getArgList() );
+			}
+
+			void visitImageAccessCallExpr( expr::StorageImageAccessCall const * expr )override
+			{
+				m_result += 2u;
+				visitList( expr->getArgList() );
+			}
+
+			void visitIdentifierExpr( expr::Identifier const * expr )override
+			{
+			}
+
+			void visitInitExpr( expr::Init const * expr )override
+			{
+				if ( auto init = expr->getInitialiser() )
+				{
+					init->accept( this );
+				}
+			}
+
+			void visitLiteralExpr( expr::Literal const * expr )override
+			{
+			}
+
+			void visitQuestionExpr( expr::Question const * expr )override
+			{
+				++m_result;
+				expr->getCtrlExpr()->accept( this );
+				expr->getTrueExpr()->accept( this );
+				expr->getFalseExpr()->accept( this );
+			}
+
+			void visitStreamAppendExpr( expr::StreamAppend const * expr )override
+			{
+				expr->getOperand()->accept( this );
+			}
+
+			void visitSwitchCaseExpr( expr::SwitchCase const * expr )override
+			{
+			}
+
+			void visitSwitchTestExpr( expr::SwitchTest const * expr )override
+			{
+				expr->getValue()->accept( this );
+			}
+
+			void visitSwizzleExpr( expr::Swizzle const * expr )override
+			{
+				++m_result;
+				expr->getOuterExpr()->accept( this );
+			}
+
+			void visitList( expr::ExprList const & list )
+			{
+				for ( auto & expr : list )
+				{
+					expr->accept( this );
+				}
+			}
+
+		private:
+			uint32_t & m_result;
+		};
+
+		static uint32_t getWeight( expr::Expr const & expr )
+		{
+			return WeightCounter::submit( expr );
+		}
+
+		static std::string getKey( expr::Expr const & expr
+			, Dependencies const & deps )
+		{
+			// The variables IDs disambiguate the variables sharing a name.
+			auto result = debug::displayExpression( expr );
+			result += "|" + std::to_string( reinterpret_cast< uintptr_t >( expr.getType().get() ) );
+
+			for ( auto id : deps.vars )
+			{
+				result += "|" + std::to_string( id );
+			}
+
+			if ( expr.isNonUniform() )
+			{
+				result += "|NonUniform";
+			}
+
+			return result;
+		}
+
+		class StmtEliminator;
+
+		class ExprRewriter
+			: public ExprCloner
+		{
+		public:
+			static expr::ExprPtr submit( StmtEliminator & owner
+				, expr::ExprCache & exprCache
+				, expr::Expr const & expr
+				, bool allowTemps );
+
+		private:
+			ExprRewriter( StmtEliminator & owner
+				, expr::ExprCache & exprCache
+				, ChildRules rules
+				, bool allowTemps
+				, expr::ExprPtr & result )
+				: ExprCloner{ exprCache, result }
+				, m_owner{ owner }
+				, m_rules{ std::move( rules ) }
+				, m_allowTemps{ allowTemps }
+			{
+			}
+
+			expr::ExprPtr doSubmit( expr::Expr const & expr )override;
+
+		private:
+			StmtEliminator & m_owner;
+			ChildRules m_rules;
+			bool m_allowTemps;
+		};
+
+		class StmtEliminator
+			: public StmtCloner
+		{
+		public:
+			static stmt::ContainerPtr submit( stmt::StmtCache & stmtCache
+				, expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, stmt::Container const & container
+				, SSAData & ssaData
+				, bool useAliases
+				, CommonSubexpressionStats & stats
+				, ExprUses & tempUses
+				, bool dryRun )
+			{
+				auto result = stmtCache.makeContainer();
+				StmtEliminator vis{ stmtCache, exprCache, typesCache, ssaData, useAliases, stats, tempUses, dryRun, result };
+				container.accept( &vis );
+				return result;
+			}
+
+			expr::ExprPtr rewrite( expr::Expr const & expr
+				, bool allowTemps
+				, bool isValue )
+			{
+				bool candidate = isCandidate( expr );
+				Dependencies deps;
+				std::string key;
+
+				if ( candidate )
+				{
+					deps = DependenciesLister::submit( expr );
+					key = getKey( expr, deps );
+
+					if ( auto entry = find( key ) )
+					{
+						return useHolder( *entry, expr );
+					}
+				}
+
+				auto result = ExprRewriter::submit( *this, m_exprCache, expr, allowTemps );
+
+				if ( !candidate )
+				{
+					return result;
+				}
+
+				auto resultDeps = DependenciesLister::submit( *result );
+				auto resultKey = getKey( *result, resultDeps );
+
+				if ( resultKey != key )
+				{
+					if ( auto entry = find( resultKey ) )
+					{
+						return useHolder( *entry, expr );
+					}
+				}
+
+				if ( !allowTemps
+					|| isValue
+					|| getWeight( expr ) < m_minTempWeight
+					|| !needsTemp( expr ) )
+				{
+					return result;
+				}
+
+				auto holder = makeTemp( std::move( result ) );
+				m_tempOrigins.emplace( holder->getId(), &expr );
+				addEntry( key, holder, deps );
+				addEntry( resultKey, holder, resultDeps );
+				return m_exprCache.makeIdentifier( m_typesCache, holder );
+			}
+
+		private:
+			StmtEliminator( stmt::StmtCache & stmtCache
+				, expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, SSAData & ssaData
+				, bool useAliases
+				, CommonSubexpressionStats & stats
+				, ExprUses & tempUses
+				, bool dryRun
+				, stmt::ContainerPtr & result )
+				: StmtCloner{ stmtCache, exprCache, result }
+				, m_typesCache{ typesCache }
+				, m_ssaData{ ssaData }
+				, m_useAliases{ useAliases }
+				, m_stats{ stats }
+				, m_tempUses{ tempUses }
+				, m_dryRun{ dryRun }
+				// Aliases are free when the backend computes them once, local variables need a declaration.
+				, m_minTempWeight{ useAliases ? 1u : 2u }
+			{
+			}
+
+			Entry const * find( std::string const & key )const
+			{
+				for ( auto it = m_scopes.rbegin(); it != m_scopes.rend(); ++it )
+				{
+					if ( auto entry = it->find( key );
+						entry != it->end() )
+					{
+						return &entry->second;
+					}
+				}
+
+				return nullptr;
+			}
+
+			void addEntry( std::string const & key
+				, var::VariablePtr holder
+				, Dependencies const & deps )
+			{
+				Entry entry{ holder
+					, { deps.vars.begin(), deps.vars.end() }
+					, deps.mutableGlobals };
+				entry.deps.insert( holder->getId() );
+				m_scopes.back().emplace( key, std::move( entry ) );
+			}
+
+			void kill( Stores const & stores )
+			{
+				if ( stores.vars.empty() && !stores.globals )
+				{
+					return;
+				}
+
+				for ( auto & scope : m_scopes )
+				{
+					std::erase_if( scope
+						, [&stores]( auto const & lookup )
+						{
+							auto & entry = lookup.second;
+							return ( stores.globals && entry.mutableGlobals )
+								|| std::any_of( entry.deps.begin()
+									, entry.deps.end()
+									, [&stores]( uint32_t id )
+									{
+										return stores.vars.contains( id );
+									} );
+						} );
+				}
+			}
+
+			expr::ExprPtr useHolder( Entry const & entry
+				, expr::Expr const & replaced )
+			{
+				if ( m_dryRun )
+				{
+					if ( auto it = m_tempOrigins.find( entry.holder->getId() );
+						it != m_tempOrigins.end() )
+					{
+						++m_tempUses[it->second];
+					}
+				}
+				else
+				{
+					++m_stats.reused;
+				}
+
+				auto result = m_exprCache.makeIdentifier( m_typesCache, entry.holder );
+
+				if ( replaced.isNonUniform() )
+				{
+					result->updateFlag( expr::Flag::eNonUniform );
+				}
+
+				return result;
+			}
+
+			bool needsTemp( expr::Expr const & expr )const
+			{
+				if ( m_dryRun )
+				{
+					return true;
+				}
+
+				auto it = m_tempUses.find( &expr );
+				return it != m_tempUses.end()
+					&& it->second > 0u;
+			}
+
+			var::VariablePtr makeTemp( expr::ExprPtr value )
+			{
+				++m_ssaData.nextVarId;
+				++m_ssaData.aliasId;
+				auto type = value->getType();
+				auto result = var::makeVariable( m_ssaData.nextVarId
+					, type
+					, "tmp_" + std::to_string( m_ssaData.aliasId )
+					, ( var::Flag::eImplicit
+						| var::Flag::eLocale
+						| var::Flag::eTemp
+						| ( m_useAliases ? var::Flag::eAlias : var::Flag::eNone ) ) );
+
+				if ( m_useAliases )
+				{
+					m_current->addStmt( m_stmtCache.makeSimple( m_exprCache.makeAlias( type
+						, m_exprCache.makeIdentifier( m_typesCache, result )
+						, std::move( value ) ) ) );
+				}
+				else
+				{
+					m_current->addStmt( m_stmtCache.makeSimple( m_exprCache.makeInit( m_exprCache.makeIdentifier( m_typesCache, result )
+						, std::move( value ) ) ) );
+				}
+
+				if ( !m_dryRun )
+				{
+					++m_stats.temporaries;
+				}
+
+				return result;
+			}
+
+			void visitScope( stmt::Container const * cont )
+			{
+				m_scopes.emplace_back();
+				visitContainerStmt( cont );
+				m_scopes.pop_back();
+			}
+
+		private:
+			void visitCompoundStmt( stmt::Compound const * stmt )override
+			{
+				m_scopes.emplace_back();
+				StmtCloner::visitCompoundStmt( stmt );
+				m_scopes.pop_back();
+			}
+
+			void visitDoWhileStmt( stmt::DoWhile const * stmt )override
+			{
+				kill( StmtStoresLister::submit( *stmt ) );
+				m_scopes.emplace_back();
+				StmtCloner::visitDoWhileStmt( stmt );
+				m_scopes.pop_back();
+			}
+
+			void visitElseIfStmt( stmt::ElseIf const * stmt )override
+			{
+				// The control expression is only evaluated when the previous ones failed, hence no temporary.
+				auto save = m_current;
+				auto cont = m_ifStmts.back()->createElseIf( rewrite( *stmt->getCtrlExpr(), false, true ) );
+				m_current = cont;
+				visitScope( stmt );
+				m_current = save;
+			}
+
+			void visitElseStmt( stmt::Else const * stmt )override
+			{
+				auto save = m_current;
+				auto cont = m_ifStmts.back()->createElse();
+				m_current = cont;
+				visitScope( stmt );
+				m_current = save;
+			}
+
+			void visitForStmt( stmt::For const * stmt )override
+			{
+				kill( StmtStoresLister::submit( *stmt ) );
+				m_scopes.emplace_back();
+				StmtCloner::visitForStmt( stmt );
+				m_scopes.pop_back();
+			}
+
+			void visitFunctionDeclStmt( stmt::FunctionDecl const * stmt )override
+			{
+				m_scopes.clear();
+				m_scopes.emplace_back();
+				StmtCloner::visitFunctionDeclStmt( stmt );
+				m_scopes.clear();
+			}
+
+			void visitIfStmt( stmt::If const * stmt )override
+			{
+				auto ctrlExpr = rewrite( *stmt->getCtrlExpr(), true, true );
+				kill( StmtStoresLister::submit( *stmt ) );
+				auto save = m_current;
+				auto cont = m_stmtCache.makeIf( std::move( ctrlExpr ) );
+				cont->setHint( stmt->getHint() );
+				m_current = cont.get();
+				visitScope( stmt );
+				m_current = save;
+				m_ifStmts.push_back( cont.get() );
+				m_current->addStmt( std::move( cont ) );
+
+				for ( auto & elseIf : stmt->getElseIfList() )
+				{
+					elseIf->accept( this );
+				}
+
+				if ( stmt->getElse() )
+				{
+					stmt->getElse()->accept( this );
+				}
+
+				m_ifStmts.pop_back();
+			}
+
+			void visitReturnStmt( stmt::Return const * stmt )override
+			{
+				if ( auto expr = stmt->getExpr() )
+				{
+					m_current->addStmt( m_stmtCache.makeReturn( rewrite( *expr, true, true ) ) );
+				}
+				else
+				{
+					m_current->addStmt( m_stmtCache.makeReturn() );
+				}
+			}
+
+			void visitSimpleStmt( stmt::Simple const * stmt )override
+			{
+				if ( m_scopes.empty() )
+				{
+					StmtCloner::visitSimpleStmt( stmt );
+					return;
+				}
+
+				auto & expr = *stmt->getExpr();
+				expr::ExprPtr result;
+
+				if ( expr.getKind() == expr::Kind::eAlias
+					&& !m_useAliases )
+				{
+					// The backend expands the aliased expression where the alias is used,
+					// the variables it would read instead may have been modified meanwhile.
+					result = doSubmit( expr );
+				}
+				else
+				{
+					result = rewrite( expr, true, true );
+				}
+
+				kill( StmtStoresLister::submit( *stmt ) );
+				m_current->addStmt( m_stmtCache.makeSimple( std::move( result ) ) );
+				registerStore( expr );
+			}
+
+			void visitSwitchCaseStmt( stmt::SwitchCase const * stmt )override
+			{
+				m_scopes.emplace_back();
+				StmtCloner::visitSwitchCaseStmt( stmt );
+				m_scopes.pop_back();
+			}
+
+			void visitSwitchStmt( stmt::Switch const * stmt )override
+			{
+				auto testExpr = rewrite( *stmt->getTestExpr()->getValue(), true, true );
+				kill( StmtStoresLister::submit( *stmt ) );
+				auto save = m_current;
+				auto cont = m_stmtCache.makeSwitch( m_exprCache.makeSwitchTest( std::move( testExpr ) ) );
+				m_switchStmts.push_back( cont.get() );
+				m_current = cont.get();
+				visitContainerStmt( stmt );
+				m_current = save;
+				m_current->addStmt( std::move( cont ) );
+				m_switchStmts.pop_back();
+			}
+
+			void visitWhileStmt( stmt::While const * stmt )override
+			{
+				kill( StmtStoresLister::submit( *stmt ) );
+				// The control expression is evaluated on each iteration, hence no temporary.
+				auto cont = m_stmtCache.makeWhile( rewrite( *stmt->getCtrlExpr(), false, true ) );
+				cont->setHint( stmt->getHint() );
+				auto save = m_current;
+				m_current = cont.get();
+				visitScope( stmt );
+				m_current = save;
+				m_current->addStmt( std::move( cont ) );
+			}
+
+			void registerStore( expr::Expr const & expr )
+			{
+				var::VariablePtr target;
+				expr::Expr const * value{};
+
+				if ( expr.getKind() == expr::Kind::eInit )
+				{
+					auto & init = static_cast< expr::Init const & >( expr );
+					target = init.getIdentifier().getVariable();
+					value = init.getInitialiser();
+				}
+				else if ( expr.getKind() == expr::Kind::eAlias )
+				{
+					auto & alias = static_cast< expr::Alias const & >( expr );
+
+					if ( alias.hasIdentifier() )
+					{
+						target = alias.getIdentifier().getVariable();
+						value = alias.getAliasedExpr();
+					}
+				}
+				else if ( expr.getKind() == expr::Kind::eAssign )
+				{
+					auto & assign = static_cast< expr::Binary const & >( expr );
+
+					if ( assign.getLHS()->getKind() == expr::Kind::eIdentifier )
+					{
+						target = static_cast< expr::Identifier const & >( *assign.getLHS() ).getVariable();
+						value = assign.getRHS();
+					}
+				}
+
+				if ( !target
+					|| !value
+					|| !isHolder( *target )
+					|| target->getType() != value->getType()
+					|| !isCandidate( *value ) )
+				{
+					return;
+				}
+
+				auto deps = DependenciesLister::submit( *value );
+
+				if ( deps.vars.end() == std::find( deps.vars.begin(), deps.vars.end(), target->getId() ) )
+				{
+					addEntry( getKey( *value, deps ), target, deps );
+				}
+			}
+
+		private:
+			type::TypesCache & m_typesCache;
+			SSAData & m_ssaData;
+			bool m_useAliases;
+			CommonSubexpressionStats & m_stats;
+			ExprUses & m_tempUses;
+			bool m_dryRun;
+			uint32_t m_minTempWeight;
+			std::vector< std::unordered_map< std::string, Entry > > m_scopes;
+			std::unordered_map< uint32_t, expr::Expr const * > m_tempOrigins;
+		};
+
+		expr::ExprPtr ExprRewriter::submit( StmtEliminator & owner
+			, expr::ExprCache & exprCache
+			, expr::Expr const & expr
+			, bool allowTemps )
+		{
+			expr::ExprPtr result{};
+			ExprRewriter vis{ owner, exprCache, getChildRules( expr ), allowTemps, result };
+			expr.accept( &vis );
+
+			if ( expr.isNonUniform() )
+			{
+				result->updateFlag( expr::Flag::eNonUniform );
+			}
+
+			return result;
+		}
+
+		expr::ExprPtr ExprRewriter::doSubmit( expr::Expr const & expr )
+		{
+			if ( isStoreKind( expr.getKind() )
+				|| m_rules.plain.end() != std::find( m_rules.plain.begin(), m_rules.plain.end(), &expr ) )
+			{
+				return ExprCloner::submit( m_exprCache, expr );
+			}
+
+			return m_owner.rewrite( expr
+				, m_allowTemps && m_rules.conditional.end() == std::find( m_rules.conditional.begin(), m_rules.conditional.end(), &expr )
+				, &expr == m_rules.value );
+		}
+	}
+
+	//*************************************************************************
+
+	stmt::ContainerPtr eliminateCommonSubexpressions( stmt::StmtCache & stmtCache
+		, expr::ExprCache & exprCache
+		, type::TypesCache & typesCache
+		, stmt::Container const & container
+		, SSAData & ssaData
+		, bool useAliases
+		, CommonSubexpressionStats & stats )
+	{
+		// The first run creates a temporary for each candidate, and counts their uses.
+		// The second one only creates the temporaries that were used.
+		cse::ExprUses tempUses;
+		{
+			auto dryData = ssaData;
+			CommonSubexpressionStats dryStats;
+			cse::StmtEliminator::submit( stmtCache, exprCache, typesCache, container, dryData, useAliases, dryStats, tempUses, true );
+		}
+		return cse::StmtEliminator::submit( stmtCache, exprCache, typesCache, container, ssaData, useAliases, stats, tempUses, false );
+	}
+
+	//*************************************************************************
+}
@@ -0,0 +1,761 @@
+/*
+See LICENSE file in root folder
+*/
+#include "ShaderAST/Visitors/EliminateDeadCode.hpp"
+
+#include "ShaderAST/Expr/ExprVisitor.hpp"
+#include "ShaderAST/Stmt/StmtCache.hpp"
+#include "ShaderAST/Stmt/StmtVisitor.hpp"
+#include "ShaderAST/Visitors/CloneStmt.hpp"
+#include "ShaderAST/Visitors/ExprSideEffects.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace ast
+{
+	//*************************************************************************
+
+	namespace dce
+	{
+		static uint32_t constexpr MaxPasses = 16u;
+
+		struct Usage
+		{
+			// The variables appearing anywhere.
+			std::unordered_set< uint32_t > referenced;
+			// The variables appearing elsewhere than as the target of a plain store.
+			std::unordered_set< uint32_t > read;
+			// The variables having a store that can't be removed, nor reduced to its value.
+			std::unordered_set< uint32_t > unremovable;
+			// The names of the called functions.
+			std::unordered_set< std::string > callees;
+
+			void merge( Usage const & rhs )
+			{
+				referenced.insert( rhs.referenced.begin(), rhs.referenced.end() );
+				read.insert( rhs.read.begin(), rhs.read.end() );
+				unremovable.insert( rhs.unremovable.begin(), rhs.unremovable.end() );
+				callees.insert( rhs.callees.begin(), rhs.callees.end() );
+			}
+		};
+
+		struct Liveness
+		{
+			Usage usage;
+			std::unordered_set< std::string > functions;
+			bool allFunctions{};
+		};
+
+		static var::VariablePtr getStoreTarget( expr::Expr const & expr )
+		{
+			var::VariablePtr result{};
+
+			switch ( expr.getKind() )
+			{
+			case expr::Kind::eInit:
+				if ( auto & init = static_cast< expr::Init const & >( expr );
+					init.hasIdentifier() )
+				{
+					result = init.getIdentifier().getVariable();
+				}
+				break;
+			case expr::Kind::eAlias:
+				if ( auto & alias = static_cast< expr::Alias const & >( expr );
+					alias.hasIdentifier() )
+				{
+					result = alias.getIdentifier().getVariable();
+				}
+				break;
+			case expr::Kind::eAggrInit:
+				if ( auto & aggrInit = static_cast< expr::AggrInit const & >( expr );
+					aggrInit.hasIdentifier() )
+				{
+					result = aggrInit.getIdentifier().getVariable();
+				}
+				break;
+			case expr::Kind::eAssign:
+				if ( auto lhs = static_cast< expr::Binary const & >( expr ).getLHS();
+					lhs->getKind() == expr::Kind::eIdentifier )
+				{
+					result = static_cast< expr::Identifier const & >( *lhs ).getVariable();
+				}
+				break;
+			default:
+				break;
+			}
+
+			if ( result && result->isMemberVar() )
+			{
+				result.reset();
+			}
+
+			return result;
+		}
+
+		static std::vector< expr::Expr const * > getStoredValues( expr::Expr const & expr )
+		{
+			std::vector< expr::Expr const * > result;
+
+			switch ( expr.getKind() )
+			{
+			case expr::Kind::eInit:
+				if ( auto value = static_cast< expr::Init const & >( expr ).getInitialiser() )
+				{
+					result.push_back( value );
+				}
+				break;
+			case expr::Kind::eAlias:
+				result.push_back( static_cast< expr::Alias const & >( expr ).getAliasedExpr() );
+				break;
+			case expr::Kind::eAggrInit:
+				for ( auto & value : static_cast< expr::AggrInit const & >( expr ).getInitialisers() )
+				{
+					result.push_back( value.get() );
+				}
+				break;
+			case expr::Kind::eAssign:
+				result.push_back( static_cast< expr::Binary const & >( expr ).getRHS() );
+				break;
+			default:
+				break;
+			}
+
+			return result;
+		}
+
+		static bool isCall( expr::Expr const & expr )
+		{
+			return expr.getKind() == expr::Kind::eFnCall
+				|| expr.getKind() == expr::Kind::eIntrinsicCall
+				|| expr.getKind() == expr::Kind::eImageAccessCall;
+		}
+
+		static bool isRemovableStoreTarget( var::Variable const & var )
+		{
+			return ( var.isLocale() || var.isAlias() || var.isTempVar() )
+				&& !var.isParam()
+				&& !var.isStatic()
+				&& !var.isShared()
+				&& !var.isLoopVar()
+				&& !var.isBuiltin()
+				&& !var.isShaderOutput();
+		}
+
+		static bool isJump( stmt::Kind kind )
+		{
+			return kind == stmt::Kind::eReturn
+				|| kind == stmt::Kind::eBreak
+				|| kind == stmt::Kind::eContinue
+				|| kind == stmt::Kind::eTerminateInvocation
+				|| kind == stmt::Kind::eTerminateRay
+				|| kind == stmt::Kind::eIgnoreIntersection;
+		}
+
+		class ExprUsageLister
+			: public expr::SimpleVisitor
+		{
+		public:
+			static void submit( expr::Expr const & expr
+				, Usage & result )
+			{
+				ExprUsageLister vis{ result };
+				expr.accept( &vis );
+			}
+
+		private:
+			explicit ExprUsageLister( Usage & result )
+				: m_result{ result }
+			{
+			}
+
+		private:
+			void visitUnaryExpr( expr::Unary const * expr )override
+			{
+				expr->getOperand()->accept( this );
+			}
+
+			void visitBinaryExpr( expr::Binary const * expr )override
+			{
+				expr->getLHS()->accept( this );
+				expr->getRHS()->accept( this );
+			}
+
+			void visitAggrInitExpr( expr::AggrInit const * expr )override
+			{
+				if ( expr->hasIdentifier() )
+				{
+					expr->getIdentifier().accept( this );
+				}
+
+				for ( auto & arg : expr->getInitialisers() )
+				{
+					arg->accept( this );
+				}
+			}
+
+			void visitCompositeConstructExpr( expr::CompositeConstruct const * expr )override
+			{
+				for ( auto & arg : expr->getArgList() )
+				{
+					arg->accept( this );
+				}
+			}
+
+			void visitMbrSelectExpr( expr::MbrSelect const * expr )override
+			{
+				expr->getOuterExpr()->accept( this );
+			}
+
+			void visitFnCallExpr( expr::FnCall const * expr )override
+			{
+				m_result.callees.insert( expr->getFn()->getVariable()->getName() );
+
+				if ( expr->isMember() )
+				{
+					expr->getInstance()->accept( this );
+				}
+
+				for ( auto & arg : expr->getArgList() )
+				{
+					arg->accept( this );
+				}
+			}
+
+			void visitIntrinsicCallExpr( expr::IntrinsicCall const * expr )override
+			{
+				for ( auto & arg : expr->getArgList() )
+				{
+					arg->accept( this );
+				}
+			}
+
+			void visitCombinedImageAccessCallExpr( expr::CombinedImageAccessCall const * expr )override
+			{
+				for ( auto & arg : expr->getArgList() )
+				{
+					arg->accept( this );
+				}
+			}
+
+			void visitImageAccessCallExpr( expr::StorageImageAccessCall const * expr )override
+			{
+				for ( auto & arg : expr->getArgList() )
+				{
+					arg->accept( this );
+				}
+			}
+
+			void visitIdentifierExpr( expr::Identifier const * expr )override
+			{
+				for ( auto var = expr->getVariable(); var; var = var->getOuter() )
+				{
+					m_result.referenced.insert( var->getId() );
+					m_result.read.insert( var->getId() );
+				}
+			}
+
+			void visitInitExpr( expr::Init const * expr )override
+			{
+				if ( expr->hasIdentifier() )
+				{
+					expr->getIdentifier().accept( this );
+				}
+
+				if ( auto init = expr->getInitialiser() )
+				{
+					init->accept( this );
+				}
+			}
+
+			void visitLiteralExpr( expr::Literal const * expr )override
+			{
+			}
+
+			void visitQuestionExpr( expr::Question const * expr )override
+			{
+				expr->getCtrlExpr()->accept( this );
+				expr->getTrueExpr()->accept( this );
+				expr->getFalseExpr()->accept( this );
+			}
+
+			void visitStreamAppendExpr( expr::StreamAppend const * expr )override
+			{
+				expr->getOperand()->accept( this );
+			}
+
+			void visitSwitchCaseExpr( expr::SwitchCase const * expr )override
+			{
+			}
+
+			void visitSwitchTestExpr( expr::SwitchTest const * expr )override
+			{
+				expr->getValue()->accept( this );
+			}
+
+			void visitSwizzleExpr( expr::Swizzle const * expr )override
+			{
+				expr->getOuterExpr()->accept( this );
+			}
+
+		private:
+			Usage & m_result;
+		};
+
+		class StmtUsageLister
+			: public stmt::SimpleVisitor
+		{
+		public:
+			static Liveness submit( stmt::Container const & container )
+			{
+				Usage globals;
+				std::unordered_map< std::string, Usage > functions;
+				std::vector< std::string > roots;
+				StmtUsageLister vis{ globals, functions, roots };
+				container.accept( &vis );
+
+				Liveness result;
+				result.usage = std::move( globals );
+				result.allFunctions = roots.empty();
+
+				if ( result.allFunctions )
+				{
+					for ( auto & function : functions )
+					{
+						result.functions.insert( function.first );
+						result.usage.merge( function.second );
+					}
+
+					return result;
+				}
+
+				while ( !roots.empty() )
+				{
+					auto name = std::move( roots.back() );
+					roots.pop_back();
+
+					if ( result.functions.insert( name ).second )
+					{
+						auto & usage = functions[name];
+						result.usage.merge( usage );
+						roots.insert( roots.end(), usage.callees.begin(), usage.callees.end() );
+					}
+				}
+
+				return result;
+			}
+
+		private:
+			StmtUsageLister( Usage & globals
+				, std::unordered_map< std::string, Usage > & functions
+				, std::vector< std::string > & roots )
+				: m_current{ &globals }
+				, m_functions{ functions }
+				, m_roots{ roots }
+			{
+			}
+
+			void visitExpr( expr::Expr const * expr )
+			{
+				if ( expr )
+				{
+					ExprUsageLister::submit( *expr, *m_current );
+				}
+			}
+
+		private:
+			void visitDispatchMeshStmt( stmt::DispatchMesh const * stmt )override
+			{
+				visitExpr( stmt->getNumGroupsX() );
+				visitExpr( stmt->getNumGroupsY() );
+				visitExpr( stmt->getNumGroupsZ() );
+				visitExpr( stmt->getPayload() );
+			}
+
+			void visitDoWhileStmt( stmt::DoWhile const * stmt )override
+			{
+				stmt::SimpleVisitor::visitDoWhileStmt( stmt );
+				visitExpr( stmt->getCtrlExpr() );
+			}
+
+			void visitElseIfStmt( stmt::ElseIf const * stmt )override
+			{
+				visitExpr( stmt->getCtrlExpr() );
+				stmt::SimpleVisitor::visitElseIfStmt( stmt );
+			}
+
+			void visitForStmt( stmt::For const * stmt )override
+			{
+				visitExpr( stmt->getInitExpr() );
+				visitExpr( stmt->getCtrlExpr() );
+				visitExpr( stmt->getIncrExpr() );
+				stmt::SimpleVisitor::visitForStmt( stmt );
+			}
+
+			void visitFunctionDeclStmt( stmt::FunctionDecl const * stmt )override
+			{
+				auto save = m_current;
+				// Overloads share their usage, which is conservative.
+				m_current = &m_functions[stmt->getName()];
+
+				if ( stmt->getFlags() != 0u )
+				{
+					m_roots.push_back( stmt->getName() );
+				}
+
+				stmt::SimpleVisitor::visitFunctionDeclStmt( stmt );
+				m_current = save;
+			}
+
+			void visitIfStmt( stmt::If const * stmt )override
+			{
+				visitExpr( stmt->getCtrlExpr() );
+				stmt::SimpleVisitor::visitIfStmt( stmt );
+			}
+
+			void visitReturnStmt( stmt::Return const * stmt )override
+			{
+				visitExpr( stmt->getExpr() );
+			}
+
+			void visitSimpleStmt( stmt::Simple const * stmt )override
+			{
+				auto target = getStoreTarget( *stmt->getExpr() );
+
+				if ( !target )
+				{
+					visitExpr( stmt->getExpr() );
+					return;
+				}
+
+				// The target of a plain store is referenced, but not read.
+				m_current->referenced.insert( target->getId() );
+
+				for ( auto value : getStoredValues( *stmt->getExpr() ) )
+				{
+					visitExpr( value );
+
+					// Side effects of calls can be kept without the store, others can't.
+					if ( !isCall( *value ) && hasSideEffects( *value ) )
+					{
+						m_current->unremovable.insert( target->getId() );
+					}
+				}
+			}
+
+			void visitSwitchStmt( stmt::Switch const * stmt )override
+			{
+				visitExpr( stmt->getTestExpr() );
+				stmt::SimpleVisitor::visitSwitchStmt( stmt );
+			}
+
+			void visitWhileStmt( stmt::While const * stmt )override
+			{
+				visitExpr( stmt->getCtrlExpr() );
+				stmt::SimpleVisitor::visitWhileStmt( stmt );
+			}
+
+		private:
+			Usage * m_current;
+			std::unordered_map< std::string, Usage > & m_functions;
+			std::vector< std::string > & m_roots;
+		};
+
+		class StmtEliminator
+			: public StmtCloner
+		{
+		public:
+			static stmt::ContainerPtr submit( stmt::StmtCache & stmtCache
+				, expr::ExprCache & exprCache
+				, stmt::Container const & container
+				, Liveness const & liveness
+				, DeadCodeStats & stats )
+			{
+				auto result = stmtCache.makeContainer();
+				StmtEliminator vis{ stmtCache, exprCache, liveness, stats, result };
+				container.accept( &vis );
+				return result;
+			}
+
+		private:
+			StmtEliminator( stmt::StmtCache & stmtCache
+				, expr::ExprCache & exprCache
+				, Liveness const & liveness
+				, DeadCodeStats & stats
+				, stmt::ContainerPtr & result )
+				: StmtCloner{ stmtCache, exprCache, result }
+				, m_liveness{ liveness }
+				, m_stats{ stats }
+			{
+			}
+
+			bool isReferenced( var::VariablePtr const & var )const
+			{
+				return m_liveness.usage.referenced.contains( var->getId() );
+			}
+
+			bool isRemovableStore( var::Variable const & var )const
+			{
+				return isRemovableStoreTarget( var )
+					&& !m_liveness.usage.read.contains( var.getId() )
+					&& !m_liveness.usage.unremovable.contains( var.getId() );
+			}
+
+			bool isReferencedBlock( stmt::Container const & stmt )const
+			{
+				return std::any_of( stmt.begin()
+					, stmt.end()
+					, [this]( stmt::StmtPtr const & lookup )
+					{
+						return lookup->getKind() != stmt::Kind::eVariableDecl
+							|| isReferenced( static_cast< stmt::VariableDecl const & >( *lookup ).getVariable() );
+					} );
+			}
+
+		private:
+			void visitContainerStmt( stmt::Container const * cont )override
+			{
+				for ( auto it = cont->begin(); it != cont->end(); ++it )
+				{
+					( *it )->accept( this );
+
+					if ( isJump( ( *it )->getKind() ) )
+					{
+						m_stats.statements += uint32_t( std::distance( std::next( it ), cont->end() ) );
+						break;
+					}
+				}
+			}
+
+			void visitAccelerationStructureDeclStmt( stmt::AccelerationStructureDecl const * stmt )override
+			{
+				if ( isReferenced( stmt->getVariable() ) )
+				{
+					StmtCloner::visitAccelerationStructureDeclStmt( stmt );
+				}
+				else
+				{
+					++m_stats.declarations;
+				}
+			}
+
+			void visitConstantBufferDeclStmt( stmt::ConstantBufferDecl const * stmt )override
+			{
+				if ( isReferencedBlock( *stmt ) )
+				{
+					++m_blockLevel;
+					StmtCloner::visitConstantBufferDeclStmt( stmt );
+					--m_blockLevel;
+				}
+				else
+				{
+					++m_stats.declarations;
+				}
+			}
+
+			void visitPushConstantsBufferDeclStmt( stmt::PushConstantsBufferDecl const * stmt )override
+			{
+				if ( isReferencedBlock( *stmt ) )
+				{
+					++m_blockLevel;
+					StmtCloner::visitPushConstantsBufferDeclStmt( stmt );
+					--m_blockLevel;
+				}
+				else
+				{
+					++m_stats.declarations;
+				}
+			}
+
+			void visitFunctionDeclStmt( stmt::FunctionDecl const * stmt )override
+			{
+				if ( m_liveness.allFunctions
+					|| m_liveness.functions.contains( stmt->getName() ) )
+				{
+					StmtCloner::visitFunctionDeclStmt( stmt );
+				}
+				else
+				{
+					++m_stats.functions;
+				}
+			}
+
+			void visitImageDeclStmt( stmt::ImageDecl const * stmt )override
+			{
+				if ( isReferenced( stmt->getVariable() ) )
+				{
+					StmtCloner::visitImageDeclStmt( stmt );
+				}
+				else
+				{
+					++m_stats.declarations;
+				}
+			}
+
+			void visitInOutVariableDeclStmt( stmt::InOutVariableDecl const * stmt )override
+			{
+				auto var = stmt->getVariable();
+
+				// Outputs are kept, since the next stage may read them.
+				if ( var->isShaderOutput()
+					|| !var->isShaderInput()
+					|| isReferenced( var ) )
+				{
+					StmtCloner::visitInOutVariableDeclStmt( stmt );
+				}
+				else
+				{
+					++m_stats.declarations;
+				}
+			}
+
+			void visitSampledImageDeclStmt( stmt::SampledImageDecl const * stmt )override
+			{
+				if ( isReferenced( stmt->getVariable() ) )
+				{
+					StmtCloner::visitSampledImageDeclStmt( stmt );
+				}
+				else
+				{
+					++m_stats.declarations;
+				}
+			}
+
+			void visitCombinedImageDeclStmt( stmt::CombinedImageDecl const * stmt )override
+			{
+				if ( isReferenced( stmt->getVariable() ) )
+				{
+					StmtCloner::visitCombinedImageDeclStmt( stmt );
+				}
+				else
+				{
+					++m_stats.declarations;
+				}
+			}
+
+			void visitSamplerDeclStmt( stmt::SamplerDecl const * stmt )override
+			{
+				if ( isReferenced( stmt->getVariable() ) )
+				{
+					StmtCloner::visitSamplerDeclStmt( stmt );
+				}
+				else
+				{
+					++m_stats.declarations;
+				}
+			}
+
+			void visitShaderBufferDeclStmt( stmt::ShaderBufferDecl const * stmt )override
+			{
+				if ( isReferenced( stmt->getVariable() )
+					|| isReferencedBlock( *stmt ) )
+				{
+					++m_blockLevel;
+					StmtCloner::visitShaderBufferDeclStmt( stmt );
+					--m_blockLevel;
+				}
+				else
+				{
+					++m_stats.declarations;
+				}
+			}
+
+			void visitShaderStructBufferDeclStmt( stmt::ShaderStructBufferDecl const * stmt )override
+			{
+				if ( isReferenced( stmt->getSsboInstance() )
+					|| isReferenced( stmt->getData() ) )
+				{
+					StmtCloner::visitShaderStructBufferDeclStmt( stmt );
+				}
+				else
+				{
+					++m_stats.declarations;
+				}
+			}
+
+			void visitSimpleStmt( stmt::Simple const * stmt )override
+			{
+				auto target = getStoreTarget( *stmt->getExpr() );
+
+				if ( !target
+					|| !isRemovableStore( *target ) )
+				{
+					StmtCloner::visitSimpleStmt( stmt );
+					return;
+				}
+
+				// The stored value is never read, only its side effects (function calls) are kept.
+				for ( auto value : getStoredValues( *stmt->getExpr() ) )
+				{
+					if ( hasSideEffects( *value ) )
+					{
+						m_current->addStmt( m_stmtCache.makeSimple( doSubmit( *value ) ) );
+					}
+				}
+
+				++m_stats.statements;
+			}
+
+			void visitVariableDeclStmt( stmt::VariableDecl const * stmt )override
+			{
+				// Blocks members are kept, to preserve the blocks layout.
+				if ( m_blockLevel
+					|| isReferenced( stmt->getVariable() ) )
+				{
+					StmtCloner::visitVariableDeclStmt( stmt );
+				}
+				else
+				{
+					++m_stats.variables;
+				}
+			}
+
+		private:
+			Liveness const & m_liveness;
+			DeadCodeStats & m_stats;
+			uint32_t m_blockLevel{};
+		};
+
+		static uint32_t getTotal( DeadCodeStats const & stats )
+		{
+			return stats.functions
+				+ stats.variables
+				+ stats.declarations
+				+ stats.statements;
+		}
+	}
+
+	//*************************************************************************
+
+	stmt::ContainerPtr eliminateDeadCode( stmt::StmtCache & stmtCache
+		, expr::ExprCache & exprCache
+		, stmt::Container const & container
+		, DeadCodeStats & stats )
+	{
+		// Removing code can make more code unused, hence the fixed point iteration.
+		auto previous = dce::getTotal( stats );
+		auto result = dce::StmtEliminator::submit( stmtCache
+			, exprCache
+			, container
+			, dce::StmtUsageLister::submit( container )
+			, stats );
+		uint32_t pass = 1u;
+
+		while ( dce::getTotal( stats ) != previous
+			&& pass < dce::MaxPasses )
+		{
+			previous = dce::getTotal( stats );
+			result = dce::StmtEliminator::submit( stmtCache
+				, exprCache
+				, *result
+				, dce::StmtUsageLister::submit( *result )
+				, stats );
+			++pass;
+		}
+
+		return result;
+	}
+
+	//*************************************************************************
+}
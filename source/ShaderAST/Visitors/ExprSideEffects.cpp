@@ -0,0 +1,225 @@
+/*
+See LICENSE file in root folder
+*/
+#include "ShaderAST/Visitors/ExprSideEffects.hpp"
+
+#include "ShaderAST/Expr/ExprVisitor.hpp"
+
+namespace ast
+{
+	//*************************************************************************
+
+	namespace sideeff
+	{
+		static bool isMemoryVariable( var::Variable const & var )
+		{
+			return var.isShared()
+				|| var.isStorageBuffer()
+				|| var.isBufferReference();
+		}
+
+		class EffectsFinder
+			: public expr::SimpleVisitor
+		{
+		public:
+			static ExprEffects submit( expr::Expr const & expr )
+			{
+				ExprEffects result{};
+				EffectsFinder vis{ result };
+				expr.accept( &vis );
+				return result;
+			}
+
+		private:
+			explicit EffectsFinder( ExprEffects & result )
+				: m_result{ result }
+			{
+			}
+
+		private:
+			void visitUnaryExpr( expr::Unary const * expr )override
+			{
+				switch ( expr->getKind() )
+				{
+				case expr::Kind::ePreIncrement:
+				case expr::Kind::ePreDecrement:
+				case expr::Kind::ePostIncrement:
+				case expr::Kind::ePostDecrement:
+					m_result.sideEffects = true;
+					expr->getOperand()->accept( this );
+					break;
+				default:
+					expr->getOperand()->accept( this );
+					break;
+				}
+			}
+
+			void visitBinaryExpr( expr::Binary const * expr )override
+			{
+				switch ( expr->getKind() )
+				{
+				case expr::Kind::eAssign:
+				case expr::Kind::eAddAssign:
+				case expr::Kind::eMinusAssign:
+				case expr::Kind::eTimesAssign:
+				case expr::Kind::eDivideAssign:
+				case expr::Kind::eModuloAssign:
+				case expr::Kind::eLShiftAssign:
+				case expr::Kind::eRShiftAssign:
+				case expr::Kind::eAndAssign:
+				case expr::Kind::eNotAssign:
+				case expr::Kind::eOrAssign:
+				case expr::Kind::eXorAssign:
+					m_result.sideEffects = true;
+					expr->getLHS()->accept( this );
+					expr->getRHS()->accept( this );
+					break;
+				default:
+					expr->getLHS()->accept( this );
+					expr->getRHS()->accept( this );
+					break;
+				}
+			}
+
+			void visitAggrInitExpr( expr::AggrInit const * expr )override
+			{
+				visitList( expr->getInitialisers() );
+			}
+
+			void visitCompositeConstructExpr( expr::CompositeConstruct const * expr )override
+			{
+				visitList( expr->getArgList() );
+			}
+
+			void visitMbrSelectExpr( expr::MbrSelect const * expr )override
+			{
+				expr->getOuterExpr()->accept( this );
+			}
+
+			void visitFnCallExpr( expr::FnCall const * expr )override
+			{
+				m_result.sideEffects = true;
+
+				if ( expr->isMember() )
+				{
+					expr->getInstance()->accept( this );
+				}
+
+				visitList( expr->getArgList() );
+			}
+
+			void visitIntrinsicCallExpr( expr::IntrinsicCall const * expr )override
+			{
+				m_result.sideEffects = m_result.sideEffects
+					|| hasSideEffects( expr->getIntrinsic() );
+				m_result.invocationDependent = m_result.invocationDependent
+					|| isInvocationDependent( expr->getIntrinsic() );
+				visitList( expr->getArgList() );
+			}
+
+			void visitCombinedImageAccessCallExpr( expr::CombinedImageAccessCall const * expr )override
+			{
+				visitList( expr->getArgList() );
+			}
+
+			void visitImageAccessCallExpr( expr::StorageImageAccessCall const * expr )override
+			{
+				m_result.sideEffects = m_result.sideEffects
+					|| hasSideEffects( expr->getImageAccess() );
+				m_result.readsMemory = true;
+				visitList( expr->getArgList() );
+			}
+
+			void visitIdentifierExpr( expr::Identifier const * expr )override
+			{
+				for ( auto var = expr->getVariable(); var; var = var->getOuter() )
+				{
+					m_result.readsMemory = m_result.readsMemory
+						|| isMemoryVariable( *var );
+				}
+			}
+
+			void visitInitExpr( expr::Init const * expr )override
+			{
+				expr->getInitialiser()->accept( this );
+			}
+
+			void visitLiteralExpr( expr::Literal const * expr )override
+			{
+			}
+
+			void visitQuestionExpr( expr::Question const * expr )override
+			{
+				expr->getCtrlExpr()->accept( this );
+				expr->getTrueExpr()->accept( this );
+				expr->getFalseExpr()->accept( this );
+			}
+
+			void visitStreamAppendExpr( expr::StreamAppend const * expr )override
+			{
+				m_result.sideEffects = true;
+				expr->getOperand()->accept( this );
+			}
+
+			void visitSwitchCaseExpr( expr::SwitchCase const * expr )override
+			{
+			}
+
+			void visitSwitchTestExpr( expr::SwitchTest const * expr )override
+			{
+				expr->getValue()->accept( this );
+			}
+
+			void visitSwizzleExpr( expr::Swizzle const * expr )override
+			{
+				expr->getOuterExpr()->accept( this );
+			}
+
+			void visitList( expr::ExprList const & list )
+			{
+				for ( auto & expr : list )
+				{
+					expr->accept( this );
+				}
+			}
+
+		private:
+			ExprEffects & m_result;
+		};
+	}
+
+	//*************************************************************************
+
+	bool hasSideEffects( expr::Intrinsic value )
+	{
+		return ( value >= expr::Intrinsic::eAtomicAddI && value <= expr::Intrinsic::eAtomicCompSwapU )
+			|| ( value >= expr::Intrinsic::eEmitStreamVertex && value <= expr::Intrinsic::eEndPrimitive )
+			|| value == expr::Intrinsic::eControlBarrier
+			|| value == expr::Intrinsic::eMemoryBarrier
+			|| ( value >= expr::Intrinsic::eTraceRay && value <= expr::Intrinsic::eSetMeshOutputCounts );
+	}
+
+	bool hasSideEffects( expr::StorageImageAccess value )
+	{
+		return value >= expr::StorageImageAccess::eImageStore1DF
+			&& value < expr::StorageImageAccess::eCount;
+	}
+
+	bool isInvocationDependent( expr::Intrinsic value )
+	{
+		return value == expr::Intrinsic::eHelperInvocation
+			|| ( value >= expr::Intrinsic::eSubgroupElect && value < expr::Intrinsic::eCount );
+	}
+
+	bool hasSideEffects( expr::Expr const & expr )
+	{
+		return getExprEffects( expr ).sideEffects;
+	}
+
+	ExprEffects getExprEffects( expr::Expr const & expr )
+	{
+		return sideeff::EffectsFinder::submit( expr );
+	}
+
+	//*************************************************************************
+}
@@ -0,0 +1,539 @@
+/*
+See LICENSE file in root folder
+*/
+#include "ShaderAST/Visitors/FlattenBranches.hpp"
+
+#include "ShaderAST/Expr/ExprVisitor.hpp"
+#include "ShaderAST/Stmt/StmtCache.hpp"
+#include "ShaderAST/Visitors/CloneExpr.hpp"
+#include "ShaderAST/Visitors/CloneStmt.hpp"
+#include "ShaderAST/Visitors/ExprSideEffects.hpp"
+
+#include <algorithm>
+#include <unordered_set>
+
+namespace ast
+{
+	//*************************************************************************
+
+	namespace flatten
+	{
+		struct Assignment
+		{
+			var::VariablePtr var;
+			expr::Expr const * value;
+		};
+
+		struct Branch
+		{
+			// The declarations of the branch, moved before the selections.
+			std::vector< expr::Expr const * > declarations;
+			// The assignments of the branch, in order.
+			std::vector< Assignment > assignments;
+		};
+
+		struct Speculation
+		{
+			// false if the expression can't be evaluated when the branch isn't taken.
+			bool safe{ true };
+			// The IDs of the read variables.
+			std::unordered_set< uint32_t > reads;
+		};
+
+		class SpeculationChecker
+			: public expr::SimpleVisitor
+		{
+		public:
+			static Speculation submit( expr::Expr const & expr )
+			{
+				auto effects = getExprEffects( expr );
+				Speculation result;
+				result.safe = !effects.sideEffects
+					&& !effects.invocationDependent
+					&& !effects.readsMemory;
+				SpeculationChecker vis{ result };
+				expr.accept( &vis );
+				return result;
+			}
+
+		private:
+			explicit SpeculationChecker( Speculation & result )
+				: m_result{ result }
+			{
+			}
+
+			void visitList( expr::ExprList const & list )
+			{
+				for ( auto & arg : list )
+				{
+					arg->accept( this );
+				}
+			}
+
+		private:
+			void visitUnaryExpr( expr::Unary const * expr )override
+			{
+				expr->getOperand()->accept( this );
+			}
+
+			void visitBinaryExpr( expr::Binary const * expr )override
+			{
+				if ( expr->getKind() == expr::Kind::eArrayAccess
+					&& expr->getRHS()->getKind() != expr::Kind::eLiteral )
+				{
+					// The index may only be valid when the condition holds.
+					m_result.safe = false;
+				}
+
+				expr->getLHS()->accept( this );
+				expr->getRHS()->accept( this );
+			}
+
+			void visitAggrInitExpr( expr::AggrInit const * expr )override
+			{
+				m_result.safe = false;
+			}
+
+			void visitCompositeConstructExpr( expr::CompositeConstruct const * expr )override
+			{
+				visitList( expr->getArgList() );
+			}
+
+			void visitMbrSelectExpr( expr::MbrSelect const * expr )override
+			{
+				expr->getOuterExpr()->accept( this );
+			}
+
+			void visitFnCallExpr( expr::FnCall const * expr )override
+			{
+				m_result.safe = false;
+			}
+
+			void visitIntrinsicCallExpr( expr::IntrinsicCall const * expr )override
+			{
+				visitList( expr->getArgList() );
+			}
+
+			void visitCombinedImageAccessCallExpr( expr::CombinedImageAccessCall const * expr )override
+			{
+				// Too expensive to be computed when not needed.
+				m_result.safe = false;
+			}
+
+			void visitImageAccessCallExpr( expr::StorageImageAccessCall const * expr )override
+			{
+				m_result.safe = false;
+			}
+
+			void visitIdentifierExpr( expr::Identifier const * expr )override
+			{
+				m_result.reads.insert( expr->getVariable()->getId() );
+			}
+
+			void visitInitExpr( expr::Init const * expr )override
+			{
+				m_result.safe = false;
+			}
+
+			void visitLiteralExpr( expr::Literal const * expr )override
+			{
+			}
+
+			void visitQuestionExpr( expr::Question const * expr )override
+			{
+				expr->getCtrlExpr()->accept( this );
+				expr->getTrueExpr()->accept( this );
+				expr->getFalseExpr()->accept( this );
+			}
+
+			void visitStreamAppendExpr( expr::StreamAppend const * expr )override
+			{
+				m_result.safe = false;
+			}
+
+			void visitSwitchCaseExpr( expr::SwitchCase const * expr )override
+			{
+				m_result.safe = false;
+			}
+
+			void visitSwitchTestExpr( expr::SwitchTest const * expr )override
+			{
+				m_result.safe = false;
+			}
+
+			void visitSwizzleExpr( expr::Swizzle const * expr )override
+			{
+				expr->getOuterExpr()->accept( this );
+			}
+
+		private:
+			Speculation & m_result;
+		};
+
+		static bool isSelectable( var::Variable const & var )
+		{
+			auto kind = var.getType()->getKind();
+			return var.isLocale()
+				&& !var.isMemberVar()
+				&& !var.isAlias()
+				&& !var.isShared()
+				&& !var.isStatic()
+				&& ( type::isScalarType( kind ) || type::isVectorType( kind ) );
+		}
+
+		static bool isAssigned( Branch const & branch
+			, var::Variable const & var )
+		{
+			return branch.assignments.end() != std::find_if( branch.assignments.begin()
+				, branch.assignments.end()
+				, [&var]( Assignment const & lookup )
+				{
+					return lookup.var->getId() == var.getId();
+				} );
+		}
+
+		static bool listBranch( stmt::Container const & cont
+			, Branch & result )
+		{
+			for ( auto & stmt : cont )
+			{
+				if ( stmt->getKind() != stmt::Kind::eSimple )
+				{
+					return false;
+				}
+
+				auto & expr = *static_cast< stmt::Simple const & >( *stmt ).getExpr();
+
+				if ( expr.getKind() == expr::Kind::eInit
+					|| expr.getKind() == expr::Kind::eAlias )
+				{
+					result.declarations.push_back( &expr );
+				}
+				else if ( expr.getKind() == expr::Kind::eAssign )
+				{
+					auto & assign = static_cast< expr::Assign const & >( expr );
+
+					if ( assign.getLHS()->getKind() != expr::Kind::eIdentifier )
+					{
+						return false;
+					}
+
+					auto var = static_cast< expr::Identifier const & >( *assign.getLHS() ).getVariable();
+
+					if ( !isSelectable( *var )
+						|| isAssigned( result, *var ) )
+					{
+						return false;
+					}
+
+					result.assignments.push_back( { var, assign.getRHS() } );
+				}
+				else
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		static expr::Expr const & getDeclaredValue( expr::Expr const & expr )
+		{
+			if ( expr.getKind() == expr::Kind::eInit )
+			{
+				return *static_cast< expr::Init const & >( expr ).getInitialiser();
+			}
+
+			return *static_cast< expr::Alias const & >( expr ).getAliasedExpr();
+		}
+
+		static bool isSpeculable( Branch const & branch
+			, std::vector< var::VariablePtr > const & targets )
+		{
+			auto readsTarget = [&targets]( Speculation const & speculation
+				, var::Variable const * except )
+			{
+				return targets.end() != std::find_if( targets.begin()
+					, targets.end()
+					, [&speculation, except]( var::VariablePtr const & lookup )
+					{
+						return ( !except || lookup->getId() != except->getId() )
+							&& speculation.reads.contains( lookup->getId() );
+					} );
+			};
+
+			for ( auto declaration : branch.declarations )
+			{
+				if ( auto speculation = SpeculationChecker::submit( getDeclaredValue( *declaration ) );
+					!speculation.safe
+					|| readsTarget( speculation, nullptr ) )
+				{
+					return false;
+				}
+			}
+
+			// A value reading another assigned variable would depend on the selections order.
+			for ( auto & assignment : branch.assignments )
+			{
+				if ( auto speculation = SpeculationChecker::submit( *assignment.value );
+					!speculation.safe
+					|| readsTarget( speculation, assignment.var.get() ) )
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		static expr::Expr const * findValue( Branch const & branch
+			, var::Variable const & var )
+		{
+			auto it = std::find_if( branch.assignments.begin()
+				, branch.assignments.end()
+				, [&var]( Assignment const & lookup )
+				{
+					return lookup.var->getId() == var.getId();
+				} );
+			return it == branch.assignments.end()
+				? nullptr
+				: it->value;
+		}
+
+		class StmtFlattener
+			: public StmtCloner
+		{
+		public:
+			static stmt::ContainerPtr submit( stmt::StmtCache & stmtCache
+				, expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, stmt::Container const & container
+				, SSAData & ssaData
+				, bool useAliases
+				, uint32_t costThreshold
+				, BranchFlatteningStats & stats )
+			{
+				auto result = stmtCache.makeContainer();
+				StmtFlattener vis{ stmtCache, exprCache, typesCache, ssaData, useAliases, costThreshold, stats, result };
+				container.accept( &vis );
+				return result;
+			}
+
+		private:
+			StmtFlattener( stmt::StmtCache & stmtCache
+				, expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, SSAData & ssaData
+				, bool useAliases
+				, uint32_t costThreshold
+				, BranchFlatteningStats & stats
+				, stmt::ContainerPtr & result )
+				: StmtCloner{ stmtCache, exprCache, result }
+				, m_typesCache{ typesCache }
+				, m_ssaData{ ssaData }
+				, m_useAliases{ useAliases }
+				, m_costThreshold{ costThreshold }
+				, m_stats{ stats }
+			{
+			}
+
+			using StmtCloner::doSubmit;
+
+			var::VariablePtr makeTemp( expr::ExprPtr value )
+			{
+				++m_ssaData.nextVarId;
+				++m_ssaData.aliasId;
+				auto type = value->getType();
+				auto result = var::makeVariable( m_ssaData.nextVarId
+					, type
+					, "tmp_" + std::to_string( m_ssaData.aliasId )
+					, ( var::Flag::eImplicit
+						| var::Flag::eLocale
+						| var::Flag::eTemp
+						| ( m_useAliases ? var::Flag::eAlias : var::Flag::eNone ) ) );
+
+				if ( m_useAliases )
+				{
+					m_current->addStmt( m_stmtCache.makeSimple( m_exprCache.makeAlias( type
+						, m_exprCache.makeIdentifier( m_typesCache, result )
+						, std::move( value ) ) ) );
+				}
+				else
+				{
+					m_current->addStmt( m_stmtCache.makeSimple( m_exprCache.makeInit( m_exprCache.makeIdentifier( m_typesCache, result )
+						, std::move( value ) ) ) );
+				}
+
+				return result;
+			}
+
+			// Clones the branch content, so that the nested if statements are flattened first.
+			stmt::ContainerPtr cloneBranch( stmt::Container const & cont )
+			{
+				auto result = m_stmtCache.makeContainer();
+				auto save = m_current;
+				m_current = result.get();
+				visitContainerStmt( &cont );
+				m_current = save;
+				return result;
+			}
+
+			bool tryFlatten( stmt::If const & ifStmt
+				, stmt::Container const & thenCont
+				, stmt::Container const * elseCont )
+			{
+				Branch thenBranch;
+				Branch elseBranch;
+
+				if ( !listBranch( thenCont, thenBranch )
+					|| ( elseCont && !listBranch( *elseCont, elseBranch ) ) )
+				{
+					return false;
+				}
+
+				auto cost = thenCont.size() + ( elseCont ? elseCont->size() : 0u );
+
+				if ( ifStmt.getHint() != stmt::SelectionHint::eFlatten
+					&& cost > m_costThreshold )
+				{
+					return false;
+				}
+
+				std::vector< var::VariablePtr > targets;
+
+				for ( auto & assignment : thenBranch.assignments )
+				{
+					targets.push_back( assignment.var );
+				}
+
+				for ( auto & assignment : elseBranch.assignments )
+				{
+					if ( !isAssigned( thenBranch, *assignment.var ) )
+					{
+						targets.push_back( assignment.var );
+					}
+				}
+
+				if ( targets.empty()
+					|| !isSpeculable( thenBranch, targets )
+					|| !isSpeculable( elseBranch, targets ) )
+				{
+					return false;
+				}
+
+				auto ctrlExpr = doSubmit( *ifStmt.getCtrlExpr() );
+
+				if ( targets.size() > 1u
+					&& ( ctrlExpr->getKind() != expr::Kind::eIdentifier
+						|| targets.end() != std::find( targets.begin()
+							, targets.end()
+							, static_cast< expr::Identifier const & >( *ctrlExpr ).getVariable() ) ) )
+				{
+					// The condition must be evaluated once, before the first selection changes what it reads.
+					ctrlExpr = m_exprCache.makeIdentifier( m_typesCache, makeTemp( std::move( ctrlExpr ) ) );
+				}
+
+				for ( auto declaration : thenBranch.declarations )
+				{
+					m_current->addStmt( m_stmtCache.makeSimple( doSubmit( *declaration ) ) );
+				}
+
+				for ( auto declaration : elseBranch.declarations )
+				{
+					m_current->addStmt( m_stmtCache.makeSimple( doSubmit( *declaration ) ) );
+				}
+
+				for ( auto & var : targets )
+				{
+					auto thenValue = findValue( thenBranch, *var );
+					auto elseValue = findValue( elseBranch, *var );
+					auto type = var->getType();
+					m_current->addStmt( m_stmtCache.makeSimple( m_exprCache.makeAssign( type
+						, m_exprCache.makeIdentifier( m_typesCache, var )
+						, m_exprCache.makeQuestion( type
+							, ExprCloner::submit( m_exprCache, *ctrlExpr )
+							, ( thenValue
+								? doSubmit( *thenValue )
+								: m_exprCache.makeIdentifier( m_typesCache, var ) )
+							, ( elseValue
+								? doSubmit( *elseValue )
+								: m_exprCache.makeIdentifier( m_typesCache, var ) ) ) ) ) );
+				}
+
+				++m_stats.branches;
+				m_stats.selections += uint32_t( targets.size() );
+				return true;
+			}
+
+			void visitIfStmt( stmt::If const * stmt )override
+			{
+				if ( m_cloneOnly
+					|| stmt->getHint() == ast::stmt::SelectionHint::eDontFlatten
+					|| !stmt->getElseIfList().empty() )
+				{
+					StmtCloner::visitIfStmt( stmt );
+					return;
+				}
+
+				auto thenCont = cloneBranch( *stmt );
+				auto elseCont = stmt->getElse()
+					? cloneBranch( *stmt->getElse() )
+					: nullptr;
+
+				if ( tryFlatten( *stmt, *thenCont, elseCont.get() ) )
+				{
+					return;
+				}
+
+				// The branches content is already processed.
+				auto save = m_current;
+				auto cont = m_stmtCache.makeIf( doSubmit( stmt->getCtrlExpr() ) );
+				cont->setHint( stmt->getHint() );
+				m_cloneOnly = true;
+				m_current = cont.get();
+				visitContainerStmt( thenCont.get() );
+
+				if ( elseCont )
+				{
+					m_current = cont->createElse();
+					visitContainerStmt( elseCont.get() );
+				}
+
+				m_current = save;
+				m_cloneOnly = false;
+				m_current->addStmt( std::move( cont ) );
+			}
+
+		private:
+			type::TypesCache & m_typesCache;
+			SSAData & m_ssaData;
+			bool m_useAliases;
+			uint32_t m_costThreshold;
+			BranchFlatteningStats & m_stats;
+			bool m_cloneOnly{};
+		};
+	}
+
+	//*************************************************************************
+
+	stmt::ContainerPtr flattenBranches( stmt::StmtCache & stmtCache
+		, expr::ExprCache & exprCache
+		, type::TypesCache & typesCache
+		, stmt::Container const & container
+		, SSAData & ssaData
+		, bool useAliases
+		, uint32_t costThreshold
+		, BranchFlatteningStats & stats )
+	{
+		return flatten::StmtFlattener::submit( stmtCache
+			, exprCache
+			, typesCache
+			, container
+			, ssaData
+			, useAliases
+			, costThreshold
+			, stats );
+	}
+
+	//*************************************************************************
+}
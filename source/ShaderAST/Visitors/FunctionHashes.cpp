@@ -0,0 +1,353 @@
+/*
+See LICENSE file in root folder
+*/
+#include "ShaderAST/Visitors/FunctionHashes.hpp"
+
+#include "ShaderAST/Expr/ExprVisitor.hpp"
+#include "ShaderAST/Stmt/StmtVisitor.hpp"
+#include "ShaderAST/Visitors/DebugDisplayStatements.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace ast
+{
+	//*************************************************************************
+
+	namespace hashes
+	{
+		class ExprCalleesLister
+			: public expr::SimpleVisitor
+		{
+		public:
+			static void submit( expr::Expr const & expr
+				, std::vector< std::string > & result )
+			{
+				ExprCalleesLister vis{ result };
+				expr.accept( &vis );
+			}
+
+		private:
+			explicit ExprCalleesLister( std::vector< std::string > & result )
+				: m_result{ result }
+			{
+			}
+
+		private:
+			void visitUnaryExpr( expr::Unary const * expr )override
+			{
+				expr->getOperand()->accept( this );
+			}
+
+			void visitBinaryExpr( expr::Binary const * expr )override
+			{
+				expr->getLHS()->accept( this );
+				expr->getRHS()->accept( this );
+			}
+
+			void visitAggrInitExpr( expr::AggrInit const * expr )override
+			{
+				for ( auto & arg : expr->getInitialisers() )
+				{
+					arg->accept( this );
+				}
+			}
+
+			void visitCompositeConstructExpr( expr::CompositeConstruct const * expr )override
+			{
+				for ( auto & arg : expr->getArgList() )
+				{
+					arg->accept( this );
+				}
+			}
+
+			void visitMbrSelectExpr( expr::MbrSelect const * expr )override
+			{
+				expr->getOuterExpr()->accept( this );
+			}
+
+			void visitFnCallExpr( expr::FnCall const * expr )override
+			{
+				auto & name = expr->getFn()->getVariable()->getName();
+
+				if ( m_result.end() == std::find( m_result.begin(), m_result.end(), name ) )
+				{
+					m_result.push_back( name );
+				}
+
+				if ( expr->isMember() )
+				{
+					expr->getInstance()->accept( this );
+				}
+
+				for ( auto & arg : expr->getArgList() )
+				{
+					arg->accept( this );
+				}
+			}
+
+			void visitIntrinsicCallExpr( expr::IntrinsicCall const * expr )override
+			{
+				for ( auto & arg : expr->getArgList() )
+				{
+					arg->accept( this );
+				}
+			}
+
+			void visitCombinedImageAccessCallExpr( expr::CombinedImageAccessCall const * expr )override
+			{
+				for ( auto & arg : expr->getArgList() )
+				{
+					arg->accept( this );
+				}
+			}
+
+			void visitImageAccessCallExpr( expr::StorageImageAccessCall const * expr )override
+			{
+				for ( auto & arg : expr->getArgList() )
+				{
+					arg->accept( this );
+				}
+			}
+
+			void visitIdentifierExpr( expr::Identifier const * expr )override
+			{
+			}
+
+			void visitInitExpr( expr::Init const * expr )override
+			{
+				expr->getInitialiser()->accept( this );
+			}
+
+			void visitLiteralExpr( expr::Literal const * expr )override
+			{
+			}
+
+			void visitQuestionExpr( expr::Question const * expr )override
+			{
+				expr->getCtrlExpr()->accept( this );
+				expr->getTrueExpr()->accept( this );
+				expr->getFalseExpr()->accept( this );
+			}
+
+			void visitStreamAppendExpr( expr::StreamAppend const * expr )override
+			{
+				expr->getOperand()->accept( this );
+			}
+
+			void visitSwitchCaseExpr( expr::SwitchCase const * expr )override
+			{
+			}
+
+			void visitSwitchTestExpr( expr::SwitchTest const * expr )override
+			{
+				expr->getValue()->accept( this );
+			}
+
+			void visitSwizzleExpr( expr::Swizzle const * expr )override
+			{
+				expr->getOuterExpr()->accept( this );
+			}
+
+		private:
+			std::vector< std::string > & m_result;
+		};
+
+		class StmtCalleesLister
+			: public stmt::SimpleVisitor
+		{
+		public:
+			static std::vector< std::string > submit( stmt::FunctionDecl const & stmt )
+			{
+				std::vector< std::string > result;
+				StmtCalleesLister vis{ result };
+				stmt.accept( &vis );
+				return result;
+			}
+
+		private:
+			explicit StmtCalleesLister( std::vector< std::string > & result )
+				: m_result{ result }
+			{
+			}
+
+			void visitExpr( expr::Expr const * expr )
+			{
+				if ( expr )
+				{
+					ExprCalleesLister::submit( *expr, m_result );
+				}
+			}
+
+		private:
+			void visitDispatchMeshStmt( stmt::DispatchMesh const * stmt )override
+			{
+				visitExpr( stmt->getNumGroupsX() );
+				visitExpr( stmt->getNumGroupsY() );
+				visitExpr( stmt->getNumGroupsZ() );
+				visitExpr( stmt->getPayload() );
+			}
+
+			void visitDoWhileStmt( stmt::DoWhile const * stmt )override
+			{
+				stmt::SimpleVisitor::visitDoWhileStmt( stmt );
+				visitExpr( stmt->getCtrlExpr() );
+			}
+
+			void visitElseIfStmt( stmt::ElseIf const * stmt )override
+			{
+				visitExpr( stmt->getCtrlExpr() );
+				stmt::SimpleVisitor::visitElseIfStmt( stmt );
+			}
+
+			void visitForStmt( stmt::For const * stmt )override
+			{
+				visitExpr( stmt->getInitExpr() );
+				visitExpr( stmt->getCtrlExpr() );
+				visitExpr( stmt->getIncrExpr() );
+				stmt::SimpleVisitor::visitForStmt( stmt );
+			}
+
+			void visitIfStmt( stmt::If const * stmt )override
+			{
+				visitExpr( stmt->getCtrlExpr() );
+				stmt::SimpleVisitor::visitIfStmt( stmt );
+			}
+
+			void visitReturnStmt( stmt::Return const * stmt )override
+			{
+				visitExpr( stmt->getExpr() );
+			}
+
+			void visitSimpleStmt( stmt::Simple const * stmt )override
+			{
+				visitExpr( stmt->getExpr() );
+			}
+
+			void visitSwitchStmt( stmt::Switch const * stmt )override
+			{
+				visitExpr( stmt->getTestExpr() );
+				stmt::SimpleVisitor::visitSwitchStmt( stmt );
+			}
+
+			void visitWhileStmt( stmt::While const * stmt )override
+			{
+				visitExpr( stmt->getCtrlExpr() );
+				stmt::SimpleVisitor::visitWhileStmt( stmt );
+			}
+
+		private:
+			std::vector< std::string > & m_result;
+		};
+
+		static size_t hashText( std::string const & text )
+		{
+			return std::hash< std::string >{}( text );
+		}
+	}
+
+	//*************************************************************************
+
+	ShaderHashes computeShaderHashes( stmt::Container const & container )
+	{
+		ShaderHashes result;
+		std::unordered_map< std::string, size_t > fullHashes;
+
+		for ( auto & stmt : container )
+		{
+			if ( stmt->getKind() != stmt::Kind::eFunctionDecl )
+			{
+				type::hashCombine( result.globals, hashes::hashText( debug::displayStatements( *stmt ) ) );
+			}
+		}
+
+		for ( auto & stmt : container )
+		{
+			if ( stmt->getKind() == stmt::Kind::eFunctionDecl )
+			{
+				auto & function = static_cast< stmt::FunctionDecl const & >( *stmt );
+				FunctionHash hash{ function.getName()
+					, hashes::hashText( debug::displayStatements( function ) )
+					, {}
+					, hashes::StmtCalleesLister::submit( function ) };
+				hash.fullHash = hash.hash;
+				type::hashCombine( hash.fullHash, result.globals );
+
+				for ( auto & callee : hash.callees )
+				{
+					// Functions are declared before being called, so their full hash is already known.
+					if ( auto it = fullHashes.find( callee );
+						it != fullHashes.end() )
+					{
+						type::hashCombine( hash.fullHash, it->second );
+					}
+				}
+
+				// Overloads share a name, the last declared one wins, which is conservative for callers.
+				fullHashes[hash.name] = hash.fullHash;
+				result.functions.push_back( std::move( hash ) );
+			}
+		}
+
+		return result;
+	}
+
+	std::vector< std::string > listChangedFunctions( ShaderHashes const & previous
+		, ShaderHashes const & current )
+	{
+		std::vector< std::string > result;
+
+		for ( auto & function : current.functions )
+		{
+			auto it = std::find_if( previous.functions.begin()
+				, previous.functions.end()
+				, [&function]( FunctionHash const & lookup )
+				{
+					return lookup.name == function.name
+						&& lookup.fullHash == function.fullHash;
+				} );
+
+			if ( it == previous.functions.end() )
+			{
+				result.push_back( function.name );
+			}
+		}
+
+		return result;
+	}
+
+	bool isSameShader( ShaderHashes const & lhs
+		, ShaderHashes const & rhs )
+	{
+		return lhs.globals == rhs.globals
+			&& std::equal( lhs.functions.begin()
+				, lhs.functions.end()
+				, rhs.functions.begin()
+				, rhs.functions.end()
+				, []( FunctionHash const & lhsFunc
+					, FunctionHash const & rhsFunc )
+				{
+					return lhsFunc.name == rhsFunc.name
+						&& lhsFunc.fullHash == rhsFunc.fullHash;
+				} );
+	}
+
+	size_t hashSpecialisation( SpecialisationInfo const & specialisation )
+	{
+		size_t result{};
+
+		for ( auto & constant : specialisation.data )
+		{
+			type::hashCombine( result, constant.info.location );
+
+			for ( auto byte : constant.data )
+			{
+				type::hashCombine( result, byte );
+			}
+		}
+
+		return result;
+	}
+
+	//*************************************************************************
+}
@@ -0,0 +1,1117 @@
+/*
+See LICENSE file in root folder
+*/
+#include "ShaderAST/Visitors/HoistLoopInvariants.hpp"
+
+#include "ShaderAST/Expr/ExprVisitor.hpp"
+#include "ShaderAST/Stmt/StmtCache.hpp"
+#include "ShaderAST/Stmt/StmtVisitor.hpp"
+#include "ShaderAST/Visitors/CloneExpr.hpp"
+#include "ShaderAST/Visitors/CloneStmt.hpp"
+#include "ShaderAST/Visitors/ExprSideEffects.hpp"
+
+#include <unordered_map>
+#include <unordered_set>
+
+namespace ast
+{
+	//*************************************************************************
+
+	namespace licm
+	{
+		// For each alias, the variables read by the aliased expression.
+		using Aliases = std::unordered_map< uint32_t, std::vector< var::VariablePtr > >;
+
+		struct LoopInfo
+		{
+			// The IDs of the variables written in the loop, with their outer variables.
+			std::unordered_set< uint32_t > written;
+			// The IDs of the variables declared in the loop.
+			std::unordered_set< uint32_t > declared;
+			// true if the loop writes memory, or global variables, or calls a function.
+			bool writesMemory{};
+		};
+
+		struct ExprUsage
+		{
+			// true if all the read variables hold the same value at each iteration.
+			bool invariant{ true };
+			// true if the expression reads at least one variable.
+			bool readsVariables{};
+			// true if the expression samples or fetches a texture, or reads a storage image.
+			bool accessesImages{};
+		};
+
+		static var::VariablePtr getAccessChainRoot( expr::Expr const & expr )
+		{
+			switch ( expr.getKind() )
+			{
+			case expr::Kind::eIdentifier:
+				return static_cast< expr::Identifier const & >( expr ).getVariable();
+			case expr::Kind::eMbrSelect:
+				return getAccessChainRoot( *static_cast< expr::MbrSelect const & >( expr ).getOuterExpr() );
+			case expr::Kind::eSwizzle:
+				return getAccessChainRoot( *static_cast< expr::Swizzle const & >( expr ).getOuterExpr() );
+			case expr::Kind::eArrayAccess:
+				return getAccessChainRoot( *static_cast< expr::ArrayAccess const & >( expr ).getLHS() );
+			default:
+				return nullptr;
+			}
+		}
+
+		static bool isReadOnly( var::Variable const & var )
+		{
+			return var.isUniform()
+				|| var.isPushConstant()
+				|| var.isConstant()
+				|| var.isShaderConstant()
+				|| var.isSpecialisationConstant()
+				|| ( var.isShaderInput() && !var.isShaderOutput() );
+		}
+
+		static bool isFunctionLocal( var::Variable const & var )
+		{
+			return var.isLocale()
+				|| var.isParam()
+				|| var.isLoopVar();
+		}
+
+		static bool isInvariant( LoopInfo const & info
+			, Aliases const & aliases
+			, var::VariablePtr var )
+		{
+			for ( auto outer = var; outer; outer = outer->getOuter() )
+			{
+				if ( info.written.contains( outer->getId() )
+					|| info.declared.contains( outer->getId() ) )
+				{
+					return false;
+				}
+			}
+
+			if ( auto it = aliases.find( var->getId() );
+				it != aliases.end() )
+			{
+				// Depending on the backend, the aliased expression is evaluated where it is declared, or where it is used.
+				for ( auto & read : it->second )
+				{
+					if ( !isInvariant( info, aliases, read ) )
+					{
+						return false;
+					}
+				}
+			}
+
+			auto root = var::getOutermost( var );
+			return isFunctionLocal( *root )
+				|| isReadOnly( *root )
+				|| !info.writesMemory;
+		}
+
+		class ReadsLister
+			: public expr::SimpleVisitor
+		{
+		public:
+			static std::vector< var::VariablePtr > submit( expr::Expr const & expr )
+			{
+				std::vector< var::VariablePtr > result;
+				ReadsLister vis{ result };
+				expr.accept( &vis );
+				return result;
+			}
+
+		private:
+			explicit ReadsLister( std::vector< var::VariablePtr > & result )
+				: m_result{ result }
+			{
+			}
+
+			void visitList( expr::ExprList const & list )
+			{
+				for ( auto & arg : list )
+				{
+					arg->accept( this );
+				}
+			}
+
+		private:
+			void visitUnaryExpr( expr::Unary const * expr )override
+			{
+				expr->getOperand()->accept( this );
+			}
+
+			void visitBinaryExpr( expr::Binary const * expr )override
+			{
+				expr->getLHS()->accept( this );
+				expr->getRHS()->accept( this );
+			}
+
+			void visitAggrInitExpr( expr::AggrInit const * expr )override
+			{
+				visitList( expr->getInitialisers() );
+			}
+
+			void visitCompositeConstructExpr( expr::CompositeConstruct const * expr )override
+			{
+				visitList( expr->getArgList() );
+			}
+
+			void visitMbrSelectExpr( expr::MbrSelect const * expr )override
+			{
+				expr->getOuterExpr()->accept( this );
+			}
+
+			void visitFnCallExpr( expr::FnCall const * expr )override
+			{
+				if ( expr->isMember() )
+				{
+					expr->getInstance()->accept( this );
+				}
+
+				visitList( expr->getArgList() );
+			}
+
+			void visitIntrinsicCallExpr( expr::IntrinsicCall const * expr )override
+			{
+				visitList( expr->getArgList() );
+			}
+
+			void visitCombinedImageAccessCallExpr( expr::CombinedImageAccessCall const * expr )override
+			{
+				visitList( expr->getArgList() );
+			}
+
+			void visitImageAccessCallExpr( expr::StorageImageAccessCall const * expr )override
+			{
+				visitList( expr->getArgList() );
+			}
+
+			void visitIdentifierExpr( expr::Identifier const * expr )override
+			{
+				m_result.push_back( expr->getVariable() );
+			}
+
+			void visitInitExpr( expr::Init const * expr )override
+			{
+				if ( auto init = expr->getInitialiser() )
+				{
+					init->accept( this );
+				}
+			}
+
+			void visitLiteralExpr( expr::Literal const * expr )override
+			{
+			}
+
+			void visitQuestionExpr( expr::Question const * expr )override
+			{
+				expr->getCtrlExpr()->accept( this );
+				expr->getTrueExpr()->accept( this );
+				expr->getFalseExpr()->accept( this );
+			}
+
+			void visitStreamAppendExpr( expr::StreamAppend const * expr )override
+			{
+				expr->getOperand()->accept( this );
+			}
+
+			void visitSwitchCaseExpr( expr::SwitchCase const * expr )override
+			{
+			}
+
+			void visitSwitchTestExpr( expr::SwitchTest const * expr )override
+			{
+				expr->getValue()->accept( this );
+			}
+
+			void visitSwizzleExpr( expr::Swizzle const * expr )override
+			{
+				expr->getOuterExpr()->accept( this );
+			}
+
+		private:
+			std::vector< var::VariablePtr > & m_result;
+		};
+
+		class ExprLoopAnalyser
+			: public expr::SimpleVisitor
+		{
+		public:
+			static void submit( expr::Expr const & expr
+				, Aliases & aliases
+				, LoopInfo & result )
+			{
+				ExprLoopAnalyser vis{ aliases, result };
+				expr.accept( &vis );
+			}
+
+		private:
+			ExprLoopAnalyser( Aliases & aliases
+				, LoopInfo & result )
+				: m_aliases{ aliases }
+				, m_result{ result }
+			{
+			}
+
+			void addWrite( expr::Expr const & expr )
+			{
+				if ( auto var = getAccessChainRoot( expr ) )
+				{
+					addWrite( var );
+				}
+			}
+
+			void addWrite( var::VariablePtr var )
+			{
+				if ( auto it = m_aliases.find( var->getId() );
+					it != m_aliases.end() )
+				{
+					// Writing through an alias writes the aliased access chain.
+					m_result.written.insert( var->getId() );
+
+					for ( auto & read : it->second )
+					{
+						addWrite( read );
+					}
+
+					return;
+				}
+
+				auto root = var::getOutermost( var );
+
+				if ( isReadOnly( *root ) )
+				{
+					return;
+				}
+
+				for ( ; var; var = var->getOuter() )
+				{
+					m_result.written.insert( var->getId() );
+				}
+
+				if ( !isFunctionLocal( *root ) )
+				{
+					m_result.writesMemory = true;
+				}
+			}
+
+			void addDeclaration( var::VariablePtr var )
+			{
+				m_result.declared.insert( var->getId() );
+			}
+
+			void visitArgs( expr::ExprList const & list )
+			{
+				for ( auto & arg : list )
+				{
+					addWrite( *arg );
+					arg->accept( this );
+				}
+			}
+
+		private:
+			void visitUnaryExpr( expr::Unary const * expr )override
+			{
+				switch ( expr->getKind() )
+				{
+				case expr::Kind::ePreIncrement:
+				case expr::Kind::ePreDecrement:
+				case expr::Kind::ePostIncrement:
+				case expr::Kind::ePostDecrement:
+					addWrite( *expr->getOperand() );
+					break;
+				default:
+					break;
+				}
+
+				expr->getOperand()->accept( this );
+			}
+
+			void visitBinaryExpr( expr::Binary const * expr )override
+			{
+				if ( expr->getKind() >= expr::Kind::eAssign
+					&& expr->getKind() <= expr::Kind::eXorAssign )
+				{
+					addWrite( *expr->getLHS() );
+				}
+				else if ( expr->getKind() == expr::Kind::eAlias )
+				{
+					auto & alias = static_cast< expr::Alias const & >( *expr );
+
+					if ( alias.hasIdentifier() )
+					{
+						auto var = alias.getIdentifier().getVariable();
+						addDeclaration( var );
+						m_aliases[var->getId()] = ReadsLister::submit( *alias.getAliasedExpr() );
+					}
+				}
+
+				expr->getLHS()->accept( this );
+				expr->getRHS()->accept( this );
+			}
+
+			void visitAggrInitExpr( expr::AggrInit const * expr )override
+			{
+				if ( expr->hasIdentifier() )
+				{
+					addDeclaration( expr->getIdentifier().getVariable() );
+				}
+
+				for ( auto & init : expr->getInitialisers() )
+				{
+					init->accept( this );
+				}
+			}
+
+			void visitCompositeConstructExpr( expr::CompositeConstruct const * expr )override
+			{
+				for ( auto & arg : expr->getArgList() )
+				{
+					arg->accept( this );
+				}
+			}
+
+			void visitMbrSelectExpr( expr::MbrSelect const * expr )override
+			{
+				expr->getOuterExpr()->accept( this );
+			}
+
+			void visitFnCallExpr( expr::FnCall const * expr )override
+			{
+				m_result.writesMemory = true;
+
+				if ( expr->isMember() )
+				{
+					addWrite( *expr->getInstance() );
+					expr->getInstance()->accept( this );
+				}
+
+				visitArgs( expr->getArgList() );
+			}
+
+			void visitIntrinsicCallExpr( expr::IntrinsicCall const * expr )override
+			{
+				if ( hasSideEffects( expr->getIntrinsic() ) )
+				{
+					m_result.writesMemory = true;
+				}
+
+				visitArgs( expr->getArgList() );
+			}
+
+			void visitCombinedImageAccessCallExpr( expr::CombinedImageAccessCall const * expr )override
+			{
+				for ( auto & arg : expr->getArgList() )
+				{
+					arg->accept( this );
+				}
+			}
+
+			void visitImageAccessCallExpr( expr::StorageImageAccessCall const * expr )override
+			{
+				if ( hasSideEffects( expr->getImageAccess() ) )
+				{
+					m_result.writesMemory = true;
+				}
+
+				visitArgs( expr->getArgList() );
+			}
+
+			void visitIdentifierExpr( expr::Identifier const * expr )override
+			{
+			}
+
+			void visitInitExpr( expr::Init const * expr )override
+			{
+				if ( expr->hasIdentifier() )
+				{
+					addDeclaration( expr->getIdentifier().getVariable() );
+				}
+
+				if ( auto init = expr->getInitialiser() )
+				{
+					init->accept( this );
+				}
+			}
+
+			void visitLiteralExpr( expr::Literal const * expr )override
+			{
+			}
+
+			void visitQuestionExpr( expr::Question const * expr )override
+			{
+				expr->getCtrlExpr()->accept( this );
+				expr->getTrueExpr()->accept( this );
+				expr->getFalseExpr()->accept( this );
+			}
+
+			void visitStreamAppendExpr( expr::StreamAppend const * expr )override
+			{
+				m_result.writesMemory = true;
+				expr->getOperand()->accept( this );
+			}
+
+			void visitSwitchCaseExpr( expr::SwitchCase const * expr )override
+			{
+			}
+
+			void visitSwitchTestExpr( expr::SwitchTest const * expr )override
+			{
+				expr->getValue()->accept( this );
+			}
+
+			void visitSwizzleExpr( expr::Swizzle const * expr )override
+			{
+				expr->getOuterExpr()->accept( this );
+			}
+
+		private:
+			Aliases & m_aliases;
+			LoopInfo & m_result;
+		};
+
+		class StmtLoopAnalyser
+			: public stmt::SimpleVisitor
+		{
+		public:
+			static LoopInfo submit( stmt::Stmt const & stmt
+				, Aliases & aliases )
+			{
+				LoopInfo result;
+				StmtLoopAnalyser vis{ aliases, result };
+				stmt.accept( &vis );
+				return result;
+			}
+
+		private:
+			StmtLoopAnalyser( Aliases & aliases
+				, LoopInfo & result )
+				: m_aliases{ aliases }
+				, m_result{ result }
+			{
+			}
+
+			void visitExpr( expr::Expr const * expr )
+			{
+				if ( expr )
+				{
+					ExprLoopAnalyser::submit( *expr, m_aliases, m_result );
+				}
+			}
+
+		private:
+			void visitDispatchMeshStmt( stmt::DispatchMesh const * stmt )override
+			{
+				m_result.writesMemory = true;
+			}
+
+			void visitDoWhileStmt( stmt::DoWhile const * stmt )override
+			{
+				stmt::SimpleVisitor::visitDoWhileStmt( stmt );
+				visitExpr( stmt->getCtrlExpr() );
+			}
+
+			void visitElseIfStmt( stmt::ElseIf const * stmt )override
+			{
+				visitExpr( stmt->getCtrlExpr() );
+				stmt::SimpleVisitor::visitElseIfStmt( stmt );
+			}
+
+			void visitForStmt( stmt::For const * stmt )override
+			{
+				visitExpr( stmt->getInitExpr() );
+				visitExpr( stmt->getCtrlExpr() );
+				visitExpr( stmt->getIncrExpr() );
+				stmt::SimpleVisitor::visitForStmt( stmt );
+			}
+
+			void visitIfStmt( stmt::If const * stmt )override
+			{
+				visitExpr( stmt->getCtrlExpr() );
+				stmt::SimpleVisitor::visitIfStmt( stmt );
+			}
+
+			void visitReturnStmt( stmt::Return const * stmt )override
+			{
+				visitExpr( stmt->getExpr() );
+			}
+
+			void visitSimpleStmt( stmt::Simple const * stmt )override
+			{
+				visitExpr( stmt->getExpr() );
+			}
+
+			void visitSwitchStmt( stmt::Switch const * stmt )override
+			{
+				visitExpr( stmt->getTestExpr() );
+				stmt::SimpleVisitor::visitSwitchStmt( stmt );
+			}
+
+			void visitVariableDeclStmt( stmt::VariableDecl const * stmt )override
+			{
+				m_result.declared.insert( stmt->getVariable()->getId() );
+			}
+
+			void visitWhileStmt( stmt::While const * stmt )override
+			{
+				visitExpr( stmt->getCtrlExpr() );
+				stmt::SimpleVisitor::visitWhileStmt( stmt );
+			}
+
+		private:
+			Aliases & m_aliases;
+			LoopInfo & m_result;
+		};
+
+		class ExprUsageLister
+			: public expr::SimpleVisitor
+		{
+		public:
+			static ExprUsage submit( expr::Expr const & expr
+				, LoopInfo const & info
+				, Aliases const & aliases )
+			{
+				ExprUsage result;
+				ExprUsageLister vis{ info, aliases, result };
+				expr.accept( &vis );
+				return result;
+			}
+
+		private:
+			ExprUsageLister( LoopInfo const & info
+				, Aliases const & aliases
+				, ExprUsage & result )
+				: m_info{ info }
+				, m_aliases{ aliases }
+				, m_result{ result }
+			{
+			}
+
+			void visitList( expr::ExprList const & list )
+			{
+				for ( auto & arg : list )
+				{
+					arg->accept( this );
+				}
+			}
+
+		private:
+			void visitUnaryExpr( expr::Unary const * expr )override
+			{
+				expr->getOperand()->accept( this );
+			}
+
+			void visitBinaryExpr( expr::Binary const * expr )override
+			{
+				expr->getLHS()->accept( this );
+				expr->getRHS()->accept( this );
+			}
+
+			void visitAggrInitExpr( expr::AggrInit const * expr )override
+			{
+				m_result.invariant = false;
+			}
+
+			void visitCompositeConstructExpr( expr::CompositeConstruct const * expr )override
+			{
+				visitList( expr->getArgList() );
+			}
+
+			void visitMbrSelectExpr( expr::MbrSelect const * expr )override
+			{
+				expr->getOuterExpr()->accept( this );
+			}
+
+			void visitFnCallExpr( expr::FnCall const * expr )override
+			{
+				m_result.invariant = false;
+			}
+
+			void visitIntrinsicCallExpr( expr::IntrinsicCall const * expr )override
+			{
+				visitList( expr->getArgList() );
+			}
+
+			void visitCombinedImageAccessCallExpr( expr::CombinedImageAccessCall const * expr )override
+			{
+				m_result.accessesImages = true;
+				visitList( expr->getArgList() );
+			}
+
+			void visitImageAccessCallExpr( expr::StorageImageAccessCall const * expr )override
+			{
+				m_result.accessesImages = true;
+				visitList( expr->getArgList() );
+			}
+
+			void visitIdentifierExpr( expr::Identifier const * expr )override
+			{
+				m_result.readsVariables = true;
+
+				if ( !isInvariant( m_info, m_aliases, expr->getVariable() ) )
+				{
+					m_result.invariant = false;
+				}
+			}
+
+			void visitInitExpr( expr::Init const * expr )override
+			{
+				m_result.invariant = false;
+			}
+
+			void visitLiteralExpr( expr::Literal const * expr )override
+			{
+			}
+
+			void visitQuestionExpr( expr::Question const * expr )override
+			{
+				expr->getCtrlExpr()->accept( this );
+				expr->getTrueExpr()->accept( this );
+				expr->getFalseExpr()->accept( this );
+			}
+
+			void visitStreamAppendExpr( expr::StreamAppend const * expr )override
+			{
+				m_result.invariant = false;
+			}
+
+			void visitSwitchCaseExpr( expr::SwitchCase const * expr )override
+			{
+				m_result.invariant = false;
+			}
+
+			void visitSwitchTestExpr( expr::SwitchTest const * expr )override
+			{
+				m_result.invariant = false;
+			}
+
+			void visitSwizzleExpr( expr::Swizzle const * expr )override
+			{
+				expr->getOuterExpr()->accept( this );
+			}
+
+		private:
+			LoopInfo const & m_info;
+			Aliases const & m_aliases;
+			ExprUsage & m_result;
+		};
+
+		// Receives the temporaries computed before the loop.
+		class Preheader
+		{
+		public:
+			Preheader( stmt::StmtCache & stmtCache
+				, expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, SSAData & ssaData
+				, bool useAliases
+				, stmt::Container & container )
+				: m_stmtCache{ stmtCache }
+				, m_exprCache{ exprCache }
+				, m_typesCache{ typesCache }
+				, m_ssaData{ ssaData }
+				, m_useAliases{ useAliases }
+				, m_container{ container }
+			{
+			}
+
+			var::VariablePtr makeTemp( expr::ExprPtr value )
+			{
+				++m_ssaData.nextVarId;
+				++m_ssaData.aliasId;
+				auto type = value->getType();
+				auto result = var::makeVariable( m_ssaData.nextVarId
+					, type
+					, "tmp_" + std::to_string( m_ssaData.aliasId )
+					, ( var::Flag::eImplicit
+						| var::Flag::eLocale
+						| var::Flag::eTemp
+						| ( m_useAliases ? var::Flag::eAlias : var::Flag::eNone ) ) );
+
+				if ( m_useAliases )
+				{
+					m_container.addStmt( m_stmtCache.makeSimple( m_exprCache.makeAlias( type
+						, m_exprCache.makeIdentifier( m_typesCache, result )
+						, std::move( value ) ) ) );
+				}
+				else
+				{
+					m_container.addStmt( m_stmtCache.makeSimple( m_exprCache.makeInit( m_exprCache.makeIdentifier( m_typesCache, result )
+						, std::move( value ) ) ) );
+				}
+
+				++m_count;
+				return result;
+			}
+
+			uint32_t getCount()const
+			{
+				return m_count;
+			}
+
+		private:
+			stmt::StmtCache & m_stmtCache;
+			expr::ExprCache & m_exprCache;
+			type::TypesCache & m_typesCache;
+			SSAData & m_ssaData;
+			bool m_useAliases;
+			stmt::Container & m_container;
+			uint32_t m_count{};
+		};
+
+		class ExprHoister
+			: public ExprCloner
+		{
+		public:
+			static expr::ExprPtr submit( expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, LoopInfo const & info
+				, Aliases const & aliases
+				, Preheader & preheader
+				, bool speculative
+				, expr::Expr const & expr )
+			{
+				if ( isHoistable( info, aliases, speculative, expr ) )
+				{
+					auto temp = preheader.makeTemp( ExprCloner::submit( exprCache, expr ) );
+					auto result = exprCache.makeIdentifier( typesCache, temp );
+
+					if ( expr.isNonUniform() )
+					{
+						result->updateFlag( expr::Flag::eNonUniform );
+					}
+
+					return result;
+				}
+
+				expr::ExprPtr result{};
+				ExprHoister vis{ exprCache, typesCache, info, aliases, preheader, speculative, result };
+				expr.accept( &vis );
+
+				if ( expr.isNonUniform() )
+				{
+					result->updateFlag( expr::Flag::eNonUniform );
+				}
+
+				return result;
+			}
+
+		private:
+			ExprHoister( expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, LoopInfo const & info
+				, Aliases const & aliases
+				, Preheader & preheader
+				, bool speculative
+				, expr::ExprPtr & result )
+				: ExprCloner{ exprCache, result }
+				, m_typesCache{ typesCache }
+				, m_info{ info }
+				, m_aliases{ aliases }
+				, m_preheader{ preheader }
+				, m_speculative{ speculative }
+			{
+			}
+
+			using ExprCloner::doSubmit;
+
+			expr::ExprPtr doSubmit( expr::Expr const & expr )override
+			{
+				return submit( m_exprCache, m_typesCache, m_info, m_aliases, m_preheader, m_speculative, expr );
+			}
+
+			static bool isHoistable( LoopInfo const & info
+				, Aliases const & aliases
+				, bool speculative
+				, expr::Expr const & expr )
+			{
+				switch ( expr.getKind() )
+				{
+				case expr::Kind::eIdentifier:
+					{
+						// Only the loads from buffers are worth a temporary.
+						auto var = static_cast< expr::Identifier const & >( expr ).getVariable();
+
+						if ( !var->isMemberVar()
+							|| isFunctionLocal( *var::getOutermost( var ) ) )
+						{
+							return false;
+						}
+					}
+					break;
+				case expr::Kind::eLiteral:
+				case expr::Kind::eInit:
+				case expr::Kind::eAlias:
+				case expr::Kind::eAggrInit:
+				case expr::Kind::eComma:
+				case expr::Kind::eCopy:
+				case expr::Kind::eFnCall:
+				case expr::Kind::eStreamAppend:
+				case expr::Kind::eSwitchCase:
+				case expr::Kind::eSwitchTest:
+				case expr::Kind::ePreIncrement:
+				case expr::Kind::ePreDecrement:
+				case expr::Kind::ePostIncrement:
+				case expr::Kind::ePostDecrement:
+					return false;
+				case expr::Kind::eMbrSelect:
+				case expr::Kind::eSwizzle:
+				case expr::Kind::eArrayAccess:
+					if ( auto root = getAccessChainRoot( expr );
+						root && isFunctionLocal( *var::getOutermost( root ) ) )
+					{
+						// Reading a local variable is already as cheap as reading a temporary.
+						return false;
+					}
+					break;
+				default:
+					if ( expr.getKind() >= expr::Kind::eAssign
+						&& expr.getKind() <= expr::Kind::eXorAssign )
+					{
+						return false;
+					}
+					break;
+				}
+
+				if ( expr.isDummy() )
+				{
+					return false;
+				}
+
+				auto type = expr.getType();
+
+				if ( type->getKind() == type::Kind::eVoid
+					|| type->getKind() == type::Kind::eArray
+					|| type::isStructType( type )
+					|| type::isOpaqueType( type::getNonArrayKind( type ) ) )
+				{
+					return false;
+				}
+
+				auto usage = ExprUsageLister::submit( expr, info, aliases );
+
+				if ( !usage.invariant
+					|| !usage.readsVariables )
+				{
+					return false;
+				}
+
+				auto effects = getExprEffects( expr );
+
+				if ( effects.sideEffects
+					|| effects.invocationDependent
+					|| ( effects.readsMemory && info.writesMemory ) )
+				{
+					return false;
+				}
+
+				// Memory reads and texture accesses are only moved when the loop would have run them anyway.
+				return !speculative
+					|| ( !effects.readsMemory && !usage.accessesImages );
+			}
+
+		private:
+			type::TypesCache & m_typesCache;
+			LoopInfo const & m_info;
+			Aliases const & m_aliases;
+			Preheader & m_preheader;
+			bool m_speculative;
+		};
+
+		class StmtHoister
+			: public StmtCloner
+		{
+		public:
+			static stmt::DoWhilePtr submit( stmt::StmtCache & stmtCache
+				, expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, stmt::DoWhile const & loop
+				, LoopInfo const & info
+				, Aliases const & aliases
+				, Preheader & preheader )
+			{
+				auto container = stmtCache.makeContainer();
+				StmtHoister vis{ stmtCache, exprCache, typesCache, info, aliases, preheader, container };
+				// The control expression isn't evaluated when the body breaks out of the loop.
+				auto result = stmtCache.makeDoWhile( vis.hoist( *loop.getCtrlExpr(), true ) );
+				result->setHint( loop.getHint() );
+				vis.m_current = result.get();
+
+				for ( auto & stmt : loop )
+				{
+					stmt->accept( &vis );
+
+					switch ( stmt->getKind() )
+					{
+					case stmt::Kind::eSimple:
+					case stmt::Kind::eVariableDecl:
+					case stmt::Kind::eComment:
+						break;
+					default:
+						// This statement can leave the iteration.
+						vis.m_escaped = true;
+						break;
+					}
+				}
+
+				return result;
+			}
+
+		private:
+			StmtHoister( stmt::StmtCache & stmtCache
+				, expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, LoopInfo const & info
+				, Aliases const & aliases
+				, Preheader & preheader
+				, stmt::ContainerPtr & result )
+				: StmtCloner{ stmtCache, exprCache, result }
+				, m_typesCache{ typesCache }
+				, m_info{ info }
+				, m_aliases{ aliases }
+				, m_preheader{ preheader }
+			{
+			}
+
+			expr::ExprPtr hoist( expr::Expr const & expr
+				, bool speculative )
+			{
+				return ExprHoister::submit( m_exprCache, m_typesCache, m_info, m_aliases, m_preheader, speculative, expr );
+			}
+
+			expr::ExprPtr doSubmit( expr::Expr const & expr )override
+			{
+				return hoist( expr, m_escaped || m_depth > 0u );
+			}
+
+			void visitDoWhileStmt( stmt::DoWhile const * stmt )override
+			{
+				++m_depth;
+				StmtCloner::visitDoWhileStmt( stmt );
+				--m_depth;
+			}
+
+			void visitForStmt( stmt::For const * stmt )override
+			{
+				++m_depth;
+				StmtCloner::visitForStmt( stmt );
+				--m_depth;
+			}
+
+			void visitIfStmt( stmt::If const * stmt )override
+			{
+				++m_depth;
+				StmtCloner::visitIfStmt( stmt );
+				--m_depth;
+			}
+
+			void visitSwitchStmt( stmt::Switch const * stmt )override
+			{
+				++m_depth;
+				StmtCloner::visitSwitchStmt( stmt );
+				--m_depth;
+			}
+
+			void visitWhileStmt( stmt::While const * stmt )override
+			{
+				++m_depth;
+				StmtCloner::visitWhileStmt( stmt );
+				--m_depth;
+			}
+
+		private:
+			type::TypesCache & m_typesCache;
+			LoopInfo const & m_info;
+			Aliases const & m_aliases;
+			Preheader & m_preheader;
+			// The nesting level in the loop body, the nested statements may not run at each iteration.
+			uint32_t m_depth{};
+			// true once a top level statement of the body may have left the iteration.
+			bool m_escaped{};
+		};
+
+		class StmtLicm
+			: public StmtCloner
+		{
+		public:
+			static stmt::ContainerPtr submit( stmt::StmtCache & stmtCache
+				, expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, stmt::Container const & container
+				, SSAData & ssaData
+				, bool useAliases
+				, LoopInvariantStats & stats )
+			{
+				// The aliases can be declared before the loops using them.
+				Aliases aliases;
+				StmtLoopAnalyser::submit( container, aliases );
+				auto result = stmtCache.makeContainer();
+				StmtLicm vis{ stmtCache, exprCache, typesCache, ssaData, useAliases, aliases, stats, result };
+				container.accept( &vis );
+				return result;
+			}
+
+		private:
+			StmtLicm( stmt::StmtCache & stmtCache
+				, expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, SSAData & ssaData
+				, bool useAliases
+				, Aliases & aliases
+				, LoopInvariantStats & stats
+				, stmt::ContainerPtr & result )
+				: StmtCloner{ stmtCache, exprCache, result }
+				, m_typesCache{ typesCache }
+				, m_ssaData{ ssaData }
+				, m_useAliases{ useAliases }
+				, m_aliases{ aliases }
+				, m_stats{ stats }
+			{
+			}
+
+			void visitDoWhileStmt( stmt::DoWhile const * stmt )override
+			{
+				// The outer loop is processed first, so that the expressions invariant for it leave the nested loops too.
+				auto info = StmtLoopAnalyser::submit( *stmt, m_aliases );
+				Preheader preheader{ m_stmtCache, m_exprCache, m_typesCache, m_ssaData, m_useAliases, *m_current };
+				auto hoisted = StmtHoister::submit( m_stmtCache, m_exprCache, m_typesCache, *stmt, info, m_aliases, preheader );
+
+				if ( preheader.getCount() )
+				{
+					++m_stats.loops;
+					m_stats.expressions += preheader.getCount();
+				}
+
+				StmtCloner::visitDoWhileStmt( hoisted.get() );
+			}
+
+		private:
+			type::TypesCache & m_typesCache;
+			SSAData & m_ssaData;
+			bool m_useAliases;
+			Aliases & m_aliases;
+			LoopInvariantStats & m_stats;
+		};
+	}
+
+	//*************************************************************************
+
+	stmt::ContainerPtr hoistLoopInvariants( stmt::StmtCache & stmtCache
+		, expr::ExprCache & exprCache
+		, type::TypesCache & typesCache
+		, stmt::Container const & container
+		, SSAData & ssaData
+		, bool useAliases
+		, LoopInvariantStats & stats )
+	{
+		return licm::StmtLicm::submit( stmtCache
+			, exprCache
+			, typesCache
+			, container
+			, ssaData
+			, useAliases
+			, stats );
+	}
+
+	//*************************************************************************
+}
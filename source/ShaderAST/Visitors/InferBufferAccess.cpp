@@ -0,0 +1,714 @@
+/*
+See LICENSE file in root folder
+*/
+#include "ShaderAST/Visitors/InferBufferAccess.hpp"
+
+#include "ShaderAST/Expr/ExprCache.hpp"
+#include "ShaderAST/Expr/ExprVisitor.hpp"
+#include "ShaderAST/Stmt/StmtCache.hpp"
+#include "ShaderAST/Stmt/StmtVisitor.hpp"
+#include "ShaderAST/Type/TypeCache.hpp"
+#include "ShaderAST/Visitors/CloneExpr.hpp"
+#include "ShaderAST/Visitors/CloneStmt.hpp"
+
+#include <map>
+#include <set>
+
+namespace ast
+{
+	//*************************************************************************
+
+	namespace access
+	{
+		struct Access
+		{
+			bool read{};
+			bool write{};
+		};
+
+		struct Buffer
+		{
+			// The buffer variable (the block instance for the buffers of structures).
+			var::VariablePtr variable;
+			// The member variables, or the data array for the buffers of structures.
+			std::vector< var::VariablePtr > members;
+		};
+
+		using IdSet = std::set< uint32_t >;
+
+		struct Analysis
+		{
+			std::vector< Buffer > buffers;
+			// The buffer and member variables, with the members they give access to.
+			std::map< uint32_t, IdSet > accessed;
+			// The accesses to the members.
+			std::map< uint32_t, Access > accesses;
+
+			void addBuffer( var::VariablePtr variable
+				, std::vector< var::VariablePtr > members )
+			{
+				auto & ids = accessed[variable->getId()];
+
+				for ( auto & member : members )
+				{
+					ids.insert( member->getId() );
+					accessed[member->getId()].insert( member->getId() );
+					accesses.try_emplace( member->getId() );
+				}
+
+				buffers.push_back( { std::move( variable ), std::move( members ) } );
+			}
+
+			IdSet const * find( var::Variable const & var )const
+			{
+				auto it = accessed.find( var.getId() );
+				return it == accessed.end()
+					? nullptr
+					: &it->second;
+			}
+		};
+
+		static bool isAtomic( expr::Intrinsic intrinsic )
+		{
+			return intrinsic >= expr::Intrinsic::eAtomicAddI
+				&& intrinsic <= expr::Intrinsic::eAtomicCompSwapU;
+		}
+		/**
+		*\return
+		*	The count of output arguments of \p intrinsic, at the end of its arguments list.
+		*/
+		static size_t getOutputArgsCount( expr::Intrinsic intrinsic )
+		{
+			if ( ( intrinsic >= expr::Intrinsic::eModf1F && intrinsic <= expr::Intrinsic::eModf4D )
+				|| ( intrinsic >= expr::Intrinsic::eFrexp1F && intrinsic <= expr::Intrinsic::eFrexp4D )
+				|| ( intrinsic >= expr::Intrinsic::eUaddCarry1 && intrinsic <= expr::Intrinsic::eUsubBorrow4 ) )
+			{
+				return 1u;
+			}
+
+			if ( intrinsic >= expr::Intrinsic::eUmulExtended1 && intrinsic <= expr::Intrinsic::eImulExtended4 )
+			{
+				return 2u;
+			}
+
+			return 0u;
+		}
+		/**
+		*\return
+		*	The root variable of an access chain (member selections, swizzles and array accesses on a variable),
+		*	\p nullptr if \p expr is a computed value.
+		*/
+		static expr::Identifier const * getAccessChainRoot( expr::Expr const & expr )
+		{
+			switch ( expr.getKind() )
+			{
+			case expr::Kind::eIdentifier:
+				return &static_cast< expr::Identifier const & >( expr );
+			case expr::Kind::eMbrSelect:
+				return getAccessChainRoot( *static_cast< expr::MbrSelect const & >( expr ).getOuterExpr() );
+			case expr::Kind::eSwizzle:
+				return getAccessChainRoot( *static_cast< expr::Swizzle const & >( expr ).getOuterExpr() );
+			case expr::Kind::eArrayAccess:
+				return getAccessChainRoot( *static_cast< expr::ArrayAccess const & >( expr ).getLHS() );
+			default:
+				return nullptr;
+			}
+		}
+
+		class ExprAnalyser
+			: public expr::SimpleVisitor
+		{
+		public:
+			static void submit( expr::Expr const & expr
+				, Analysis & analysis )
+			{
+				ExprAnalyser vis{ analysis };
+				expr.accept( &vis );
+			}
+
+		private:
+			explicit ExprAnalyser( Analysis & analysis )
+				: m_analysis{ analysis }
+			{
+			}
+
+			void mark( var::Variable const & var
+				, bool read
+				, bool write )
+			{
+				if ( auto ids = m_analysis.find( var ) )
+				{
+					for ( auto id : *ids )
+					{
+						auto & access = m_analysis.accesses[id];
+						access.read = access.read || read;
+						access.write = access.write || write;
+					}
+				}
+			}
+			/**
+			*	Marks the variable accessed by an access chain, the indices in the chain are read.
+			*/
+			void access( expr::Expr const & expr
+				, bool read
+				, bool write )
+			{
+				switch ( expr.getKind() )
+				{
+				case expr::Kind::eIdentifier:
+					mark( *static_cast< expr::Identifier const & >( expr ).getVariable(), read, write );
+					break;
+				case expr::Kind::eMbrSelect:
+					access( *static_cast< expr::MbrSelect const & >( expr ).getOuterExpr(), read, write );
+					break;
+				case expr::Kind::eSwizzle:
+					access( *static_cast< expr::Swizzle const & >( expr ).getOuterExpr(), read, write );
+					break;
+				case expr::Kind::eArrayAccess:
+					access( *static_cast< expr::ArrayAccess const & >( expr ).getLHS(), read, write );
+					static_cast< expr::ArrayAccess const & >( expr ).getRHS()->accept( this );
+					break;
+				default:
+					expr.accept( this );
+					break;
+				}
+			}
+
+			void visitAlias( expr::Alias const & expr )
+			{
+				auto aliased = expr.getAliasedExpr();
+				auto root = getAccessChainRoot( *aliased );
+				auto ids = root
+					? m_analysis.find( *root->getVariable() )
+					: nullptr;
+
+				if ( !ids )
+				{
+					aliased->accept( this );
+					return;
+				}
+
+				// The accesses through the alias are the accesses to the aliased members.
+				m_analysis.accessed[expr.getIdentifier().getVariable()->getId()] = *ids;
+				access( *aliased, false, false );
+			}
+
+			void visitUnaryExpr( expr::Unary const * expr )override
+			{
+				switch ( expr->getKind() )
+				{
+				case expr::Kind::ePreIncrement:
+				case expr::Kind::ePreDecrement:
+				case expr::Kind::ePostIncrement:
+				case expr::Kind::ePostDecrement:
+					access( *expr->getOperand(), true, true );
+					break;
+				default:
+					expr->getOperand()->accept( this );
+					break;
+				}
+			}
+
+			void visitBinaryExpr( expr::Binary const * expr )override
+			{
+				switch ( expr->getKind() )
+				{
+				case expr::Kind::eAlias:
+					visitAlias( static_cast< expr::Alias const & >( *expr ) );
+					break;
+				case expr::Kind::eAssign:
+					access( *expr->getLHS(), false, true );
+					expr->getRHS()->accept( this );
+					break;
+				case expr::Kind::eAddAssign:
+				case expr::Kind::eMinusAssign:
+				case expr::Kind::eTimesAssign:
+				case expr::Kind::eDivideAssign:
+				case expr::Kind::eModuloAssign:
+				case expr::Kind::eLShiftAssign:
+				case expr::Kind::eRShiftAssign:
+				case expr::Kind::eAndAssign:
+				case expr::Kind::eNotAssign:
+				case expr::Kind::eOrAssign:
+				case expr::Kind::eXorAssign:
+					access( *expr->getLHS(), true, true );
+					expr->getRHS()->accept( this );
+					break;
+				default:
+					expr->getLHS()->accept( this );
+					expr->getRHS()->accept( this );
+					break;
+				}
+			}
+
+			void visitAggrInitExpr( expr::AggrInit const * expr )override
+			{
+				for ( auto & init : expr->getInitialisers() )
+				{
+					init->accept( this );
+				}
+			}
+
+			void visitCompositeConstructExpr( expr::CompositeConstruct const * expr )override
+			{
+				for ( auto & arg : expr->getArgList() )
+				{
+					arg->accept( this );
+				}
+			}
+
+			void visitMbrSelectExpr( expr::MbrSelect const * expr )override
+			{
+				expr->getOuterExpr()->accept( this );
+			}
+
+			void visitFnCallExpr( expr::FnCall const * expr )override
+			{
+				if ( expr->isMember() )
+				{
+					access( *expr->getInstance(), true, true );
+				}
+
+				auto & fnType = static_cast< type::Function const & >( *expr->getFn()->getType() );
+				auto argIt = expr->getArgList().begin();
+
+				for ( auto & param : fnType )
+				{
+					if ( argIt == expr->getArgList().end() )
+					{
+						break;
+					}
+
+					if ( param->isOutputParam() )
+					{
+						access( **argIt, param->isInputParam(), true );
+					}
+					else
+					{
+						( *argIt )->accept( this );
+					}
+
+					++argIt;
+				}
+
+				for ( ; argIt != expr->getArgList().end(); ++argIt )
+				{
+					( *argIt )->accept( this );
+				}
+			}
+
+			void visitIntrinsicCallExpr( expr::IntrinsicCall const * expr )override
+			{
+				auto & args = expr->getArgList();
+				auto outputs = getOutputArgsCount( expr->getIntrinsic() );
+				size_t index = 0u;
+
+				for ( auto & arg : args )
+				{
+					if ( index == 0u && isAtomic( expr->getIntrinsic() ) )
+					{
+						access( *arg, true, true );
+					}
+					else if ( index + outputs >= args.size() )
+					{
+						access( *arg, false, true );
+					}
+					else
+					{
+						arg->accept( this );
+					}
+
+					++index;
+				}
+			}
+
+			void visitCombinedImageAccessCallExpr( expr::CombinedImageAccessCall const * expr )override
+			{
+				for ( auto & arg : expr->getArgList() )
+				{
+					arg->accept( this );
+				}
+			}
+
+			void visitImageAccessCallExpr( expr::StorageImageAccessCall const * expr )override
+			{
+				for ( auto & arg : expr->getArgList() )
+				{
+					arg->accept( this );
+				}
+			}
+
+			void visitIdentifierExpr( expr::Identifier const * expr )override
+			{
+				mark( *expr->getVariable(), true, false );
+			}
+
+			void visitInitExpr( expr::Init const * expr )override
+			{
+				if ( auto init = expr->getInitialiser() )
+				{
+					init->accept( this );
+				}
+			}
+
+			void visitLiteralExpr( expr::Literal const * expr )override
+			{
+			}
+
+			void visitQuestionExpr( expr::Question const * expr )override
+			{
+				expr->getCtrlExpr()->accept( this );
+				expr->getTrueExpr()->accept( this );
+				expr->getFalseExpr()->accept( this );
+			}
+
+			void visitStreamAppendExpr( expr::StreamAppend const * expr )override
+			{
+				expr->getOperand()->accept( this );
+			}
+
+			void visitSwitchCaseExpr( expr::SwitchCase const * expr )override
+			{
+			}
+
+			void visitSwitchTestExpr( expr::SwitchTest const * expr )override
+			{
+				expr->getValue()->accept( this );
+			}
+
+			void visitSwizzleExpr( expr::Swizzle const * expr )override
+			{
+				expr->getOuterExpr()->accept( this );
+			}
+
+		private:
+			Analysis & m_analysis;
+		};
+
+		class StmtAnalyser
+			: public stmt::SimpleVisitor
+		{
+		public:
+			static void submit( stmt::Container const & container
+				, Analysis & analysis )
+			{
+				StmtAnalyser vis{ analysis };
+				container.accept( &vis );
+			}
+
+		private:
+			explicit StmtAnalyser( Analysis & analysis )
+				: m_analysis{ analysis }
+			{
+			}
+
+			void visitExpr( expr::Expr const * expr )
+			{
+				if ( expr )
+				{
+					ExprAnalyser::submit( *expr, m_analysis );
+				}
+			}
+
+		private:
+			void visitDispatchMeshStmt( stmt::DispatchMesh const * stmt )override
+			{
+				visitExpr( stmt->getNumGroupsX() );
+				visitExpr( stmt->getNumGroupsY() );
+				visitExpr( stmt->getNumGroupsZ() );
+				visitExpr( stmt->getPayload() );
+			}
+
+			void visitDoWhileStmt( stmt::DoWhile const * stmt )override
+			{
+				stmt::SimpleVisitor::visitDoWhileStmt( stmt );
+				visitExpr( stmt->getCtrlExpr() );
+			}
+
+			void visitElseIfStmt( stmt::ElseIf const * stmt )override
+			{
+				visitExpr( stmt->getCtrlExpr() );
+				stmt::SimpleVisitor::visitElseIfStmt( stmt );
+			}
+
+			void visitForStmt( stmt::For const * stmt )override
+			{
+				visitExpr( stmt->getInitExpr() );
+				visitExpr( stmt->getCtrlExpr() );
+				visitExpr( stmt->getIncrExpr() );
+				stmt::SimpleVisitor::visitForStmt( stmt );
+			}
+
+			void visitIfStmt( stmt::If const * stmt )override
+			{
+				visitExpr( stmt->getCtrlExpr() );
+				stmt::SimpleVisitor::visitIfStmt( stmt );
+			}
+
+			void visitReturnStmt( stmt::Return const * stmt )override
+			{
+				visitExpr( stmt->getExpr() );
+			}
+
+			void visitShaderBufferDeclStmt( stmt::ShaderBufferDecl const * stmt )override
+			{
+				std::vector< var::VariablePtr > members;
+
+				for ( auto & member : *stmt )
+				{
+					assert( member->getKind() == stmt::Kind::eVariableDecl );
+					members.push_back( static_cast< stmt::VariableDecl const & >( *member ).getVariable() );
+				}
+
+				m_analysis.addBuffer( stmt->getVariable(), std::move( members ) );
+			}
+
+			void visitShaderStructBufferDeclStmt( stmt::ShaderStructBufferDecl const * stmt )override
+			{
+				m_analysis.addBuffer( stmt->getSsboInstance(), { stmt->getData() } );
+			}
+
+			void visitSimpleStmt( stmt::Simple const * stmt )override
+			{
+				visitExpr( stmt->getExpr() );
+			}
+
+			void visitSwitchStmt( stmt::Switch const * stmt )override
+			{
+				visitExpr( stmt->getTestExpr() );
+				stmt::SimpleVisitor::visitSwitchStmt( stmt );
+			}
+
+			void visitWhileStmt( stmt::While const * stmt )override
+			{
+				visitExpr( stmt->getCtrlExpr() );
+				stmt::SimpleVisitor::visitWhileStmt( stmt );
+			}
+
+		private:
+			Analysis & m_analysis;
+		};
+
+		using Replaced = std::map< uint32_t, var::VariablePtr >;
+
+		class ExprReplacer
+			: public ExprCloner
+		{
+		public:
+			static expr::ExprPtr submit( expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, Replaced const & replaced
+				, expr::Expr const & expr )
+			{
+				expr::ExprPtr result{};
+				ExprReplacer vis{ exprCache, typesCache, replaced, result };
+				expr.accept( &vis );
+
+				if ( expr.isNonUniform() )
+				{
+					result->updateFlag( expr::Flag::eNonUniform );
+				}
+
+				return result;
+			}
+
+		private:
+			ExprReplacer( expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, Replaced const & replaced
+				, expr::ExprPtr & result )
+				: ExprCloner{ exprCache, result }
+				, m_typesCache{ typesCache }
+				, m_replaced{ replaced }
+			{
+			}
+
+			expr::ExprPtr doSubmit( expr::Expr const & expr )override
+			{
+				return submit( m_exprCache, m_typesCache, m_replaced, expr );
+			}
+
+			void visitIdentifierExpr( expr::Identifier const * expr )override
+			{
+				if ( auto it = m_replaced.find( expr->getVariable()->getId() );
+					it != m_replaced.end() )
+				{
+					m_result = m_exprCache.makeIdentifier( m_typesCache, it->second );
+				}
+				else
+				{
+					m_result = m_exprCache.makeIdentifier( *expr );
+				}
+			}
+
+		private:
+			type::TypesCache & m_typesCache;
+			Replaced const & m_replaced;
+		};
+
+		class StmtReplacer
+			: public StmtCloner
+		{
+		public:
+			static stmt::ContainerPtr submit( stmt::StmtCache & stmtCache
+				, expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, stmt::Container const & container
+				, Replaced const & replaced )
+			{
+				auto result = stmtCache.makeContainer();
+				StmtReplacer vis{ stmtCache, exprCache, typesCache, replaced, result };
+				container.accept( &vis );
+				return result;
+			}
+
+		private:
+			StmtReplacer( stmt::StmtCache & stmtCache
+				, expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, Replaced const & replaced
+				, stmt::ContainerPtr & result )
+				: StmtCloner{ stmtCache, exprCache, result }
+				, m_typesCache{ typesCache }
+				, m_replaced{ replaced }
+			{
+			}
+
+			var::VariablePtr replace( var::VariablePtr var )const
+			{
+				if ( auto it = m_replaced.find( var->getId() );
+					it != m_replaced.end() )
+				{
+					return it->second;
+				}
+
+				return var;
+			}
+
+			using StmtCloner::doSubmit;
+
+			expr::ExprPtr doSubmit( expr::Expr const & expr )override
+			{
+				return ExprReplacer::submit( m_exprCache, m_typesCache, m_replaced, expr );
+			}
+
+			void visitShaderBufferDeclStmt( stmt::ShaderBufferDecl const * stmt )override
+			{
+				auto save = m_current;
+				auto cont = m_stmtCache.makeShaderBufferDecl( replace( stmt->getVariable() )
+					, stmt->getBindingPoint()
+					, stmt->getDescriptorSet() );
+				m_current = cont.get();
+				visitContainerStmt( stmt );
+				m_current = save;
+				m_current->addStmt( std::move( cont ) );
+			}
+
+			void visitShaderStructBufferDeclStmt( stmt::ShaderStructBufferDecl const * stmt )override
+			{
+				m_current->addStmt( m_stmtCache.makeShaderStructBufferDecl( stmt->getSsboName()
+					, replace( stmt->getSsboInstance() )
+					, replace( stmt->getData() )
+					, stmt->getBindingPoint()
+					, stmt->getDescriptorSet() ) );
+			}
+
+			void visitVariableDeclStmt( stmt::VariableDecl const * stmt )override
+			{
+				m_current->addStmt( m_stmtCache.makeVariableDecl( replace( stmt->getVariable() ) ) );
+			}
+
+		private:
+			type::TypesCache & m_typesCache;
+			Replaced const & m_replaced;
+		};
+		/**
+		*\return
+		*	\p var with the access flags added, \p nullptr if it already has them.
+		*/
+		static var::VariablePtr makeFlagged( var::Variable const & var
+			, var::VariablePtr outer
+			, bool nonWritable
+			, bool nonReadable
+			, BufferAccessStats & stats )
+		{
+			auto flags = var.getFlags();
+
+			if ( nonWritable && !var.isNonWritable() )
+			{
+				flags |= uint64_t( var::Flag::eNonWritable );
+				++stats.nonWritable;
+			}
+
+			if ( nonReadable && !var.isNonReadable() )
+			{
+				flags |= uint64_t( var::Flag::eNonReadable );
+				++stats.nonReadable;
+			}
+
+			if ( flags == var.getFlags()
+				&& outer == var.getOuter() )
+			{
+				return nullptr;
+			}
+
+			return outer
+				? var::makeVariable( var.getEntityName(), std::move( outer ), var.getType(), flags )
+				: var::makeVariable( var.getEntityName(), var.getType(), flags );
+		}
+	}
+
+	//*************************************************************************
+
+	stmt::ContainerPtr inferBufferAccess( stmt::StmtCache & stmtCache
+		, expr::ExprCache & exprCache
+		, type::TypesCache & typesCache
+		, stmt::Container const & container
+		, BufferAccessStats & stats )
+	{
+		access::Analysis analysis;
+		access::StmtAnalyser::submit( container, analysis );
+		access::Replaced replaced;
+
+		// The shader variables are shared with the source statements, they are replaced instead of modified.
+		for ( auto & buffer : analysis.buffers )
+		{
+			bool nonWritable = true;
+			bool nonReadable = true;
+
+			for ( auto & member : buffer.members )
+			{
+				auto & access = analysis.accesses[member->getId()];
+				nonWritable = nonWritable && !access.write;
+				// The unused members are only marked as not written.
+				nonReadable = nonReadable && !access.read && access.write;
+			}
+
+			auto variable = buffer.variable;
+
+			if ( auto flagged = access::makeFlagged( *variable, nullptr, nonWritable, nonReadable, stats ) )
+			{
+				variable = flagged;
+				replaced.emplace( variable->getId(), variable );
+			}
+
+			for ( auto & member : buffer.members )
+			{
+				auto & access = analysis.accesses[member->getId()];
+				// The members of a buffer block keep their block as outer variable.
+				auto outer = ( member->isMemberVar() && member->getOuter()->getId() == variable->getId() )
+					? variable
+					: member->getOuter();
+
+				if ( auto flagged = access::makeFlagged( *member, outer, !access.write, !access.read && access.write, stats ) )
+				{
+					replaced.emplace( flagged->getId(), flagged );
+				}
+			}
+		}
+
+		return access::StmtReplacer::submit( stmtCache, exprCache, typesCache, container, replaced );
+	}
+
+	//*************************************************************************
+}
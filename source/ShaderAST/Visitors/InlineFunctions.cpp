@@ -0,0 +1,904 @@
+/*
+See LICENSE file in root folder
+*/
+#include "ShaderAST/Visitors/InlineFunctions.hpp"
+
+#include "ShaderAST/Expr/ExprVisitor.hpp"
+#include "ShaderAST/Stmt/StmtCache.hpp"
+#include "ShaderAST/Stmt/StmtVisitor.hpp"
+#include "ShaderAST/Visitors/CloneExpr.hpp"
+#include "ShaderAST/Visitors/CloneStmt.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace ast
+{
+	//*************************************************************************
+
+	namespace inlining
+	{
+		struct FunctionUsage
+		{
+			// The number of calls, per function variable ID.
+			std::unordered_map< uint32_t, uint32_t > calls;
+			// The variables declared in the function.
+			std::vector< var::VariablePtr > locals;
+			// The IDs of the variables that are written, or given to a call as an access chain.
+			std::unordered_set< uint32_t > written;
+			// The IDs of the outermost variables of the member variables used in the function.
+			std::unordered_set< uint32_t > memberOuters;
+			uint32_t statements{};
+			uint32_t returns{};
+			bool endsWithReturn{};
+			bool unsupported{};
+		};
+
+		struct FunctionInfo
+		{
+			stmt::FunctionDecl const * decl{};
+			FunctionUsage usage;
+			bool inlinable{};
+			bool inlined{};
+		};
+
+		struct Bindings
+		{
+			// The replacement variables, for the parameters copies and the local variables.
+			std::unordered_map< uint32_t, var::VariablePtr > vars;
+			// The replacement expressions, for the parameters used directly.
+			std::unordered_map< uint32_t, expr::Expr const * > exprs;
+		};
+
+		static var::VariablePtr getAccessChainRoot( expr::Expr const & expr )
+		{
+			switch ( expr.getKind() )
+			{
+			case expr::Kind::eIdentifier:
+				return static_cast< expr::Identifier const & >( expr ).getVariable();
+			case expr::Kind::eMbrSelect:
+				return getAccessChainRoot( *static_cast< expr::MbrSelect const & >( expr ).getOuterExpr() );
+			case expr::Kind::eSwizzle:
+				return getAccessChainRoot( *static_cast< expr::Swizzle const & >( expr ).getOuterExpr() );
+			case expr::Kind::eArrayAccess:
+				return getAccessChainRoot( *static_cast< expr::ArrayAccess const & >( expr ).getLHS() );
+			default:
+				return nullptr;
+			}
+		}
+
+		static bool isAccessChain( expr::Expr const & expr )
+		{
+			return getAccessChainRoot( expr ) != nullptr;
+		}
+
+		class ExprUsageLister
+			: public expr::SimpleVisitor
+		{
+		public:
+			static void submit( expr::Expr const & expr
+				, FunctionUsage & result )
+			{
+				ExprUsageLister vis{ result };
+				expr.accept( &vis );
+			}
+
+		private:
+			explicit ExprUsageLister( FunctionUsage & result )
+				: m_result{ result }
+			{
+			}
+
+			void addWritten( expr::Expr const & expr )
+			{
+				if ( auto var = getAccessChainRoot( expr ) )
+				{
+					m_result.written.insert( var->getId() );
+				}
+			}
+
+			void addLocal( expr::Identifier const & identifier )
+			{
+				m_result.locals.push_back( identifier.getVariable() );
+			}
+
+			void visitArgs( expr::ExprList const & args )
+			{
+				for ( auto & arg : args )
+				{
+					addWritten( *arg );
+					arg->accept( this );
+				}
+			}
+
+		private:
+			void visitUnaryExpr( expr::Unary const * expr )override
+			{
+				switch ( expr->getKind() )
+				{
+				case expr::Kind::ePreIncrement:
+				case expr::Kind::ePreDecrement:
+				case expr::Kind::ePostIncrement:
+				case expr::Kind::ePostDecrement:
+					addWritten( *expr->getOperand() );
+					break;
+				default:
+					break;
+				}
+
+				expr->getOperand()->accept( this );
+			}
+
+			void visitBinaryExpr( expr::Binary const * expr )override
+			{
+				if ( expr->getKind() >= expr::Kind::eAssign
+					&& expr->getKind() <= expr::Kind::eXorAssign )
+				{
+					addWritten( *expr->getLHS() );
+				}
+				else if ( expr->getKind() == expr::Kind::eAlias )
+				{
+					addLocal( static_cast< expr::Alias const & >( *expr ).getIdentifier() );
+				}
+
+				expr->getLHS()->accept( this );
+				expr->getRHS()->accept( this );
+			}
+
+			void visitAggrInitExpr( expr::AggrInit const * expr )override
+			{
+				if ( expr->hasIdentifier() )
+				{
+					addLocal( expr->getIdentifier() );
+				}
+
+				for ( auto & init : expr->getInitialisers() )
+				{
+					init->accept( this );
+				}
+			}
+
+			void visitCompositeConstructExpr( expr::CompositeConstruct const * expr )override
+			{
+				for ( auto & arg : expr->getArgList() )
+				{
+					arg->accept( this );
+				}
+			}
+
+			void visitMbrSelectExpr( expr::MbrSelect const * expr )override
+			{
+				expr->getOuterExpr()->accept( this );
+			}
+
+			void visitFnCallExpr( expr::FnCall const * expr )override
+			{
+				++m_result.calls[expr->getFn()->getVariable()->getId()];
+
+				if ( expr->isMember() )
+				{
+					addWritten( *expr->getInstance() );
+					expr->getInstance()->accept( this );
+				}
+
+				visitArgs( expr->getArgList() );
+			}
+
+			void visitIntrinsicCallExpr( expr::IntrinsicCall const * expr )override
+			{
+				visitArgs( expr->getArgList() );
+			}
+
+			void visitCombinedImageAccessCallExpr( expr::CombinedImageAccessCall const * expr )override
+			{
+				visitArgs( expr->getArgList() );
+			}
+
+			void visitImageAccessCallExpr( expr::StorageImageAccessCall const * expr )override
+			{
+				visitArgs( expr->getArgList() );
+			}
+
+			void visitIdentifierExpr( expr::Identifier const * expr )override
+			{
+				auto var = expr->getVariable();
+
+				if ( var->isMemberVar() )
+				{
+					m_result.memberOuters.insert( var::getOutermost( var )->getId() );
+				}
+			}
+
+			void visitInitExpr( expr::Init const * expr )override
+			{
+				if ( expr->hasIdentifier() )
+				{
+					addLocal( expr->getIdentifier() );
+				}
+
+				if ( auto init = expr->getInitialiser() )
+				{
+					init->accept( this );
+				}
+			}
+
+			void visitLiteralExpr( expr::Literal const * expr )override
+			{
+			}
+
+			void visitQuestionExpr( expr::Question const * expr )override
+			{
+				expr->getCtrlExpr()->accept( this );
+				expr->getTrueExpr()->accept( this );
+				expr->getFalseExpr()->accept( this );
+			}
+
+			void visitStreamAppendExpr( expr::StreamAppend const * expr )override
+			{
+				expr->getOperand()->accept( this );
+			}
+
+			void visitSwitchCaseExpr( expr::SwitchCase const * expr )override
+			{
+			}
+
+			void visitSwitchTestExpr( expr::SwitchTest const * expr )override
+			{
+				expr->getValue()->accept( this );
+			}
+
+			void visitSwizzleExpr( expr::Swizzle const * expr )override
+			{
+				expr->getOuterExpr()->accept( this );
+			}
+
+		private:
+			FunctionUsage & m_result;
+		};
+
+		class StmtUsageLister
+			: public stmt::SimpleVisitor
+		{
+		public:
+			static FunctionUsage submit( stmt::FunctionDecl const & stmt )
+			{
+				FunctionUsage result;
+				StmtUsageLister vis{ result };
+				vis.visitContainerStmt( &stmt );
+
+				if ( !stmt.empty() )
+				{
+					result.endsWithReturn = ( *std::prev( stmt.end() ) )->getKind() == stmt::Kind::eReturn;
+				}
+
+				return result;
+			}
+
+		private:
+			explicit StmtUsageLister( FunctionUsage & result )
+				: m_result{ result }
+			{
+			}
+
+			void visitExpr( expr::Expr const * expr )
+			{
+				if ( expr )
+				{
+					ExprUsageLister::submit( *expr, m_result );
+				}
+			}
+
+		private:
+			void visitContainerStmt( stmt::Container const * cont )override
+			{
+				for ( auto & stmt : *cont )
+				{
+					switch ( stmt->getKind() )
+					{
+					case stmt::Kind::eSimple:
+					case stmt::Kind::eCompound:
+					case stmt::Kind::eVariableDecl:
+					case stmt::Kind::eIf:
+					case stmt::Kind::eElse:
+					case stmt::Kind::eElseIf:
+					case stmt::Kind::eWhile:
+					case stmt::Kind::eFor:
+					case stmt::Kind::eDoWhile:
+					case stmt::Kind::eSwitch:
+					case stmt::Kind::eSwitchCase:
+					case stmt::Kind::eReturn:
+					case stmt::Kind::eBreak:
+					case stmt::Kind::eContinue:
+					case stmt::Kind::eDemote:
+					case stmt::Kind::eTerminateInvocation:
+						++m_result.statements;
+						break;
+					case stmt::Kind::eComment:
+						break;
+					default:
+						// Declarations and stage specific statements stay in their function.
+						m_result.unsupported = true;
+						break;
+					}
+
+					stmt->accept( this );
+				}
+			}
+
+			void visitDoWhileStmt( stmt::DoWhile const * stmt )override
+			{
+				stmt::SimpleVisitor::visitDoWhileStmt( stmt );
+				visitExpr( stmt->getCtrlExpr() );
+			}
+
+			void visitElseIfStmt( stmt::ElseIf const * stmt )override
+			{
+				visitExpr( stmt->getCtrlExpr() );
+				stmt::SimpleVisitor::visitElseIfStmt( stmt );
+			}
+
+			void visitForStmt( stmt::For const * stmt )override
+			{
+				visitExpr( stmt->getInitExpr() );
+				visitExpr( stmt->getCtrlExpr() );
+				visitExpr( stmt->getIncrExpr() );
+				stmt::SimpleVisitor::visitForStmt( stmt );
+			}
+
+			void visitIfStmt( stmt::If const * stmt )override
+			{
+				visitExpr( stmt->getCtrlExpr() );
+				stmt::SimpleVisitor::visitIfStmt( stmt );
+			}
+
+			void visitReturnStmt( stmt::Return const * stmt )override
+			{
+				++m_result.returns;
+				visitExpr( stmt->getExpr() );
+			}
+
+			void visitSimpleStmt( stmt::Simple const * stmt )override
+			{
+				visitExpr( stmt->getExpr() );
+			}
+
+			void visitSwitchStmt( stmt::Switch const * stmt )override
+			{
+				visitExpr( stmt->getTestExpr() );
+				stmt::SimpleVisitor::visitSwitchStmt( stmt );
+			}
+
+			void visitVariableDeclStmt( stmt::VariableDecl const * stmt )override
+			{
+				m_result.locals.push_back( stmt->getVariable() );
+			}
+
+			void visitWhileStmt( stmt::While const * stmt )override
+			{
+				visitExpr( stmt->getCtrlExpr() );
+				stmt::SimpleVisitor::visitWhileStmt( stmt );
+			}
+
+		private:
+			FunctionUsage & m_result;
+		};
+
+		static bool isInlinable( stmt::FunctionDecl const & decl
+			, FunctionUsage const & usage )
+		{
+			if ( decl.getFlags() != 0u
+				|| usage.unsupported
+				|| usage.returns > ( usage.endsWithReturn ? 1u : 0u )
+				|| ( decl.getType()->getReturnType()->getKind() != type::Kind::eVoid && !usage.endsWithReturn ) )
+			{
+				return false;
+			}
+
+			// Member variables can't be remapped to the copies of their outer variable.
+			auto isRemapped = [&usage]( uint32_t id )
+			{
+				return usage.locals.end() != std::find_if( usage.locals.begin()
+					, usage.locals.end()
+					, [id]( var::VariablePtr const & lookup )
+					{
+						return lookup->getId() == id;
+					} );
+			};
+
+			for ( auto & param : *decl.getType() )
+			{
+				if ( usage.memberOuters.contains( param->getId() ) )
+				{
+					return false;
+				}
+			}
+
+			return std::none_of( usage.memberOuters.begin()
+				, usage.memberOuters.end()
+				, isRemapped );
+		}
+
+		class ExprRemapper
+			: public ExprCloner
+		{
+		public:
+			static expr::ExprPtr submit( expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, Bindings const & bindings
+				, expr::Expr const & expr )
+			{
+				expr::ExprPtr result{};
+				ExprRemapper vis{ exprCache, typesCache, bindings, result };
+				expr.accept( &vis );
+
+				if ( expr.isNonUniform() )
+				{
+					result->updateFlag( expr::Flag::eNonUniform );
+				}
+
+				return result;
+			}
+
+		private:
+			ExprRemapper( expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, Bindings const & bindings
+				, expr::ExprPtr & result )
+				: ExprCloner{ exprCache, result }
+				, m_typesCache{ typesCache }
+				, m_bindings{ bindings }
+			{
+			}
+
+			expr::IdentifierPtr remap( expr::Identifier const & expr )
+			{
+				if ( auto it = m_bindings.vars.find( expr.getVariable()->getId() );
+					it != m_bindings.vars.end() )
+				{
+					return m_exprCache.makeIdentifier( m_typesCache, it->second );
+				}
+
+				return m_exprCache.makeIdentifier( expr );
+			}
+
+			expr::ExprPtr doSubmit( expr::Expr const & expr )override
+			{
+				return submit( m_exprCache, m_typesCache, m_bindings, expr );
+			}
+
+			void visitAggrInitExpr( expr::AggrInit const * expr )override
+			{
+				if ( !expr->hasIdentifier() )
+				{
+					ExprCloner::visitAggrInitExpr( expr );
+					return;
+				}
+
+				expr::ExprList initialisers;
+
+				for ( auto & init : expr->getInitialisers() )
+				{
+					initialisers.emplace_back( doSubmit( *init ) );
+				}
+
+				m_result = m_exprCache.makeAggrInit( remap( expr->getIdentifier() )
+					, std::move( initialisers ) );
+			}
+
+			void visitAliasExpr( expr::Alias const * expr )override
+			{
+				m_result = m_exprCache.makeAlias( expr->getType()
+					, remap( expr->getIdentifier() )
+					, doSubmit( *expr->getAliasedExpr() ) );
+			}
+
+			void visitIdentifierExpr( expr::Identifier const * expr )override
+			{
+				if ( auto it = m_bindings.exprs.find( expr->getVariable()->getId() );
+					it != m_bindings.exprs.end() )
+				{
+					m_result = ExprCloner::submit( m_exprCache, *it->second );
+				}
+				else
+				{
+					m_result = remap( *expr );
+				}
+			}
+
+			void visitInitExpr( expr::Init const * expr )override
+			{
+				if ( !expr->hasIdentifier() )
+				{
+					ExprCloner::visitInitExpr( expr );
+					return;
+				}
+
+				m_result = m_exprCache.makeInit( remap( expr->getIdentifier() )
+					, doSubmit( *expr->getInitialiser() ) );
+			}
+
+		private:
+			type::TypesCache & m_typesCache;
+			Bindings const & m_bindings;
+		};
+
+		class BodyCloner
+			: public StmtCloner
+		{
+		public:
+			static void submit( stmt::StmtCache & stmtCache
+				, expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, Bindings const & bindings
+				, stmt::FunctionDecl const & decl
+				, stmt::Container & target )
+			{
+				auto result = stmtCache.makeContainer();
+				BodyCloner vis{ stmtCache, exprCache, typesCache, bindings, result };
+				vis.m_current = &target;
+
+				for ( auto & stmt : decl )
+				{
+					// The final return is processed by the caller.
+					if ( stmt->getKind() != stmt::Kind::eReturn )
+					{
+						stmt->accept( &vis );
+					}
+				}
+			}
+
+		private:
+			BodyCloner( stmt::StmtCache & stmtCache
+				, expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, Bindings const & bindings
+				, stmt::ContainerPtr & result )
+				: StmtCloner{ stmtCache, exprCache, result }
+				, m_typesCache{ typesCache }
+				, m_bindings{ bindings }
+			{
+			}
+
+			expr::ExprPtr doSubmit( expr::Expr const & expr )override
+			{
+				return ExprRemapper::submit( m_exprCache, m_typesCache, m_bindings, expr );
+			}
+
+			void visitVariableDeclStmt( stmt::VariableDecl const * stmt )override
+			{
+				auto var = stmt->getVariable();
+
+				if ( auto it = m_bindings.vars.find( var->getId() );
+					it != m_bindings.vars.end() )
+				{
+					var = it->second;
+				}
+
+				m_current->addStmt( m_stmtCache.makeVariableDecl( var ) );
+			}
+
+		private:
+			type::TypesCache & m_typesCache;
+			Bindings const & m_bindings;
+		};
+
+		class StmtInliner
+			: public StmtCloner
+		{
+		public:
+			static stmt::ContainerPtr submit( stmt::StmtCache & stmtCache
+				, expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, stmt::Container const & container
+				, SSAData & ssaData
+				, bool useAliases
+				, uint32_t costThreshold
+				, InlineStats & stats )
+			{
+				auto result = stmtCache.makeContainer();
+				StmtInliner vis{ stmtCache, exprCache, typesCache, ssaData, useAliases, costThreshold, stats, result };
+
+				for ( auto & stmt : container )
+				{
+					if ( stmt->getKind() == stmt::Kind::eFunctionDecl )
+					{
+						for ( auto & [id, count] : StmtUsageLister::submit( static_cast< stmt::FunctionDecl const & >( *stmt ) ).calls )
+						{
+							vis.m_callCounts[id] += count;
+						}
+					}
+				}
+
+				container.accept( &vis );
+				return result;
+			}
+
+		private:
+			StmtInliner( stmt::StmtCache & stmtCache
+				, expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, SSAData & ssaData
+				, bool useAliases
+				, uint32_t costThreshold
+				, InlineStats & stats
+				, stmt::ContainerPtr & result )
+				: StmtCloner{ stmtCache, exprCache, result }
+				, m_typesCache{ typesCache }
+				, m_ssaData{ ssaData }
+				, m_useAliases{ useAliases }
+				, m_costThreshold{ costThreshold }
+				, m_stats{ stats }
+			{
+			}
+
+			var::VariablePtr makeVar( var::Variable const & source
+				, uint64_t flags )
+			{
+				++m_ssaData.nextVarId;
+				++m_ssaData.aliasId;
+				auto name = ( source.isTempVar()
+					? std::string{ "tmp" }
+					: source.getName() );
+				return var::makeVariable( m_ssaData.nextVarId
+					, source.getType()
+					, name + "_" + std::to_string( m_ssaData.aliasId )
+					, flags );
+			}
+
+			var::VariablePtr makeTemp( type::TypePtr type )
+			{
+				++m_ssaData.nextVarId;
+				++m_ssaData.aliasId;
+				return var::makeVariable( m_ssaData.nextVarId
+					, type
+					, "tmp_" + std::to_string( m_ssaData.aliasId )
+					, ( var::Flag::eImplicit
+						| var::Flag::eLocale
+						| var::Flag::eTemp ) );
+			}
+
+			bool canUseDirectly( expr::Expr const & arg )const
+			{
+				if ( arg.getKind() == expr::Kind::eLiteral )
+				{
+					return true;
+				}
+
+				if ( arg.getKind() != expr::Kind::eIdentifier )
+				{
+					return false;
+				}
+
+				// The inlined body can't modify the caller's local variables, nor the constants.
+				// Aliases expanded at each use, or of an access chain (loaded at each use),
+				// could read variables the body modifies.
+				auto & var = *static_cast< expr::Identifier const & >( arg ).getVariable();
+
+				if ( var.isAlias() )
+				{
+					return m_useAliases
+						&& m_valueAliases.contains( var.getId() );
+				}
+
+				return !var.isMemberVar()
+					&& ( ( ( var.isLocale() || var.isParam() || var.isLoopVar() )
+							&& !var.isShared()
+							&& !var.isStatic() )
+						|| var.isConstant()
+						|| var.isShaderConstant()
+						|| var.isSpecialisationConstant() );
+			}
+
+			FunctionInfo * getInlinable( expr::Expr const & expr )
+			{
+				if ( expr.getKind() != expr::Kind::eFnCall
+					|| static_cast< expr::FnCall const & >( expr ).isMember() )
+				{
+					return nullptr;
+				}
+
+				auto id = static_cast< expr::FnCall const & >( expr ).getFn()->getVariable()->getId();
+				auto it = m_functions.find( id );
+
+				if ( it == m_functions.end()
+					|| !it->second.inlinable )
+				{
+					return nullptr;
+				}
+
+				auto countIt = m_callCounts.find( id );
+
+				if ( it->second.usage.statements > m_costThreshold
+					&& ( countIt == m_callCounts.end() || countIt->second > 1u ) )
+				{
+					return nullptr;
+				}
+
+				return &it->second;
+			}
+
+			void inlineCall( expr::FnCall const & call
+				, FunctionInfo & info
+				, expr::Identifier const * resultAlias )
+			{
+				auto & decl = *info.decl;
+				Bindings bindings;
+				std::vector< std::pair< expr::Expr const *, var::VariablePtr > > outputs;
+				auto argIt = call.getArgList().begin();
+
+				for ( auto & param : *decl.getType() )
+				{
+					auto & arg = **argIt;
+					++argIt;
+
+					if ( type::isOpaqueType( type::getNonArrayKind( param->getType() ) )
+						|| ( !param->isOutputParam()
+							&& !info.usage.written.contains( param->getId() )
+							&& canUseDirectly( arg ) ) )
+					{
+						bindings.exprs.emplace( param->getId(), &arg );
+						continue;
+					}
+
+					auto copy = makeVar( *param, uint64_t( var::Flag::eImplicit ) | uint64_t( var::Flag::eLocale ) | uint64_t( var::Flag::eTemp ) );
+					bindings.vars.emplace( param->getId(), copy );
+
+					if ( param->isOutputParam() )
+					{
+						outputs.emplace_back( &arg, copy );
+					}
+
+					if ( param->isOutputParam() && !param->isInputParam() )
+					{
+						m_current->addStmt( m_stmtCache.makeVariableDecl( copy ) );
+					}
+					else
+					{
+						m_current->addStmt( m_stmtCache.makeSimple( m_exprCache.makeInit( m_exprCache.makeIdentifier( m_typesCache, copy )
+							, ExprCloner::submit( m_exprCache, arg ) ) ) );
+					}
+				}
+
+				for ( auto & local : info.usage.locals )
+				{
+					if ( !bindings.vars.contains( local->getId() ) )
+					{
+						bindings.vars.emplace( local->getId(), makeVar( *local, local->getFlags() ) );
+					}
+				}
+
+				BodyCloner::submit( m_stmtCache, m_exprCache, m_typesCache, bindings, decl, *m_current );
+
+				if ( resultAlias )
+				{
+					auto & ret = static_cast< stmt::Return const & >( **std::prev( decl.end() ) );
+					auto value = ExprRemapper::submit( m_exprCache, m_typesCache, bindings, *ret.getExpr() );
+
+					if ( !m_useAliases )
+					{
+						// The alias is expanded where it is used, after the output parameters are copied back.
+						auto temp = makeTemp( value->getType() );
+						m_current->addStmt( m_stmtCache.makeSimple( m_exprCache.makeInit( m_exprCache.makeIdentifier( m_typesCache, temp )
+							, std::move( value ) ) ) );
+						value = m_exprCache.makeIdentifier( m_typesCache, temp );
+					}
+
+					if ( !isAccessChain( *value ) )
+					{
+						m_valueAliases.insert( resultAlias->getVariable()->getId() );
+					}
+
+					m_current->addStmt( m_stmtCache.makeSimple( m_exprCache.makeAlias( resultAlias->getType()
+						, m_exprCache.makeIdentifier( *resultAlias )
+						, std::move( value ) ) ) );
+				}
+
+				for ( auto & [arg, copy] : outputs )
+				{
+					m_current->addStmt( m_stmtCache.makeSimple( m_exprCache.makeAssign( arg->getType()
+						, ExprCloner::submit( m_exprCache, *arg )
+						, m_exprCache.makeIdentifier( m_typesCache, copy ) ) ) );
+				}
+
+				++m_stats.calls;
+
+				if ( !info.inlined )
+				{
+					info.inlined = true;
+					++m_stats.functions;
+				}
+			}
+
+		private:
+			void visitFunctionDeclStmt( stmt::FunctionDecl const * stmt )override
+			{
+				auto save = m_current;
+				auto cont = m_stmtCache.makeFunctionDecl( stmt->getFuncVar()
+					, stmt->getFlags() );
+				m_current = cont.get();
+				visitContainerStmt( stmt );
+				m_current = save;
+
+				// The processed body is used, so that the functions it called are already inlined.
+				auto & info = m_functions[cont->getFuncVar()->getId()];
+				info.decl = cont.get();
+				info.usage = StmtUsageLister::submit( *cont );
+				info.inlinable = isInlinable( *cont, info.usage );
+				m_current->addStmt( std::move( cont ) );
+			}
+
+			void visitSimpleStmt( stmt::Simple const * stmt )override
+			{
+				// After SSA transformation, the calls are statements, or the value of an alias.
+				auto & expr = *stmt->getExpr();
+
+				if ( auto info = getInlinable( expr ) )
+				{
+					inlineCall( static_cast< expr::FnCall const & >( expr )
+						, *info
+						, nullptr );
+				}
+				else if ( expr.getKind() == expr::Kind::eAlias
+					&& static_cast< expr::Alias const & >( expr ).hasIdentifier() )
+				{
+					auto & alias = static_cast< expr::Alias const & >( expr );
+
+					if ( auto aliasInfo = getInlinable( *alias.getAliasedExpr() ) )
+					{
+						inlineCall( static_cast< expr::FnCall const & >( *alias.getAliasedExpr() )
+							, *aliasInfo
+							, &alias.getIdentifier() );
+					}
+					else
+					{
+						if ( !isAccessChain( *alias.getAliasedExpr() ) )
+						{
+							m_valueAliases.insert( alias.getIdentifier().getVariable()->getId() );
+						}
+
+						StmtCloner::visitSimpleStmt( stmt );
+					}
+				}
+				else
+				{
+					StmtCloner::visitSimpleStmt( stmt );
+				}
+			}
+
+		private:
+			type::TypesCache & m_typesCache;
+			SSAData & m_ssaData;
+			bool m_useAliases;
+			uint32_t m_costThreshold;
+			InlineStats & m_stats;
+			std::unordered_map< uint32_t, uint32_t > m_callCounts;
+			std::unordered_map< uint32_t, FunctionInfo > m_functions;
+			// The IDs of the aliases holding a computed value.
+			std::unordered_set< uint32_t > m_valueAliases;
+		};
+	}
+
+	//*************************************************************************
+
+	stmt::ContainerPtr inlineFunctions( stmt::StmtCache & stmtCache
+		, expr::ExprCache & exprCache
+		, type::TypesCache & typesCache
+		, stmt::Container const & container
+		, SSAData & ssaData
+		, bool useAliases
+		, uint32_t costThreshold
+		, InlineStats & stats )
+	{
+		return inlining::StmtInliner::submit( stmtCache
+			, exprCache
+			, typesCache
+			, container
+			, ssaData
+			, useAliases
+			, costThreshold
+			, stats );
+	}
+
+	//*************************************************************************
+}
@@ -0,0 +1,136 @@
+/*
+See LICENSE file in root folder
+*/
+#include "ShaderAST/Visitors/OptimiseStatements.hpp"
+
+#include "ShaderAST/Visitors/ResolveConstants.hpp"
+#include "ShaderAST/Visitors/SimplifyStatements.hpp"
+
+namespace ast
+{
+	size_t hashConfig( OptimisationConfig const & config )
+	{
+		size_t result{};
+		type::hashCombine( result, config.inlineFunctions );
+		type::hashCombine( result, config.inlineCostThreshold );
+		type::hashCombine( result, config.unrollLoops );
+		type::hashCombine( result, config.unrollBudget );
+		type::hashCombine( result, config.propagateConstants );
+		type::hashCombine( result, config.reduceStrength );
+		type::hashCombine( result, config.strengthReduction );
+		type::hashCombine( result, config.coalesceComponents );
+		type::hashCombine( result, config.flattenBranches );
+		type::hashCombine( result, config.flattenCostThreshold );
+		type::hashCombine( result, config.hoistLoopInvariants );
+		type::hashCombine( result, config.eliminateCommonSubexpressions );
+		type::hashCombine( result, config.eliminateDeadCode );
+		type::hashCombine( result, config.eliminateBarriers );
+		type::hashCombine( result, config.barrierElimination );
+		type::hashCombine( result, config.inferBufferAccess );
+		type::hashCombine( result, config.placeNonUniform );
+		type::hashCombine( result, config.relaxPrecision );
+		type::hashCombine( result, config.relaxedPrecisionBound );
+		return result;
+	}
+
+	stmt::ContainerPtr optimiseStatements( stmt::StmtCache & stmtCache
+		, expr::ExprCache & exprCache
+		, type::TypesCache & typesCache
+		, stmt::ContainerPtr container
+		, SSAData & ssaData
+		, bool useAliases
+		, OptimisationConfig const & config )
+	{
+		// Each pass gives new statements, so the input ones are only kept when no pass is enabled.
+		OptimisationStats stats{};
+		auto result = std::move( container );
+
+		// Runs first, so that the other passes see the inlined code.
+		if ( config.inlineFunctions )
+		{
+			result = inlineFunctions( stmtCache, exprCache, typesCache, *result, ssaData, useAliases, config.inlineCostThreshold, stats.inlining );
+		}
+
+		if ( config.unrollLoops )
+		{
+			result = unrollLoops( stmtCache, exprCache, typesCache, *result, ssaData, config.unrollBudget, stats.unrolling );
+		}
+
+		if ( config.propagateConstants )
+		{
+			result = propagateConstants( stmtCache, exprCache, *result, stats.constants );
+		}
+
+		// Folds the expressions using the loop variables and the propagated values, now replaced by literals,
+		// and removes the switch cases that can't be selected anymore.
+		if ( stats.unrolling.loops
+			|| stats.constants.values
+			|| stats.constants.branches )
+		{
+			result = simplify( stmtCache, exprCache, typesCache, *result );
+			result = resolveConstants( stmtCache, exprCache, typesCache, *result );
+		}
+
+		if ( config.reduceStrength )
+		{
+			result = reduceStrength( stmtCache, exprCache, typesCache, *result, config.strengthReduction, stats.strength );
+		}
+
+		if ( config.coalesceComponents )
+		{
+			result = coalesceComponents( stmtCache, exprCache, typesCache, *result, stats.coalescing );
+		}
+
+		if ( config.flattenBranches )
+		{
+			result = flattenBranches( stmtCache, exprCache, typesCache, *result, ssaData, useAliases, config.flattenCostThreshold, stats.flattening );
+		}
+
+		if ( config.hoistLoopInvariants )
+		{
+			result = hoistLoopInvariants( stmtCache, exprCache, typesCache, *result, ssaData, useAliases, stats.loopInvariants );
+		}
+
+		if ( config.eliminateCommonSubexpressions )
+		{
+			result = eliminateCommonSubexpressions( stmtCache, exprCache, typesCache, *result, ssaData, useAliases, stats.commonSubexpressions );
+		}
+
+		// Runs last, since the previous passes leave unused variables behind.
+		if ( config.eliminateDeadCode )
+		{
+			result = eliminateDeadCode( stmtCache, exprCache, *result, stats.deadCode );
+		}
+
+		// Runs after the dead code elimination, which can remove the accesses between two barriers.
+		if ( config.eliminateBarriers )
+		{
+			result = eliminateBarriers( stmtCache, exprCache, typesCache, *result, config.barrierElimination, stats.barriers );
+		}
+
+		// Runs after the dead code elimination, which can remove the last reads or writes of a buffer.
+		if ( config.inferBufferAccess )
+		{
+			result = inferBufferAccess( stmtCache, exprCache, typesCache, *result, stats.bufferAccess );
+		}
+
+		// Runs on the final expressions, the previous passes can move or duplicate the descriptor indices.
+		if ( config.placeNonUniform )
+		{
+			result = placeNonUniform( stmtCache, exprCache, *result, stats.nonUniform );
+		}
+
+		// Also gives a precision to the temporaries created by the previous passes.
+		if ( config.relaxPrecision )
+		{
+			result = relaxPrecision( stmtCache, exprCache, typesCache, *result, config.relaxedPrecisionBound, stats.precision );
+		}
+
+		if ( config.stats )
+		{
+			*config.stats = stats;
+		}
+
+		return result;
+	}
+}
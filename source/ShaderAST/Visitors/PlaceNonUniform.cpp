@@ -0,0 +1,1021 @@
+/*
+See LICENSE file in root folder
+*/
+#include "ShaderAST/Visitors/PlaceNonUniform.hpp"
+
+#include "ShaderAST/Expr/ExprCache.hpp"
+#include "ShaderAST/Expr/ExprVisitor.hpp"
+#include "ShaderAST/Stmt/StmtCache.hpp"
+#include "ShaderAST/Stmt/StmtVisitor.hpp"
+#include "ShaderAST/Type/TypeCache.hpp"
+#include "ShaderAST/Visitors/CloneExpr.hpp"
+#include "ShaderAST/Visitors/CloneStmt.hpp"
+
+#include <algorithm>
+#include <map>
+#include <set>
+
+namespace ast
+{
+	//*************************************************************************
+
+	namespace unif
+	{
+		enum class Uniformity
+		{
+			// The same value for all the invocations of the draw call (of the workgroup, for compute shaders).
+			eUniform,
+			// The same value for all the active invocations of a subgroup.
+			eSubgroup,
+			eNonUniform,
+		};
+
+		struct FunctionData
+		{
+			stmt::FunctionDecl const * decl{};
+			// The uniformity of the control flow at the call sites.
+			Uniformity control{};
+			// The uniformity of the returned values.
+			Uniformity result{};
+		};
+
+		struct Analysis
+		{
+			// The uniformity of the variables written by the shader (locals, parameters, ...).
+			std::map< uint32_t, Uniformity > variables;
+			std::map< uint32_t, FunctionData > functions;
+			// The uniformity of the control flow at the break and continue statements of the loops.
+			std::map< stmt::Stmt const *, Uniformity > loops;
+			// The storage buffers written by the shader.
+			std::set< uint32_t > writtenBuffers;
+			// Tells if the last run changed something.
+			bool changed{};
+
+			void raise( Uniformity & value
+				, Uniformity uniformity )
+			{
+				if ( uniformity > value )
+				{
+					value = uniformity;
+					changed = true;
+				}
+			}
+		};
+
+		static Uniformity join( Uniformity lhs
+			, Uniformity rhs )
+		{
+			return std::max( lhs, rhs );
+		}
+
+		static Uniformity getBuiltinUniformity( Builtin builtin )
+		{
+			switch ( builtin )
+			{
+			case Builtin::eNumWorkGroups:
+			case Builtin::eWorkGroupSize:
+			case Builtin::eWorkGroupID:
+			case Builtin::eWorkDim:
+			case Builtin::eGlobalSize:
+			case Builtin::eEnqueuedWorkgroupSize:
+			case Builtin::eSubgroupSize:
+			case Builtin::eSubgroupMaxSize:
+			case Builtin::eNumSubgroups:
+			case Builtin::eNumEnqueuedSubgroups:
+			case Builtin::eBaseVertex:
+			case Builtin::eBaseInstance:
+			case Builtin::eDrawIndex:
+			case Builtin::eDeviceIndex:
+			case Builtin::ePatchVerticesIn:
+			case Builtin::eLaunchSize:
+				return Uniformity::eUniform;
+			case Builtin::eSubgroupID:
+				return Uniformity::eSubgroup;
+			default:
+				return Uniformity::eNonUniform;
+			}
+		}
+		/**
+		*\return
+		*	\p true if the uniformity of \p var only depends on the values the shader assigns to it.
+		*/
+		static bool isTracked( var::Variable const & var )
+		{
+			return !var.isBuiltin()
+				&& ( var.isLocale()
+					|| var.isParam()
+					|| var.isLoopVar()
+					|| var.isTempVar()
+					|| var.isAlias()
+					|| var.isStatic() );
+		}
+
+		static bool isDescriptorArray( expr::Expr const & expr )
+		{
+			auto type = expr.getType();
+			return type::isArrayType( type->getKind() )
+				&& type::isOpaqueType( type::getNonArrayTypeRec( type ) );
+		}
+
+		static var::VariablePtr getAccessChainRoot( expr::Expr const & expr )
+		{
+			switch ( expr.getKind() )
+			{
+			case expr::Kind::eIdentifier:
+				return var::getOutermost( static_cast< expr::Identifier const & >( expr ).getVariable() );
+			case expr::Kind::eMbrSelect:
+				return getAccessChainRoot( *static_cast< expr::MbrSelect const & >( expr ).getOuterExpr() );
+			case expr::Kind::eSwizzle:
+				return getAccessChainRoot( *static_cast< expr::Swizzle const & >( expr ).getOuterExpr() );
+			case expr::Kind::eArrayAccess:
+				return getAccessChainRoot( *static_cast< expr::ArrayAccess const & >( expr ).getLHS() );
+			default:
+				return nullptr;
+			}
+		}
+
+		static bool hasOutputArgs( expr::Intrinsic intrinsic )
+		{
+			return ( intrinsic >= expr::Intrinsic::eModf1F && intrinsic <= expr::Intrinsic::eModf4D )
+				|| ( intrinsic >= expr::Intrinsic::eFrexp1F && intrinsic <= expr::Intrinsic::eFrexp4D );
+		}
+
+		static bool isAtomic( expr::Intrinsic intrinsic )
+		{
+			return intrinsic >= expr::Intrinsic::eAtomicAddI
+				&& intrinsic <= expr::Intrinsic::eAtomicCompSwapU;
+		}
+
+		class UniformityEvaluator
+			: public expr::SimpleVisitor
+		{
+		public:
+			static Uniformity submit( expr::Expr const & expr
+				, Analysis const & analysis )
+			{
+				Uniformity result{};
+				UniformityEvaluator vis{ analysis, result };
+				expr.accept( &vis );
+				return result;
+			}
+
+		private:
+			UniformityEvaluator( Analysis const & analysis
+				, Uniformity & result )
+				: m_analysis{ analysis }
+				, m_result{ result }
+			{
+			}
+
+			Uniformity doSubmit( expr::Expr const & expr )const
+			{
+				return submit( expr, m_analysis );
+			}
+
+			Uniformity doSubmit( expr::ExprList const & exprs )const
+			{
+				auto result = Uniformity::eUniform;
+
+				for ( auto & expr : exprs )
+				{
+					result = join( result, doSubmit( *expr ) );
+				}
+
+				return result;
+			}
+
+			Uniformity getVariableUniformity( var::VariablePtr var )const
+			{
+				if ( var->isBuiltin() )
+				{
+					return getBuiltinUniformity( var->getBuiltin() );
+				}
+
+				var = var::getOutermost( var );
+
+				if ( var->isBuiltin() )
+				{
+					return getBuiltinUniformity( var->getBuiltin() );
+				}
+
+				if ( isTracked( *var ) )
+				{
+					auto it = m_analysis.variables.find( var->getId() );
+					return it == m_analysis.variables.end()
+						? Uniformity::eUniform
+						: it->second;
+				}
+
+				if ( var->isStorageBuffer() )
+				{
+					// Only the other invocations can change the content of the buffer, if the shader writes it.
+					return m_analysis.writtenBuffers.contains( var->getId() )
+						? Uniformity::eNonUniform
+						: Uniformity::eUniform;
+				}
+
+				if ( var->isUniform()
+					|| var->isPushConstant()
+					|| var->isConstant()
+					|| var->isShaderConstant()
+					|| var->isSpecialisationConstant()
+					|| type::isOpaqueType( type::getNonArrayTypeRec( var->getType() ) ) )
+				{
+					return Uniformity::eUniform;
+				}
+
+				// Shader inputs and outputs, shared variables, ray payloads, buffer references...
+				return Uniformity::eNonUniform;
+			}
+
+			Uniformity getIntrinsicUniformity( expr::IntrinsicCall const & expr )const
+			{
+				auto intrinsic = expr.getIntrinsic();
+				auto isIn = [intrinsic]( expr::Intrinsic min, expr::Intrinsic max )
+				{
+					return intrinsic >= min && intrinsic <= max;
+				};
+
+				// The values read from another invocation of the subgroup (all, any, allEqual, broadcast, broadcastFirst),
+				// which are uniform if the read value is.
+				if ( isIn( expr::Intrinsic::eSubgroupAll, expr::Intrinsic::eSubgroupBroadcastFirst4D )
+					|| isIn( expr::Intrinsic::eReadInvocation1F, expr::Intrinsic::eReadFirstInvocation4D ) )
+				{
+					return std::min( doSubmit( expr.getArgList() ), Uniformity::eSubgroup );
+				}
+
+				// The results of ballots and reductions depend on the active invocations of the subgroup.
+				if ( intrinsic == expr::Intrinsic::eSubgroupBallot
+					|| isIn( expr::Intrinsic::eSubgroupAdd1F, expr::Intrinsic::eSubgroupXor4B ) )
+				{
+					return Uniformity::eSubgroup;
+				}
+
+				if ( intrinsic == expr::Intrinsic::eSubgroupBallotBitExtract
+					|| intrinsic == expr::Intrinsic::eSubgroupBallotBitCount
+					|| intrinsic == expr::Intrinsic::eSubgroupBallotFindLSB
+					|| intrinsic == expr::Intrinsic::eSubgroupBallotFindMSB )
+				{
+					return doSubmit( expr.getArgList() );
+				}
+
+				// The other subgroup operations (elect, scans, shuffles, quad operations) give a value per invocation,
+				// as do the derivatives, the interpolation functions, and the atomic operations.
+				if ( isIn( expr::Intrinsic::eSubgroupElect, expr::Intrinsic::eSubgroupQuadSwapVertical4D )
+					|| isIn( expr::Intrinsic::eDFdx1, expr::Intrinsic::eInterpolateAtOffset4 )
+					|| isAtomic( intrinsic )
+					|| intrinsic == expr::Intrinsic::eHelperInvocation
+					|| intrinsic == expr::Intrinsic::eReportIntersection )
+				{
+					return Uniformity::eNonUniform;
+				}
+
+				return doSubmit( expr.getArgList() );
+			}
+
+		private:
+			void visitUnaryExpr( expr::Unary const * expr )override
+			{
+				m_result = doSubmit( *expr->getOperand() );
+			}
+
+			void visitBinaryExpr( expr::Binary const * expr )override
+			{
+				m_result = join( doSubmit( *expr->getLHS() )
+					, doSubmit( *expr->getRHS() ) );
+			}
+
+			void visitAggrInitExpr( expr::AggrInit const * expr )override
+			{
+				m_result = doSubmit( expr->getInitialisers() );
+			}
+
+			void visitCompositeConstructExpr( expr::CompositeConstruct const * expr )override
+			{
+				m_result = doSubmit( expr->getArgList() );
+			}
+
+			void visitMbrSelectExpr( expr::MbrSelect const * expr )override
+			{
+				m_result = doSubmit( *expr->getOuterExpr() );
+			}
+
+			void visitFnCallExpr( expr::FnCall const * expr )override
+			{
+				// The parameters already hold the uniformity of the arguments of all the calls.
+				if ( auto it = m_analysis.functions.find( expr->getFn()->getVariable()->getId() );
+					it != m_analysis.functions.end() )
+				{
+					m_result = expr->isMember()
+						? join( it->second.result, doSubmit( *expr->getInstance() ) )
+						: it->second.result;
+				}
+				else
+				{
+					m_result = Uniformity::eNonUniform;
+				}
+			}
+
+			void visitIntrinsicCallExpr( expr::IntrinsicCall const * expr )override
+			{
+				m_result = getIntrinsicUniformity( *expr );
+			}
+
+			void visitCombinedImageAccessCallExpr( expr::CombinedImageAccessCall const * expr )override
+			{
+				m_result = doSubmit( expr->getArgList() );
+			}
+
+			void visitImageAccessCallExpr( expr::StorageImageAccessCall const * expr )override
+			{
+				// The storage images can be written by the other invocations.
+				m_result = Uniformity::eNonUniform;
+			}
+
+			void visitIdentifierExpr( expr::Identifier const * expr )override
+			{
+				m_result = getVariableUniformity( expr->getVariable() );
+			}
+
+			void visitInitExpr( expr::Init const * expr )override
+			{
+				m_result = expr->getInitialiser()
+					? doSubmit( *expr->getInitialiser() )
+					: Uniformity::eUniform;
+			}
+
+			void visitLiteralExpr( expr::Literal const * expr )override
+			{
+				m_result = Uniformity::eUniform;
+			}
+
+			void visitQuestionExpr( expr::Question const * expr )override
+			{
+				m_result = join( doSubmit( *expr->getCtrlExpr() )
+					, join( doSubmit( *expr->getTrueExpr() )
+						, doSubmit( *expr->getFalseExpr() ) ) );
+			}
+
+			void visitStreamAppendExpr( expr::StreamAppend const * expr )override
+			{
+				m_result = Uniformity::eNonUniform;
+			}
+
+			void visitSwitchCaseExpr( expr::SwitchCase const * expr )override
+			{
+				m_result = Uniformity::eUniform;
+			}
+
+			void visitSwitchTestExpr( expr::SwitchTest const * expr )override
+			{
+				m_result = doSubmit( *expr->getValue() );
+			}
+
+			void visitSwizzleExpr( expr::Swizzle const * expr )override
+			{
+				m_result = doSubmit( *expr->getOuterExpr() );
+			}
+
+		private:
+			Analysis const & m_analysis;
+			Uniformity & m_result;
+		};
+
+		static Uniformity getUniformity( expr::Expr const & expr
+			, Analysis const & analysis )
+		{
+			return UniformityEvaluator::submit( expr, analysis );
+		}
+		/**
+		*	Raises the uniformity of the variables written by an expression.
+		*/
+		class ExprAnalyser
+			: public expr::SimpleVisitor
+		{
+		public:
+			static void submit( expr::Expr const & expr
+				, Uniformity control
+				, Analysis & analysis )
+			{
+				ExprAnalyser vis{ control, analysis };
+				expr.accept( &vis );
+			}
+
+		private:
+			ExprAnalyser( Uniformity control
+				, Analysis & analysis )
+				: m_control{ control }
+				, m_analysis{ analysis }
+			{
+			}
+
+			void write( var::VariablePtr var
+				, Uniformity uniformity )
+			{
+				if ( !var )
+				{
+					return;
+				}
+
+				if ( isTracked( *var ) )
+				{
+					m_analysis.raise( m_analysis.variables[var->getId()], join( m_control, uniformity ) );
+				}
+				else if ( var->isStorageBuffer()
+					&& m_analysis.writtenBuffers.insert( var->getId() ).second )
+				{
+					m_analysis.changed = true;
+				}
+			}
+
+			void write( expr::Expr const & target
+				, Uniformity uniformity )
+			{
+				write( getAccessChainRoot( target ), uniformity );
+			}
+
+			Uniformity getUniformity( expr::Expr const & expr )const
+			{
+				return unif::getUniformity( expr, m_analysis );
+			}
+
+			void visitCallArgs( expr::FnCall const & expr )
+			{
+				auto it = m_analysis.functions.find( expr.getFn()->getVariable()->getId() );
+
+				if ( it == m_analysis.functions.end() )
+				{
+					auto & fnType = static_cast< type::Function const & >( *expr.getFn()->getType() );
+					auto argIt = expr.getArgList().begin();
+
+					for ( auto & param : fnType )
+					{
+						if ( argIt == expr.getArgList().end() )
+						{
+							break;
+						}
+
+						if ( param->isOutputParam() )
+						{
+							write( **argIt, Uniformity::eNonUniform );
+						}
+
+						++argIt;
+					}
+
+					return;
+				}
+
+				auto & function = it->second;
+				m_analysis.raise( function.control, m_control );
+				auto argIt = expr.getArgList().begin();
+
+				for ( auto & param : *function.decl->getType() )
+				{
+					if ( argIt == expr.getArgList().end() )
+					{
+						break;
+					}
+
+					auto & arg = **argIt;
+					m_analysis.raise( m_analysis.variables[param->getId()], join( m_control, getUniformity( arg ) ) );
+
+					if ( param->isOutputParam() )
+					{
+						write( arg, m_analysis.variables[param->getId()] );
+					}
+
+					++argIt;
+				}
+			}
+
+		private:
+			void visitUnaryExpr( expr::Unary const * expr )override
+			{
+				switch ( expr->getKind() )
+				{
+				case expr::Kind::ePreIncrement:
+				case expr::Kind::ePreDecrement:
+				case expr::Kind::ePostIncrement:
+				case expr::Kind::ePostDecrement:
+					write( *expr->getOperand(), getUniformity( *expr->getOperand() ) );
+					break;
+				default:
+					break;
+				}
+
+				expr->getOperand()->accept( this );
+			}
+
+			void visitBinaryExpr( expr::Binary const * expr )override
+			{
+				switch ( expr->getKind() )
+				{
+				case expr::Kind::eAssign:
+				case expr::Kind::eAlias:
+				case expr::Kind::eAddAssign:
+				case expr::Kind::eMinusAssign:
+				case expr::Kind::eTimesAssign:
+				case expr::Kind::eDivideAssign:
+				case expr::Kind::eModuloAssign:
+				case expr::Kind::eLShiftAssign:
+				case expr::Kind::eRShiftAssign:
+				case expr::Kind::eAndAssign:
+				case expr::Kind::eNotAssign:
+				case expr::Kind::eOrAssign:
+				case expr::Kind::eXorAssign:
+					// The written variable also depends on the indices of the written element.
+					write( *expr->getLHS(), join( getUniformity( *expr->getLHS() )
+						, getUniformity( *expr->getRHS() ) ) );
+					break;
+				default:
+					break;
+				}
+
+				expr->getLHS()->accept( this );
+				expr->getRHS()->accept( this );
+			}
+
+			void visitAggrInitExpr( expr::AggrInit const * expr )override
+			{
+				for ( auto & init : expr->getInitialisers() )
+				{
+					init->accept( this );
+				}
+
+				if ( expr->hasIdentifier() )
+				{
+					write( expr->getIdentifier(), getUniformity( *expr ) );
+				}
+			}
+
+			void visitCompositeConstructExpr( expr::CompositeConstruct const * expr )override
+			{
+				for ( auto & arg : expr->getArgList() )
+				{
+					arg->accept( this );
+				}
+			}
+
+			void visitMbrSelectExpr( expr::MbrSelect const * expr )override
+			{
+				expr->getOuterExpr()->accept( this );
+			}
+
+			void visitFnCallExpr( expr::FnCall const * expr )override
+			{
+				if ( expr->isMember() )
+				{
+					expr->getInstance()->accept( this );
+				}
+
+				for ( auto & arg : expr->getArgList() )
+				{
+					arg->accept( this );
+				}
+
+				visitCallArgs( *expr );
+			}
+
+			void visitIntrinsicCallExpr( expr::IntrinsicCall const * expr )override
+			{
+				for ( auto & arg : expr->getArgList() )
+				{
+					arg->accept( this );
+				}
+
+				if ( hasOutputArgs( expr->getIntrinsic() ) )
+				{
+					write( *expr->getArgList().back(), getUniformity( *expr->getArgList().front() ) );
+				}
+				else if ( isAtomic( expr->getIntrinsic() ) )
+				{
+					write( *expr->getArgList().front(), Uniformity::eNonUniform );
+				}
+			}
+
+			void visitCombinedImageAccessCallExpr( expr::CombinedImageAccessCall const * expr )override
+			{
+				for ( auto & arg : expr->getArgList() )
+				{
+					arg->accept( this );
+				}
+			}
+
+			void visitImageAccessCallExpr( expr::StorageImageAccessCall const * expr )override
+			{
+				for ( auto & arg : expr->getArgList() )
+				{
+					arg->accept( this );
+				}
+			}
+
+			void visitIdentifierExpr( expr::Identifier const * expr )override
+			{
+			}
+
+			void visitInitExpr( expr::Init const * expr )override
+			{
+				if ( auto init = expr->getInitialiser() )
+				{
+					init->accept( this );
+
+					if ( expr->hasIdentifier() )
+					{
+						write( expr->getIdentifier(), getUniformity( *init ) );
+					}
+				}
+			}
+
+			void visitLiteralExpr( expr::Literal const * expr )override
+			{
+			}
+
+			void visitQuestionExpr( expr::Question const * expr )override
+			{
+				expr->getCtrlExpr()->accept( this );
+				expr->getTrueExpr()->accept( this );
+				expr->getFalseExpr()->accept( this );
+			}
+
+			void visitStreamAppendExpr( expr::StreamAppend const * expr )override
+			{
+				expr->getOperand()->accept( this );
+			}
+
+			void visitSwitchCaseExpr( expr::SwitchCase const * expr )override
+			{
+			}
+
+			void visitSwitchTestExpr( expr::SwitchTest const * expr )override
+			{
+				expr->getValue()->accept( this );
+			}
+
+			void visitSwizzleExpr( expr::Swizzle const * expr )override
+			{
+				expr->getOuterExpr()->accept( this );
+			}
+
+		private:
+			Uniformity m_control;
+			Analysis & m_analysis;
+		};
+		/**
+		*	Follows the uniformity of the control flow, and analyses the expressions of the statements with it.
+		*/
+		class StmtAnalyser
+			: public stmt::SimpleVisitor
+		{
+		public:
+			static void submit( stmt::Container const & container
+				, Analysis & analysis )
+			{
+				StmtAnalyser vis{ analysis };
+				container.accept( &vis );
+			}
+
+		private:
+			explicit StmtAnalyser( Analysis & analysis )
+				: m_analysis{ analysis }
+			{
+			}
+
+			void visitExpr( expr::Expr const * expr )
+			{
+				if ( expr )
+				{
+					ExprAnalyser::submit( *expr, m_control, m_analysis );
+				}
+			}
+
+			Uniformity getUniformity( expr::Expr const * expr )const
+			{
+				return expr
+					? unif::getUniformity( *expr, m_analysis )
+					: Uniformity::eUniform;
+			}
+
+			void visitBranch( stmt::Compound const & stmt
+				, Uniformity control )
+			{
+				auto save = m_control;
+				m_control = control;
+				visitContainerStmt( &stmt );
+				m_control = save;
+			}
+			/**
+			*	The invocations leaving a loop early run less iterations than the others,
+			*	so the whole loop depends on the uniformity of the break and continue statements.
+			*/
+			void visitLoop( stmt::Compound const & stmt
+				, Uniformity ctrl )
+			{
+				auto save = m_control;
+				m_control = join( m_control, join( ctrl, m_analysis.loops[&stmt] ) );
+				m_loops.push_back( &stmt );
+				visitContainerStmt( &stmt );
+				m_loops.pop_back();
+				m_control = save;
+			}
+
+		private:
+			void visitBreakStmt( stmt::Break const * stmt )override
+			{
+				if ( !stmt->isSwitchCaseBreak()
+					&& !m_loops.empty() )
+				{
+					m_analysis.raise( m_analysis.loops[m_loops.back()], m_control );
+				}
+			}
+
+			void visitContinueStmt( stmt::Continue const * stmt )override
+			{
+				if ( !m_loops.empty() )
+				{
+					m_analysis.raise( m_analysis.loops[m_loops.back()], m_control );
+				}
+			}
+
+			void visitDoWhileStmt( stmt::DoWhile const * stmt )override
+			{
+				visitLoop( *stmt, getUniformity( stmt->getCtrlExpr() ) );
+				auto save = m_control;
+				m_control = join( m_control, m_analysis.loops[stmt] );
+				visitExpr( stmt->getCtrlExpr() );
+				m_control = save;
+			}
+
+			void visitForStmt( stmt::For const * stmt )override
+			{
+				visitExpr( stmt->getInitExpr() );
+				auto ctrl = getUniformity( stmt->getCtrlExpr() );
+				visitLoop( *stmt, ctrl );
+				auto save = m_control;
+				m_control = join( m_control, join( ctrl, m_analysis.loops[stmt] ) );
+				visitExpr( stmt->getCtrlExpr() );
+				visitExpr( stmt->getIncrExpr() );
+				m_control = save;
+			}
+
+			void visitFunctionDeclStmt( stmt::FunctionDecl const * stmt )override
+			{
+				auto save = m_control;
+				auto & function = m_analysis.functions[stmt->getFuncVar()->getId()];
+				m_function = &function;
+				m_control = function.control;
+				visitContainerStmt( stmt );
+				m_function = nullptr;
+				m_control = save;
+			}
+
+			void visitIfStmt( stmt::If const * stmt )override
+			{
+				visitExpr( stmt->getCtrlExpr() );
+				auto control = join( m_control, getUniformity( stmt->getCtrlExpr() ) );
+				visitBranch( *stmt, control );
+
+				for ( auto & elseIf : stmt->getElseIfList() )
+				{
+					auto save = m_control;
+					m_control = control;
+					visitExpr( elseIf->getCtrlExpr() );
+					m_control = save;
+					control = join( control, getUniformity( elseIf->getCtrlExpr() ) );
+					visitBranch( *elseIf, control );
+				}
+
+				if ( stmt->getElse() )
+				{
+					visitBranch( *stmt->getElse(), control );
+				}
+			}
+
+			void visitReturnStmt( stmt::Return const * stmt )override
+			{
+				visitExpr( stmt->getExpr() );
+
+				if ( m_function )
+				{
+					m_analysis.raise( m_function->result, join( m_control, getUniformity( stmt->getExpr() ) ) );
+				}
+			}
+
+			void visitSimpleStmt( stmt::Simple const * stmt )override
+			{
+				visitExpr( stmt->getExpr() );
+			}
+
+			void visitSwitchStmt( stmt::Switch const * stmt )override
+			{
+				visitExpr( stmt->getTestExpr() );
+				visitBranch( *stmt, join( m_control, getUniformity( stmt->getTestExpr() ) ) );
+			}
+
+			void visitWhileStmt( stmt::While const * stmt )override
+			{
+				auto ctrl = getUniformity( stmt->getCtrlExpr() );
+				auto save = m_control;
+				m_control = join( m_control, join( ctrl, m_analysis.loops[stmt] ) );
+				visitExpr( stmt->getCtrlExpr() );
+				m_control = save;
+				visitLoop( *stmt, ctrl );
+			}
+
+		private:
+			Analysis & m_analysis;
+			Uniformity m_control{};
+			FunctionData * m_function{};
+			std::vector< stmt::Stmt const * > m_loops;
+		};
+
+		static void analyse( stmt::Container const & container
+			, Analysis & analysis )
+		{
+			for ( auto & stmt : container )
+			{
+				if ( stmt->getKind() == stmt::Kind::eFunctionDecl )
+				{
+					auto & decl = static_cast< stmt::FunctionDecl const & >( *stmt );
+					analysis.functions[decl.getFuncVar()->getId()].decl = &decl;
+
+					// The parameters of the entry points are the shader inputs.
+					if ( decl.isEntryPoint() )
+					{
+						for ( auto & param : *decl.getType() )
+						{
+							analysis.variables[param->getId()] = Uniformity::eNonUniform;
+						}
+					}
+				}
+			}
+
+			// The uniformities only grow, and have a maximum, so this ends.
+			do
+			{
+				analysis.changed = false;
+				StmtAnalyser::submit( container, analysis );
+			}
+			while ( analysis.changed );
+		}
+
+		class ExprPlacer
+			: public ExprCloner
+		{
+		public:
+			static expr::ExprPtr submit( expr::ExprCache & exprCache
+				, Analysis const & analysis
+				, expr::Expr const & expr
+				, NonUniformStats & stats )
+			{
+				auto result = clone( exprCache, analysis, expr, stats );
+
+				// The flags placed elsewhere than on a descriptor index don't make a descriptor access valid.
+				if ( expr.isNonUniform()
+					&& !result->isNonUniform() )
+				{
+					++stats.unnecessary;
+				}
+
+				return result;
+			}
+
+		private:
+			static expr::ExprPtr clone( expr::ExprCache & exprCache
+				, Analysis const & analysis
+				, expr::Expr const & expr
+				, NonUniformStats & stats )
+			{
+				expr::ExprPtr result{};
+				ExprPlacer vis{ exprCache, analysis, stats, result };
+				expr.accept( &vis );
+				return result;
+			}
+
+			ExprPlacer( expr::ExprCache & exprCache
+				, Analysis const & analysis
+				, NonUniformStats & stats
+				, expr::ExprPtr & result )
+				: ExprCloner{ exprCache, result }
+				, m_analysis{ analysis }
+				, m_stats{ stats }
+			{
+			}
+
+			expr::ExprPtr doSubmit( expr::Expr const & expr )override
+			{
+				return submit( m_exprCache, m_analysis, expr, m_stats );
+			}
+
+			void visitArrayAccessExpr( expr::ArrayAccess const * expr )override
+			{
+				if ( !isDescriptorArray( *expr->getLHS() ) )
+				{
+					ExprCloner::visitArrayAccessExpr( expr );
+					return;
+				}
+
+				auto & index = *expr->getRHS();
+				auto required = getUniformity( index, m_analysis ) != Uniformity::eUniform;
+				expr::ExprPtr rhs;
+
+				if ( !required )
+				{
+					rhs = doSubmit( index );
+				}
+				else if ( index.isNonUniform() )
+				{
+					rhs = ExprCloner::submit( m_exprCache, index );
+				}
+				else
+				{
+					// Same as the writer's nonuniform(), once simplified.
+					rhs = doSubmit( index );
+					rhs->updateFlag( expr::Flag::eNonUniform );
+					rhs = m_exprCache.makeCopy( std::move( rhs ) );
+					rhs->updateFlag( expr::Flag::eNonUniform );
+					++m_stats.added;
+				}
+
+				m_result = m_exprCache.makeArrayAccess( expr->getType()
+					, doSubmit( *expr->getLHS() )
+					, std::move( rhs ) );
+
+				if ( required && expr->isNonUniform() )
+				{
+					m_result->updateFlag( expr::Flag::eNonUniform );
+				}
+			}
+
+			void visitCopyExpr( expr::Copy const * expr )override
+			{
+				// The copy only held the removed flag, which may also be on its operand.
+				if ( expr->isNonUniform() )
+				{
+					m_result = clone( m_exprCache, m_analysis, *expr->getOperand(), m_stats );
+					return;
+				}
+
+				ExprCloner::visitCopyExpr( expr );
+			}
+
+		private:
+			Analysis const & m_analysis;
+			NonUniformStats & m_stats;
+		};
+
+		class StmtPlacer
+			: public StmtCloner
+		{
+		public:
+			static stmt::ContainerPtr submit( stmt::StmtCache & stmtCache
+				, expr::ExprCache & exprCache
+				, stmt::Container const & container
+				, Analysis const & analysis
+				, NonUniformStats & stats )
+			{
+				auto result = stmtCache.makeContainer();
+				StmtPlacer vis{ stmtCache, exprCache, analysis, stats, result };
+				container.accept( &vis );
+				return result;
+			}
+
+		private:
+			StmtPlacer( stmt::StmtCache & stmtCache
+				, expr::ExprCache & exprCache
+				, Analysis const & analysis
+				, NonUniformStats & stats
+				, stmt::ContainerPtr & result )
+				: StmtCloner{ stmtCache, exprCache, result }
+				, m_analysis{ analysis }
+				, m_stats{ stats }
+			{
+			}
+
+			using StmtCloner::doSubmit;
+
+			expr::ExprPtr doSubmit( expr::Expr const & expr )override
+			{
+				return ExprPlacer::submit( m_exprCache, m_analysis, expr, m_stats );
+			}
+
+		private:
+			Analysis const & m_analysis;
+			NonUniformStats & m_stats;
+		};
+	}
+
+	//*************************************************************************
+
+	stmt::ContainerPtr placeNonUniform( stmt::StmtCache & stmtCache
+		, expr::ExprCache & exprCache
+		, stmt::Container const & container
+		, NonUniformStats & stats )
+	{
+		unif::Analysis analysis;
+		unif::analyse( container, analysis );
+		return unif::StmtPlacer::submit( stmtCache, exprCache, container, analysis, stats );
+	}
+
+	//*************************************************************************
+}
@@ -0,0 +1,871 @@
+/*
+See LICENSE file in root folder
+*/
+#include "ShaderAST/Visitors/PropagateConstants.hpp"
+
+#include "ShaderAST/Expr/ExprVisitor.hpp"
+#include "ShaderAST/Stmt/StmtCache.hpp"
+#include "ShaderAST/Stmt/StmtVisitor.hpp"
+#include "ShaderAST/Type/TypeFunction.hpp"
+#include "ShaderAST/Visitors/CloneExpr.hpp"
+#include "ShaderAST/Visitors/CloneStmt.hpp"
+#include "ShaderAST/Visitors/ResolveConstants.hpp"
+
+#include <unordered_map>
+#include <unordered_set>
+
+namespace ast
+{
+	//*************************************************************************
+
+	namespace sccp
+	{
+		// The known values of the local variables, at a point of the control flow.
+		using Values = std::unordered_map< uint32_t, expr::Literal const * >;
+		using VarIds = std::unordered_set< uint32_t >;
+		// The variables that can be written through an alias, indexed by the alias ID.
+		using Aliases = std::unordered_map< uint32_t, uint32_t >;
+
+		static var::VariablePtr getAccessChainRoot( expr::Expr const & expr )
+		{
+			switch ( expr.getKind() )
+			{
+			case expr::Kind::eIdentifier:
+				return static_cast< expr::Identifier const & >( expr ).getVariable();
+			case expr::Kind::eMbrSelect:
+				return getAccessChainRoot( *static_cast< expr::MbrSelect const & >( expr ).getOuterExpr() );
+			case expr::Kind::eSwizzle:
+				return getAccessChainRoot( *static_cast< expr::Swizzle const & >( expr ).getOuterExpr() );
+			case expr::Kind::eArrayAccess:
+				return getAccessChainRoot( *static_cast< expr::ArrayAccess const & >( expr ).getLHS() );
+			default:
+				return nullptr;
+			}
+		}
+
+		static bool isTracked( var::Variable const & var )
+		{
+			return ( var.isLocale() || var.isLoopVar() )
+				&& !var.isShared()
+				&& !var.isStatic()
+				&& !var.isMemberVar();
+		}
+
+		static bool isTerminated( stmt::Container const & cont )
+		{
+			if ( cont.empty() )
+			{
+				return false;
+			}
+
+			switch ( cont.back()->getKind() )
+			{
+			case stmt::Kind::eReturn:
+			case stmt::Kind::eBreak:
+			case stmt::Kind::eContinue:
+			case stmt::Kind::eTerminateInvocation:
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		static bool isSameValue( expr::Literal const & lhs
+			, expr::Literal const & rhs )
+		{
+			return lhs.getLiteralType() == rhs.getLiteralType()
+				&& ( lhs == rhs )->getValue< expr::LiteralType::eBool >();
+		}
+		/**
+		*\return
+		*	The values known in both \p lhs and \p rhs.
+		*/
+		static Values merge( Values const & lhs
+			, Values const & rhs )
+		{
+			Values result;
+
+			for ( auto & [id, value] : lhs )
+			{
+				if ( auto it = rhs.find( id );
+					it != rhs.end() && isSameValue( *value, *it->second ) )
+				{
+					result.emplace( id, value );
+				}
+			}
+
+			return result;
+		}
+		/**
+		*\return
+		*	The operands of \p expr that are written by \p expr, or that are part of a written access chain.
+		*/
+		static std::unordered_set< expr::Expr const * > getWrittenOperands( expr::Expr const & expr
+			, bool isLHS )
+		{
+			std::unordered_set< expr::Expr const * > result;
+
+			if ( expr.getKind() >= expr::Kind::eAssign
+				&& expr.getKind() <= expr::Kind::eXorAssign )
+			{
+				result.insert( static_cast< expr::Binary const & >( expr ).getLHS() );
+				return result;
+			}
+
+			switch ( expr.getKind() )
+			{
+			case expr::Kind::ePreIncrement:
+			case expr::Kind::ePreDecrement:
+			case expr::Kind::ePostIncrement:
+			case expr::Kind::ePostDecrement:
+				result.insert( static_cast< expr::Unary const & >( expr ).getOperand() );
+				break;
+			case expr::Kind::eMbrSelect:
+				if ( isLHS )
+				{
+					result.insert( static_cast< expr::MbrSelect const & >( expr ).getOuterExpr() );
+				}
+				break;
+			case expr::Kind::eSwizzle:
+				if ( isLHS )
+				{
+					result.insert( static_cast< expr::Swizzle const & >( expr ).getOuterExpr() );
+				}
+				break;
+			case expr::Kind::eArrayAccess:
+				// The index is only read.
+				if ( isLHS )
+				{
+					result.insert( static_cast< expr::ArrayAccess const & >( expr ).getLHS() );
+				}
+				break;
+			case expr::Kind::eFnCall:
+				{
+					auto & fnCall = static_cast< expr::FnCall const & >( expr );
+					auto & fnType = static_cast< type::Function const & >( *fnCall.getFn()->getType() );
+					auto paramIt = fnType.begin();
+
+					for ( auto & arg : fnCall.getArgList() )
+					{
+						if ( paramIt != fnType.end() )
+						{
+							if ( ( *paramIt )->isOutputParam() )
+							{
+								result.insert( arg.get() );
+							}
+
+							++paramIt;
+						}
+					}
+
+					if ( fnCall.isMember() )
+					{
+						result.insert( fnCall.getInstance() );
+					}
+				}
+				break;
+			case expr::Kind::eIntrinsicCall:
+				// The intrinsics output parameters are not listed, so any access chain can be written.
+				for ( auto & arg : static_cast< expr::IntrinsicCall const & >( expr ).getArgList() )
+				{
+					if ( getAccessChainRoot( *arg ) )
+					{
+						result.insert( arg.get() );
+					}
+				}
+				break;
+			case expr::Kind::eCombinedImageAccessCall:
+				for ( auto & arg : static_cast< expr::CombinedImageAccessCall const & >( expr ).getArgList() )
+				{
+					if ( getAccessChainRoot( *arg ) )
+					{
+						result.insert( arg.get() );
+					}
+				}
+				break;
+			case expr::Kind::eImageAccessCall:
+				for ( auto & arg : static_cast< expr::StorageImageAccessCall const & >( expr ).getArgList() )
+				{
+					if ( getAccessChainRoot( *arg ) )
+					{
+						result.insert( arg.get() );
+					}
+				}
+				break;
+			default:
+				break;
+			}
+
+			return result;
+		}
+
+		class ExprWritesLister
+			: public expr::SimpleVisitor
+		{
+		public:
+			static void submit( expr::Expr const & expr
+				, VarIds & written
+				, Aliases & aliases )
+			{
+				ExprWritesLister vis{ false, written, aliases };
+				expr.accept( &vis );
+			}
+
+		private:
+			ExprWritesLister( bool isLHS
+				, VarIds & written
+				, Aliases & aliases )
+				: m_isLHS{ isLHS }
+				, m_written{ written }
+				, m_aliases{ aliases }
+			{
+			}
+
+			void visitOperand( expr::Expr const & parent
+				, expr::Expr const & operand )
+			{
+				ExprWritesLister vis{ getWrittenOperands( parent, m_isLHS ).contains( &operand )
+					, m_written
+					, m_aliases };
+				operand.accept( &vis );
+			}
+
+			void visitOperands( expr::Expr const & parent
+				, expr::ExprList const & operands )
+			{
+				for ( auto & operand : operands )
+				{
+					visitOperand( parent, *operand );
+				}
+			}
+
+		private:
+			void visitUnaryExpr( expr::Unary const * expr )override
+			{
+				visitOperand( *expr, *expr->getOperand() );
+			}
+
+			void visitBinaryExpr( expr::Binary const * expr )override
+			{
+				if ( expr->getKind() == expr::Kind::eAlias )
+				{
+					auto & alias = static_cast< expr::Alias const & >( *expr );
+
+					if ( auto root = getAccessChainRoot( *alias.getAliasedExpr() ) )
+					{
+						m_aliases.emplace( alias.getIdentifier().getVariable()->getId(), root->getId() );
+					}
+				}
+
+				visitOperand( *expr, *expr->getLHS() );
+				visitOperand( *expr, *expr->getRHS() );
+			}
+
+			void visitAggrInitExpr( expr::AggrInit const * expr )override
+			{
+				visitOperands( *expr, expr->getInitialisers() );
+			}
+
+			void visitCompositeConstructExpr( expr::CompositeConstruct const * expr )override
+			{
+				visitOperands( *expr, expr->getArgList() );
+			}
+
+			void visitMbrSelectExpr( expr::MbrSelect const * expr )override
+			{
+				visitOperand( *expr, *expr->getOuterExpr() );
+			}
+
+			void visitFnCallExpr( expr::FnCall const * expr )override
+			{
+				if ( expr->isMember() )
+				{
+					visitOperand( *expr, *expr->getInstance() );
+				}
+
+				visitOperands( *expr, expr->getArgList() );
+			}
+
+			void visitIntrinsicCallExpr( expr::IntrinsicCall const * expr )override
+			{
+				visitOperands( *expr, expr->getArgList() );
+			}
+
+			void visitCombinedImageAccessCallExpr( expr::CombinedImageAccessCall const * expr )override
+			{
+				visitOperands( *expr, expr->getArgList() );
+			}
+
+			void visitImageAccessCallExpr( expr::StorageImageAccessCall const * expr )override
+			{
+				visitOperands( *expr, expr->getArgList() );
+			}
+
+			void visitIdentifierExpr( expr::Identifier const * expr )override
+			{
+				if ( m_isLHS )
+				{
+					m_written.insert( expr->getVariable()->getId() );
+				}
+			}
+
+			void visitInitExpr( expr::Init const * expr )override
+			{
+				if ( auto init = expr->getInitialiser() )
+				{
+					visitOperand( *expr, *init );
+				}
+			}
+
+			void visitLiteralExpr( expr::Literal const * expr )override
+			{
+			}
+
+			void visitQuestionExpr( expr::Question const * expr )override
+			{
+				visitOperand( *expr, *expr->getCtrlExpr() );
+				visitOperand( *expr, *expr->getTrueExpr() );
+				visitOperand( *expr, *expr->getFalseExpr() );
+			}
+
+			void visitStreamAppendExpr( expr::StreamAppend const * expr )override
+			{
+				visitOperand( *expr, *expr->getOperand() );
+			}
+
+			void visitSwitchCaseExpr( expr::SwitchCase const * expr )override
+			{
+			}
+
+			void visitSwitchTestExpr( expr::SwitchTest const * expr )override
+			{
+				visitOperand( *expr, *expr->getValue() );
+			}
+
+			void visitSwizzleExpr( expr::Swizzle const * expr )override
+			{
+				visitOperand( *expr, *expr->getOuterExpr() );
+			}
+
+		private:
+			bool m_isLHS;
+			VarIds & m_written;
+			Aliases & m_aliases;
+		};
+
+		class StmtWritesLister
+			: public stmt::SimpleVisitor
+		{
+		public:
+			static void submit( stmt::Stmt const & stmt
+				, VarIds & written
+				, Aliases & aliases )
+			{
+				StmtWritesLister vis{ written, aliases };
+				stmt.accept( &vis );
+			}
+
+		private:
+			StmtWritesLister( VarIds & written
+				, Aliases & aliases )
+				: m_written{ written }
+				, m_aliases{ aliases }
+			{
+			}
+
+			void visitExpr( expr::Expr const * expr )
+			{
+				if ( expr )
+				{
+					ExprWritesLister::submit( *expr, m_written, m_aliases );
+				}
+			}
+
+		private:
+			void visitDoWhileStmt( stmt::DoWhile const * stmt )override
+			{
+				stmt::SimpleVisitor::visitDoWhileStmt( stmt );
+				visitExpr( stmt->getCtrlExpr() );
+			}
+
+			void visitElseIfStmt( stmt::ElseIf const * stmt )override
+			{
+				visitExpr( stmt->getCtrlExpr() );
+				stmt::SimpleVisitor::visitElseIfStmt( stmt );
+			}
+
+			void visitForStmt( stmt::For const * stmt )override
+			{
+				visitExpr( stmt->getInitExpr() );
+				visitExpr( stmt->getCtrlExpr() );
+				visitExpr( stmt->getIncrExpr() );
+				stmt::SimpleVisitor::visitForStmt( stmt );
+			}
+
+			void visitIfStmt( stmt::If const * stmt )override
+			{
+				visitExpr( stmt->getCtrlExpr() );
+				stmt::SimpleVisitor::visitIfStmt( stmt );
+			}
+
+			void visitReturnStmt( stmt::Return const * stmt )override
+			{
+				visitExpr( stmt->getExpr() );
+			}
+
+			void visitSimpleStmt( stmt::Simple const * stmt )override
+			{
+				visitExpr( stmt->getExpr() );
+			}
+
+			void visitSwitchStmt( stmt::Switch const * stmt )override
+			{
+				visitExpr( stmt->getTestExpr() );
+				stmt::SimpleVisitor::visitSwitchStmt( stmt );
+			}
+
+			void visitWhileStmt( stmt::While const * stmt )override
+			{
+				visitExpr( stmt->getCtrlExpr() );
+				stmt::SimpleVisitor::visitWhileStmt( stmt );
+			}
+
+		private:
+			VarIds & m_written;
+			Aliases & m_aliases;
+		};
+
+		class ExprPropagator
+			: public ExprCloner
+		{
+		public:
+			static expr::ExprPtr submit( expr::ExprCache & exprCache
+				, Values const & values
+				, VarIds & written
+				, ConstantPropagationStats & stats
+				, expr::Expr const & expr
+				, bool isLHS = false )
+			{
+				expr::ExprPtr result{};
+				ExprPropagator vis{ exprCache, values, written, stats, expr, isLHS, result };
+				expr.accept( &vis );
+
+				if ( expr.isNonUniform() )
+				{
+					result->updateFlag( expr::Flag::eNonUniform );
+				}
+
+				return result;
+			}
+
+		private:
+			ExprPropagator( expr::ExprCache & exprCache
+				, Values const & values
+				, VarIds & written
+				, ConstantPropagationStats & stats
+				, expr::Expr const & expr
+				, bool isLHS
+				, expr::ExprPtr & result )
+				: ExprCloner{ exprCache, result }
+				, m_values{ values }
+				, m_written{ written }
+				, m_stats{ stats }
+				, m_isLHS{ isLHS }
+				, m_writtenOperands{ getWrittenOperands( expr, isLHS ) }
+			{
+			}
+
+			expr::ExprPtr doSubmit( expr::Expr const & expr )override
+			{
+				return submit( m_exprCache
+					, m_values
+					, m_written
+					, m_stats
+					, expr
+					, m_writtenOperands.contains( &expr ) );
+			}
+
+			void visitAliasExpr( expr::Alias const * expr )override
+			{
+				// An alias to an access chain is a reference, its variables must stay variables.
+				if ( getAccessChainRoot( *expr->getAliasedExpr() ) )
+				{
+					m_result = ExprCloner::submit( m_exprCache, *expr );
+					return;
+				}
+
+				ExprCloner::visitAliasExpr( expr );
+			}
+
+			void visitIdentifierExpr( expr::Identifier const * expr )override
+			{
+				if ( m_isLHS )
+				{
+					m_written.insert( expr->getVariable()->getId() );
+				}
+				else if ( auto it = m_values.find( expr->getVariable()->getId() );
+					it != m_values.end() )
+				{
+					m_result = m_exprCache.makeLiteral( *it->second );
+					++m_stats.values;
+					return;
+				}
+
+				ExprCloner::visitIdentifierExpr( expr );
+			}
+
+		private:
+			Values const & m_values;
+			VarIds & m_written;
+			ConstantPropagationStats & m_stats;
+			bool m_isLHS;
+			std::unordered_set< expr::Expr const * > m_writtenOperands;
+		};
+
+		class StmtPropagator
+			: public StmtCloner
+		{
+		public:
+			static stmt::ContainerPtr submit( stmt::StmtCache & stmtCache
+				, expr::ExprCache & exprCache
+				, stmt::Container const & container
+				, ConstantPropagationStats & stats )
+			{
+				auto result = stmtCache.makeContainer();
+				StmtPropagator vis{ stmtCache, exprCache, stats, result };
+				VarIds written;
+				StmtWritesLister::submit( container, written, vis.m_aliases );
+				container.accept( &vis );
+				return result;
+			}
+
+		private:
+			StmtPropagator( stmt::StmtCache & stmtCache
+				, expr::ExprCache & exprCache
+				, ConstantPropagationStats & stats
+				, stmt::ContainerPtr & result )
+				: StmtCloner{ stmtCache, exprCache, result }
+				, m_stats{ stats }
+			{
+			}
+
+			using StmtCloner::doSubmit;
+
+			expr::ExprPtr doSubmit( expr::Expr const & expr )override
+			{
+				VarIds written;
+				auto result = fold( ExprPropagator::submit( m_exprCache, m_values, written, m_stats, expr ) );
+				kill( written );
+				return result;
+			}
+
+			expr::ExprPtr fold( expr::ExprPtr expr )
+			{
+				if ( expr->getKind() != expr::Kind::eInit )
+				{
+					return resolveConstants( m_exprCache, *expr );
+				}
+
+				// Constants resolution only handles the initialiser.
+				auto & init = static_cast< expr::Init const & >( *expr );
+
+				if ( !init.hasIdentifier()
+					|| !init.getInitialiser() )
+				{
+					return expr;
+				}
+
+				return m_exprCache.makeInit( m_exprCache.makeIdentifier( init.getIdentifier() )
+					, resolveConstants( m_exprCache, *init.getInitialiser() ) );
+			}
+
+			void kill( uint32_t id )
+			{
+				m_values.erase( id );
+
+				if ( auto it = m_aliases.find( id );
+					it != m_aliases.end() )
+				{
+					kill( it->second );
+				}
+			}
+
+			void kill( VarIds const & written )
+			{
+				for ( auto id : written )
+				{
+					kill( id );
+				}
+			}
+
+			void killWrites( stmt::Stmt const & stmt )
+			{
+				VarIds written;
+				StmtWritesLister::submit( stmt, written, m_aliases );
+				kill( written );
+			}
+
+			void setValue( var::Variable const & var
+				, expr::Expr const & value )
+			{
+				if ( !isTracked( var ) )
+				{
+					return;
+				}
+
+				if ( value.getKind() == expr::Kind::eLiteral
+					&& value.getType()->getKind() == var.getType()->getKind() )
+				{
+					auto literal = m_exprCache.makeLiteral( static_cast< expr::Literal const & >( value ) );
+					m_values[var.getId()] = literal.get();
+					m_literals.emplace_back( std::move( literal ) );
+				}
+				else
+				{
+					m_values.erase( var.getId() );
+				}
+			}
+			/**
+			*	Processes \p cont from \p values, into \p target.
+			*\return
+			*	The values at the end of \p cont.
+			*/
+			Values visitBranch( stmt::Container const & cont
+				, Values values
+				, stmt::Container & target )
+			{
+				auto save = m_current;
+				m_values = std::move( values );
+				m_current = &target;
+				visitContainerStmt( &cont );
+				m_current = save;
+				return std::move( m_values );
+			}
+			/**
+			*	Processes a loop, with the variables it writes as unknown, before, within and after it.
+			*/
+			template< typename LoopT, typename VisitT >
+			void visitLoop( LoopT const & stmt
+				, VisitT visit )
+			{
+				killWrites( stmt );
+				auto values = m_values;
+				visit( &stmt );
+				m_values = std::move( values );
+			}
+
+		private:
+			void visitDoWhileStmt( stmt::DoWhile const * stmt )override
+			{
+				visitLoop( *stmt
+					, [this]( stmt::DoWhile const * loop )
+					{
+						StmtCloner::visitDoWhileStmt( loop );
+					} );
+			}
+
+			void visitForStmt( stmt::For const * stmt )override
+			{
+				visitLoop( *stmt
+					, [this]( stmt::For const * loop )
+					{
+						StmtCloner::visitForStmt( loop );
+					} );
+			}
+
+			void visitFunctionDeclStmt( stmt::FunctionDecl const * stmt )override
+			{
+				m_values.clear();
+				StmtCloner::visitFunctionDeclStmt( stmt );
+				m_values.clear();
+			}
+
+			void visitIfStmt( stmt::If const * stmt )override
+			{
+				auto ctrl = doSubmit( stmt->getCtrlExpr() );
+
+				if ( ctrl->getKind() == expr::Kind::eLiteral
+					&& static_cast< expr::Literal const & >( *ctrl ).getLiteralType() == expr::LiteralType::eBool
+					&& stmt->getElseIfList().empty() )
+				{
+					// Only the taken branch remains, in a compound to keep its declarations scoped.
+					auto taken = static_cast< expr::Literal const & >( *ctrl ).getValue< expr::LiteralType::eBool >()
+						? static_cast< stmt::Container const * >( stmt )
+						: static_cast< stmt::Container const * >( stmt->getElse() );
+					++m_stats.branches;
+
+					if ( taken )
+					{
+						auto compound = m_stmtCache.makeCompound();
+						m_values = visitBranch( *taken, std::move( m_values ), *compound );
+						m_current->addStmt( std::move( compound ) );
+					}
+
+					return;
+				}
+
+				if ( !stmt->getElseIfList().empty() )
+				{
+					// Not expected after simplification, the written variables are just forgotten.
+					killWrites( *stmt );
+					auto values = m_values;
+					auto cont = m_stmtCache.makeIf( std::move( ctrl ) );
+				cont->setHint( stmt->getHint() );
+					auto ifStmt = cont.get();
+					m_current->addStmt( std::move( cont ) );
+					visitBranch( *stmt, values, *ifStmt );
+
+					for ( auto & elseIf : stmt->getElseIfList() )
+					{
+						visitBranch( *elseIf, values, *ifStmt->createElseIf( doSubmit( elseIf->getCtrlExpr() ) ) );
+					}
+
+					if ( stmt->getElse() )
+					{
+						visitBranch( *stmt->getElse(), values, *ifStmt->createElse() );
+					}
+
+					m_values = std::move( values );
+					return;
+				}
+
+				// The values after the if statement are the ones known the same way in both branches,
+				// ignoring the branches that don't reach the end of the statement.
+				auto values = m_values;
+				auto cont = m_stmtCache.makeIf( std::move( ctrl ) );
+				cont->setHint( stmt->getHint() );
+				auto ifStmt = cont.get();
+				m_current->addStmt( std::move( cont ) );
+				auto thenValues = visitBranch( *stmt, values, *ifStmt );
+				auto thenEnds = isTerminated( *stmt );
+				auto elseValues = values;
+				auto elseEnds = false;
+
+				if ( auto elseStmt = stmt->getElse() )
+				{
+					elseValues = visitBranch( *elseStmt, values, *ifStmt->createElse() );
+					elseEnds = isTerminated( *elseStmt );
+				}
+
+				if ( thenEnds && elseEnds )
+				{
+					m_values.clear();
+				}
+				else if ( thenEnds )
+				{
+					m_values = std::move( elseValues );
+				}
+				else if ( elseEnds )
+				{
+					m_values = std::move( thenValues );
+				}
+				else
+				{
+					m_values = merge( thenValues, elseValues );
+				}
+			}
+
+			void visitSimpleStmt( stmt::Simple const * stmt )override
+			{
+				auto expr = doSubmit( stmt->getExpr() );
+
+				switch ( expr->getKind() )
+				{
+				case expr::Kind::eInit:
+					{
+						auto & init = static_cast< expr::Init const & >( *expr );
+
+						if ( init.hasIdentifier()
+							&& init.getInitialiser() )
+						{
+							setValue( *init.getIdentifier().getVariable(), *init.getInitialiser() );
+						}
+					}
+					break;
+				case expr::Kind::eAlias:
+					{
+						auto & alias = static_cast< expr::Alias const & >( *expr );
+						setValue( *alias.getIdentifier().getVariable(), *alias.getAliasedExpr() );
+					}
+					break;
+				case expr::Kind::eAssign:
+					{
+						auto & assign = static_cast< expr::Assign const & >( *expr );
+
+						if ( assign.getLHS()->getKind() == expr::Kind::eIdentifier )
+						{
+							setValue( *static_cast< expr::Identifier const & >( *assign.getLHS() ).getVariable(), *assign.getRHS() );
+						}
+					}
+					break;
+				default:
+					break;
+				}
+
+				m_current->addStmt( m_stmtCache.makeSimple( std::move( expr ) ) );
+			}
+
+			void visitSwitchCaseStmt( stmt::SwitchCase const * stmt )override
+			{
+				// Each case can be entered from the test, with the values known before the switch.
+				m_values = m_switchValues.back();
+				StmtCloner::visitSwitchCaseStmt( stmt );
+			}
+
+			void visitSwitchStmt( stmt::Switch const * stmt )override
+			{
+				auto test = doSubmit( stmt->getTestExpr()->getValue() );
+
+				// The case matching the literal is selected by constants resolution.
+				if ( test->getKind() == expr::Kind::eLiteral )
+				{
+					++m_stats.branches;
+				}
+
+				killWrites( *stmt );
+				m_switchValues.push_back( m_values );
+				auto save = m_current;
+				auto cont = m_stmtCache.makeSwitch( m_exprCache.makeSwitchTest( std::move( test ) ) );
+				m_switchStmts.push_back( cont.get() );
+				m_current = cont.get();
+				visitContainerStmt( stmt );
+				m_current = save;
+				m_current->addStmt( std::move( cont ) );
+				m_switchStmts.pop_back();
+				m_values = std::move( m_switchValues.back() );
+				m_switchValues.pop_back();
+			}
+
+			void visitWhileStmt( stmt::While const * stmt )override
+			{
+				visitLoop( *stmt
+					, [this]( stmt::While const * loop )
+					{
+						StmtCloner::visitWhileStmt( loop );
+					} );
+			}
+
+		private:
+			ConstantPropagationStats & m_stats;
+			Values m_values;
+			Aliases m_aliases;
+			std::vector< Values > m_switchValues;
+			std::vector< expr::ExprPtr > m_literals;
+		};
+	}
+
+	//*************************************************************************
+
+	stmt::ContainerPtr propagateConstants( stmt::StmtCache & stmtCache
+		, expr::ExprCache & exprCache
+		, stmt::Container const & container
+		, ConstantPropagationStats & stats )
+	{
+		return sccp::StmtPropagator::submit( stmtCache
+			, exprCache
+			, container
+			, stats );
+	}
+
+	//*************************************************************************
+}
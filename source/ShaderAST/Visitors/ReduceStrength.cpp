@@ -0,0 +1,696 @@
+/*
+See LICENSE file in root folder
+*/
+#include "ShaderAST/Visitors/ReduceStrength.hpp"
+
+#include "ShaderAST/Expr/ExprCache.hpp"
+#include "ShaderAST/Stmt/StmtCache.hpp"
+#include "ShaderAST/Type/TypeCache.hpp"
+#include "ShaderAST/Visitors/CloneExpr.hpp"
+#include "ShaderAST/Visitors/CloneStmt.hpp"
+
+#include <cmath>
+#include <limits>
+
+namespace ast
+{
+	//*************************************************************************
+
+	namespace strength
+	{
+		/**
+		*\return
+		*	The literal, if \p expr is a literal, or a composite built from the same literal.
+		*/
+		static expr::Literal const * getUniformLiteral( expr::Expr const & expr )
+		{
+			if ( expr.getKind() == expr::Kind::eLiteral )
+			{
+				return &static_cast< expr::Literal const & >( expr );
+			}
+
+			if ( expr.getKind() != expr::Kind::eCompositeConstruct )
+			{
+				return nullptr;
+			}
+
+			auto & composite = static_cast< expr::CompositeConstruct const & >( expr );
+
+			if ( composite.getArgList().empty()
+				|| !isScalarType( composite.getComponent() ) )
+			{
+				return nullptr;
+			}
+
+			expr::Literal const * result{};
+
+			for ( auto & arg : composite.getArgList() )
+			{
+				if ( arg->getKind() != expr::Kind::eLiteral )
+				{
+					return nullptr;
+				}
+
+				auto & literal = static_cast< expr::Literal const & >( *arg );
+
+				if ( result
+					&& ( result->getLiteralType() != literal.getLiteralType()
+						|| !( *result == literal )->getValue< expr::LiteralType::eBool >() ) )
+				{
+					return nullptr;
+				}
+
+				result = &literal;
+			}
+
+			return result;
+		}
+
+		static bool getFloatValue( expr::Literal const & literal
+			, double & value )
+		{
+			switch ( literal.getLiteralType() )
+			{
+			case expr::LiteralType::eFloat:
+				value = literal.getValue< expr::LiteralType::eFloat >();
+				return true;
+			case expr::LiteralType::eDouble:
+				value = literal.getValue< expr::LiteralType::eDouble >();
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		static bool getIntValue( expr::Literal const & literal
+			, uint64_t & value
+			, bool & isSigned )
+		{
+			isSigned = false;
+
+			switch ( literal.getLiteralType() )
+			{
+			case expr::LiteralType::eInt32:
+				{
+					auto v = literal.getValue< expr::LiteralType::eInt32 >();
+					isSigned = true;
+					value = uint64_t( v < 0 ? 0 : v );
+					return v >= 0;
+				}
+			case expr::LiteralType::eInt64:
+				{
+					auto v = literal.getValue< expr::LiteralType::eInt64 >();
+					isSigned = true;
+					value = uint64_t( v < 0 ? 0 : v );
+					return v >= 0;
+				}
+			case expr::LiteralType::eUInt32:
+				value = literal.getValue< expr::LiteralType::eUInt32 >();
+				return true;
+			case expr::LiteralType::eUInt64:
+				value = literal.getValue< expr::LiteralType::eUInt64 >();
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		static bool isValue( expr::Literal const * literal
+			, int64_t expected )
+		{
+			if ( !literal )
+			{
+				return false;
+			}
+
+			double fvalue{};
+
+			if ( getFloatValue( *literal, fvalue ) )
+			{
+				return fvalue == double( expected );
+			}
+
+			uint64_t ivalue{};
+			bool isSigned{};
+			return expected >= 0
+				&& getIntValue( *literal, ivalue, isSigned )
+				&& ivalue == uint64_t( expected );
+		}
+
+		static bool isPositiveZero( expr::Literal const * literal )
+		{
+			double value{};
+			return literal
+				&& ( !getFloatValue( *literal, value )
+					|| !std::signbit( value ) )
+				&& isValue( literal, 0 );
+		}
+		/**
+		*\return
+		*	The exponent, if \p literal is an integer power of two greater than 1.
+		*/
+		static uint32_t getPowerOfTwo( expr::Literal const * literal )
+		{
+			uint64_t value{};
+			bool isSigned{};
+
+			if ( !literal
+				|| !getIntValue( *literal, value, isSigned )
+				|| value < 2u
+				|| ( value & ( value - 1u ) ) != 0u )
+			{
+				return 0u;
+			}
+
+			uint32_t result{};
+
+			while ( value > 1u )
+			{
+				value >>= 1u;
+				++result;
+			}
+
+			return result;
+		}
+		/**
+		*\return
+		*	\p true if \p value is an exact power of two, with an exact reciprocal as a normal number of \p type.
+		*/
+		static bool hasExactReciprocal( expr::LiteralType type
+			, double value )
+		{
+			int exponent{};
+
+			if ( std::frexp( value, &exponent ) != 0.5 )
+			{
+				return false;
+			}
+
+			auto reciprocal = 1.0 / value;
+
+			if ( type == expr::LiteralType::eFloat )
+			{
+				return reciprocal >= double( std::numeric_limits< float >::min() )
+					&& reciprocal <= double( std::numeric_limits< float >::max() );
+			}
+
+			return reciprocal >= std::numeric_limits< double >::min()
+				&& reciprocal <= std::numeric_limits< double >::max();
+		}
+		/**
+		*\return
+		*	\p true for the variables accesses, cheap enough to be evaluated twice.
+		*/
+		static bool isVariableAccess( expr::Expr const & expr )
+		{
+			switch ( expr.getKind() )
+			{
+			case expr::Kind::eIdentifier:
+			case expr::Kind::eLiteral:
+				return true;
+			case expr::Kind::eMbrSelect:
+				return isVariableAccess( *static_cast< expr::MbrSelect const & >( expr ).getOuterExpr() );
+			case expr::Kind::eSwizzle:
+				return isVariableAccess( *static_cast< expr::Swizzle const & >( expr ).getOuterExpr() );
+			case expr::Kind::eArrayAccess:
+				{
+					auto & arrayAccess = static_cast< expr::ArrayAccess const & >( expr );
+					return isVariableAccess( *arrayAccess.getLHS() )
+						&& ( arrayAccess.getRHS()->getKind() == expr::Kind::eLiteral
+							|| arrayAccess.getRHS()->getKind() == expr::Kind::eIdentifier );
+				}
+			default:
+				return false;
+			}
+		}
+
+		static bool isPow( expr::Intrinsic intrinsic )
+		{
+			return intrinsic >= expr::Intrinsic::ePow1
+				&& intrinsic <= expr::Intrinsic::ePow4;
+		}
+
+		static bool isNormalize( expr::Intrinsic intrinsic )
+		{
+			return intrinsic >= expr::Intrinsic::eNormalize1F
+				&& intrinsic <= expr::Intrinsic::eNormalize4D;
+		}
+
+		static bool isTranspose( expr::Intrinsic intrinsic )
+		{
+			return intrinsic >= expr::Intrinsic::eTranspose2x2F
+				&& intrinsic <= expr::Intrinsic::eTranspose4x4D;
+		}
+
+		static expr::IntrinsicCall const * getIntrinsicCall( expr::Expr const & expr
+			, bool( *isIntrinsic )( expr::Intrinsic ) )
+		{
+			if ( expr.getKind() != expr::Kind::eIntrinsicCall
+				|| !isIntrinsic( static_cast< expr::IntrinsicCall const & >( expr ).getIntrinsic() ) )
+			{
+				return nullptr;
+			}
+
+			return &static_cast< expr::IntrinsicCall const & >( expr );
+		}
+
+		class ExprReducer
+			: public ExprCloner
+		{
+		public:
+			static expr::ExprPtr submit( expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, StrengthReductionMode mode
+				, StrengthReductionStats & stats
+				, expr::Expr const & expr )
+			{
+				expr::ExprPtr result{};
+				ExprReducer vis{ exprCache, typesCache, mode, stats, result };
+				expr.accept( &vis );
+
+				if ( expr.isNonUniform() )
+				{
+					result->updateFlag( expr::Flag::eNonUniform );
+				}
+
+				return result;
+			}
+
+		private:
+			ExprReducer( expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, StrengthReductionMode mode
+				, StrengthReductionStats & stats
+				, expr::ExprPtr & result )
+				: ExprCloner{ exprCache, result }
+				, m_typesCache{ typesCache }
+				, m_mode{ mode }
+				, m_stats{ stats }
+			{
+			}
+
+			using ExprCloner::doSubmit;
+
+			expr::ExprPtr doSubmit( expr::Expr const & expr )override
+			{
+				return submit( m_exprCache, m_typesCache, m_mode, m_stats, expr );
+			}
+
+			bool isFastMath()const
+			{
+				return m_mode == StrengthReductionMode::eFastMath;
+			}
+
+			expr::ExprPtr makeValue( expr::LiteralType type
+				, double value )
+			{
+				if ( type == expr::LiteralType::eFloat )
+				{
+					return m_exprCache.makeLiteral( m_typesCache, float( value ) );
+				}
+
+				return m_exprCache.makeLiteral( m_typesCache, value );
+			}
+
+			expr::ExprPtr makeValue( expr::LiteralType type
+				, uint32_t value )
+			{
+				switch ( type )
+				{
+				case expr::LiteralType::eInt32:
+					return m_exprCache.makeLiteral( m_typesCache, int32_t( value ) );
+				case expr::LiteralType::eInt64:
+					return m_exprCache.makeLiteral( m_typesCache, int64_t( value ) );
+				case expr::LiteralType::eUInt64:
+					return m_exprCache.makeLiteral( m_typesCache, uint64_t( value ) );
+				default:
+					return m_exprCache.makeLiteral( m_typesCache, value );
+				}
+			}
+			/**
+			*	Creates an operand with the same shape (literal or composite) as \p shape, holding \p value.
+			*/
+			template< typename ValueT >
+			expr::ExprPtr makeOperand( expr::Expr const & shape
+				, ValueT value )
+			{
+				if ( shape.getKind() != expr::Kind::eCompositeConstruct )
+				{
+					return value();
+				}
+
+				auto & composite = static_cast< expr::CompositeConstruct const & >( shape );
+				expr::ExprList args;
+
+				for ( size_t i = 0u; i < composite.getArgList().size(); ++i )
+				{
+					args.emplace_back( value() );
+				}
+
+				return m_exprCache.makeCompositeConstruct( composite.getComposite()
+					, composite.getComponent()
+					, std::move( args ) );
+			}
+			/**
+			*\return
+			*	\p operand, if it can replace \p expr.
+			*/
+			expr::ExprPtr keep( expr::Expr const & expr
+				, expr::ExprPtr & operand )
+			{
+				if ( operand->getType()->getKind() != expr.getType()->getKind() )
+				{
+					return nullptr;
+				}
+
+				++m_stats.rewrites;
+				return std::move( operand );
+			}
+
+			expr::ExprPtr makeShift( expr::Binary const & expr
+				, expr::Kind kind
+				, expr::ExprPtr & value
+				, expr::Expr const & factor
+				, expr::Literal const & literal
+				, uint32_t shift )
+			{
+				if ( value->getType()->getKind() != expr.getType()->getKind()
+					|| isMatrixType( expr.getType()->getKind() ) )
+				{
+					return nullptr;
+				}
+
+				auto amount = makeOperand( factor
+					, [this, &literal, shift]()
+					{
+						return makeValue( literal.getLiteralType(), shift );
+					} );
+				++m_stats.rewrites;
+
+				if ( kind == expr::Kind::eLShift )
+				{
+					return m_exprCache.makeLShift( expr.getType(), std::move( value ), std::move( amount ) );
+				}
+
+				return m_exprCache.makeRShift( expr.getType(), std::move( value ), std::move( amount ) );
+			}
+
+			expr::ExprPtr reduceTimes( expr::Times const & expr
+				, expr::ExprPtr & lhs
+				, expr::ExprPtr & rhs )
+			{
+				auto lhsLiteral = getUniformLiteral( *lhs );
+				auto rhsLiteral = getUniformLiteral( *rhs );
+				expr::ExprPtr result{};
+
+				if ( isValue( rhsLiteral, 1 ) )
+				{
+					result = keep( expr, lhs );
+				}
+				else if ( isValue( lhsLiteral, 1 ) )
+				{
+					result = keep( expr, rhs );
+				}
+				else if ( auto rhsShift = getPowerOfTwo( rhsLiteral ) )
+				{
+					result = makeShift( expr, expr::Kind::eLShift, lhs, *rhs, *rhsLiteral, rhsShift );
+				}
+				else if ( auto lhsShift = getPowerOfTwo( lhsLiteral ) )
+				{
+					result = makeShift( expr, expr::Kind::eLShift, rhs, *lhs, *lhsLiteral, lhsShift );
+				}
+
+				return result;
+			}
+
+			expr::ExprPtr reduceDivide( expr::Divide const & expr
+				, expr::ExprPtr & lhs
+				, expr::ExprPtr & rhs )
+			{
+				auto literal = getUniformLiteral( *rhs );
+
+				if ( !literal )
+				{
+					return nullptr;
+				}
+
+				if ( isValue( literal, 1 ) )
+				{
+					return keep( expr, lhs );
+				}
+
+				uint64_t ivalue{};
+				bool isSigned{};
+
+				// A signed division rounds towards zero, unlike the shift.
+				if ( getIntValue( *literal, ivalue, isSigned ) )
+				{
+					auto shift = getPowerOfTwo( literal );
+					return ( shift && !isSigned )
+						? makeShift( expr, expr::Kind::eRShift, lhs, *rhs, *literal, shift )
+						: nullptr;
+				}
+
+				double value{};
+
+				if ( !getFloatValue( *literal, value )
+					|| value == 0.0
+					|| !std::isfinite( value )
+					|| isMatrixType( expr.getType()->getKind() )
+					|| !( isFastMath() || hasExactReciprocal( literal->getLiteralType(), value ) ) )
+				{
+					return nullptr;
+				}
+
+				auto reciprocal = makeOperand( *rhs
+					, [this, literal, value]()
+					{
+						return makeValue( literal->getLiteralType(), 1.0 / value );
+					} );
+				++m_stats.rewrites;
+				return m_exprCache.makeTimes( expr.getType(), std::move( lhs ), std::move( reciprocal ) );
+			}
+
+			expr::ExprPtr reduceAdd( expr::Add const & expr
+				, expr::ExprPtr & lhs
+				, expr::ExprPtr & rhs )
+			{
+				// -0.0 + 0.0 is 0.0, so the float version changes the sign of the zero.
+				auto isZero = [this]( expr::Literal const * literal )
+				{
+					double value{};
+					return isValue( literal, 0 )
+						&& ( isFastMath() || !getFloatValue( *literal, value ) );
+				};
+
+				if ( isZero( getUniformLiteral( *rhs ) ) )
+				{
+					return keep( expr, lhs );
+				}
+
+				if ( isZero( getUniformLiteral( *lhs ) ) )
+				{
+					return keep( expr, rhs );
+				}
+
+				return nullptr;
+			}
+
+			expr::ExprPtr reduceMinus( expr::Minus const & expr
+				, expr::ExprPtr & lhs
+				, expr::ExprPtr & rhs )
+			{
+				if ( isPositiveZero( getUniformLiteral( *rhs ) ) )
+				{
+					return keep( expr, lhs );
+				}
+
+				return nullptr;
+			}
+
+			expr::ExprPtr reduceIntrinsic( expr::IntrinsicCall const & expr
+				, expr::ExprList & args )
+			{
+				if ( isPow( expr.getIntrinsic() ) )
+				{
+					if ( !isValue( getUniformLiteral( *args[1] ), 2 )
+						|| !isVariableAccess( *args[0] ) )
+					{
+						return nullptr;
+					}
+
+					auto copy = ExprCloner::submit( m_exprCache, *args[0] );
+					++m_stats.rewrites;
+					return m_exprCache.makeTimes( expr.getType(), std::move( args[0] ), std::move( copy ) );
+				}
+
+				if ( isTranspose( expr.getIntrinsic() ) )
+				{
+					if ( auto inner = getIntrinsicCall( *args[0], isTranspose ) )
+					{
+						++m_stats.rewrites;
+						return ExprCloner::submit( m_exprCache, *inner->getArgList()[0] );
+					}
+
+					return nullptr;
+				}
+
+				if ( isNormalize( expr.getIntrinsic() )
+					&& isFastMath()
+					&& getIntrinsicCall( *args[0], isNormalize ) )
+				{
+					++m_stats.rewrites;
+					return std::move( args[0] );
+				}
+
+				return nullptr;
+			}
+
+			void visitAddExpr( expr::Add const * expr )override
+			{
+				auto lhs = doSubmit( expr->getLHS() );
+				auto rhs = doSubmit( expr->getRHS() );
+				m_result = reduceAdd( *expr, lhs, rhs );
+
+				if ( !m_result )
+				{
+					m_result = m_exprCache.makeAdd( expr->getType(), std::move( lhs ), std::move( rhs ) );
+				}
+			}
+
+			void visitDivideExpr( expr::Divide const * expr )override
+			{
+				auto lhs = doSubmit( expr->getLHS() );
+				auto rhs = doSubmit( expr->getRHS() );
+				m_result = reduceDivide( *expr, lhs, rhs );
+
+				if ( !m_result )
+				{
+					m_result = m_exprCache.makeDivide( expr->getType(), std::move( lhs ), std::move( rhs ) );
+				}
+			}
+
+			void visitIntrinsicCallExpr( expr::IntrinsicCall const * expr )override
+			{
+				expr::ExprList args;
+
+				for ( auto & arg : expr->getArgList() )
+				{
+					args.emplace_back( doSubmit( *arg ) );
+				}
+
+				m_result = reduceIntrinsic( *expr, args );
+
+				if ( !m_result )
+				{
+					m_result = m_exprCache.makeIntrinsicCall( expr->getType()
+						, expr->getIntrinsic()
+						, std::move( args ) );
+				}
+			}
+
+			void visitMinusExpr( expr::Minus const * expr )override
+			{
+				auto lhs = doSubmit( expr->getLHS() );
+				auto rhs = doSubmit( expr->getRHS() );
+				m_result = reduceMinus( *expr, lhs, rhs );
+
+				if ( !m_result )
+				{
+					m_result = m_exprCache.makeMinus( expr->getType(), std::move( lhs ), std::move( rhs ) );
+				}
+			}
+
+			void visitTimesExpr( expr::Times const * expr )override
+			{
+				auto lhs = doSubmit( expr->getLHS() );
+				auto rhs = doSubmit( expr->getRHS() );
+				m_result = reduceTimes( *expr, lhs, rhs );
+
+				if ( !m_result )
+				{
+					m_result = m_exprCache.makeTimes( expr->getType(), std::move( lhs ), std::move( rhs ) );
+				}
+			}
+
+		private:
+			type::TypesCache & m_typesCache;
+			StrengthReductionMode m_mode;
+			StrengthReductionStats & m_stats;
+		};
+
+		class StmtReducer
+			: public StmtCloner
+		{
+		public:
+			static stmt::ContainerPtr submit( stmt::StmtCache & stmtCache
+				, expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, stmt::Container const & container
+				, StrengthReductionMode mode
+				, StrengthReductionStats & stats )
+			{
+				auto result = stmtCache.makeContainer();
+				StmtReducer vis{ stmtCache, exprCache, typesCache, mode, stats, result };
+				container.accept( &vis );
+				return result;
+			}
+
+		private:
+			StmtReducer( stmt::StmtCache & stmtCache
+				, expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, StrengthReductionMode mode
+				, StrengthReductionStats & stats
+				, stmt::ContainerPtr & result )
+				: StmtCloner{ stmtCache, exprCache, result }
+				, m_typesCache{ typesCache }
+				, m_mode{ mode }
+				, m_stats{ stats }
+			{
+			}
+
+			expr::ExprPtr doSubmit( expr::Expr const & expr )override
+			{
+				return ExprReducer::submit( m_exprCache, m_typesCache, m_mode, m_stats, expr );
+			}
+
+		private:
+			type::TypesCache & m_typesCache;
+			StrengthReductionMode m_mode;
+			StrengthReductionStats & m_stats;
+		};
+	}
+
+	//*************************************************************************
+
+	stmt::ContainerPtr reduceStrength( stmt::StmtCache & stmtCache
+		, expr::ExprCache & exprCache
+		, type::TypesCache & typesCache
+		, stmt::Container const & container
+		, StrengthReductionMode mode
+		, StrengthReductionStats & stats )
+	{
+		return strength::StmtReducer::submit( stmtCache
+			, exprCache
+			, typesCache
+			, container
+			, mode
+			, stats );
+	}
+
+	expr::ExprPtr reduceStrength( expr::ExprCache & exprCache
+		, type::TypesCache & typesCache
+		, expr::Expr const & expr
+		, StrengthReductionMode mode
+		, StrengthReductionStats & stats )
+	{
+		return strength::ExprReducer::submit( exprCache
+			, typesCache
+			, mode
+			, stats
+			, expr );
+	}
+
+	//*************************************************************************
+}
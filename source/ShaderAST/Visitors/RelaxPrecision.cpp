@@ -0,0 +1,1041 @@
+/*
+See LICENSE file in root folder
+*/
+#include "ShaderAST/Visitors/RelaxPrecision.hpp"
+
+#include "ShaderAST/Expr/ExprCache.hpp"
+#include "ShaderAST/Expr/ExprVisitor.hpp"
+#include "ShaderAST/Stmt/StmtCache.hpp"
+#include "ShaderAST/Stmt/StmtVisitor.hpp"
+#include "ShaderAST/Type/TypeCache.hpp"
+#include "ShaderAST/Visitors/CloneExpr.hpp"
+#include "ShaderAST/Visitors/CloneStmt.hpp"
+#include "ShaderAST/Visitors/GetExprName.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+namespace ast
+{
+	//*************************************************************************
+
+	namespace relax
+	{
+		// The times the range of a variable can grow, before it is considered unbounded (loops accumulating values).
+		static constexpr uint32_t MaxUpdates = 8u;
+
+		struct Range
+		{
+			enum class State
+			{
+				// No value seen yet.
+				eEmpty,
+				eBounded,
+				eUnbounded,
+			};
+
+			State state{ State::eEmpty };
+			double min{};
+			double max{};
+
+			bool operator==( Range const & rhs )const = default;
+		};
+
+		struct VariableData
+		{
+			var::VariablePtr variable;
+			// The values assigned to the variable.
+			std::vector< expr::Expr const * > values;
+			// The range of the values of the variable, for the current iteration.
+			Range range;
+			// The times the range grew.
+			uint32_t updates{};
+			// Modified in a way the analysis doesn't follow (compound assignment, output argument...).
+			bool opaque{};
+			// The value needs full precision.
+			bool excluded{};
+		};
+
+		using Variables = std::map< uint32_t, VariableData >;
+
+		static Range makeRange( double min
+			, double max )
+		{
+			return Range{ Range::State::eBounded, min, max };
+		}
+
+		static Range makeUnbounded()
+		{
+			return Range{ Range::State::eUnbounded };
+		}
+
+		static bool isBounded( Range const & range )
+		{
+			return range.state == Range::State::eBounded;
+		}
+
+		static double getMagnitude( Range const & range )
+		{
+			return std::max( std::abs( range.min ), std::abs( range.max ) );
+		}
+
+		static Range join( Range const & lhs
+			, Range const & rhs )
+		{
+			if ( lhs.state == Range::State::eEmpty )
+			{
+				return rhs;
+			}
+
+			if ( rhs.state == Range::State::eEmpty )
+			{
+				return lhs;
+			}
+
+			if ( !isBounded( lhs ) || !isBounded( rhs ) )
+			{
+				return makeUnbounded();
+			}
+
+			return makeRange( std::min( lhs.min, rhs.min )
+				, std::max( lhs.max, rhs.max ) );
+		}
+		/**
+		*\return
+		*	The state of an operation result, when one of its operands is not bounded, \p eBounded otherwise.
+		*/
+		static Range::State getOperationState( Range const & lhs
+			, Range const & rhs )
+		{
+			if ( lhs.state == Range::State::eUnbounded
+				|| rhs.state == Range::State::eUnbounded )
+			{
+				return Range::State::eUnbounded;
+			}
+
+			if ( lhs.state == Range::State::eEmpty
+				|| rhs.state == Range::State::eEmpty )
+			{
+				return Range::State::eEmpty;
+			}
+
+			return Range::State::eBounded;
+		}
+
+		static Range add( Range const & lhs
+			, Range const & rhs )
+		{
+			if ( auto state = getOperationState( lhs, rhs );
+				state != Range::State::eBounded )
+			{
+				return Range{ state };
+			}
+
+			return makeRange( lhs.min + rhs.min, lhs.max + rhs.max );
+		}
+
+		static Range negate( Range const & range )
+		{
+			if ( !isBounded( range ) )
+			{
+				return range;
+			}
+
+			return makeRange( -range.max, -range.min );
+		}
+
+		static Range minus( Range const & lhs
+			, Range const & rhs )
+		{
+			return add( lhs, negate( rhs ) );
+		}
+
+		static Range times( Range const & lhs
+			, Range const & rhs )
+		{
+			if ( auto state = getOperationState( lhs, rhs );
+				state != Range::State::eBounded )
+			{
+				return Range{ state };
+			}
+
+			auto products = { lhs.min * rhs.min, lhs.min * rhs.max, lhs.max * rhs.min, lhs.max * rhs.max };
+			return makeRange( std::min( products ), std::max( products ) );
+		}
+
+		static Range divide( Range const & lhs
+			, Range const & rhs )
+		{
+			if ( isBounded( rhs )
+				&& ( rhs.min > 0.0 || rhs.max < 0.0 ) )
+			{
+				return times( lhs, makeRange( 1.0 / rhs.max, 1.0 / rhs.min ) );
+			}
+
+			return rhs.state == Range::State::eEmpty
+				? rhs
+				: makeUnbounded();
+		}
+
+		static Range absolute( Range const & range )
+		{
+			if ( !isBounded( range ) )
+			{
+				return range;
+			}
+
+			if ( range.min <= 0.0 && range.max >= 0.0 )
+			{
+				return makeRange( 0.0, getMagnitude( range ) );
+			}
+
+			return makeRange( std::min( std::abs( range.min ), std::abs( range.max ) )
+				, getMagnitude( range ) );
+		}
+
+		static bool isCandidate( var::Variable const & var )
+		{
+			auto kind = var.getType()->getKind();
+			return var.isLocale()
+				&& !var.isParam()
+				&& !var.isLoopVar()
+				&& !var.isShared()
+				&& !var.isStatic()
+				&& !var.isMemberVar()
+				&& !var.isRelaxedPrecision()
+				&& ( kind == type::Kind::eFloat
+					|| kind == type::Kind::eVec2F
+					|| kind == type::Kind::eVec3F
+					|| kind == type::Kind::eVec4F );
+		}
+
+		static var::VariablePtr getAccessChainRoot( expr::Expr const & expr )
+		{
+			switch ( expr.getKind() )
+			{
+			case expr::Kind::eIdentifier:
+				return static_cast< expr::Identifier const & >( expr ).getVariable();
+			case expr::Kind::eMbrSelect:
+				return getAccessChainRoot( *static_cast< expr::MbrSelect const & >( expr ).getOuterExpr() );
+			case expr::Kind::eSwizzle:
+				return getAccessChainRoot( *static_cast< expr::Swizzle const & >( expr ).getOuterExpr() );
+			case expr::Kind::eArrayAccess:
+				return getAccessChainRoot( *static_cast< expr::ArrayAccess const & >( expr ).getLHS() );
+			default:
+				return nullptr;
+			}
+		}
+		/**
+		*\return
+		*	\p true if \p expr is a variable, or components of a variable.
+		*/
+		static bool isWholeOrComponents( expr::Expr const & expr )
+		{
+			return expr.getKind() == expr::Kind::eIdentifier
+				|| ( expr.getKind() == expr::Kind::eSwizzle
+					&& static_cast< expr::Swizzle const & >( expr ).getOuterExpr()->getKind() == expr::Kind::eIdentifier );
+		}
+
+		static bool hasOutputArgs( expr::Intrinsic intrinsic )
+		{
+			return ( intrinsic >= expr::Intrinsic::eModf1F && intrinsic <= expr::Intrinsic::eModf4D )
+				|| ( intrinsic >= expr::Intrinsic::eFrexp1F && intrinsic <= expr::Intrinsic::eFrexp4D );
+		}
+
+		class RangeEvaluator
+		{
+		public:
+			RangeEvaluator( Variables const & variables
+				, double maxMagnitude )
+				: m_variables{ variables }
+				, m_maxMagnitude{ maxMagnitude }
+			{
+			}
+
+			Range getRange( expr::Expr const & expr )const
+			{
+				switch ( expr.getKind() )
+				{
+				case expr::Kind::eLiteral:
+					return getLiteralRange( static_cast< expr::Literal const & >( expr ) );
+				case expr::Kind::eIdentifier:
+					return getVariableRange( *static_cast< expr::Identifier const & >( expr ).getVariable() );
+				case expr::Kind::eSwizzle:
+					return getRange( *static_cast< expr::Swizzle const & >( expr ).getOuterExpr() );
+				case expr::Kind::eCompositeConstruct:
+					return getHull( static_cast< expr::CompositeConstruct const & >( expr ).getArgList() );
+				case expr::Kind::eQuestion:
+					return join( getRange( *static_cast< expr::Question const & >( expr ).getTrueExpr() )
+						, getRange( *static_cast< expr::Question const & >( expr ).getFalseExpr() ) );
+				case expr::Kind::eUnaryMinus:
+					return negate( getRange( *static_cast< expr::Unary const & >( expr ).getOperand() ) );
+				case expr::Kind::eUnaryPlus:
+					return getRange( *static_cast< expr::Unary const & >( expr ).getOperand() );
+				case expr::Kind::eAdd:
+				case expr::Kind::eMinus:
+				case expr::Kind::eTimes:
+				case expr::Kind::eDivide:
+					return getBinaryRange( static_cast< expr::Binary const & >( expr ) );
+				case expr::Kind::eIntrinsicCall:
+					return getIntrinsicRange( static_cast< expr::IntrinsicCall const & >( expr ) );
+				default:
+					return makeUnbounded();
+				}
+			}
+
+		private:
+			static Range getLiteralRange( expr::Literal const & expr )
+			{
+				switch ( expr.getLiteralType() )
+				{
+				case expr::LiteralType::eInt32:
+					return makeRange( expr.getValue< expr::LiteralType::eInt32 >(), expr.getValue< expr::LiteralType::eInt32 >() );
+				case expr::LiteralType::eUInt32:
+					return makeRange( expr.getValue< expr::LiteralType::eUInt32 >(), expr.getValue< expr::LiteralType::eUInt32 >() );
+				case expr::LiteralType::eFloat:
+					return makeRange( expr.getValue< expr::LiteralType::eFloat >(), expr.getValue< expr::LiteralType::eFloat >() );
+				case expr::LiteralType::eDouble:
+					return makeRange( expr.getValue< expr::LiteralType::eDouble >(), expr.getValue< expr::LiteralType::eDouble >() );
+				default:
+					return makeUnbounded();
+				}
+			}
+
+			Range getVariableRange( var::Variable const & var )const
+			{
+				if ( var.isRelaxedPrecision() )
+				{
+					return makeRange( -m_maxMagnitude, m_maxMagnitude );
+				}
+
+				if ( auto it = m_variables.find( var.getId() );
+					it != m_variables.end() )
+				{
+					return it->second.range;
+				}
+
+				return makeUnbounded();
+			}
+
+			Range getHull( expr::ExprList const & exprs )const
+			{
+				Range result;
+
+				for ( auto & expr : exprs )
+				{
+					result = join( result, getRange( *expr ) );
+				}
+
+				return result;
+			}
+
+			Range getBinaryRange( expr::Binary const & expr )const
+			{
+				// The ranges of the matrix products components don't follow the ranges of the operands components.
+				if ( isMatrixType( expr.getLHS()->getType()->getKind() )
+					|| isMatrixType( expr.getRHS()->getType()->getKind() ) )
+				{
+					return makeUnbounded();
+				}
+
+				auto lhs = getRange( *expr.getLHS() );
+				auto rhs = getRange( *expr.getRHS() );
+
+				switch ( expr.getKind() )
+				{
+				case expr::Kind::eAdd:
+					return add( lhs, rhs );
+				case expr::Kind::eMinus:
+					return minus( lhs, rhs );
+				case expr::Kind::eTimes:
+					return times( lhs, rhs );
+				default:
+					return divide( lhs, rhs );
+				}
+			}
+
+			Range getIntrinsicRange( expr::IntrinsicCall const & expr )const
+			{
+				auto intrinsic = expr.getIntrinsic();
+				auto & args = expr.getArgList();
+				auto isIn = [intrinsic]( expr::Intrinsic min, expr::Intrinsic max )
+				{
+					return intrinsic >= min && intrinsic <= max;
+				};
+
+				if ( isIn( expr::Intrinsic::eCos1, expr::Intrinsic::eSin4 )
+					|| isIn( expr::Intrinsic::eSign1F, expr::Intrinsic::eSign4D )
+					|| isIn( expr::Intrinsic::eNormalize1F, expr::Intrinsic::eNormalize4D )
+					|| intrinsic == expr::Intrinsic::eUnpackSnorm2x16
+					|| intrinsic == expr::Intrinsic::eUnpackSnorm4x8 )
+				{
+					return makeRange( -1.0, 1.0 );
+				}
+
+				if ( intrinsic == expr::Intrinsic::eUnpackUnorm2x16
+					|| intrinsic == expr::Intrinsic::eUnpackUnorm4x8
+					|| isIn( expr::Intrinsic::eFract1F, expr::Intrinsic::eFract4D )
+					|| isIn( expr::Intrinsic::eStep1F, expr::Intrinsic::eStep4D )
+					|| isIn( expr::Intrinsic::eSmoothStep1F, expr::Intrinsic::eSmoothStep4D ) )
+				{
+					return makeRange( 0.0, 1.0 );
+				}
+
+				if ( isIn( expr::Intrinsic::eAbs1F, expr::Intrinsic::eAbs4D ) )
+				{
+					return absolute( getRange( *args[0] ) );
+				}
+
+				if ( isIn( expr::Intrinsic::eSqrt1F, expr::Intrinsic::eSqrt4D ) )
+				{
+					auto range = getRange( *args[0] );
+					return isBounded( range )
+						? makeRange( 0.0, std::sqrt( std::max( range.max, 0.0 ) ) )
+						: range;
+				}
+
+				if ( isIn( expr::Intrinsic::eMin1F, expr::Intrinsic::eMin4U )
+					|| isIn( expr::Intrinsic::eMax1F, expr::Intrinsic::eMax4U ) )
+				{
+					auto lhs = getRange( *args[0] );
+					auto rhs = getRange( *args[1] );
+
+					if ( auto state = getOperationState( lhs, rhs );
+						state != Range::State::eBounded )
+					{
+						return Range{ state };
+					}
+
+					return intrinsic <= expr::Intrinsic::eMin4U
+						? makeRange( std::min( lhs.min, rhs.min ), std::min( lhs.max, rhs.max ) )
+						: makeRange( std::max( lhs.min, rhs.min ), std::max( lhs.max, rhs.max ) );
+				}
+
+				if ( isIn( expr::Intrinsic::eClamp1F, expr::Intrinsic::eClamp4U ) )
+				{
+					// The result lies in the bounds, whatever the clamped value.
+					auto min = getRange( *args[1] );
+					auto max = getRange( *args[2] );
+
+					if ( auto state = getOperationState( min, max );
+						state != Range::State::eBounded )
+					{
+						return Range{ state };
+					}
+
+					return makeRange( min.min, max.max );
+				}
+
+				if ( isIn( expr::Intrinsic::eMix1F, expr::Intrinsic::eMix4D ) )
+				{
+					auto lhs = getRange( *args[0] );
+					auto rhs = getRange( *args[1] );
+					auto factor = getRange( *args[2] );
+
+					if ( isBounded( factor )
+						&& factor.min >= 0.0
+						&& factor.max <= 1.0 )
+					{
+						return join( lhs, rhs );
+					}
+
+					return add( lhs, times( minus( rhs, lhs ), factor ) );
+				}
+
+				if ( isIn( expr::Intrinsic::eFma1F, expr::Intrinsic::eFma4D ) )
+				{
+					return add( times( getRange( *args[0] ), getRange( *args[1] ) )
+						, getRange( *args[2] ) );
+				}
+
+				if ( isIn( expr::Intrinsic::eLength1F, expr::Intrinsic::eLength4D ) )
+				{
+					auto range = getRange( *args[0] );
+					return isBounded( range )
+						? makeRange( 0.0, std::sqrt( double( getComponentCount( args[0]->getType() ) ) ) * getMagnitude( range ) )
+						: range;
+				}
+
+				if ( isIn( expr::Intrinsic::eDot1F, expr::Intrinsic::eDot4D ) )
+				{
+					auto range = times( absolute( getRange( *args[0] ) ), absolute( getRange( *args[1] ) ) );
+
+					if ( !isBounded( range ) )
+					{
+						return range;
+					}
+
+					auto magnitude = double( getComponentCount( args[0]->getType() ) ) * range.max;
+					return makeRange( -magnitude, magnitude );
+				}
+
+				return makeUnbounded();
+			}
+
+		private:
+			Variables const & m_variables;
+			double m_maxMagnitude;
+		};
+
+		class ExprGatherer
+			: public expr::SimpleVisitor
+		{
+		public:
+			static void submit( expr::Expr const & expr
+				, Variables & variables )
+			{
+				ExprGatherer vis{ variables };
+				expr.accept( &vis );
+			}
+
+		private:
+			explicit ExprGatherer( Variables & variables )
+				: m_variables{ variables }
+			{
+			}
+
+			VariableData * getData( var::VariablePtr var )
+			{
+				if ( !var || !isCandidate( *var ) )
+				{
+					return nullptr;
+				}
+
+				auto & result = m_variables[var->getId()];
+				result.variable = var;
+				return &result;
+			}
+
+			void addValue( expr::Expr const & target
+				, expr::Expr const & value )
+			{
+				if ( auto data = getData( getAccessChainRoot( target ) ) )
+				{
+					if ( isWholeOrComponents( target ) )
+					{
+						data->values.push_back( &value );
+					}
+					else
+					{
+						data->opaque = true;
+					}
+				}
+			}
+
+			void addOpaque( expr::Expr const & target )
+			{
+				if ( auto data = getData( getAccessChainRoot( target ) ) )
+				{
+					data->opaque = true;
+				}
+			}
+
+			void addExcluded( expr::Expr const & expr )
+			{
+				for ( auto ident : listIdentifiers( expr ) )
+				{
+					if ( auto data = getData( ident->getVariable() ) )
+					{
+						data->excluded = true;
+					}
+				}
+			}
+			/**
+			*	The arguments of calls which parameters may be written, and which precision is decided by the callee.
+			*/
+			void visitCallArgs( expr::ExprList const & args )
+			{
+				for ( auto & arg : args )
+				{
+					addOpaque( *arg );
+					addExcluded( *arg );
+					arg->accept( this );
+				}
+			}
+
+		private:
+			void visitUnaryExpr( expr::Unary const * expr )override
+			{
+				switch ( expr->getKind() )
+				{
+				case expr::Kind::ePreIncrement:
+				case expr::Kind::ePreDecrement:
+				case expr::Kind::ePostIncrement:
+				case expr::Kind::ePostDecrement:
+					addOpaque( *expr->getOperand() );
+					break;
+				case expr::Kind::eCast:
+					addExcluded( *expr->getOperand() );
+					break;
+				default:
+					break;
+				}
+
+				expr->getOperand()->accept( this );
+			}
+
+			void visitBinaryExpr( expr::Binary const * expr )override
+			{
+				switch ( expr->getKind() )
+				{
+				case expr::Kind::eAssign:
+					addValue( *expr->getLHS(), *expr->getRHS() );
+
+					if ( auto root = getAccessChainRoot( *expr->getLHS() );
+						root && root->isBuiltin() )
+					{
+						addExcluded( *expr->getRHS() );
+					}
+					break;
+				case expr::Kind::eAddAssign:
+				case expr::Kind::eMinusAssign:
+				case expr::Kind::eTimesAssign:
+				case expr::Kind::eDivideAssign:
+				case expr::Kind::eModuloAssign:
+				case expr::Kind::eLShiftAssign:
+				case expr::Kind::eRShiftAssign:
+				case expr::Kind::eAndAssign:
+				case expr::Kind::eNotAssign:
+				case expr::Kind::eOrAssign:
+				case expr::Kind::eXorAssign:
+					addOpaque( *expr->getLHS() );
+					break;
+				case expr::Kind::eAlias:
+					addValue( *expr->getLHS(), *expr->getRHS() );
+					break;
+				default:
+					break;
+				}
+
+				expr->getLHS()->accept( this );
+				expr->getRHS()->accept( this );
+			}
+
+			void visitAggrInitExpr( expr::AggrInit const * expr )override
+			{
+				for ( auto & init : expr->getInitialisers() )
+				{
+					init->accept( this );
+				}
+			}
+
+			void visitCompositeConstructExpr( expr::CompositeConstruct const * expr )override
+			{
+				for ( auto & arg : expr->getArgList() )
+				{
+					arg->accept( this );
+				}
+			}
+
+			void visitMbrSelectExpr( expr::MbrSelect const * expr )override
+			{
+				expr->getOuterExpr()->accept( this );
+			}
+
+			void visitFnCallExpr( expr::FnCall const * expr )override
+			{
+				if ( expr->isMember() )
+				{
+					expr->getInstance()->accept( this );
+				}
+
+				visitCallArgs( expr->getArgList() );
+			}
+
+			void visitIntrinsicCallExpr( expr::IntrinsicCall const * expr )override
+			{
+				if ( hasOutputArgs( expr->getIntrinsic() ) )
+				{
+					visitCallArgs( expr->getArgList() );
+					return;
+				}
+
+				for ( auto & arg : expr->getArgList() )
+				{
+					arg->accept( this );
+				}
+			}
+
+			void visitCombinedImageAccessCallExpr( expr::CombinedImageAccessCall const * expr )override
+			{
+				// The texture coordinates need their full precision.
+				visitCallArgs( expr->getArgList() );
+			}
+
+			void visitImageAccessCallExpr( expr::StorageImageAccessCall const * expr )override
+			{
+				visitCallArgs( expr->getArgList() );
+			}
+
+			void visitIdentifierExpr( expr::Identifier const * expr )override
+			{
+			}
+
+			void visitInitExpr( expr::Init const * expr )override
+			{
+				if ( auto init = expr->getInitialiser() )
+				{
+					if ( expr->hasIdentifier() )
+					{
+						addValue( expr->getIdentifier(), *init );
+					}
+
+					init->accept( this );
+				}
+			}
+
+			void visitLiteralExpr( expr::Literal const * expr )override
+			{
+			}
+
+			void visitQuestionExpr( expr::Question const * expr )override
+			{
+				expr->getCtrlExpr()->accept( this );
+				expr->getTrueExpr()->accept( this );
+				expr->getFalseExpr()->accept( this );
+			}
+
+			void visitStreamAppendExpr( expr::StreamAppend const * expr )override
+			{
+				expr->getOperand()->accept( this );
+			}
+
+			void visitSwitchCaseExpr( expr::SwitchCase const * expr )override
+			{
+			}
+
+			void visitSwitchTestExpr( expr::SwitchTest const * expr )override
+			{
+				expr->getValue()->accept( this );
+			}
+
+			void visitSwizzleExpr( expr::Swizzle const * expr )override
+			{
+				expr->getOuterExpr()->accept( this );
+			}
+
+		private:
+			Variables & m_variables;
+		};
+
+		class StmtGatherer
+			: public stmt::SimpleVisitor
+		{
+		public:
+			static void submit( stmt::Container const & container
+				, Variables & variables )
+			{
+				StmtGatherer vis{ variables };
+				container.accept( &vis );
+			}
+
+		private:
+			explicit StmtGatherer( Variables & variables )
+				: m_variables{ variables }
+			{
+			}
+
+			void visitExpr( expr::Expr const * expr )
+			{
+				if ( expr )
+				{
+					ExprGatherer::submit( *expr, m_variables );
+				}
+			}
+
+		private:
+			void visitDoWhileStmt( stmt::DoWhile const * stmt )override
+			{
+				stmt::SimpleVisitor::visitDoWhileStmt( stmt );
+				visitExpr( stmt->getCtrlExpr() );
+			}
+
+			void visitElseIfStmt( stmt::ElseIf const * stmt )override
+			{
+				visitExpr( stmt->getCtrlExpr() );
+				stmt::SimpleVisitor::visitElseIfStmt( stmt );
+			}
+
+			void visitForStmt( stmt::For const * stmt )override
+			{
+				visitExpr( stmt->getInitExpr() );
+				visitExpr( stmt->getCtrlExpr() );
+				visitExpr( stmt->getIncrExpr() );
+				stmt::SimpleVisitor::visitForStmt( stmt );
+			}
+
+			void visitIfStmt( stmt::If const * stmt )override
+			{
+				visitExpr( stmt->getCtrlExpr() );
+				stmt::SimpleVisitor::visitIfStmt( stmt );
+			}
+
+			void visitReturnStmt( stmt::Return const * stmt )override
+			{
+				visitExpr( stmt->getExpr() );
+			}
+
+			void visitSimpleStmt( stmt::Simple const * stmt )override
+			{
+				visitExpr( stmt->getExpr() );
+			}
+
+			void visitSwitchStmt( stmt::Switch const * stmt )override
+			{
+				visitExpr( stmt->getTestExpr() );
+				stmt::SimpleVisitor::visitSwitchStmt( stmt );
+			}
+
+			void visitWhileStmt( stmt::While const * stmt )override
+			{
+				visitExpr( stmt->getCtrlExpr() );
+				stmt::SimpleVisitor::visitWhileStmt( stmt );
+			}
+
+		private:
+			Variables & m_variables;
+		};
+
+		static void computeRanges( Variables & variables
+			, double maxMagnitude )
+		{
+			RangeEvaluator evaluator{ variables, maxMagnitude };
+			bool changed = true;
+
+			// The ranges only grow, and are widened to unbounded after MaxUpdates changes, so this ends.
+			while ( changed )
+			{
+				changed = false;
+
+				for ( auto & [id, data] : variables )
+				{
+					if ( data.range.state == Range::State::eUnbounded )
+					{
+						continue;
+					}
+
+					auto range = data.opaque
+						? makeUnbounded()
+						: data.range;
+
+					for ( auto value : data.values )
+					{
+						range = join( range, evaluator.getRange( *value ) );
+					}
+
+					if ( range != data.range )
+					{
+						data.range = ( ++data.updates > MaxUpdates )
+							? makeUnbounded()
+							: range;
+						changed = true;
+					}
+				}
+			}
+		}
+		/**
+		*	The variables used to compute the value of a variable needing full precision need it too.
+		*/
+		static void propagateExclusions( Variables & variables )
+		{
+			std::vector< VariableData * > work;
+
+			for ( auto & [id, data] : variables )
+			{
+				if ( data.excluded )
+				{
+					work.push_back( &data );
+				}
+			}
+
+			while ( !work.empty() )
+			{
+				auto data = work.back();
+				work.pop_back();
+
+				for ( auto value : data->values )
+				{
+					for ( auto ident : listIdentifiers( *value ) )
+					{
+						if ( auto it = variables.find( ident->getVariable()->getId() );
+							it != variables.end() && !it->second.excluded )
+						{
+							it->second.excluded = true;
+							work.push_back( &it->second );
+						}
+					}
+				}
+			}
+		}
+
+		using Relaxed = std::map< uint32_t, var::VariablePtr >;
+
+		class ExprRelaxer
+			: public ExprCloner
+		{
+		public:
+			static expr::ExprPtr submit( expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, Relaxed const & relaxed
+				, expr::Expr const & expr )
+			{
+				expr::ExprPtr result{};
+				ExprRelaxer vis{ exprCache, typesCache, relaxed, result };
+				expr.accept( &vis );
+
+				if ( expr.isNonUniform() )
+				{
+					result->updateFlag( expr::Flag::eNonUniform );
+				}
+
+				return result;
+			}
+
+		private:
+			ExprRelaxer( expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, Relaxed const & relaxed
+				, expr::ExprPtr & result )
+				: ExprCloner{ exprCache, result }
+				, m_typesCache{ typesCache }
+				, m_relaxed{ relaxed }
+			{
+			}
+
+			expr::IdentifierPtr remap( expr::Identifier const & expr )
+			{
+				if ( auto it = m_relaxed.find( expr.getVariable()->getId() );
+					it != m_relaxed.end() )
+				{
+					return m_exprCache.makeIdentifier( m_typesCache, it->second );
+				}
+
+				return m_exprCache.makeIdentifier( expr );
+			}
+
+			expr::ExprPtr doSubmit( expr::Expr const & expr )override
+			{
+				return submit( m_exprCache, m_typesCache, m_relaxed, expr );
+			}
+
+			void visitAliasExpr( expr::Alias const * expr )override
+			{
+				m_result = m_exprCache.makeAlias( expr->getType()
+					, remap( expr->getIdentifier() )
+					, doSubmit( *expr->getAliasedExpr() ) );
+			}
+
+			void visitIdentifierExpr( expr::Identifier const * expr )override
+			{
+				m_result = remap( *expr );
+			}
+
+			void visitInitExpr( expr::Init const * expr )override
+			{
+				if ( !expr->hasIdentifier() )
+				{
+					ExprCloner::visitInitExpr( expr );
+					return;
+				}
+
+				m_result = m_exprCache.makeInit( remap( expr->getIdentifier() )
+					, doSubmit( *expr->getInitialiser() ) );
+			}
+
+		private:
+			type::TypesCache & m_typesCache;
+			Relaxed const & m_relaxed;
+		};
+
+		class StmtRelaxer
+			: public StmtCloner
+		{
+		public:
+			static stmt::ContainerPtr submit( stmt::StmtCache & stmtCache
+				, expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, stmt::Container const & container
+				, Relaxed const & relaxed )
+			{
+				auto result = stmtCache.makeContainer();
+				StmtRelaxer vis{ stmtCache, exprCache, typesCache, relaxed, result };
+				container.accept( &vis );
+				return result;
+			}
+
+		private:
+			StmtRelaxer( stmt::StmtCache & stmtCache
+				, expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, Relaxed const & relaxed
+				, stmt::ContainerPtr & result )
+				: StmtCloner{ stmtCache, exprCache, result }
+				, m_typesCache{ typesCache }
+				, m_relaxed{ relaxed }
+			{
+			}
+
+			using StmtCloner::doSubmit;
+
+			expr::ExprPtr doSubmit( expr::Expr const & expr )override
+			{
+				return ExprRelaxer::submit( m_exprCache, m_typesCache, m_relaxed, expr );
+			}
+
+			void visitVariableDeclStmt( stmt::VariableDecl const * stmt )override
+			{
+				auto var = stmt->getVariable();
+
+				if ( auto it = m_relaxed.find( var->getId() );
+					it != m_relaxed.end() )
+				{
+					var = it->second;
+				}
+
+				m_current->addStmt( m_stmtCache.makeVariableDecl( var ) );
+			}
+
+		private:
+			type::TypesCache & m_typesCache;
+			Relaxed const & m_relaxed;
+		};
+	}
+
+	//*************************************************************************
+
+	stmt::ContainerPtr relaxPrecision( stmt::StmtCache & stmtCache
+		, expr::ExprCache & exprCache
+		, type::TypesCache & typesCache
+		, stmt::Container const & container
+		, float maxMagnitude
+		, RelaxedPrecisionStats & stats )
+	{
+		relax::Variables variables;
+		relax::StmtGatherer::submit( container, variables );
+		relax::computeRanges( variables, maxMagnitude );
+		relax::propagateExclusions( variables );
+		relax::Relaxed relaxed;
+
+		for ( auto & [id, data] : variables )
+		{
+			if ( !data.excluded
+				&& relax::isBounded( data.range )
+				&& relax::getMagnitude( data.range ) <= maxMagnitude )
+			{
+				// The shader variables are shared with the source statements, they are replaced instead of modified.
+				auto & var = *data.variable;
+				relaxed.emplace( id
+					, var::makeVariable( id
+						, var.getType()
+						, var.getName()
+						, var.getFlags() | var::Flag::eRelaxedPrecision ) );
+				++stats.variables;
+			}
+		}
+
+		return relax::StmtRelaxer::submit( stmtCache, exprCache, typesCache, container, relaxed );
+	}
+
+	//*************************************************************************
+}
@@ -3211,6 +3211,7 @@ namespace ast
 				else
 				{
 					processIfStmt( stmt, std::move( ctrlExpr ), first, stopped, ifs );
+					m_ifStmts.back()->setHint( stmt->getHint() );
 				}
 
 				for ( auto & elseIf : stmt->getElseIfList() )
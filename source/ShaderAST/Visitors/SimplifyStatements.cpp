@@ -2286,6 +2286,7 @@ namespace ast
 				auto doWhileContent = m_stmtCache.makeDoWhile( ( scalarType != ast::type::Kind::eBoolean )
 					? helpers::makeToBoolCast( m_exprCache, m_typesCache, std::move( ctrlExpr ) )
 					: std::move( ctrlExpr ) );
+				doWhileContent->setHint( stmt->getHint() );
 				auto save = m_current;
 				m_current = doWhileContent.get();
 				visitContainerStmt( stmt );
@@ -2312,6 +2313,7 @@ namespace ast
 				auto ifCont = m_stmtCache.makeIf( ( scalarType != ast::type::Kind::eBoolean )
 					? helpers::makeToBoolCast( m_exprCache, m_typesCache, std::move( ctrlExpr ) )
 					: std::move( ctrlExpr ) );
+				ifCont->setHint( stmt->getHint() );
 				m_current = ifCont.get();
 				visitContainerStmt( stmt );
 				m_current = save;
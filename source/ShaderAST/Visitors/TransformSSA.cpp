@@ -1185,6 +1185,7 @@ namespace ast
 				TraceFunc;
 				auto save = m_current;
 				auto cont = m_stmtCache.makeIf( doSubmit( stmt->getCtrlExpr() ) );
+				cont->setHint( stmt->getHint() );
 				m_current = cont.get();
 				visitContainerStmt( stmt );
 				m_current = save;
@@ -1245,6 +1246,7 @@ namespace ast
 				{
 					// Do ... while content
 					auto doWhileContent = m_stmtCache.makeDoWhile( doSubmit( stmt->getCtrlExpr() ) );
+					doWhileContent->setHint( stmt->getHint() );
 					auto save2 = m_current;
 					m_current = doWhileContent.get();
 					visitContainerStmt( stmt );
@@ -1264,6 +1266,7 @@ namespace ast
 				{
 					// Do ... while content
 					auto doWhileContent = m_stmtCache.makeDoWhile( doSubmit( stmt->getCtrlExpr() ) );
+					doWhileContent->setHint( stmt->getHint() );
 					auto save = m_current;
 					m_current = doWhileContent.get();
 					visitContainerStmt( stmt );
@@ -0,0 +1,1148 @@
+/*
+See LICENSE file in root folder
+*/
+#include "ShaderAST/Visitors/UnrollLoops.hpp"
+
+#include "ShaderAST/Expr/ExprVisitor.hpp"
+#include "ShaderAST/Stmt/StmtCache.hpp"
+#include "ShaderAST/Stmt/StmtVisitor.hpp"
+#include "ShaderAST/Visitors/CloneExpr.hpp"
+#include "ShaderAST/Visitors/CloneStmt.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace ast
+{
+	//*************************************************************************
+
+	namespace unroll
+	{
+		// The limit for the loops with the unroll hint.
+		static uint32_t constexpr MaxUnrollCost = 1024u;
+
+		struct BodyUsage
+		{
+			// The variables declared in the body.
+			std::vector< var::VariablePtr > locals;
+			// The IDs of the variables that are written, or given to a call as an access chain.
+			std::unordered_set< uint32_t > written;
+			uint32_t statements{};
+			// A break or continue statement applies to the loop itself.
+			bool escapes{};
+		};
+
+		struct LoopControl
+		{
+			// The comparison, with the loop variable as the left operand.
+			expr::Kind op{};
+			int64_t bound{};
+		};
+
+		struct Bindings
+		{
+			// The replacement variables, for the local variables.
+			std::unordered_map< uint32_t, var::VariablePtr > vars;
+			// The replacement expression, for the loop variable.
+			std::unordered_map< uint32_t, expr::Expr const * > exprs;
+		};
+
+		static var::VariablePtr getAccessChainRoot( expr::Expr const & expr )
+		{
+			switch ( expr.getKind() )
+			{
+			case expr::Kind::eIdentifier:
+				return static_cast< expr::Identifier const & >( expr ).getVariable();
+			case expr::Kind::eMbrSelect:
+				return getAccessChainRoot( *static_cast< expr::MbrSelect const & >( expr ).getOuterExpr() );
+			case expr::Kind::eSwizzle:
+				return getAccessChainRoot( *static_cast< expr::Swizzle const & >( expr ).getOuterExpr() );
+			case expr::Kind::eArrayAccess:
+				return getAccessChainRoot( *static_cast< expr::ArrayAccess const & >( expr ).getLHS() );
+			default:
+				return nullptr;
+			}
+		}
+
+		static bool isVariable( expr::Expr const & expr
+			, var::Variable const & var )
+		{
+			return expr.getKind() == expr::Kind::eIdentifier
+				&& static_cast< expr::Identifier const & >( expr ).getVariable()->getId() == var.getId();
+		}
+
+		static bool getLiteralValue( expr::Expr const & expr
+			, type::Kind kind
+			, int64_t & value )
+		{
+			if ( expr.getKind() != expr::Kind::eLiteral )
+			{
+				return false;
+			}
+
+			auto & literal = static_cast< expr::Literal const & >( expr );
+
+			if ( kind == type::Kind::eInt32
+				&& literal.getLiteralType() == expr::LiteralType::eInt32 )
+			{
+				value = literal.getValue< expr::LiteralType::eInt32 >();
+				return true;
+			}
+
+			if ( kind == type::Kind::eUInt32
+				&& literal.getLiteralType() == expr::LiteralType::eUInt32 )
+			{
+				value = literal.getValue< expr::LiteralType::eUInt32 >();
+				return true;
+			}
+
+			return false;
+		}
+
+		static bool isInRange( type::Kind kind
+			, int64_t value )
+		{
+			if ( kind == type::Kind::eInt32 )
+			{
+				return value >= std::numeric_limits< int32_t >::lowest()
+					&& value <= std::numeric_limits< int32_t >::max();
+			}
+
+			return value >= 0
+				&& value <= std::numeric_limits< uint32_t >::max();
+		}
+
+		static expr::Kind swapOperands( expr::Kind op )
+		{
+			switch ( op )
+			{
+			case expr::Kind::eLess:
+				return expr::Kind::eGreater;
+			case expr::Kind::eLessEqual:
+				return expr::Kind::eGreaterEqual;
+			case expr::Kind::eGreater:
+				return expr::Kind::eLess;
+			case expr::Kind::eGreaterEqual:
+				return expr::Kind::eLessEqual;
+			default:
+				return op;
+			}
+		}
+
+		static bool getControl( expr::Expr const & expr
+			, var::Variable const & var
+			, LoopControl & result )
+		{
+			switch ( expr.getKind() )
+			{
+			case expr::Kind::eLess:
+			case expr::Kind::eLessEqual:
+			case expr::Kind::eGreater:
+			case expr::Kind::eGreaterEqual:
+			case expr::Kind::eNotEqual:
+				break;
+			default:
+				return false;
+			}
+
+			auto & binary = static_cast< expr::Binary const & >( expr );
+			auto kind = var.getType()->getKind();
+
+			if ( isVariable( *binary.getLHS(), var )
+				&& getLiteralValue( *binary.getRHS(), kind, result.bound ) )
+			{
+				result.op = expr.getKind();
+				return true;
+			}
+
+			if ( isVariable( *binary.getRHS(), var )
+				&& getLiteralValue( *binary.getLHS(), kind, result.bound ) )
+			{
+				result.op = swapOperands( expr.getKind() );
+				return true;
+			}
+
+			return false;
+		}
+
+		static bool getStepValue( expr::Expr const & value
+			, var::Variable const & var
+			, int64_t & step )
+		{
+			auto kind = var.getType()->getKind();
+
+			if ( value.getKind() == expr::Kind::eAdd )
+			{
+				auto & add = static_cast< expr::Binary const & >( value );
+				return ( isVariable( *add.getLHS(), var ) && getLiteralValue( *add.getRHS(), kind, step ) )
+					|| ( isVariable( *add.getRHS(), var ) && getLiteralValue( *add.getLHS(), kind, step ) );
+			}
+
+			if ( value.getKind() == expr::Kind::eMinus )
+			{
+				auto & minus = static_cast< expr::Binary const & >( value );
+
+				if ( isVariable( *minus.getLHS(), var )
+					&& getLiteralValue( *minus.getRHS(), kind, step ) )
+				{
+					step = -step;
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		static expr::Alias const * getAlias( stmt::Stmt const & stmt )
+		{
+			if ( stmt.getKind() != stmt::Kind::eSimple
+				|| static_cast< stmt::Simple const & >( stmt ).getExpr()->getKind() != expr::Kind::eAlias )
+			{
+				return nullptr;
+			}
+
+			return &static_cast< expr::Alias const & >( *static_cast< stmt::Simple const & >( stmt ).getExpr() );
+		}
+		/**
+		*	Finds the step of the loop variable, at the end of the loop body.
+		*	SSA transformation can compute the new value in an alias, just before the assignment.
+		*\return
+		*	The count of statements holding the step, 0 if none was found.
+		*/
+		static size_t getStep( stmt::Container const & loop
+			, var::Variable const & var
+			, int64_t & step )
+		{
+			if ( loop.empty()
+				|| loop.back()->getKind() != stmt::Kind::eSimple )
+			{
+				return 0u;
+			}
+
+			auto & expr = *static_cast< stmt::Simple const & >( *loop.back() ).getExpr();
+			auto kind = var.getType()->getKind();
+
+			switch ( expr.getKind() )
+			{
+			case expr::Kind::ePreIncrement:
+			case expr::Kind::ePostIncrement:
+				step = 1;
+				return isVariable( *static_cast< expr::Unary const & >( expr ).getOperand(), var ) ? 1u : 0u;
+			case expr::Kind::ePreDecrement:
+			case expr::Kind::ePostDecrement:
+				step = -1;
+				return isVariable( *static_cast< expr::Unary const & >( expr ).getOperand(), var ) ? 1u : 0u;
+			case expr::Kind::eAddAssign:
+			case expr::Kind::eMinusAssign:
+				{
+					auto & binary = static_cast< expr::Binary const & >( expr );
+
+					if ( !isVariable( *binary.getLHS(), var )
+						|| !getLiteralValue( *binary.getRHS(), kind, step ) )
+					{
+						return 0u;
+					}
+
+					step = ( expr.getKind() == expr::Kind::eAddAssign ) ? step : -step;
+					return 1u;
+				}
+			case expr::Kind::eAssign:
+				{
+					auto & assign = static_cast< expr::Assign const & >( expr );
+
+					if ( !isVariable( *assign.getLHS(), var ) )
+					{
+						return 0u;
+					}
+
+					if ( getStepValue( *assign.getRHS(), var, step ) )
+					{
+						return 1u;
+					}
+
+					if ( loop.size() < 2u
+						|| assign.getRHS()->getKind() != expr::Kind::eIdentifier )
+					{
+						return 0u;
+					}
+
+					auto alias = getAlias( **std::prev( loop.end(), 2 ) );
+					return ( alias
+							&& alias->getIdentifier().getVariable()->getId() == static_cast< expr::Identifier const & >( *assign.getRHS() ).getVariable()->getId()
+							&& getStepValue( *alias->getAliasedExpr(), var, step ) )
+						? 2u
+						: 0u;
+				}
+			default:
+				return 0u;
+			}
+		}
+
+		static bool evaluate( LoopControl const & control
+			, int64_t value )
+		{
+			switch ( control.op )
+			{
+			case expr::Kind::eLess:
+				return value < control.bound;
+			case expr::Kind::eLessEqual:
+				return value <= control.bound;
+			case expr::Kind::eGreater:
+				return value > control.bound;
+			case expr::Kind::eGreaterEqual:
+				return value >= control.bound;
+			default:
+				return value != control.bound;
+			}
+		}
+		/**
+		*	Lists the values the loop variable takes in the body.
+		*\return
+		*	\p false if the loop doesn't end within \p maxIterations, or if the variable overflows.
+		*/
+		static bool listIterations( type::Kind kind
+			, int64_t init
+			, LoopControl const & control
+			, int64_t step
+			, uint32_t maxIterations
+			, std::vector< int64_t > & values
+			, int64_t & final )
+		{
+			auto value = init;
+
+			while ( evaluate( control, value ) )
+			{
+				if ( values.size() >= maxIterations )
+				{
+					return false;
+				}
+
+				values.push_back( value );
+				value += step;
+
+				if ( !isInRange( kind, value ) )
+				{
+					return false;
+				}
+			}
+
+			final = value;
+			return true;
+		}
+
+		class ExprUsageLister
+			: public expr::SimpleVisitor
+		{
+		public:
+			static void submit( expr::Expr const & expr
+				, BodyUsage & result )
+			{
+				ExprUsageLister vis{ result };
+				expr.accept( &vis );
+			}
+
+		private:
+			explicit ExprUsageLister( BodyUsage & result )
+				: m_result{ result }
+			{
+			}
+
+			void addWritten( expr::Expr const & expr )
+			{
+				if ( auto var = getAccessChainRoot( expr ) )
+				{
+					m_result.written.insert( var->getId() );
+				}
+			}
+
+			void addLocal( expr::Identifier const & identifier )
+			{
+				m_result.locals.push_back( identifier.getVariable() );
+			}
+
+			void visitArgs( expr::ExprList const & args )
+			{
+				for ( auto & arg : args )
+				{
+					addWritten( *arg );
+					arg->accept( this );
+				}
+			}
+
+		private:
+			void visitUnaryExpr( expr::Unary const * expr )override
+			{
+				switch ( expr->getKind() )
+				{
+				case expr::Kind::ePreIncrement:
+				case expr::Kind::ePreDecrement:
+				case expr::Kind::ePostIncrement:
+				case expr::Kind::ePostDecrement:
+					addWritten( *expr->getOperand() );
+					break;
+				default:
+					break;
+				}
+
+				expr->getOperand()->accept( this );
+			}
+
+			void visitBinaryExpr( expr::Binary const * expr )override
+			{
+				if ( expr->getKind() >= expr::Kind::eAssign
+					&& expr->getKind() <= expr::Kind::eXorAssign )
+				{
+					addWritten( *expr->getLHS() );
+				}
+				else if ( expr->getKind() == expr::Kind::eAlias )
+				{
+					addLocal( static_cast< expr::Alias const & >( *expr ).getIdentifier() );
+				}
+
+				expr->getLHS()->accept( this );
+				expr->getRHS()->accept( this );
+			}
+
+			void visitAggrInitExpr( expr::AggrInit const * expr )override
+			{
+				if ( expr->hasIdentifier() )
+				{
+					addLocal( expr->getIdentifier() );
+				}
+
+				for ( auto & init : expr->getInitialisers() )
+				{
+					init->accept( this );
+				}
+			}
+
+			void visitCompositeConstructExpr( expr::CompositeConstruct const * expr )override
+			{
+				for ( auto & arg : expr->getArgList() )
+				{
+					arg->accept( this );
+				}
+			}
+
+			void visitMbrSelectExpr( expr::MbrSelect const * expr )override
+			{
+				expr->getOuterExpr()->accept( this );
+			}
+
+			void visitFnCallExpr( expr::FnCall const * expr )override
+			{
+				if ( expr->isMember() )
+				{
+					addWritten( *expr->getInstance() );
+					expr->getInstance()->accept( this );
+				}
+
+				visitArgs( expr->getArgList() );
+			}
+
+			void visitIntrinsicCallExpr( expr::IntrinsicCall const * expr )override
+			{
+				visitArgs( expr->getArgList() );
+			}
+
+			void visitCombinedImageAccessCallExpr( expr::CombinedImageAccessCall const * expr )override
+			{
+				visitArgs( expr->getArgList() );
+			}
+
+			void visitImageAccessCallExpr( expr::StorageImageAccessCall const * expr )override
+			{
+				visitArgs( expr->getArgList() );
+			}
+
+			void visitIdentifierExpr( expr::Identifier const * expr )override
+			{
+			}
+
+			void visitInitExpr( expr::Init const * expr )override
+			{
+				if ( expr->hasIdentifier() )
+				{
+					addLocal( expr->getIdentifier() );
+				}
+
+				if ( auto init = expr->getInitialiser() )
+				{
+					init->accept( this );
+				}
+			}
+
+			void visitLiteralExpr( expr::Literal const * expr )override
+			{
+			}
+
+			void visitQuestionExpr( expr::Question const * expr )override
+			{
+				expr->getCtrlExpr()->accept( this );
+				expr->getTrueExpr()->accept( this );
+				expr->getFalseExpr()->accept( this );
+			}
+
+			void visitStreamAppendExpr( expr::StreamAppend const * expr )override
+			{
+				expr->getOperand()->accept( this );
+			}
+
+			void visitSwitchCaseExpr( expr::SwitchCase const * expr )override
+			{
+			}
+
+			void visitSwitchTestExpr( expr::SwitchTest const * expr )override
+			{
+				expr->getValue()->accept( this );
+			}
+
+			void visitSwizzleExpr( expr::Swizzle const * expr )override
+			{
+				expr->getOuterExpr()->accept( this );
+			}
+
+		private:
+			BodyUsage & m_result;
+		};
+
+		class StmtUsageLister
+			: public stmt::SimpleVisitor
+		{
+		public:
+			static BodyUsage submit( stmt::Container const & body )
+			{
+				BodyUsage result;
+				StmtUsageLister vis{ result };
+				vis.visitContainerStmt( &body );
+				return result;
+			}
+
+		private:
+			explicit StmtUsageLister( BodyUsage & result )
+				: m_result{ result }
+			{
+			}
+
+			void visitExpr( expr::Expr const * expr )
+			{
+				if ( expr )
+				{
+					ExprUsageLister::submit( *expr, m_result );
+				}
+			}
+
+			void visitNestedLoop( stmt::Container const & stmt )
+			{
+				++m_loops;
+				stmt::SimpleVisitor::visitContainerStmt( &stmt );
+				--m_loops;
+			}
+
+		private:
+			void visitContainerStmt( stmt::Container const * cont )override
+			{
+				for ( auto & stmt : *cont )
+				{
+					if ( stmt->getKind() != stmt::Kind::eComment )
+					{
+						++m_result.statements;
+					}
+
+					stmt->accept( this );
+				}
+			}
+
+			void visitBreakStmt( stmt::Break const * stmt )override
+			{
+				m_result.escapes = m_result.escapes
+					|| ( m_loops == 0u && m_switches == 0u );
+			}
+
+			void visitContinueStmt( stmt::Continue const * stmt )override
+			{
+				m_result.escapes = m_result.escapes
+					|| m_loops == 0u;
+			}
+
+			void visitDoWhileStmt( stmt::DoWhile const * stmt )override
+			{
+				visitNestedLoop( *stmt );
+				visitExpr( stmt->getCtrlExpr() );
+			}
+
+			void visitElseIfStmt( stmt::ElseIf const * stmt )override
+			{
+				visitExpr( stmt->getCtrlExpr() );
+				stmt::SimpleVisitor::visitElseIfStmt( stmt );
+			}
+
+			void visitForStmt( stmt::For const * stmt )override
+			{
+				visitExpr( stmt->getInitExpr() );
+				visitExpr( stmt->getCtrlExpr() );
+				visitExpr( stmt->getIncrExpr() );
+				visitNestedLoop( *stmt );
+			}
+
+			void visitIfStmt( stmt::If const * stmt )override
+			{
+				visitExpr( stmt->getCtrlExpr() );
+				stmt::SimpleVisitor::visitIfStmt( stmt );
+			}
+
+			void visitReturnStmt( stmt::Return const * stmt )override
+			{
+				visitExpr( stmt->getExpr() );
+			}
+
+			void visitSimpleStmt( stmt::Simple const * stmt )override
+			{
+				visitExpr( stmt->getExpr() );
+			}
+
+			void visitSwitchStmt( stmt::Switch const * stmt )override
+			{
+				visitExpr( stmt->getTestExpr() );
+				++m_switches;
+				stmt::SimpleVisitor::visitSwitchStmt( stmt );
+				--m_switches;
+			}
+
+			void visitVariableDeclStmt( stmt::VariableDecl const * stmt )override
+			{
+				m_result.locals.push_back( stmt->getVariable() );
+			}
+
+			void visitWhileStmt( stmt::While const * stmt )override
+			{
+				visitExpr( stmt->getCtrlExpr() );
+				visitNestedLoop( *stmt );
+			}
+
+		private:
+			BodyUsage & m_result;
+			uint32_t m_loops{};
+			uint32_t m_switches{};
+		};
+
+		class ExprRemapper
+			: public ExprCloner
+		{
+		public:
+			static expr::ExprPtr submit( expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, Bindings const & bindings
+				, expr::Expr const & expr )
+			{
+				expr::ExprPtr result{};
+				ExprRemapper vis{ exprCache, typesCache, bindings, result };
+				expr.accept( &vis );
+
+				if ( expr.isNonUniform() )
+				{
+					result->updateFlag( expr::Flag::eNonUniform );
+				}
+
+				return result;
+			}
+
+		private:
+			ExprRemapper( expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, Bindings const & bindings
+				, expr::ExprPtr & result )
+				: ExprCloner{ exprCache, result }
+				, m_typesCache{ typesCache }
+				, m_bindings{ bindings }
+			{
+			}
+
+			expr::IdentifierPtr remap( expr::Identifier const & expr )
+			{
+				if ( auto it = m_bindings.vars.find( expr.getVariable()->getId() );
+					it != m_bindings.vars.end() )
+				{
+					return m_exprCache.makeIdentifier( m_typesCache, it->second );
+				}
+
+				return m_exprCache.makeIdentifier( expr );
+			}
+
+			expr::ExprPtr doSubmit( expr::Expr const & expr )override
+			{
+				return submit( m_exprCache, m_typesCache, m_bindings, expr );
+			}
+
+			void visitAggrInitExpr( expr::AggrInit const * expr )override
+			{
+				if ( !expr->hasIdentifier() )
+				{
+					ExprCloner::visitAggrInitExpr( expr );
+					return;
+				}
+
+				expr::ExprList initialisers;
+
+				for ( auto & init : expr->getInitialisers() )
+				{
+					initialisers.emplace_back( doSubmit( *init ) );
+				}
+
+				m_result = m_exprCache.makeAggrInit( remap( expr->getIdentifier() )
+					, std::move( initialisers ) );
+			}
+
+			void visitAliasExpr( expr::Alias const * expr )override
+			{
+				m_result = m_exprCache.makeAlias( expr->getType()
+					, remap( expr->getIdentifier() )
+					, doSubmit( *expr->getAliasedExpr() ) );
+			}
+
+			void visitIdentifierExpr( expr::Identifier const * expr )override
+			{
+				if ( auto it = m_bindings.exprs.find( expr->getVariable()->getId() );
+					it != m_bindings.exprs.end() )
+				{
+					m_result = ExprCloner::submit( m_exprCache, *it->second );
+				}
+				else
+				{
+					m_result = remap( *expr );
+				}
+			}
+
+			void visitInitExpr( expr::Init const * expr )override
+			{
+				if ( !expr->hasIdentifier() )
+				{
+					ExprCloner::visitInitExpr( expr );
+					return;
+				}
+
+				m_result = m_exprCache.makeInit( remap( expr->getIdentifier() )
+					, doSubmit( *expr->getInitialiser() ) );
+			}
+
+		private:
+			type::TypesCache & m_typesCache;
+			Bindings const & m_bindings;
+		};
+
+		class BodyCloner
+			: public StmtCloner
+		{
+		public:
+			static void submit( stmt::StmtCache & stmtCache
+				, expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, Bindings const & bindings
+				, stmt::Container const & body
+				, stmt::Container & target )
+			{
+				auto result = stmtCache.makeContainer();
+				BodyCloner vis{ stmtCache, exprCache, typesCache, bindings, result };
+				vis.m_current = &target;
+				vis.visitContainerStmt( &body );
+			}
+
+		private:
+			BodyCloner( stmt::StmtCache & stmtCache
+				, expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, Bindings const & bindings
+				, stmt::ContainerPtr & result )
+				: StmtCloner{ stmtCache, exprCache, result }
+				, m_typesCache{ typesCache }
+				, m_bindings{ bindings }
+			{
+			}
+
+			expr::ExprPtr doSubmit( expr::Expr const & expr )override
+			{
+				return ExprRemapper::submit( m_exprCache, m_typesCache, m_bindings, expr );
+			}
+
+			void visitVariableDeclStmt( stmt::VariableDecl const * stmt )override
+			{
+				auto var = stmt->getVariable();
+
+				if ( auto it = m_bindings.vars.find( var->getId() );
+					it != m_bindings.vars.end() )
+				{
+					var = it->second;
+				}
+
+				m_current->addStmt( m_stmtCache.makeVariableDecl( var ) );
+			}
+
+		private:
+			type::TypesCache & m_typesCache;
+			Bindings const & m_bindings;
+		};
+
+		class StmtUnroller
+			: public StmtCloner
+		{
+		public:
+			static stmt::ContainerPtr submit( stmt::StmtCache & stmtCache
+				, expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, stmt::Container const & container
+				, SSAData & ssaData
+				, uint32_t budget
+				, UnrollStats & stats )
+			{
+				auto result = stmtCache.makeContainer();
+				StmtUnroller vis{ stmtCache, exprCache, typesCache, ssaData, budget, stats, result };
+				container.accept( &vis );
+				return result;
+			}
+
+		private:
+			StmtUnroller( stmt::StmtCache & stmtCache
+				, expr::ExprCache & exprCache
+				, type::TypesCache & typesCache
+				, SSAData & ssaData
+				, uint32_t budget
+				, UnrollStats & stats
+				, stmt::ContainerPtr & result )
+				: StmtCloner{ stmtCache, exprCache, result }
+				, m_typesCache{ typesCache }
+				, m_ssaData{ ssaData }
+				, m_budget{ budget }
+				, m_stats{ stats }
+			{
+			}
+
+			var::VariablePtr makeVar( var::Variable const & source )
+			{
+				++m_ssaData.nextVarId;
+				++m_ssaData.aliasId;
+				auto name = ( source.isTempVar()
+					? std::string{ "tmp" }
+					: source.getName() );
+				return var::makeVariable( m_ssaData.nextVarId
+					, source.getType()
+					, name + "_" + std::to_string( m_ssaData.aliasId )
+					, source.getFlags() );
+			}
+
+			expr::ExprPtr makeValue( type::Kind kind
+				, int64_t value )
+			{
+				if ( kind == type::Kind::eInt32 )
+				{
+					return m_exprCache.makeLiteral( m_typesCache, int32_t( value ) );
+				}
+
+				return m_exprCache.makeLiteral( m_typesCache, uint32_t( value ) );
+			}
+			/**
+			*\return
+			*	The loop variable, if \p stmt initialises or assigns a local integer variable with a literal.
+			*/
+			static var::VariablePtr getLoopVar( stmt::Stmt const * stmt
+				, int64_t & init )
+			{
+				if ( !stmt
+					|| stmt->getKind() != stmt::Kind::eSimple )
+				{
+					return nullptr;
+				}
+
+				auto & expr = *static_cast< stmt::Simple const & >( *stmt ).getExpr();
+				var::VariablePtr result{};
+				expr::Expr const * value{};
+
+				if ( expr.getKind() == expr::Kind::eInit
+					&& static_cast< expr::Init const & >( expr ).hasIdentifier() )
+				{
+					auto & initExpr = static_cast< expr::Init const & >( expr );
+					result = initExpr.getIdentifier().getVariable();
+					value = initExpr.getInitialiser();
+				}
+				else if ( expr.getKind() == expr::Kind::eAssign
+					&& static_cast< expr::Assign const & >( expr ).getLHS()->getKind() == expr::Kind::eIdentifier )
+				{
+					auto & assign = static_cast< expr::Assign const & >( expr );
+					result = static_cast< expr::Identifier const & >( *assign.getLHS() ).getVariable();
+					value = assign.getRHS();
+				}
+
+				if ( !result
+					|| !value
+					|| result->isMemberVar()
+					|| result->isShared()
+					|| result->isStatic()
+					|| !( result->isLocale() || result->isLoopVar() )
+					|| !getLiteralValue( *value, result->getType()->getKind(), init ) )
+				{
+					return nullptr;
+				}
+
+				return result;
+			}
+
+			stmt::DoWhilePtr makeLoop( stmt::DoWhile const & loop
+				, stmt::Container const & body
+				, size_t stepSize )
+			{
+				auto doWhile = m_stmtCache.makeDoWhile( doSubmit( loop.getCtrlExpr() ) );
+				doWhile->setHint( loop.getHint() );
+				BodyCloner::submit( m_stmtCache, m_exprCache, m_typesCache, {}, body, *doWhile );
+
+				for ( auto it = std::prev( loop.end(), ptrdiff_t( stepSize ) ); it != loop.end(); ++it )
+				{
+					doWhile->addStmt( m_stmtCache.makeSimple( doSubmit( static_cast< stmt::Simple const & >( **it ).getExpr() ) ) );
+				}
+
+				return doWhile;
+			}
+
+			void addLoop( stmt::If const & stmt
+				, stmt::DoWhile const & loop
+				, stmt::Container const & body
+				, size_t stepSize )
+			{
+				auto ifStmt = m_stmtCache.makeIf( doSubmit( stmt.getCtrlExpr() ) );
+				ifStmt->addStmt( makeLoop( loop, body, stepSize ) );
+				m_current->addStmt( std::move( ifStmt ) );
+			}
+			/**
+			*	Processes the loop body, without its step.
+			*/
+			stmt::ContainerPtr processBody( stmt::DoWhile const & loop
+				, size_t stepSize )
+			{
+				// The body is processed first, so that its nested loops are unrolled.
+				auto body = m_stmtCache.makeContainer();
+				auto save = m_current;
+				m_current = body.get();
+				visitStatements( loop.begin(), std::prev( loop.end(), ptrdiff_t( stepSize ) ) );
+				m_current = save;
+				return body;
+			}
+			/**
+			*	Adds the copies of the processed \p body of \p loop, for each value of the loop variable.
+			*\return
+			*	\p false if the loop doesn't fit the budget, or if its body writes the loop variable or escapes the loop.
+			*/
+			bool unroll( stmt::DoWhile const & loop
+				, stmt::Container const & body
+				, var::VariablePtr var
+				, int64_t init
+				, LoopControl const & control
+				, int64_t step )
+			{
+				auto usage = StmtUsageLister::submit( body );
+				auto maxCost = ( loop.getHint() == stmt::LoopHint::eUnroll )
+					? MaxUnrollCost
+					: m_budget;
+				auto kind = var->getType()->getKind();
+				std::vector< int64_t > values;
+				int64_t final{};
+
+				if ( usage.escapes
+					|| usage.written.contains( var->getId() )
+					|| !listIterations( kind
+						, init
+						, control
+						, step
+						, maxCost / std::max( 1u, usage.statements )
+						, values
+						, final ) )
+				{
+					return false;
+				}
+
+				for ( auto value : values )
+				{
+					auto literal = makeValue( kind, value );
+					Bindings bindings;
+					bindings.exprs.emplace( var->getId(), literal.get() );
+
+					for ( auto & local : usage.locals )
+					{
+						if ( !bindings.vars.contains( local->getId() ) )
+						{
+							bindings.vars.emplace( local->getId(), makeVar( *local ) );
+						}
+					}
+
+					BodyCloner::submit( m_stmtCache, m_exprCache, m_typesCache, bindings, body, *m_current );
+				}
+
+				if ( !values.empty() )
+				{
+					// The variable can be read after the loop.
+					m_current->addStmt( m_stmtCache.makeSimple( m_exprCache.makeAssign( var->getType()
+						, m_exprCache.makeIdentifier( m_typesCache, var )
+						, makeValue( kind, final ) ) ) );
+				}
+
+				++m_stats.loops;
+				m_stats.iterations += uint32_t( values.size() );
+				return true;
+			}
+			/**
+			*	Unrolls the loops shaped like SSA transformation creates them :
+			*	var = init; if ( var OP bound ) { do { body; step; } while ( var OP bound ); }
+			*\return
+			*	\p false if \p stmt doesn't hold such a loop.
+			*/
+			bool tryUnroll( stmt::If const & stmt
+				, stmt::Stmt const * previous )
+			{
+				if ( !stmt.getElseIfList().empty()
+					|| stmt.getElse()
+					|| stmt.size() != 1u
+					|| ( *stmt.begin() )->getKind() != stmt::Kind::eDoWhile )
+				{
+					return false;
+				}
+
+				auto & loop = static_cast< stmt::DoWhile const & >( **stmt.begin() );
+				int64_t init{};
+				auto var = getLoopVar( previous, init );
+
+				if ( !var
+					|| loop.getHint() == stmt::LoopHint::eDontUnroll )
+				{
+					return false;
+				}
+
+				LoopControl ifControl{};
+				LoopControl loopControl{};
+				int64_t step{};
+				auto stepSize = getStep( loop, *var, step );
+
+				if ( !stepSize
+					|| !getControl( *stmt.getCtrlExpr(), *var, ifControl )
+					|| !getControl( *loop.getCtrlExpr(), *var, loopControl )
+					|| ifControl.op != loopControl.op
+					|| ifControl.bound != loopControl.bound )
+				{
+					return false;
+				}
+
+				auto body = processBody( loop, stepSize );
+
+				if ( !unroll( loop, *body, var, init, loopControl, step ) )
+				{
+					addLoop( stmt, loop, *body, stepSize );
+				}
+
+				return true;
+			}
+			/**
+			*	Unrolls the do while loops preceded by the initialisation of their variable :
+			*	var = init; do { body; step; } while ( var OP bound );
+			*	Only when the first iteration passes the condition, the loop then runs like a while loop.
+			*\return
+			*	\p false if \p stmt isn't such a loop.
+			*/
+			bool tryUnroll( stmt::DoWhile const & loop
+				, stmt::Stmt const * previous )
+			{
+				int64_t init{};
+				auto var = getLoopVar( previous, init );
+
+				if ( !var
+					|| loop.getHint() == stmt::LoopHint::eDontUnroll )
+				{
+					return false;
+				}
+
+				LoopControl control{};
+				int64_t step{};
+				auto stepSize = getStep( loop, *var, step );
+
+				if ( !stepSize
+					|| !getControl( *loop.getCtrlExpr(), *var, control )
+					|| !evaluate( control, init ) )
+				{
+					return false;
+				}
+
+				auto body = processBody( loop, stepSize );
+
+				if ( !unroll( loop, *body, var, init, control, step ) )
+				{
+					m_current->addStmt( makeLoop( loop, *body, stepSize ) );
+				}
+
+				return true;
+			}
+
+			void visitStatements( stmt::StmtList::const_iterator begin
+				, stmt::StmtList::const_iterator end )
+			{
+				auto save = m_previous;
+				m_previous = nullptr;
+
+				for ( auto it = begin; it != end; ++it )
+				{
+					( *it )->accept( this );
+					m_previous = it->get();
+				}
+
+				m_previous = save;
+			}
+
+		private:
+			void visitContainerStmt( stmt::Container const * cont )override
+			{
+				visitStatements( cont->begin(), cont->end() );
+			}
+
+			void visitIfStmt( stmt::If const * stmt )override
+			{
+				if ( !tryUnroll( *stmt, m_previous ) )
+				{
+					StmtCloner::visitIfStmt( stmt );
+				}
+			}
+
+			void visitDoWhileStmt( stmt::DoWhile const * stmt )override
+			{
+				if ( !tryUnroll( *stmt, m_previous ) )
+				{
+					StmtCloner::visitDoWhileStmt( stmt );
+				}
+			}
+
+		private:
+			type::TypesCache & m_typesCache;
+			SSAData & m_ssaData;
+			uint32_t m_budget;
+			UnrollStats & m_stats;
+			// The statement preceding the visited one, in the current container.
+			stmt::Stmt const * m_previous{};
+		};
+	}
+
+	//*************************************************************************
+
+	stmt::ContainerPtr unrollLoops( stmt::StmtCache & stmtCache
+		, expr::ExprCache & exprCache
+		, type::TypesCache & typesCache
+		, stmt::Container const & container
+		, SSAData & ssaData
+		, uint32_t budget
+		, UnrollStats & stats )
+	{
+		return unroll::StmtUnroller::submit( stmtCache
+			, exprCache
+			, typesCache
+			, container
+			, ssaData
+			, budget
+			, stats );
+	}
+
+	//*************************************************************************
+}
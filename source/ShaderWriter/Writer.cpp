@@ -184,14 +184,37 @@ namespace sdw
 		return m_builder->loadExpr( makeExpr( *this, value ) );
 	}
 
+	void ShaderWriter::relaxPrecision( Value const & value )
+	{
+		if ( auto ident = ast::findIdentifier( *value.getExpr() ) )
+		{
+			ident->getVariable()->updateFlag( var::Flag::eRelaxedPrecision );
+		}
+	}
+
 	void ShaderWriter::forStmt( expr::ExprPtr init
 		, expr::ExprPtr cond
 		, expr::ExprPtr incr
 		, std::function< void() > const & function )
 	{
-		m_builder->pushScope( getStmtCache().makeFor( makeExpr( *this, *init )
+		forStmt( std::move( init )
+			, std::move( cond )
+			, std::move( incr )
+			, ast::stmt::LoopHint::eNone
+			, function );
+	}
+
+	void ShaderWriter::forStmt( expr::ExprPtr init
+		, expr::ExprPtr cond
+		, expr::ExprPtr incr
+		, ast::stmt::LoopHint hint
+		, std::function< void() > const & function )
+	{
+		auto stmt = getStmtCache().makeFor( makeExpr( *this, *init )
 			, makeExpr( *this, *cond )
-			, makeExpr( *this, *incr ) ) );
+			, makeExpr( *this, *incr ) );
+		stmt->setHint( hint );
+		m_builder->pushScope( std::move( stmt ) );
 		function();
 		m_builder->popScope();
 	}
@@ -199,7 +222,16 @@ namespace sdw
 	void ShaderWriter::doWhileStmt( expr::ExprPtr condition
 		, std::function< void() > const & function )
 	{
-		m_builder->pushScope( getStmtCache().makeDoWhile( std::move( condition ) ) );
+		doWhileStmt( std::move( condition ), ast::stmt::LoopHint::eNone, function );
+	}
+
+	void ShaderWriter::doWhileStmt( expr::ExprPtr condition
+		, ast::stmt::LoopHint hint
+		, std::function< void() > const & function )
+	{
+		auto stmt = getStmtCache().makeDoWhile( std::move( condition ) );
+		stmt->setHint( hint );
+		m_builder->pushScope( std::move( stmt ) );
 		function();
 		m_builder->popScope();
 	}
@@ -210,10 +242,26 @@ namespace sdw
 		return doWhileStmt( makeCondition( condition ), function );
 	}
 
+	void ShaderWriter::doWhileStmt( sdw::Boolean const condition
+		, ast::stmt::LoopHint hint
+		, std::function< void() > const & function )
+	{
+		return doWhileStmt( makeCondition( condition ), hint, function );
+	}
+
+	void ShaderWriter::whileStmt( expr::ExprPtr condition
+		, std::function< void() > const & function )
+	{
+		whileStmt( std::move( condition ), ast::stmt::LoopHint::eNone, function );
+	}
+
 	void ShaderWriter::whileStmt( expr::ExprPtr condition
+		, ast::stmt::LoopHint hint
 		, std::function< void() > const & function )
 	{
-		m_builder->pushScope( getStmtCache().makeWhile( std::move( condition ) ) );
+		auto stmt = getStmtCache().makeWhile( std::move( condition ) );
+		stmt->setHint( hint );
+		m_builder->pushScope( std::move( stmt ) );
 		function();
 		m_builder->popScope();
 	}
@@ -224,10 +272,24 @@ namespace sdw
 		return whileStmt( makeCondition( condition ), function );
 	}
 
+	void ShaderWriter::whileStmt( sdw::Boolean const condition
+		, ast::stmt::LoopHint hint
+		, std::function< void() > const & function )
+	{
+		return whileStmt( makeCondition( condition ), hint, function );
+	}
+
 	ShaderWriter & ShaderWriter::ifStmt( expr::ExprPtr condition
 		, std::function< void() > const & function )
 	{
-		m_builder->beginIf( std::move( condition ) );
+		return ifStmt( std::move( condition ), ast::stmt::SelectionHint::eNone, function );
+	}
+
+	ShaderWriter & ShaderWriter::ifStmt( expr::ExprPtr condition
+		, ast::stmt::SelectionHint hint
+		, std::function< void() > const & function )
+	{
+		m_builder->beginIf( std::move( condition ), hint );
 		function();
 		m_builder->popScope();
 		return *this;
@@ -239,6 +301,13 @@ namespace sdw
 		return ifStmt( makeCondition( condition ), function );
 	}
 
+	ShaderWriter & ShaderWriter::ifStmt( sdw::Boolean const condition
+		, ast::stmt::SelectionHint hint
+		, std::function< void() > const & function )
+	{
+		return ifStmt( makeCondition( condition ), hint, function );
+	}
+
 	ShaderWriter & ShaderWriter::elseIfStmt( expr::ExprPtr condition
 		, std::function< void() > const & function )
 	{
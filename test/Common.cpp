@@ -519,6 +519,47 @@ namespace test
 
 	//*********************************************************************************************
 
+	ASTContext::ASTContext( TestCounts & testCounts )
+		: counts{ testCounts }
+		, stmtCache{ *testCounts.allocatorBlock }
+		, exprCache{ *testCounts.allocatorBlock }
+	{
+	}
+
+	ast::var::VariablePtr ASTContext::makeVariable( std::string name
+		, ast::type::TypePtr type
+		, uint64_t flags )
+	{
+		return ast::var::makeVariable( ++counts.nextVarId
+			, std::move( type )
+			, std::move( name )
+			, flags );
+	}
+
+	ast::expr::IdentifierPtr ASTContext::makeIdent( ast::var::VariablePtr var )
+	{
+		return exprCache.makeIdentifier( typesCache, std::move( var ) );
+	}
+
+	ast::stmt::SimplePtr ASTContext::makeInit( ast::var::VariablePtr var
+		, ast::expr::ExprPtr value )
+	{
+		return stmtCache.makeSimple( exprCache.makeInit( makeIdent( std::move( var ) ), std::move( value ) ) );
+	}
+
+	ast::stmt::SimplePtr ASTContext::makeAssign( ast::var::VariablePtr var
+		, ast::expr::ExprPtr value )
+	{
+		auto type = var->getType();
+		return stmtCache.makeSimple( exprCache.makeAssign( type, makeIdent( std::move( var ) ), std::move( value ) ) );
+	}
+
+	ast::stmt::FunctionDeclPtr ASTContext::makeMain( ast::stmt::FunctionFlag flag )
+	{
+		return stmtCache.makeFunctionDecl( ast::var::makeFunction( ++counts.nextVarId, typesCache.getFunction( typesCache.getVoid(), {} ), "main" )
+			, flag );
+	}
+
 	void beginTest( TestCounts & testCounts
 		, std::string name )
 	{
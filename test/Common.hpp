@@ -6,6 +6,8 @@
 #include <ShaderAST/Stmt/StmtVisitor.hpp>
 #include <ShaderAST/Type/ImageConfiguration.hpp>
 #include <ShaderAST/Type/TypeArray.hpp>
+#include <ShaderAST/Type/TypeCache.hpp>
+#include <ShaderAST/Var/Variable.hpp>
 
 #pragma warning( push )
 #pragma warning( disable: 4365 )
@@ -148,6 +150,38 @@ namespace test
 
 	using TestCountsPtr = std::unique_ptr< TestCounts >;
 
+	/**
+	*	The caches and the statements builders shared by the AST visitors tests.
+	*/
+	struct ASTContext
+	{
+		explicit ASTContext( TestCounts & testCounts );
+
+		ast::var::VariablePtr makeVariable( std::string name
+			, ast::type::TypePtr type
+			, uint64_t flags = uint64_t( ast::var::Flag::eLocale ) );
+		ast::expr::IdentifierPtr makeIdent( ast::var::VariablePtr var );
+		// var = value
+		ast::stmt::SimplePtr makeInit( ast::var::VariablePtr var
+			, ast::expr::ExprPtr value );
+		// var = value, var being already declared
+		ast::stmt::SimplePtr makeAssign( ast::var::VariablePtr var
+			, ast::expr::ExprPtr value );
+		// void main()
+		ast::stmt::FunctionDeclPtr makeMain( ast::stmt::FunctionFlag flag = ast::stmt::FunctionFlag::eComputeEntryPoint );
+
+		template< typename ValueT >
+		ast::expr::LiteralPtr makeLiteral( ValueT value )
+		{
+			return exprCache.makeLiteral( typesCache, value );
+		}
+
+		TestCounts & counts;
+		ast::stmt::StmtCache stmtCache;
+		ast::expr::ExprCache exprCache;
+		ast::type::TypesCache typesCache;
+	};
+
 	struct TestSuite
 	{
 		using TestCountsType = test::TestCounts;
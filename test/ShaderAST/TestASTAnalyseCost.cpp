@@ -0,0 +1,177 @@
+#include "Common.hpp"
+
+#include <ShaderAST/Expr/MakeIntrinsic.hpp>
+#include <ShaderAST/Visitors/AnalyseCost.hpp>
+
+#pragma clang diagnostic ignored "-Wunused-member-function"
+#pragma warning( disable:5245 )
+
+namespace
+{
+	struct Context
+		: test::ASTContext
+	{
+		explicit Context( test::TestCounts & testCounts )
+			: test::ASTContext{ testCounts }
+			, input{ makeVariable( "input", typesCache.getVec4F(), uint64_t( ast::var::Flag::eUniform ) ) }
+		{
+		}
+
+		ast::stmt::SimplePtr makeAddAssign( ast::var::VariablePtr var
+			, ast::expr::ExprPtr value )
+		{
+			return stmtCache.makeSimple( exprCache.makeAddAssign( var->getType(), makeIdent( var ), std::move( value ) ) );
+		}
+
+		// for ( int i = 0; i < count; ++i )
+		ast::stmt::ForPtr makeFor( ast::expr::ExprPtr count )
+		{
+			auto i = makeVariable( "i", typesCache.getInt32(), uint64_t( ast::var::Flag::eLoopVar ) );
+			return stmtCache.makeFor( exprCache.makeInit( makeIdent( i ), makeLiteral( 0 ) )
+				, exprCache.makeLess( typesCache, makeIdent( i ), std::move( count ) )
+				, exprCache.makePreIncrement( makeIdent( i ) ) );
+		}
+
+		ast::ShaderCost submit( ast::stmt::FunctionDeclPtr main )
+		{
+			auto container = stmtCache.makeContainer();
+			container->addStmt( std::move( main ) );
+			return ast::analyseCost( *container );
+		}
+
+		ast::var::VariablePtr input;
+	};
+
+	void testOperations( test::TestCounts & testCounts )
+	{
+		testBegin( "testOperations" );
+		Context context{ testCounts };
+		// vec4 a = input * input; float b = sqrt( a.x ); int c = 1 + 2; if ( b > 0.0 ) { a += input; }
+		auto a = context.makeVariable( "a", context.typesCache.getVec4F() );
+		auto b = context.makeVariable( "b", context.typesCache.getFloat() );
+		auto c = context.makeVariable( "c", context.typesCache.getInt32() );
+		auto main = context.makeMain();
+		main->addStmt( context.makeInit( a, context.exprCache.makeTimes( context.typesCache.getVec4F(), context.makeIdent( context.input ), context.makeIdent( context.input ) ) ) );
+		main->addStmt( context.makeInit( b, ast::expr::makeSqrt1F( context.exprCache, context.typesCache
+			, context.exprCache.makeSwizzle( context.makeIdent( a ), ast::expr::SwizzleKind::fromOffset( 0u ) ) ) ) );
+		main->addStmt( context.makeInit( c, context.exprCache.makeAdd( context.typesCache.getInt32()
+			, context.exprCache.makeLiteral( context.typesCache, 1 )
+			, context.exprCache.makeLiteral( context.typesCache, 2 ) ) ) );
+		auto ifStmt = context.stmtCache.makeIf( context.exprCache.makeGreater( context.typesCache, context.makeIdent( b ), context.exprCache.makeLiteral( context.typesCache, 0.0f ) ) );
+		ifStmt->addStmt( context.makeAddAssign( a, context.makeIdent( context.input ) ) );
+		main->addStmt( std::move( ifStmt ) );
+		auto result = context.submit( std::move( main ) );
+		// 4 for the product, 1 for the comparison, 4 for the addition.
+		check( result.operations.floatOps == 9u );
+		check( result.operations.intOps == 1u );
+		check( result.operations.transcendentals == 1u );
+		check( result.operations.branches == 1u );
+		check( result.functions.size() == 1u );
+		check( result.functions.front().entryPoint );
+		testEnd();
+	}
+
+	void testLoops( test::TestCounts & testCounts )
+	{
+		testBegin( "testLoops" );
+		Context context{ testCounts };
+		// vec4 a = input; for ( int i = 0; i < 8; ++i ) { a += input; } for ( int i = 0; i < count; ++i ) { a += input; }
+		auto a = context.makeVariable( "a", context.typesCache.getVec4F() );
+		auto count = context.makeVariable( "count", context.typesCache.getInt32() );
+		auto main = context.makeMain();
+		main->addStmt( context.makeInit( a, context.makeIdent( context.input ) ) );
+		main->addStmt( context.makeInit( count, context.exprCache.makeCast( context.typesCache.getInt32()
+			, context.exprCache.makeSwizzle( context.makeIdent( context.input ), ast::expr::SwizzleKind::fromOffset( 0u ) ) ) ) );
+		auto known = context.makeFor( context.exprCache.makeLiteral( context.typesCache, 8 ) );
+		known->addStmt( context.makeAddAssign( a, context.makeIdent( context.input ) ) );
+		main->addStmt( std::move( known ) );
+		auto unknown = context.makeFor( context.makeIdent( count ) );
+		unknown->addStmt( context.makeAddAssign( a, context.makeIdent( context.input ) ) );
+		main->addStmt( std::move( unknown ) );
+		auto result = context.submit( std::move( main ) );
+		auto & function = result.functions.front();
+		check( function.loops.size() == 2u );
+		check( function.loops[0].tripCount == 8u );
+		check( function.loops[0].iteration.floatOps == 4u );
+		check( function.loops[1].tripCount == 0u );
+		// The loop with an unknown trip count is counted once.
+		check( result.operations.floatOps == 8u );
+		check( result.executed.floatOps == 4u * 8u + 4u );
+		testEnd();
+	}
+
+	void testResources( test::TestCounts & testCounts )
+	{
+		testBegin( "testResources" );
+		Context context{ testCounts };
+		// vec4 s = texture( sampler, input.xy ); memoryBarrier(); int o = atomicAdd( counter, 1 );
+		auto sampler = ast::var::makeVariable( ++context.counts.nextVarId
+			, context.typesCache.getCombinedImage( ast::type::ImageConfiguration{}, false )
+			, "sampler"
+			, uint64_t( ast::var::Flag::eUniform ) );
+		auto counter = ast::var::makeVariable( ++context.counts.nextVarId, context.typesCache.getInt32(), "counter", uint64_t( ast::var::Flag::eShared ) );
+		auto s = context.makeVariable( "s", context.typesCache.getVec4F() );
+		auto o = context.makeVariable( "o", context.typesCache.getInt32() );
+		auto main = context.makeMain();
+		main->addStmt( context.makeInit( s, context.exprCache.makeCombinedImageAccessCall( context.typesCache.getVec4F()
+			, ast::expr::CombinedImageAccess::eTexture2DF
+			, context.makeIdent( sampler )
+			, context.exprCache.makeSwizzle( context.makeIdent( context.input ), ast::expr::SwizzleKind{ ast::expr::SwizzleKind::e01 } ) ) ) );
+		main->addStmt( context.stmtCache.makeSimple( ast::expr::makeMemoryBarrier( context.exprCache, context.typesCache
+			, ast::type::Scope::eWorkgroup
+			, ast::type::MemorySemanticsMask::eWorkgroupMemory | ast::type::MemorySemanticsMask::eAcquireRelease ) ) );
+		main->addStmt( context.makeInit( o, ast::expr::makeAtomicAddI( context.exprCache, context.typesCache
+			, context.makeIdent( counter )
+			, context.exprCache.makeLiteral( context.typesCache, 1 ) ) ) );
+		auto result = context.submit( std::move( main ) );
+		check( result.operations.samples == 1u );
+		check( result.operations.gathers == 0u );
+		check( result.operations.barriers == 1u );
+		check( result.operations.atomics == 1u );
+		testEnd();
+	}
+
+	void testLiveValues( test::TestCounts & testCounts )
+	{
+		testBegin( "testLiveValues" );
+		Context context{ testCounts };
+		// vec4 a = input; vec4 b = a * a; float c = b.x; float d = c + c;
+		auto a = context.makeVariable( "a", context.typesCache.getVec4F() );
+		auto b = context.makeVariable( "b", context.typesCache.getVec4F() );
+		auto c = context.makeVariable( "c", context.typesCache.getFloat() );
+		auto d = context.makeVariable( "d", context.typesCache.getFloat() );
+		auto main = context.makeMain();
+		main->addStmt( context.makeInit( a, context.makeIdent( context.input ) ) );
+		main->addStmt( context.makeInit( b, context.exprCache.makeTimes( context.typesCache.getVec4F(), context.makeIdent( a ), context.makeIdent( a ) ) ) );
+		main->addStmt( context.makeInit( c, context.exprCache.makeSwizzle( context.makeIdent( b ), ast::expr::SwizzleKind::fromOffset( 0u ) ) ) );
+		main->addStmt( context.makeInit( d, context.exprCache.makeAdd( context.typesCache.getFloat(), context.makeIdent( c ), context.makeIdent( c ) ) ) );
+		auto result = context.submit( std::move( main ) );
+		// a and b are live together.
+		check( result.peakLiveValues == 8u );
+
+		// vec4 a = input; for ( int i = 0; i < 4; ++i ) { vec4 t = input; t += a; }
+		main = context.makeMain();
+		main->addStmt( context.makeInit( a, context.makeIdent( context.input ) ) );
+		auto loop = context.makeFor( context.exprCache.makeLiteral( context.typesCache, 4 ) );
+		auto t = context.makeVariable( "t", context.typesCache.getVec4F() );
+		loop->addStmt( context.makeInit( t, context.makeIdent( context.input ) ) );
+		loop->addStmt( context.makeAddAssign( t, context.makeIdent( a ) ) );
+		main->addStmt( std::move( loop ) );
+		result = context.submit( std::move( main ) );
+		// a, i and t are live together.
+		check( result.peakLiveValues == 9u );
+		testEnd();
+	}
+}
+
+testSuiteMain( TestASTAnalyseCost )
+{
+	testSuiteBegin();
+	testOperations( testCounts );
+	testLoops( testCounts );
+	testResources( testCounts );
+	testLiveValues( testCounts );
+	testSuiteEnd();
+}
+
+testSuiteLaunch( TestASTAnalyseCost )
@@ -0,0 +1,181 @@
+#include "Common.hpp"
+
+#include <ShaderAST/Visitors/AnalyseRegisterPressure.hpp>
+
+#pragma clang diagnostic ignored "-Wunused-member-function"
+#pragma warning( disable:5245 )
+
+namespace
+{
+	struct Context
+		: test::ASTContext
+	{
+		explicit Context( test::TestCounts & testCounts )
+			: test::ASTContext{ testCounts }
+			, input{ makeVariable( "input", typesCache.getVec4F(), uint64_t( ast::var::Flag::eUniform ) ) }
+		{
+		}
+
+		ast::expr::ExprPtr makeX( ast::var::VariablePtr var )
+		{
+			return exprCache.makeSwizzle( makeIdent( var ), ast::expr::SwizzleKind::fromOffset( 0u ) );
+		}
+
+		ast::expr::ExprPtr makeAdd( ast::expr::ExprPtr lhs
+			, ast::expr::ExprPtr rhs )
+		{
+			auto type = lhs->getType();
+			return exprCache.makeAdd( type, std::move( lhs ), std::move( rhs ) );
+		}
+
+		ast::stmt::FunctionDeclPtr makeMain()
+		{
+			return test::ASTContext::makeMain( ast::stmt::FunctionFlag::eFragmentEntryPoint );
+		}
+
+		ast::RegisterPressure submit( ast::stmt::FunctionDeclPtr main )
+		{
+			container = stmtCache.makeContainer();
+			container->addStmt( std::move( main ) );
+			return ast::analyseRegisterPressure( *container );
+		}
+
+		ast::var::VariablePtr input;
+		ast::stmt::ContainerPtr container;
+	};
+
+	ast::stmt::Stmt const * getStmt( ast::stmt::Container const & container
+		, size_t index )
+	{
+		return std::next( container.begin(), ptrdiff_t( index ) )->get();
+	}
+
+	void testStraightLine( test::TestCounts & testCounts )
+	{
+		testBegin( "testStraightLine" );
+		Context context{ testCounts };
+		// vec4 a = input; float x = a.x; vec4 b = input; float y = b.x + x;
+		auto a = context.makeVariable( "a", context.typesCache.getVec4F() );
+		auto x = context.makeVariable( "x", context.typesCache.getFloat() );
+		auto b = context.makeVariable( "b", context.typesCache.getVec4F() );
+		auto y = context.makeVariable( "y", context.typesCache.getFloat() );
+		auto main = context.makeMain();
+		main->addStmt( context.makeInit( a, context.makeIdent( context.input ) ) );
+		main->addStmt( context.makeInit( x, context.makeX( a ) ) );
+		main->addStmt( context.makeInit( b, context.makeIdent( context.input ) ) );
+		main->addStmt( context.makeInit( y, context.makeAdd( context.makeX( b ), context.makeIdent( x ) ) ) );
+		auto & mainRef = *main;
+		auto result = context.submit( std::move( main ) );
+		// a is dead once x is computed, the peak is on the last statement, with b, x and y.
+		require( result.functions.size() == 1u );
+		auto & function = result.functions.front();
+		check( function.maxLiveScalars == 6u );
+		check( result.entryPointMaxLiveScalars == 6u );
+		require( function.peakStatements.size() == 1u );
+		check( function.peakStatements.front() == getStmt( mainRef, 3u ) );
+		testEnd();
+	}
+
+	void testBranches( test::TestCounts & testCounts )
+	{
+		testBegin( "testBranches" );
+		Context context{ testCounts };
+		// vec4 a = input; vec4 b; if ( input.x > 0.0 ) { b = a; } else { b = input; } float r = b.x;
+		auto a = context.makeVariable( "a", context.typesCache.getVec4F() );
+		auto b = context.makeVariable( "b", context.typesCache.getVec4F() );
+		auto r = context.makeVariable( "r", context.typesCache.getFloat() );
+		auto main = context.makeMain();
+		main->addStmt( context.makeInit( a, context.makeIdent( context.input ) ) );
+		main->addStmt( context.stmtCache.makeVariableDecl( b ) );
+		auto ifStmt = context.stmtCache.makeIf( context.exprCache.makeGreater( context.typesCache
+			, context.makeX( context.input )
+			, context.exprCache.makeLiteral( context.typesCache, 0.0f ) ) );
+		ifStmt->addStmt( context.stmtCache.makeSimple( context.exprCache.makeAssign( b->getType(), context.makeIdent( b ), context.makeIdent( a ) ) ) );
+		auto elseStmt = ifStmt->createElse();
+		elseStmt->addStmt( context.stmtCache.makeSimple( context.exprCache.makeAssign( b->getType(), context.makeIdent( b ), context.makeIdent( context.input ) ) ) );
+		main->addStmt( std::move( ifStmt ) );
+		main->addStmt( context.makeInit( r, context.makeX( b ) ) );
+		auto result = context.submit( std::move( main ) );
+		// a is live until the assignment in the if branch, where a and b are live together.
+		check( result.functions.front().maxLiveScalars == 8u );
+		testEnd();
+	}
+
+	void testLoop( test::TestCounts & testCounts )
+	{
+		testBegin( "testLoop" );
+		Context context{ testCounts };
+		// vec4 a = input; vec4 s = input; while ( s.x < 8.0 ) { vec4 t = s + a; s = t; } float r = s.x;
+		auto a = context.makeVariable( "a", context.typesCache.getVec4F() );
+		auto s = context.makeVariable( "s", context.typesCache.getVec4F() );
+		auto t = context.makeVariable( "t", context.typesCache.getVec4F() );
+		auto r = context.makeVariable( "r", context.typesCache.getFloat() );
+		auto main = context.makeMain();
+		main->addStmt( context.makeInit( a, context.makeIdent( context.input ) ) );
+		main->addStmt( context.makeInit( s, context.makeIdent( context.input ) ) );
+		auto loop = context.stmtCache.makeWhile( context.exprCache.makeLess( context.typesCache
+			, context.makeX( s )
+			, context.exprCache.makeLiteral( context.typesCache, 8.0f ) ) );
+		loop->addStmt( context.makeInit( t, context.makeAdd( context.makeIdent( s ), context.makeIdent( a ) ) ) );
+		loop->addStmt( context.stmtCache.makeSimple( context.exprCache.makeAssign( s->getType(), context.makeIdent( s ), context.makeIdent( t ) ) ) );
+		main->addStmt( std::move( loop ) );
+		main->addStmt( context.makeInit( r, context.makeX( s ) ) );
+		auto & mainRef = *main;
+		auto result = context.submit( std::move( main ) );
+		// a is live in the whole loop, because it is used in the next iterations.
+		auto & function = result.functions.front();
+		check( function.maxLiveScalars == 12u );
+		require( function.peakStatements.size() == 2u );
+		auto & loopRef = static_cast< ast::stmt::While const & >( *getStmt( mainRef, 2u ) );
+		check( function.peakStatements[0] == getStmt( loopRef, 0u ) );
+		check( function.peakStatements[1] == getStmt( loopRef, 1u ) );
+		testEnd();
+	}
+
+	void testCalls( test::TestCounts & testCounts )
+	{
+		testBegin( "testCalls" );
+		Context context{ testCounts };
+		auto container = context.stmtCache.makeContainer();
+		// float helper( float p ) { vec4 v = vec4( p ); return v.x; }
+		auto p = context.makeVariable( "p", context.typesCache.getFloat(), uint64_t( ast::var::Flag::eInputParam ) );
+		auto v = context.makeVariable( "v", context.typesCache.getVec4F() );
+		auto helper = ast::var::makeFunction( ++context.counts.nextVarId, context.typesCache.getFunction( context.typesCache.getFloat(), { p } ), "helper" );
+		auto helperDecl = context.stmtCache.makeFunctionDecl( helper );
+		ast::expr::ExprList ctorArgs;
+		ctorArgs.emplace_back( context.makeIdent( p ) );
+		helperDecl->addStmt( context.makeInit( v, context.exprCache.makeCompositeConstruct( ast::expr::CompositeType::eVec4, ast::type::Kind::eFloat, std::move( ctorArgs ) ) ) );
+		helperDecl->addStmt( context.stmtCache.makeReturn( context.makeX( v ) ) );
+		container->addStmt( std::move( helperDecl ) );
+		// void main() { vec4 a = input; float r = helper( a.x ) + a.y; }
+		auto a = context.makeVariable( "a", context.typesCache.getVec4F() );
+		auto r = context.makeVariable( "r", context.typesCache.getFloat() );
+		auto main = context.makeMain();
+		main->addStmt( context.makeInit( a, context.makeIdent( context.input ) ) );
+		ast::expr::ExprList args;
+		args.emplace_back( context.makeX( a ) );
+		main->addStmt( context.makeInit( r, context.makeAdd( context.exprCache.makeFnCall( context.typesCache.getFloat(), context.makeIdent( helper ), std::move( args ) )
+			, context.exprCache.makeSwizzle( context.makeIdent( a ), ast::expr::SwizzleKind::fromOffset( 1u ) ) ) ) );
+		container->addStmt( std::move( main ) );
+		auto result = ast::analyseRegisterPressure( *container );
+		require( result.functions.size() == 2u );
+		check( !result.functions[0].entryPoint );
+		check( result.functions[0].maxLiveScalars == 5u );
+		// The values of helper are added to a and r, live at the call.
+		check( result.functions[1].maxLiveScalars == 10u );
+		check( result.entryPointMaxLiveScalars == 10u );
+		testEnd();
+	}
+}
+
+testSuiteMain( TestASTAnalyseRegisterPressure )
+{
+	testSuiteBegin();
+	testStraightLine( testCounts );
+	testBranches( testCounts );
+	testLoop( testCounts );
+	testCalls( testCounts );
+	testSuiteEnd();
+}
+
+testSuiteLaunch( TestASTAnalyseRegisterPressure )
@@ -0,0 +1,105 @@
+#include "Common.hpp"
+
+#include <ShaderAST/ShaderBatch.hpp>
+
+#include <atomic>
+
+#pragma clang diagnostic ignored "-Wunused-member-function"
+#pragma warning( disable:5245 )
+
+namespace
+{
+	void testRunBatch( test::TestCounts & testCounts )
+	{
+		testBegin( "testRunBatch" );
+		static size_t constexpr count = 1000u;
+
+		for ( uint32_t concurrency : { 1u, 2u, 7u, 0u } )
+		{
+			std::vector< size_t > results( count );
+			std::atomic< size_t > calls{};
+			ast::runBatch( count
+				, [&results, &calls]( ast::ShaderAllocator & allocator
+					, size_t index )
+				{
+					auto block = allocator.getBlock();
+					auto data = static_cast< size_t * >( block->allocate( sizeof( size_t ), index + 1u ) );
+
+					for ( size_t i = 0u; i <= index; ++i )
+					{
+						data[i] = i;
+					}
+
+					results[index] = data[index] * 2u;
+					block->deallocate( data, sizeof( size_t ), index + 1u );
+					++calls;
+				}
+				, ast::BatchConfig{ concurrency } );
+			testCounts << "Concurrency " << concurrency << test::endl;
+			check( calls == count );
+
+			for ( size_t i = 0u; i < count; ++i )
+			{
+				check( results[i] == i * 2u );
+			}
+		}
+
+		testEnd();
+	}
+
+	void testRunBatchErrors( test::TestCounts & testCounts )
+	{
+		testBegin( "testRunBatchErrors" );
+		std::atomic< size_t > calls{};
+		std::string error;
+
+		try
+		{
+			ast::runBatch( 100u
+				, [&calls]( ast::ShaderAllocator & allocator
+					, size_t index )
+				{
+					++calls;
+
+					if ( index == 42u || index == 77u )
+					{
+						throw ast::Exception{ std::to_string( index ) };
+					}
+				}
+				, ast::BatchConfig{ 4u } );
+		}
+		catch ( ast::Exception & exc )
+		{
+			error = exc.what();
+		}
+
+		check( calls == 100u );
+		check( error == "42" );
+		testEnd();
+	}
+
+	void testGroupBatchItems( test::TestCounts & testCounts )
+	{
+		testBegin( "testGroupBatchItems" );
+		int a{};
+		int b{};
+		int c{};
+		auto groups = ast::groupBatchItems( { &a, &b, &a, &c, &b, &a } );
+		require( groups.size() == 3u );
+		check( ( groups[0] == std::vector< size_t >{ 0u, 2u, 5u } ) );
+		check( ( groups[1] == std::vector< size_t >{ 1u, 4u } ) );
+		check( ( groups[2] == std::vector< size_t >{ 3u } ) );
+		testEnd();
+	}
+}
+
+testSuiteMain( TestASTBatch )
+{
+	testSuiteBegin();
+	testRunBatch( testCounts );
+	testRunBatchErrors( testCounts );
+	testGroupBatchItems( testCounts );
+	testSuiteEnd();
+}
+
+testSuiteLaunch( TestASTBatch )
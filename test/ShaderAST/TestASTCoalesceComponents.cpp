@@ -0,0 +1,185 @@
+#include "Common.hpp"
+
+#include <ShaderAST/Visitors/CoalesceComponents.hpp>
+
+#pragma clang diagnostic ignored "-Wunused-member-function"
+#pragma warning( disable:5245 )
+
+namespace
+{
+	struct Context
+		: test::ASTContext
+	{
+		explicit Context( test::TestCounts & testCounts )
+			: test::ASTContext{ testCounts }
+			, r{ makeLocale( "r", 4u ) }
+			, a{ makeLocale( "a", 2u ) }
+			, b{ makeLocale( "b", 2u ) }
+			, c{ makeLocale( "c", 4u ) }
+			, s{ makeVariable( "s", typesCache.getFloat() ) }
+		{
+		}
+
+		ast::var::VariablePtr makeLocale( std::string name
+			, uint32_t count )
+		{
+			return makeVariable( std::move( name ), typesCache.getVector( ast::type::Kind::eFloat, count ) );
+		}
+
+		ast::expr::ExprPtr makeComponent( ast::var::VariablePtr var
+			, uint32_t component )
+		{
+			return exprCache.makeSwizzle( makeIdent( var ), ast::expr::SwizzleKind::fromOffset( component ) );
+		}
+
+		// r.component = value
+		ast::stmt::SimplePtr makeAssignComponent( uint32_t component
+			, ast::expr::ExprPtr value )
+		{
+			return stmtCache.makeSimple( exprCache.makeAssign( typesCache.getFloat(), makeComponent( r, component ), std::move( value ) ) );
+		}
+
+		ast::stmt::ContainerPtr submit( ast::stmt::FunctionDeclPtr main )
+		{
+			auto container = stmtCache.makeContainer();
+			container->addStmt( std::move( main ) );
+			stats = {};
+			return ast::coalesceComponents( stmtCache, exprCache, typesCache, *container, stats );
+		}
+
+		ast::var::VariablePtr r;
+		ast::var::VariablePtr a;
+		ast::var::VariablePtr b;
+		ast::var::VariablePtr c;
+		ast::var::VariablePtr s;
+		ast::ComponentCoalescingStats stats;
+	};
+
+	ast::stmt::FunctionDecl const & getMain( ast::stmt::Container const & container )
+	{
+		return static_cast< ast::stmt::FunctionDecl const & >( **container.begin() );
+	}
+
+	ast::expr::Assign const & getAssign( ast::stmt::Container const & container
+		, size_t index )
+	{
+		auto & stmt = static_cast< ast::stmt::Simple const & >( **std::next( container.begin(), ptrdiff_t( index ) ) );
+		return static_cast< ast::expr::Assign const & >( *stmt.getExpr() );
+	}
+
+	void testComponents( test::TestCounts & testCounts )
+	{
+		testBegin( "testComponents" );
+		Context context{ testCounts };
+		// r.y = a.y * b.y; r.x = a.x * b.x;
+		auto main = context.makeMain();
+		main->addStmt( context.makeAssignComponent( 1u
+			, context.exprCache.makeTimes( context.typesCache.getFloat(), context.makeComponent( context.a, 1u ), context.makeComponent( context.b, 1u ) ) ) );
+		main->addStmt( context.makeAssignComponent( 0u
+			, context.exprCache.makeTimes( context.typesCache.getFloat(), context.makeComponent( context.a, 0u ), context.makeComponent( context.b, 0u ) ) ) );
+		auto result = context.submit( std::move( main ) );
+		check( context.stats.assignments == 1u );
+		check( context.stats.components == 2u );
+		// r.xy = a * b;
+		auto & resultMain = getMain( *result );
+		require( resultMain.size() == 1u );
+		auto & assign = getAssign( resultMain, 0u );
+		require( assign.getLHS()->getKind() == ast::expr::Kind::eSwizzle );
+		check( static_cast< ast::expr::Swizzle const & >( *assign.getLHS() ).getSwizzle() == ast::expr::SwizzleKind::e01 );
+		require( assign.getRHS()->getKind() == ast::expr::Kind::eTimes );
+		auto & value = static_cast< ast::expr::Times const & >( *assign.getRHS() );
+		check( value.getType()->getKind() == ast::type::Kind::eVec2F );
+		check( value.getLHS()->getKind() == ast::expr::Kind::eIdentifier );
+		check( value.getRHS()->getKind() == ast::expr::Kind::eIdentifier );
+		testEnd();
+	}
+
+	void testScalarOperands( test::TestCounts & testCounts )
+	{
+		testBegin( "testScalarOperands" );
+		Context context{ testCounts };
+		// r.x = c.x * s; r.z = -c.y; r.y = c.z * s; r.w = -c.x;
+		auto main = context.makeMain();
+		main->addStmt( context.makeAssignComponent( 0u
+			, context.exprCache.makeTimes( context.typesCache.getFloat(), context.makeComponent( context.c, 0u ), context.makeIdent( context.s ) ) ) );
+		main->addStmt( context.makeAssignComponent( 2u
+			, context.exprCache.makeUnaryMinus( context.makeComponent( context.c, 1u ) ) ) );
+		main->addStmt( context.makeAssignComponent( 1u
+			, context.exprCache.makeTimes( context.typesCache.getFloat(), context.makeComponent( context.c, 2u ), context.makeIdent( context.s ) ) ) );
+		main->addStmt( context.makeAssignComponent( 3u
+			, context.exprCache.makeUnaryMinus( context.makeComponent( context.c, 0u ) ) ) );
+		auto result = context.submit( std::move( main ) );
+		check( context.stats.assignments == 2u );
+		check( context.stats.components == 4u );
+		// r.xy = c.xz * s; r.zw = -c.yx;
+		auto & resultMain = getMain( *result );
+		require( resultMain.size() == 2u );
+		auto & times = getAssign( resultMain, 0u );
+		require( times.getRHS()->getKind() == ast::expr::Kind::eTimes );
+		auto & value = static_cast< ast::expr::Times const & >( *times.getRHS() );
+		check( value.getLHS()->getKind() == ast::expr::Kind::eSwizzle );
+		check( value.getRHS()->getKind() == ast::expr::Kind::eIdentifier );
+		auto & negate = getAssign( resultMain, 1u );
+		check( static_cast< ast::expr::Swizzle const & >( *negate.getLHS() ).getSwizzle() == ast::expr::SwizzleKind::e23 );
+		check( negate.getRHS()->getKind() == ast::expr::Kind::eUnaryMinus );
+		testEnd();
+	}
+
+	void testLiterals( test::TestCounts & testCounts )
+	{
+		testBegin( "testLiterals" );
+		Context context{ testCounts };
+		// r.x = a.x + 1.0; r.y = a.y + 2.0; r.z = s + 3.0;
+		auto main = context.makeMain();
+		main->addStmt( context.makeAssignComponent( 0u
+			, context.exprCache.makeAdd( context.typesCache.getFloat(), context.makeComponent( context.a, 0u ), context.makeLiteral( 1.0f ) ) ) );
+		main->addStmt( context.makeAssignComponent( 1u
+			, context.exprCache.makeAdd( context.typesCache.getFloat(), context.makeComponent( context.a, 1u ), context.makeLiteral( 2.0f ) ) ) );
+		main->addStmt( context.makeAssignComponent( 2u
+			, context.exprCache.makeAdd( context.typesCache.getFloat(), context.makeIdent( context.s ), context.makeLiteral( 3.0f ) ) ) );
+		auto result = context.submit( std::move( main ) );
+		// The third assignment doesn't use a vector, gathering it would not save anything.
+		check( context.stats.assignments == 1u );
+		check( context.stats.components == 2u );
+		auto & resultMain = getMain( *result );
+		require( resultMain.size() == 2u );
+		auto & assign = getAssign( resultMain, 0u );
+		require( assign.getRHS()->getKind() == ast::expr::Kind::eAdd );
+		check( static_cast< ast::expr::Add const & >( *assign.getRHS() ).getRHS()->getKind() == ast::expr::Kind::eCompositeConstruct );
+		check( getAssign( resultMain, 1u ).getLHS()->getType()->getKind() == ast::type::Kind::eFloat );
+		testEnd();
+	}
+
+	void testDependencies( test::TestCounts & testCounts )
+	{
+		testBegin( "testDependencies" );
+		Context context{ testCounts };
+		// r.x = c.x; r.y = r.x * c.y; r.z = c.z; s = c.w; r.w = c.w;
+		auto main = context.makeMain();
+		main->addStmt( context.makeAssignComponent( 0u, context.makeComponent( context.c, 0u ) ) );
+		main->addStmt( context.makeAssignComponent( 1u
+			, context.exprCache.makeTimes( context.typesCache.getFloat(), context.makeComponent( context.r, 0u ), context.makeComponent( context.c, 1u ) ) ) );
+		main->addStmt( context.makeAssignComponent( 2u, context.makeComponent( context.c, 2u ) ) );
+		main->addStmt( context.stmtCache.makeSimple( context.exprCache.makeAssign( context.typesCache.getFloat()
+			, context.makeIdent( context.s )
+			, context.makeComponent( context.c, 3u ) ) ) );
+		main->addStmt( context.makeAssignComponent( 3u, context.makeComponent( context.c, 3u ) ) );
+		auto result = context.submit( std::move( main ) );
+		// Only the consecutive assignments that don't read r are gathered.
+		check( context.stats.assignments == 0u );
+		check( getMain( *result ).size() == 5u );
+		testEnd();
+	}
+}
+
+testSuiteMain( TestASTCoalesceComponents )
+{
+	testSuiteBegin();
+	testComponents( testCounts );
+	testScalarOperands( testCounts );
+	testLiterals( testCounts );
+	testDependencies( testCounts );
+	testSuiteEnd();
+}
+
+testSuiteLaunch( TestASTCoalesceComponents )
@@ -0,0 +1,236 @@
+#include "Common.hpp"
+
+#include <ShaderAST/Visitors/EliminateCommonSubexpressions.hpp>
+
+#pragma clang diagnostic ignored "-Wunused-member-function"
+#pragma warning( disable:5245 )
+
+namespace
+{
+	struct Context
+		: test::ASTContext
+	{
+		explicit Context( test::TestCounts & testCounts )
+			: test::ASTContext{ testCounts }
+			, x{ makeLocale( "x" ) }
+			, y{ makeLocale( "y" ) }
+		{
+		}
+
+		ast::var::VariablePtr makeLocale( std::string name )
+		{
+			return makeVariable( std::move( name ), typesCache.getInt32() );
+		}
+
+		// x * y
+		ast::expr::ExprPtr makeProduct( ast::var::VariablePtr lhs = nullptr )
+		{
+			return exprCache.makeTimes( typesCache.getInt32()
+				, makeIdent( lhs ? lhs : x )
+				, makeIdent( y ) );
+		}
+
+		ast::stmt::ContainerPtr submit( ast::stmt::FunctionDeclPtr main
+			, bool useAliases = false )
+		{
+			auto container = stmtCache.makeContainer();
+			container->addStmt( std::move( main ) );
+			ast::SSAData ssaData{ counts.nextVarId, 0u };
+			stats = {};
+			auto result = ast::eliminateCommonSubexpressions( stmtCache, exprCache, typesCache, *container, ssaData, useAliases, stats );
+			counts.nextVarId = ssaData.nextVarId;
+			return result;
+		}
+
+		ast::stmt::FunctionDeclPtr makeMain()
+		{
+			auto result = test::ASTContext::makeMain();
+			result->addStmt( makeInit( x, makeLiteral( 2 ) ) );
+			result->addStmt( makeInit( y, makeLiteral( 3 ) ) );
+			return result;
+		}
+
+		ast::var::VariablePtr x;
+		ast::var::VariablePtr y;
+		ast::CommonSubexpressionStats stats;
+	};
+
+	ast::stmt::FunctionDecl const & getMain( ast::stmt::Container const & container )
+	{
+		return static_cast< ast::stmt::FunctionDecl const & >( **container.begin() );
+	}
+
+	void testReuseHolder( test::TestCounts & testCounts )
+	{
+		testBegin( "testReuseHolder" );
+		Context context{ testCounts };
+		// int a = x * y; int b = ( x * y ) + 1;
+		auto main = context.makeMain();
+		main->addStmt( context.makeInit( context.makeLocale( "a" ), context.makeProduct() ) );
+		main->addStmt( context.makeInit( context.makeLocale( "b" )
+			, context.exprCache.makeAdd( context.typesCache.getInt32()
+				, context.makeProduct()
+				, context.exprCache.makeLiteral( context.typesCache, 1 ) ) ) );
+		auto result = context.submit( std::move( main ) );
+		check( context.stats.reused == 1u );
+		check( context.stats.temporaries == 0u );
+		check( getMain( *result ).size() == 4u );
+		testEnd();
+	}
+
+	void testTemporary( test::TestCounts & testCounts )
+	{
+		testBegin( "testTemporary" );
+		Context context{ testCounts };
+		// int a = ( x * y ) + 1; int b = ( x * y ) + 2;
+		auto main = context.makeMain();
+		main->addStmt( context.makeInit( context.makeLocale( "a" )
+			, context.exprCache.makeAdd( context.typesCache.getInt32()
+				, context.makeProduct()
+				, context.exprCache.makeLiteral( context.typesCache, 1 ) ) ) );
+		main->addStmt( context.makeInit( context.makeLocale( "b" )
+			, context.exprCache.makeAdd( context.typesCache.getInt32()
+				, context.makeProduct()
+				, context.exprCache.makeLiteral( context.typesCache, 2 ) ) ) );
+		auto result = context.submit( std::move( main ), true );
+		check( context.stats.reused == 1u );
+		check( context.stats.temporaries == 1u );
+		auto & resultMain = getMain( *result );
+		require( resultMain.size() == 5u );
+		auto & temp = static_cast< ast::stmt::Simple const & >( **std::next( resultMain.begin(), 2 ) );
+		check( temp.getExpr()->getKind() == ast::expr::Kind::eAlias );
+
+		// Temporaries holding a single operation are only worth it for aliases.
+		main = context.makeMain();
+		main->addStmt( context.makeInit( context.makeLocale( "a" )
+			, context.exprCache.makeAdd( context.typesCache.getInt32()
+				, context.makeProduct()
+				, context.exprCache.makeLiteral( context.typesCache, 1 ) ) ) );
+		main->addStmt( context.makeInit( context.makeLocale( "b" )
+			, context.exprCache.makeAdd( context.typesCache.getInt32()
+				, context.makeProduct()
+				, context.exprCache.makeLiteral( context.typesCache, 2 ) ) ) );
+		result = context.submit( std::move( main ), false );
+		check( context.stats.temporaries == 0u );
+		testEnd();
+	}
+
+	void testKilledByStore( test::TestCounts & testCounts )
+	{
+		testBegin( "testKilledByStore" );
+		Context context{ testCounts };
+		// int a = x * y; x = 4; int b = x * y;
+		auto main = context.makeMain();
+		main->addStmt( context.makeInit( context.makeLocale( "a" ), context.makeProduct() ) );
+		main->addStmt( context.stmtCache.makeSimple( context.exprCache.makeAssign( context.typesCache.getInt32()
+			, context.exprCache.makeIdentifier( context.typesCache, context.x )
+			, context.exprCache.makeLiteral( context.typesCache, 4 ) ) ) );
+		main->addStmt( context.makeInit( context.makeLocale( "b" ), context.makeProduct() ) );
+		context.submit( std::move( main ) );
+		check( context.stats.reused == 0u );
+		testEnd();
+	}
+
+	void testNonUniform( test::TestCounts & testCounts )
+	{
+		testBegin( "testNonUniform" );
+		Context context{ testCounts };
+		// int a = x * y; int b = nonuniform( x * y );
+		auto main = context.makeMain();
+		main->addStmt( context.makeInit( context.makeLocale( "a" ), context.makeProduct() ) );
+		auto product = context.makeProduct();
+		product->updateFlag( ast::expr::Flag::eNonUniform );
+		main->addStmt( context.makeInit( context.makeLocale( "b" ), std::move( product ) ) );
+		context.submit( std::move( main ) );
+		check( context.stats.reused == 0u );
+		testEnd();
+	}
+
+	void testMemoryReads( test::TestCounts & testCounts )
+	{
+		testBegin( "testMemoryReads" );
+		Context context{ testCounts };
+		// Another invocation may write the buffer between both reads.
+		auto buffer = ast::var::makeVariable( ++testCounts.nextVarId, context.typesCache.getInt32(), "buffer", uint64_t( ast::var::Flag::eStorageBuffer ) );
+		auto main = context.makeMain();
+		main->addStmt( context.makeInit( context.makeLocale( "a" ), context.makeProduct( buffer ) ) );
+		main->addStmt( context.makeInit( context.makeLocale( "b" ), context.makeProduct( buffer ) ) );
+		context.submit( std::move( main ) );
+		check( context.stats.reused == 0u );
+		testEnd();
+	}
+
+	void testScopes( test::TestCounts & testCounts )
+	{
+		testBegin( "testScopes" );
+		Context context{ testCounts };
+		// if ( x ) { int a = x * y; int b = x * y; } int c = x * y;
+		auto main = context.makeMain();
+		auto ifStmt = context.stmtCache.makeIf( context.exprCache.makeIdentifier( context.typesCache, context.x ) );
+		ifStmt->addStmt( context.makeInit( context.makeLocale( "a" ), context.makeProduct() ) );
+		ifStmt->addStmt( context.makeInit( context.makeLocale( "b" ), context.makeProduct() ) );
+		main->addStmt( std::move( ifStmt ) );
+		main->addStmt( context.makeInit( context.makeLocale( "c" ), context.makeProduct() ) );
+		context.submit( std::move( main ) );
+		check( context.stats.reused == 1u );
+		testEnd();
+	}
+
+	void testShaderIOStructs( test::TestCounts & testCounts )
+	{
+		testBegin( "testShaderIOStructs" );
+		Context context{ testCounts };
+		// The backends split the shader inputs structures into one variable per member.
+		// float a = in[x].position.x; float b = in[x].position.y;
+		auto ioStruct = context.typesCache.getIOStruct( "Position"
+			, ast::EntryPoint::eTessellationControl
+			, ast::var::Flag::eShaderInput );
+		ioStruct->declMember( "position", ast::type::Kind::eVec4F, ast::type::NotArray, 0u );
+		auto in = context.makeVariable( "in"
+			, context.typesCache.getArray( ioStruct, 3u )
+			, uint64_t( ast::var::Flag::eShaderInput ) );
+		auto makePosition = [&context, &ioStruct, &in]( ast::expr::SwizzleKind::Value swizzle )
+		{
+			return context.exprCache.makeSwizzle( context.exprCache.makeMbrSelect( context.exprCache.makeArrayAccess( ioStruct
+						, context.makeIdent( in )
+						, context.makeIdent( context.x ) )
+					, 0u
+					, 0u )
+				, ast::expr::SwizzleKind{ swizzle } );
+		};
+		auto main = context.makeMain();
+		main->addStmt( context.makeInit( context.makeVariable( "a", context.typesCache.getFloat() )
+			, makePosition( ast::expr::SwizzleKind::e0 ) ) );
+		main->addStmt( context.makeInit( context.makeVariable( "b", context.typesCache.getFloat() )
+			, makePosition( ast::expr::SwizzleKind::e1 ) ) );
+		auto result = context.submit( std::move( main ), true );
+		// Only the position is held, not its structure.
+		check( context.stats.temporaries == 1u );
+
+		for ( auto & stmt : getMain( *result ) )
+		{
+			if ( stmt->getKind() == ast::stmt::Kind::eSimple
+				&& static_cast< ast::stmt::Simple const & >( *stmt ).getExpr()->getKind() == ast::expr::Kind::eAlias )
+			{
+				check( !ast::type::isStructType( static_cast< ast::stmt::Simple const & >( *stmt ).getExpr()->getType() ) );
+			}
+		}
+
+		testEnd();
+	}
+}
+
+testSuiteMain( TestASTCommonSubexpressions )
+{
+	testSuiteBegin();
+	testReuseHolder( testCounts );
+	testTemporary( testCounts );
+	testKilledByStore( testCounts );
+	testNonUniform( testCounts );
+	testMemoryReads( testCounts );
+	testScopes( testCounts );
+	testShaderIOStructs( testCounts );
+	testSuiteEnd();
+}
+
+testSuiteLaunch( TestASTCommonSubexpressions )
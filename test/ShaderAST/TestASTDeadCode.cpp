@@ -0,0 +1,229 @@
+#include "Common.hpp"
+
+#include <ShaderAST/Stmt/StmtCache.hpp>
+#include <ShaderAST/Expr/ExprCache.hpp>
+#include <ShaderAST/Type/TypeCache.hpp>
+#include <ShaderAST/Visitors/EliminateDeadCode.hpp>
+
+#pragma clang diagnostic ignored "-Wunused-member-function"
+#pragma warning( disable:5245 )
+
+namespace
+{
+	ast::stmt::FunctionDecl const & getFunction( ast::stmt::Container const & container
+		, std::string const & name )
+	{
+		for ( auto & stmt : container )
+		{
+			if ( stmt->getKind() == ast::stmt::Kind::eFunctionDecl
+				&& static_cast< ast::stmt::FunctionDecl const & >( *stmt ).getName() == name )
+			{
+				return static_cast< ast::stmt::FunctionDecl const & >( *stmt );
+			}
+		}
+
+		throw ast::Exception{ "Function not found: " + name };
+	}
+
+	ast::var::VariablePtr makeLocale( test::TestCounts & testCounts
+		, ast::type::TypesCache & typesCache
+		, std::string name )
+	{
+		return ast::var::makeVariable( ++testCounts.nextVarId, typesCache.getInt32(), std::move( name ), uint64_t( ast::var::Flag::eLocale ) );
+	}
+
+	void testUnusedFunctions( test::TestCounts & testCounts )
+	{
+		testBegin( "testUnusedFunctions" );
+		ast::stmt::StmtCache stmtCache{ *testCounts.allocatorBlock };
+		ast::expr::ExprCache exprCache{ *testCounts.allocatorBlock };
+		ast::type::TypesCache typesCache;
+		auto container = stmtCache.makeContainer();
+		auto makeFunction = [&]( std::string name )
+		{
+			return ast::var::makeFunction( ++testCounts.nextVarId, typesCache.getFunction( typesCache.getVoid(), {} ), std::move( name ) );
+		};
+		auto makeCall = [&]( ast::var::VariablePtr fn )
+		{
+			return stmtCache.makeSimple( exprCache.makeFnCall( typesCache.getVoid()
+				, exprCache.makeIdentifier( typesCache, fn )
+				, {} ) );
+		};
+
+		// used is called from main, unused2 is only called from unused, which isn't called.
+		auto used = makeFunction( "used" );
+		auto unused2 = makeFunction( "unused2" );
+		auto unused = makeFunction( "unused" );
+		container->addStmt( stmtCache.makeFunctionDecl( used ) );
+		container->addStmt( stmtCache.makeFunctionDecl( unused2 ) );
+		auto unusedDecl = stmtCache.makeFunctionDecl( unused );
+		unusedDecl->addStmt( makeCall( unused2 ) );
+		container->addStmt( std::move( unusedDecl ) );
+		auto main = stmtCache.makeFunctionDecl( makeFunction( "main" ), ast::stmt::FunctionFlag::eComputeEntryPoint );
+		main->addStmt( makeCall( used ) );
+		container->addStmt( std::move( main ) );
+
+		ast::DeadCodeStats stats;
+		auto result = ast::eliminateDeadCode( stmtCache, exprCache, *container, stats );
+		require( result->size() == 2u );
+		check( getFunction( *result, "used" ).getName() == "used" );
+		check( getFunction( *result, "main" ).size() == 1u );
+		check( stats.functions == 2u );
+
+		// Without entry point, every function is kept.
+		auto library = stmtCache.makeContainer();
+		library->addStmt( stmtCache.makeFunctionDecl( makeFunction( "lib" ) ) );
+		stats = {};
+		result = ast::eliminateDeadCode( stmtCache, exprCache, *library, stats );
+		check( result->size() == 1u );
+		check( stats.functions == 0u );
+		testEnd();
+	}
+
+	void testUnusedVariables( test::TestCounts & testCounts )
+	{
+		testBegin( "testUnusedVariables" );
+		ast::stmt::StmtCache stmtCache{ *testCounts.allocatorBlock };
+		ast::expr::ExprCache exprCache{ *testCounts.allocatorBlock };
+		ast::type::TypesCache typesCache;
+		auto container = stmtCache.makeContainer();
+		auto output = ast::var::makeVariable( ++testCounts.nextVarId, typesCache.getInt32(), "output", uint64_t( ast::var::Flag::eShaderOutput ) );
+		container->addStmt( stmtCache.makeInOutVariableDecl( output, 0u ) );
+		auto compute = ast::var::makeFunction( ++testCounts.nextVarId, typesCache.getFunction( typesCache.getInt32(), {} ), "compute" );
+		auto computeDecl = stmtCache.makeFunctionDecl( compute );
+		computeDecl->addStmt( stmtCache.makeReturn( exprCache.makeLiteral( typesCache, 1 ) ) );
+		container->addStmt( std::move( computeDecl ) );
+
+		auto declared = makeLocale( testCounts, typesCache, "declared" );
+		auto stored = makeLocale( testCounts, typesCache, "stored" );
+		auto called = makeLocale( testCounts, typesCache, "called" );
+		auto read = makeLocale( testCounts, typesCache, "read" );
+		auto main = stmtCache.makeFunctionDecl( ast::var::makeFunction( ++testCounts.nextVarId, typesCache.getFunction( typesCache.getVoid(), {} ), "main" )
+			, ast::stmt::FunctionFlag::eFragmentEntryPoint );
+		// int declared; (never referenced)
+		main->addStmt( stmtCache.makeVariableDecl( declared ) );
+		// int stored = 2; stored = 3; (never read)
+		main->addStmt( stmtCache.makeSimple( exprCache.makeInit( exprCache.makeIdentifier( typesCache, stored ), exprCache.makeLiteral( typesCache, 2 ) ) ) );
+		main->addStmt( stmtCache.makeSimple( exprCache.makeAssign( typesCache.getInt32()
+			, exprCache.makeIdentifier( typesCache, stored )
+			, exprCache.makeLiteral( typesCache, 3 ) ) ) );
+		// int called = compute(); (never read, but the call is kept)
+		main->addStmt( stmtCache.makeSimple( exprCache.makeInit( exprCache.makeIdentifier( typesCache, called )
+			, exprCache.makeFnCall( typesCache.getInt32(), exprCache.makeIdentifier( typesCache, compute ), {} ) ) ) );
+		// int read = 4; output = read;
+		main->addStmt( stmtCache.makeSimple( exprCache.makeInit( exprCache.makeIdentifier( typesCache, read ), exprCache.makeLiteral( typesCache, 4 ) ) ) );
+		main->addStmt( stmtCache.makeSimple( exprCache.makeAssign( typesCache.getInt32()
+			, exprCache.makeIdentifier( typesCache, output )
+			, exprCache.makeIdentifier( typesCache, read ) ) ) );
+		container->addStmt( std::move( main ) );
+
+		ast::DeadCodeStats stats;
+		auto result = ast::eliminateDeadCode( stmtCache, exprCache, *container, stats );
+		require( result->size() == 3u );
+		auto & function = getFunction( *result, "main" );
+		require( function.size() == 3u );
+		auto it = function.begin();
+		require( ( *it )->getKind() == ast::stmt::Kind::eSimple );
+		check( static_cast< ast::stmt::Simple const & >( **it ).getExpr()->getKind() == ast::expr::Kind::eFnCall );
+		++it;
+		require( ( *it )->getKind() == ast::stmt::Kind::eSimple );
+		check( static_cast< ast::stmt::Simple const & >( **it ).getExpr()->getKind() == ast::expr::Kind::eInit );
+		check( stats.variables == 1u );
+		check( stats.statements == 3u );
+		check( stats.functions == 0u );
+		testEnd();
+	}
+
+	void testUnusedDeclarations( test::TestCounts & testCounts )
+	{
+		testBegin( "testUnusedDeclarations" );
+		ast::stmt::StmtCache stmtCache{ *testCounts.allocatorBlock };
+		ast::expr::ExprCache exprCache{ *testCounts.allocatorBlock };
+		ast::type::TypesCache typesCache;
+		auto container = stmtCache.makeContainer();
+		auto usedInput = ast::var::makeVariable( ++testCounts.nextVarId, typesCache.getInt32(), "usedInput", uint64_t( ast::var::Flag::eShaderInput ) );
+		auto unusedInput = ast::var::makeVariable( ++testCounts.nextVarId, typesCache.getInt32(), "unusedInput", uint64_t( ast::var::Flag::eShaderInput ) );
+		auto unusedOutput = ast::var::makeVariable( ++testCounts.nextVarId, typesCache.getInt32(), "unusedOutput", uint64_t( ast::var::Flag::eShaderOutput ) );
+		auto usedSampler = ast::var::makeVariable( ++testCounts.nextVarId, typesCache.getSampler(), "usedSampler", uint64_t( ast::var::Flag::eUniform ) );
+		auto unusedSampler = ast::var::makeVariable( ++testCounts.nextVarId, typesCache.getSampler(), "unusedSampler", uint64_t( ast::var::Flag::eUniform ) );
+		auto unusedShared = ast::var::makeVariable( ++testCounts.nextVarId, typesCache.getInt32(), "unusedShared", uint64_t( ast::var::Flag::eShared ) );
+		container->addStmt( stmtCache.makeInOutVariableDecl( usedInput, 0u ) );
+		container->addStmt( stmtCache.makeInOutVariableDecl( unusedInput, 1u ) );
+		container->addStmt( stmtCache.makeInOutVariableDecl( unusedOutput, 0u ) );
+		container->addStmt( stmtCache.makeSamplerDecl( usedSampler, 0u, 0u ) );
+		container->addStmt( stmtCache.makeSamplerDecl( unusedSampler, 1u, 0u ) );
+		container->addStmt( stmtCache.makeVariableDecl( unusedShared ) );
+
+		auto main = stmtCache.makeFunctionDecl( ast::var::makeFunction( ++testCounts.nextVarId, typesCache.getFunction( typesCache.getVoid(), {} ), "main" )
+			, ast::stmt::FunctionFlag::eFragmentEntryPoint );
+		main->addStmt( stmtCache.makeIf( exprCache.makeEqual( typesCache
+			, exprCache.makeIdentifier( typesCache, usedInput )
+			, exprCache.makeLiteral( typesCache, 0 ) ) ) );
+		main->addStmt( stmtCache.makeSimple( exprCache.makeIdentifier( typesCache, usedSampler ) ) );
+		container->addStmt( std::move( main ) );
+
+		ast::DeadCodeStats stats;
+		auto result = ast::eliminateDeadCode( stmtCache, exprCache, *container, stats );
+		check( result->size() == 4u );
+		check( stats.declarations == 2u );
+		check( stats.variables == 1u );
+		testEnd();
+	}
+
+	void testUnreachableStatements( test::TestCounts & testCounts )
+	{
+		testBegin( "testUnreachableStatements" );
+		ast::stmt::StmtCache stmtCache{ *testCounts.allocatorBlock };
+		ast::expr::ExprCache exprCache{ *testCounts.allocatorBlock };
+		ast::type::TypesCache typesCache;
+		auto container = stmtCache.makeContainer();
+		auto output = ast::var::makeVariable( ++testCounts.nextVarId, typesCache.getInt32(), "output", uint64_t( ast::var::Flag::eShaderOutput ) );
+		container->addStmt( stmtCache.makeInOutVariableDecl( output, 0u ) );
+		auto makeStore = [&]( int value )
+		{
+			return stmtCache.makeSimple( exprCache.makeAssign( typesCache.getInt32()
+				, exprCache.makeIdentifier( typesCache, output )
+				, exprCache.makeLiteral( typesCache, value ) ) );
+		};
+		auto main = stmtCache.makeFunctionDecl( ast::var::makeFunction( ++testCounts.nextVarId, typesCache.getFunction( typesCache.getVoid(), {} ), "main" )
+			, ast::stmt::FunctionFlag::eFragmentEntryPoint );
+		// Statements following a demote are kept.
+		auto demoted = stmtCache.makeCompound();
+		demoted->addStmt( stmtCache.makeDemote() );
+		demoted->addStmt( makeStore( 1 ) );
+		main->addStmt( std::move( demoted ) );
+		// Statements following a terminate are removed.
+		auto terminated = stmtCache.makeCompound();
+		terminated->addStmt( stmtCache.makeTerminateInvocation() );
+		terminated->addStmt( makeStore( 2 ) );
+		main->addStmt( std::move( terminated ) );
+		main->addStmt( makeStore( 3 ) );
+		main->addStmt( stmtCache.makeReturn() );
+		main->addStmt( makeStore( 4 ) );
+		main->addStmt( makeStore( 5 ) );
+		container->addStmt( std::move( main ) );
+
+		ast::DeadCodeStats stats;
+		auto result = ast::eliminateDeadCode( stmtCache, exprCache, *container, stats );
+		auto & function = getFunction( *result, "main" );
+		require( function.size() == 4u );
+		auto it = function.begin();
+		check( static_cast< ast::stmt::Compound const & >( **it ).size() == 2u );
+		++it;
+		check( static_cast< ast::stmt::Compound const & >( **it ).size() == 1u );
+		check( stats.statements == 3u );
+		testEnd();
+	}
+}
+
+testSuiteMain( TestASTDeadCode )
+{
+	testSuiteBegin();
+	testUnusedFunctions( testCounts );
+	testUnusedVariables( testCounts );
+	testUnusedDeclarations( testCounts );
+	testUnreachableStatements( testCounts );
+	testSuiteEnd();
+}
+
+testSuiteLaunch( TestASTDeadCode )
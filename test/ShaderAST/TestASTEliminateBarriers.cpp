@@ -0,0 +1,240 @@
+#include "Common.hpp"
+
+#include <ShaderAST/Visitors/EliminateBarriers.hpp>
+
+#pragma clang diagnostic ignored "-Wunused-member-function"
+#pragma warning( disable:5245 )
+
+namespace
+{
+	struct Context
+		: test::ASTContext
+	{
+		explicit Context( test::TestCounts & testCounts )
+			: test::ASTContext{ testCounts }
+		{
+		}
+
+		ast::var::VariablePtr makeShared( std::string name )
+		{
+			return makeVariable( std::move( name ), typesCache.getFloat(), uint64_t( ast::var::Flag::eShared ) );
+		}
+
+		ast::stmt::SimplePtr makeWrite( ast::var::VariablePtr var )
+		{
+			return makeAssign( var, makeLiteral( 1.0f ) );
+		}
+
+		ast::stmt::SimplePtr makeRead( ast::var::VariablePtr var )
+		{
+			return makeInit( makeVariable( "r", typesCache.getFloat() ), makeIdent( var ) );
+		}
+
+		ast::stmt::SimplePtr makeBarrier()
+		{
+			return stmtCache.makeSimple( ast::expr::makeControlBarrier( exprCache
+				, typesCache
+				, ast::type::Scope::eWorkgroup
+				, ast::type::Scope::eWorkgroup
+				, ast::type::MemorySemanticsMask::eAcquireRelease | ast::type::MemorySemanticsMask::eWorkgroupMemory ) );
+		}
+
+		ast::stmt::SimplePtr makeMemoryBarrier( ast::type::Scope scope
+			, ast::type::MemorySemanticsMask storage )
+		{
+			return stmtCache.makeSimple( ast::expr::makeMemoryBarrier( exprCache
+				, typesCache
+				, scope
+				, ast::type::MemorySemanticsMask::eAcquireRelease | storage ) );
+		}
+
+		ast::stmt::FunctionDecl const & submit( ast::stmt::FunctionDeclPtr main
+			, ast::BarrierEliminationMode mode = ast::BarrierEliminationMode::eConflicts )
+		{
+			auto container = stmtCache.makeContainer();
+			container->addStmt( std::move( main ) );
+			stats = {};
+			result = ast::eliminateBarriers( stmtCache, exprCache, typesCache, *container, mode, stats );
+			return static_cast< ast::stmt::FunctionDecl const & >( **result->begin() );
+		}
+
+		ast::BarrierEliminationStats stats;
+		ast::stmt::ContainerPtr result;
+	};
+
+	ast::stmt::Stmt const & getStmt( ast::stmt::Container const & container
+		, size_t index )
+	{
+		return **std::next( container.begin(), ptrdiff_t( index ) );
+	}
+
+	ast::expr::IntrinsicCall const * getBarrier( ast::stmt::Container const & container
+		, size_t index )
+	{
+		auto & stmt = getStmt( container, index );
+
+		if ( stmt.getKind() != ast::stmt::Kind::eSimple )
+		{
+			return nullptr;
+		}
+
+		auto expr = static_cast< ast::stmt::Simple const & >( stmt ).getExpr();
+
+		if ( expr->getKind() != ast::expr::Kind::eIntrinsicCall )
+		{
+			return nullptr;
+		}
+
+		return static_cast< ast::expr::IntrinsicCall const * >( expr );
+	}
+
+	uint32_t getArg( ast::expr::IntrinsicCall const & call
+		, size_t index )
+	{
+		return static_cast< ast::expr::Literal const & >( *call.getArgList()[index] ).getValue< ast::expr::LiteralType::eUInt32 >();
+	}
+
+	void testMerge( test::TestCounts & testCounts )
+	{
+		testBegin( "testMerge" );
+		Context context{ testCounts };
+		// s = 1.0; memoryBarrierShared(); memoryBarrierBuffer(); barrier(); barrier(); float r = s;
+		auto s = context.makeShared( "s" );
+		auto main = context.makeMain();
+		main->addStmt( context.makeWrite( s ) );
+		main->addStmt( context.makeMemoryBarrier( ast::type::Scope::eWorkgroup, ast::type::MemorySemanticsMask::eWorkgroupMemory ) );
+		main->addStmt( context.makeMemoryBarrier( ast::type::Scope::eDevice, ast::type::MemorySemanticsMask::eUniformMemory ) );
+		main->addStmt( context.makeBarrier() );
+		main->addStmt( context.makeBarrier() );
+		main->addStmt( context.makeRead( s ) );
+		auto & result = context.submit( std::move( main ) );
+		check( context.stats.merged == 2u );
+		check( context.stats.removed == 0u );
+		require( result.size() == 4u );
+		// The memory barriers are merged, with the widest scope and both storage classes.
+		auto memory = getBarrier( result, 1u );
+		require( memory != nullptr );
+		check( memory->getIntrinsic() == ast::expr::Intrinsic::eMemoryBarrier );
+		check( getArg( *memory, 0u ) == uint32_t( ast::type::Scope::eDevice ) );
+		check( getArg( *memory, 1u ) == uint32_t( ast::type::MemorySemanticsMask::eAcquireRelease
+			| ast::type::MemorySemanticsMask::eWorkgroupMemory
+			| ast::type::MemorySemanticsMask::eUniformMemory ) );
+		auto control = getBarrier( result, 2u );
+		require( control != nullptr );
+		check( control->getIntrinsic() == ast::expr::Intrinsic::eControlBarrier );
+		testEnd();
+	}
+
+	void testConflicts( test::TestCounts & testCounts )
+	{
+		testBegin( "testConflicts" );
+
+		for ( auto mode : { ast::BarrierEliminationMode::eConservative, ast::BarrierEliminationMode::eConflicts } )
+		{
+			Context context{ testCounts };
+			// a = 1.0; barrier(); b = 1.0; barrier(); float r = a;
+			auto a = context.makeShared( "a" );
+			auto b = context.makeShared( "b" );
+			auto main = context.makeMain();
+			main->addStmt( context.makeWrite( a ) );
+			main->addStmt( context.makeBarrier() );
+			main->addStmt( context.makeWrite( b ) );
+			main->addStmt( context.makeBarrier() );
+			main->addStmt( context.makeRead( a ) );
+			auto & result = context.submit( std::move( main ), mode );
+			check( context.stats.merged == 0u );
+
+			if ( mode == ast::BarrierEliminationMode::eConservative )
+			{
+				// Shared memory is accessed on both sides of each barrier.
+				check( context.stats.removed == 0u );
+				check( result.size() == 5u );
+			}
+			else
+			{
+				// The first barrier separates accesses to different variables,
+				// once removed, the second one separates the write and the read of a.
+				check( context.stats.removed == 1u );
+				require( result.size() == 4u );
+				check( getBarrier( result, 1u ) == nullptr );
+				check( getBarrier( result, 2u ) != nullptr );
+			}
+		}
+
+		testEnd();
+	}
+
+	void testBoundaries( test::TestCounts & testCounts )
+	{
+		testBegin( "testBoundaries" );
+		Context context{ testCounts };
+		// barrier(); while ( c ) { s = 1.0; barrier(); float r = s; } memoryBarrierShared();
+		auto s = context.makeShared( "s" );
+		auto c = context.makeVariable( "c", context.typesCache.getBool() );
+		auto main = context.makeMain();
+		main->addStmt( context.makeBarrier() );
+		auto loop = context.stmtCache.makeWhile( context.makeIdent( c ) );
+		loop->addStmt( context.makeWrite( s ) );
+		loop->addStmt( context.makeBarrier() );
+		loop->addStmt( context.makeRead( s ) );
+		main->addStmt( std::move( loop ) );
+		main->addStmt( context.makeMemoryBarrier( ast::type::Scope::eWorkgroup, ast::type::MemorySemanticsMask::eWorkgroupMemory ) );
+		auto & result = context.submit( std::move( main ), ast::BarrierEliminationMode::eConservative );
+		// Nothing is accessed before the first barrier, nor after the last one.
+		check( context.stats.removed == 2u );
+		require( result.size() == 1u );
+		// The read of an iteration conflicts with the write of the next one, the barrier in the loop is kept.
+		auto & resultLoop = static_cast< ast::stmt::While const & >( getStmt( result, 0u ) );
+		require( resultLoop.size() == 3u );
+		check( getBarrier( resultLoop, 1u ) != nullptr );
+		testEnd();
+	}
+
+	void testUnknownPaths( test::TestCounts & testCounts )
+	{
+		testBegin( "testUnknownPaths" );
+		Context context{ testCounts };
+		auto container = context.stmtCache.makeContainer();
+		// void sync() { barrier(); }
+		auto sync = ast::var::makeFunction( ++context.counts.nextVarId, context.typesCache.getFunction( context.typesCache.getVoid(), {} ), "sync" );
+		auto syncDecl = context.stmtCache.makeFunctionDecl( sync );
+		syncDecl->addStmt( context.makeBarrier() );
+		container->addStmt( std::move( syncDecl ) );
+		// s = 1.0; while ( c ) { if ( c ) { break; } barrier(); } float r = s;
+		auto s = context.makeShared( "s" );
+		auto c = context.makeVariable( "c", context.typesCache.getBool() );
+		auto main = context.makeMain();
+		main->addStmt( context.makeWrite( s ) );
+		auto loop = context.stmtCache.makeWhile( context.makeIdent( c ) );
+		auto ifStmt = context.stmtCache.makeIf( context.makeIdent( c ) );
+		ifStmt->addStmt( context.stmtCache.makeBreak( false ) );
+		loop->addStmt( std::move( ifStmt ) );
+		loop->addStmt( context.makeBarrier() );
+		main->addStmt( std::move( loop ) );
+		main->addStmt( context.makeRead( s ) );
+		container->addStmt( std::move( main ) );
+		ast::BarrierEliminationStats stats;
+		auto result = ast::eliminateBarriers( context.stmtCache, context.exprCache, context.typesCache, *container, ast::BarrierEliminationMode::eConflicts, stats );
+		// The barrier of the function is never processed, the one in the loop can be preceded by the write of s.
+		check( stats.removed == 0u );
+		check( stats.merged == 0u );
+		auto & resultSync = static_cast< ast::stmt::FunctionDecl const & >( getStmt( *result, 0u ) );
+		check( resultSync.size() == 1u );
+		auto & resultMain = static_cast< ast::stmt::FunctionDecl const & >( getStmt( *result, 1u ) );
+		auto & resultLoop = static_cast< ast::stmt::While const & >( getStmt( resultMain, 1u ) );
+		check( resultLoop.size() == 2u );
+		testEnd();
+	}
+}
+
+testSuiteMain( TestASTEliminateBarriers )
+{
+	testSuiteBegin();
+	testMerge( testCounts );
+	testConflicts( testCounts );
+	testBoundaries( testCounts );
+	testUnknownPaths( testCounts );
+	testSuiteEnd();
+}
+
+testSuiteLaunch( TestASTEliminateBarriers )
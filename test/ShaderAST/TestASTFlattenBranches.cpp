@@ -0,0 +1,192 @@
+#include "Common.hpp"
+
+#include <ShaderAST/Visitors/FlattenBranches.hpp>
+
+#pragma clang diagnostic ignored "-Wunused-member-function"
+#pragma warning( disable:5245 )
+
+namespace
+{
+	struct Context
+		: test::ASTContext
+	{
+		explicit Context( test::TestCounts & testCounts )
+			: test::ASTContext{ testCounts }
+			, x{ makeLocale( "x" ) }
+			, y{ makeLocale( "y" ) }
+			, global{ makeVariable( "global", typesCache.getInt32(), 0u ) }
+			, ssbo{ makeVariable( "ssbo", typesCache.getInt32(), uint64_t( ast::var::Flag::eStorageBuffer ) ) }
+		{
+		}
+
+		ast::var::VariablePtr makeLocale( std::string name )
+		{
+			return makeVariable( std::move( name ), typesCache.getInt32() );
+		}
+
+		// if ( global > 0 )
+		ast::stmt::IfPtr makeIf()
+		{
+			return stmtCache.makeIf( exprCache.makeGreater( typesCache, makeIdent( global ), makeLiteral( 0 ) ) );
+		}
+
+		ast::stmt::FunctionDeclPtr makeMain()
+		{
+			auto result = test::ASTContext::makeMain();
+			result->addStmt( makeInit( x, makeLiteral( 0 ) ) );
+			result->addStmt( makeInit( y, makeLiteral( 0 ) ) );
+			return result;
+		}
+
+		ast::stmt::ContainerPtr submit( ast::stmt::FunctionDeclPtr main )
+		{
+			auto container = stmtCache.makeContainer();
+			container->addStmt( std::move( main ) );
+			stats = {};
+			ast::SSAData ssaData{ counts.nextVarId, 0u };
+			return ast::flattenBranches( stmtCache, exprCache, typesCache, *container, ssaData, false, 4u, stats );
+		}
+
+		ast::var::VariablePtr x;
+		ast::var::VariablePtr y;
+		ast::var::VariablePtr global;
+		ast::var::VariablePtr ssbo;
+		ast::BranchFlatteningStats stats;
+	};
+
+	ast::stmt::FunctionDecl const & getMain( ast::stmt::Container const & container )
+	{
+		return static_cast< ast::stmt::FunctionDecl const & >( **container.begin() );
+	}
+
+	ast::stmt::Stmt const & getStmt( ast::stmt::Container const & container
+		, size_t index )
+	{
+		return **std::next( container.begin(), ptrdiff_t( index ) );
+	}
+
+	ast::expr::Expr const & getExpr( ast::stmt::Container const & container
+		, size_t index )
+	{
+		return *static_cast< ast::stmt::Simple const & >( getStmt( container, index ) ).getExpr();
+	}
+
+	void testIfElse( test::TestCounts & testCounts )
+	{
+		testBegin( "testIfElse" );
+		Context context{ testCounts };
+		// if ( global > 0 ) { x = 1; } else { x = 2; }
+		auto main = context.makeMain();
+		auto ifStmt = context.makeIf();
+		ifStmt->addStmt( context.makeAssign( context.x, context.makeLiteral( 1 ) ) );
+		ifStmt->createElse()->addStmt( context.makeAssign( context.x, context.makeLiteral( 2 ) ) );
+		main->addStmt( std::move( ifStmt ) );
+		auto result = context.submit( std::move( main ) );
+		check( context.stats.branches == 1u );
+		check( context.stats.selections == 1u );
+		// x = ( global > 0 ) ? 1 : 2;
+		auto & resultMain = getMain( *result );
+		require( resultMain.size() == 3u );
+		require( getStmt( resultMain, 2u ).getKind() == ast::stmt::Kind::eSimple );
+		auto & assign = static_cast< ast::expr::Assign const & >( getExpr( resultMain, 2u ) );
+		require( assign.getKind() == ast::expr::Kind::eAssign );
+		check( assign.getRHS()->getKind() == ast::expr::Kind::eQuestion );
+		testEnd();
+	}
+
+	void testSeveralVariables( test::TestCounts & testCounts )
+	{
+		testBegin( "testSeveralVariables" );
+		Context context{ testCounts };
+		// if ( global > 0 ) { x = 1; y = y + 1; }
+		auto main = context.makeMain();
+		auto ifStmt = context.makeIf();
+		ifStmt->addStmt( context.makeAssign( context.x, context.makeLiteral( 1 ) ) );
+		ifStmt->addStmt( context.makeAssign( context.y
+			, context.exprCache.makeAdd( context.typesCache.getInt32(), context.makeIdent( context.y ), context.makeLiteral( 1 ) ) ) );
+		main->addStmt( std::move( ifStmt ) );
+		auto result = context.submit( std::move( main ) );
+		check( context.stats.branches == 1u );
+		check( context.stats.selections == 2u );
+		// The condition is computed once, before the selections.
+		auto & resultMain = getMain( *result );
+		require( resultMain.size() == 5u );
+		check( getExpr( resultMain, 2u ).getKind() == ast::expr::Kind::eInit );
+		check( getExpr( resultMain, 3u ).getKind() == ast::expr::Kind::eAssign );
+		check( getExpr( resultMain, 4u ).getKind() == ast::expr::Kind::eAssign );
+		testEnd();
+	}
+
+	void testKeptBranches( test::TestCounts & testCounts )
+	{
+		testBegin( "testKeptBranches" );
+		Context context{ testCounts };
+		// if ( global > 0 ) { x = ssbo; }
+		// if ( global > 0 ) { x = y; y = 1; }
+		// [[dont_flatten]] if ( global > 0 ) { x = 1; }
+		// if ( global > 0 ) { global = 1; }
+		auto main = context.makeMain();
+		auto ifStmt = context.makeIf();
+		ifStmt->addStmt( context.makeAssign( context.x, context.makeIdent( context.ssbo ) ) );
+		main->addStmt( std::move( ifStmt ) );
+		ifStmt = context.makeIf();
+		ifStmt->addStmt( context.makeAssign( context.x, context.makeIdent( context.y ) ) );
+		ifStmt->addStmt( context.makeAssign( context.y, context.makeLiteral( 1 ) ) );
+		main->addStmt( std::move( ifStmt ) );
+		ifStmt = context.makeIf();
+		ifStmt->setHint( ast::stmt::SelectionHint::eDontFlatten );
+		ifStmt->addStmt( context.makeAssign( context.x, context.makeLiteral( 1 ) ) );
+		main->addStmt( std::move( ifStmt ) );
+		ifStmt = context.makeIf();
+		ifStmt->addStmt( context.makeAssign( context.global, context.makeLiteral( 1 ) ) );
+		main->addStmt( std::move( ifStmt ) );
+		auto result = context.submit( std::move( main ) );
+		check( context.stats.branches == 0u );
+		auto & resultMain = getMain( *result );
+		require( resultMain.size() == 6u );
+		check( getStmt( resultMain, 4u ).getKind() == ast::stmt::Kind::eIf );
+		check( static_cast< ast::stmt::If const & >( getStmt( resultMain, 4u ) ).getHint() == ast::stmt::SelectionHint::eDontFlatten );
+		testEnd();
+	}
+
+	void testCostThreshold( test::TestCounts & testCounts )
+	{
+		testBegin( "testCostThreshold" );
+		Context context{ testCounts };
+		// if ( global > 0 ) { x = 1; x2 = 1; x3 = 1; } else { y = 2; y2 = 2; }, twice, the second one hinted to be flattened.
+		auto main = context.makeMain();
+
+		for ( auto hint : { ast::stmt::SelectionHint::eNone, ast::stmt::SelectionHint::eFlatten } )
+		{
+			auto ifStmt = context.makeIf();
+			ifStmt->setHint( hint );
+			ifStmt->addStmt( context.makeAssign( context.x, context.makeLiteral( 1 ) ) );
+			ifStmt->addStmt( context.makeAssign( context.makeLocale( "x2" ), context.makeLiteral( 1 ) ) );
+			ifStmt->addStmt( context.makeAssign( context.makeLocale( "x3" ), context.makeLiteral( 1 ) ) );
+			auto elseStmt = ifStmt->createElse();
+			elseStmt->addStmt( context.makeAssign( context.y, context.makeLiteral( 2 ) ) );
+			elseStmt->addStmt( context.makeAssign( context.makeLocale( "y2" ), context.makeLiteral( 2 ) ) );
+			main->addStmt( std::move( ifStmt ) );
+		}
+
+		auto result = context.submit( std::move( main ) );
+		check( context.stats.branches == 1u );
+		check( context.stats.selections == 5u );
+		auto & resultMain = getMain( *result );
+		require( resultMain.size() == 9u );
+		check( getStmt( resultMain, 2u ).getKind() == ast::stmt::Kind::eIf );
+		testEnd();
+	}
+}
+
+testSuiteMain( TestASTFlattenBranches )
+{
+	testSuiteBegin();
+	testIfElse( testCounts );
+	testSeveralVariables( testCounts );
+	testKeptBranches( testCounts );
+	testCostThreshold( testCounts );
+	testSuiteEnd();
+}
+
+testSuiteLaunch( TestASTFlattenBranches )
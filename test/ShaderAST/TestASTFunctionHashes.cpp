@@ -0,0 +1,173 @@
+#include "Common.hpp"
+
+#include <ShaderAST/Stmt/StmtCache.hpp>
+#include <ShaderAST/Expr/ExprCache.hpp>
+#include <ShaderAST/Type/TypeCache.hpp>
+#include <ShaderAST/Visitors/FunctionHashes.hpp>
+#include <ShaderAST/Visitors/OptimiseStatements.hpp>
+
+#include <cstring>
+
+#pragma clang diagnostic ignored "-Wunused-member-function"
+#pragma warning( disable:5245 )
+
+namespace
+{
+	// Builds: int callee( int i ) { return i + calleeValue; } int caller() { return callee( 1 ); } int other() { return 2; }
+	ast::stmt::ContainerPtr buildShader( test::TestCounts & testCounts
+		, ast::stmt::StmtCache & stmtCache
+		, ast::expr::ExprCache & exprCache
+		, ast::type::TypesCache & typesCache
+		, int calleeValue
+		, int globalValue )
+	{
+		auto result = stmtCache.makeContainer();
+		result->addStmt( stmtCache.makeVariableDecl( ast::var::makeVariable( ++testCounts.nextVarId, typesCache.getInt32(), "global" + std::to_string( globalValue ) ) ) );
+
+		auto calleeType = typesCache.getFunction( typesCache.getInt32(), { ast::var::makeVariable( ++testCounts.nextVarId, typesCache.getInt32(), "i" ) } );
+		auto calleeVar = ast::var::makeFunction( ++testCounts.nextVarId, calleeType, "callee" );
+		auto callee = stmtCache.makeFunctionDecl( calleeVar );
+		callee->addStmt( stmtCache.makeReturn(
+			exprCache.makeAdd( typesCache.getInt32(),
+				exprCache.makeIdentifier( typesCache, *calleeType->begin() ),
+				exprCache.makeLiteral( typesCache, calleeValue ) ) ) );
+		result->addStmt( std::move( callee ) );
+
+		auto caller = stmtCache.makeFunctionDecl( ast::var::makeFunction( ++testCounts.nextVarId, typesCache.getFunction( typesCache.getInt32(), {} ), "caller" ) );
+		ast::expr::ExprList args;
+		args.emplace_back( exprCache.makeLiteral( typesCache, 1 ) );
+		caller->addStmt( stmtCache.makeReturn( exprCache.makeFnCall( typesCache.getInt32()
+			, exprCache.makeIdentifier( typesCache, calleeVar )
+			, std::move( args ) ) ) );
+		result->addStmt( std::move( caller ) );
+
+		auto other = stmtCache.makeFunctionDecl( ast::var::makeFunction( ++testCounts.nextVarId, typesCache.getFunction( typesCache.getInt32(), {} ), "other" ) );
+		other->addStmt( stmtCache.makeReturn( exprCache.makeLiteral( typesCache, 2 ) ) );
+		result->addStmt( std::move( other ) );
+		return result;
+	}
+
+	void testComputeShaderHashes( test::TestCounts & testCounts )
+	{
+		testBegin( "testComputeShaderHashes" );
+		ast::stmt::StmtCache stmtCache{ *testCounts.allocatorBlock };
+		ast::expr::ExprCache exprCache{ *testCounts.allocatorBlock };
+		ast::type::TypesCache typesCache;
+		auto ref = ast::computeShaderHashes( *buildShader( testCounts, stmtCache, exprCache, typesCache, 10, 0 ) );
+		require( ref.functions.size() == 3u );
+		check( ref.functions[0].name == "callee" );
+		check( ref.functions[0].callees.empty() );
+		check( ref.functions[1].name == "caller" );
+		require( ref.functions[1].callees.size() == 1u );
+		check( ref.functions[1].callees[0] == "callee" );
+
+		// Rebuilding the same source gives the same hashes, even with different variable IDs.
+		auto same = ast::computeShaderHashes( *buildShader( testCounts, stmtCache, exprCache, typesCache, 10, 0 ) );
+		check( ast::isSameShader( ref, same ) );
+		check( ast::listChangedFunctions( ref, same ).empty() );
+
+		// Changing the callee changes its caller, but not the other function.
+		auto changed = ast::computeShaderHashes( *buildShader( testCounts, stmtCache, exprCache, typesCache, 20, 0 ) );
+		check( !ast::isSameShader( ref, changed ) );
+		check( changed.functions[2].hash == ref.functions[2].hash );
+		check( changed.functions[1].hash == ref.functions[1].hash );
+		check( ( ast::listChangedFunctions( ref, changed ) == std::vector< std::string >{ "callee", "caller" } ) );
+
+		// Changing a global declaration changes every function.
+		auto global = ast::computeShaderHashes( *buildShader( testCounts, stmtCache, exprCache, typesCache, 10, 1 ) );
+		check( global.globals != ref.globals );
+		check( ast::listChangedFunctions( ref, global ).size() == 3u );
+		testEnd();
+	}
+
+	void testShaderMemo( test::TestCounts & testCounts )
+	{
+		testBegin( "testShaderMemo" );
+		ast::stmt::StmtCache stmtCache{ *testCounts.allocatorBlock };
+		ast::expr::ExprCache exprCache{ *testCounts.allocatorBlock };
+		ast::type::TypesCache typesCache;
+		using Memo = ast::ShaderMemoT< std::string >;
+		Memo memo;
+		uint32_t compiles{};
+		// Each function output is the index of the compilation that generated it.
+		auto compile = [&compiles]( Memo::FunctionOutputs & functions )
+		{
+			std::string result;
+			++compiles;
+
+			for ( size_t index = 0u; index < functions.getHashes().functions.size(); ++index )
+			{
+				if ( auto output = functions.find( index ) )
+				{
+					result += *output;
+				}
+				else
+				{
+					functions.store( index, std::to_string( compiles ) );
+					result += std::to_string( compiles );
+				}
+			}
+
+			return result;
+		};
+		ast::OptimisationConfig config{};
+		auto configHash = ast::hashConfig( config );
+
+		check( memo.compile( *buildShader( testCounts, stmtCache, exprCache, typesCache, 10, 0 ), configHash, compile ) == "111" );
+		check( !memo.isReused() );
+		check( memo.getGeneratedFunctions().size() == 3u );
+		check( memo.compile( *buildShader( testCounts, stmtCache, exprCache, typesCache, 10, 0 ), configHash, compile ) == "111" );
+		check( memo.isReused() );
+		check( memo.getChangedFunctions().empty() );
+		check( memo.getGeneratedFunctions().empty() );
+		// Only the callee and its caller are generated again.
+		check( memo.compile( *buildShader( testCounts, stmtCache, exprCache, typesCache, 20, 0 ), configHash, compile ) == "221" );
+		check( !memo.isReused() );
+		check( memo.getChangedFunctions().size() == 2u );
+		check( ( memo.getGeneratedFunctions() == std::vector< std::string >{ "callee", "caller" } ) );
+		// A global declaration change regenerates every function.
+		check( memo.compile( *buildShader( testCounts, stmtCache, exprCache, typesCache, 20, 1 ), configHash, compile ) == "333" );
+		check( memo.getGeneratedFunctions().size() == 3u );
+		// Same shader, other configuration.
+		config.eliminateDeadCode = true;
+		check( ast::hashConfig( config ) != configHash );
+		configHash = ast::hashConfig( config );
+		check( memo.compile( *buildShader( testCounts, stmtCache, exprCache, typesCache, 20, 1 ), configHash, compile ) == "444" );
+		check( !memo.isReused() );
+		check( memo.getChangedFunctions().empty() );
+		check( memo.getGeneratedFunctions().size() == 3u );
+		memo.clear();
+		check( memo.compile( *buildShader( testCounts, stmtCache, exprCache, typesCache, 20, 1 ), configHash, compile ) == "555" );
+		testEnd();
+	}
+
+	void testHashSpecialisation( test::TestCounts & testCounts )
+	{
+		testBegin( "testHashSpecialisation" );
+		ast::type::TypesCache typesCache;
+		auto makeSpecialisation = [&typesCache]( int32_t value )
+		{
+			ast::SpecialisationInfo result;
+			ast::SpecConstantData constant{ { { typesCache.getInt32(), 0u } } };
+			constant.data.resize( sizeof( int32_t ) );
+			std::memcpy( constant.data.data(), &value, sizeof( int32_t ) );
+			result.data.push_back( std::move( constant ) );
+			return result;
+		};
+
+		check( ast::hashSpecialisation( makeSpecialisation( 1 ) ) == ast::hashSpecialisation( makeSpecialisation( 1 ) ) );
+		check( ast::hashSpecialisation( makeSpecialisation( 1 ) ) != ast::hashSpecialisation( makeSpecialisation( 2 ) ) );
+		testEnd();
+	}
+}
+
+testSuiteMain( TestASTFunctionHashes )
+{
+	testSuiteBegin();
+	testComputeShaderHashes( testCounts );
+	testShaderMemo( testCounts );
+	testHashSpecialisation( testCounts );
+	testSuiteEnd();
+}
+
+testSuiteLaunch( TestASTFunctionHashes )
@@ -0,0 +1,212 @@
+#include "Common.hpp"
+
+#include <ShaderAST/Visitors/HoistLoopInvariants.hpp>
+
+#pragma clang diagnostic ignored "-Wunused-member-function"
+#pragma warning( disable:5245 )
+
+namespace
+{
+	struct Context
+		: test::ASTContext
+	{
+		explicit Context( test::TestCounts & testCounts )
+			: test::ASTContext{ testCounts }
+			, x{ makeLocale( "x" ) }
+			, y{ makeLocale( "y" ) }
+			, z{ makeLocale( "z" ) }
+			, global{ makeVariable( "global", typesCache.getInt32(), 0u ) }
+			, ubo{ makeVariable( "ubo", typesCache.getInt32(), uint64_t( ast::var::Flag::eUniform ) ) }
+			, uboValue{ ast::var::makeVariable( ++counts.nextVarId, ubo, typesCache.getInt32(), "uboValue", uint64_t( ast::var::Flag::eMember ) ) }
+			, ssbo{ makeVariable( "ssbo", typesCache.getInt32(), uint64_t( ast::var::Flag::eStorageBuffer ) ) }
+			, ssboValue{ ast::var::makeVariable( ++counts.nextVarId, ssbo, typesCache.getInt32(), "ssboValue", uint64_t( ast::var::Flag::eMember ) ) }
+		{
+		}
+
+		ast::var::VariablePtr makeLocale( std::string name )
+		{
+			return makeVariable( std::move( name ), typesCache.getInt32() );
+		}
+
+		ast::expr::ExprPtr makeTimes( ast::expr::ExprPtr lhs
+			, ast::expr::ExprPtr rhs )
+		{
+			return exprCache.makeTimes( typesCache.getInt32(), std::move( lhs ), std::move( rhs ) );
+		}
+
+		// x = x + 1
+		ast::stmt::SimplePtr makeStep()
+		{
+			return makeAssign( x, exprCache.makeAdd( typesCache.getInt32(), makeIdent( x ), makeLiteral( 1 ) ) );
+		}
+
+		// do { ... } while ( x < 4 )
+		ast::stmt::DoWhilePtr makeLoop()
+		{
+			return stmtCache.makeDoWhile( exprCache.makeLess( typesCache, makeIdent( x ), makeLiteral( 4 ) ) );
+		}
+
+		ast::stmt::FunctionDeclPtr makeMain()
+		{
+			auto result = test::ASTContext::makeMain();
+			result->addStmt( makeInit( x, makeLiteral( 0 ) ) );
+			result->addStmt( makeInit( z, makeLiteral( 2 ) ) );
+			return result;
+		}
+
+		ast::stmt::ContainerPtr submit( ast::stmt::FunctionDeclPtr main )
+		{
+			auto container = stmtCache.makeContainer();
+			container->addStmt( std::move( main ) );
+			stats = {};
+			ast::SSAData ssaData{ counts.nextVarId, 0u };
+			return ast::hoistLoopInvariants( stmtCache, exprCache, typesCache, *container, ssaData, false, stats );
+		}
+
+		ast::var::VariablePtr x;
+		ast::var::VariablePtr y;
+		ast::var::VariablePtr z;
+		ast::var::VariablePtr global;
+		ast::var::VariablePtr ubo;
+		ast::var::VariablePtr uboValue;
+		ast::var::VariablePtr ssbo;
+		ast::var::VariablePtr ssboValue;
+		ast::LoopInvariantStats stats;
+	};
+
+	ast::stmt::FunctionDecl const & getMain( ast::stmt::Container const & container )
+	{
+		return static_cast< ast::stmt::FunctionDecl const & >( **container.begin() );
+	}
+
+	ast::stmt::Stmt const & getStmt( ast::stmt::Container const & container
+		, size_t index )
+	{
+		return **std::next( container.begin(), ptrdiff_t( index ) );
+	}
+
+	// The value assigned by the statement at the given index.
+	ast::expr::Expr const & getValue( ast::stmt::Container const & container
+		, size_t index )
+	{
+		auto & stmt = static_cast< ast::stmt::Simple const & >( getStmt( container, index ) );
+		return *static_cast< ast::expr::Binary const & >( *stmt.getExpr() ).getRHS();
+	}
+
+	void testInvariants( test::TestCounts & testCounts )
+	{
+		testBegin( "testInvariants" );
+		Context context{ testCounts };
+		// do { global = x * ( z * uboValue ); x = x + 1; } while ( x < 4 );
+		auto main = context.makeMain();
+		auto loop = context.makeLoop();
+		loop->addStmt( context.makeAssign( context.global
+			, context.makeTimes( context.makeIdent( context.x )
+				, context.makeTimes( context.makeIdent( context.z ), context.makeIdent( context.uboValue ) ) ) ) );
+		loop->addStmt( context.makeStep() );
+		main->addStmt( std::move( loop ) );
+		auto result = context.submit( std::move( main ) );
+		check( context.stats.loops == 1u );
+		check( context.stats.expressions == 1u );
+		// z * uboValue is computed before the loop.
+		auto & resultMain = getMain( *result );
+		require( resultMain.size() == 4u );
+		check( getStmt( resultMain, 2u ).getKind() == ast::stmt::Kind::eSimple );
+		check( getValue( resultMain, 2u ).getKind() == ast::expr::Kind::eTimes );
+		auto & resultLoop = static_cast< ast::stmt::DoWhile const & >( getStmt( resultMain, 3u ) );
+		require( resultLoop.getKind() == ast::stmt::Kind::eDoWhile );
+		auto & value = static_cast< ast::expr::Binary const & >( getValue( resultLoop, 0u ) );
+		check( value.getRHS()->getKind() == ast::expr::Kind::eIdentifier );
+		testEnd();
+	}
+
+	void testWrittenVariables( test::TestCounts & testCounts )
+	{
+		testBegin( "testWrittenVariables" );
+		Context context{ testCounts };
+		// do { y = z * x; z = y; x = x + 1; } while ( x < 4 );
+		auto main = context.makeMain();
+		auto loop = context.makeLoop();
+		loop->addStmt( context.makeAssign( context.y
+			, context.makeTimes( context.makeIdent( context.z ), context.makeIdent( context.x ) ) ) );
+		loop->addStmt( context.makeAssign( context.z, context.makeIdent( context.y ) ) );
+		loop->addStmt( context.makeStep() );
+		main->addStmt( std::move( loop ) );
+		auto result = context.submit( std::move( main ) );
+		check( context.stats.loops == 0u );
+		check( context.stats.expressions == 0u );
+		check( getMain( *result ).size() == 3u );
+		testEnd();
+	}
+
+	void testMemoryWrites( test::TestCounts & testCounts )
+	{
+		testBegin( "testMemoryWrites" );
+		Context context{ testCounts };
+		// do { y = ssboValue * 2; x = x + 1; } while ( x < 4 );
+		// do { y = ssboValue * 2; ssboValue = x; x = x + 1; } while ( x < 4 );
+		auto main = context.makeMain();
+		auto loop = context.makeLoop();
+		loop->addStmt( context.makeAssign( context.y
+			, context.makeTimes( context.makeIdent( context.ssboValue ), context.makeLiteral( 2 ) ) ) );
+		loop->addStmt( context.makeStep() );
+		main->addStmt( std::move( loop ) );
+		loop = context.makeLoop();
+		loop->addStmt( context.makeAssign( context.y
+			, context.makeTimes( context.makeIdent( context.ssboValue ), context.makeLiteral( 2 ) ) ) );
+		loop->addStmt( context.makeAssign( context.ssboValue, context.makeIdent( context.x ) ) );
+		loop->addStmt( context.makeStep() );
+		main->addStmt( std::move( loop ) );
+		auto result = context.submit( std::move( main ) );
+		// Only the loop that doesn't write the storage buffer has its read moved.
+		check( context.stats.loops == 1u );
+		check( context.stats.expressions == 1u );
+		auto & resultMain = getMain( *result );
+		require( resultMain.size() == 5u );
+		auto & second = static_cast< ast::stmt::DoWhile const & >( getStmt( resultMain, 4u ) );
+		require( second.getKind() == ast::stmt::Kind::eDoWhile );
+		check( getValue( second, 0u ).getKind() == ast::expr::Kind::eTimes );
+		testEnd();
+	}
+
+	void testConditionalReads( test::TestCounts & testCounts )
+	{
+		testBegin( "testConditionalReads" );
+		Context context{ testCounts };
+		// do { if ( x > 2 ) { y = ssboValue * 2; y = z * 3; } x = x + 1; } while ( x < 4 );
+		auto main = context.makeMain();
+		auto loop = context.makeLoop();
+		auto ifStmt = context.stmtCache.makeIf( context.exprCache.makeGreater( context.typesCache, context.makeIdent( context.x ), context.makeLiteral( 2 ) ) );
+		ifStmt->addStmt( context.makeAssign( context.y
+			, context.makeTimes( context.makeIdent( context.ssboValue ), context.makeLiteral( 2 ) ) ) );
+		ifStmt->addStmt( context.makeAssign( context.y
+			, context.makeTimes( context.makeIdent( context.z ), context.makeLiteral( 3 ) ) ) );
+		loop->addStmt( std::move( ifStmt ) );
+		loop->addStmt( context.makeStep() );
+		main->addStmt( std::move( loop ) );
+		auto result = context.submit( std::move( main ) );
+		// The memory read is not done when the condition fails, the arithmetic can be.
+		check( context.stats.loops == 1u );
+		check( context.stats.expressions == 1u );
+		auto & resultMain = getMain( *result );
+		require( resultMain.size() == 4u );
+		auto & resultLoop = static_cast< ast::stmt::DoWhile const & >( getStmt( resultMain, 3u ) );
+		auto & resultIf = static_cast< ast::stmt::If const & >( getStmt( resultLoop, 0u ) );
+		require( resultIf.getKind() == ast::stmt::Kind::eIf );
+		check( getValue( resultIf, 0u ).getKind() == ast::expr::Kind::eTimes );
+		check( getValue( resultIf, 1u ).getKind() == ast::expr::Kind::eIdentifier );
+		testEnd();
+	}
+}
+
+testSuiteMain( TestASTHoistLoopInvariants )
+{
+	testSuiteBegin();
+	testInvariants( testCounts );
+	testWrittenVariables( testCounts );
+	testMemoryWrites( testCounts );
+	testConditionalReads( testCounts );
+	testSuiteEnd();
+}
+
+testSuiteLaunch( TestASTHoistLoopInvariants )
@@ -0,0 +1,197 @@
+#include "Common.hpp"
+
+#include <ShaderAST/Visitors/InferBufferAccess.hpp>
+
+#pragma clang diagnostic ignored "-Wunused-member-function"
+#pragma warning( disable:5245 )
+
+namespace
+{
+	struct Context
+		: test::ASTContext
+	{
+		explicit Context( test::TestCounts & testCounts )
+			: test::ASTContext{ testCounts }
+		{
+		}
+
+		ast::var::VariablePtr makeMember( ast::var::VariablePtr buffer
+			, std::string name
+			, ast::type::TypePtr type )
+		{
+			return ast::var::makeVariable( ++counts.nextVarId
+				, std::move( buffer )
+				, std::move( type )
+				, std::move( name )
+				, uint64_t( ast::var::Flag::eMember ) | uint64_t( ast::var::Flag::eStorageBuffer ) );
+		}
+
+		// lhs = rhs, lhs being any lvalue expression
+		ast::stmt::SimplePtr makeAssign( ast::expr::ExprPtr lhs
+			, ast::expr::ExprPtr rhs )
+		{
+			auto type = lhs->getType();
+			return stmtCache.makeSimple( exprCache.makeAssign( type, std::move( lhs ), std::move( rhs ) ) );
+		}
+
+		ast::stmt::ContainerPtr submit( ast::stmt::ContainerPtr container )
+		{
+			stats = {};
+			return ast::inferBufferAccess( stmtCache, exprCache, typesCache, *container, stats );
+		}
+
+		ast::BufferAccessStats stats;
+	};
+
+	ast::stmt::Stmt const & getStmt( ast::stmt::Container const & container
+		, size_t index )
+	{
+		return **std::next( container.begin(), ptrdiff_t( index ) );
+	}
+
+	ast::var::VariablePtr getMember( ast::stmt::ShaderBufferDecl const & buffer
+		, size_t index )
+	{
+		return static_cast< ast::stmt::VariableDecl const & >( getStmt( buffer, index ) ).getVariable();
+	}
+
+	void testMembers( test::TestCounts & testCounts )
+	{
+		testBegin( "testMembers" );
+		Context context{ testCounts };
+		// buffer Buffer { vec4 src; vec4 dst; uint counter; uint unused; };
+		auto type = context.typesCache.getStruct( ast::type::MemoryLayout::eStd430, "Buffer" );
+		auto buffer = context.makeVariable( "Buffer", type, uint64_t( ast::var::Flag::eStorageBuffer ) );
+		auto src = context.makeMember( buffer, "src", context.typesCache.getVec4F() );
+		auto dst = context.makeMember( buffer, "dst", context.typesCache.getVec4F() );
+		auto counter = context.makeMember( buffer, "counter", context.typesCache.getUInt32() );
+		auto unused = context.makeMember( buffer, "unused", context.typesCache.getUInt32() );
+		auto container = context.stmtCache.makeContainer();
+		auto bufferDecl = context.stmtCache.makeShaderBufferDecl( buffer, 0u, 0u );
+		bufferDecl->add( context.stmtCache.makeVariableDecl( src ) );
+		bufferDecl->add( context.stmtCache.makeVariableDecl( dst ) );
+		bufferDecl->add( context.stmtCache.makeVariableDecl( counter ) );
+		bufferDecl->add( context.stmtCache.makeVariableDecl( unused ) );
+		container->addStmt( std::move( bufferDecl ) );
+		// vec4 v = src; dst = v; atomicAdd( counter, 1u );
+		auto v = context.makeVariable( "v", context.typesCache.getVec4F() );
+		auto main = context.makeMain();
+		main->addStmt( context.makeInit( v, context.makeIdent( src ) ) );
+		main->addStmt( context.makeAssign( context.makeIdent( dst ), context.makeIdent( v ) ) );
+		ast::expr::ExprList args;
+		args.emplace_back( context.makeIdent( counter ) );
+		args.emplace_back( context.exprCache.makeLiteral( context.typesCache, 1u ) );
+		main->addStmt( context.stmtCache.makeSimple( context.exprCache.makeIntrinsicCall( context.typesCache.getUInt32()
+			, ast::expr::Intrinsic::eAtomicAddU
+			, std::move( args ) ) ) );
+		container->addStmt( std::move( main ) );
+		auto result = context.submit( std::move( container ) );
+		check( context.stats.nonWritable == 2u );
+		check( context.stats.nonReadable == 1u );
+		auto & resultBuffer = static_cast< ast::stmt::ShaderBufferDecl const & >( getStmt( *result, 0u ) );
+		check( !resultBuffer.getVariable()->isNonWritable() );
+		check( !resultBuffer.getVariable()->isNonReadable() );
+		auto resultSrc = getMember( resultBuffer, 0u );
+		check( resultSrc->isNonWritable() );
+		check( !resultSrc->isNonReadable() );
+		check( resultSrc->getOuter() == resultBuffer.getVariable() );
+		auto resultDst = getMember( resultBuffer, 1u );
+		check( !resultDst->isNonWritable() );
+		check( resultDst->isNonReadable() );
+		auto resultCounter = getMember( resultBuffer, 2u );
+		check( !resultCounter->isNonWritable() );
+		check( !resultCounter->isNonReadable() );
+		// The members never used are only marked as not written.
+		auto resultUnused = getMember( resultBuffer, 3u );
+		check( resultUnused->isNonWritable() );
+		check( !resultUnused->isNonReadable() );
+		// The uses in the function see the replaced variables.
+		auto & resultMain = static_cast< ast::stmt::FunctionDecl const & >( getStmt( *result, 1u ) );
+		auto & assign = static_cast< ast::expr::Assign const & >( *static_cast< ast::stmt::Simple const & >( getStmt( resultMain, 1u ) ).getExpr() );
+		check( static_cast< ast::expr::Identifier const & >( *assign.getLHS() ).getVariable() == resultDst );
+		testEnd();
+	}
+
+	void testStructBuffer( test::TestCounts & testCounts )
+	{
+		testBegin( "testStructBuffer" );
+		Context context{ testCounts };
+		// buffer Buffer { float data[]; } inst;
+		auto type = context.typesCache.getStruct( ast::type::MemoryLayout::eStd430, "BufferType" );
+		type->declMember( "data", context.typesCache.getArray( context.typesCache.getFloat() ) );
+		auto data = context.makeVariable( "data", type->getMember( "data" ).type, uint64_t( ast::var::Flag::eStorageBuffer ) );
+		auto instance = context.makeVariable( "inst", type, uint64_t( ast::var::Flag::eStorageBuffer ) );
+		auto container = context.stmtCache.makeContainer();
+		container->addStmt( context.stmtCache.makeShaderStructBufferDecl( "Buffer", instance, data, 0u, 0u ) );
+		// float v = data[1];
+		auto v = context.makeVariable( "v", context.typesCache.getFloat() );
+		auto main = context.makeMain();
+		main->addStmt( context.makeInit( v, context.exprCache.makeArrayAccess( context.typesCache.getFloat()
+			, context.makeIdent( data )
+			, context.exprCache.makeLiteral( context.typesCache, 1u ) ) ) );
+		container->addStmt( std::move( main ) );
+		auto result = context.submit( std::move( container ) );
+		check( context.stats.nonWritable == 2u );
+		check( context.stats.nonReadable == 0u );
+		auto & resultBuffer = static_cast< ast::stmt::ShaderStructBufferDecl const & >( getStmt( *result, 0u ) );
+		check( resultBuffer.getSsboInstance()->isNonWritable() );
+		check( resultBuffer.getData()->isNonWritable() );
+		check( !resultBuffer.getData()->isNonReadable() );
+		testEnd();
+	}
+
+	void testAliasesAndCalls( test::TestCounts & testCounts )
+	{
+		testBegin( "testAliasesAndCalls" );
+		Context context{ testCounts };
+		// buffer Buffer { float data[]; } inst;
+		auto type = context.typesCache.getStruct( ast::type::MemoryLayout::eStd430, "BufferType" );
+		type->declMember( "data", context.typesCache.getArray( context.typesCache.getFloat() ) );
+		auto data = context.makeVariable( "data", type->getMember( "data" ).type, uint64_t( ast::var::Flag::eStorageBuffer ) );
+		auto instance = context.makeVariable( "inst", type, uint64_t( ast::var::Flag::eStorageBuffer ) );
+		auto container = context.stmtCache.makeContainer();
+		container->addStmt( context.stmtCache.makeShaderStructBufferDecl( "Buffer", instance, data, 0u, 0u ) );
+		// void fill( out float p ) { p = 1.0; }
+		auto p = context.makeVariable( "p", context.typesCache.getFloat(), uint64_t( ast::var::Flag::eOutputParam ) );
+		auto fill = ast::var::makeFunction( ++context.counts.nextVarId, context.typesCache.getFunction( context.typesCache.getVoid(), { p } ), "fill" );
+		auto fillDecl = context.stmtCache.makeFunctionDecl( fill );
+		fillDecl->addStmt( context.makeAssign( context.makeIdent( p ), context.exprCache.makeLiteral( context.typesCache, 1.0f ) ) );
+		container->addStmt( std::move( fillDecl ) );
+		// alias a = data[0]; a = 2.0; fill( data[1] );
+		auto a = context.makeVariable( "a", context.typesCache.getFloat(), uint64_t( ast::var::Flag::eAlias ) );
+		auto main = context.makeMain();
+		main->addStmt( context.stmtCache.makeSimple( context.exprCache.makeAlias( context.typesCache.getFloat()
+			, context.makeIdent( a )
+			, context.exprCache.makeArrayAccess( context.typesCache.getFloat()
+				, context.makeIdent( data )
+				, context.exprCache.makeLiteral( context.typesCache, 0u ) ) ) ) );
+		main->addStmt( context.makeAssign( context.makeIdent( a ), context.exprCache.makeLiteral( context.typesCache, 2.0f ) ) );
+		ast::expr::ExprList args;
+		args.emplace_back( context.exprCache.makeArrayAccess( context.typesCache.getFloat()
+			, context.makeIdent( data )
+			, context.exprCache.makeLiteral( context.typesCache, 1u ) ) );
+		main->addStmt( context.stmtCache.makeSimple( context.exprCache.makeFnCall( context.typesCache.getVoid()
+			, context.makeIdent( fill )
+			, std::move( args ) ) ) );
+		container->addStmt( std::move( main ) );
+		auto result = context.submit( std::move( container ) );
+		// The buffer is only written, through the alias and the output argument.
+		check( context.stats.nonWritable == 0u );
+		check( context.stats.nonReadable == 2u );
+		auto & resultBuffer = static_cast< ast::stmt::ShaderStructBufferDecl const & >( getStmt( *result, 0u ) );
+		check( resultBuffer.getData()->isNonReadable() );
+		check( !resultBuffer.getData()->isNonWritable() );
+		testEnd();
+	}
+}
+
+testSuiteMain( TestASTInferBufferAccess )
+{
+	testSuiteBegin();
+	testMembers( testCounts );
+	testStructBuffer( testCounts );
+	testAliasesAndCalls( testCounts );
+	testSuiteEnd();
+}
+
+testSuiteLaunch( TestASTInferBufferAccess )
@@ -0,0 +1,197 @@
+#include "Common.hpp"
+
+#include <ShaderAST/Visitors/InlineFunctions.hpp>
+
+#pragma clang diagnostic ignored "-Wunused-member-function"
+#pragma warning( disable:5245 )
+
+namespace
+{
+	struct Context
+		: test::ASTContext
+	{
+		explicit Context( test::TestCounts & testCounts )
+			: test::ASTContext{ testCounts }
+		{
+		}
+
+		ast::var::VariablePtr makeLocale( std::string name
+			, uint64_t flags = uint64_t( ast::var::Flag::eLocale ) )
+		{
+			return makeVariable( std::move( name ), typesCache.getInt32(), flags );
+		}
+
+		ast::stmt::ContainerPtr submit( ast::stmt::ContainerPtr container
+			, bool useAliases
+			, uint32_t costThreshold )
+		{
+			ast::SSAData ssaData{ counts.nextVarId, 0u };
+			stats = {};
+			auto result = ast::inlineFunctions( stmtCache, exprCache, typesCache, *container, ssaData, useAliases, costThreshold, stats );
+			counts.nextVarId = ssaData.nextVarId;
+			return result;
+		}
+
+		ast::InlineStats stats;
+	};
+
+	ast::stmt::FunctionDecl const & getFunction( ast::stmt::Container const & container
+		, std::string const & name )
+	{
+		for ( auto & stmt : container )
+		{
+			if ( stmt->getKind() == ast::stmt::Kind::eFunctionDecl
+				&& static_cast< ast::stmt::FunctionDecl const & >( *stmt ).getName() == name )
+			{
+				return static_cast< ast::stmt::FunctionDecl const & >( *stmt );
+			}
+		}
+
+		throw ast::Exception{ "Function not found: " + name };
+	}
+
+	ast::expr::Expr const & getExpr( ast::stmt::Container const & container
+		, size_t index )
+	{
+		auto & stmt = **std::next( container.begin(), ptrdiff_t( index ) );
+
+		if ( stmt.getKind() != ast::stmt::Kind::eSimple )
+		{
+			throw ast::Exception{ "Not a simple statement" };
+		}
+
+		return *static_cast< ast::stmt::Simple const & >( stmt ).getExpr();
+	}
+
+	void testOutputParam( test::TestCounts & testCounts )
+	{
+		testBegin( "testOutputParam" );
+		Context context{ testCounts };
+		auto container = context.stmtCache.makeContainer();
+		// void set( out int o, int i ) { o = i * 2; }
+		auto o = context.makeLocale( "o", uint64_t( ast::var::Flag::eOutputParam ) );
+		auto i = context.makeLocale( "i", uint64_t( ast::var::Flag::eInputParam ) );
+		auto set = ast::var::makeFunction( ++testCounts.nextVarId, context.typesCache.getFunction( context.typesCache.getVoid(), { o, i } ), "set" );
+		auto setDecl = context.stmtCache.makeFunctionDecl( set );
+		setDecl->addStmt( context.stmtCache.makeSimple( context.exprCache.makeAssign( context.typesCache.getInt32()
+			, context.makeIdent( o )
+			, context.exprCache.makeTimes( context.typesCache.getInt32(), context.makeIdent( i ), context.makeLiteral( 2 ) ) ) ) );
+		container->addStmt( std::move( setDecl ) );
+		// void main() { int x; set( x, 3 ); }
+		auto x = context.makeLocale( "x" );
+		auto main = context.makeMain();
+		main->addStmt( context.stmtCache.makeVariableDecl( x ) );
+		ast::expr::ExprList args;
+		args.emplace_back( context.makeIdent( x ) );
+		args.emplace_back( context.makeLiteral( 3 ) );
+		main->addStmt( context.stmtCache.makeSimple( context.exprCache.makeFnCall( context.typesCache.getVoid()
+			, context.makeIdent( set )
+			, std::move( args ) ) ) );
+		container->addStmt( std::move( main ) );
+
+		auto result = context.submit( std::move( container ), false, 8u );
+		check( context.stats.functions == 1u );
+		check( context.stats.calls == 1u );
+		// int x; int o_N; o_N = 3 * 2; x = o_N;
+		auto & resultMain = getFunction( *result, "main" );
+		require( resultMain.size() == 4u );
+		check( ( *std::next( resultMain.begin() ) )->getKind() == ast::stmt::Kind::eVariableDecl );
+		auto & body = static_cast< ast::expr::Assign const & >( getExpr( resultMain, 2u ) );
+		check( body.getRHS()->getKind() == ast::expr::Kind::eTimes );
+		check( static_cast< ast::expr::Times const & >( *body.getRHS() ).getLHS()->getKind() == ast::expr::Kind::eLiteral );
+		auto & copyBack = static_cast< ast::expr::Assign const & >( getExpr( resultMain, 3u ) );
+		require( copyBack.getLHS()->getKind() == ast::expr::Kind::eIdentifier );
+		check( static_cast< ast::expr::Identifier const & >( *copyBack.getLHS() ).getVariable() == x );
+		testEnd();
+	}
+
+	void testReturnValue( test::TestCounts & testCounts )
+	{
+		testBegin( "testReturnValue" );
+		Context context{ testCounts };
+		auto container = context.stmtCache.makeContainer();
+		// int next( int i ) { return i + 1; }
+		auto i = context.makeLocale( "i", uint64_t( ast::var::Flag::eInputParam ) );
+		auto next = ast::var::makeFunction( ++testCounts.nextVarId, context.typesCache.getFunction( context.typesCache.getInt32(), { i } ), "next" );
+		auto nextDecl = context.stmtCache.makeFunctionDecl( next );
+		nextDecl->addStmt( context.stmtCache.makeReturn( context.exprCache.makeAdd( context.typesCache.getInt32()
+			, context.makeIdent( i )
+			, context.makeLiteral( 1 ) ) ) );
+		container->addStmt( std::move( nextDecl ) );
+		// void main() { int x = 2; alias tmp = next( x ); }
+		auto x = context.makeLocale( "x" );
+		auto tmp = context.makeLocale( "tmp", uint64_t( ast::var::Flag::eLocale ) | uint64_t( ast::var::Flag::eAlias ) | uint64_t( ast::var::Flag::eTemp ) );
+		auto main = context.makeMain();
+		main->addStmt( context.makeInit( x, context.makeLiteral( 2 ) ) );
+		ast::expr::ExprList args;
+		args.emplace_back( context.makeIdent( x ) );
+		main->addStmt( context.stmtCache.makeSimple( context.exprCache.makeAlias( context.typesCache.getInt32()
+			, context.makeIdent( tmp )
+			, context.exprCache.makeFnCall( context.typesCache.getInt32(), context.makeIdent( next ), std::move( args ) ) ) ) );
+		container->addStmt( std::move( main ) );
+
+		// The unmodified parameter is replaced by x, and the alias holds the returned expression.
+		auto result = context.submit( std::move( container ), true, 8u );
+		check( context.stats.calls == 1u );
+		auto & resultMain = getFunction( *result, "main" );
+		require( resultMain.size() == 2u );
+		auto & alias = static_cast< ast::expr::Alias const & >( getExpr( resultMain, 1u ) );
+		require( alias.getKind() == ast::expr::Kind::eAlias );
+		check( alias.getIdentifier().getVariable() == tmp );
+		check( alias.getAliasedExpr()->getKind() == ast::expr::Kind::eAdd );
+		testEnd();
+	}
+
+	void testNotInlined( test::TestCounts & testCounts )
+	{
+		testBegin( "testNotInlined" );
+		Context context{ testCounts };
+		auto container = context.stmtCache.makeContainer();
+		auto global = context.makeLocale( "global", 0u );
+		// void early( int i ) { if ( i ) { return; } global = i; }
+		auto i = context.makeLocale( "i", uint64_t( ast::var::Flag::eInputParam ) );
+		auto early = ast::var::makeFunction( ++testCounts.nextVarId, context.typesCache.getFunction( context.typesCache.getVoid(), { i } ), "early" );
+		auto earlyDecl = context.stmtCache.makeFunctionDecl( early );
+		auto ifStmt = context.stmtCache.makeIf( context.makeIdent( i ) );
+		ifStmt->addStmt( context.stmtCache.makeReturn() );
+		earlyDecl->addStmt( std::move( ifStmt ) );
+		earlyDecl->addStmt( context.makeAssign( global, context.makeIdent( i ) ) );
+		container->addStmt( std::move( earlyDecl ) );
+		// void big( int j ) { global = j; global = j; } (cost 2)
+		auto j = context.makeLocale( "j", uint64_t( ast::var::Flag::eInputParam ) );
+		auto big = ast::var::makeFunction( ++testCounts.nextVarId, context.typesCache.getFunction( context.typesCache.getVoid(), { j } ), "big" );
+		auto bigDecl = context.stmtCache.makeFunctionDecl( big );
+		bigDecl->addStmt( context.makeAssign( global, context.makeIdent( j ) ) );
+		bigDecl->addStmt( context.makeAssign( global, context.makeIdent( j ) ) );
+		container->addStmt( std::move( bigDecl ) );
+		// void main() { early( 1 ); big( 1 ); big( 2 ); }
+		auto main = context.makeMain();
+		auto makeCall = [&context]( ast::var::VariablePtr fn, int value )
+		{
+			ast::expr::ExprList args;
+			args.emplace_back( context.makeLiteral( value ) );
+			return context.stmtCache.makeSimple( context.exprCache.makeFnCall( context.typesCache.getVoid(), context.makeIdent( fn ), std::move( args ) ) );
+		};
+		main->addStmt( makeCall( early, 1 ) );
+		main->addStmt( makeCall( big, 1 ) );
+		main->addStmt( makeCall( big, 2 ) );
+		container->addStmt( std::move( main ) );
+
+		// early returns early, big is called twice and costs more than the threshold.
+		auto result = context.submit( std::move( container ), false, 1u );
+		check( context.stats.calls == 0u );
+		check( getFunction( *result, "main" ).size() == 3u );
+		testEnd();
+	}
+}
+
+testSuiteMain( TestASTInlineFunctions )
+{
+	testSuiteBegin();
+	testOutputParam( testCounts );
+	testReturnValue( testCounts );
+	testNotInlined( testCounts );
+	testSuiteEnd();
+}
+
+testSuiteLaunch( TestASTInlineFunctions )
@@ -0,0 +1,175 @@
+#include "Common.hpp"
+
+#include <ShaderAST/Expr/MakeIntrinsic.hpp>
+#include <ShaderAST/Visitors/PlaceNonUniform.hpp>
+
+#pragma clang diagnostic ignored "-Wunused-member-function"
+#pragma warning( disable:5245 )
+
+namespace
+{
+	struct Context
+		: test::ASTContext
+	{
+		explicit Context( test::TestCounts & testCounts )
+			: test::ASTContext{ testCounts }
+			, samplers{ makeVariable( "samplers", typesCache.getArray( typesCache.getSampler(), 8u ), uint64_t( ast::var::Flag::eUniform ) ) }
+			, input{ makeVariable( "input", typesCache.getInt32(), uint64_t( ast::var::Flag::eShaderInput ) | uint64_t( ast::var::Flag::eFlat ) ) }
+			, uniform{ makeVariable( "uniform", typesCache.getInt32(), uint64_t( ast::var::Flag::eUniform ) ) }
+		{
+		}
+
+		ast::var::VariablePtr makeLocale( std::string name )
+		{
+			return makeVariable( std::move( name ), typesCache.getInt32() );
+		}
+
+		ast::expr::ExprPtr makeNonUniform( ast::expr::ExprPtr expr )
+		{
+			auto result = exprCache.makeCopy( std::move( expr ) );
+			result->updateFlag( ast::expr::Flag::eNonUniform );
+			return result;
+		}
+
+		// samplers[index];
+		ast::stmt::SimplePtr makeAccess( ast::expr::ExprPtr index )
+		{
+			return stmtCache.makeSimple( exprCache.makeArrayAccess( typesCache.getSampler()
+				, makeIdent( samplers )
+				, std::move( index ) ) );
+		}
+
+		ast::stmt::FunctionDeclPtr makeMain()
+		{
+			return test::ASTContext::makeMain( ast::stmt::FunctionFlag::eFragmentEntryPoint );
+		}
+
+		ast::stmt::ContainerPtr submit( ast::stmt::FunctionDeclPtr main )
+		{
+			auto container = stmtCache.makeContainer();
+			container->addStmt( std::move( main ) );
+			stats = {};
+			return ast::placeNonUniform( stmtCache, exprCache, *container, stats );
+		}
+
+		ast::var::VariablePtr samplers;
+		ast::var::VariablePtr input;
+		ast::var::VariablePtr uniform;
+		ast::NonUniformStats stats;
+	};
+
+	ast::stmt::FunctionDecl const & getMain( ast::stmt::Container const & container )
+	{
+		return static_cast< ast::stmt::FunctionDecl const & >( **container.begin() );
+	}
+
+	ast::expr::Expr const & getIndex( ast::stmt::Container const & container
+		, size_t index )
+	{
+		auto & stmt = static_cast< ast::stmt::Simple const & >( **std::next( container.begin(), ptrdiff_t( index ) ) );
+		return *static_cast< ast::expr::ArrayAccess const & >( *stmt.getExpr() ).getRHS();
+	}
+
+	void testInputs( test::TestCounts & testCounts )
+	{
+		testBegin( "testInputs" );
+		Context context{ testCounts };
+		// samplers[input]; samplers[nonuniform( input )]; samplers[uniform];
+		auto main = context.makeMain();
+		main->addStmt( context.makeAccess( context.makeIdent( context.input ) ) );
+		main->addStmt( context.makeAccess( context.makeNonUniform( context.makeIdent( context.input ) ) ) );
+		main->addStmt( context.makeAccess( context.makeIdent( context.uniform ) ) );
+		auto result = context.submit( std::move( main ) );
+		check( context.stats.added == 1u );
+		check( context.stats.unnecessary == 0u );
+		auto & resultMain = getMain( *result );
+		check( getIndex( resultMain, 0u ).isNonUniform() );
+		check( getIndex( resultMain, 1u ).isNonUniform() );
+		check( !getIndex( resultMain, 2u ).isNonUniform() );
+		testEnd();
+	}
+
+	void testUnnecessary( test::TestCounts & testCounts )
+	{
+		testBegin( "testUnnecessary" );
+		Context context{ testCounts };
+		// int a = uniform + 1; samplers[nonuniform( a )]; int b = nonuniform( uniform );
+		auto a = context.makeLocale( "a" );
+		auto b = context.makeLocale( "b" );
+		auto main = context.makeMain();
+		main->addStmt( context.makeInit( a
+			, context.exprCache.makeAdd( context.typesCache.getInt32()
+				, context.makeIdent( context.uniform )
+				, context.exprCache.makeLiteral( context.typesCache, 1 ) ) ) );
+		main->addStmt( context.makeAccess( context.makeNonUniform( context.makeIdent( a ) ) ) );
+		main->addStmt( context.makeInit( b, context.makeNonUniform( context.makeIdent( context.uniform ) ) ) );
+		auto result = context.submit( std::move( main ) );
+		// The flag on the uniform index, and the flag outside of a descriptor index, are removed.
+		check( context.stats.added == 0u );
+		check( context.stats.unnecessary == 2u );
+		auto & resultMain = getMain( *result );
+		check( !getIndex( resultMain, 1u ).isNonUniform() );
+		check( getIndex( resultMain, 1u ).getKind() == ast::expr::Kind::eIdentifier );
+		testEnd();
+	}
+
+	void testControlFlow( test::TestCounts & testCounts )
+	{
+		testBegin( "testControlFlow" );
+		Context context{ testCounts };
+		// int i = 0; if ( input > 0 ) { i = 1; } int j = 0; if ( uniform > 0 ) { j = 1; } samplers[i]; samplers[j];
+		auto i = context.makeLocale( "i" );
+		auto j = context.makeLocale( "j" );
+		auto main = context.makeMain();
+		main->addStmt( context.makeInit( i, context.exprCache.makeLiteral( context.typesCache, 0 ) ) );
+		auto ifInput = context.stmtCache.makeIf( context.exprCache.makeGreater( context.typesCache
+			, context.makeIdent( context.input )
+			, context.exprCache.makeLiteral( context.typesCache, 0 ) ) );
+		ifInput->addStmt( context.makeAssign( i, context.exprCache.makeLiteral( context.typesCache, 1 ) ) );
+		main->addStmt( std::move( ifInput ) );
+		main->addStmt( context.makeInit( j, context.exprCache.makeLiteral( context.typesCache, 0 ) ) );
+		auto ifUniform = context.stmtCache.makeIf( context.exprCache.makeGreater( context.typesCache
+			, context.makeIdent( context.uniform )
+			, context.exprCache.makeLiteral( context.typesCache, 0 ) ) );
+		ifUniform->addStmt( context.makeAssign( j, context.exprCache.makeLiteral( context.typesCache, 1 ) ) );
+		main->addStmt( std::move( ifUniform ) );
+		main->addStmt( context.makeAccess( context.makeIdent( i ) ) );
+		main->addStmt( context.makeAccess( context.makeIdent( j ) ) );
+		auto result = context.submit( std::move( main ) );
+		// Only the value assigned in the non uniform branch is non uniform.
+		check( context.stats.added == 1u );
+		auto & resultMain = getMain( *result );
+		check( getIndex( resultMain, 4u ).isNonUniform() );
+		check( !getIndex( resultMain, 5u ).isNonUniform() );
+		testEnd();
+	}
+
+	void testSubgroup( test::TestCounts & testCounts )
+	{
+		testBegin( "testSubgroup" );
+		Context context{ testCounts };
+		// samplers[subgroupBroadcastFirst( input )]; samplers[subgroupBroadcastFirst( uniform )];
+		auto main = context.makeMain();
+		main->addStmt( context.makeAccess( ast::expr::makeSubgroupBroadcastFirst1I( context.exprCache, context.typesCache, context.makeIdent( context.input ) ) ) );
+		main->addStmt( context.makeAccess( ast::expr::makeSubgroupBroadcastFirst1I( context.exprCache, context.typesCache, context.makeIdent( context.uniform ) ) ) );
+		auto result = context.submit( std::move( main ) );
+		// A value uniform per subgroup is not dynamically uniform.
+		check( context.stats.added == 1u );
+		auto & resultMain = getMain( *result );
+		check( getIndex( resultMain, 0u ).isNonUniform() );
+		check( !getIndex( resultMain, 1u ).isNonUniform() );
+		testEnd();
+	}
+}
+
+testSuiteMain( TestASTPlaceNonUniform )
+{
+	testSuiteBegin();
+	testInputs( testCounts );
+	testUnnecessary( testCounts );
+	testControlFlow( testCounts );
+	testSubgroup( testCounts );
+	testSuiteEnd();
+}
+
+testSuiteLaunch( TestASTPlaceNonUniform )
@@ -0,0 +1,178 @@
+#include "Common.hpp"
+
+#include <ShaderAST/Visitors/PropagateConstants.hpp>
+
+#pragma clang diagnostic ignored "-Wunused-member-function"
+#pragma warning( disable:5245 )
+
+namespace
+{
+	struct Context
+		: test::ASTContext
+	{
+		explicit Context( test::TestCounts & testCounts )
+			: test::ASTContext{ testCounts }
+			, x{ makeLocale( "x" ) }
+			, y{ makeLocale( "y" ) }
+			, global{ makeVariable( "global", typesCache.getInt32(), 0u ) }
+		{
+		}
+
+		ast::var::VariablePtr makeLocale( std::string name )
+		{
+			return makeVariable( std::move( name ), typesCache.getInt32() );
+		}
+
+		// global = var
+		ast::stmt::SimplePtr makeUse( ast::var::VariablePtr var )
+		{
+			return makeAssign( global, makeIdent( var ) );
+		}
+
+		ast::stmt::ContainerPtr submit( ast::stmt::FunctionDeclPtr main )
+		{
+			auto container = stmtCache.makeContainer();
+			container->addStmt( std::move( main ) );
+			stats = {};
+			return ast::propagateConstants( stmtCache, exprCache, *container, stats );
+		}
+
+		ast::var::VariablePtr x;
+		ast::var::VariablePtr y;
+		ast::var::VariablePtr global;
+		ast::ConstantPropagationStats stats;
+	};
+
+	ast::stmt::FunctionDecl const & getMain( ast::stmt::Container const & container )
+	{
+		return static_cast< ast::stmt::FunctionDecl const & >( **container.begin() );
+	}
+
+	ast::stmt::Stmt const & getStmt( ast::stmt::Container const & container
+		, size_t index )
+	{
+		return **std::next( container.begin(), ptrdiff_t( index ) );
+	}
+
+	// The value assigned to global by the statement at the given index.
+	ast::expr::Expr const & getUsed( ast::stmt::Container const & container
+		, size_t index )
+	{
+		auto & stmt = static_cast< ast::stmt::Simple const & >( getStmt( container, index ) );
+		return *static_cast< ast::expr::Assign const & >( *stmt.getExpr() ).getRHS();
+	}
+
+	bool isValue( ast::expr::Expr const & expr
+		, int value )
+	{
+		return expr.getKind() == ast::expr::Kind::eLiteral
+			&& static_cast< ast::expr::Literal const & >( expr ).getValue< ast::expr::LiteralType::eInt32 >() == value;
+	}
+
+	void testPropagation( test::TestCounts & testCounts )
+	{
+		testBegin( "testPropagation" );
+		Context context{ testCounts };
+		// int x = 2; int y = x * 3; global = y; x = 5; global = x;
+		auto main = context.makeMain();
+		main->addStmt( context.makeInit( context.x, context.makeLiteral( 2 ) ) );
+		main->addStmt( context.makeInit( context.y
+			, context.exprCache.makeTimes( context.typesCache.getInt32(), context.makeIdent( context.x ), context.makeLiteral( 3 ) ) ) );
+		main->addStmt( context.makeUse( context.y ) );
+		main->addStmt( context.makeAssign( context.x, context.makeLiteral( 5 ) ) );
+		main->addStmt( context.makeUse( context.x ) );
+		auto result = context.submit( std::move( main ) );
+		check( context.stats.values == 3u );
+		// The value of y is folded, and the reassigned x is followed.
+		auto & resultMain = getMain( *result );
+		require( resultMain.size() == 5u );
+		check( isValue( getUsed( resultMain, 2u ), 6 ) );
+		check( isValue( getUsed( resultMain, 4u ), 5 ) );
+		testEnd();
+	}
+
+	void testBranches( test::TestCounts & testCounts )
+	{
+		testBegin( "testBranches" );
+		Context context{ testCounts };
+		// int x = 1; if ( x == 1 ) { global = 2; } else { global = 3; }
+		auto main = context.makeMain();
+		main->addStmt( context.makeInit( context.x, context.makeLiteral( 1 ) ) );
+		auto ifStmt = context.stmtCache.makeIf( context.exprCache.makeEqual( context.typesCache, context.makeIdent( context.x ), context.makeLiteral( 1 ) ) );
+		ifStmt->addStmt( context.makeAssign( context.global, context.makeLiteral( 2 ) ) );
+		ifStmt->createElse()->addStmt( context.makeAssign( context.global, context.makeLiteral( 3 ) ) );
+		main->addStmt( std::move( ifStmt ) );
+		auto result = context.submit( std::move( main ) );
+		check( context.stats.branches == 1u );
+		// Only the taken branch remains.
+		auto & resultMain = getMain( *result );
+		require( resultMain.size() == 2u );
+		auto & compound = static_cast< ast::stmt::Compound const & >( getStmt( resultMain, 1u ) );
+		require( compound.getKind() == ast::stmt::Kind::eCompound );
+		require( compound.size() == 1u );
+		check( isValue( getUsed( compound, 0u ), 2 ) );
+		testEnd();
+	}
+
+	void testMerge( test::TestCounts & testCounts )
+	{
+		testBegin( "testMerge" );
+		Context context{ testCounts };
+		// int x = 1; int y = 1; if ( global ) { x = 2; y = 1; } global = x; global = y;
+		auto main = context.makeMain();
+		main->addStmt( context.makeInit( context.x, context.makeLiteral( 1 ) ) );
+		main->addStmt( context.makeInit( context.y, context.makeLiteral( 1 ) ) );
+		auto ifStmt = context.stmtCache.makeIf( context.exprCache.makeNotEqual( context.typesCache, context.makeIdent( context.global ), context.makeLiteral( 0 ) ) );
+		ifStmt->addStmt( context.makeAssign( context.x, context.makeLiteral( 2 ) ) );
+		ifStmt->addStmt( context.makeAssign( context.y, context.makeLiteral( 1 ) ) );
+		main->addStmt( std::move( ifStmt ) );
+		main->addStmt( context.makeUse( context.x ) );
+		main->addStmt( context.makeUse( context.y ) );
+		auto result = context.submit( std::move( main ) );
+		check( context.stats.branches == 0u );
+		// x differs between the branches, y doesn't.
+		auto & resultMain = getMain( *result );
+		require( resultMain.size() == 5u );
+		check( getUsed( resultMain, 3u ).getKind() == ast::expr::Kind::eIdentifier );
+		check( isValue( getUsed( resultMain, 4u ), 1 ) );
+		testEnd();
+	}
+
+	void testLoop( test::TestCounts & testCounts )
+	{
+		testBegin( "testLoop" );
+		Context context{ testCounts };
+		// int x = 0; int y = 4; while ( x < global ) { global = y; x = x + 1; } global = x;
+		auto main = context.makeMain();
+		main->addStmt( context.makeInit( context.x, context.makeLiteral( 0 ) ) );
+		main->addStmt( context.makeInit( context.y, context.makeLiteral( 4 ) ) );
+		auto loop = context.stmtCache.makeWhile( context.exprCache.makeLess( context.typesCache, context.makeIdent( context.x ), context.makeIdent( context.global ) ) );
+		loop->addStmt( context.makeUse( context.y ) );
+		loop->addStmt( context.makeAssign( context.x
+			, context.exprCache.makeAdd( context.typesCache.getInt32(), context.makeIdent( context.x ), context.makeLiteral( 1 ) ) ) );
+		main->addStmt( std::move( loop ) );
+		main->addStmt( context.makeUse( context.x ) );
+		auto result = context.submit( std::move( main ) );
+		// x is written in the loop, y isn't.
+		auto & resultMain = getMain( *result );
+		require( resultMain.size() == 4u );
+		auto & resultLoop = static_cast< ast::stmt::While const & >( getStmt( resultMain, 2u ) );
+		auto & ctrl = static_cast< ast::expr::Less const & >( *resultLoop.getCtrlExpr() );
+		check( ctrl.getLHS()->getKind() == ast::expr::Kind::eIdentifier );
+		check( isValue( getUsed( resultLoop, 0u ), 4 ) );
+		check( getUsed( resultMain, 3u ).getKind() == ast::expr::Kind::eIdentifier );
+		testEnd();
+	}
+}
+
+testSuiteMain( TestASTPropagateConstants )
+{
+	testSuiteBegin();
+	testPropagation( testCounts );
+	testBranches( testCounts );
+	testMerge( testCounts );
+	testLoop( testCounts );
+	testSuiteEnd();
+}
+
+testSuiteLaunch( TestASTPropagateConstants )
@@ -0,0 +1,252 @@
+#include "Common.hpp"
+
+#include <ShaderAST/Visitors/ReduceStrength.hpp>
+
+#pragma clang diagnostic ignored "-Wunused-member-function"
+#pragma warning( disable:5245 )
+
+namespace
+{
+	struct Context
+		: test::ASTContext
+	{
+		explicit Context( test::TestCounts & testCounts )
+			: test::ASTContext{ testCounts }
+		{
+		}
+
+		ast::expr::IdentifierPtr makeIdent( ast::type::TypePtr type
+			, std::string name )
+		{
+			return test::ASTContext::makeIdent( makeVariable( std::move( name ), type ) );
+		}
+
+		ast::expr::ExprPtr submit( ast::expr::ExprPtr expr
+			, ast::StrengthReductionMode mode = ast::StrengthReductionMode::eExact )
+		{
+			stats = {};
+			return ast::reduceStrength( exprCache, typesCache, *expr, mode, stats );
+		}
+
+		ast::expr::ExprPtr makeIntrinsic( ast::type::TypePtr type
+			, ast::expr::Intrinsic intrinsic
+			, ast::expr::ExprPtr arg )
+		{
+			ast::expr::ExprList args;
+			args.emplace_back( std::move( arg ) );
+			return exprCache.makeIntrinsicCall( type, intrinsic, std::move( args ) );
+		}
+
+		ast::StrengthReductionStats stats;
+	};
+
+	template< ast::expr::LiteralType TypeT >
+	bool isValue( ast::expr::Expr const & expr
+		, typename ast::expr::LiteralValueTraits< TypeT >::type value )
+	{
+		return expr.getKind() == ast::expr::Kind::eLiteral
+			&& static_cast< ast::expr::Literal const & >( expr ).getLiteralType() == TypeT
+			&& static_cast< ast::expr::Literal const & >( expr ).getValue< TypeT >() == value;
+	}
+
+	void testPow( test::TestCounts & testCounts )
+	{
+		testBegin( "testPow" );
+		Context context{ testCounts };
+		auto makePow = [&context]( ast::expr::ExprPtr x, float y )
+		{
+			ast::expr::ExprList args;
+			args.emplace_back( std::move( x ) );
+			args.emplace_back( context.exprCache.makeLiteral( context.typesCache, y ) );
+			return context.exprCache.makeIntrinsicCall( context.typesCache.getFloat(), ast::expr::Intrinsic::ePow1, std::move( args ) );
+		};
+		// pow( x, 2.0 ) => x * x
+		auto result = context.submit( makePow( context.makeIdent( context.typesCache.getFloat(), "x" ), 2.0f ) );
+		check( context.stats.rewrites == 1u );
+		require( result->getKind() == ast::expr::Kind::eTimes );
+		auto & times = static_cast< ast::expr::Times const & >( *result );
+		check( times.getLHS()->getKind() == ast::expr::Kind::eIdentifier );
+		check( times.getRHS()->getKind() == ast::expr::Kind::eIdentifier );
+		// pow( x, 3.0 ) is kept.
+		result = context.submit( makePow( context.makeIdent( context.typesCache.getFloat(), "x" ), 3.0f ) );
+		check( context.stats.rewrites == 0u );
+		check( result->getKind() == ast::expr::Kind::eIntrinsicCall );
+		// pow( x + y, 2.0 ) is kept, x + y would be computed twice.
+		result = context.submit( makePow( context.exprCache.makeAdd( context.typesCache.getFloat()
+				, context.makeIdent( context.typesCache.getFloat(), "x" )
+				, context.makeIdent( context.typesCache.getFloat(), "y" ) )
+			, 2.0f ) );
+		check( context.stats.rewrites == 0u );
+		testEnd();
+	}
+
+	void testFloatDivide( test::TestCounts & testCounts )
+	{
+		testBegin( "testFloatDivide" );
+		Context context{ testCounts };
+		auto makeDivide = [&context]( float value )
+		{
+			return context.exprCache.makeDivide( context.typesCache.getFloat()
+				, context.makeIdent( context.typesCache.getFloat(), "x" )
+				, context.exprCache.makeLiteral( context.typesCache, value ) );
+		};
+		// x / 4.0 => x * 0.25, in both modes.
+		auto result = context.submit( makeDivide( 4.0f ) );
+		check( context.stats.rewrites == 1u );
+		require( result->getKind() == ast::expr::Kind::eTimes );
+		check( isValue< ast::expr::LiteralType::eFloat >( *static_cast< ast::expr::Times const & >( *result ).getRHS(), 0.25f ) );
+		// x / 3.0 has no exact reciprocal.
+		result = context.submit( makeDivide( 3.0f ) );
+		check( context.stats.rewrites == 0u );
+		check( result->getKind() == ast::expr::Kind::eDivide );
+		result = context.submit( makeDivide( 3.0f ), ast::StrengthReductionMode::eFastMath );
+		check( context.stats.rewrites == 1u );
+		check( result->getKind() == ast::expr::Kind::eTimes );
+		// Division by zero is kept.
+		result = context.submit( makeDivide( 0.0f ), ast::StrengthReductionMode::eFastMath );
+		check( context.stats.rewrites == 0u );
+		testEnd();
+	}
+
+	void testShifts( test::TestCounts & testCounts )
+	{
+		testBegin( "testShifts" );
+		Context context{ testCounts };
+		// i * 8 => i << 3
+		auto result = context.submit( context.exprCache.makeTimes( context.typesCache.getInt32()
+			, context.makeIdent( context.typesCache.getInt32(), "i" )
+			, context.exprCache.makeLiteral( context.typesCache, 8 ) ) );
+		check( context.stats.rewrites == 1u );
+		require( result->getKind() == ast::expr::Kind::eLShift );
+		check( isValue< ast::expr::LiteralType::eInt32 >( *static_cast< ast::expr::LShift const & >( *result ).getRHS(), 3 ) );
+		// 4u * u => u << 2u
+		result = context.submit( context.exprCache.makeTimes( context.typesCache.getUInt32()
+			, context.exprCache.makeLiteral( context.typesCache, 4u )
+			, context.makeIdent( context.typesCache.getUInt32(), "u" ) ) );
+		require( result->getKind() == ast::expr::Kind::eLShift );
+		check( isValue< ast::expr::LiteralType::eUInt32 >( *static_cast< ast::expr::LShift const & >( *result ).getRHS(), 2u ) );
+		// u / 16u => u >> 4u
+		result = context.submit( context.exprCache.makeDivide( context.typesCache.getUInt32()
+			, context.makeIdent( context.typesCache.getUInt32(), "u" )
+			, context.exprCache.makeLiteral( context.typesCache, 16u ) ) );
+		require( result->getKind() == ast::expr::Kind::eRShift );
+		check( isValue< ast::expr::LiteralType::eUInt32 >( *static_cast< ast::expr::RShift const & >( *result ).getRHS(), 4u ) );
+		// i / 16 is kept, the signed division rounds towards zero.
+		result = context.submit( context.exprCache.makeDivide( context.typesCache.getInt32()
+			, context.makeIdent( context.typesCache.getInt32(), "i" )
+			, context.exprCache.makeLiteral( context.typesCache, 16 ) ) );
+		check( context.stats.rewrites == 0u );
+		check( result->getKind() == ast::expr::Kind::eDivide );
+		// i * 6 is kept.
+		result = context.submit( context.exprCache.makeTimes( context.typesCache.getInt32()
+			, context.makeIdent( context.typesCache.getInt32(), "i" )
+			, context.exprCache.makeLiteral( context.typesCache, 6 ) ) );
+		check( context.stats.rewrites == 0u );
+		testEnd();
+	}
+
+	void testIdentities( test::TestCounts & testCounts )
+	{
+		testBegin( "testIdentities" );
+		Context context{ testCounts };
+		// x * 1.0 => x
+		auto result = context.submit( context.exprCache.makeTimes( context.typesCache.getFloat()
+			, context.makeIdent( context.typesCache.getFloat(), "x" )
+			, context.exprCache.makeLiteral( context.typesCache, 1.0f ) ) );
+		check( context.stats.rewrites == 1u );
+		check( result->getKind() == ast::expr::Kind::eIdentifier );
+		// 0 + i => i
+		result = context.submit( context.exprCache.makeAdd( context.typesCache.getInt32()
+			, context.exprCache.makeLiteral( context.typesCache, 0 )
+			, context.makeIdent( context.typesCache.getInt32(), "i" ) ) );
+		check( context.stats.rewrites == 1u );
+		check( result->getKind() == ast::expr::Kind::eIdentifier );
+		// x + 0.0 changes -0.0 into 0.0, only in fast math mode.
+		result = context.submit( context.exprCache.makeAdd( context.typesCache.getFloat()
+			, context.makeIdent( context.typesCache.getFloat(), "x" )
+			, context.exprCache.makeLiteral( context.typesCache, 0.0f ) ) );
+		check( context.stats.rewrites == 0u );
+		check( result->getKind() == ast::expr::Kind::eAdd );
+		result = context.submit( std::move( result ), ast::StrengthReductionMode::eFastMath );
+		check( context.stats.rewrites == 1u );
+		check( result->getKind() == ast::expr::Kind::eIdentifier );
+		// x - 0.0 => x
+		result = context.submit( context.exprCache.makeMinus( context.typesCache.getFloat()
+			, context.makeIdent( context.typesCache.getFloat(), "x" )
+			, context.exprCache.makeLiteral( context.typesCache, 0.0f ) ) );
+		check( context.stats.rewrites == 1u );
+		check( result->getKind() == ast::expr::Kind::eIdentifier );
+		// x * 1.0, with x a float and the result a vec3, is kept.
+		result = context.submit( context.exprCache.makeTimes( context.typesCache.getVec3F()
+			, context.makeIdent( context.typesCache.getFloat(), "x" )
+			, context.exprCache.makeCompositeConstruct( ast::expr::CompositeType::eVec3
+				, ast::type::Kind::eFloat
+				, [&context]()
+				{
+					ast::expr::ExprList args;
+					args.emplace_back( context.exprCache.makeLiteral( context.typesCache, 1.0f ) );
+					args.emplace_back( context.exprCache.makeLiteral( context.typesCache, 1.0f ) );
+					args.emplace_back( context.exprCache.makeLiteral( context.typesCache, 1.0f ) );
+					return args;
+				}() ) ) );
+		check( context.stats.rewrites == 0u );
+		testEnd();
+	}
+
+	void testTranspose( test::TestCounts & testCounts )
+	{
+		testBegin( "testTranspose" );
+		Context context{ testCounts };
+		// transpose( transpose( m ) ) => m
+		auto mat3x2 = context.typesCache.getMat3x2F();
+		auto mat2x3 = context.typesCache.getMat2x3F();
+		auto result = context.submit( context.makeIntrinsic( mat3x2
+			, ast::expr::Intrinsic::eTranspose2x3F
+			, context.makeIntrinsic( mat2x3
+				, ast::expr::Intrinsic::eTranspose3x2F
+				, context.makeIdent( mat3x2, "m" ) ) ) );
+		check( context.stats.rewrites == 1u );
+		require( result->getKind() == ast::expr::Kind::eIdentifier );
+		check( result->getType() == mat3x2 );
+		testEnd();
+	}
+
+	void testNormalize( test::TestCounts & testCounts )
+	{
+		testBegin( "testNormalize" );
+		Context context{ testCounts };
+		auto vec3 = context.typesCache.getVec3F();
+		auto makeNormalize = [&context, vec3]()
+		{
+			return context.makeIntrinsic( vec3
+				, ast::expr::Intrinsic::eNormalize3F
+				, context.makeIntrinsic( vec3
+					, ast::expr::Intrinsic::eNormalize3F
+					, context.makeIdent( vec3, "v" ) ) );
+		};
+		// The rounding can differ, only in fast math mode.
+		auto result = context.submit( makeNormalize() );
+		check( context.stats.rewrites == 0u );
+		// normalize( normalize( v ) ) => normalize( v )
+		result = context.submit( makeNormalize(), ast::StrengthReductionMode::eFastMath );
+		check( context.stats.rewrites == 1u );
+		require( result->getKind() == ast::expr::Kind::eIntrinsicCall );
+		auto & call = static_cast< ast::expr::IntrinsicCall const & >( *result );
+		check( call.getArgList().front()->getKind() == ast::expr::Kind::eIdentifier );
+		testEnd();
+	}
+}
+
+testSuiteMain( TestASTReduceStrength )
+{
+	testSuiteBegin();
+	testPow( testCounts );
+	testFloatDivide( testCounts );
+	testShifts( testCounts );
+	testIdentities( testCounts );
+	testTranspose( testCounts );
+	testNormalize( testCounts );
+	testSuiteEnd();
+}
+
+testSuiteLaunch( TestASTReduceStrength )
@@ -0,0 +1,185 @@
+#include "Common.hpp"
+
+#include <ShaderAST/Expr/MakeIntrinsic.hpp>
+#include <ShaderAST/Visitors/RelaxPrecision.hpp>
+
+#pragma clang diagnostic ignored "-Wunused-member-function"
+#pragma warning( disable:5245 )
+
+namespace
+{
+	struct Context
+		: test::ASTContext
+	{
+		explicit Context( test::TestCounts & testCounts )
+			: test::ASTContext{ testCounts }
+			, input{ makeVariable( "input", typesCache.getFloat(), uint64_t( ast::var::Flag::eUniform ) ) }
+			, normal{ makeVariable( "normal", typesCache.getVec3F(), uint64_t( ast::var::Flag::eUniform ) ) }
+		{
+		}
+
+		ast::var::VariablePtr makeLocale( std::string name
+			, uint32_t count = 1u )
+		{
+			return makeVariable( std::move( name )
+				, ( count == 1u
+					? typesCache.getFloat()
+					: typesCache.getVector( ast::type::Kind::eFloat, count ) ) );
+		}
+
+		ast::expr::ExprPtr makeTimes( ast::expr::ExprPtr lhs
+			, ast::expr::ExprPtr rhs )
+		{
+			auto type = lhs->getType();
+			return exprCache.makeTimes( type, std::move( lhs ), std::move( rhs ) );
+		}
+
+		// clamp( input, 0.0, max )
+		ast::expr::ExprPtr makeClamp( float max )
+		{
+			return ast::expr::makeClamp1F( exprCache, typesCache, makeIdent( input ), makeLiteral( 0.0f ), makeLiteral( max ) );
+		}
+
+		ast::stmt::ContainerPtr submit( ast::stmt::FunctionDeclPtr main
+			, float maxMagnitude = 2.0f )
+		{
+			auto container = stmtCache.makeContainer();
+			container->addStmt( std::move( main ) );
+			stats = {};
+			return ast::relaxPrecision( stmtCache, exprCache, typesCache, *container, maxMagnitude, stats );
+		}
+
+		ast::var::VariablePtr input;
+		ast::var::VariablePtr normal;
+		ast::RelaxedPrecisionStats stats;
+	};
+
+	ast::stmt::FunctionDecl const & getMain( ast::stmt::Container const & container )
+	{
+		return static_cast< ast::stmt::FunctionDecl const & >( **container.begin() );
+	}
+
+	ast::var::Variable const & getVariable( ast::stmt::Container const & container
+		, size_t index )
+	{
+		auto & stmt = static_cast< ast::stmt::Simple const & >( **std::next( container.begin(), ptrdiff_t( index ) ) );
+		auto & expr = *stmt.getExpr();
+
+		if ( expr.getKind() == ast::expr::Kind::eInit )
+		{
+			return *static_cast< ast::expr::Init const & >( expr ).getIdentifier().getVariable();
+		}
+
+		return *static_cast< ast::expr::Identifier const & >( *static_cast< ast::expr::Assign const & >( expr ).getLHS() ).getVariable();
+	}
+
+	void testBoundedValues( test::TestCounts & testCounts )
+	{
+		testBegin( "testBoundedValues" );
+		Context context{ testCounts };
+		// vec3 n = normalize( normal ); float c = clamp( input, 0.0, 1.0 ) * 0.5; float h = ( c + n.x ) * 0.5; float x = input * 0.5;
+		auto n = context.makeLocale( "n", 3u );
+		auto c = context.makeLocale( "c" );
+		auto h = context.makeLocale( "h" );
+		auto x = context.makeLocale( "x" );
+		auto main = context.makeMain();
+		main->addStmt( context.makeInit( n, ast::expr::makeNormalize3F( context.exprCache, context.typesCache, context.makeIdent( context.normal ) ) ) );
+		main->addStmt( context.makeInit( c, context.makeTimes( context.makeClamp( 1.0f ), context.makeLiteral( 0.5f ) ) ) );
+		main->addStmt( context.makeInit( h
+			, context.makeTimes( context.exprCache.makeAdd( context.typesCache.getFloat()
+					, context.makeIdent( c )
+					, context.exprCache.makeSwizzle( context.makeIdent( n ), ast::expr::SwizzleKind::fromOffset( 0u ) ) )
+				, context.makeLiteral( 0.5f ) ) ) );
+		main->addStmt( context.makeInit( x, context.makeTimes( context.makeIdent( context.input ), context.makeLiteral( 0.5f ) ) ) );
+		auto result = context.submit( std::move( main ) );
+		check( context.stats.variables == 3u );
+		auto & resultMain = getMain( *result );
+		check( getVariable( resultMain, 0u ).isRelaxedPrecision() );
+		check( getVariable( resultMain, 1u ).isRelaxedPrecision() );
+		check( getVariable( resultMain, 2u ).isRelaxedPrecision() );
+		check( !getVariable( resultMain, 3u ).isRelaxedPrecision() );
+		// The source variables are left untouched.
+		check( !n->isRelaxedPrecision() );
+		testEnd();
+	}
+
+	void testExclusions( test::TestCounts & testCounts )
+	{
+		testBegin( "testExclusions" );
+		Context context{ testCounts };
+		// float a = fract( input ); float b = a * 0.5; int i = int( b ); float p = fract( input ); gl_Position.x = p;
+		auto a = context.makeLocale( "a" );
+		auto b = context.makeLocale( "b" );
+		auto i = ast::var::makeVariable( ++context.counts.nextVarId, context.typesCache.getInt32(), "i", uint64_t( ast::var::Flag::eLocale ) );
+		auto p = context.makeLocale( "p" );
+		auto position = ast::var::makeBuiltin( ++context.counts.nextVarId, ast::Builtin::ePosition, context.typesCache.getVec4F(), ast::var::Flag::eShaderOutput );
+		auto main = context.makeMain();
+		main->addStmt( context.makeInit( a, ast::expr::makeFract1F( context.exprCache, context.typesCache, context.makeIdent( context.input ) ) ) );
+		main->addStmt( context.makeInit( b, context.makeTimes( context.makeIdent( a ), context.makeLiteral( 0.5f ) ) ) );
+		main->addStmt( context.makeInit( i, context.exprCache.makeCast( context.typesCache.getInt32(), context.makeIdent( b ) ) ) );
+		main->addStmt( context.makeInit( p, ast::expr::makeFract1F( context.exprCache, context.typesCache, context.makeIdent( context.input ) ) ) );
+		main->addStmt( context.stmtCache.makeSimple( context.exprCache.makeAssign( context.typesCache.getFloat()
+			, context.exprCache.makeSwizzle( context.makeIdent( position ), ast::expr::SwizzleKind::fromOffset( 0u ) )
+			, context.makeIdent( p ) ) ) );
+		auto result = context.submit( std::move( main ) );
+		// The converted value, the value it is computed from, and the builtin output value keep their precision.
+		check( context.stats.variables == 0u );
+		auto & resultMain = getMain( *result );
+		check( !getVariable( resultMain, 0u ).isRelaxedPrecision() );
+		check( !getVariable( resultMain, 3u ).isRelaxedPrecision() );
+		testEnd();
+	}
+
+	void testAccumulation( test::TestCounts & testCounts )
+	{
+		testBegin( "testAccumulation" );
+		Context context{ testCounts };
+		// float s = 0.0; s = s + 0.5; float u; float w = u * 0.5; with u marked by the user.
+		auto s = context.makeLocale( "s" );
+		auto u = context.makeLocale( "u" );
+		u->updateFlag( ast::var::Flag::eRelaxedPrecision );
+		auto w = context.makeLocale( "w" );
+		auto main = context.makeMain();
+		main->addStmt( context.makeInit( s, context.makeLiteral( 0.0f ) ) );
+		main->addStmt( context.makeAssign( s, context.exprCache.makeAdd( context.typesCache.getFloat(), context.makeIdent( s ), context.makeLiteral( 0.5f ) ) ) );
+		main->addStmt( context.stmtCache.makeVariableDecl( u ) );
+		main->addStmt( context.makeInit( w, context.makeTimes( context.makeIdent( u ), context.makeLiteral( 0.5f ) ) ) );
+		auto result = context.submit( std::move( main ) );
+		// The accumulated value is not bounded, the user marked value is trusted.
+		check( context.stats.variables == 1u );
+		auto & resultMain = getMain( *result );
+		check( !getVariable( resultMain, 0u ).isRelaxedPrecision() );
+		check( !getVariable( resultMain, 1u ).isRelaxedPrecision() );
+		check( getVariable( resultMain, 3u ).isRelaxedPrecision() );
+		testEnd();
+	}
+
+	void testMagnitude( test::TestCounts & testCounts )
+	{
+		testBegin( "testMagnitude" );
+		Context context{ testCounts };
+		// float c = clamp( input, 0.0, 4.0 );
+		auto main = context.makeMain();
+		main->addStmt( context.makeInit( context.makeLocale( "c" ), context.makeClamp( 4.0f ) ) );
+		auto result = context.submit( std::move( main ) );
+		check( context.stats.variables == 0u );
+
+		main = context.makeMain();
+		main->addStmt( context.makeInit( context.makeLocale( "c" ), context.makeClamp( 4.0f ) ) );
+		result = context.submit( std::move( main ), 8.0f );
+		check( context.stats.variables == 1u );
+		testEnd();
+	}
+}
+
+testSuiteMain( TestASTRelaxPrecision )
+{
+	testSuiteBegin();
+	testBoundedValues( testCounts );
+	testExclusions( testCounts );
+	testAccumulation( testCounts );
+	testMagnitude( testCounts );
+	testSuiteEnd();
+}
+
+testSuiteLaunch( TestASTRelaxPrecision )
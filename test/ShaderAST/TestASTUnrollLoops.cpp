@@ -0,0 +1,229 @@
+#include "Common.hpp"
+
+#include <ShaderAST/Visitors/UnrollLoops.hpp>
+
+#pragma clang diagnostic ignored "-Wunused-member-function"
+#pragma warning( disable:5245 )
+
+namespace
+{
+	struct Context
+		: test::ASTContext
+	{
+		explicit Context( test::TestCounts & testCounts )
+			: test::ASTContext{ testCounts }
+			, i{ makeLocale( "i", uint64_t( ast::var::Flag::eLocale ) | uint64_t( ast::var::Flag::eLoopVar ) ) }
+			, sum{ makeLocale( "sum" ) }
+		{
+		}
+
+		ast::var::VariablePtr makeLocale( std::string name
+			, uint64_t flags = uint64_t( ast::var::Flag::eLocale ) )
+		{
+			return makeVariable( std::move( name ), typesCache.getInt32(), flags );
+		}
+
+		ast::expr::ExprPtr makeCondition( int bound )
+		{
+			return exprCache.makeLess( typesCache, makeIdent( i ), makeLiteral( bound ) );
+		}
+
+		// sum = sum + i
+		ast::stmt::SimplePtr makeAccumulation()
+		{
+			return makeAssign( sum
+				, exprCache.makeAdd( typesCache.getInt32(), makeIdent( sum ), makeIdent( i ) ) );
+		}
+
+		// do { body; i = i + 1; } while ( i < bound );
+		ast::stmt::DoWhilePtr makeDoWhile( int bound
+			, ast::stmt::LoopHint hint
+			, std::vector< ast::stmt::StmtPtr > body )
+		{
+			auto result = stmtCache.makeDoWhile( makeCondition( bound ) );
+			result->setHint( hint );
+
+			for ( auto & stmt : body )
+			{
+				result->addStmt( std::move( stmt ) );
+			}
+
+			result->addStmt( makeAssign( i
+				, exprCache.makeAdd( typesCache.getInt32(), makeIdent( i ), makeLiteral( 1 ) ) ) );
+			return result;
+		}
+
+		// The shape SSA transformation gives to for ( int i = 0; i < bound; ++i ) { body }:
+		// { i = 0; if ( i < bound ) { do { body; i = i + 1; } while ( i < bound ); } }
+		ast::stmt::CompoundPtr makeLoop( int bound
+			, ast::stmt::LoopHint hint
+			, std::vector< ast::stmt::StmtPtr > body )
+		{
+			auto result = stmtCache.makeCompound();
+			result->addStmt( makeInit( i, makeLiteral( 0 ) ) );
+			auto ifStmt = stmtCache.makeIf( makeCondition( bound ) );
+			ifStmt->addStmt( makeDoWhile( bound, hint, std::move( body ) ) );
+			result->addStmt( std::move( ifStmt ) );
+			return result;
+		}
+
+		// { i = init; do { body; i = i + 1; } while ( i < bound ); }
+		ast::stmt::CompoundPtr makeDoWhileLoop( int init
+			, int bound
+			, ast::stmt::LoopHint hint
+			, std::vector< ast::stmt::StmtPtr > body )
+		{
+			auto result = stmtCache.makeCompound();
+			result->addStmt( makeInit( i, makeLiteral( init ) ) );
+			result->addStmt( makeDoWhile( bound, hint, std::move( body ) ) );
+			return result;
+		}
+
+		ast::stmt::ContainerPtr submit( ast::stmt::StmtPtr loop
+			, uint32_t budget )
+		{
+			auto container = stmtCache.makeContainer();
+			auto main = makeMain();
+			main->addStmt( makeInit( sum, makeLiteral( 0 ) ) );
+			main->addStmt( std::move( loop ) );
+			container->addStmt( std::move( main ) );
+			ast::SSAData ssaData{ counts.nextVarId, 0u };
+			stats = {};
+			auto result = ast::unrollLoops( stmtCache, exprCache, typesCache, *container, ssaData, budget, stats );
+			counts.nextVarId = ssaData.nextVarId;
+			return result;
+		}
+
+		ast::var::VariablePtr i;
+		ast::var::VariablePtr sum;
+		ast::UnrollStats stats;
+	};
+
+	std::vector< ast::stmt::StmtPtr > makeBody( ast::stmt::StmtPtr stmt )
+	{
+		std::vector< ast::stmt::StmtPtr > result;
+		result.emplace_back( std::move( stmt ) );
+		return result;
+	}
+
+	ast::stmt::Compound const & getLoop( ast::stmt::Container const & container )
+	{
+		auto & main = static_cast< ast::stmt::FunctionDecl const & >( **container.begin() );
+		return static_cast< ast::stmt::Compound const & >( **std::next( main.begin() ) );
+	}
+
+	void testUnroll( test::TestCounts & testCounts )
+	{
+		testBegin( "testUnroll" );
+		Context context{ testCounts };
+		auto result = context.submit( context.makeLoop( 3, ast::stmt::LoopHint::eNone, makeBody( context.makeAccumulation() ) ), 64u );
+		check( context.stats.loops == 1u );
+		check( context.stats.iterations == 3u );
+		// { i = 0; sum = sum + 0; sum = sum + 1; sum = sum + 2; i = 3; }
+		auto & loop = getLoop( *result );
+		require( loop.size() == 5u );
+		auto & copy = static_cast< ast::stmt::Simple const & >( **std::next( loop.begin(), 2 ) );
+		auto & assign = static_cast< ast::expr::Assign const & >( *copy.getExpr() );
+		auto & add = static_cast< ast::expr::Add const & >( *assign.getRHS() );
+		require( add.getRHS()->getKind() == ast::expr::Kind::eLiteral );
+		check( static_cast< ast::expr::Literal const & >( *add.getRHS() ).getValue< ast::expr::LiteralType::eInt32 >() == 1 );
+		auto & final = static_cast< ast::stmt::Simple const & >( *loop.back() );
+		auto & finalAssign = static_cast< ast::expr::Assign const & >( *final.getExpr() );
+		check( static_cast< ast::expr::Literal const & >( *finalAssign.getRHS() ).getValue< ast::expr::LiteralType::eInt32 >() == 3 );
+		testEnd();
+	}
+
+	void testLocals( test::TestCounts & testCounts )
+	{
+		testBegin( "testLocals" );
+		Context context{ testCounts };
+		// do { int v = i * 2; sum = sum + v; i = i + 1; }
+		auto v = context.makeLocale( "v" );
+		std::vector< ast::stmt::StmtPtr > body;
+		body.emplace_back( context.stmtCache.makeSimple( context.exprCache.makeInit( context.makeIdent( v )
+			, context.exprCache.makeTimes( context.typesCache.getInt32(), context.makeIdent( context.i ), context.makeLiteral( 2 ) ) ) ) );
+		body.emplace_back( context.stmtCache.makeSimple( context.exprCache.makeAssign( context.typesCache.getInt32()
+			, context.makeIdent( context.sum )
+			, context.exprCache.makeAdd( context.typesCache.getInt32(), context.makeIdent( context.sum ), context.makeIdent( v ) ) ) ) );
+		auto result = context.submit( context.makeLoop( 2, ast::stmt::LoopHint::eNone, std::move( body ) ), 64u );
+		check( context.stats.iterations == 2u );
+		// Each copy declares its own variable.
+		auto & loop = getLoop( *result );
+		require( loop.size() == 6u );
+		auto & first = static_cast< ast::expr::Init const & >( *static_cast< ast::stmt::Simple const & >( **std::next( loop.begin(), 1 ) ).getExpr() );
+		auto & second = static_cast< ast::expr::Init const & >( *static_cast< ast::stmt::Simple const & >( **std::next( loop.begin(), 3 ) ).getExpr() );
+		check( first.getIdentifier().getVariable()->getId() != v->getId() );
+		check( second.getIdentifier().getVariable()->getId() != v->getId() );
+		check( first.getIdentifier().getVariable()->getId() != second.getIdentifier().getVariable()->getId() );
+		testEnd();
+	}
+
+	void testBudget( test::TestCounts & testCounts )
+	{
+		testBegin( "testBudget" );
+		Context context{ testCounts };
+		// 16 iterations of 1 statement don't fit in a budget of 8.
+		context.submit( context.makeLoop( 16, ast::stmt::LoopHint::eNone, makeBody( context.makeAccumulation() ) ), 8u );
+		check( context.stats.loops == 0u );
+		// Unless the loop asks for it.
+		context.submit( context.makeLoop( 16, ast::stmt::LoopHint::eUnroll, makeBody( context.makeAccumulation() ) ), 8u );
+		check( context.stats.loops == 1u );
+		check( context.stats.iterations == 16u );
+		// And the loops asking not to be unrolled are kept.
+		context.submit( context.makeLoop( 2, ast::stmt::LoopHint::eDontUnroll, makeBody( context.makeAccumulation() ) ), 64u );
+		check( context.stats.loops == 0u );
+		testEnd();
+	}
+
+	void testDoWhile( test::TestCounts & testCounts )
+	{
+		testBegin( "testDoWhile" );
+		Context context{ testCounts };
+		auto result = context.submit( context.makeDoWhileLoop( 0, 3, ast::stmt::LoopHint::eNone, makeBody( context.makeAccumulation() ) ), 64u );
+		check( context.stats.loops == 1u );
+		check( context.stats.iterations == 3u );
+		// { i = 0; sum = sum + 0; sum = sum + 1; sum = sum + 2; i = 3; }
+		check( getLoop( *result ).size() == 5u );
+		// The first iteration doesn't pass the condition, it still runs once.
+		context.submit( context.makeDoWhileLoop( 4, 3, ast::stmt::LoopHint::eNone, makeBody( context.makeAccumulation() ) ), 64u );
+		check( context.stats.loops == 0u );
+		// The loops asking not to be unrolled are kept.
+		result = context.submit( context.makeDoWhileLoop( 0, 3, ast::stmt::LoopHint::eDontUnroll, makeBody( context.makeAccumulation() ) ), 64u );
+		check( context.stats.loops == 0u );
+		auto & loop = getLoop( *result );
+		require( loop.size() == 2u );
+		check( loop.back()->getKind() == ast::stmt::Kind::eDoWhile );
+		testEnd();
+	}
+
+	void testNotUnrolled( test::TestCounts & testCounts )
+	{
+		testBegin( "testNotUnrolled" );
+		Context context{ testCounts };
+		// The body breaks the loop.
+		context.submit( context.makeLoop( 2, ast::stmt::LoopHint::eNone, makeBody( context.stmtCache.makeBreak( false ) ) ), 64u );
+		check( context.stats.loops == 0u );
+		// The body writes the loop variable.
+		context.submit( context.makeLoop( 2
+				, ast::stmt::LoopHint::eNone
+				, makeBody( context.stmtCache.makeSimple( context.exprCache.makeAssign( context.typesCache.getInt32()
+					, context.makeIdent( context.i )
+					, context.makeLiteral( 0 ) ) ) ) )
+			, 64u );
+		check( context.stats.loops == 0u );
+		testEnd();
+	}
+}
+
+testSuiteMain( TestASTUnrollLoops )
+{
+	testSuiteBegin();
+	testUnroll( testCounts );
+	testLocals( testCounts );
+	testBudget( testCounts );
+	testDoWhile( testCounts );
+	testNotUnrolled( testCounts );
+	testSuiteEnd();
+}
+
+testSuiteLaunch( TestASTUnrollLoops )
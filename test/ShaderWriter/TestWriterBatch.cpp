@@ -0,0 +1,247 @@
+#include "Common.hpp"
+#include "WriterCommon.hpp"
+
+#if SDW_HasCompilerGlsl
+#	include <CompilerGlsl/compileGlsl.hpp>
+#endif
+#if SDW_HasCompilerHlsl
+#	include <CompilerHlsl/compileHlsl.hpp>
+#endif
+#if SDW_HasCompilerSpirV
+#	include <CompilerSpirV/compileSpirV.hpp>
+#endif
+
+#include <mutex>
+#include <thread>
+
+#pragma warning( disable:5245 )
+#pragma GCC diagnostic ignored "-Wunused-function"
+#pragma clang diagnostic ignored "-Wunused-member-function"
+
+namespace
+{
+	using ShaderList = std::vector< ast::Shader const * >;
+
+	struct BatchRecord
+	{
+		explicit BatchRecord( size_t count )
+			: calls( count )
+			, threads( count )
+		{
+		}
+
+		void record( size_t index )
+		{
+			std::lock_guard< std::mutex > lock{ mutex };
+			++calls[index];
+			threads[index] = std::this_thread::get_id();
+		}
+
+		std::mutex mutex;
+		std::vector< uint32_t > calls;
+		std::vector< std::thread::id > threads;
+	};
+
+	ast::ShaderPtr makeShader( test::sdw_test::TestCounts & testCounts
+		, int32_t count )
+	{
+		using namespace sdw;
+		sdw::ComputeWriter writer{ &testCounts.allocator };
+		writer.implementMainT< VoidT >( 16u, 16u, [&]( ComputeIn in )
+			{
+				auto sum = writer.declLocale( "sum", 0_i );
+
+				FOR( writer, Int, i, 0, i < count, ++i )
+				{
+					sum += i * writer.cast< Int >( in.localInvocationIndex );
+				}
+				ROF;
+			} );
+		return writer.getBuilder().releaseShader();
+	}
+
+	struct BatchShaders
+	{
+		explicit BatchShaders( test::sdw_test::TestCounts & testCounts )
+			: a{ makeShader( testCounts, 2 ) }
+			, b{ makeShader( testCounts, 4 ) }
+			, c{ makeShader( testCounts, 8 ) }
+			// Repeated shaders, to check that the items sharing a shader are grouped.
+			, items{ a.get(), b.get(), a.get(), c.get(), b.get(), a.get() }
+		{
+		}
+
+		ast::ShaderPtr a;
+		ast::ShaderPtr b;
+		ast::ShaderPtr c;
+		ShaderList items;
+	};
+
+	void checkRecord( BatchRecord const & record
+		, ShaderList const & items
+		, test::sdw_test::TestCounts & testCounts )
+	{
+		for ( size_t index = 0u; index < items.size(); ++index )
+		{
+			checkEqual( record.calls[index], 1u );
+
+			for ( size_t prev = 0u; prev < index; ++prev )
+			{
+				if ( items[prev] == items[index] )
+				{
+					check( record.threads[prev] == record.threads[index] );
+				}
+			}
+		}
+	}
+
+#if SDW_HasCompilerSpirV
+	void spirvBatch( test::sdw_test::TestCounts & testCounts )
+	{
+		testBegin( "spirvBatch" );
+		BatchShaders shaders{ testCounts };
+		auto const & items = shaders.items;
+		std::vector< std::vector< uint32_t > > expected;
+
+		for ( auto shader : items )
+		{
+			spirv::SpirVConfig config{};
+			expected.push_back( spirv::serialiseSpirv( *shader, config ) );
+		}
+
+		for ( auto concurrency : { 1u, 4u } )
+		{
+			std::vector< spirv::SpirVConfig > configs( items.size() );
+			BatchRecord record{ items.size() };
+			auto result = spirv::compileBatch( items
+				, configs
+				, ast::BatchConfig{ concurrency }
+				, [&record]( size_t index, std::vector< uint32_t > const & )
+				{
+					record.record( index );
+				} );
+			require( result.size() == expected.size() );
+
+			for ( size_t index = 0u; index < items.size(); ++index )
+			{
+				check( result[index] == expected[index] );
+			}
+
+			checkRecord( record, items, testCounts );
+		}
+
+		testEnd();
+	}
+#endif
+
+#if SDW_HasCompilerGlsl
+	void glslBatch( test::sdw_test::TestCounts & testCounts )
+	{
+		testBegin( "glslBatch" );
+		BatchShaders shaders{ testCounts };
+		auto const & items = shaders.items;
+		glsl::GlslConfig const baseConfig{ ast::ShaderStage::eCompute
+			, glsl::v4_6
+			, {}
+			, true
+			, false
+			, false
+			, true
+			, true
+			, true
+			, true };
+		std::vector< std::string > expected;
+
+		for ( auto shader : items )
+		{
+			auto config = baseConfig;
+			expected.push_back( glsl::compileGlsl( *shader
+				, ast::SpecialisationInfo{}
+				, config ) );
+		}
+
+		for ( auto concurrency : { 1u, 4u } )
+		{
+			std::vector< glsl::GlslConfig > configs( items.size(), baseConfig );
+			BatchRecord record{ items.size() };
+			auto result = glsl::compileBatch( items
+				, {}
+				, configs
+				, ast::BatchConfig{ concurrency }
+				, [&record]( size_t index, std::string const & )
+				{
+					record.record( index );
+				} );
+			require( result.size() == expected.size() );
+
+			for ( size_t index = 0u; index < items.size(); ++index )
+			{
+				checkEqual( result[index], expected[index] );
+			}
+
+			checkRecord( record, items, testCounts );
+		}
+
+		testEnd();
+	}
+#endif
+
+#if SDW_HasCompilerHlsl
+	void hlslBatch( test::sdw_test::TestCounts & testCounts )
+	{
+		testBegin( "hlslBatch" );
+		BatchShaders shaders{ testCounts };
+		auto const & items = shaders.items;
+		hlsl::HlslConfig const baseConfig{ hlsl::v6_6, ast::ShaderStage::eCompute };
+		std::vector< std::string > expected;
+
+		for ( auto shader : items )
+		{
+			expected.push_back( hlsl::compileHlsl( *shader
+				, ast::SpecialisationInfo{}
+				, baseConfig ) );
+		}
+
+		for ( auto concurrency : { 1u, 4u } )
+		{
+			std::vector< hlsl::HlslConfig > configs( items.size(), baseConfig );
+			BatchRecord record{ items.size() };
+			auto result = hlsl::compileBatch( items
+				, {}
+				, configs
+				, ast::BatchConfig{ concurrency }
+				, [&record]( size_t index, std::string const & )
+				{
+					record.record( index );
+				} );
+			require( result.size() == expected.size() );
+
+			for ( size_t index = 0u; index < items.size(); ++index )
+			{
+				checkEqual( result[index], expected[index] );
+			}
+
+			checkRecord( record, items, testCounts );
+		}
+
+		testEnd();
+	}
+#endif
+}
+
+sdwTestSuiteMain( TestWriterBatch )
+{
+	sdwTestSuiteBegin();
+#if SDW_HasCompilerSpirV
+	spirvBatch( testCounts );
+#endif
+#if SDW_HasCompilerGlsl
+	glslBatch( testCounts );
+#endif
+#if SDW_HasCompilerHlsl
+	hlslBatch( testCounts );
+#endif
+	sdwTestSuiteEnd();
+}
+
+sdwTestSuiteLaunch( TestWriterBatch )
@@ -0,0 +1,283 @@
+#include "Common.hpp"
+#include "WriterCommon.hpp"
+
+#include <ShaderWriter/CompositeTypes/ArrayStorageBuffer.hpp>
+
+#if SDW_HasCompilerGlsl
+#	include <CompilerGlsl/compileGlsl.hpp>
+#endif
+#if SDW_HasCompilerHlsl
+#	include <CompilerHlsl/compileHlsl.hpp>
+#endif
+#if SDW_HasCompilerSpirV
+#	include <CompilerSpirV/compileSpirV.hpp>
+#endif
+
+#pragma warning( disable:5245 )
+#pragma GCC diagnostic ignored "-Wunused-function"
+#pragma clang diagnostic ignored "-Wunused-member-function"
+
+namespace
+{
+	bool contains( std::string const & text
+		, std::string const & value )
+	{
+		return text.find( value ) != std::string::npos;
+	}
+
+	std::vector< std::string > findLines( std::string const & text
+		, std::string const & value )
+	{
+		std::vector< std::string > result;
+		std::stringstream stream{ text };
+		std::string line;
+
+		while ( std::getline( stream, line ) )
+		{
+			if ( contains( line, value ) )
+			{
+				result.push_back( line );
+			}
+		}
+
+		return result;
+	}
+
+#if SDW_HasCompilerGlsl
+	std::string writeGlsl( ast::Shader const & shader
+		, ast::ShaderStage stage
+		, ast::OptimisationConfig const & optimisations )
+	{
+		glsl::GlslConfig config{ stage
+			, glsl::v4_6
+			, {}
+			, true
+			, false
+			, false
+			, true
+			, true
+			, true
+			, true };
+		config.optimisations = optimisations;
+		return glsl::compileGlsl( shader
+			, ast::SpecialisationInfo{}
+			, config );
+	}
+#endif
+
+#if SDW_HasCompilerHlsl
+	std::string writeHlsl( ast::Shader const & shader
+		, ast::ShaderStage stage
+		, ast::OptimisationConfig const & optimisations )
+	{
+		hlsl::HlslConfig config{ hlsl::v6_6, stage };
+		config.optimisations = optimisations;
+		return hlsl::compileHlsl( shader
+			, ast::SpecialisationInfo{}
+			, config );
+	}
+#endif
+
+#if SDW_HasCompilerSpirV
+	std::string writeSpirV( ast::Shader const & shader
+		, ast::OptimisationConfig const & optimisations )
+	{
+		spirv::SpirVConfig config{};
+		config.debugLevel = spirv::DebugLevel::eNames;
+		config.optimisations = optimisations;
+		return spirv::writeSpirv( shader, config );
+	}
+#endif
+
+	// A buffer only read, and a buffer only written, with members and with a data array.
+	ast::ShaderPtr makeBufferShader( test::sdw_test::TestCounts & testCounts )
+	{
+		using namespace sdw;
+		sdw::ComputeWriter writer{ &testCounts.allocator };
+		sdw::StorageBuffer inputs{ writer, "Inputs", 0u, 0u };
+		auto value = inputs.declMember< Float >( "value" );
+		inputs.end();
+		sdw::StorageBuffer outputs{ writer, "Outputs", 1u, 0u };
+		auto result = outputs.declMember< Float >( "result" );
+		outputs.end();
+		ArrayStorageBufferT< Float > factors{ writer, "Factors", writer.getTypesCache().getFloat(), ast::type::MemoryLayout::eStd430, 2u, 0u, true };
+		writer.implementMainT< VoidT >( 1u, [&]( ComputeIn in )
+			{
+				result = value * factors[in.localInvocationIndex];
+			} );
+		return writer.getBuilder().releaseShader();
+	}
+
+	void bufferAccess( test::sdw_test::TestCounts & testCounts )
+	{
+		testBegin( "bufferAccess" );
+		auto shader = makeBufferShader( testCounts );
+		ast::OptimisationConfig optimisations{};
+		optimisations.inferBufferAccess = true;
+
+#if SDW_HasCompilerGlsl
+		{
+			auto glsl = writeGlsl( *shader, ast::ShaderStage::eCompute, optimisations );
+			check( contains( glsl, "readonly float value;" ) );
+			check( contains( glsl, "writeonly float result;" ) );
+			check( contains( glsl, "readonly float FactorsData[];" ) );
+			// Without the inference, the buffers keep their default access.
+			auto plain = writeGlsl( *shader, ast::ShaderStage::eCompute, ast::OptimisationConfig{} );
+			check( !contains( plain, "readonly" ) );
+			check( !contains( plain, "writeonly" ) );
+		}
+#endif
+#if SDW_HasCompilerSpirV
+		{
+			auto spirv = writeSpirV( *shader, optimisations );
+			// value and Factors are never written, result is never read.
+			checkEqual( findLines( spirv, "NonWritable" ).size(), 2u );
+			checkEqual( findLines( spirv, "NonReadable" ).size(), 1u );
+
+			for ( auto & line : findLines( spirv, "NonWritable" ) )
+			{
+				check( contains( line, "MemberDecorate" ) );
+			}
+
+			auto plain = writeSpirV( *shader, ast::OptimisationConfig{} );
+			check( !contains( plain, "NonWritable" ) );
+			check( !contains( plain, "NonReadable" ) );
+		}
+#endif
+#if SDW_HasCompilerHlsl
+		{
+			// The buffers never written are shader resource views, HLSL has no write only buffer.
+			auto hlsl = writeHlsl( *shader, ast::ShaderStage::eCompute, optimisations );
+			check( contains( hlsl, "\nStructuredBuffer<InputsBlock> Inputs: register(t0);" ) );
+			check( contains( hlsl, "\nRWStructuredBuffer<OutputsBlock> Outputs: register(u1);" ) );
+			check( contains( hlsl, "\nStructuredBuffer<float> FactorsData: register(t2);" ) );
+			auto plain = writeHlsl( *shader, ast::ShaderStage::eCompute, ast::OptimisationConfig{} );
+			check( contains( plain, "\nRWStructuredBuffer<InputsBlock> Inputs: register(u0);" ) );
+			check( contains( plain, "\nRWStructuredBuffer<float> FactorsData: register(u2);" ) );
+		}
+#endif
+		testEnd();
+	}
+
+	// Two colours computed the same way, only the first one is marked with relaxed precision.
+	ast::ShaderPtr makePrecisionShader( test::sdw_test::TestCounts & testCounts )
+	{
+		using namespace sdw;
+		sdw::ComputeWriter writer{ &testCounts.allocator };
+		sdw::StorageBuffer outputs{ writer, "Outputs", 0u, 0u };
+		auto result = outputs.declMember< Vec4 >( "result" );
+		outputs.end();
+		writer.implementMainT< VoidT >( 1u, [&]( ComputeIn in )
+			{
+				auto factor = writer.declLocale( "factor", writer.cast< Float >( in.localInvocationIndex ) );
+				auto relaxed = writer.declLocale( "relaxed", vec4( factor * 0.5_f ) );
+				writer.relaxPrecision( relaxed );
+				auto full = writer.declLocale( "full", vec4( factor * 0.25_f ) );
+				result = relaxed + full;
+			} );
+		return writer.getBuilder().releaseShader();
+	}
+
+	void relaxedPrecision( test::sdw_test::TestCounts & testCounts )
+	{
+		testBegin( "relaxedPrecision" );
+		auto shader = makePrecisionShader( testCounts );
+
+#if SDW_HasCompilerGlsl
+		{
+			auto glsl = writeGlsl( *shader, ast::ShaderStage::eCompute, ast::OptimisationConfig{} );
+			checkEqual( findLines( glsl, "mediump" ).size(), 1u );
+			check( contains( glsl, "mediump vec4 relaxed" ) );
+		}
+#endif
+#if SDW_HasCompilerSpirV
+		{
+			auto spirv = writeSpirV( *shader, ast::OptimisationConfig{} );
+			auto decorations = findLines( spirv, "RelaxedPrecision" );
+			auto names = findLines( spirv, "\"relaxed\"" );
+			require( decorations.size() == 1u );
+			require( names.size() == 1u );
+			// The decoration targets the relaxed variable.
+			auto id = names.front().substr( names.front().find( '%' ) );
+			id = id.substr( 0u, id.find( ' ' ) );
+			check( contains( decorations.front(), id + " RelaxedPrecision" ) );
+		}
+#endif
+		testEnd();
+	}
+
+	// Samples an array of textures, indexed by the invocation index (dynamically non uniform),
+	// or by a uniform buffer member (dynamically uniform).
+	ast::ShaderPtr makeDescriptorIndexShader( test::sdw_test::TestCounts & testCounts
+		, bool invocationIndex )
+	{
+		using namespace sdw;
+		sdw::ComputeWriter writer{ &testCounts.allocator };
+		sdw::UniformBuffer indices{ writer, "Indices", 0u, 0u };
+		auto uniformIndex = indices.declMember< UInt >( "index" );
+		indices.end();
+		auto textures = writer.declCombinedImgArray< FImg2DRgba32 >( "textures", 1u, 0u, 8u );
+		sdw::StorageBuffer outputs{ writer, "Outputs", 2u, 0u };
+		auto result = outputs.declMember< Vec4 >( "result" );
+		outputs.end();
+		writer.implementMainT< VoidT >( 1u, [&]( ComputeIn in )
+			{
+				if ( invocationIndex )
+				{
+					result = textures[in.localInvocationIndex].lod( vec2( 0.5_f ), 0.0_f );
+				}
+				else
+				{
+					result = textures[uniformIndex].lod( vec2( 0.5_f ), 0.0_f );
+				}
+			} );
+		return writer.getBuilder().releaseShader();
+	}
+
+	void nonUniformIndex( test::sdw_test::TestCounts & testCounts )
+	{
+		testBegin( "nonUniformIndex" );
+		ast::OptimisationConfig optimisations{};
+		optimisations.placeNonUniform = true;
+		auto dynamic = makeDescriptorIndexShader( testCounts, true );
+		auto uniform = makeDescriptorIndexShader( testCounts, false );
+
+#if SDW_HasCompilerGlsl
+		{
+			auto glsl = writeGlsl( *dynamic, ast::ShaderStage::eCompute, optimisations );
+			check( contains( glsl, "#extension GL_EXT_nonuniform_qualifier" ) );
+			check( contains( glsl, "textures[nonuniformEXT(" ) );
+			glsl = writeGlsl( *uniform, ast::ShaderStage::eCompute, optimisations );
+			check( !contains( glsl, "nonuniform" ) );
+		}
+#endif
+#if SDW_HasCompilerSpirV
+		{
+			auto spirv = writeSpirV( *dynamic, optimisations );
+			auto decorations = findLines( spirv, " NonUniform" );
+			check( !decorations.empty() );
+
+			for ( auto & line : decorations )
+			{
+				check( contains( line, "Decorate" ) );
+			}
+
+			check( contains( spirv, "ShaderNonUniform" ) );
+			spirv = writeSpirV( *uniform, optimisations );
+			check( !contains( spirv, "NonUniform" ) );
+		}
+#endif
+		testEnd();
+	}
+}
+
+sdwTestSuiteMain( TestWriterOptimisationFlags )
+{
+	sdwTestSuiteBegin();
+	bufferAccess( testCounts );
+	relaxedPrecision( testCounts );
+	nonUniformIndex( testCounts );
+	sdwTestSuiteEnd();
+}
+
+sdwTestSuiteLaunch( TestWriterOptimisationFlags )
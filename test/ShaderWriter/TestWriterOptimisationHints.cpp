@@ -0,0 +1,213 @@
+#include "Common.hpp"
+#include "WriterCommon.hpp"
+
+#include <ShaderAST/Stmt/StmtIf.hpp>
+#include <ShaderAST/Stmt/StmtLoop.hpp>
+
+#if SDW_HasCompilerSpirV
+#	include <CompilerSpirV/compileSpirV.hpp>
+#endif
+
+#pragma warning( disable:5245 )
+#pragma GCC diagnostic ignored "-Wunused-function"
+#pragma clang diagnostic ignored "-Wunused-member-function"
+
+namespace
+{
+	enum class LoopKind
+	{
+		eFor,
+		eWhile,
+		eDoWhile,
+	};
+
+	struct Hints
+	{
+		std::vector< ast::stmt::LoopHint > loops;
+		std::vector< ast::stmt::SelectionHint > selections;
+	};
+
+	void gatherHints( ast::stmt::Container const & container
+		, Hints & result )
+	{
+		for ( auto & stmt : container )
+		{
+			if ( auto loop = dynamic_cast< ast::stmt::Loop const * >( stmt.get() ) )
+			{
+				result.loops.push_back( loop->getHint() );
+			}
+			else if ( auto selection = dynamic_cast< ast::stmt::If const * >( stmt.get() ) )
+			{
+				result.selections.push_back( selection->getHint() );
+			}
+
+			if ( auto compound = dynamic_cast< ast::stmt::Container const * >( stmt.get() ) )
+			{
+				gatherHints( *compound, result );
+			}
+		}
+	}
+
+	// A loop summing its four iterations indices.
+	ast::ShaderPtr makeLoopShader( test::sdw_test::TestCounts & testCounts
+		, LoopKind kind
+		, ast::stmt::LoopHint hint )
+	{
+		using namespace sdw;
+		sdw::ComputeWriter writer{ &testCounts.allocator };
+		sdw::StorageBuffer bo{ writer, "Datas", 0u, 0u };
+		auto a = bo.declMember< Int >( "a" );
+		bo.end();
+		writer.implementMainT< VoidT >( 1u, [&]( ComputeIn in )
+			{
+				auto sum = writer.declLocale( "sum", writer.cast< Int >( in.localInvocationIndex ) );
+
+				switch ( kind )
+				{
+				case LoopKind::eFor:
+					FOR_HINT( writer, hint, Int, i, 0, i < 4_i, ++i )
+					{
+						sum += i;
+					}
+					ROF;
+					break;
+				case LoopKind::eWhile:
+					{
+						auto i = writer.declLocale( "i", 0_i );
+						WHILE_HINT( writer, hint, i < 4_i )
+						{
+							sum += i;
+							i += 1_i;
+						}
+						ELIHW;
+					}
+					break;
+				case LoopKind::eDoWhile:
+					{
+						auto i = writer.declLocale( "i", 0_i );
+						DOWHILE_HINT( writer, hint, i < 4_i )
+						{
+							sum += i;
+							i += 1_i;
+						}
+						ELIHWOD;
+					}
+					break;
+				}
+
+				a = sum;
+			} );
+		return writer.getBuilder().releaseShader();
+	}
+
+	// An if statement only assigning a local variable.
+	ast::ShaderPtr makeSelectionShader( test::sdw_test::TestCounts & testCounts
+		, ast::stmt::SelectionHint hint )
+	{
+		using namespace sdw;
+		sdw::ComputeWriter writer{ &testCounts.allocator };
+		sdw::StorageBuffer bo{ writer, "Datas", 0u, 0u };
+		auto a = bo.declMember< Int >( "a" );
+		bo.end();
+		writer.implementMainT< VoidT >( 1u, [&]( ComputeIn in )
+			{
+				auto index = writer.declLocale( "index", writer.cast< Int >( in.localInvocationIndex ) );
+				auto value = writer.declLocale( "value", 0_i );
+
+				IF_HINT( writer, hint, index > 2_i )
+				{
+					value = index * 2_i;
+				}
+				ELSE
+				{
+					value = index + 3_i;
+				}
+				FI;
+
+				a = value;
+			} );
+		return writer.getBuilder().releaseShader();
+	}
+
+#if SDW_HasCompilerSpirV
+	std::string compileOptimised( ast::Shader const & shader
+		, ast::OptimisationConfig optimisations
+		, ast::OptimisationStats & stats )
+	{
+		spirv::SpirVConfig config{};
+		config.optimisations = optimisations;
+		config.optimisations.stats = &stats;
+		return spirv::writeSpirv( shader, config, false );
+	}
+#endif
+
+	void loopHint( test::sdw_test::TestCounts & testCounts
+		, std::string const & name
+		, LoopKind kind )
+	{
+		testBegin( name );
+		auto kept = makeLoopShader( testCounts, kind, ast::stmt::LoopHint::eDontUnroll );
+		Hints hints;
+		gatherHints( *kept->getStatements(), hints );
+		require( hints.loops.size() == 1u );
+		check( hints.loops.front() == ast::stmt::LoopHint::eDontUnroll );
+
+#if SDW_HasCompilerSpirV
+		ast::OptimisationConfig optimisations{};
+		optimisations.unrollLoops = true;
+		ast::OptimisationStats keptStats{};
+		auto keptText = compileOptimised( *kept, optimisations, keptStats );
+		checkEqual( keptStats.unrolling.loops, 0u );
+		check( keptText.find( "LoopMerge" ) != std::string::npos );
+		check( keptText.find( "DontUnroll" ) != std::string::npos );
+
+		// Without the hint, the same loop is unrolled.
+		auto unrolled = makeLoopShader( testCounts, kind, ast::stmt::LoopHint::eNone );
+		ast::OptimisationStats unrolledStats{};
+		auto unrolledText = compileOptimised( *unrolled, optimisations, unrolledStats );
+		checkEqual( unrolledStats.unrolling.loops, 1u );
+		check( unrolledText.find( "LoopMerge" ) == std::string::npos );
+#endif
+		testEnd();
+	}
+
+	void ifHint( test::sdw_test::TestCounts & testCounts )
+	{
+		testBegin( "ifHint" );
+		auto kept = makeSelectionShader( testCounts, ast::stmt::SelectionHint::eDontFlatten );
+		Hints hints;
+		gatherHints( *kept->getStatements(), hints );
+		require( hints.selections.size() == 1u );
+		check( hints.selections.front() == ast::stmt::SelectionHint::eDontFlatten );
+
+#if SDW_HasCompilerSpirV
+		ast::OptimisationConfig optimisations{};
+		optimisations.flattenBranches = true;
+		ast::OptimisationStats keptStats{};
+		auto keptText = compileOptimised( *kept, optimisations, keptStats );
+		checkEqual( keptStats.flattening.branches, 0u );
+		check( keptText.find( "BranchConditional" ) != std::string::npos );
+		check( keptText.find( "DontFlatten" ) != std::string::npos );
+
+		// Without the hint, the same if statement is flattened.
+		auto flattened = makeSelectionShader( testCounts, ast::stmt::SelectionHint::eNone );
+		ast::OptimisationStats flattenedStats{};
+		auto flattenedText = compileOptimised( *flattened, optimisations, flattenedStats );
+		checkEqual( flattenedStats.flattening.branches, 1u );
+		check( flattenedText.find( "BranchConditional" ) == std::string::npos );
+#endif
+		testEnd();
+	}
+}
+
+sdwTestSuiteMain( TestWriterOptimisationHints )
+{
+	sdwTestSuiteBegin();
+	loopHint( testCounts, "forHint", LoopKind::eFor );
+	loopHint( testCounts, "whileHint", LoopKind::eWhile );
+	loopHint( testCounts, "doWhileHint", LoopKind::eDoWhile );
+	ifHint( testCounts );
+	sdwTestSuiteEnd();
+}
+
+sdwTestSuiteLaunch( TestWriterOptimisationHints )
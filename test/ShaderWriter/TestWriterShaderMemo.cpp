@@ -0,0 +1,255 @@
+#include "Common.hpp"
+#include "WriterCommon.hpp"
+
+#if SDW_HasCompilerGlsl
+#	include <CompilerGlsl/compileGlsl.hpp>
+#endif
+#if SDW_HasCompilerHlsl
+#	include <CompilerHlsl/compileHlsl.hpp>
+#endif
+#if SDW_HasCompilerSpirV
+#	include <CompilerSpirV/compileSpirV.hpp>
+#endif
+
+#include <sstream>
+
+#pragma warning( disable:5245 )
+#pragma GCC diagnostic ignored "-Wunused-function"
+#pragma clang diagnostic ignored "-Wunused-member-function"
+
+namespace
+{
+	using NameList = std::vector< std::string >;
+
+	// Only combine depends on offset, store calls it, and main calls store.
+	ast::ShaderPtr makeShader( test::sdw_test::TestCounts & testCounts
+		, int32_t offset )
+	{
+		using namespace sdw;
+		sdw::ComputeWriter writer{ &testCounts.allocator };
+		sdw::StorageBuffer bo{ writer, "Datas", 0u, 0u };
+		auto a = bo.declMember< Int >( "a" );
+		auto b = bo.declMember< Vec4 >( "b" );
+		bo.end();
+		auto twice = writer.implementFunction< Int >( "twice"
+			, [&]( Int const & p )
+			{
+				writer.returnStmt( p * 2_i );
+			}
+			, InInt{ writer, "p" } );
+		auto scale = writer.implementFunction< Vec4 >( "scale"
+			, [&]( Vec4 const & p
+				, Float const & f )
+			{
+				auto v = writer.declLocale( "v", p * f );
+				writer.returnStmt( v + vec4( 1.0_f ) );
+			}
+			, InVec4{ writer, "p" }
+			, InFloat{ writer, "f" } );
+		auto combine = writer.implementFunction< Int >( "combine"
+			, [&]( Int const & p
+				, Int const & q )
+			{
+				IF( writer, p > q )
+				{
+					writer.returnStmt( twice( p ) );
+				}
+				FI;
+				writer.returnStmt( twice( q ) + offset );
+			}
+			, InInt{ writer, "p" }
+			, InInt{ writer, "q" } );
+		auto store = writer.implementFunction< Void >( "store"
+			, [&]( Int const & p )
+			{
+				a = combine( p, 2_i );
+				b = scale( b, writer.cast< Float >( p ) );
+			}
+			, InInt{ writer, "p" } );
+		writer.implementMainT< VoidT >( 1u, [&]( ComputeIn in )
+			{
+				auto index = writer.declLocale( "index", writer.cast< Int >( in.localInvocationIndex ) );
+				store( twice( index ) );
+			} );
+		return writer.getBuilder().releaseShader();
+	}
+
+	// Compiles the shader, changes combine, and compiles it again, with the same memo.
+	template< typename MemoT, typename CompileT >
+	void checkMemo( test::sdw_test::TestCounts & testCounts
+		, MemoT & memo
+		, CompileT compile )
+	{
+		auto shader = makeShader( testCounts, 3 );
+		auto output = compile( *shader, memo );
+		check( !memo.isReused() );
+		checkEqual( memo.getGeneratedFunctions().size(), 5u );
+		// A rebuilt shader reuses the whole output.
+		auto same = makeShader( testCounts, 3 );
+		check( compile( *same, memo ) == output );
+		check( memo.isReused() );
+		check( memo.getGeneratedFunctions().empty() );
+		// Only combine and its callers are generated again.
+		auto changed = makeShader( testCounts, 4 );
+		output = compile( *changed, memo );
+		check( !memo.isReused() );
+		check( ( memo.getGeneratedFunctions() == NameList{ "combine", "store", "main" } ) );
+		// The reused functions give the output of a whole generation.
+		MemoT fresh;
+		check( compile( *changed, fresh ) == output );
+		checkEqual( fresh.getGeneratedFunctions().size(), 5u );
+	}
+
+#if SDW_HasCompilerGlsl
+	void glslMemo( test::sdw_test::TestCounts & testCounts )
+	{
+		testBegin( "glslMemo" );
+		glsl::GlslConfig const baseConfig{ ast::ShaderStage::eCompute
+			, glsl::v4_6
+			, {}
+			, true
+			, false
+			, false
+			, true
+			, true
+			, true
+			, true };
+		auto compile = [&baseConfig]( ast::Shader const & shader
+			, glsl::GlslMemo & memo )
+		{
+			auto config = baseConfig;
+			return glsl::compileGlsl( shader
+				, ast::SpecialisationInfo{}
+				, config
+				, memo );
+		};
+		glsl::GlslMemo memo;
+		checkMemo( testCounts, memo, compile );
+		// The spliced source is the one compileGlsl gives.
+		auto shader = makeShader( testCounts, 4 );
+		auto config = baseConfig;
+		checkEqual( compile( *shader, memo ), glsl::compileGlsl( *shader
+			, ast::SpecialisationInfo{}
+			, config ) );
+		check( memo.isReused() );
+		testEnd();
+	}
+#endif
+
+#if SDW_HasCompilerHlsl
+	void hlslMemo( test::sdw_test::TestCounts & testCounts )
+	{
+		testBegin( "hlslMemo" );
+		hlsl::HlslConfig const config{ hlsl::v6_6, ast::ShaderStage::eCompute };
+		auto compile = [&config]( ast::Shader const & shader
+			, hlsl::HlslMemo & memo )
+		{
+			return hlsl::compileHlsl( shader
+				, ast::SpecialisationInfo{}
+				, config
+				, memo );
+		};
+		hlsl::HlslMemo memo;
+		checkMemo( testCounts, memo, compile );
+		// The spliced source is the one compileHlsl gives.
+		auto shader = makeShader( testCounts, 4 );
+		checkEqual( compile( *shader, memo ), hlsl::compileHlsl( *shader
+			, ast::SpecialisationInfo{}
+			, config ) );
+		check( memo.isReused() );
+		testEnd();
+	}
+#endif
+
+#if SDW_HasCompilerSpirV
+	// The count of textual instructions whose opcode is opName, like "%12 = FunctionCall ..." or "Store %4 %7".
+	size_t countInstructions( std::string const & text
+		, std::string const & opName )
+	{
+		size_t result{};
+		std::stringstream stream{ text };
+
+		for ( std::string line; std::getline( stream, line ); )
+		{
+			auto pos = line.find( ") " );
+
+			if ( pos == std::string::npos )
+			{
+				continue;
+			}
+
+			std::stringstream words{ line.substr( pos + 2u ) };
+			std::string word;
+			words >> word;
+
+			if ( word.front() == '%' )
+			{
+				words >> word >> word;
+			}
+
+			result += ( word == opName ) ? 1u : 0u;
+		}
+
+		return result;
+	}
+
+	void spirvMemo( test::sdw_test::TestCounts & testCounts )
+	{
+		testBegin( "spirvMemo" );
+
+		for ( auto compactIds : { false, true } )
+		{
+			spirv::SpirVConfig baseConfig{};
+			baseConfig.debugLevel = spirv::DebugLevel::eNames;
+			baseConfig.compactIds = compactIds;
+			auto compile = [&baseConfig]( ast::Shader const & shader
+				, spirv::SpirVMemo & memo )
+			{
+				auto config = baseConfig;
+				return spirv::serialiseSpirv( shader, config, memo );
+			};
+			spirv::SpirVMemo memo;
+			checkMemo( testCounts, memo, compile );
+			// The merged module holds the same functions and globals as the one generated at once.
+			auto shader = makeShader( testCounts, 4 );
+			auto config = baseConfig;
+			auto words = compile( *shader, memo );
+			auto expected = spirv::serialiseSpirv( *shader, config );
+			auto block = testCounts.allocator.getBlock();
+			auto text = spirv::displaySpirv( *block, words );
+			auto expectedText = spirv::displaySpirv( *block, expected );
+
+			for ( auto opName : { "Function", "FunctionCall", "Variable", "TypeStruct", "EntryPoint", "Name" } )
+			{
+				checkEqual( countInstructions( text, opName ), countInstructions( expectedText, opName ) );
+			}
+
+			checkEqual( words.size(), expected.size() );
+
+			if ( compactIds )
+			{
+				checkEqual( words[3], expected[3] );
+			}
+		}
+
+		testEnd();
+	}
+#endif
+}
+
+sdwTestSuiteMain( TestWriterShaderMemo )
+{
+	sdwTestSuiteBegin();
+#if SDW_HasCompilerGlsl
+	glslMemo( testCounts );
+#endif
+#if SDW_HasCompilerHlsl
+	hlslMemo( testCounts );
+#endif
+#if SDW_HasCompilerSpirV
+	spirvMemo( testCounts );
+#endif
+	sdwTestSuiteEnd();
+}
+
+sdwTestSuiteLaunch( TestWriterShaderMemo )
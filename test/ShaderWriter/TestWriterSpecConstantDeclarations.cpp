@@ -1,6 +1,18 @@
 #include "Common.hpp"
 #include "WriterCommon.hpp"
 
+#if SDW_HasCompilerGlsl
+#	include <CompilerGlsl/compileGlsl.hpp>
+#endif
+#if SDW_HasCompilerHlsl
+#	include <CompilerHlsl/compileHlsl.hpp>
+#endif
+#if SDW_HasCompilerSpirV
+#	include <CompilerSpirV/compileSpirV.hpp>
+#endif
+
+#include <cstring>
+
 namespace
 {
 	template< typename T >
@@ -71,6 +83,125 @@ namespace
 		}
 		testEnd();
 	}
+
+	// colour = 0, or 1 if value > 2
+	ast::ShaderPtr makeGuardedShader( test::sdw_test::TestCounts & testCounts )
+	{
+		using namespace sdw;
+		sdw::FragmentWriter writer{ &testCounts.allocator };
+		auto value = writer.declSpecConstant( "value", 0u, 0 );
+		auto colour = writer.declOutput< Vec4 >( "colour", 0u );
+		writer.implementMainT< VoidT, VoidT >( [&]( FragmentInT< VoidT > in
+			, FragmentOutT< VoidT > out )
+			{
+				colour = vec4( 0.0_f );
+
+				IF( writer, value > 2_i )
+				{
+					colour = vec4( 1.0_f );
+				}
+				FI;
+			} );
+		return writer.getBuilder().releaseShader();
+	}
+
+	ast::SpecialisationInfo makeSpecialisation( ast::Shader const & shader
+		, int32_t value )
+	{
+		ast::SpecialisationInfo result;
+		result.data.push_back( { shader.getSpecConstants().begin()->second, std::vector< uint8_t >( sizeof( value ) ) } );
+		std::memcpy( result.data.back().data.data(), &value, sizeof( value ) );
+		return result;
+	}
+
+#if SDW_HasCompilerSpirV
+	void testBakedSpecConstant( test::sdw_test::TestCounts & testCounts )
+	{
+		testBegin( "testBakedSpecConstant" );
+		auto shader = makeGuardedShader( testCounts );
+
+		spirv::SpirVConfig specConfig{};
+		auto spec = spirv::writeSpirv( *shader, specConfig, false );
+		check( spec.find( "SpecConstant" ) != std::string::npos );
+		check( spec.find( "BranchConditional" ) != std::string::npos );
+
+		// value = 1, the guarded branch is unreachable.
+		auto specialisation = makeSpecialisation( *shader, 1 );
+		spirv::SpirVConfig bakedConfig{};
+		bakedConfig.specialisation = &specialisation;
+		auto baked = spirv::writeSpirv( *shader, bakedConfig, false );
+		check( baked.find( "SpecConstant" ) == std::string::npos );
+		check( baked.find( "BranchConditional" ) == std::string::npos );
+		check( baked.find( "SelectionMerge" ) == std::string::npos );
+		testEnd();
+	}
+#endif
+
+#if SDW_HasCompilerGlsl
+	void testGlslVariants( test::sdw_test::TestCounts & testCounts )
+	{
+		testBegin( "testGlslVariants" );
+		auto shader = makeGuardedShader( testCounts );
+		glsl::GlslConfig const baseConfig{ ast::ShaderStage::eFragment
+			, glsl::v4_6
+			, {}
+			, true
+			, false
+			, false
+			, true
+			, true
+			, true
+			, true };
+		{
+			auto config = baseConfig;
+			auto variants = glsl::compileGlslVariants( *shader, {}, config );
+			check( variants.empty() );
+		}
+		{
+			std::vector< ast::SpecialisationInfo > const specialisations{ makeSpecialisation( *shader, 1 )
+				, makeSpecialisation( *shader, 3 ) };
+			auto config = baseConfig;
+			auto variants = glsl::compileGlslVariants( *shader, specialisations, config );
+			require( variants.size() == specialisations.size() );
+
+			for ( size_t index = 0u; index < variants.size(); ++index )
+			{
+				auto standaloneConfig = baseConfig;
+				checkEqual( variants[index], glsl::compileGlsl( *shader, specialisations[index], standaloneConfig ) );
+			}
+
+			checkNotEqual( variants[0], variants[1] );
+		}
+		testEnd();
+	}
+#endif
+
+#if SDW_HasCompilerHlsl
+	void testHlslVariants( test::sdw_test::TestCounts & testCounts )
+	{
+		testBegin( "testHlslVariants" );
+		auto shader = makeGuardedShader( testCounts );
+		hlsl::HlslConfig const config{ hlsl::v6_6, ast::ShaderStage::eFragment };
+		{
+			auto variants = hlsl::compileHlslVariants( *shader, {}, config );
+			check( variants.empty() );
+		}
+		{
+			std::vector< ast::SpecialisationInfo > const specialisations{ makeSpecialisation( *shader, 1 )
+				, makeSpecialisation( *shader, 3 ) };
+			auto variants = hlsl::compileHlslVariants( *shader, specialisations, config );
+			require( variants.size() == specialisations.size() );
+
+			for ( size_t index = 0u; index < variants.size(); ++index )
+			{
+				checkEqual( variants[index], hlsl::compileHlsl( *shader, specialisations[index], config ) );
+			}
+
+			checkNotEqual( variants[0], variants[1] );
+		}
+		testEnd();
+	}
+#endif
 }
 
 sdwTestSuiteMain( TestWriterSpecConstantDeclarations )
@@ -81,6 +212,15 @@ sdwTestSuiteMain( TestWriterSpecConstantDeclarations )
 	testSpecConstant< uint32_t >( testCounts );
 	testSpecConstant< float >( testCounts );
 	testSpecConstant< double >( testCounts );
+#if SDW_HasCompilerSpirV
+	testBakedSpecConstant( testCounts );
+#endif
+#if SDW_HasCompilerGlsl
+	testGlslVariants( testCounts );
+#endif
+#if SDW_HasCompilerHlsl
+	testHlslVariants( testCounts );
+#endif
 	sdwTestSuiteEnd();
 }
 
@@ -0,0 +1,402 @@
+#include "Common.hpp"
+#include "WriterCommon.hpp"
+
+#if SDW_HasCompilerSpirV
+#	include <CompilerSpirV/compileSpirV.hpp>
+#endif
+
+#include <algorithm>
+#include <sstream>
+
+namespace
+{
+#if SDW_HasCompilerSpirV
+	using LineList = std::vector< std::string >;
+
+	// The textual instructions whose opcode is opName, like "%12 = AccessChain ..." or "Store %4 %7".
+	LineList findInstructions( std::string const & text
+		, std::string const & opName )
+	{
+		LineList result;
+		std::stringstream stream{ text };
+
+		for ( std::string line; std::getline( stream, line ); )
+		{
+			auto pos = line.find( ") " );
+
+			if ( pos == std::string::npos )
+			{
+				continue;
+			}
+
+			std::stringstream words{ line.substr( pos + 2u ) };
+			std::string word;
+			words >> word;
+
+			if ( word.front() == '%' )
+			{
+				words >> word >> word;
+			}
+
+			if ( word == opName )
+			{
+				result.push_back( line );
+			}
+		}
+
+		return result;
+	}
+
+	// The result id of a textual instruction, like "%12".
+	std::string getResultId( std::string const & line )
+	{
+		std::stringstream words{ line.substr( line.find( ") " ) + 2u ) };
+		std::string result;
+		words >> result;
+		return result;
+	}
+
+	void storeThenLoad( test::sdw_test::TestCounts & testCounts )
+	{
+		testBegin( "storeThenLoad" );
+		using namespace sdw;
+		sdw::ComputeWriter writer{ &testCounts.allocator };
+		sdw::StorageBuffer bo{ writer, "Datas", 0u, 0u };
+		auto a = bo.declMember< Int >( "a" );
+		bo.end();
+		writer.implementMainT< VoidT >( 1u, [&]( ComputeIn in )
+			{
+				a = writer.cast< Int >( in.localInvocationIndex );
+				a = a + 1_i;
+			} );
+		auto & shader = writer.getShader();
+
+		spirv::SpirVConfig config{};
+		config.eliminateRedundantMemoryAccesses = true;
+		auto text = spirv::writeSpirv( shader, config, false );
+		auto chains = findInstructions( text, "AccessChain" );
+		require( chains.size() == 1u );
+		auto chain = getResultId( chains.front() );
+		check( findInstructions( text, "Store" ).size() == 2u );
+
+		for ( auto & load : findInstructions( text, "Load" ) )
+		{
+			// Only the invocation index is loaded, a's stored value is reused.
+			check( load.substr( load.size() - chain.size() - 1u ) != " " + chain );
+		}
+
+		testEnd();
+	}
+
+	void siblingStore( test::sdw_test::TestCounts & testCounts )
+	{
+		testBegin( "siblingStore" );
+		using namespace sdw;
+		sdw::ComputeWriter writer{ &testCounts.allocator };
+		sdw::StorageBuffer bo{ writer, "Datas", 0u, 0u };
+		auto a = bo.declMember< Int >( "a" );
+		auto b = bo.declMember< Int >( "b" );
+		bo.end();
+		writer.implementMainT< VoidT >( 1u, [&]( ComputeIn in )
+			{
+				a = writer.cast< Int >( in.localInvocationIndex );
+				b = a + 1_i;
+				b = a + b;
+			} );
+		auto & shader = writer.getShader();
+
+		spirv::SpirVConfig config{};
+		config.eliminateRedundantMemoryAccesses = true;
+		auto text = spirv::writeSpirv( shader, config, false );
+		// The chains are kept across the stores.
+		auto chains = findInstructions( text, "AccessChain" );
+		require( chains.size() == 2u );
+		auto chainA = getResultId( chains[0] );
+		// The store to b drops a's stored value, so the second read of a reloads it.
+		auto loads = findInstructions( text, "Load" );
+		require( loads.size() == 2u );
+		check( loads[1].substr( loads[1].size() - chainA.size() - 1u ) == " " + chainA );
+		testEnd();
+	}
+
+	// The Function storage class variables declarations.
+	LineList findLocalVariables( std::string const & text )
+	{
+		LineList result;
+
+		for ( auto & variable : findInstructions( text, "Variable" ) )
+		{
+			if ( variable.find( " Function" ) != std::string::npos )
+			{
+				result.push_back( variable );
+			}
+		}
+
+		return result;
+	}
+
+	void promotedLocal( test::sdw_test::TestCounts & testCounts )
+	{
+		testBegin( "promotedLocal" );
+		using namespace sdw;
+		sdw::ComputeWriter writer{ &testCounts.allocator };
+		sdw::StorageBuffer bo{ writer, "Datas", 0u, 0u };
+		auto a = bo.declMember< Int >( "a" );
+		bo.end();
+		writer.implementMainT< VoidT >( 1u, [&]( ComputeIn in )
+			{
+				auto index = writer.declLocale( "index", writer.cast< Int >( in.localInvocationIndex ) );
+				auto value = writer.declLocale( "value", 0_i );
+
+				IF( writer, index > 2_i )
+				{
+					value = index * 2_i;
+				}
+				ELSE
+				{
+					value = index + 3_i;
+				}
+				FI;
+
+				a = value;
+			} );
+		auto & shader = writer.getShader();
+
+		spirv::SpirVConfig unpromotedConfig{};
+		check( findLocalVariables( spirv::writeSpirv( shader, unpromotedConfig, false ) ).size() == 2u );
+
+		spirv::SpirVConfig config{};
+		config.promoteLocalVariables = true;
+		auto text = spirv::writeSpirv( shader, config, false );
+		// value's two stored values meet in the selection merge block.
+		check( findInstructions( text, "Phi" ).size() == 1u );
+		check( findLocalVariables( text ).empty() );
+		testEnd();
+	}
+
+	void emptySelection( test::sdw_test::TestCounts & testCounts )
+	{
+		testBegin( "emptySelection" );
+		using namespace sdw;
+		sdw::ComputeWriter writer{ &testCounts.allocator };
+		sdw::StorageBuffer bo{ writer, "Datas", 0u, 0u };
+		auto a = bo.declMember< Int >( "a" );
+		bo.end();
+		writer.implementMainT< VoidT >( 1u, [&]( ComputeIn in )
+			{
+				auto index = writer.declLocale( "index", writer.cast< Int >( in.localInvocationIndex ) );
+
+				IF( writer, index > 4_i )
+				{
+				}
+				FI;
+
+				a = index;
+			} );
+		auto & shader = writer.getShader();
+
+		spirv::ControlFlowStats stats{};
+		spirv::SpirVConfig config{};
+		config.simplifyControlFlow = true;
+		config.controlFlowStats = &stats;
+		auto text = spirv::writeSpirv( shader, config, false );
+		check( stats.blocksAfter < stats.blocksBefore );
+		// The selection is folded, and its merge block is merged into the header.
+		check( stats.blocksAfter == 1u );
+		check( findInstructions( text, "SelectionMerge" ).empty() );
+		check( findInstructions( text, "BranchConditional" ).empty() );
+		testEnd();
+	}
+
+	// The greatest id referenced by a textual module.
+	uint32_t getMaxId( std::string const & text )
+	{
+		uint32_t result{};
+
+		for ( auto pos = text.find( '%' ); pos != std::string::npos; pos = text.find( '%', pos + 1u ) )
+		{
+			result = std::max( result, uint32_t( std::stoul( text.substr( pos + 1u ) ) ) );
+		}
+
+		return result;
+	}
+
+	// The result ids of a textual module, in definition order.
+	std::vector< uint32_t > getDefinedIds( std::string const & text )
+	{
+		std::vector< uint32_t > result;
+		std::stringstream stream{ text };
+
+		for ( std::string line; std::getline( stream, line ); )
+		{
+			if ( line.find( ") " ) == std::string::npos )
+			{
+				continue;
+			}
+
+			if ( auto id = getResultId( line );
+				id.front() == '%' )
+			{
+				result.push_back( uint32_t( std::stoul( id.substr( 1u ) ) ) );
+			}
+		}
+
+		return result;
+	}
+
+	ast::ShaderPtr makeSelectionShader( test::sdw_test::TestCounts & testCounts )
+	{
+		using namespace sdw;
+		sdw::ComputeWriter writer{ &testCounts.allocator };
+		sdw::StorageBuffer bo{ writer, "Datas", 0u, 0u };
+		auto a = bo.declMember< Int >( "a" );
+		bo.end();
+		writer.implementMainT< VoidT >( 1u, [&]( ComputeIn in )
+			{
+				auto index = writer.declLocale( "index", writer.cast< Int >( in.localInvocationIndex ) );
+
+				IF( writer, index > 2_i )
+				{
+					a = index * 2_i;
+				}
+				ELSE
+				{
+					a = index + 3_i;
+				}
+				FI;
+			} );
+		return writer.getBuilder().releaseShader();
+	}
+
+	void compactedIds( test::sdw_test::TestCounts & testCounts )
+	{
+		testBegin( "compactedIds" );
+		auto shader = makeSelectionShader( testCounts );
+
+		spirv::SpirVConfig config{};
+		config.compactIds = true;
+		auto text = spirv::writeSpirv( *shader, config );
+		auto words = spirv::serialiseSpirv( *shader, config );
+		require( words.size() > 5u );
+		// The ids bound is the fourth word of the header.
+		checkEqual( words[3], getMaxId( text ) + 1u );
+		// The ids are defined densely, in definition order.
+		auto definitions = getDefinedIds( text );
+
+		for ( uint32_t index = 0u; index < definitions.size(); ++index )
+		{
+			checkEqual( definitions[index], index + 1u );
+		}
+
+		// The same shader, written again, gives the same module.
+		auto other = makeSelectionShader( testCounts );
+		spirv::SpirVConfig otherConfig{};
+		otherConfig.compactIds = true;
+		check( words == spirv::serialiseSpirv( *other, otherConfig ) );
+		testEnd();
+	}
+
+	// Several functions calling each other, sharing a buffer, constants and a struct type.
+	ast::ShaderPtr makeFunctionsShader( test::sdw_test::TestCounts & testCounts )
+	{
+		using namespace sdw;
+		sdw::ComputeWriter writer{ &testCounts.allocator };
+		sdw::StorageBuffer bo{ writer, "Datas", 0u, 0u };
+		auto a = bo.declMember< Int >( "a" );
+		auto b = bo.declMember< Vec4 >( "b" );
+		bo.end();
+		auto twice = writer.implementFunction< Int >( "twice"
+			, [&]( Int const & p )
+			{
+				writer.returnStmt( p * 2_i );
+			}
+			, InInt{ writer, "p" } );
+		auto scale = writer.implementFunction< Vec4 >( "scale"
+			, [&]( Vec4 const & p
+				, Float const & f )
+			{
+				auto v = writer.declLocale( "v", p * f );
+				writer.returnStmt( v + vec4( 1.0_f ) );
+			}
+			, InVec4{ writer, "p" }
+			, InFloat{ writer, "f" } );
+		auto combine = writer.implementFunction< Int >( "combine"
+			, [&]( Int const & p
+				, Int const & q )
+			{
+				IF( writer, p > q )
+				{
+					writer.returnStmt( twice( p ) );
+				}
+				FI;
+				writer.returnStmt( twice( q ) + 3_i );
+			}
+			, InInt{ writer, "p" }
+			, InInt{ writer, "q" } );
+		auto store = writer.implementFunction< Void >( "store"
+			, [&]( Int const & p )
+			{
+				a = combine( p, 2_i );
+				b = scale( b, writer.cast< Float >( p ) );
+			}
+			, InInt{ writer, "p" } );
+		writer.implementMainT< VoidT >( 1u, [&]( ComputeIn in )
+			{
+				auto index = writer.declLocale( "index", writer.cast< Int >( in.localInvocationIndex ) );
+				store( twice( index ) );
+			} );
+		return writer.getBuilder().releaseShader();
+	}
+
+	void parallelFunctions( test::sdw_test::TestCounts & testCounts )
+	{
+		testBegin( "parallelFunctions" );
+		auto shader = makeFunctionsShader( testCounts );
+		spirv::SpirVConfig sequentialConfig{};
+		auto sequential = spirv::writeSpirv( *shader, sequentialConfig );
+		auto sequentialWords = spirv::serialiseSpirv( *shader, sequentialConfig );
+
+		for ( uint32_t threads = 2u; threads <= 3u; ++threads )
+		{
+			spirv::SpirVConfig config{};
+			config.generationThreads = threads;
+			auto text = spirv::writeSpirv( *shader, config );
+			// The merged module holds the same functions and globals as the sequential one.
+			checkEqual( findInstructions( text, "Function" ).size(), findInstructions( sequential, "Function" ).size() );
+			checkEqual( findInstructions( text, "FunctionCall" ).size(), findInstructions( sequential, "FunctionCall" ).size() );
+			checkEqual( findInstructions( text, "Variable" ).size(), findInstructions( sequential, "Variable" ).size() );
+			checkEqual( findInstructions( text, "TypeStruct" ).size(), findInstructions( sequential, "TypeStruct" ).size() );
+			checkEqual( findInstructions( text, "EntryPoint" ).size(), 1u );
+			// The module only depends on the threads count.
+			auto words = spirv::serialiseSpirv( *shader, config );
+			check( getMaxId( text ) < words[3] );
+			auto other = makeFunctionsShader( testCounts );
+			check( words == spirv::serialiseSpirv( *other, config ) );
+			checkEqual( words.size(), sequentialWords.size() );
+
+			config.compactIds = true;
+			words = spirv::serialiseSpirv( *shader, config );
+			text = spirv::writeSpirv( *shader, config );
+			checkEqual( words[3], getMaxId( text ) + 1u );
+		}
+
+		testEnd();
+	}
+#endif
+}
+
+sdwTestSuiteMain( TestWriterSpirVPasses )
+{
+	sdwTestSuiteBegin();
+#if SDW_HasCompilerSpirV
+	storeThenLoad( testCounts );
+	siblingStore( testCounts );
+	promotedLocal( testCounts );
+	emptySelection( testCounts );
+	compactedIds( testCounts );
+	parallelFunctions( testCounts );
+#endif
+	sdwTestSuiteEnd();
+}
+
+sdwTestSuiteLaunch( TestWriterSpirVPasses )
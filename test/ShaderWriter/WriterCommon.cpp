@@ -44,6 +44,26 @@ namespace test
 {
 	namespace
 	{
+		// Every AST optimisation, so that they are validated on all the writer tests shaders.
+		ast::OptimisationConfig getAllOptimisations()
+		{
+			ast::OptimisationConfig result{};
+			result.inlineFunctions = true;
+			result.unrollLoops = true;
+			result.propagateConstants = true;
+			result.reduceStrength = true;
+			result.coalesceComponents = true;
+			result.flattenBranches = true;
+			result.hoistLoopInvariants = true;
+			result.eliminateCommonSubexpressions = true;
+			result.eliminateDeadCode = true;
+			result.eliminateBarriers = true;
+			result.inferBufferAccess = true;
+			result.placeNonUniform = true;
+			result.relaxPrecision = true;
+			return result;
+		}
+
 #if SDW_HasCompilerGlsl
 
 		glsl::GlslExtensionSet getExtensions( uint32_t glslVersion )
@@ -845,16 +865,31 @@ namespace test
 		{
 #if SDW_HasCompilerGlsl
 
-			auto validate = [&]()
+			bool plainFailed{};
+			auto validate = [&]( bool optimise )
 			{
 				for ( auto & entryPoint : entryPoints )
 				{
 					testCounts.incIndent();
-					testCounts << printStage( entryPoint.stage ) << " stage, entry point :[" << entryPoint.name << "]" << endl;
+
+					if ( optimise )
+					{
+						testCounts << printStage( entryPoint.stage ) << " stage, entry point :[" << entryPoint.name << "], AST optimisations" << endl;
+					}
+					else
+					{
+						testCounts << printStage( entryPoint.stage ) << " stage, entry point :[" << entryPoint.name << "]" << endl;
+					}
+
 					std::string errors;
 					auto config = getGlslConfig( testCounts.getGlslVersion( infoIndex ) );
 					config.allocator = &testCounts.allocator;
 
+					if ( optimise )
+					{
+						config.optimisations = getAllOptimisations();
+					}
+
 					if ( isRayTraceStage( entryPoint.stage )
 						|| entryPoint.stage == ast::ShaderStage::eMesh
 						|| entryPoint.stage == ast::ShaderStage::eTask )
@@ -875,6 +910,16 @@ namespace test
 					}
 					catch ( std::exception & exc )
 					{
+						// The AST optimisations must not make a shader fail to compile.
+						if ( !optimise )
+						{
+							plainFailed = true;
+						}
+						else if ( !plainFailed )
+						{
+							failure( "testWriteGlsl" );
+						}
+
 						testCounts << exc.what() << endl;
 						testCounts.decIndent();
 						return;
@@ -922,7 +967,8 @@ namespace test
 			};
 			testCounts.incIndent();
 			testCounts << "GLSL version " << std::to_string( testCounts.getGlslVersion( infoIndex ) ) << endl;
-			checkNoThrow( validate() )
+			checkNoThrow( validate( false ) )
+			checkNoThrow( validate( true ) )
 			testCounts.decIndent();
 
 #endif
@@ -958,29 +1004,56 @@ namespace test
 		{
 #if SDW_HasCompilerHlsl
 
-			auto validate = [&]()
+			bool plainFailed{};
+			auto validate = [&]( bool optimise )
 			{
 				for ( auto & entryPoint : entryPoints )
 				{
 					testCounts.incIndent();
-					testCounts << printStage( entryPoint.stage ) << " stage, entry point :[" << entryPoint.name << "]" << endl;
+
+					if ( optimise )
+					{
+						testCounts << printStage( entryPoint.stage ) << " stage, entry point :[" << entryPoint.name << "], AST optimisations" << endl;
+					}
+					else
+					{
+						testCounts << printStage( entryPoint.stage ) << " stage, entry point :[" << entryPoint.name << "]" << endl;
+					}
+
 					std::string errors;
 					std::string hlsl;
 
 					try
 					{
 						auto statements = ::ast::selectEntryPoint( shader.getStmtCache(), shader.getExprCache(), entryPoint, *shader.getStatements() );
+						hlsl::HlslConfig config{ testCounts.getHlslVersion( infoIndex )
+							, entryPoint.stage
+							, false
+							, &testCounts.allocator };
+
+						if ( optimise )
+						{
+							config.optimisations = getAllOptimisations();
+						}
+
 						hlsl = hlsl::compileHlsl( shader
 							, statements.get()
 							, entryPoint.stage
 							, specialisation
-							, hlsl::HlslConfig{ testCounts.getHlslVersion( infoIndex )
-								, entryPoint.stage
-								, false
-								, &testCounts.allocator } );
+							, config );
 					}
 					catch ( std::exception & exc )
 					{
+						// The AST optimisations must not make a shader fail to compile.
+						if ( !optimise )
+						{
+							plainFailed = true;
+						}
+						else if ( !plainFailed )
+						{
+							failure( "testWriteHlsl" );
+						}
+
 						testCounts << exc.what() << endl;
 						testCounts.decIndent();
 						return;
@@ -1009,7 +1082,8 @@ namespace test
 			auto minor = shaderModel % 10u;
 			auto model = std::to_string( major ) + "_" + std::to_string( minor );
 			testCounts << "HLSL Shader Model " << model << endl;
-			checkNoThrow( validate() )
+			checkNoThrow( validate( false ) )
+			checkNoThrow( validate( true ) )
 			testCounts.decIndent();
 #endif
 		}
@@ -1082,7 +1156,23 @@ namespace test
 			if ( testCounts.isSpirVInitialised( infoIndex )
 				&& !testCounts.isSpvIgnored( infoIndex, compilers.ignoredSpv ) )
 			{
-				auto validate = [&]( bool availableExtensions )
+				// The AST optimisations must not make a shader fail, compared to the same configuration without them.
+				bool referenceFailed{};
+				auto checkAstOptimisations = [&]( bool optimise
+					, bool optimiseAst )
+				{
+					if ( !optimiseAst )
+					{
+						referenceFailed = referenceFailed || optimise;
+					}
+					else if ( !referenceFailed )
+					{
+						failure( "testWriteSpirV" );
+					}
+				};
+				auto validate = [&]( bool availableExtensions
+					, bool optimise
+					, bool optimiseAst )
 				{
 					try
 					{
@@ -1099,6 +1189,18 @@ namespace test
 							spirv::SpirVConfig config{};
 							config.specVersion = testCounts.getSpirVVersion( infoIndex );
 							config.debugLevel = debugLevel;
+							config.eliminateRedundantMemoryAccesses = optimise;
+							config.promoteLocalVariables = optimise;
+							config.simplifyControlFlow = optimise;
+							config.compactIds = optimise;
+							config.generationThreads = optimise ? 2u : 0u;
+							spirv::ControlFlowStats controlFlowStats;
+							config.controlFlowStats = &controlFlowStats;
+
+							if ( optimiseAst )
+							{
+								config.optimisations = getAllOptimisations();
+							}
 
 							if ( availableExtensions )
 							{
@@ -1162,6 +1264,25 @@ namespace test
 								return;
 							}
 
+							if ( optimiseAst )
+							{
+								// The same module, without the AST optimisations, to report their effect on its size.
+								auto referenceConfig = config;
+								referenceConfig.controlFlowStats = nullptr;
+								referenceConfig.optimisations = {};
+								auto referenceModule = spirv::compileSpirV( *testCounts.allocatorBlock
+									, shader
+									, statements.get()
+									, entryPoint.stage
+									, referenceConfig );
+								testCounts << "SPIR-V words (AST optimisations off/on): " << spirv::serialiseModule( *referenceModule ).size()
+									<< " -> " << spirv::serialiseModule( *shaderModule ).size() << endl;
+							}
+							else if ( optimise )
+							{
+								testCounts << "SPIR-V blocks: " << controlFlowStats.blocksBefore << " -> " << controlFlowStats.blocksAfter << endl;
+							}
+
 							displayShader( "SPIR-V", textSpirv, testCounts, compilers.forceDisplay && availableExtensions, false );
 							std::vector< uint32_t > spirv;
 
@@ -1233,11 +1354,13 @@ namespace test
 					}
 					catch ( std::exception & exc )
 					{
+						checkAstOptimisations( optimise, optimiseAst );
 						testCounts << exc.what() << endl;
 						testCounts.decIndent();
 					}
 					catch ( ... )
 					{
+						checkAstOptimisations( optimise, optimiseAst );
 						testCounts << "Unknown exception" << endl;
 						testCounts.decIndent();
 					}
@@ -1245,8 +1368,10 @@ namespace test
 				testCounts.incIndent();
 				testCounts << "Vulkan " << printVkVersion( testCounts.getVulkanVersion( infoIndex ) )
 					<< " - SPIR-V " << printSpvVersion( testCounts.getSpirVVersion( infoIndex ) ) << endl;
-				checkNoThrow( validate( false ) )
-				checkNoThrow( validate( true ) )
+				checkNoThrow( validate( false, false, false ) )
+				checkNoThrow( validate( true, false, false ) )
+				checkNoThrow( validate( true, true, false ) )
+				checkNoThrow( validate( true, true, true ) )
 				testCounts.decIndent();
 			}
 